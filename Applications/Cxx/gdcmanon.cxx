@@ -23,6 +23,8 @@
 #include "gdcmVersion.h"
 #include "gdcmSystem.h"
 #include "gdcmCryptoFactory.h"
+#include "gdcmBatchAnonymizer.h"
+#include "gdcmDummyValueMap.h"
 #include "gdcmUIDGenerator.h"
 #include "gdcmAnonymizer.h"
 #include "gdcmGlobal.h"
@@ -150,78 +152,6 @@ static bool AnonymizeOneFileDumb(gdcm::Anonymizer &anon, const char *filename, c
   return success;
 }
 
-static bool AnonymizeOneFile(gdcm::Anonymizer &anon, const char *filename, const char *outfilename, bool continuemode = false)
-{
-  gdcm::Reader reader;
-  reader.SetFileName( filename );
-  if( !reader.Read() )
-    {
-    std::cerr << "Could not read : " << filename << std::endl;
-    if( continuemode )
-      {
-      std::cerr << "Skipping from anonymization process (continue mode)." << std::endl;
-      return true;
-      }
-    else
-      {
-      std::cerr << "Check [--continue] option for skipping files." << std::endl;
-      return false;
-      }
-    }
-  gdcm::File &file = reader.GetFile();
-  gdcm::MediaStorage ms;
-  ms.SetFromFile(file);
-  if( !gdcm::Defs::GetIODNameFromMediaStorage(ms) )
-    {
-    std::cerr << "The Media Storage Type of your file is not supported: " << ms << std::endl;
-    std::cerr << "Please report" << std::endl;
-    return false;
-    }
-
-  anon.SetFile( file );
-
-  if( deidentify )
-    {
-    //anon.RemovePrivateTags();
-    //anon.RemoveRetired();
-    if( !anon.BasicApplicationLevelConfidentialityProfile( true ) )
-      {
-      std::cerr << "Could not De-indentify : " << filename << std::endl;
-      return false;
-      }
-    }
-  else if ( reidentify )
-    {
-    if( !anon.BasicApplicationLevelConfidentialityProfile( false ) )
-      {
-      std::cerr << "Could not Re-indentify : " << filename << std::endl;
-      return false;
-      }
-    }
-
-  gdcm::FileMetaInformation &fmi = file.GetHeader();
-  fmi.Clear();
-
-  gdcm::Writer writer;
-  writer.SetFileName( outfilename );
-  writer.SetFile( file );
-  if( !writer.Write() )
-    {
-    std::cerr << "Could not Write : " << outfilename << std::endl;
-    if( strcmp(filename,outfilename) != 0 )
-      {
-      gdcm::System::RemoveFile( outfilename );
-      }
-    else
-      {
-      std::cerr << "gdcmanon just corrupted: " << filename << " for you (data lost)." << std::endl;
-      }
-
-    return false;
-    }
-  return true;
-}
-
 static bool GetRSAKeys(gdcm::CryptographicMessageSyntax &cms, const char *privpath = nullptr, const char *certpath = nullptr)
 {
   if( privpath && *privpath )
@@ -259,6 +189,8 @@ static void PrintHelp()
   std::cout << "  -o --output                 DICOM filename / directory" << std::endl;
   std::cout << "  -r --recursive              recursively process (sub-)directories." << std::endl;
   std::cout << "     --continue               Do not stop when file found is not DICOM." << std::endl;
+  std::cout << "     --threads %d             Number of files processed in parallel (default: number of cores)." << std::endl;
+  std::cout << "     --map FILE               Load/save the mapping to dummy values from/to FILE." << std::endl;
   std::cout << "     --root-uid               Root UID." << std::endl;
   std::cout << "     --resources-path         Resources path." << std::endl;
   std::cout << "  -k --key                    Path to RSA Private Key." << std::endl;
@@ -356,6 +288,10 @@ int main(int argc, char *argv[])
   int remove_tag = 0;
   int replace_tag = 0;
   int crypto_api = 0;
+  int threads = 0;
+  int nthreads = 0;
+  int mapfile = 0;
+  std::string mapfilename;
   std::vector<gdcm::Tag> empty_tags;
   std::vector<gdcm::Tag> clear_tags;
   std::vector<gdcm::Tag> remove_tags;
@@ -396,6 +332,8 @@ int main(int argc, char *argv[])
         {"replace", required_argument, &replace_tag, 1},
         {"continue", no_argument, &continuemode, 1},
         {"crypto", required_argument, &crypto_api, 1}, //20
+        {"threads", required_argument, &threads, 1},
+        {"map", required_argument, &mapfile, 1},
 
         {"verbose", no_argument, nullptr, 'V'},
         {"warning", no_argument, nullptr, 'W'},
@@ -545,6 +483,22 @@ int main(int argc, char *argv[])
               return 1;
               }
             }
+          else if( option_index == 21 ) /* threads */
+            {
+            assert( strcmp(s, "threads") == 0 );
+            nthreads = atoi(optarg);
+            if( nthreads < 0 )
+              {
+              std::cerr << "Invalid number of threads: " << optarg << std::endl;
+              return 1;
+              }
+            }
+          else if( option_index == 22 ) /* map */
+            {
+            assert( strcmp(s, "map") == 0 );
+            assert( mapfilename.empty() );
+            mapfilename = optarg;
+            }
           //printf (" with arg %s", optarg);
           }
         //printf ("\n");
@@ -881,15 +835,10 @@ int main(int argc, char *argv[])
     cms_ptr->SetCipherType( ciphertype );
     }
 
-  // Setup gdcm::Anonymizer
-  gdcm::Anonymizer anon;
-  if( !dumb_mode )
-    {
-    anon.SetCryptographicMessageSyntax( cms_ptr );
-    }
-
   if( dumb_mode )
     {
+    // Setup gdcm::Anonymizer
+    gdcm::Anonymizer anon;
     for(unsigned int i = 0; i < nfiles; ++i)
       {
       const char *in  = filenames[i].c_str();
@@ -905,16 +854,42 @@ int main(int argc, char *argv[])
     }
   else
     {
-    for(unsigned int i = 0; i < nfiles; ++i)
+    // Consistent dummy values with previous runs:
+    gdcm::DummyValueMap dvm;
+    if( mapfile && gdcm::System::FileExists( mapfilename.c_str() )
+      && !dvm.Read( mapfilename.c_str() ) )
       {
-      const char *in  = filenames[i].c_str();
-      const char *out = outfilenames[i].c_str();
-      if( !AnonymizeOneFile(anon, in, out, (continuemode > 0 ? true: false)) )
-        {
-        //std::cerr << "Could not anonymize: " << in << std::endl;
-        delete cms_ptr;
-        return 1;
-        }
+      std::cerr << "Could not read map file: " << mapfilename << std::endl;
+      delete cms_ptr;
+      return 1;
+      }
+    gdcm::BatchAnonymizer batch;
+    batch.SetFileNames( filenames, outfilenames );
+    batch.SetCryptographicMessageSyntax( cms_ptr );
+    if( mapfile ) batch.SetDummyValueMap( &dvm );
+    batch.SetNumberOfThreads( (unsigned int)nthreads );
+    batch.SetSkipUnreadableFiles( continuemode > 0 ? true : false );
+    const bool success = batch.Anonymize( deidentify ? true : false );
+    gdcm::Directory::FilenamesType const &failed = batch.GetFailedFileNames();
+    for( size_t i = 0; i < failed.size(); ++i )
+      {
+      std::cerr << (success ? "Skipped : " : "Could not anonymize : ") << failed[i] << std::endl;
+      }
+    if( !success && !continuemode )
+      {
+      std::cerr << "Check [--continue] option for skipping files." << std::endl;
+      }
+    // Save the mapping even on error, files already written use it
+    if( mapfile && deidentify && !dvm.Write( mapfilename.c_str() ) )
+      {
+      std::cerr << "Could not write map file: " << mapfilename << std::endl;
+      delete cms_ptr;
+      return 1;
+      }
+    if( !success )
+      {
+      delete cms_ptr;
+      return 1;
       }
     }
   delete cms_ptr;
@@ -45,6 +45,7 @@ static void PrintHelp()
   std::cout << "  -o --output    DICOM filename or directory" << std::endl;
   std::cout << "  -r --recursive          recursive." << std::endl;
   std::cout << "     --descriptor          descriptor." << std::endl;
+  std::cout << "     --append              add the files to the existing output DICOMDIR." << std::endl;
   std::cout << "     --root-uid               Root UID." << std::endl;
   std::cout << "General Options:" << std::endl;
   std::cout << "  -V --verbose   more verbose (warning+error)." << std::endl;
@@ -74,6 +75,7 @@ int main(int argc, char *argv[])
   int resourcespath = 0;
   int rootuid = 0;
   int descriptor = 0;
+  int append = 0;
   std::string descriptor_str;
   std::string root;
   while (true) {
@@ -85,6 +87,7 @@ int main(int argc, char *argv[])
         {"root-uid", 1, &rootuid, 1}, // specific Root (not GDCM)
         {"resources-path", 1, &resourcespath, 1},
         {"descriptor", 1, &descriptor, 1},
+        {"append", 0, &append, 1},
 
         {"verbose", 0, &verbose, 1},
         {"warning", 0, &warning, 1},
@@ -329,8 +332,21 @@ int main(int argc, char *argv[])
     }
   (void)nfiles;
 
+  if( append )
+    {
+    gdcm::Reader reader;
+    reader.SetFileName( outfilename.c_str() );
+    if( !reader.Read() )
+      {
+      std::cerr << "Could not read DICOMDIR: " << outfilename << std::endl;
+      return 1;
+      }
+    gen.SetFile( reader.GetFile() );
+    gen.SetAppend( true );
+    }
   gen.SetFilenames( filenames );
-  gen.SetDescriptor( descriptor_str.c_str() );
+  if( descriptor )
+    gen.SetDescriptor( descriptor_str.c_str() );
   if( !gen.Generate() )
     {
     std::cerr << "Problem during generation" << std::endl;
@@ -84,6 +84,9 @@ static void PrintHelp()
   std::cout << "     --key            0123,4567=VALUE for specifying search criteria (wildcard not allowed)." << std::endl;
   std::cout << "  Note that C-MOVE supports the same queries as C-FIND, but no wildcards are allowed." << std::endl;
   std::cout << "C-GET Options:" << std::endl;
+  std::cout << "  -o --output         DICOM output directory." << std::endl;
+  std::cout << "     --key            0123,4567=VALUE for specifying search criteria (wildcard not allowed)." << std::endl;
+  std::cout << "  Note that C-GET supports the same queries as C-MOVE, files are received over the same association." << std::endl;
   std::cout << "General Options:" << std::endl;
   std::cout << "     --root-uid               Root UID." << std::endl;
   std::cout << "  -V --verbose   more verbose (warning+error)." << std::endl;
@@ -767,7 +770,52 @@ int main(int argc, char *argv[])
     }
   else if ( mode == "get" ) // C-GET SCU
     {
-    return 1;
+    // ./bin/gdcmscu --get --studyroot --study dhcp-67-183 5678 --key 20,d=1.2.3
+    gdcm::ERootType theRoot = gdcm::eStudyRootType;
+    if (findpatientroot)
+      theRoot = gdcm::ePatientRootType;
+    gdcm::EQueryLevel theLevel = gdcm::eStudy;
+    if (patientquery)
+      theLevel = gdcm::ePatient;
+    if (seriesquery)
+      theLevel = gdcm::eSeries;
+    if (imagequery)
+      theLevel = gdcm::eImage;
+
+    gdcm::SmartPointer<gdcm::BaseRootQuery> theQuery =
+      gdcm::CompositeNetworkFunctions::ConstructQuery(theRoot, theLevel ,keys, gdcm::eGet );
+
+    if (findstudyroot == 0 && findpatientroot == 0)
+      {
+      if (gdcm::Trace::GetErrorFlag())
+        {
+        std::cerr << "Need to explicitly choose query retrieve level, --patientroot or --studyroot" << std::endl;
+        }
+      std::cerr << "Get failed." << std::endl;
+      return 1;
+      }
+
+    if( storequery )
+      {
+      if (!theQuery->WriteQuery(queryfile))
+        {
+        std::cerr << "Could not write out query to: " << queryfile << std::endl;
+        std::cerr << "Get failed." << std::endl;
+        return 1;
+        }
+      }
+
+    if (!theQuery->ValidateQuery(false))
+      {
+      std::cerr << "You have not constructed a valid get query."
+        " Please try again." << std::endl;
+      return 1;
+      }
+
+    bool didItWork = gdcm::CompositeNetworkFunctions::CGet( hostname, (uint16_t)port,
+      theQuery, callingaetitle.c_str(), callaetitle.c_str(), outputdir.c_str() );
+    gdcmDebugMacro( (didItWork ? "Get succeeded." : "Get failed.") );
+    return didItWork ? 0 : 1;
     }
   else
     {
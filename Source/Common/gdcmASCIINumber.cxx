@@ -0,0 +1,410 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmASCIINumber.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+
+namespace gdcm
+{
+
+static inline bool IsSpace(char c)
+{
+  return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+static inline bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// All exactly representable as double
+static const double PowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const char *ASCIINumber::Parse(const char *p, const char *end, double &value)
+{
+  value = 0;
+  while( p != end && IsSpace(*p) ) ++p;
+  const char *start = p;
+  bool negative = false;
+  if( p != end && ( *p == '+' || *p == '-' ) )
+    {
+    negative = *p == '-';
+    ++p;
+    }
+  // Keep the first 19 significant digits (they fit in 64bits), and remember
+  // if any of the others was not zero
+  uint64_t mantissa = 0;
+  int ndigits = 0;
+  int exponent = 0;
+  bool digits = false;
+  bool exact = true;
+  for( ; p != end && IsDigit(*p); ++p )
+    {
+    digits = true;
+    if( ndigits < 19 )
+      {
+      mantissa = mantissa * 10 + (uint64_t)( *p - '0' );
+      if( mantissa ) ++ndigits;
+      }
+    else
+      {
+      ++exponent;
+      exact = exact && *p == '0';
+      }
+    }
+  if( p != end && *p == '.' )
+    {
+    for( ++p; p != end && IsDigit(*p); ++p )
+      {
+      digits = true;
+      if( ndigits < 19 )
+        {
+        mantissa = mantissa * 10 + (uint64_t)( *p - '0' );
+        if( mantissa ) ++ndigits;
+        --exponent;
+        }
+      else
+        {
+        exact = exact && *p == '0';
+        }
+      }
+    }
+  if( !digits ) return nullptr;
+  if( p != end && ( *p == 'e' || *p == 'E' ) )
+    {
+    const char *q = p + 1;
+    bool expnegative = false;
+    if( q != end && ( *q == '+' || *q == '-' ) )
+      {
+      expnegative = *q == '-';
+      ++q;
+      }
+    if( q != end && IsDigit(*q) )
+      {
+      int e = 0;
+      for( ; q != end && IsDigit(*q); ++q )
+        if( e < 100000 ) e = e * 10 + ( *q - '0' );
+      exponent += expnegative ? -e : e;
+      p = q;
+      }
+    }
+
+  if( mantissa == 0 )
+    {
+    value = negative ? -0. : 0.;
+    return p;
+    }
+  // Both the mantissa and the power of ten are exact: a single operation
+  // gives the correctly rounded result
+  if( exact && mantissa <= ( (uint64_t)1 << 53 ) && exponent >= -22 && exponent <= 22 )
+    {
+    double d = (double)mantissa;
+    if( exponent < 0 ) d /= PowersOfTen[-exponent];
+    else d *= PowersOfTen[exponent];
+    value = negative ? -d : d;
+    return p;
+    }
+  // Rare: let the C++ library do it, with a locale independent stream
+  std::istringstream is( std::string( start, p ) );
+  is.imbue( std::locale::classic() );
+  is >> value;
+  return p;
+}
+
+static const char *ParseDigits(const char *p, const char *end, bool &negative,
+  unsigned long long &value, bool &overflow)
+{
+  value = 0;
+  overflow = false;
+  negative = false;
+  while( p != end && IsSpace(*p) ) ++p;
+  if( p != end && ( *p == '+' || *p == '-' ) )
+    {
+    negative = *p == '-';
+    ++p;
+    }
+  if( p == end || !IsDigit(*p) ) return nullptr;
+  const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+  for( ; p != end && IsDigit(*p); ++p )
+    {
+    const unsigned int d = (unsigned int)( *p - '0' );
+    if( value > ( max - d ) / 10 ) overflow = true;
+    else value = value * 10 + d;
+    }
+  return p;
+}
+
+const char *ASCIINumber::Parse(const char *p, const char *end, long long &value)
+{
+  bool negative, overflow;
+  unsigned long long v;
+  value = 0;
+  p = ParseDigits( p, end, negative, v, overflow );
+  if( !p ) return nullptr;
+  const unsigned long long max = (unsigned long long)std::numeric_limits<long long>::max();
+  if( negative )
+    value = ( overflow || v > max + 1 ) ? std::numeric_limits<long long>::min()
+      : ( v == 0 ? 0 : -(long long)( v - 1 ) - 1 );
+  else
+    value = ( overflow || v > max ) ? std::numeric_limits<long long>::max() : (long long)v;
+  return p;
+}
+
+const char *ASCIINumber::Parse(const char *p, const char *end, unsigned long long &value)
+{
+  bool negative, overflow;
+  unsigned long long v;
+  value = 0;
+  p = ParseDigits( p, end, negative, v, overflow );
+  if( !p ) return nullptr;
+  if( overflow ) value = std::numeric_limits<unsigned long long>::max();
+  else value = negative ? 0 - v : v; // same as strtoull
+  return p;
+}
+
+// http://stackoverflow.com/questions/32631178/writing-ieee-754-1985-double-as-ascii-on-a-limited-16-bytes-string
+
+static inline void clean(char *mant) {
+  char *ix = mant + strlen(mant) - 1;
+  while(('0' == *ix) && (ix > mant)) {
+    *ix-- = '\0';
+  }
+  if ('.' == *ix) {
+    *ix = '\0';
+  }
+}
+
+static int add1(char *buf, int n) {
+  if (n < 0) return 1;
+  if (buf[n] == '9') {
+    buf[n] = '0';
+    return add1(buf, n-1);
+  }
+  else {
+    buf[n] = (char)(buf[n] + 1);
+  }
+  return 0;
+}
+
+static int doround(char *buf, unsigned int n) {
+  char c;
+  if (n >= strlen(buf)) return 0;
+  c = buf[n];
+  buf[n] = 0;
+  if ((c >= '5') && (c <= '9')) return add1(buf, n-1);
+  return 0;
+}
+
+#if defined(_MSC_VER) && (_MSC_VER < 1900)
+#define snprintf _snprintf
+#endif
+
+static int roundat(char *buf, size_t bufLen, unsigned int i, int iexp) {
+  if (doround(buf, i) != 0) {
+    iexp += 1;
+    switch(iexp) {
+    case -2:
+      strcpy(buf, ".01");
+      break;
+    case -1:
+      strcpy(buf, ".1");
+      break;
+    case 0:
+      strcpy(buf, "1.");
+      break;
+    case 1:
+      strcpy(buf, "10");
+      break;
+    case 2:
+      strcpy(buf, "100");
+      break;
+    default:
+      snprintf(buf, bufLen, "1e%d", iexp);
+    }
+    return 1;
+  }
+  return 0;
+}
+
+// Write f with as many digits as fit in size characters
+static void x16printf(char *buf, int size, double f) {
+  char line[40];
+  char *mant = line + 1;
+  int iexp, lexp, i;
+  char exp[6];
+
+  if (f < 0) {
+    f = -f;
+    size -= 1;
+    *buf++ = '-';
+  }
+  snprintf(line, sizeof(line), "%1.16e", f);
+  if (line[0] == '-') {
+    f = -f;
+    size -= 1;
+    *buf++ = '-';
+    snprintf(line, sizeof(line), "%1.16e", f);
+  }
+  *mant = line[0];
+  i = (int)strcspn(mant, "eE");
+  mant[i] = '\0';
+  iexp = (int)strtol(mant + i + 1, nullptr, 10);
+  lexp = snprintf(exp, sizeof(exp), "e%d", iexp);
+  if ((iexp >= size) || (iexp < -3)) {
+    i = roundat(mant, sizeof(line) - 1, size - 1 -lexp, iexp);
+    if(i == 1) {
+      strcpy(buf, mant);
+      return;
+    }
+    buf[0] = mant[0];
+    buf[1] = '.';
+    strncpy(buf + i + 2, mant + 1, size - 2 - lexp);
+    buf[size-lexp] = 0;
+    clean(buf);
+    strcat(buf, exp);
+  }
+  else if (iexp >= size - 2) {
+    roundat(mant, sizeof(line) - 1, iexp + 1, iexp);
+    strcpy(buf, mant);
+  }
+  else if (iexp >= 0) {
+    i = roundat(mant, sizeof(line) - 1, size - 1, iexp);
+    if (i == 1) {
+      strcpy(buf, mant);
+      return;
+    }
+    strncpy(buf, mant, iexp + 1);
+    buf[iexp + 1] = '.';
+    strncpy(buf + iexp + 2, mant + iexp + 1, size - iexp - 1);
+    buf[size] = 0;
+    clean(buf);
+  }
+  else {
+    int j;
+    i = roundat(mant, sizeof(line) - 1, size + 1 + iexp, iexp);
+    if (i == 1) {
+      strcpy(buf, mant);
+      return;
+    }
+    buf[0] = '.';
+    for(j=0; j< -1 - iexp; j++) {
+      buf[j+1] = '0';
+    }
+    strncpy(buf - iexp, mant, size + 1 + iexp);
+    buf[size] = 0;
+    clean(buf);
+  }
+}
+
+// Write f rounded to ndigits significant digits, in the same layout as
+// x16printf. Return the length, 0 if more than 16 characters are needed.
+static unsigned int FormatDigits(char *buf, double f, int ndigits)
+{
+  char line[40];
+  // The decimal point is skipped below, whatever the locale uses
+  snprintf(line, sizeof(line), "%.*e", ndigits - 1, std::fabs(f));
+  char digits[20];
+  int n = 0;
+  const char *p = line;
+  for( ; *p && *p != 'e' && *p != 'E'; ++p )
+    if( IsDigit(*p) && n < 19 ) digits[n++] = *p;
+  if( !*p || n == 0 ) return 0;
+  const int iexp = (int)strtol(p + 1, nullptr, 10);
+  while( n > 1 && digits[n-1] == '0' ) --n;
+
+  std::string s;
+  if( std::signbit(f) ) s += '-';
+  const int size = 16 - (int)s.size();
+  if( iexp >= size || iexp < -3 )
+    {
+    s += digits[0];
+    if( n > 1 )
+      {
+      s += '.';
+      s.append( digits + 1, n - 1 );
+      }
+    char exp[8];
+    snprintf(exp, sizeof(exp), "e%d", iexp);
+    s += exp;
+    }
+  else if( iexp >= 0 )
+    {
+    for( int i = 0; i <= iexp; ++i )
+      s += i < n ? digits[i] : '0';
+    if( n > iexp + 1 )
+      {
+      s += '.';
+      s.append( digits + iexp + 1, n - iexp - 1 );
+      }
+    }
+  else
+    {
+    s += '.';
+    s.append( -1 - iexp, '0' );
+    s.append( digits, n );
+    }
+  if( s.size() > 16 ) return 0;
+  memcpy( buf, s.c_str(), s.size() + 1 );
+  return (unsigned int)s.size();
+}
+
+unsigned int ASCIINumber::FormatDS(double value, char *buffer)
+{
+  if( std::isfinite( value ) )
+    {
+    // Shortest first
+    for( int ndigits = 1; ndigits <= 17; ++ndigits )
+      {
+      const unsigned int len = FormatDigits( buffer, value, ndigits );
+      double check;
+      if( len && Parse( buffer, buffer + len, check ) && check == value )
+        return len;
+      }
+    }
+  x16printf( buffer, 16, value );
+  return (unsigned int)strlen( buffer );
+}
+
+unsigned int ASCIINumber::Format(long long value, char *buffer)
+{
+  char digits[20];
+  unsigned int n = 0;
+  unsigned long long v = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+  do
+    {
+    digits[n++] = (char)( '0' + v % 10 );
+    v /= 10;
+    } while( v );
+  unsigned int len = 0;
+  if( value < 0 ) buffer[len++] = '-';
+  while( n ) buffer[len++] = digits[--n];
+  buffer[len] = 0;
+  return len;
+}
+
+#if defined(_MSC_VER) && (_MSC_VER < 1900)
+#undef snprintf
+#endif
+
+} // end namespace gdcm
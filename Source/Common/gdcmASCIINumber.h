@@ -0,0 +1,59 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMASCIINUMBER_H
+#define GDCMASCIINUMBER_H
+
+#include "gdcmTypes.h"
+
+namespace gdcm
+{
+/**
+ * \brief Class to convert numbers from/to their ASCII representation
+ * \details Numbers are parsed directly from a buffer (no std::stringstream)
+ * and do not depend on the current locale. This is what is used to parse
+ * Decimal String (DS) and Integer String (IS) values, as well as FL/FD
+ * values given as text.
+ *
+ * A parse function skips leading white spaces, reads as many characters as
+ * possible and returns a pointer past the last one read. It returns nullptr
+ * when no number could be read (value is then set to 0).
+ */
+class GDCM_EXPORT ASCIINumber
+{
+public:
+  /// Parse [+-]digits[.digits][(e|E)[+-]digits]. The result is the closest
+  /// double to the decimal value.
+  static const char *Parse(const char *begin, const char *end, double &value);
+  /// Parse [+-]digits
+  static const char *Parse(const char *begin, const char *end, long long &value);
+  static const char *Parse(const char *begin, const char *end, unsigned long long &value);
+
+  /// Write value as a Decimal String (at most 16 characters) into buffer,
+  /// which must hold at least 17 characters, and return its length.
+  /// The shortest representation which reads back as exactly value is used,
+  /// when one fits in 16 characters. Otherwise value is rounded to as many
+  /// digits as possible.
+  static unsigned int FormatDS(double value, char *buffer);
+
+  /// Write value as an Integer String into buffer, which must hold at least
+  /// 21 characters, and return its length.
+  static unsigned int Format(long long value, char *buffer);
+
+  ASCIINumber(const ASCIINumber&) = delete;
+  void operator=(const ASCIINumber&) = delete;
+};
+
+} // end namespace gdcm
+
+#endif // GDCMASCIINUMBER_H
@@ -0,0 +1,101 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMPARALLELFOR_H
+#define GDCMPARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace gdcm
+{
+/**
+ * \brief Internal helper: the number of threads to use for n tasks, given
+ * the NumberOfThreads setting of a class (0 means the number of cores).
+ * \return a value in [1, max(n, 1)]
+ */
+inline unsigned int ComputeNumberOfThreads(unsigned int nthreads, size_t n)
+{
+  if( !nthreads ) nthreads = std::thread::hardware_concurrency();
+  if( !nthreads ) nthreads = 1;
+  return (unsigned int)std::max( std::min( (size_t)nthreads, n ), (size_t)1 );
+}
+
+/**
+ * \brief Internal helper: call f(i, t) for each i in [0, n), using up to
+ * nthreads threads (the calling one included). Each thread t, in
+ * [0, nthreads), takes the next index until there is none left or a call
+ * returned false.
+ *
+ * All threads are joined before returning, also when one could not be
+ * started (the others do its work) or when f threw (the first exception is
+ * rethrown in the calling thread).
+ * \return false as soon as one call returned false
+ */
+template <typename F>
+bool ParallelFor(size_t n, unsigned int nthreads, F f)
+{
+  std::atomic<size_t> next( 0 );
+  std::atomic<bool> stop( false );
+  std::exception_ptr error;
+  std::mutex lock;
+  auto work = [&]( unsigned int t ) {
+    try
+      {
+      for( size_t i = next++; i < n && !stop; i = next++ )
+        if( !f( i, t ) ) stop = true;
+      }
+    catch( ... )
+      {
+      std::lock_guard<std::mutex> guard( lock );
+      if( !error ) error = std::current_exception();
+      stop = true;
+      }
+  };
+  struct Joiner
+  {
+    std::vector<std::thread> Threads;
+    ~Joiner()
+      {
+      for( size_t t = 0; t < Threads.size(); ++t )
+        if( Threads[t].joinable() ) Threads[t].join();
+      }
+  } joiner;
+  // no reallocation (which could throw) once a thread is started
+  joiner.Threads.reserve( nthreads );
+  for( unsigned int t = 1; t < nthreads; ++t )
+    {
+    try
+      {
+      joiner.Threads.push_back( std::thread( work, t ) );
+      }
+    catch( std::system_error & )
+      {
+      break;
+      }
+    }
+  work( 0 );
+  for( size_t t = 0; t < joiner.Threads.size(); ++t )
+    joiner.Threads[t].join();
+  if( error ) std::rethrow_exception( error );
+  return !stop;
+}
+
+} // end namespace gdcm
+
+#endif //GDCMPARALLELFOR_H
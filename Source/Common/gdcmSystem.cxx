@@ -46,6 +46,7 @@
 #if defined(_WIN32) && (defined(_MSC_VER) || defined(__WATCOMC__) ||defined(__BORLANDC__) || defined(__MINGW32__))
 #include <io.h>
 #include <direct.h>
+#include <windows.h> // MoveFileEx
 #define _unlink unlink
 #else
 //#include <features.h> // we want GNU extensions
@@ -338,6 +339,21 @@ bool System::RemoveFile(const char* source)
   return res;
 }
 
+bool System::RenameFile(const char *source, const char *destination)
+{
+#ifdef _MSC_VER
+  const std::wstring wsource = System::ConvertToUNC(source);
+  const std::wstring wdestination = System::ConvertToUNC(destination);
+  return MoveFileExW(wsource.c_str(), wdestination.c_str(),
+    MOVEFILE_REPLACE_EXISTING) != 0;
+#elif defined(_WIN32)
+  /* Win32 rename fails when destination exists */
+  return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return rename(source, destination) == 0;
+#endif
+}
+
 // RemoveDirectory is a WIN32 function, use different name
 bool System::DeleteDirectory(const char *source)
 {
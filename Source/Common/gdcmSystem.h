@@ -36,6 +36,9 @@ public:
   static bool FileIsSymlink(const char* name);
   /// remove a file named source
   static bool RemoveFile(const char* source);
+  /// rename file source into destination. An existing destination is
+  /// replaced atomically: it is never removed when the rename fails.
+  static bool RenameFile(const char* source, const char* destination);
   /// remove a directory named source
   static bool DeleteDirectory(const char *source);
 
@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMTEXTFIELDS_H
+#define GDCMTEXTFIELDS_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace gdcm
+{
+/**
+ * \brief Internal helper: value without its padding, that is without the
+ * leading spaces and the trailing spaces and NULs. value may be a nullptr
+ * (when len is 0).
+ */
+inline std::string TrimValue(const char *value, size_t len)
+{
+  while( len && ( value[len-1] == ' ' || value[len-1] == '\0' ) ) --len;
+  size_t start = 0;
+  while( start < len && value[start] == ' ' ) ++start;
+  return std::string( value + start, len - start );
+}
+
+inline std::string TrimValue(const char *value)
+{
+  return value ? TrimValue( value, strlen( value ) ) : std::string();
+}
+
+/**
+ * \brief Internal helper: write s as one field of a tab separated line, the
+ * backslash, tab, newline, carriage return and NUL characters being escaped.
+ * \see ReadTextField
+ */
+inline void WriteTextField(std::ostream &os, std::string const &s)
+{
+  for( std::string::const_iterator it = s.begin(); it != s.end(); ++it )
+    {
+    switch( *it )
+      {
+    case '\\': os << "\\\\"; break;
+    case '\t': os << "\\t"; break;
+    case '\n': os << "\\n"; break;
+    case '\r': os << "\\r"; break;
+    case '\0': os << "\\0"; break;
+    default: os << *it;
+      }
+    }
+}
+
+/**
+ * \brief Internal helper: read into s the field of line starting at pos
+ * (written by WriteTextField), and move pos past its separator.
+ * \return false when the field holds an invalid escape sequence
+ */
+inline bool ReadTextField(std::string const &line, std::string::size_type &pos,
+  std::string &s)
+{
+  s.clear();
+  for( ; pos < line.size() && line[pos] != '\t'; ++pos )
+    {
+    if( line[pos] != '\\' )
+      {
+      s += line[pos];
+      continue;
+      }
+    if( ++pos == line.size() ) return false;
+    switch( line[pos] )
+      {
+    case '\\': s += '\\'; break;
+    case 't': s += '\t'; break;
+    case 'n': s += '\n'; break;
+    case 'r': s += '\r'; break;
+    case '0': s += '\0'; break;
+    default: return false;
+      }
+    }
+  if( pos < line.size() ) ++pos; // skip separator
+  return true;
+}
+
+} // end namespace gdcm
+
+#endif //GDCMTEXTFIELDS_H
@@ -244,11 +244,8 @@ protected:
     //  }
     //else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadNoSwap(Internal,
-        GetNumberOfValues(),ss);
+        GetNumberOfValues(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
   void SetByteValue(const ByteValue *bv) {
@@ -261,11 +258,8 @@ protected:
     //  }
     //else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
-        GetNumberOfValues(),ss);
+        GetNumberOfValues(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
 #if 0 // TODO  FIXME the implicit way:
@@ -479,11 +473,8 @@ protected:
     //  }
     //else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadNoSwap(&Internal,
-        GetNumberOfValues(),ss);
+        GetNumberOfValues(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
   void SetByteValue(const ByteValue *bv) {
@@ -496,11 +487,8 @@ protected:
     //  }
     //else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(&Internal,
-        GetNumberOfValues(),ss);
+        GetNumberOfValues(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
 #if 0 // TODO  FIXME the implicit way:
@@ -689,10 +677,7 @@ public:
 protected:
   void SetByteValue(const ByteValue *bv) {
     assert( bv ); // FIXME
-    std::stringstream ss;
-    std::string s = std::string( bv->GetPointer(), bv->GetLength() );
     Length = bv->GetLength(); // HACK FIXME
-    ss.str( s );
     ArrayType *internal;
     ArrayType buffer[256];
     if( bv->GetLength() < 256 )
@@ -703,14 +688,13 @@ protected:
       {
       internal = new ArrayType[(VL::Type)bv->GetLength()]; // over allocation
       }
-    EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadComputeLength(internal, Length, ss);
+    EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadComputeLength(internal, Length,
+      bv->GetPointer(), bv->GetPointer()+bv->GetLength());
     SetValues( internal, Length, true );
     if( !(bv->GetLength() < 256) )
       {
       delete[] internal;
       }
-    //EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
-    //  GetNumberOfValues(),ss);
   }
 
 private:
@@ -22,6 +22,7 @@
 #include <iterator>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
 
 namespace gdcm_ns
 {
@@ -167,10 +168,21 @@ public:
   std::ostream const &Write(std::ostream &os) const {
     assert( !(Internal.size() % 2) );
     if( !Internal.empty() ) {
-      //os.write(&Internal[0], Internal.size());
-      std::vector<char> copy = Internal;
-      TSwap::SwapArray((TType*)(void*)&copy[0], Internal.size() / sizeof(TType) );
-      os.write(&copy[0], copy.size());
+      if( sizeof(TType) == 1 || TSwap::Swap( (uint16_t)0x0102 ) == 0x0102 )
+        {
+        // nothing to swap
+        os.write(&Internal[0], Internal.size());
+        return os;
+        }
+      // swap one block at a time, instead of copying the whole value
+      std::vector<char> copy( std::min( Internal.size(), (size_t)(64 * 1024) ) );
+      for( size_t pos = 0; pos < Internal.size(); pos += copy.size() )
+        {
+        const size_t len = std::min( copy.size(), Internal.size() - pos );
+        memcpy( &copy[0], &Internal[pos], len );
+        TSwap::SwapArray((TType*)(void*)&copy[0], len / sizeof(TType) );
+        os.write(&copy[0], len);
+        }
       }
     return os;
   }
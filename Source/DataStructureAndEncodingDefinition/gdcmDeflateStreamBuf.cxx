@@ -0,0 +1,290 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmDeflateStreamBuf.h"
+#include "gdcmTrace.h"
+#include "gdcmParallelFor.h"
+
+#include <gdcm_zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace gdcm
+{
+
+// deflate window size, also the maximum dictionary size
+static const size_t WindowSize = 32 * 1024;
+
+// Compress one block into out. Non-final blocks end with a sync flush, so
+// that the next block starts on a byte boundary
+static bool DeflateBlock(const char *dict, size_t dictlen,
+  const char *in, size_t len, bool last, int level, std::vector<char> &out)
+{
+  z_stream zs;
+  memset( &zs, 0, sizeof(zs) );
+  if( deflateInit2( &zs, level, Z_DEFLATED, -15 /* raw deflate */, 8,
+      Z_DEFAULT_STRATEGY ) != Z_OK )
+    {
+    return false;
+    }
+  bool ok = true;
+  if( dictlen )
+    {
+    ok = deflateSetDictionary( &zs, (const Bytef*)dict, (uInt)dictlen ) == Z_OK;
+    }
+  // room for the sync flush marker on top of the worst case
+  out.resize( deflateBound( &zs, (uLong)len ) + 16 );
+  zs.next_in = (Bytef*)const_cast<char*>(in);
+  zs.avail_in = (uInt)len;
+  size_t produced = 0;
+  const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+  while( ok )
+    {
+    zs.next_out = (Bytef*)&out[produced];
+    zs.avail_out = (uInt)(out.size() - produced);
+    const int ret = deflate( &zs, flush );
+    produced = out.size() - zs.avail_out;
+    if( ret == Z_STREAM_END || (!last && ret == Z_OK && zs.avail_out) ) break;
+    if( ret != Z_OK && ret != Z_BUF_ERROR ) ok = false;
+    else out.resize( out.size() * 2 );
+    }
+  out.resize( produced );
+  deflateEnd( &zs );
+  return ok;
+}
+
+DeflateStreamBuf::DeflateStreamBuf(std::ostream &os, unsigned int nthreads,
+  int level, size_t blocksize):
+  OS(os),
+  NumberOfThreads(nthreads),
+  Level(level),
+  BlockSize(blocksize),
+  DictionaryLength(0),
+  Finished(false),
+  Failed(false)
+{
+  if( !NumberOfThreads ) NumberOfThreads = std::thread::hardware_concurrency();
+  if( !NumberOfThreads ) NumberOfThreads = 1;
+  if( BlockSize < WindowSize ) BlockSize = WindowSize;
+  Buffer.resize( WindowSize + NumberOfThreads * BlockSize );
+  setp( &Buffer[WindowSize], &Buffer[0] + Buffer.size() );
+}
+
+DeflateStreamBuf::~DeflateStreamBuf()
+{
+  Finish();
+}
+
+DeflateStreamBuf::int_type DeflateStreamBuf::overflow(int_type c)
+{
+  if( Finished || !CompressBuffer( false ) ) return traits_type::eof();
+  if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+    {
+    *pptr() = traits_type::to_char_type( c );
+    pbump( 1 );
+    }
+  return traits_type::not_eof( c );
+}
+
+std::streamsize DeflateStreamBuf::xsputn(const char *s, std::streamsize n)
+{
+  std::streamsize written = 0;
+  while( written < n )
+    {
+    if( pptr() == epptr() && (Finished || !CompressBuffer( false )) ) break;
+    const std::streamsize len =
+      std::min( n - written, (std::streamsize)(epptr() - pptr()) );
+    memcpy( pptr(), s + written, (size_t)len );
+    pbump( (int)len );
+    written += len;
+    }
+  return written;
+}
+
+bool DeflateStreamBuf::Finish()
+{
+  if( Finished ) return !Failed;
+  Finished = true;
+  CompressBuffer( true );
+  OS.flush();
+  return !Failed && !OS.fail();
+}
+
+bool DeflateStreamBuf::CompressBuffer(bool last)
+{
+  if( Failed ) return false;
+  char *data = &Buffer[WindowSize];
+  const size_t len = (size_t)(pptr() - data);
+  // the final block may be empty, it only marks the end of the stream
+  const size_t nblocks = len ? (len + BlockSize - 1) / BlockSize : 1;
+  std::vector< std::vector<char> > outs( nblocks );
+  const char *dictend = data;
+  const size_t dictlen = DictionaryLength;
+  const int level = Level;
+  const size_t blocksize = BlockSize;
+  bool ok = false;
+  try
+    {
+    ok = ParallelFor( nblocks, ComputeNumberOfThreads( NumberOfThreads, nblocks ),
+      [&]( size_t i, unsigned int ) {
+      const size_t start = i * blocksize;
+      const size_t blocklen = std::min( blocksize, len - std::min( len, start ) );
+      // dictionary is what precedes the block: the end of the previous block,
+      // or of the previous batch for the first one
+      const size_t dlen = i ? std::min( WindowSize, blocksize ) : dictlen;
+      return DeflateBlock( dictend + start - dlen, dlen, data + start, blocklen,
+        last && i == nblocks - 1, level, outs[i] );
+    } );
+    }
+  catch( std::exception &ex )
+    {
+    (void)ex;
+    gdcmDebugMacro( "Exception: " << ex.what() );
+    }
+  if( !ok )
+    {
+    gdcmErrorMacro( "Could not deflate" );
+    Failed = true;
+    return false;
+    }
+  for( size_t i = 0; i < nblocks; ++i )
+    {
+    if( !outs[i].empty() ) OS.write( &outs[i][0], outs[i].size() );
+    }
+
+  // keep the end of this batch as dictionary for the next one
+  const size_t keep = std::min( WindowSize, DictionaryLength + len );
+  memmove( &Buffer[WindowSize - keep], data + len - keep, keep );
+  DictionaryLength = keep;
+  setp( data, &Buffer[0] + Buffer.size() );
+  if( OS.fail() ) Failed = true;
+  return !Failed;
+}
+
+class InflateStreamBufInternals
+{
+public:
+  z_stream ZStream;
+  std::vector<char> Input;
+  int Err;
+  bool AtEOF;
+  bool Ended;
+};
+
+// size of the putback area kept in front of the get area
+static const size_t PutBack = 4;
+
+InflateStreamBuf::InflateStreamBuf(std::istream &is, size_t buffersize):IS(is)
+{
+  Internals = new InflateStreamBufInternals;
+  memset( &Internals->ZStream, 0, sizeof(Internals->ZStream) );
+  Internals->Err = inflateInit2( &Internals->ZStream, -15 /* raw deflate */ );
+  Internals->AtEOF = false;
+  Internals->Ended = false;
+  Internals->Input.resize( buffersize );
+  Output.resize( PutBack + buffersize );
+  setg( &Output[0], &Output[PutBack], &Output[PutBack] );
+}
+
+InflateStreamBuf::~InflateStreamBuf()
+{
+  inflateEnd( &Internals->ZStream );
+  delete Internals;
+}
+
+size_t InflateStreamBuf::Inflate(char *out, size_t len)
+{
+  z_stream &zs = Internals->ZStream;
+  int &err = Internals->Err;
+  zs.next_out = (Bytef*)out;
+  zs.avail_out = (uInt)len;
+  while( err == Z_OK && zs.avail_out )
+    {
+    if( !zs.avail_in )
+      {
+      if( Internals->AtEOF ) break;
+      std::vector<char> &input = Internals->Input;
+      IS.read( &input[0], (std::streamsize)input.size() - 1 );
+      size_t n = (size_t)IS.gcount();
+      if( !IS )
+        {
+        // End of file and no final block: tell zlib the stream ends with an
+        // extra \0 (srwithgraphdeflated.dcm)
+        Internals->AtEOF = true;
+        input[n++] = 0;
+        }
+      zs.next_in = (Bytef*)&input[0];
+      zs.avail_in = (uInt)n;
+      }
+    err = inflate( &zs, Z_SYNC_FLUSH );
+    if( err == Z_BUF_ERROR && zs.avail_in ) break;
+    if( err == Z_BUF_ERROR ) err = Z_OK; // need more input
+    }
+  if( err == Z_STREAM_END && !Internals->Ended )
+    {
+    // give back what follows the deflate stream (but not the extra \0)
+    const size_t back = zs.avail_in - (Internals->AtEOF && zs.avail_in ? 1 : 0);
+    IS.clear();
+    if( back ) IS.seekg( -(std::streamoff)back, std::ios::cur );
+    zs.avail_in = 0;
+    Internals->Ended = true;
+    }
+  return len - zs.avail_out;
+}
+
+void InflateStreamBuf::ResetGetArea(const char *last, size_t len)
+{
+  // keep a few bytes for putback
+  const size_t n = std::min( len, PutBack );
+  memmove( &Output[PutBack - n], last + len - n, n );
+  setg( &Output[PutBack - n], &Output[PutBack], &Output[PutBack] );
+}
+
+InflateStreamBuf::int_type InflateStreamBuf::underflow()
+{
+  if( gptr() < egptr() ) return traits_type::to_int_type( *gptr() );
+  ResetGetArea( eback(), (size_t)(gptr() - eback()) );
+  const size_t n = Inflate( &Output[PutBack], Output.size() - PutBack );
+  if( !n ) return traits_type::eof();
+  setg( eback(), &Output[PutBack], &Output[PutBack] + n );
+  return traits_type::to_int_type( *gptr() );
+}
+
+std::streamsize InflateStreamBuf::xsgetn(char *s, std::streamsize n)
+{
+  std::streamsize done = std::min( n, (std::streamsize)(egptr() - gptr()) );
+  memcpy( s, gptr(), (size_t)done );
+  gbump( (int)done );
+  if( done == n ) return done;
+  const size_t remain = (size_t)(n - done);
+  if( remain >= Output.size() - PutBack )
+    {
+    // large read (eg. Pixel Data): no intermediate copy
+    const size_t r = Inflate( s + done, remain );
+    done += (std::streamsize)r;
+    ResetGetArea( s, (size_t)done );
+    return done;
+    }
+  while( done < n && !traits_type::eq_int_type( underflow(), traits_type::eof() ) )
+    {
+    const std::streamsize len = std::min( n - done, (std::streamsize)(egptr() - gptr()) );
+    memcpy( s + done, gptr(), (size_t)len );
+    gbump( (int)len );
+    done += len;
+    }
+  return done;
+}
+
+} // end namespace gdcm
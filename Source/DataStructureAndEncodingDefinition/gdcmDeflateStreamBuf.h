@@ -0,0 +1,124 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMDEFLATESTREAMBUF_H
+#define GDCMDEFLATESTREAMBUF_H
+
+#include "gdcmTypes.h"
+
+#include <streambuf>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace gdcm
+{
+
+/**
+ * \brief DeflateStreamBuf
+ * \details Compress everything written into a raw deflate stream (RFC 1951,
+ * no zlib header), as required by Deflated Explicit VR Little Endian.
+ *
+ * Data is cut into blocks which are compressed independently by several
+ * threads (pigz-style). Each block is primed with the last 32KB of the
+ * previous one and ends on a byte boundary (sync flush), so the blocks
+ * concatenated form a single valid deflate stream, with a compression ratio
+ * very close to a single-threaded deflate.
+ *
+ * Compressed data is only written to the output stream once a full batch of
+ * blocks is available, or on Finish().
+ */
+class GDCM_EXPORT DeflateStreamBuf : public std::streambuf
+{
+public:
+  /// Compress into os using nthreads threads (0 means the number of cores)
+  explicit DeflateStreamBuf(std::ostream &os, unsigned int nthreads = 0,
+    int level = -1, size_t blocksize = 128 * 1024);
+  ~DeflateStreamBuf() override;
+
+  /// Compress pending data and terminate the deflate stream. Nothing can be
+  /// written afterward. Return false upon error.
+  bool Finish();
+
+  unsigned int GetNumberOfThreads() const { return NumberOfThreads; }
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+private:
+  bool CompressBuffer(bool last);
+
+  std::ostream &OS;
+  unsigned int NumberOfThreads;
+  int Level;
+  size_t BlockSize;
+  // last 32KB of the previous batch (dictionary), followed by the batch
+  std::vector<char> Buffer;
+  size_t DictionaryLength;
+  bool Finished;
+  bool Failed;
+};
+
+/**
+ * \brief InflateStreamBuf
+ * \details Decompress a raw deflate stream read from an istream. Large
+ * reads are inflated directly into the destination buffer. When the end of
+ * the deflate stream is reached, the input stream is repositioned right after
+ * it.
+ */
+class InflateStreamBufInternals;
+class GDCM_EXPORT InflateStreamBuf : public std::streambuf
+{
+public:
+  explicit InflateStreamBuf(std::istream &is, size_t buffersize = 256 * 1024);
+  ~InflateStreamBuf() override;
+
+protected:
+  int_type underflow() override;
+  std::streamsize xsgetn(char *s, std::streamsize n) override;
+
+private:
+  size_t Inflate(char *out, size_t len);
+  void ResetGetArea(const char *last, size_t len);
+
+  std::istream &IS;
+  InflateStreamBufInternals *Internals;
+  std::vector<char> Output;
+};
+
+/// ostream writing through a DeflateStreamBuf
+class GDCM_EXPORT DeflateOStream : public std::ostream
+{
+public:
+  explicit DeflateOStream(std::ostream &os, unsigned int nthreads = 0):
+    std::ostream(nullptr), Buf(os, nthreads) { rdbuf( &Buf ); }
+  /// See DeflateStreamBuf::Finish
+  bool Finish() { const bool b = Buf.Finish(); if( !b ) setstate( std::ios::badbit ); return b; }
+private:
+  DeflateStreamBuf Buf;
+};
+
+/// istream reading through an InflateStreamBuf
+class GDCM_EXPORT InflateIStream : public std::istream
+{
+public:
+  explicit InflateIStream(std::istream &is):
+    std::istream(nullptr), Buf(is) { rdbuf( &Buf ); }
+private:
+  InflateStreamBuf Buf;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMDEFLATESTREAMBUF_H
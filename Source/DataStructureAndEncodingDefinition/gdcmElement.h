@@ -21,6 +21,7 @@
 #include "gdcmByteValue.h"
 #include "gdcmDataElement.h"
 #include "gdcmSwapper.h"
+#include "gdcmASCIINumber.h"
 
 #include <string>
 #include <vector>
@@ -28,6 +29,7 @@
 #include <limits>
 #include <cmath>
 #include <cstring>
+#include <type_traits>
 
 namespace gdcm_ns
 {
@@ -151,6 +153,11 @@ public:
     return EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
       GetLength(),_is);
     }
+  /// Same as above, but directly from the len bytes of buffer
+  void Read(const char *buffer, size_t len) {
+    return EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
+      GetLength(),buffer,buffer+len);
+    }
   void Write(std::ostream &_os) const {
     return EncodingImplementation<VRToEncoding<TVR>::Mode>::Write(Internal,
       GetLength(),_os);
@@ -162,11 +169,7 @@ public:
     const ByteValue *bv = dynamic_cast<const ByteValue*>(&v);
     if( bv ) {
       //memcpy(Internal, bv->GetPointer(), bv->GetLength());
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
-      EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
-        GetLength(),ss);
+      Read(bv->GetPointer(), bv->GetLength());
     }
   }
 protected:
@@ -174,11 +177,8 @@ protected:
     const ByteValue *bv = dynamic_cast<const ByteValue*>(&v);
     assert( bv ); // That would be bad...
     //memcpy(Internal, bv->GetPointer(), bv->GetLength());
-    std::stringstream ss;
-    std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-    ss.str( s );
     EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadNoSwap(Internal,
-      GetLength(),ss);
+      GetLength(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
   }
 };
 
@@ -249,6 +249,91 @@ public:
                           std::istream &_is) {
     Read(data,length,_is);
 }
+
+  // Same as above, but directly from the buffer [begin, end). Numbers are
+  // parsed without any std::stringstream (see ASCIINumber)
+  template<typename T>
+  static inline void ReadComputeLength(T* data, unsigned int &length,
+                          const char *begin, const char *end) {
+    ReadComputeLength(data,length,begin,end,std::is_arithmetic<T>());
+    }
+  template<typename T>
+  static inline void Read(T* data, unsigned long length,
+                          const char *begin, const char *end) {
+    Read(data,length,begin,end,std::is_arithmetic<T>());
+    }
+  template<typename T>
+  static inline void ReadNoSwap(T* data, unsigned long length,
+                          const char *begin, const char *end) {
+    Read(data,length,begin,end);
+    }
+
+  static inline const char *ParseValue(const char *p, const char *end, double &v) {
+    return ASCIINumber::Parse(p, end, v);
+    }
+  template<typename T>
+  static inline const char *ParseValue(const char *p, const char *end, T &v) {
+    if( std::is_floating_point<T>::value ) {
+      double d;
+      p = ASCIINumber::Parse(p, end, d);
+      v = static_cast<T>(d);
+    } else if( std::is_signed<T>::value ) {
+      long long l;
+      p = ASCIINumber::Parse(p, end, l);
+      // saturate, like operator>>
+      if( l < (long long)(std::numeric_limits<T>::min)() ) l = (long long)(std::numeric_limits<T>::min)();
+      if( l > (long long)(std::numeric_limits<T>::max)() ) l = (long long)(std::numeric_limits<T>::max)();
+      v = static_cast<T>(l);
+    } else {
+      unsigned long long u;
+      p = ASCIINumber::Parse(p, end, u);
+      if( u > (unsigned long long)(std::numeric_limits<T>::max)() ) u = (unsigned long long)(std::numeric_limits<T>::max)();
+      v = static_cast<T>(u);
+    }
+    return p;
+    }
+
+  template<typename T>
+  static inline void ReadComputeLength(T* data, unsigned int &length,
+                          const char *p, const char *end, std::true_type) {
+    assert( data );
+    length = 0;
+    // Stop after the first value not followed by a backslash
+    while( (p = ParseValue(p, end, data[length++])) != nullptr ) {
+      while( p != end && (*p == ' ' || (*p >= '\t' && *p <= '\r')) ) ++p;
+      if( p == end || *p != '\\' ) break;
+      ++p;
+      }
+    }
+  template<typename T>
+  static inline void Read(T* data, unsigned long length,
+                          const char *p, const char *end, std::true_type) {
+    assert( data );
+    assert( length ); // != 0
+    p = ParseValue(p, end, data[0]);
+    for(unsigned long i=1; i<length && p; ++i) {
+      // Skip the separator in between the values
+      while( p != end && (*p == ' ' || (*p >= '\t' && *p <= '\r')) ) ++p;
+      if( p == end ) break;
+      p = ParseValue(p + 1, end, data[i]);
+      }
+    }
+  // Not a number: use the std::istream implementation
+  template<typename T>
+  static inline void ReadComputeLength(T* data, unsigned int &length,
+                          const char *begin, const char *end, std::false_type) {
+    std::stringstream ss;
+    ss.str( std::string(begin, end) );
+    ReadComputeLength(data,length,ss);
+    }
+  template<typename T>
+  static inline void Read(T* data, unsigned long length,
+                          const char *begin, const char *end, std::false_type) {
+    std::stringstream ss;
+    ss.str( std::string(begin, end) );
+    Read(data,length,ss);
+    }
+
   template<typename T>
   static inline void Write(const T* data, unsigned long length,
                            std::ostream &_os)  {
@@ -280,144 +365,6 @@ std::string to_string ( Float data ) {
     throw "Impossible Conversion"; // should not happen ...
   }
 }
-#else
-// http://stackoverflow.com/questions/32631178/writing-ieee-754-1985-double-as-ascii-on-a-limited-16-bytes-string
-
-static inline void clean(char *mant) {
-  char *ix = mant + strlen(mant) - 1;
-  while(('0' == *ix) && (ix > mant)) {
-    *ix-- = '\0';
-  }
-  if ('.' == *ix) {
-    *ix = '\0';
-  }
-}
-
-static int add1(char *buf, int n) {
-  if (n < 0) return 1;
-  if (buf[n] == '9') {
-    buf[n] = '0';
-    return add1(buf, n-1);
-  }
-  else {
-    buf[n] = (char)(buf[n] + 1);
-  }
-  return 0;
-}
-
-static int doround(char *buf, unsigned int n) {
-  char c;
-  if (n >= strlen(buf)) return 0;
-  c = buf[n];
-  buf[n] = 0;
-  if ((c >= '5') && (c <= '9')) return add1(buf, n-1);
-  return 0;
-}
-
-#if defined(_MSC_VER) && (_MSC_VER < 1900)
-#define snprintf _snprintf
-#endif
-
-static int roundat(char *buf, size_t bufLen, unsigned int i, int iexp) {
-  if (doround(buf, i) != 0) {
-    iexp += 1;
-    switch(iexp) {
-    case -2:
-      strcpy(buf, ".01");
-      break;
-    case -1:
-      strcpy(buf, ".1");
-      break;
-    case 0:
-      strcpy(buf, "1.");
-      break;
-    case 1:
-      strcpy(buf, "10");
-      break;
-    case 2:
-      strcpy(buf, "100");
-      break;
-    default:
-      snprintf(buf, bufLen, "1e%d", iexp);
-    }
-    return 1;
-  }
-  return 0;
-}
-
-template < typename Float >
-static void x16printf(char *buf, int size, Float f) {
-  char line[40];
-  char *mant = line + 1;
-  int iexp, lexp, i;
-  char exp[6];
-
-  if (f < 0) {
-    f = -f;
-    size -= 1;
-    *buf++ = '-';
-  }
-  snprintf(line, sizeof(line), "%1.16e", f);
-  if (line[0] == '-') {
-    f = -f;
-    size -= 1;
-    *buf++ = '-';
-    snprintf(line, sizeof(line), "%1.16e", f);
-  }
-  *mant = line[0];
-  i = (int)strcspn(mant, "eE");
-  mant[i] = '\0';
-  iexp = (int)strtol(mant + i + 1, nullptr, 10);
-  lexp = snprintf(exp, sizeof(exp), "e%d", iexp);
-  if ((iexp >= size) || (iexp < -3)) {
-    i = roundat(mant, sizeof(line) - 1, size - 1 -lexp, iexp);
-    if(i == 1) {
-      strcpy(buf, mant);
-      return;
-    }
-    buf[0] = mant[0];
-    buf[1] = '.';
-    strncpy(buf + i + 2, mant + 1, size - 2 - lexp);
-    buf[size-lexp] = 0;
-    clean(buf);
-    strcat(buf, exp);
-  }
-  else if (iexp >= size - 2) {
-    roundat(mant, sizeof(line) - 1, iexp + 1, iexp);
-    strcpy(buf, mant);
-  }
-  else if (iexp >= 0) {
-    i = roundat(mant, sizeof(line) - 1, size - 1, iexp);
-    if (i == 1) {
-      strcpy(buf, mant);
-      return;
-    }
-    strncpy(buf, mant, iexp + 1);
-    buf[iexp + 1] = '.';
-    strncpy(buf + iexp + 2, mant + iexp + 1, size - iexp - 1);
-    buf[size] = 0;
-    clean(buf);
-  }
-  else {
-    int j;
-    i = roundat(mant, sizeof(line) - 1, size + 1 + iexp, iexp);
-    if (i == 1) {
-      strcpy(buf, mant);
-      return;
-    }
-    buf[0] = '.';
-    for(j=0; j< -1 - iexp; j++) {
-      buf[j+1] = '0';
-    }
-    strncpy(buf - iexp, mant, size + 1 + iexp);
-    buf[size] = 0;
-    clean(buf);
-  }
-}
-#if defined(_MSC_VER) && (_MSC_VER < 1900)
-#undef snprintf
-#endif
-
 #endif
 
 template<> inline void EncodingImplementation<VR::VRASCII>::Write(const double* data, unsigned long length, std::ostream &_os)  {
@@ -428,7 +375,7 @@ template<> inline void EncodingImplementation<VR::VRASCII>::Write(const double*
     _os << to_string(data[0]);
 #else
     char buf[16+1];
-    x16printf(buf, 16, data[0]);
+    ASCIINumber::FormatDS(data[0], buf);
     _os << buf;
 #endif
     for(unsigned long i=1; i<length; ++i) {
@@ -436,7 +383,7 @@ template<> inline void EncodingImplementation<VR::VRASCII>::Write(const double*
 #ifdef VRDS16ILLEGAL
       _os << "\\" << to_string(data[i]);
 #else
-      x16printf(buf, 16, data[i]);
+      ASCIINumber::FormatDS(data[i], buf);
       _os << "\\" << buf;
 #endif
       }
@@ -496,6 +443,32 @@ public:
     //  _is.GetSwapCode(), length);
     SwapperNoOp::SwapArray(data,length);
   }
+  // Same as above, but directly from the buffer [begin, end)
+  template<typename T>
+    static inline void ReadComputeLength(T* data, unsigned int &length,
+      const char *begin, const char *end) {
+    assert( data ); // Can we read from pointer ?
+    length /= sizeof(T);
+    const size_t len = (size_t)(end - begin);
+    // T can be Tag (AT), copied bytewise like the stream versions above do
+    memcpy( static_cast<void*>(data), begin,
+      len < length * sizeof(T) ? len : length * sizeof(T) );
+    }
+  template<typename T>
+  static inline void ReadNoSwap(T* data, unsigned long length,
+    const char *begin, const char *end) {
+    assert( data ); // Can we read from pointer ?
+    assert( length );
+    const size_t len = (size_t)(end - begin);
+    memcpy( static_cast<void*>(data), begin,
+      len < length * sizeof(T) ? len : length * sizeof(T) );
+  }
+  template<typename T>
+  static inline void Read(T* data, unsigned long length,
+    const char *begin, const char *end) {
+    ReadNoSwap(data,length,begin,end);
+    SwapperNoOp::SwapArray(data,length);
+  }
   template<typename T>
   static inline void Write(const T* data, unsigned long length,
     std::ostream &_os) {
@@ -667,11 +640,8 @@ public:
       }
     else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
-        GetLength(),ss);
+        GetLength(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
   void SetFromDataElement(DataElement const &de) {
@@ -711,6 +681,12 @@ public:
     EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
       GetLength(),_is);
     }
+  /// Same as above, but directly from the len bytes of buffer
+  void Read(const char *buffer, size_t len) {
+    if( !Internal ) return;
+    EncodingImplementation<VRToEncoding<TVR>::Mode>::Read(Internal,
+      GetLength(),buffer,buffer+len);
+    }
   //void ReadComputeLength(std::istream &_is) {
   //  if( !Internal ) return;
   //  EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadComputeLength(Internal,
@@ -772,11 +748,8 @@ protected:
       }
     else
       {
-      std::stringstream ss;
-      std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-      ss.str( s );
       EncodingImplementation<VRToEncoding<TVR>::Mode>::ReadNoSwap(Internal,
-        GetLength(),ss);
+        GetLength(),bv->GetPointer(),bv->GetPointer()+bv->GetLength());
       }
   }
 
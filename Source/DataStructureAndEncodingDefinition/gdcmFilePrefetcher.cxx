@@ -0,0 +1,274 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFilePrefetcher.h"
+#include "gdcmTrace.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace gdcm
+{
+
+namespace
+{
+// First bytes of a file, as read by a worker thread
+struct PrefetchedFile
+{
+  std::string FileName;
+  std::vector<char> Head;
+  std::streamoff Size{0};
+  bool Done{false};
+  bool OK{false};
+};
+
+void ReadHead(PrefetchedFile &f, size_t prefetchsize)
+{
+  std::ifstream is( f.FileName.c_str(), std::ios::binary );
+  if( !is ) return;
+  is.seekg( 0, std::ios::end );
+  f.Size = is.tellg();
+  if( f.Size < 0 ) return;
+  is.seekg( 0, std::ios::beg );
+  f.Head.resize( (size_t)std::min( (std::streamoff)prefetchsize, f.Size ) );
+  if( !f.Head.empty() ) is.read( &f.Head[0], (std::streamsize)f.Head.size() );
+  f.OK = !is.fail();
+}
+
+// Serve the prefetched bytes from memory, then read the file itself
+class PrefetchStreamBuf : public std::streambuf
+{
+public:
+  PrefetchStreamBuf():Tail(64 * 1024) {}
+
+  void Reset(std::shared_ptr<PrefetchedFile> const &f)
+    {
+    File = f;
+    if( Stream.is_open() ) Stream.close();
+    Stream.clear();
+    AreaOffset = 0;
+    char *head = File->Head.empty() ? nullptr : &File->Head[0];
+    setg( head, head, head + File->Head.size() );
+    }
+
+protected:
+  int_type underflow() override
+    {
+    if( gptr() < egptr() ) return traits_type::to_int_type( *gptr() );
+    if( !Load( AreaOffset + (egptr() - eback()) ) ) return traits_type::eof();
+    return traits_type::to_int_type( *gptr() );
+    }
+
+  pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) override
+    {
+    if( !File || !(which & std::ios::in) ) return pos_type(off_type(-1));
+    off_type target = off;
+    if( dir == std::ios::cur ) target += AreaOffset + (gptr() - eback());
+    else if( dir == std::ios::end ) target += File->Size;
+    if( target < 0 || target > File->Size ) return pos_type(off_type(-1));
+    if( target >= AreaOffset && target <= AreaOffset + (egptr() - eback()) )
+      {
+      setg( eback(), eback() + (target - AreaOffset), egptr() );
+      }
+    else
+      {
+      // loaded on next read
+      AreaOffset = target;
+      setg( nullptr, nullptr, nullptr );
+      }
+    return pos_type(target);
+    }
+
+  pos_type seekpos(pos_type pos, std::ios::openmode which) override
+    {
+    return seekoff( off_type(pos), std::ios::beg, which );
+    }
+
+private:
+  bool Load(std::streamoff off)
+    {
+    const std::vector<char> &head = File->Head;
+    if( off < (std::streamoff)head.size() )
+      {
+      char *p = const_cast<char*>( &head[0] );
+      AreaOffset = 0;
+      setg( p, p + off, p + head.size() );
+      return true;
+      }
+    if( off >= File->Size ) return false;
+    if( !Stream.is_open() )
+      {
+      Stream.open( File->FileName.c_str(), std::ios::binary );
+      if( !Stream ) return false;
+      }
+    Stream.clear();
+    Stream.seekg( off, std::ios::beg );
+    Stream.read( &Tail[0], (std::streamsize)Tail.size() );
+    const std::streamsize n = Stream.gcount();
+    if( n <= 0 ) return false;
+    AreaOffset = off;
+    setg( &Tail[0], &Tail[0], &Tail[0] + n );
+    return true;
+    }
+
+  std::shared_ptr<PrefetchedFile> File;
+  std::ifstream Stream;
+  std::vector<char> Tail;
+  // offset in the file of eback()
+  std::streamoff AreaOffset{0};
+};
+}
+
+class FilePrefetcherInternals
+{
+public:
+  unsigned int ReadAhead{4};
+  size_t PrefetchSize{1024 * 1024};
+  std::vector<std::string> FileNames;
+
+  std::mutex Mutex;
+  std::condition_variable WorkAvailable;
+  std::condition_variable WorkDone;
+  std::deque< std::shared_ptr<PrefetchedFile> > Queue;
+  std::map< size_t, std::shared_ptr<PrefetchedFile> > Files;
+  std::vector<std::thread> Threads;
+  bool Stopping{false};
+
+  PrefetchStreamBuf Buf;
+  std::istream Stream{nullptr};
+
+  void Work()
+    {
+    std::unique_lock<std::mutex> lock( Mutex );
+    for(;;)
+      {
+      WorkAvailable.wait( lock, [this]{ return Stopping || !Queue.empty(); } );
+      if( Stopping ) return;
+      std::shared_ptr<PrefetchedFile> f = Queue.front();
+      Queue.pop_front();
+      const size_t prefetchsize = PrefetchSize;
+      lock.unlock();
+      ReadHead( *f, prefetchsize );
+      lock.lock();
+      f->Done = true;
+      WorkDone.notify_all();
+      }
+    }
+};
+
+FilePrefetcher::FilePrefetcher()
+{
+  Internals = new FilePrefetcherInternals;
+  Internals->Stream.rdbuf( &Internals->Buf );
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+  Stop();
+  delete Internals;
+}
+
+void FilePrefetcher::SetReadAhead(unsigned int n)
+{
+  Internals->ReadAhead = n;
+}
+
+unsigned int FilePrefetcher::GetReadAhead() const
+{
+  return Internals->ReadAhead;
+}
+
+void FilePrefetcher::SetPrefetchSize(size_t bytes)
+{
+  Internals->PrefetchSize = bytes;
+}
+
+size_t FilePrefetcher::GetPrefetchSize() const
+{
+  return Internals->PrefetchSize;
+}
+
+void FilePrefetcher::Stop()
+{
+  {
+  std::lock_guard<std::mutex> lock( Internals->Mutex );
+  Internals->Stopping = true;
+  Internals->Queue.clear();
+  }
+  Internals->WorkAvailable.notify_all();
+  for( size_t i = 0; i < Internals->Threads.size(); ++i )
+    Internals->Threads[i].join();
+  Internals->Threads.clear();
+  Internals->Files.clear();
+  Internals->Stopping = false;
+}
+
+void FilePrefetcher::SetFileNames(std::vector<std::string> const &filenames)
+{
+  Stop();
+  Internals->FileNames = filenames;
+  const unsigned int nthreads = std::max( Internals->ReadAhead, 1u );
+  for( unsigned int t = 0; t < nthreads; ++t )
+    Internals->Threads.push_back( std::thread( &FilePrefetcherInternals::Work, Internals ) );
+  std::lock_guard<std::mutex> lock( Internals->Mutex );
+  for( size_t i = 0; i <= Internals->ReadAhead && i < filenames.size(); ++i )
+    Schedule( i );
+}
+
+// Mutex must be locked
+void FilePrefetcher::Schedule(size_t idx)
+{
+  if( Internals->Files.count( idx ) ) return;
+  std::shared_ptr<PrefetchedFile> f = std::make_shared<PrefetchedFile>();
+  f->FileName = Internals->FileNames[idx];
+  Internals->Files[idx] = f;
+  Internals->Queue.push_back( f );
+  Internals->WorkAvailable.notify_one();
+}
+
+std::istream &FilePrefetcher::GetStream(size_t idx)
+{
+  std::istream &is = Internals->Stream;
+  is.clear();
+  if( idx >= Internals->FileNames.size() )
+    {
+    gdcmErrorMacro( "No file number " << idx );
+    is.setstate( std::ios::failbit );
+    return is;
+    }
+  std::shared_ptr<PrefetchedFile> f;
+  {
+  std::unique_lock<std::mutex> lock( Internals->Mutex );
+  // files before idx are done with (still readable, but not kept around)
+  Internals->Files.erase( Internals->Files.begin(), Internals->Files.lower_bound( idx ) );
+  for( size_t i = idx; i <= idx + Internals->ReadAhead && i < Internals->FileNames.size(); ++i )
+    Schedule( i );
+  f = Internals->Files[idx];
+  Internals->WorkDone.wait( lock, [&f]{ return f->Done; } );
+  }
+  Internals->Buf.Reset( f );
+  if( !f->OK )
+    {
+    gdcmDebugMacro( "Could not read: " << f->FileName );
+    is.setstate( std::ios::failbit );
+    }
+  return is;
+}
+
+} // end namespace gdcm
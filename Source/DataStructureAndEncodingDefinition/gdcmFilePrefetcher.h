@@ -0,0 +1,87 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMFILEPREFETCHER_H
+#define GDCMFILEPREFETCHER_H
+
+#include "gdcmTypes.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace gdcm
+{
+
+class FilePrefetcherInternals;
+/**
+ * \brief FilePrefetcher
+ * \details Read ahead a list of files which are then consumed in order (eg.
+ * by Sorter or Scanner), so that the open/read round trips of the next
+ * files overlap with the parsing of the current one. This mostly matters on
+ * network file systems.
+ *
+ * A pool of threads reads the first GetPrefetchSize() bytes of the next
+ * GetReadAhead() files. GetStream() returns a stream serving those bytes from
+ * memory, and falling back to the file for anything beyond them, so any file
+ * can be read completely.
+ *
+ * \code
+ * FilePrefetcher prefetcher;
+ * prefetcher.SetFileNames( filenames );
+ * for( size_t i = 0; i < filenames.size(); ++i )
+ *   {
+ *   Reader reader;
+ *   reader.SetStream( prefetcher.GetStream( i ) );
+ *   reader.Read();
+ *   }
+ * \endcode
+ *
+ * \see Reader
+ */
+class GDCM_EXPORT FilePrefetcher
+{
+public:
+  FilePrefetcher();
+  ~FilePrefetcher();
+
+  /// Set/Get the number of files read ahead of the current one (default 4)
+  void SetReadAhead(unsigned int n);
+  unsigned int GetReadAhead() const;
+
+  /// Set/Get the number of bytes read ahead at the start of each file
+  /// (default 1MB)
+  void SetPrefetchSize(size_t bytes);
+  size_t GetPrefetchSize() const;
+
+  /// Set the files to read, in the order they will be requested. Start
+  /// prefetching the first ones.
+  void SetFileNames(std::vector<std::string> const &filenames);
+
+  /// Return the content of file idx (in SetFileNames order), waiting for
+  /// it to be prefetched, and start prefetching the following files. The
+  /// stream is valid until the next call. It is in a failed state if the
+  /// file cannot be read.
+  std::istream &GetStream(size_t idx);
+
+private:
+  FilePrefetcher(FilePrefetcher const &) = delete;
+  FilePrefetcher &operator=(FilePrefetcher const &) = delete;
+  void Stop();
+  void Schedule(size_t idx);
+  FilePrefetcherInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMFILEPREFETCHER_H
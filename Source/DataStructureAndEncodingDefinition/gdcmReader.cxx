@@ -17,7 +17,7 @@
 #include "gdcmFileMetaInformation.h"
 #include "gdcmSwapper.h"
 
-#include "gdcmDeflateStream.h"
+#include "gdcmDeflateStreamBuf.h"
 #include "gdcmSystem.h"
 
 #include "gdcmExplicitDataElement.h"
@@ -429,7 +429,7 @@ bool Reader::InternalReadCommon(const T_Caller &caller)
   if( ts == TransferSyntax::DeflatedExplicitVRLittleEndian )
     {
 
-    zlib_stream::zip_istream gzis( is );
+    InflateIStream gzis( is );
     // FIXME: we also know in this case that we are dealing with Explicit:
     assert( ts.GetNegociatedType() == TransferSyntax::Explicit );
     //F->GetDataSet().ReadUpToTag<ExplicitDataElement,SwapperNoOp>(gzis,tag, skiptags);
@@ -437,7 +437,7 @@ bool Reader::InternalReadCommon(const T_Caller &caller)
     // I need the following hack to read: srwithgraphdeflated.dcm
     //is.clear();
     // well not anymore, see special handling of trailing \0 in:
-    // basic_unzip_streambuf<charT, traits>::fill_input_buffer(void)
+    // InflateStreamBuf::Inflate
     return is.good();
     }
 
@@ -844,6 +844,7 @@ void Reader::SetFileName(const char *utf8path)
   if( Ifstream->is_open() )
     {
     Stream = Ifstream;
+    FileName = utf8path;
     assert( Stream && *Stream );
     }
   else
@@ -851,6 +852,7 @@ void Reader::SetFileName(const char *utf8path)
     delete Ifstream;
     Ifstream = nullptr;
     Stream = nullptr;
+    FileName.clear();
     }
 }
 
@@ -66,6 +66,7 @@ public:
   /// Set the open-ed stream directly
   void SetStream(std::istream &input_stream) {
     Stream = &input_stream;
+    FileName.clear();
   }
 
   /// Set/Get File
@@ -114,12 +115,17 @@ protected:
   //will still have to be subject to endianness swaps, if necessary.
   std::istream* GetStreamPtr() const { return Stream; }
 
+  /// Name of the file opened with SetFileName, empty when reading from a
+  /// user provided stream (see SetStream)
+  const std::string &GetFileName() const { return FileName; }
+
 private:
   template <typename T_Caller>
   bool InternalReadCommon(const T_Caller &caller);
   TransferSyntax GuessTransferSyntax();
   std::istream *Stream;
   std::ifstream *Ifstream;
+  std::string FileName;
 
   // prevent copy/move to avoid 2 ifstream leak
   Reader(const Reader &) = delete;
@@ -14,6 +14,7 @@
 #include "gdcmSequenceOfFragments.h"
 #include "gdcmImplicitDataElement.h"
 #include "gdcmByteValue.h"
+#include "gdcmSwapper.h"
 
 namespace gdcm_ns
 {
@@ -109,6 +110,34 @@ bool SequenceOfFragments::GetBuffer(char *buffer, unsigned long length) const
   return true;
 }
 
+void SequenceOfFragments::ComputeFragmentOffsets(std::vector<uint64_t> &offsets,
+  std::vector<uint64_t> &lengths) const
+{
+  offsets.clear();
+  lengths.clear();
+  uint64_t offset = 0;
+  FragmentVector::const_iterator it = Fragments.begin();
+  for(;it != Fragments.end(); ++it)
+    {
+    offsets.push_back( offset );
+    lengths.push_back( it->GetVL() );
+    offset += it->ComputeLength();
+    }
+}
+
+bool SequenceOfFragments::FillBasicOffsetTable()
+{
+  Table.SetByteValue( "", 0 );
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> lengths;
+  ComputeFragmentOffsets( offsets, lengths );
+  if( offsets.empty() || offsets.back() > 0xFFFFFFFF ) return false;
+  std::vector<uint32_t> table( offsets.begin(), offsets.end() );
+  SwapperNoOp::SwapArray( &table[0], table.size() );
+  Table.SetByteValue( (char*)&table[0], (uint32_t)(table.size() * sizeof(uint32_t)) );
+  return true;
+}
+
 bool SequenceOfFragments::WriteBuffer(std::ostream &os) const
 {
   FragmentVector::const_iterator it = Fragments.begin();
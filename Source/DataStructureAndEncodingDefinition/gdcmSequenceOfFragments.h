@@ -82,6 +82,19 @@ public:
   const BasicOffsetTable &GetTable() const { return Table; }
   BasicOffsetTable &GetTable() { return Table; }
 
+  /// Compute the offset of each fragment (relative to the first byte of the
+  /// first fragment item, as used by the Basic and Extended Offset Tables)
+  /// and its length. This is the Extended Offset Table (7FE0,0001) and
+  /// Extended Offset Table Lengths (7FE0,0002) when each fragment holds
+  /// exactly one frame.
+  void ComputeFragmentOffsets(std::vector<uint64_t> &offsets,
+    std::vector<uint64_t> &lengths) const;
+
+  /// Fill the Basic Offset Table, assuming each fragment holds exactly one
+  /// frame. Return false (and leave the table empty) when an offset does not
+  /// fit in 32bits, in which case the Extended Offset Table should be used.
+  bool FillBasicOffsetTable();
+
 template <typename TSwap>
 std::istream& Read(std::istream &is, bool readvalues = true)
 {
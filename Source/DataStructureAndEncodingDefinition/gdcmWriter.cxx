@@ -23,14 +23,406 @@
 
 #include "gdcmItem.h"
 #include "gdcmSequenceOfItems.h"
+#include "gdcmSequenceOfFragments.h"
 #include "gdcmParseException.h"
 
-#include "gdcmDeflateStream.h"
+#include "gdcmDeflateStreamBuf.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 namespace gdcm
 {
 
-Writer::Writer():Stream(nullptr),Ofstream(nullptr),F(new File),CheckFileMetaInformation(true),WriteDataSetOnly(false)
+namespace
+{
+/*
+ * Write a DataSet the same way DataSet::Write<TDE,TSwap> does, in a single
+ * pass:
+ * - headers and small values are gathered in a contiguous buffer, item and
+ *   sequence lengths are filled in there once their content has been
+ *   serialized (instead of being computed again at each nesting level),
+ * - large values are not copied, they are handed to the stream straight from
+ *   the ByteValue, in between the buffered bytes.
+ * The buffer is written out between top level data elements. Anything unusual
+ * (invalid or dual VR, UN sequences, 16bits VR which cannot hold their
+ * length, ...) is delegated to DataElement::Write.
+ */
+template <typename TDE, typename TSwap>
+class DataSetSerializer
+{
+public:
+  explicit DataSetSerializer(std::ostream &os):Stream(os),Used(0),Delegate(*this)
+    {
+    Swap = TSwap::Swap( (uint16_t)0x0102 ) != 0x0102;
+    }
+
+  void Write(const DataSet &ds)
+    {
+    Buffer.resize( BufferSize );
+    Emit( ds, true );
+    Flush();
+    }
+
+private:
+  static const size_t BufferSize = 1024 * 1024;
+  static const size_t DirectWriteSize = 64 * 1024;
+  static const bool Explicit = std::is_same<TDE,ExplicitDataElement>::value;
+
+  enum Kind { Empty, Bytes, Items, Fragments, Delegated };
+
+  // Value written in place, at Offset in Buffer
+  struct External
+    {
+    size_t Offset;
+    const char *Pointer;
+    size_t Length;
+    };
+
+  // DataElement::Write output goes to Buffer
+  class DelegateStreamBuf : public std::streambuf
+    {
+  public:
+    explicit DelegateStreamBuf(DataSetSerializer &s):S(s) {}
+  protected:
+    int_type overflow(int_type c) override
+      {
+      if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+        {
+        const char ch = traits_type::to_char_type( c );
+        S.Append( &ch, 1 );
+        }
+      return traits_type::not_eof( c );
+      }
+    std::streamsize xsputn(const char *p, std::streamsize n) override
+      {
+      S.Append( p, (size_t)n );
+      return n;
+      }
+  private:
+    DataSetSerializer &S;
+    };
+
+  Kind Classify(const DataElement &de, const Value *&v, unsigned int &swapsize) const
+    {
+    v = nullptr;
+    swapsize = 1;
+    const Tag &tag = de.GetTag();
+    const VL &vl = de.GetVL();
+    if( tag.GetGroup() == 0xfffe ) return Delegated;
+    if( Explicit )
+      {
+      const VR &vr = de.GetVR();
+      if( vr == VR::INVALID || !vr.IsVRFile() || vr.IsDual() ) return Delegated;
+      if( (vr & VR::VL16) && vl > (uint32_t)VL::GetVL16Max() ) return Delegated;
+      if( vr == VR::UN && ( vl.IsUndefined()
+          || tag.IsPrivateCreator() || tag.IsGroupLength() ) ) return Delegated;
+      if( vr == VR::OW && vl.IsUndefined() ) return Delegated;
+      }
+    else if( tag == Tag(0x7fe0,0x0010) && vl.IsUndefined() ) return Delegated;
+
+    const ByteValue *bv = de.GetByteValue();
+    const SequenceOfItems *sqi = nullptr;
+    const SequenceOfFragments *sf = nullptr;
+    if( !bv && !de.IsEmpty() )
+      {
+      sqi = dynamic_cast<const SequenceOfItems*>( &de.GetValue() );
+      if( !sqi ) sf = dynamic_cast<const SequenceOfFragments*>( &de.GetValue() );
+      }
+    if( Explicit && de.GetVR() == VR::SQ && vl && !sqi ) return Delegated;
+    // a sequence stored as UN keeps the encoding chosen by DataElement::Write
+    if( Explicit && de.GetVR() == VR::UN && sqi ) return Delegated;
+    if( vl == 0 )
+      {
+      return sqi ? Delegated : Empty;
+      }
+    if( sqi )
+      {
+      v = sqi;
+      return Items;
+      }
+    if( bv )
+      {
+      if( vl.IsUndefined() || bv->GetLength() != vl ) return Delegated;
+      if( Explicit && !( de.GetVR() & VR::VRASCII ) )
+        {
+        swapsize = de.GetVR() == VR::AT ? 2 : de.GetVR().GetSize();
+        if( swapsize != 1 && swapsize != 2 && swapsize != 4 && swapsize != 8 )
+          return Delegated;
+        }
+      v = bv;
+      return Bytes;
+      }
+    if( sf && Explicit && vl.IsUndefined() )
+      {
+      v = sf;
+      return Fragments;
+      }
+    return Delegated;
+    }
+
+  // Write ds, return DataSet::GetLength<TDE>
+  VL Emit(const DataSet &ds, bool toplevel)
+    {
+    VL length = 0;
+    for( DataSet::ConstIterator it = ds.Begin(); it != ds.End(); ++it )
+      {
+      length += Emit( *it );
+      if( toplevel && ( Used >= BufferSize || !Externals.empty() ) ) Flush();
+      }
+    return length;
+    }
+
+  // Write de, return DataElement::GetLength<TDE>
+  VL Emit(const DataElement &de)
+    {
+    const Value *v;
+    unsigned int swapsize;
+    const Kind kind = Classify( de, v, swapsize );
+    if( kind == Delegated )
+      {
+      std::ostream os( &Delegate );
+      de.Write<TDE,TSwap>( os );
+      if( de.GetTag() == Tag(0xfffe,0xe00d) ) return 0;
+      return de.GetLength<TDE>();
+      }
+
+    const VL vl = de.GetVL();
+    const size_t vloffset = Used + 4; // implicit
+    uint32_t headerlen = 8;
+    if( Explicit )
+      {
+      const VR &vr = de.GetVR();
+      char *p = Reserve( 12 );
+      PutTag( p, de.GetTag() );
+      memcpy( p + 4, VR::GetVRString( vr ), 2 );
+      if( vr & VR::VL32 )
+        {
+        p[6] = p[7] = 0;
+        PutUInt32( p + 8, vl );
+        headerlen = 12;
+        }
+      else
+        {
+        PutUInt16( p + 6, (uint16_t)vl );
+        }
+      Used += headerlen;
+      }
+    else
+      {
+      PutHeader( de.GetTag(), vl );
+      }
+
+    switch( kind )
+      {
+    case Bytes:
+      PutValue( *static_cast<const ByteValue*>( v ), swapsize );
+      break;
+    case Items:
+        {
+        const VL sqlen = Emit( *static_cast<const SequenceOfItems*>( v ) );
+        if( vl.IsUndefined() )
+          {
+          return ( Explicit ? 12 : 8 ) + sqlen;
+          }
+        if( !Explicit )
+          {
+          // implicit: always the actual length
+          PutUInt32( &Buffer[vloffset], sqlen );
+          return 8 + sqlen;
+          }
+        if( sqlen != vl ) throw Exception( "Inconsistent Sequence length" );
+        }
+      break;
+    case Fragments:
+        {
+        const SequenceOfFragments &sf = *static_cast<const SequenceOfFragments*>( v );
+        Emit( sf );
+        return 12 + sf.ComputeLength();
+        }
+    default:
+      break;
+      }
+    return headerlen + vl;
+    }
+
+  // Write the items, return SequenceOfItems::ComputeLength<TDE>
+  VL Emit(const SequenceOfItems &sqi)
+    {
+    VL length = 0;
+    for( SequenceOfItems::ConstIterator it = sqi.Begin(); it != sqi.End(); ++it )
+      {
+      const size_t vloffset = Used + 4;
+      PutHeader( it->GetTag(), it->GetVL() );
+      const VL nestedlen = Emit( it->GetNestedDataSet(), false );
+      length += 8 + nestedlen;
+      if( it->IsUndefinedLength() )
+        {
+        PutHeader( Tag(0xfffe,0xe00d), 0 );
+        length += 8;
+        }
+      else
+        {
+        PutUInt32( &Buffer[vloffset], nestedlen );
+        }
+      }
+    if( sqi.IsUndefinedLength() )
+      {
+      PutHeader( Tag(0xfffe,0xe0dd), 0 );
+      length += 8;
+      }
+    return length;
+    }
+
+  void Emit(const SequenceOfFragments &sf)
+    {
+    Emit( sf.GetTable() );
+    for( SequenceOfFragments::ConstIterator it = sf.Begin(); it != sf.End(); ++it )
+      {
+      Emit( *it );
+      }
+    PutHeader( Tag(0xfffe,0xe0dd), 0 );
+    }
+
+  // Same as Fragment::Write<TSwap>
+  void Emit(const Fragment &frag)
+    {
+    const ByteValue *bv = frag.GetByteValue();
+    if( frag.IsEmpty() || !bv )
+      {
+      PutHeader( frag.GetTag(), 0 );
+      }
+    else
+      {
+      PutHeader( frag.GetTag(), bv->ComputeLength() );
+      if( frag.GetVL() ) PutValue( *bv, 1 );
+      }
+    }
+
+  static void PutUInt16(char *p, uint16_t v)
+    {
+    v = TSwap::Swap( v );
+    memcpy( p, &v, sizeof(v) );
+    }
+
+  static void PutUInt32(char *p, uint32_t v)
+    {
+    v = TSwap::Swap( v );
+    memcpy( p, &v, sizeof(v) );
+    }
+
+  static void PutTag(char *p, const Tag &t)
+    {
+    PutUInt16( p, t.GetGroup() );
+    PutUInt16( p + 2, t.GetElement() );
+    }
+
+  // Tag and 32bits VL: Item, delimitation items, implicit data element
+  void PutHeader(const Tag &t, uint32_t vl)
+    {
+    char *p = Reserve( 8 );
+    PutTag( p, t );
+    PutUInt32( p + 4, vl );
+    Used += 8;
+    }
+
+  void PutValue(const ByteValue &bv, unsigned int swapsize)
+    {
+    const std::vector<char> &v = bv;
+    if( v.empty() ) return;
+    if( swapsize == 1 || !Swap )
+      {
+      if( v.size() >= DirectWriteSize )
+        {
+        // no copy
+        const External e = { Used, &v[0], v.size() };
+        Externals.push_back( e );
+        }
+      else
+        {
+        Append( &v[0], v.size() );
+        }
+      return;
+      }
+    // swap a block at a time (in an aligned scratch buffer)
+    Scratch.resize( DirectWriteSize / sizeof(uint64_t) );
+    const size_t block = DirectWriteSize;
+    for( size_t pos = 0; pos < v.size(); pos += block )
+      {
+      const size_t len = std::min( block, v.size() - pos );
+      memcpy( &Scratch[0], &v[pos], len );
+      switch( swapsize )
+        {
+      case 2:
+        TSwap::SwapArray( (uint16_t*)(void*)&Scratch[0], len / 2 );
+        break;
+      case 4:
+        TSwap::SwapArray( (uint32_t*)(void*)&Scratch[0], len / 4 );
+        break;
+      case 8:
+        TSwap::SwapArray( (uint64_t*)&Scratch[0], len / 8 );
+        break;
+        }
+      Append( (const char*)(void*)&Scratch[0], len );
+      }
+    }
+
+  // Room for len bytes at the end of Buffer, which only grows while a top
+  // level data element is being serialized
+  char *Reserve(size_t len)
+    {
+    if( Used + len > Buffer.size() )
+      Buffer.resize( std::max( 2 * Buffer.size(), Used + len ) );
+    return &Buffer[Used];
+    }
+
+  void Append(const char *p, size_t len)
+    {
+    memcpy( Reserve( len ), p, len );
+    Used += len;
+    }
+
+  void Flush()
+    {
+    size_t pos = 0;
+    for( size_t i = 0; i < Externals.size(); ++i )
+      {
+      const External &e = Externals[i];
+      Stream.write( &Buffer[pos], (std::streamsize)(e.Offset - pos) );
+      Stream.write( e.Pointer, (std::streamsize)e.Length );
+      pos = e.Offset;
+      }
+    Stream.write( &Buffer[pos], (std::streamsize)(Used - pos) );
+    Externals.clear();
+    Used = 0;
+    }
+
+  std::ostream &Stream;
+  std::vector<char> Buffer;
+  size_t Used;
+  std::vector<External> Externals;
+  std::vector<uint64_t> Scratch;
+  DelegateStreamBuf Delegate;
+  bool Swap;
+};
+
+template <typename TDE, typename TSwap>
+void WriteDataSet(const DataSet &ds, std::ostream &os, bool fastwrite)
+{
+  if( fastwrite )
+    {
+    DataSetSerializer<TDE,TSwap> serializer( os );
+    serializer.Write( ds );
+    }
+  else
+    {
+    ds.Write<TDE,TSwap>(os);
+    }
+}
+}
+
+Writer::Writer():Stream(nullptr),Ofstream(nullptr),F(new File),CheckFileMetaInformation(true),WriteDataSetOnly(false),NumberOfThreads(0),FastWrite(false)
 {
 }
 
@@ -96,15 +488,17 @@ bool Writer::Write()
 
   if( ts == TransferSyntax::DeflatedExplicitVRLittleEndian )
     {
-    //gzostream gzos(os.rdbuf());
-      try {
-      zlib_stream::zip_ostream gzos( os );
+    try
+      {
+      DeflateOStream gzos( os, NumberOfThreads );
       assert( ts.GetNegociatedType() == TransferSyntax::Explicit );
-      DS.Write<ExplicitDataElement,SwapperNoOp>(gzos);
-      //gzos.flush();
-      } catch (...){
-		  return false;
-	  }
+      WriteDataSet<ExplicitDataElement,SwapperNoOp>(DS, gzos, FastWrite);
+      if( !gzos.Finish() ) return false;
+      }
+    catch (...)
+      {
+      return false;
+      }
 
     return !os.fail();
     }
@@ -118,24 +512,24 @@ bool Writer::Write()
         {
         // There is no such thing as Implicit Big Endian... oh well
         // LIBIDO-16-ACR_NEMA-Volume.dcm
-        DS.Write<ImplicitDataElement,SwapperDoOp>(os);
+        WriteDataSet<ImplicitDataElement,SwapperDoOp>(DS, os, FastWrite);
         }
       else
         {
         assert( ts.GetNegociatedType() == TransferSyntax::Explicit );
-        DS.Write<ExplicitDataElement,SwapperDoOp>(os);
+        WriteDataSet<ExplicitDataElement,SwapperDoOp>(DS, os, FastWrite);
         }
       }
     else // LittleEndian
       {
       if( ts.GetNegociatedType() == TransferSyntax::Implicit )
         {
-        DS.Write<ImplicitDataElement,SwapperNoOp>(os);
+        WriteDataSet<ImplicitDataElement,SwapperNoOp>(DS, os, FastWrite);
         }
       else
         {
         assert( ts.GetNegociatedType() == TransferSyntax::Explicit );
-        DS.Write<ExplicitDataElement,SwapperNoOp>(os);
+        WriteDataSet<ExplicitDataElement,SwapperNoOp>(DS, os, FastWrite);
         }
       }
     }
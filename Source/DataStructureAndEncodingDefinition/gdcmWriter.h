@@ -71,6 +71,21 @@ public:
   void CheckFileMetaInformationOff() { CheckFileMetaInformation = false; }
   void CheckFileMetaInformationOn() { CheckFileMetaInformation = true; }
 
+  /// Set the number of threads used to compress a Deflated Explicit VR Little
+  /// Endian data set (default 0: number of cores)
+  void SetNumberOfThreads(unsigned int n) { NumberOfThreads = n; }
+  unsigned int GetNumberOfThreads() const { return NumberOfThreads; }
+
+  /// Serialize the data set with all the item and sequence lengths computed
+  /// in a single pass, and with large batched writes (values are not copied
+  /// unless they need byte swapping). The output is the same, this only
+  /// matters for large data sets (eg. rewriting the header of a whole study).
+  /// Default is off.
+  void SetFastWrite(bool b) { FastWrite = b; }
+  bool GetFastWrite() const { return FastWrite; }
+  void FastWriteOn() { FastWrite = true; }
+  void FastWriteOff() { FastWrite = false; }
+
 protected:
   void SetWriteDataSetOnly(bool b) { WriteDataSetOnly = b; }
 
@@ -90,6 +105,8 @@ private:
   SmartPointer<File> F;
   bool CheckFileMetaInformation;
   bool WriteDataSetOnly;
+  unsigned int NumberOfThreads;
+  bool FastWrite;
 };
 
 } // end namespace gdcm
@@ -20,7 +20,7 @@
 #include "gdcmDataSetHelper.h"
 #include "gdcmUIDGenerator.h"
 #include "gdcmAttribute.h"
-#include "gdcmDummyValueGenerator.h"
+#include "gdcmDummyValueMap.h"
 #include "gdcmDicts.h"
 #include "gdcmType.h"
 #include "gdcmDefs.h"
@@ -524,12 +524,8 @@ bool Anonymizer::RemovePrivateTags()
 
 /*
  * Implementation note:
- * In order to implement the dummy 'memory' we use a static std::map
- * this works great but we cannot be thread safe.
- * In order to be thread safe, we would need to externalize this map generation
- * maybe using a Scanner do the operation once (Scanner is doing) the merging
- * automatically...
- * this is left as an exercise for the reader :)
+ * The dummy 'memory' is a DummyValueMap, either the user specified one or a
+ * static one shared by all instances. Both can be used from several threads.
  */
 bool Anonymizer::BasicApplicationLevelConfidentialityProfile(bool deidentify)
 {
@@ -944,13 +940,15 @@ generate a DICOMDIR
   return !b;
 }
 
-Anonymizer::DummyMapNonUIDTags Anonymizer::dummyMapNonUIDTags;
-Anonymizer::DummyMapUIDTags Anonymizer::dummyMapUIDTags;
+static DummyValueMap &GetSharedDummyValueMap()
+{
+  static DummyValueMap dvm;
+  return dvm;
+}
 
 void Anonymizer::ClearInternalUIDs()
 {
-  dummyMapNonUIDTags.clear();
-  dummyMapUIDTags.clear();
+  GetSharedDummyValueMap().Clear();
 }
 
 bool Anonymizer::BALCPProtect(DataSet &ds, Tag const & tag, IOD const & iod)
@@ -968,6 +966,7 @@ bool Anonymizer::BALCPProtect(DataSet &ds, Tag const & tag, IOD const & iod)
     {
     DataElement copy;
     copy = ds.GetDataElement( tag );
+    DummyValueMap &dvm = DVM ? *DVM : GetSharedDummyValueMap();
 
     if ( IsVRUI( tag ) )
       {
@@ -985,15 +984,7 @@ bool Anonymizer::BALCPProtect(DataSet &ds, Tag const & tag, IOD const & iod)
       std::string anonymizedUID;
       if( !UIDToAnonymize.empty() )
         {
-        if ( dummyMapUIDTags.count( UIDToAnonymize ) == 0 )
-          {
-          anonymizedUID = uid.Generate();
-          dummyMapUIDTags[ UIDToAnonymize ] = anonymizedUID;
-          }
-        else
-          {
-          anonymizedUID = dummyMapUIDTags[ UIDToAnonymize ];
-          }
+        anonymizedUID = dvm.GetDummyUID( UIDToAnonymize );
         }
       else
         {
@@ -1007,22 +998,7 @@ bool Anonymizer::BALCPProtect(DataSet &ds, Tag const & tag, IOD const & iod)
       }
     else
       {
-      TagValueKey tvk;
-      tvk.first = tag;
-
-      assert( dummyMapNonUIDTags.count( tvk ) == 0 || dummyMapNonUIDTags.count( tvk ) == 1 );
-      if( dummyMapNonUIDTags.count( tvk ) == 0 )
-        {
-        const char *ret = DummyValueGenerator::Generate( tvk.second.c_str() );
-        if( ret )
-          {
-          dummyMapNonUIDTags[ tvk ] = ret;
-          }
-        else
-          dummyMapNonUIDTags[ tvk ] = "";
-        }
-
-      std::string &v = dummyMapNonUIDTags[ tvk ];
+      const std::string v = dvm.GetDummyValue( tag, std::string() );
       copy.SetByteValue( v.c_str(), (uint32_t)v.size() );
       }
       ds.Replace( copy );
@@ -1069,14 +1045,13 @@ void Anonymizer::RecurseDataSet( DataSet & ds )
   for( ; it != ds.End(); /*++it*/ )
     {
     assert( it != ds.End() );
-    DataElement de = *it; ++it;
+    const DataElement &cde = *it; ++it;
     //const SequenceOfItems *sqi = de.GetSequenceOfItems();
-    VR vr = DataSetHelper::ComputeVR(*F, ds, de.GetTag() );
-    SmartPointer<SequenceOfItems> sqi = nullptr;
-    if( vr == VR::SQ )
-      {
-      sqi = de.GetValueAsSQ();
-      }
+    VR vr = DataSetHelper::ComputeVR(*F, ds, cde.GetTag() );
+    // only sequences are modified, do not copy other elements
+    if( vr != VR::SQ ) continue;
+    DataElement de = cde;
+    SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
     if( sqi )
       {
       de.SetValue( *sqi ); // EXTREMELY IMPORTANT #2912092
@@ -1093,8 +1068,8 @@ void Anonymizer::RecurseDataSet( DataSet & ds )
         DataSet &nested = item.GetNestedDataSet();
         RecurseDataSet( nested );
         }
+      ds.Replace( de );
       }
-    ds.Replace( de );
     }
 
 }
@@ -26,6 +26,7 @@ namespace gdcm
 class TagPath;
 class IOD;
 class CryptographicMessageSyntax;
+class DummyValueMap;
 
 /**
  * \brief Anonymizer
@@ -55,10 +56,11 @@ class CryptographicMessageSyntax;
  * 2. smart mode
  * this mode implements the Basic Application Level Confidentiality Profile
  * (DICOM PS 3.15-2008) In this case, it is extremely important to use the same
- * Anonymizer class when anonymizing a FileSet. Once the Anonymizer
- * is destroyed its memory of known (already processed) UIDs will be lost.
- * which will make the anonymizer behaves incorrectly for attributes such as
- * Series UID Study UID where user want some consistency.  When attribute is
+ * DummyValueMap when anonymizing a FileSet (by default all Anonymizer
+ * instances share the same one). Once the mapping is cleared its memory of
+ * known (already processed) UIDs will be lost, which will make the anonymizer
+ * behaves incorrectly for attributes such as Series UID Study UID where user
+ * want some consistency.  When attribute is
  * Type 1 / Type 1C, a dummy generator will take in the existing value and
  * produce a dummy value (a sha1 representation). sha1 algorithm is considered
  * to be cryptographically strong (compared to md5sum) so that we meet the
@@ -77,7 +79,7 @@ class CryptographicMessageSyntax;
 class GDCM_EXPORT Anonymizer : public Subject
 {
 public:
-  Anonymizer():F(new File),CMS(nullptr) {}
+  Anonymizer():F(new File),CMS(nullptr),DVM(nullptr) {}
   ~Anonymizer() override;
 
   /// Make Tag t empty (if not found tag will be created)
@@ -130,20 +132,27 @@ public:
   /// PS 3.15 / E.1.1 De-Identifier
   /// An Application may claim conformance to the Basic Application Level Confidentiality Profile as a deidentifier
   /// if it protects all Attributes that might be used by unauthorized entities to identify the patient.
-  /// NOT THREAD SAFE
+  /// Several Anonymizer instances can run in parallel, each one on its own
+  /// File, when the CryptographicMessageSyntax is thread safe.
   bool BasicApplicationLevelConfidentialityProfile(bool deidentify = true);
 
   /// Set/Get CMS key that will be used to encrypt the dataset within BasicApplicationLevelConfidentialityProfile
   void SetCryptographicMessageSyntax( CryptographicMessageSyntax *cms );
   const CryptographicMessageSyntax *GetCryptographicMessageSyntax() const;
 
+  /// Set/Get the mapping of original values to dummy values used within
+  /// BasicApplicationLevelConfidentialityProfile. When not set (nullptr) a
+  /// mapping shared by all Anonymizer instances is used.
+  void SetDummyValueMap( DummyValueMap *dvm ) { DVM = dvm; }
+  DummyValueMap *GetDummyValueMap() const { return DVM; }
+
   /// for wrapped language: instantiate a reference counted object
   static SmartPointer<Anonymizer> New() { return new Anonymizer; }
 
   /// Return the list of Tag that will be considered when anonymizing a DICOM file.
   static std::vector<Tag> GetBasicApplicationLevelConfidentialityProfileAttributes();
 
-  /// Clear the internal mapping of real UIDs to generated UIDs
+  /// Clear the shared mapping of real UIDs to generated UIDs
   /// \warning the mapping is definitely lost
   static void ClearInternalUIDs();
 
@@ -162,12 +171,7 @@ private:
   // I would prefer to have a smart pointer to DataSet but DataSet does not derive from Object...
   SmartPointer<File> F;
   CryptographicMessageSyntax *CMS;
-
-  typedef std::pair< Tag, std::string > TagValueKey;
-  typedef std::map< TagValueKey, std::string > DummyMapNonUIDTags;
-  typedef std::map< std::string, std::string > DummyMapUIDTags;
-  static DummyMapNonUIDTags dummyMapNonUIDTags;
-  static DummyMapUIDTags dummyMapUIDTags;
+  DummyValueMap *DVM;
 };
 
 /**
@@ -0,0 +1,175 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmBatchAnonymizer.h"
+#include "gdcmStreamingAnonymizer.h"
+#include "gdcmParallelFor.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace gdcm
+{
+
+class BatchAnonymizerInternals
+{
+public:
+  Directory::FilenamesType Inputs;
+  Directory::FilenamesType Outputs;
+  Directory::FilenamesType Failed;
+  CryptographicMessageSyntax *CMS{nullptr};
+  DummyValueMap *DVM{nullptr};
+  unsigned int NumberOfThreads{0};
+  bool SkipUnreadableFiles{false};
+};
+
+namespace
+{
+enum FileStatus
+{
+  FILE_DONE,
+  FILE_UNREADABLE,
+  FILE_FAILED
+};
+}
+
+static FileStatus AnonymizeOneFile(StreamingAnonymizer &anon, const char *filename,
+  const char *outfilename, bool deidentify)
+{
+  anon.SetInputFileName( filename );
+  anon.SetOutputFileName( outfilename );
+  if( !anon.BasicApplicationLevelConfidentialityProfile( deidentify ) )
+    {
+    if( anon.IsInputFileUnreadable() )
+      {
+      gdcmErrorMacro( "Could not read: " << filename );
+      return FILE_UNREADABLE;
+      }
+    gdcmErrorMacro( "Could not " << (deidentify ? "de" : "re")
+      << "-identify: " << filename );
+    return FILE_FAILED;
+    }
+  return FILE_DONE;
+}
+
+BatchAnonymizer::BatchAnonymizer():Internals(new BatchAnonymizerInternals)
+{
+}
+
+BatchAnonymizer::~BatchAnonymizer()
+{
+  delete Internals;
+}
+
+void BatchAnonymizer::SetFileNames(Directory::FilenamesType const &inputs,
+  Directory::FilenamesType const &outputs)
+{
+  Internals->Inputs = inputs;
+  Internals->Outputs = outputs;
+}
+
+void BatchAnonymizer::SetCryptographicMessageSyntax( CryptographicMessageSyntax *cms )
+{
+  Internals->CMS = cms;
+}
+
+const CryptographicMessageSyntax *BatchAnonymizer::GetCryptographicMessageSyntax() const
+{
+  return Internals->CMS;
+}
+
+void BatchAnonymizer::SetDummyValueMap( DummyValueMap *dvm )
+{
+  Internals->DVM = dvm;
+}
+
+DummyValueMap *BatchAnonymizer::GetDummyValueMap() const
+{
+  return Internals->DVM;
+}
+
+void BatchAnonymizer::SetNumberOfThreads(unsigned int nthreads)
+{
+  Internals->NumberOfThreads = nthreads;
+}
+
+unsigned int BatchAnonymizer::GetNumberOfThreads() const
+{
+  return Internals->NumberOfThreads;
+}
+
+void BatchAnonymizer::SetSkipUnreadableFiles(bool skip)
+{
+  Internals->SkipUnreadableFiles = skip;
+}
+
+bool BatchAnonymizer::GetSkipUnreadableFiles() const
+{
+  return Internals->SkipUnreadableFiles;
+}
+
+Directory::FilenamesType const &BatchAnonymizer::GetFailedFileNames() const
+{
+  return Internals->Failed;
+}
+
+bool BatchAnonymizer::Anonymize(bool deidentify)
+{
+  Directory::FilenamesType const &inputs = Internals->Inputs;
+  Directory::FilenamesType const &outputs = Internals->Outputs;
+  Internals->Failed.clear();
+  if( inputs.size() != outputs.size() )
+    {
+    gdcmErrorMacro( "Different number of input and output files" );
+    return false;
+    }
+  const size_t nfiles = inputs.size();
+
+  const unsigned int nthreads =
+    ComputeNumberOfThreads( Internals->NumberOfThreads, nfiles );
+  std::vector<StreamingAnonymizer> anons( nthreads );
+  for( unsigned int t = 0; t < nthreads; ++t )
+    {
+    anons[t].SetCryptographicMessageSyntax( Internals->CMS );
+    anons[t].SetDummyValueMap( Internals->DVM );
+    }
+
+  // Stop at the first file which failed (or could not be read, unless
+  // those are skipped)
+  std::mutex lock;
+  std::vector<size_t> failed;
+  const bool done = ParallelFor( nfiles, nthreads,
+    [&]( size_t i, unsigned int t ) {
+      FileStatus status;
+      try
+        {
+        status = AnonymizeOneFile( anons[t], inputs[i].c_str(), outputs[i].c_str(), deidentify );
+        }
+      catch( std::exception &ex )
+        {
+        gdcmErrorMacro( "Exception while processing: " << inputs[i] << ": " << ex.what() );
+        status = FILE_FAILED;
+        }
+      if( status == FILE_DONE ) return true;
+      std::lock_guard<std::mutex> guard( lock );
+      failed.push_back( i );
+      return status != FILE_FAILED && Internals->SkipUnreadableFiles;
+    } );
+
+  std::sort( failed.begin(), failed.end() );
+  for( size_t i = 0; i < failed.size(); ++i )
+    Internals->Failed.push_back( inputs[ failed[i] ] );
+  return done;
+}
+
+} // end namespace gdcm
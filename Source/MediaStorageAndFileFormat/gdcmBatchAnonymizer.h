@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMBATCHANONYMIZER_H
+#define GDCMBATCHANONYMIZER_H
+
+#include "gdcmDirectory.h"
+
+namespace gdcm
+{
+
+class CryptographicMessageSyntax;
+class DummyValueMap;
+class BatchAnonymizerInternals;
+
+/**
+ * \brief BatchAnonymizer
+ * \details Apply the Basic Application Level Confidentiality Profile (see
+ * Anonymizer) to a set of files, using several threads: each thread
+ * de-identifies (or re-identifies) one file at a time with a
+ * StreamingAnonymizer, so the Pixel Data are never loaded in memory.
+ *
+ * Dummy values are consistent across all files: they all use the same
+ * DummyValueMap, which can be saved and loaded back to keep them consistent
+ * from one run to the next.
+ *
+ * The CryptographicMessageSyntax is shared by all threads, its Encrypt /
+ * Decrypt functions must be thread safe (this is the case with OpenSSL).
+ *
+ * \see Anonymizer StreamingAnonymizer DummyValueMap
+ */
+class GDCM_EXPORT BatchAnonymizer
+{
+public:
+  BatchAnonymizer();
+  ~BatchAnonymizer();
+  BatchAnonymizer(const BatchAnonymizer&) = delete;
+  void operator=(const BatchAnonymizer&) = delete;
+
+  /// Set the files to process: input file i is written to output file i
+  /// (which can be the same file).
+  void SetFileNames(Directory::FilenamesType const &inputs,
+    Directory::FilenamesType const &outputs);
+
+  /// Set/Get CMS key used to encrypt (decrypt) the attributes
+  void SetCryptographicMessageSyntax( CryptographicMessageSyntax *cms );
+  const CryptographicMessageSyntax *GetCryptographicMessageSyntax() const;
+
+  /// Set/Get the mapping of original values to dummy values. When not set
+  /// (nullptr) the one shared by all Anonymizer instances is used.
+  void SetDummyValueMap( DummyValueMap *dvm );
+  DummyValueMap *GetDummyValueMap() const;
+
+  /// Set/Get the number of files anonymized at once (one per core if unset)
+  void SetNumberOfThreads(unsigned int nthreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /// When set, input files which cannot be read are skipped, otherwise they
+  /// stop the processing like any other error. Default is false.
+  void SetSkipUnreadableFiles(bool skip);
+  bool GetSkipUnreadableFiles() const;
+
+  /// De-identify (or re-identify) all the files. Return false when a file
+  /// could not be processed: no new file is started after an error, files
+  /// being processed are finished.
+  bool Anonymize(bool deidentify = true);
+
+  /// Input files which failed or were skipped during the last call to
+  /// Anonymize, in the order of the inputs.
+  Directory::FilenamesType const &GetFailedFileNames() const;
+
+private:
+  BatchAnonymizerInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMBATCHANONYMIZER_H
@@ -0,0 +1,728 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmCatalog.h"
+#include "gdcmScanner2.h"
+#include "gdcmDataSet.h"
+#include "gdcmSystem.h"
+#include "gdcmTrace.h"
+#include "gdcmParallelFor.h"
+#include "gdcmTextFields.h"
+
+#include <algorithm>
+#include <cstdlib> // strtoul
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace gdcm
+{
+
+namespace
+{
+struct CatalogColumn
+{
+  Tag T;
+  VR::VRType V;
+  bool Indexed;
+};
+
+// The first column is the unique key of the level
+const CatalogColumn PatientColumns[] = {
+  { Tag(0x0010,0x0020), VR::LO, true }, // Patient ID
+  { Tag(0x0010,0x0010), VR::PN, true }, // Patient's Name
+  { Tag(0x0010,0x0030), VR::DA, false }, // Patient's Birth Date
+  { Tag(0x0010,0x0040), VR::CS, false }, // Patient's Sex
+};
+const CatalogColumn StudyColumns[] = {
+  { Tag(0x0020,0x000d), VR::UI, true }, // Study Instance UID
+  { Tag(0x0008,0x0020), VR::DA, true }, // Study Date
+  { Tag(0x0008,0x0030), VR::TM, false }, // Study Time
+  { Tag(0x0008,0x0050), VR::SH, true }, // Accession Number
+  { Tag(0x0020,0x0010), VR::SH, false }, // Study ID
+  { Tag(0x0008,0x1030), VR::LO, false }, // Study Description
+  { Tag(0x0008,0x0090), VR::PN, false }, // Referring Physician's Name
+};
+const CatalogColumn SeriesColumns[] = {
+  { Tag(0x0020,0x000e), VR::UI, true }, // Series Instance UID
+  { Tag(0x0008,0x0060), VR::CS, true }, // Modality
+  { Tag(0x0020,0x0011), VR::IS, false }, // Series Number
+  { Tag(0x0008,0x0021), VR::DA, false }, // Series Date
+  { Tag(0x0008,0x103e), VR::LO, false }, // Series Description
+};
+const CatalogColumn InstanceColumns[] = {
+  { Tag(0x0008,0x0018), VR::UI, true }, // SOP Instance UID
+  { Tag(0x0008,0x0016), VR::UI, false }, // SOP Class UID
+  { Tag(0x0020,0x0013), VR::IS, false }, // Instance Number
+};
+
+const unsigned int NumberOfLevels = 4;
+const CatalogColumn *const LevelColumns[NumberOfLevels] = {
+  PatientColumns, StudyColumns, SeriesColumns, InstanceColumns };
+const unsigned int LevelNumberOfColumns[NumberOfLevels] = {
+  sizeof(PatientColumns) / sizeof(*PatientColumns),
+  sizeof(StudyColumns) / sizeof(*StudyColumns),
+  sizeof(SeriesColumns) / sizeof(*SeriesColumns),
+  sizeof(InstanceColumns) / sizeof(*InstanceColumns) };
+const char LevelNames[NumberOfLevels][8] = { "PATIENT", "STUDY", "SERIES", "IMAGE" };
+const char LevelKeys[NumberOfLevels + 1] = "PTSI";
+
+const size_t NoParent = (size_t)-1;
+
+// Find the level and column of t, return false if t is not in the catalog
+bool FindColumn(Tag const &t, unsigned int &level, unsigned int &col)
+{
+  for( level = 0; level < NumberOfLevels; ++level )
+    for( col = 0; col < LevelNumberOfColumns[level]; ++col )
+      if( LevelColumns[level][col].T == t ) return true;
+  return false;
+}
+
+bool IsRangeVR(VR::VRType vr)
+{
+  return vr == VR::DA || vr == VR::TM || vr == VR::DT;
+}
+
+// '*' matches any sequence of characters, '?' any single character
+bool WildCardMatch(const char *s, const char *pattern)
+{
+  const char *star = nullptr, *ss = s;
+  while( *s )
+    {
+    if( *pattern == '?' || ( *pattern && *pattern != '*' && *pattern == *s ) )
+      {
+      ++s; ++pattern;
+      }
+    else if( *pattern == '*' )
+      {
+      star = pattern++;
+      ss = s;
+      }
+    else if( star )
+      {
+      pattern = star + 1;
+      s = ++ss;
+      }
+    else
+      return false;
+    }
+  while( *pattern == '*' ) ++pattern;
+  return !*pattern;
+}
+
+// A matching key, preprocessed once per query
+struct CatalogKey
+{
+  enum { Equal, List, Range, WildCard } Type;
+  unsigned int Column;
+  std::string Value; // also the lower bound of a range, or the wild card
+  std::string Upper;
+  std::vector<std::string> Values; // list of UIDs
+  std::string Prefix; // of the wild card, before the first '*' or '?'
+
+  bool Match(std::string const &v) const
+    {
+    switch( Type )
+      {
+    case Equal:
+      return v == Value;
+    case List:
+      return std::find( Values.begin(), Values.end(), v ) != Values.end();
+    case Range:
+      // The upper bound is inclusive, whatever the precision of the value
+      return !v.empty() && ( Value.empty() || v >= Value )
+        && ( Upper.empty() || v.compare( 0, Upper.size(), Upper ) <= 0 );
+    case WildCard:
+      return WildCardMatch( v.c_str(), Value.c_str() );
+      }
+    return false;
+    }
+};
+
+bool MakeKey(unsigned int col, VR::VRType vr, std::string const &value, CatalogKey &key)
+{
+  if( value.empty() ) return false; // universal matching
+  key.Column = col;
+  key.Value = value;
+  std::string::size_type pos;
+  if( vr == VR::UI && value.find( '\\' ) != std::string::npos )
+    {
+    key.Type = CatalogKey::List;
+    std::string::size_type start = 0;
+    do
+      {
+      pos = value.find( '\\', start );
+      key.Values.push_back( TrimValue( value.c_str() + start,
+          ( pos == std::string::npos ? value.size() : pos ) - start ) );
+      start = pos + 1;
+      } while( pos != std::string::npos );
+    }
+  else if( IsRangeVR( vr ) && ( pos = value.find( '-' ) ) != std::string::npos )
+    {
+    key.Type = CatalogKey::Range;
+    key.Value = value.substr( 0, pos );
+    key.Upper = value.substr( pos + 1 );
+    }
+  else if( vr != VR::UI && ( pos = value.find_first_of( "*?" ) ) != std::string::npos )
+    {
+    key.Type = CatalogKey::WildCard;
+    key.Prefix = value.substr( 0, pos );
+    if( key.Value == "*" ) return false;
+    }
+  else
+    key.Type = CatalogKey::Equal;
+  return true;
+}
+}
+
+// One table per level. Each indexed column maps its values to the (sorted)
+// ids of the records, so that equality, prefix and range matching only visit
+// the matching records.
+class CatalogTable
+{
+public:
+  typedef std::map< std::string, std::vector<size_t> > IndexType;
+  unsigned int NumberOfColumns{0};
+  const CatalogColumn *Columns{nullptr};
+  std::vector<std::string> Values; // record r, column c: r * NumberOfColumns + c
+  std::vector<size_t> Parents;
+  std::vector< std::vector<size_t> > Children;
+  std::vector<IndexType> Indexes; // one per column, empty if not indexed
+
+  size_t GetNumberOfRecords() const { return Parents.size(); }
+  std::string const & GetValue(size_t id, unsigned int col) const
+    {
+    return Values[ id * NumberOfColumns + col ];
+    }
+  void Clear()
+    {
+    Values.clear();
+    Parents.clear();
+    Children.clear();
+    Indexes.assign( NumberOfColumns, IndexType() );
+    }
+  // Return the id of the record with this unique key, or NoParent
+  size_t Find(std::string const &key) const
+    {
+    IndexType::const_iterator it = Indexes[0].find( key );
+    return it == Indexes[0].end() ? NoParent : it->second[0];
+    }
+  size_t Insert(const std::string *values, size_t parent)
+    {
+    const size_t id = GetNumberOfRecords();
+    Values.insert( Values.end(), values, values + NumberOfColumns );
+    Parents.push_back( parent );
+    Children.push_back( std::vector<size_t>() );
+    for( unsigned int c = 0; c < NumberOfColumns; ++c )
+      if( Columns[c].Indexed )
+        Indexes[c][ values[c] ].push_back( id );
+    return id;
+    }
+  // Ids matching key, from the index. Return false when the index cannot be
+  // used (not indexed, or wild card without a prefix)
+  bool LookUp(CatalogKey const &key, std::vector<size_t> &ids) const;
+  // Ids of all the records matching keys (sorted)
+  std::vector<size_t> Select(std::vector<CatalogKey> const &keys) const;
+};
+
+bool CatalogTable::LookUp(CatalogKey const &key, std::vector<size_t> &ids) const
+{
+  if( !Columns[key.Column].Indexed ) return false;
+  const IndexType &index = Indexes[key.Column];
+  ids.clear();
+  IndexType::const_iterator it;
+  switch( key.Type )
+    {
+  case CatalogKey::Equal:
+    it = index.find( key.Value );
+    if( it != index.end() ) ids = it->second;
+    return true;
+  case CatalogKey::List:
+    for( size_t i = 0; i < key.Values.size(); ++i )
+      {
+      it = index.find( key.Values[i] );
+      if( it != index.end() ) ids.insert( ids.end(), it->second.begin(), it->second.end() );
+      }
+    break;
+  case CatalogKey::Range:
+    for( it = index.lower_bound( key.Value ); it != index.end(); ++it )
+      {
+      if( !key.Upper.empty() && it->first.compare( 0, key.Upper.size(), key.Upper ) > 0 )
+        break;
+      if( key.Match( it->first ) )
+        ids.insert( ids.end(), it->second.begin(), it->second.end() );
+      }
+    break;
+  case CatalogKey::WildCard:
+    if( key.Prefix.empty() ) return false;
+    for( it = index.lower_bound( key.Prefix ); it != index.end()
+      && it->first.compare( 0, key.Prefix.size(), key.Prefix ) == 0; ++it )
+      {
+      if( key.Match( it->first ) )
+        ids.insert( ids.end(), it->second.begin(), it->second.end() );
+      }
+    break;
+    }
+  std::sort( ids.begin(), ids.end() );
+  ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+  return true;
+}
+
+std::vector<size_t> CatalogTable::Select(std::vector<CatalogKey> const &keys) const
+{
+  // Start from the smallest set of records found in an index
+  std::vector<size_t> candidates, ids;
+  bool indexed = false;
+  for( size_t k = 0; k < keys.size(); ++k )
+    {
+    if( LookUp( keys[k], ids ) && ( !indexed || ids.size() < candidates.size() ) )
+      {
+      candidates.swap( ids );
+      indexed = true;
+      }
+    }
+  std::vector<size_t> ret;
+  const size_t n = indexed ? candidates.size() : GetNumberOfRecords();
+  for( size_t i = 0; i < n; ++i )
+    {
+    const size_t id = indexed ? candidates[i] : i;
+    bool match = true;
+    for( size_t k = 0; k < keys.size() && match; ++k )
+      match = keys[k].Match( GetValue( id, keys[k].Column ) );
+    if( match ) ret.push_back( id );
+    }
+  return ret;
+}
+
+class CatalogInternals
+{
+public:
+  CatalogTable Tables[NumberOfLevels];
+  std::vector<std::string> Filenames; // of the instances
+  unsigned int NumberOfThreads{0};
+
+  CatalogInternals()
+    {
+    for( unsigned int level = 0; level < NumberOfLevels; ++level )
+      {
+      Tables[level].NumberOfColumns = LevelNumberOfColumns[level];
+      Tables[level].Columns = LevelColumns[level];
+      Tables[level].Clear();
+      }
+    }
+  void Clear()
+    {
+    for( unsigned int level = 0; level < NumberOfLevels; ++level )
+      Tables[level].Clear();
+    Filenames.clear();
+    }
+  // Add one instance, and its parents if needed
+  void Insert(const std::string *values[NumberOfLevels], const char *filename)
+    {
+    size_t parent = NoParent;
+    for( unsigned int level = 0; level < NumberOfLevels; ++level )
+      {
+      CatalogTable &table = Tables[level];
+      size_t id = table.Find( values[level][0] );
+      if( id == NoParent )
+        {
+        id = table.Insert( values[level], parent );
+        if( parent != NoParent ) Tables[level - 1].Children[parent].push_back( id );
+        if( level == NumberOfLevels - 1 ) Filenames.push_back( filename );
+        }
+      parent = id;
+      }
+    }
+  // Id of the ancestor at level of record id at level from
+  size_t GetAncestor(unsigned int from, size_t id, unsigned int level) const
+    {
+    for( ; from > level; --from )
+      id = Tables[from].Parents[id];
+    return id;
+    }
+};
+
+Catalog::Catalog():Internals(new CatalogInternals)
+{
+}
+
+Catalog::~Catalog()
+{
+  delete Internals;
+}
+
+std::vector<Tag> Catalog::GetTags(LevelType level)
+{
+  std::vector<Tag> tags;
+  for( unsigned int c = 0; c < LevelNumberOfColumns[level]; ++c )
+    tags.push_back( LevelColumns[level][c].T );
+  return tags;
+}
+
+void Catalog::SetNumberOfThreads(unsigned int nthreads)
+{
+  Internals->NumberOfThreads = nthreads;
+}
+
+unsigned int Catalog::GetNumberOfThreads() const
+{
+  return Internals->NumberOfThreads;
+}
+
+bool Catalog::Populate(Directory::FilenamesType const & filenames)
+{
+  if( filenames.empty() ) return true;
+  const unsigned int nthreads =
+    ComputeNumberOfThreads( Internals->NumberOfThreads, filenames.size() );
+
+  // Each Scanner2 scans a contiguous part of filenames, the records are then
+  // inserted in the order of filenames
+  std::vector< SmartPointer<Scanner2> > scanners( nthreads );
+  std::vector<Directory::FilenamesType> chunks( nthreads );
+  const size_t chunksize = ( filenames.size() + nthreads - 1 ) / nthreads;
+  for( unsigned int t = 0; t < nthreads; ++t )
+    {
+    scanners[t] = new Scanner2;
+    for( unsigned int level = 0; level < NumberOfLevels; ++level )
+      for( unsigned int c = 0; c < LevelNumberOfColumns[level]; ++c )
+        scanners[t]->AddPublicTag( LevelColumns[level][c].T );
+    const size_t begin = std::min( t * chunksize, filenames.size() );
+    const size_t end = std::min( begin + chunksize, filenames.size() );
+    chunks[t].assign( filenames.begin() + begin, filenames.begin() + end );
+    }
+  const bool scanned = ParallelFor( nthreads, nthreads,
+    [&]( size_t t, unsigned int ) {
+      try
+        {
+        return scanners[t]->Scan( chunks[t] );
+        }
+      catch( std::exception &ex )
+        {
+        gdcmErrorMacro( "Exception while scanning: " << ex.what() );
+        return false;
+        }
+    } );
+  if( !scanned ) return false;
+
+  std::vector<std::string> values[NumberOfLevels];
+  const std::string *pvalues[NumberOfLevels];
+  for( unsigned int level = 0; level < NumberOfLevels; ++level )
+    {
+    values[level].resize( LevelNumberOfColumns[level] );
+    pvalues[level] = values[level].data();
+    }
+  for( unsigned int t = 0; t < nthreads; ++t )
+    {
+    const Scanner2 &s = *scanners[t];
+    for( size_t f = 0; f < chunks[t].size(); ++f )
+      {
+      const char *filename = chunks[t][f].c_str();
+      if( !s.IsKey( filename ) )
+        {
+        gdcmDebugMacro( "Skipping: " << filename );
+        continue;
+        }
+      const Scanner2::PublicTagToValue &mapping = s.GetPublicMapping( filename );
+      for( unsigned int level = 0; level < NumberOfLevels; ++level )
+        for( unsigned int c = 0; c < LevelNumberOfColumns[level]; ++c )
+          {
+          Scanner2::PublicTagToValue::const_iterator it =
+            mapping.find( LevelColumns[level][c].T );
+          values[level][c] = it == mapping.end() ? std::string()
+            : TrimValue( it->second );
+          }
+      if( values[NumberOfLevels - 1][0].empty() )
+        {
+        gdcmDebugMacro( "No SOP Instance UID, skipping: " << filename );
+        continue;
+        }
+      Internals->Insert( pvalues, filename );
+      }
+    }
+  return true;
+}
+
+void Catalog::Clear()
+{
+  Internals->Clear();
+}
+
+size_t Catalog::GetNumberOfRecords(LevelType level) const
+{
+  return Internals->Tables[level].GetNumberOfRecords();
+}
+
+std::vector<size_t> Catalog::Select(LevelType level, KeysType const & keys) const
+{
+  // Matching records, for each level with at least one key
+  std::vector<CatalogKey> levelkeys[NumberOfLevels];
+  for( KeysType::const_iterator it = keys.begin(); it != keys.end(); ++it )
+    {
+    unsigned int l, col;
+    if( !FindColumn( it->first, l, col ) || l > (unsigned int)level )
+      {
+      gdcmDebugMacro( "Ignoring key: " << it->first );
+      continue;
+      }
+    CatalogKey key;
+    if( MakeKey( col, LevelColumns[l][col].V, TrimValue( it->second.c_str(), it->second.size() ), key ) )
+      levelkeys[l].push_back( key );
+    }
+  std::vector<size_t> matches[NumberOfLevels];
+  int best = -1;
+  for( unsigned int l = 0; l <= (unsigned int)level; ++l )
+    {
+    if( levelkeys[l].empty() ) continue;
+    matches[l] = Internals->Tables[l].Select( levelkeys[l] );
+    if( best < 0 || matches[l].size() < matches[best].size() ) best = (int)l;
+    }
+  std::vector<size_t> ids;
+  if( best < 0 )
+    {
+    ids.resize( GetNumberOfRecords( level ) );
+    for( size_t i = 0; i < ids.size(); ++i ) ids[i] = i;
+    return ids;
+    }
+
+  // Start from the level with the fewest matching records, go down to the
+  // requested level, then check the records of the other levels
+  ids = matches[best];
+  for( unsigned int l = (unsigned int)best; l < (unsigned int)level; ++l )
+    {
+    std::vector<size_t> children;
+    for( size_t i = 0; i < ids.size(); ++i )
+      {
+      const std::vector<size_t> &c = Internals->Tables[l].Children[ ids[i] ];
+      children.insert( children.end(), c.begin(), c.end() );
+      }
+    ids.swap( children );
+    }
+  std::vector<size_t> ret;
+  for( size_t i = 0; i < ids.size(); ++i )
+    {
+    bool match = true;
+    for( unsigned int l = 0; l <= (unsigned int)level && match; ++l )
+      {
+      if( (int)l == best || levelkeys[l].empty() ) continue;
+      match = std::binary_search( matches[l].begin(), matches[l].end(),
+        Internals->GetAncestor( level, ids[i], l ) );
+      }
+    if( match ) ret.push_back( ids[i] );
+    }
+  std::sort( ret.begin(), ret.end() );
+  return ret;
+}
+
+const char *Catalog::GetValue(LevelType level, size_t id, Tag const & t) const
+{
+  unsigned int l, col;
+  if( !FindColumn( t, l, col ) || l > (unsigned int)level
+    || id >= GetNumberOfRecords( level ) )
+    return nullptr;
+  return Internals->Tables[l].GetValue(
+    Internals->GetAncestor( level, id, l ), col ).c_str();
+}
+
+size_t Catalog::GetParent(LevelType level, size_t id) const
+{
+  assert( id < GetNumberOfRecords( level ) );
+  return Internals->Tables[level].Parents[id];
+}
+
+const char *Catalog::GetFilename(size_t id) const
+{
+  if( id >= Internals->Filenames.size() ) return nullptr;
+  return Internals->Filenames[id].c_str();
+}
+
+Directory::FilenamesType Catalog::GetFilenames(LevelType level, size_t id) const
+{
+  Directory::FilenamesType filenames;
+  if( id >= GetNumberOfRecords( level ) ) return filenames;
+  std::vector<size_t> ids( 1, id );
+  for( unsigned int l = level; l < NumberOfLevels - 1; ++l )
+    {
+    std::vector<size_t> children;
+    for( size_t i = 0; i < ids.size(); ++i )
+      {
+      const std::vector<size_t> &c = Internals->Tables[l].Children[ ids[i] ];
+      children.insert( children.end(), c.begin(), c.end() );
+      }
+    ids.swap( children );
+    }
+  for( size_t i = 0; i < ids.size(); ++i )
+    filenames.push_back( Internals->Filenames[ ids[i] ] );
+  return filenames;
+}
+
+bool Catalog::Find(DataSet const & identifier, std::vector<DataSet> & results) const
+{
+  results.clear();
+  const Tag queryretrievelevel(0x0008,0x0052);
+  const Tag specificcharacterset(0x0008,0x0005);
+  const ByteValue *bv = identifier.FindDataElement( queryretrievelevel ) ?
+    identifier.GetDataElement( queryretrievelevel ).GetByteValue() : nullptr;
+  if( !bv )
+    {
+    gdcmErrorMacro( "No Query/Retrieve Level" );
+    return false;
+    }
+  const std::string levelname = TrimValue( bv->GetPointer(), bv->GetLength() );
+  unsigned int l = 0;
+  while( l < NumberOfLevels && levelname != LevelNames[l] ) ++l;
+  if( l == NumberOfLevels )
+    {
+    gdcmErrorMacro( "Invalid Query/Retrieve Level: " << levelname );
+    return false;
+    }
+  const LevelType level = (LevelType)l;
+
+  KeysType keys;
+  for( DataSet::ConstIterator it = identifier.Begin(); it != identifier.End(); ++it )
+    {
+    const Tag &t = it->GetTag();
+    if( t == queryretrievelevel || t == specificcharacterset ) continue;
+    const ByteValue *value = it->GetByteValue();
+    if( value && value->GetLength() )
+      keys.push_back( std::make_pair( t, std::string( value->GetPointer(), value->GetLength() ) ) );
+    }
+  const std::vector<size_t> ids = Select( level, keys );
+
+  results.resize( ids.size() );
+  for( size_t i = 0; i < ids.size(); ++i )
+    {
+    DataSet &ds = results[i];
+    for( DataSet::ConstIterator it = identifier.Begin(); it != identifier.End(); ++it )
+      {
+      const Tag &t = it->GetTag();
+      if( t == queryretrievelevel || t == specificcharacterset )
+        {
+        ds.Insert( *it );
+        continue;
+        }
+      DataElement de( t );
+      de.SetVR( it->GetVR() );
+      unsigned int vl, col;
+      if( FindColumn( t, vl, col ) )
+        {
+        if( it->GetVR() == VR::INVALID || it->GetVR() == VR::UN )
+          de.SetVR( LevelColumns[vl][col].V );
+        const char *value = GetValue( level, ids[i], t );
+        std::string s = value ? value : "";
+        if( s.size() % 2 ) s.push_back( de.GetVR() == VR::UI ? '\0' : ' ' );
+        de.SetByteValue( s.c_str(), (uint32_t)s.size() );
+        }
+      ds.Insert( de );
+      }
+    }
+  return true;
+}
+
+bool Catalog::Read(const char *filename)
+{
+  std::ifstream is( filename, std::ios::binary );
+  if( !is )
+    {
+    gdcmErrorMacro( "Could not open: " << filename );
+    return false;
+    }
+  Internals->Clear();
+  std::string line, field;
+  std::vector<std::string> values;
+  unsigned int lineno = 0;
+  while( std::getline( is, line ) )
+    {
+    ++lineno;
+    if( !line.empty() && line[line.size()-1] == '\r' ) line.resize( line.size() - 1 );
+    if( line.empty() || line[0] == '#' ) continue;
+    const char *key = strchr( LevelKeys, line[0] );
+    bool valid = key && *key && line.size() > 1 && line[1] == '\t';
+    const unsigned int level = valid ? (unsigned int)(key - LevelKeys) : 0;
+    std::string::size_type pos = 2;
+    size_t parent = NoParent;
+    std::string instancefilename;
+    if( valid && level )
+      {
+      valid = ReadTextField( line, pos, field ) && !field.empty();
+      char *end = nullptr;
+      parent = valid ? (size_t)strtoul( field.c_str(), &end, 10 ) : NoParent;
+      valid = valid && !*end && parent < Internals->Tables[level - 1].GetNumberOfRecords();
+      }
+    if( valid && level == NumberOfLevels - 1 )
+      valid = ReadTextField( line, pos, instancefilename );
+    CatalogTable &table = Internals->Tables[level];
+    values.resize( table.NumberOfColumns );
+    for( unsigned int c = 0; valid && c < table.NumberOfColumns; ++c )
+      valid = ReadTextField( line, pos, values[c] );
+    if( !valid || pos != line.size() )
+      {
+      gdcmErrorMacro( "Invalid line " << lineno << " in: " << filename );
+      Internals->Clear();
+      return false;
+      }
+    const size_t id = table.Insert( values.data(), parent );
+    if( level ) Internals->Tables[level - 1].Children[parent].push_back( id );
+    if( level == NumberOfLevels - 1 ) Internals->Filenames.push_back( instancefilename );
+    }
+  return true;
+}
+
+bool Catalog::Write(const char *filename) const
+{
+  const std::string tmpfilename = std::string( filename ) + ".tmp";
+    {
+    std::ofstream os( tmpfilename.c_str(), std::ios::binary );
+    if( !os )
+      {
+      gdcmErrorMacro( "Could not create: " << tmpfilename );
+      return false;
+      }
+    os << "# GDCM catalog\n";
+    // Parents are written before their children
+    for( unsigned int level = 0; level < NumberOfLevels; ++level )
+      {
+      const CatalogTable &table = Internals->Tables[level];
+      for( size_t id = 0; id < table.GetNumberOfRecords(); ++id )
+        {
+        os << LevelKeys[level];
+        if( level ) os << '\t' << table.Parents[id];
+        if( level == NumberOfLevels - 1 )
+          {
+          os << '\t';
+          WriteTextField( os, Internals->Filenames[id] );
+          }
+        for( unsigned int c = 0; c < table.NumberOfColumns; ++c )
+          {
+          os << '\t';
+          WriteTextField( os, table.GetValue( id, c ) );
+          }
+        os << '\n';
+        }
+      }
+    os.close();
+    if( os.fail() )
+      {
+      gdcmErrorMacro( "Could not write: " << tmpfilename );
+      System::RemoveFile( tmpfilename.c_str() );
+      return false;
+      }
+    }
+  if( !System::RenameFile( tmpfilename.c_str(), filename ) )
+    {
+    gdcmErrorMacro( "Could not rename " << tmpfilename << " to: " << filename );
+    return false;
+    }
+  return true;
+}
+
+} // end namespace gdcm
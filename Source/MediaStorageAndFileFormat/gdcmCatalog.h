@@ -0,0 +1,135 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMCATALOG_H
+#define GDCMCATALOG_H
+
+#include "gdcmDirectory.h"
+#include "gdcmTag.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace gdcm
+{
+
+class DataSet;
+class CatalogInternals;
+
+/**
+ * \brief Catalog
+ * \details A local catalog of DICOM files, organized as a patient / study /
+ * series / instance hierarchy (one table per level, each record pointing to
+ * its parent). The catalog is populated by scanning files (see Scanner2),
+ * several Scanner2 running in parallel, and queried with the C-FIND matching
+ * rules, so it can be used as the backing store of a local C-FIND SCP.
+ *
+ * Only the attributes returned by GetTags are kept. The UIDs, Patient ID,
+ * Patient's Name, Study Date, Accession Number and Modality are indexed:
+ * a query on one of them does not loop over all records.
+ *
+ * The catalog can be saved to a file (Write) and loaded back (Read), so that
+ * files do not have to be scanned again.
+ *
+ * Usage:
+ * \code
+ * Catalog c;
+ * c.Populate( d.GetFilenames() );
+ * Catalog::KeysType keys;
+ * keys.push_back( std::make_pair( Tag(0x0008,0x0060), "CT" ) );
+ * keys.push_back( std::make_pair( Tag(0x0008,0x0020), "20200101-20201231" ) );
+ * std::vector<size_t> series = c.Select( Catalog::SERIES, keys );
+ * \endcode
+ *
+ * \see Scanner2 DICOMDIRGenerator
+ */
+class GDCM_EXPORT Catalog
+{
+public:
+  Catalog();
+  ~Catalog();
+  Catalog(const Catalog&) = delete;
+  void operator=(const Catalog&) = delete;
+
+  /// Levels of the hierarchy, same as the Query/Retrieve Level (0008,0052)
+  typedef enum {
+    PATIENT = 0,
+    STUDY,
+    SERIES,
+    IMAGE
+  } LevelType;
+
+  /// Matching keys: each value follows the C-FIND rules (PS 3.4 C.2.2.2):
+  /// an empty value matches anything, a list of UIDs (separated by '\')
+  /// matches any of them, a date or time value with a '-' is a range,
+  /// a value with '*' or '?' is a wild card, anything else must be equal.
+  typedef std::vector< std::pair<Tag, std::string> > KeysType;
+
+  /// Return the attributes stored at level (and not at its parent levels)
+  static std::vector<Tag> GetTags(LevelType level);
+
+  /// Set/Get how many Scanner2 Populate runs side by side (default: all cores)
+  void SetNumberOfThreads(unsigned int nthreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /// Scan filenames and add them to the catalog. Files which are not DICOM,
+  /// or without a SOP Instance UID, are skipped. An instance already in the
+  /// catalog is not added twice (its first filename is kept).
+  bool Populate(Directory::FilenamesType const & filenames);
+
+  /// Remove all records
+  void Clear();
+
+  /// Number of records at level
+  size_t GetNumberOfRecords(LevelType level) const;
+
+  /// Return the ids of the records of level matching all keys (in ascending
+  /// order). Keys can be attributes of level or of any of its parent levels;
+  /// other attributes are ignored.
+  std::vector<size_t> Select(LevelType level, KeysType const & keys) const;
+
+  /// Value of t for record id of level, or of one of its parents.
+  /// \return nullptr when t is not an attribute of level or of its parents
+  const char *GetValue(LevelType level, size_t id, Tag const & t) const;
+
+  /// Id of the parent record (at level - 1) of record id of level
+  size_t GetParent(LevelType level, size_t id) const;
+
+  /// Filename of instance id (IMAGE level)
+  const char *GetFilename(size_t id) const;
+
+  /// Filenames of all instances of record id of level
+  Directory::FilenamesType GetFilenames(LevelType level, size_t id) const;
+
+  /// Answer a C-FIND request: the Query/Retrieve Level and the keys are read
+  /// from identifier, one result is returned per matching record with the
+  /// same attributes as identifier (the ones which are not in the catalog
+  /// are returned empty).
+  /// \return false when the Query/Retrieve Level is missing or invalid
+  bool Find(DataSet const & identifier, std::vector<DataSet> & results) const;
+
+  /// Load the records saved in filename (replaces the current ones)
+  bool Read(const char *filename);
+
+  /// Save all records to filename. The file is replaced only once it has
+  /// been completely written.
+  bool Write(const char *filename) const;
+
+private:
+  CatalogInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMCATALOG_H
@@ -24,6 +24,8 @@
 #include "gdcmext/csa.h"
 #include "gdcmext/mec_mr3.h"
 
+#include <unordered_map>
+
 namespace gdcm {
 
 static const PrivateTag part15_table_E_1_1[] = {
@@ -522,6 +524,35 @@ static inline bool in_part15(const PrivateTag &pt) {
 typedef std::set<DataElement> DataElementSet;
 typedef DataElementSet::const_iterator ConstIterator;
 
+// Key of the compiled rules: public tag, or private tag and its creator
+struct RuleKey {
+  uint32_t ElementTag;
+  std::string Owner;
+  RuleKey() : ElementTag(0) {}
+  explicit RuleKey(Tag const &t) : ElementTag(t.GetElementTag()) {}
+  explicit RuleKey(PrivateTag const &pt)
+      : ElementTag(pt.GetElementTag()), Owner(pt.GetOwner()) {}
+  bool operator==(RuleKey const &other) const {
+    return ElementTag == other.ElementTag && Owner == other.Owner;
+  }
+};
+
+struct RuleKeyHash {
+  size_t operator()(RuleKey const &key) const {
+    return std::hash<uint32_t>()(key.ElementTag) ^
+           (std::hash<std::string>()(key.Owner) << 1);
+  }
+};
+
+// DPath rules for an attribute, and index of the rules for the attributes of
+// its items (-1 when none)
+struct RuleNode {
+  unsigned int Rules;
+  int Items;
+  RuleNode() : Rules(0), Items(-1) {}
+};
+typedef std::unordered_map<RuleKey, RuleNode, RuleKeyHash> RuleLevel;
+
 struct Cleaner::impl {
   std::set<DPath> preserve_dpaths;
   std::set<DPath> empty_dpaths;
@@ -546,12 +577,19 @@ struct Cleaner::impl {
         WhenScrubFails(false) {}
 
   enum ACTION { NONE, EMPTY, REMOVE, SCRUB };
-  enum ACTION ComputeAction(File const &file, DataSet &ds,
-                            const DataElement &de, VR const &ref_dict_vr,
-                            const std::string &tag_path);
+  enum ACTION ComputeAction(DataSet &ds, const DataElement &de,
+                            VR const &ref_dict_vr, int level, int &items);
+
+  bool ProcessDataSet(Subject &s, File &file, DataSet &ds, int level);
 
-  bool ProcessDataSet(Subject &s, File &file, DataSet &ds,
-                      const std::string &tag_path);
+  // All the rules above, compiled by Compile() into hash tables: a single
+  // one for the Tag / PrivateTag rules (they apply at any depth) and a trie
+  // for the DPath rules, one level per nested dataset (Levels[0] is root).
+  enum RULE { RULE_PRESERVE = 1, RULE_SCRUB = 2, RULE_EMPTY = 4, RULE_REMOVE = 8 };
+  std::unordered_map<RuleKey, unsigned int, RuleKeyHash> TagRules;
+  std::vector<RuleLevel> Levels;
+  void Compile();
+  bool CompileDPath(DPath const &dpath, unsigned int rule);
 
   template <typename T>
   bool CheckVRBeforeInsert(std::set<VR> &empty_or_remove_vrs, T const &t,
@@ -710,36 +748,6 @@ static VR ComputeDictVR(File &file, DataSet &ds, DataElement const &de) {
   return dict_vr;
 }
 
-static inline std::string tostring(uint16_t const val, int const width = 4) {
-  std::ostringstream oss;
-  oss.setf(std::ios::right);
-  oss << std::hex << std::setw(width) << std::setfill('0') << val;
-  return oss.str();
-}
-
-static std::vector<std::string> tag2strings(DataSet const &ds, Tag const &tag) {
-  std::vector<std::string> ret;
-  if (tag.IsPublic() || tag.IsPrivateCreator() || tag.IsGroupLength()) {
-    ret.push_back(tostring(tag.GetGroup()));
-    ret.push_back(tostring(tag.GetElement()));
-  } else {
-    const PrivateTag pt = ds.GetPrivateTag(tag);
-    ret.push_back(tostring(pt.GetGroup()));
-    ret.push_back(tostring(pt.GetElement(), 2));
-    ret.push_back(pt.GetOwner());
-  }
-  return ret;
-}
-
-template <typename T>
-static void print_contents(std::ostream &oss, const std::vector<T> &v,
-                           const char *const separator = ",") {
-  if (!v.empty()) {
-    std::copy(v.begin(), --v.end(), std::ostream_iterator<T>(oss, separator));
-    oss << v.back();
-  }
-}
-
 static bool isAllZero(const char *buffer, size_t len) {
   while (len-- > 0) {
     if (buffer[len] != 0) return false;
@@ -1063,31 +1071,88 @@ static bool CleanPMTF(DataSet &ds, const DataElement &de) {
   return false;
 }
 
-static DPath ConstructDPath(std::string const &tag_path, const DataSet &ds,
-                            const Tag &tag) {
-  DPath dpath;
+// Components of a DPath: "gggg,eeee" or "gggg,ee,OWNER", separated by '*'
+// when the next attribute is in the items of the previous one. Item numbers
+// are never matched, such DPath are ignored.
+bool Cleaner::impl::CompileDPath(DPath const &dpath, unsigned int rule) {
   std::ostringstream oss;
-  oss << tag_path;
-  const std::vector<std::string> tag_strings = tag2strings(ds, tag);
-  print_contents(oss, tag_strings);
-  dpath.ConstructFromString(oss.str().c_str());
-  return dpath;
+  oss << dpath;
+  std::vector<std::string> comps;
+  std::istringstream is(oss.str());
+  std::string sub;
+  while (std::getline(is, sub, '\\')) comps.push_back(sub);
+  if (comps.size() < 2 || !comps[0].empty()) return false;
+
+  int level = 0;
+  for (size_t i = 1; i < comps.size(); i += 2) {
+    PrivateTag pt;
+    Tag t;
+    RuleKey key;
+    if (pt.ReadFromCommaSeparatedString(comps[i].c_str())) {
+      key = RuleKey(pt);
+    } else if (t.ReadFromCommaSeparatedString(comps[i].c_str())) {
+      key = RuleKey(t);
+    } else {
+      return false;
+    }
+    if (i + 1 == comps.size()) {
+      Levels[level][key].Rules |= rule;
+      return true;
+    }
+    if (comps[i + 1] != "*") return false;
+    int items = Levels[level][key].Items;
+    if (items < 0) {
+      items = static_cast<int>(Levels.size());
+      Levels[level][key].Items = items;
+      Levels.push_back(RuleLevel());
+    }
+    level = items;
+  }
+  return false;
 }
 
-static bool IsDPathInSet(std::set<DPath> const &aset, DPath const dpath) {
-  bool found = false;
-  for (std::set<DPath>::const_iterator it = aset.begin();
-       found == false && it != aset.end(); ++it) {
-    found = it->Match(dpath);
+void Cleaner::impl::Compile() {
+  TagRules.clear();
+  Levels.assign(1, RuleLevel());
+  for (std::set<Tag>::const_iterator it = scrub_tags.begin();
+       it != scrub_tags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_SCRUB;
+  for (std::set<Tag>::const_iterator it = empty_tags.begin();
+       it != empty_tags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_EMPTY;
+  for (std::set<Tag>::const_iterator it = remove_tags.begin();
+       it != remove_tags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_REMOVE;
+  for (std::set<PrivateTag>::const_iterator it = scrub_privatetags.begin();
+       it != scrub_privatetags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_SCRUB;
+  for (std::set<PrivateTag>::const_iterator it = empty_privatetags.begin();
+       it != empty_privatetags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_EMPTY;
+  for (std::set<PrivateTag>::const_iterator it = remove_privatetags.begin();
+       it != remove_privatetags.end(); ++it)
+    TagRules[RuleKey(*it)] |= RULE_REMOVE;
+
+  const std::set<DPath> *dpaths[] = {&preserve_dpaths, &scrub_dpaths,
+                                     &empty_dpaths, &remove_dpaths};
+  const unsigned int rules[] = {RULE_PRESERVE, RULE_SCRUB, RULE_EMPTY,
+                                RULE_REMOVE};
+  for (int i = 0; i < 4; ++i) {
+    for (std::set<DPath>::const_iterator it = dpaths[i]->begin();
+         it != dpaths[i]->end(); ++it) {
+      if (!CompileDPath(*it, rules[i])) {
+        gdcmDebugMacro("DPath can never match: " << *it);
+      }
+    }
   }
-
-  return found;
 }
 
-Cleaner::impl::ACTION Cleaner::impl::ComputeAction(
-    File const & /*file*/, DataSet &ds, const DataElement &de,
-    VR const &ref_dict_vr, const std::string &tag_path) {
+Cleaner::impl::ACTION Cleaner::impl::ComputeAction(DataSet &ds,
+                                                   const DataElement &de,
+                                                   VR const &ref_dict_vr,
+                                                   int level, int &items) {
   const Tag &tag = de.GetTag();
+  items = -1;
   // Group Length & Illegal cannot be preserved so it is safe to do them now:
   if (tag.IsGroupLength()) {
     if (AllGroupLength) return Cleaner::impl::REMOVE;
@@ -1095,56 +1160,41 @@ Cleaner::impl::ACTION Cleaner::impl::ComputeAction(
     if (AllIllegal) return Cleaner::impl::REMOVE;
   }
 
-  if (tag.IsPublic()) {
-    const DPath dpath = ConstructDPath(tag_path, ds, tag);
-    // Preserve
-    if (IsDPathInSet(preserve_dpaths, dpath)) return Cleaner::impl::NONE;
-    // Scrub
-    if (scrub_tags.find(tag) != scrub_tags.end() ||
-        IsDPathInSet(scrub_dpaths, dpath)) {
-      return Cleaner::impl::SCRUB;
-    }
-    // Empty
-    if (empty_tags.find(tag) != empty_tags.end() ||
-        IsDPathInSet(empty_dpaths, dpath)) {
-      assert(!tag.IsGroupLength());
-      assert(!tag.IsPrivateCreator());
-      assert(ds.FindDataElement(tag));
-      return Cleaner::impl::EMPTY;
-    }
-    // Remove
-    if (remove_tags.find(tag) != remove_tags.end() ||
-        IsDPathInSet(remove_dpaths, dpath)) {
-      return Cleaner::impl::REMOVE;
-    }
-  }
-
-  if (tag.IsPrivate() && !tag.IsPrivateCreator() && !tag.IsGroupLength()) {
-    const PrivateTag pt = ds.GetPrivateTag(tag);
-    const char *owner = pt.GetOwner();
-    assert(owner);
-    if (*owner == 0 && AllMissingPrivateCreator) {
-      return Cleaner::impl::REMOVE;
-    }
-    // At this point we have a private creator, it makes sense to check for
-    // preserve: Preserve
-    const DPath dpath = ConstructDPath(tag_path, ds, tag);
-    if (IsDPathInSet(preserve_dpaths, dpath)) return Cleaner::impl::NONE;
-    // Scrub
-    if (scrub_privatetags.find(pt) != scrub_privatetags.end() ||
-        IsDPathInSet(scrub_dpaths, dpath)) {
-      return Cleaner::impl::SCRUB;
+  if (tag.IsPublic() ||
+      (tag.IsPrivate() && !tag.IsPrivateCreator() && !tag.IsGroupLength())) {
+    RuleKey key;
+    if (tag.IsPublic()) {
+      key = RuleKey(tag);
+    } else {
+      const PrivateTag pt = ds.GetPrivateTag(tag);
+      const char *owner = pt.GetOwner();
+      assert(owner);
+      if (*owner == 0 && AllMissingPrivateCreator) {
+        return Cleaner::impl::REMOVE;
+      }
+      // At this point we have a private creator, it makes sense to check for
+      // preserve
+      key = RuleKey(pt);
     }
-    // Empty
-    if (empty_privatetags.find(pt) != empty_privatetags.end() ||
-        IsDPathInSet(empty_dpaths, dpath)) {
-      return Cleaner::impl::EMPTY;
+    unsigned int rules = 0;
+    if (!TagRules.empty()) {
+      std::unordered_map<RuleKey, unsigned int, RuleKeyHash>::const_iterator
+          it = TagRules.find(key);
+      if (it != TagRules.end()) rules = it->second;
     }
-    // Remove
-    if (remove_privatetags.find(pt) != remove_privatetags.end() ||
-        IsDPathInSet(remove_dpaths, dpath)) {
-      return Cleaner::impl::REMOVE;
+    if (level >= 0) {
+      const RuleLevel &rl = Levels[level];
+      RuleLevel::const_iterator it = rl.find(key);
+      if (it != rl.end()) {
+        rules |= it->second.Rules;
+        items = it->second.Items;
+      }
     }
+    // Preserve, Scrub, Empty then Remove
+    if (rules & RULE_PRESERVE) return Cleaner::impl::NONE;
+    if (rules & RULE_SCRUB) return Cleaner::impl::SCRUB;
+    if (rules & RULE_EMPTY) return Cleaner::impl::EMPTY;
+    if (rules & RULE_REMOVE) return Cleaner::impl::REMOVE;
   }
 
   // VR cleanup
@@ -1180,7 +1230,7 @@ Cleaner::impl::ACTION Cleaner::impl::ComputeAction(
 }
 
 bool Cleaner::impl::ProcessDataSet(Subject &subject, File &file, DataSet &ds,
-                                   const std::string &tag_path) {
+                                   int level) {
   subject.InvokeEvent(IterationEvent());
   ConstIterator it = ds.GetDES().begin();
 
@@ -1192,8 +1242,9 @@ bool Cleaner::impl::ProcessDataSet(Subject &subject, File &file, DataSet &ds,
     ae.SetTag(tag);
 
     VR dict_vr = ComputeDictVR(file, ds, de);
+    int items;
     Cleaner::impl::ACTION action =
-        Cleaner::impl::ComputeAction(file, ds, de, dict_vr, tag_path);
+        Cleaner::impl::ComputeAction(ds, de, dict_vr, level, items);
 
     if (action == Cleaner::impl::NONE) {
       // nothing to do, but recurse in nested-dataset:
@@ -1205,16 +1256,8 @@ bool Cleaner::impl::ProcessDataSet(Subject &subject, File &file, DataSet &ds,
             Item &item = sqi->GetItem(i);
 
             DataSet &nestedds = item.GetNestedDataSet();
-            const std::vector<std::string> tag_strings = tag2strings(ds, tag);
-
-            std::ostringstream os;
-            os << tag_path;  // already padded with trailing '/'
-            print_contents(os, tag_strings);
-            os << '/';
-            os << '*';  // no need for item numbering
-            os << '/';
-
-            if (!ProcessDataSet(subject, file, nestedds, os.str())) {
+            // no need for item numbering
+            if (!ProcessDataSet(subject, file, nestedds, items)) {
               gdcmErrorMacro("Error processing Item #" << i);
               return false;
             }
@@ -1329,7 +1372,8 @@ void Cleaner::EmptyWhenScrubFails(bool empty) {
 bool Cleaner::Clean() {
   DataSet &ds = F->GetDataSet();
   this->InvokeEvent(StartEvent());
-  const bool ret = pimpl->ProcessDataSet(*this, *F, ds, "/");
+  pimpl->Compile();
+  const bool ret = pimpl->ProcessDataSet(*this, *F, ds, 0);
   this->InvokeEvent(EndEvent());
   return ret;
 }
@@ -25,349 +25,99 @@
 #include "gdcmTag.h"
 #include "gdcmVR.h"
 #include "gdcmCodeString.h"
+#include "gdcmTextFields.h"
 
+#include <map>
+#include <set>
+#include <vector>
 
 namespace gdcm
 {
 
+namespace
+{
+// A directory record, and its lower level records indexed by their key
+struct DirectoryRecord
+{
+  DirectoryRecord() {}
+  explicit DirectoryRecord(Item const &record):Record(record) {}
+  Item Record;
+  std::map<std::string, size_t> Children; // position in the lower level
+};
+
+enum DirectoryRecordLevel
+{
+  PATIENT = 0,
+  STUDY,
+  SERIES,
+  IMAGE,
+  NUMBER_OF_LEVELS
+};
+
+// Key of a record: Patient ID, Study Instance UID, Series Instance UID and
+// SOP Instance UID (Referenced SOP Instance UID in File for the records)
+const Tag KeyTags[NUMBER_OF_LEVELS] = {
+  Tag(0x10,0x20), Tag(0x20,0xd), Tag(0x20,0xe), Tag(0x8,0x18) };
+const Tag RecordKeyTags[NUMBER_OF_LEVELS] = {
+  Tag(0x10,0x20), Tag(0x20,0xd), Tag(0x20,0xe), Tag(0x4,0x1511) };
+const char * const KeyNames[NUMBER_OF_LEVELS] = {
+  "Patient ID", "Study Instance UID", "Series Instance UID", "SOP Instance UID" };
+const char * const RecordTypes[NUMBER_OF_LEVELS] = {
+  "PATIENT", "STUDY", "SERIES", nullptr }; // any type for the lowest level
+
+// Values are compared without their padding
+std::string GetKey(DataSet const &ds, Tag const &t)
+{
+  if( !ds.FindDataElement( t ) ) return "";
+  const ByteValue *bv = ds.GetDataElement( t ).GetByteValue();
+  if( !bv ) return "";
+  return TrimValue( bv->GetPointer(), bv->GetLength() );
+}
+}
+
 class DICOMDIRGeneratorInternal
 {
 public:
-  DICOMDIRGeneratorInternal():F(new File) {}
+  DICOMDIRGeneratorInternal():F(new File),HasFileSetID(false),Append(false) {}
   SmartPointer<File> F;
   using FilenamesType = Directory::FilenamesType;
   FilenamesType fns;
   using FilenameType = Directory::FilenameType;
   FilenameType rootdir;
   Scanner scanner;
-  std::vector<uint32_t> OffsetTable;
   std::string FileSetID;
-};
+  bool HasFileSetID; // SetDescriptor was called
+  bool Append;
 
-bool DICOMDIRGenerator::ComputeDirectoryRecordsOffset(const SequenceOfItems *sqi, VL start)
-{
-  SequenceOfItems::SizeType nitems = sqi->GetNumberOfItems();
-  std::vector<uint32_t> &offsets = Internals->OffsetTable;
-  Internals->OffsetTable.resize( nitems + 1 );
-  offsets[0] = start;
-  for(SequenceOfItems::SizeType i = 1; i <= nitems; ++i)
-    {
-    const Item &item = sqi->GetItem(i);
-    offsets[i] = offsets[i-1] + item.GetLength<ExplicitDataElement>();
-    }
-
-//#define MDEBUG
-#ifdef MDEBUG
-  for(unsigned int i = 0; i <= nitems; ++i)
-    {
-    std::cout << "offset #" << i << " -> "<< offsets[i] << std::endl;
-    }
-#endif
-
-  return true;
-}
-
-static const char *GetLowerLevelDirectoryRecord(const char *input)
-{
-  if( !input ) return nullptr;
+  // patient -> study -> series -> image tree
+  std::map<std::string, size_t> Patients;
+  std::vector<DirectoryRecord> Records[NUMBER_OF_LEVELS];
 
-  if( strcmp( input, "PATIENT " ) == 0 )
+  void Clear()
     {
-    return "STUDY ";
+    Patients.clear();
+    for( int level = 0; level < NUMBER_OF_LEVELS; ++level )
+      Records[level].clear();
     }
-  else if( strcmp( input, "STUDY ") == 0 )
-    {
-    return "SERIES";
-    }
-  else if( strcmp( input, "SERIES" ) == 0 )
-    {
-    return "IMAGE ";
-    }
-  else if( strcmp( input, "IMAGE " ) == 0 )
-    {
-    return nullptr;
-    }
-  assert( 0 );
-  //std::cerr << "COULD NOT FIND:" << input << std::endl;
-  return nullptr;
-}
-
+};
 
-DICOMDIRGenerator::MyPair DICOMDIRGenerator::GetReferenceValueForDirectoryType(size_t itemidx)
-{
-  /*
-   * PS 3.11 - 2008 / D.3.3 Directory Information in DICOMDIR
-   * The Patient ID at the patient level shall be unique for each patient directory record in one File Set.
-  */
-  /*
-   * This function will return the Patient ID when directorytype          == "PATIENT"
-   * This function will return the Study Instance UID when directorytype  == "STUDY"
-   * This function will return the Series Instance UID when directorytype == "SERIES"
-   * This function will return the SOP Instance UID when directorytype    == "IMAGE"
-   */
-  MyPair ret;
-  const SequenceOfItems *sqi = GetDirectoryRecordSequence();
-  const Item &item = sqi->GetItem(itemidx);
-  const DataSet &ds = item.GetNestedDataSet();
+static void InsertDirectoryRecordHeader(DataSet &ds, const char *type)
+{
+  // (0004,1400) up 0                                        #   4, 1 OffsetOfTheNextDirectoryRecord
+  // (0004,1410) US 65535                                    #   2, 1 RecordInUseFlag
+  // (0004,1420) up 502                                      #   4, 1 OffsetOfReferencedLowerLevelDirectoryEntity
+  // (0004,1430) CS [PATIENT]                                #   8, 1 DirectoryRecordType
+  Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
+  ds.Insert( offsetofthenextdirectoryrecord.GetAsDataElement() );
+  Attribute<0x4,0x1410> recordinuseflag = {0xFFFF};
+  ds.Insert( recordinuseflag.GetAsDataElement() );
+  Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
+  ds.Insert( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
   Attribute<0x4,0x1430> directoryrecordtype;
-  directoryrecordtype.Set( ds );
-
-  const char *input = directoryrecordtype.GetValue();
-  assert( input );
-
-  if( strcmp( input, "PATIENT " ) == 0 )
-    {
-    Attribute<0x10,0x20> patientid;
-    patientid.Set( ds );
-    assert( patientid.GetValue() );
-    ret.first = patientid.GetValue();
-    ret.second = patientid.GetTag();
-    }
-  else if( strcmp( input, "STUDY ") == 0 )
-    {
-    Attribute <0x20,0xd> studyuid;
-    studyuid.Set( ds );
-    assert( studyuid.GetValue() );
-    ret.first = studyuid.GetValue();
-    ret.second = studyuid.GetTag();
-    }
-  else if( strcmp( input, "SERIES" ) == 0 )
-    {
-    Attribute <0x20,0xe> seriesuid;
-    seriesuid.Set( ds );
-    assert( seriesuid.GetValue() );
-    ret.first = seriesuid.GetValue();
-    ret.second = seriesuid.GetTag();
-    }
-  else if( strcmp( input, "IMAGE " ) == 0 )
-    {
-    Attribute <0x04,0x1511> sopuid;
-    sopuid.Set( ds );
-    assert( sopuid.GetValue() );
-    ret.first = sopuid.GetValue();
-    ret.second = Tag(0x8,0x18); // watch out !
-    }
-  else
-    {
-    assert( 0 );
-    }
-  return ret;
-}
-
-static Tag GetParentTag(Tag const &t)
-{
-  Tag ret;
-  if( t == Tag(0x8,0x18) )
-    {
-    ret = Tag(0x20,0xe);
-    }
-  else if( t == Tag(0x20,0xe) )
-    {
-    ret = Tag(0x20,0xd);
-    }
-  else if( t == Tag(0x20,0xd) )
-    {
-    ret = Tag(0x10,0x20);
-    }
-  else if( t == Tag(0x10,0x20) )
-    {
-    ret = Tag(0x0,0x0);
-    }
-  else
-    {
-    assert( 0 );
-    }
-  return ret;
-}
-
-bool DICOMDIRGenerator::SeriesBelongToStudy(const char *seriesuid, const char *studyuid)
-{
-  assert( seriesuid );
-  assert( studyuid );
-  const Scanner &scanner = GetScanner();
-
-  Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(Tag(0x20,0xe), seriesuid);
-  Tag tstudyuid(0x20,0xd);
-  bool b = false;
-  if( ttv.find( tstudyuid ) != ttv.end() )
-    {
-    const char *v = ttv.find(tstudyuid)->second;
-    if( v && strcmp(v, studyuid ) == 0 )
-      {
-      b = true;
-      }
-    }
-
-  return b;
-}
-
-bool DICOMDIRGenerator::ImageBelongToSeries(const char *sopuid, const char *seriesuid, Tag const &t1, Tag const &t2)
-{
-  assert( seriesuid );
-  assert( sopuid );
-  const Scanner &scanner = GetScanner();
-
-  Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(t1, sopuid);
-  bool b = false;
-  if( ttv.find( t2 ) != ttv.end() )
-    {
-    const char *v = ttv.find(t2)->second;
-    if( v && strcmp(v, seriesuid) == 0 )
-      {
-      b = true;
-      }
-    }
-
-  return b;
+  directoryrecordtype.SetValue( type );
+  ds.Insert( directoryrecordtype.GetAsDataElement() );
 }
 
-bool DICOMDIRGenerator::ImageBelongToSameSeries(const char *sopuid1, const char *sopuid2, Tag const &t)
-{
-  assert( sopuid1 );
-  assert( sopuid2 );
-  const Scanner &scanner = GetScanner();
-
-  Scanner::TagToValue const &ttv1 = scanner.GetMappingFromTagToValue(t, sopuid1);
-  Scanner::TagToValue const &ttv2 = scanner.GetMappingFromTagToValue(t, sopuid2);
-  Tag tseriesuid = GetParentTag( t );
-  if( tseriesuid == Tag(0x0,0x0) )
-    {
-    // Let's pretend that Patient belong to the same 'root' element:
-    return true;
-    }
-  bool b = false;
-  const char *seriesuid1 = nullptr;
-  if( ttv1.find( tseriesuid ) != ttv1.end() )
-    {
-    seriesuid1 = ttv1.find(tseriesuid)->second;
-    }
-  const char *seriesuid2 = nullptr;
-  if( ttv2.find( tseriesuid ) != ttv2.end() )
-    {
-    seriesuid2 = ttv2.find(tseriesuid)->second;
-    }
-  assert( seriesuid1 );
-  assert( seriesuid2 );
-
-  b = strcmp( seriesuid1, seriesuid2) == 0;
-  return b;
-}
-
-size_t DICOMDIRGenerator::FindLowerLevelDirectoryRecord( size_t item1, const char *directorytype )
-{
-//  return FindNextDirectoryRecord( item1, GetLowerLevelDirectoryRecord( directorytype ) );
-  const char *lowerdirectorytype = GetLowerLevelDirectoryRecord( directorytype );
-  if( !lowerdirectorytype ) return 0;
-
-  const SequenceOfItems *sqi = GetDirectoryRecordSequence();
-  SequenceOfItems::SizeType nitems = sqi->GetNumberOfItems();
-  for(SequenceOfItems::SizeType i = item1 + 1; i <= nitems; ++i)
-    {
-    const Item &item = sqi->GetItem(i);
-    const DataSet &ds = item.GetNestedDataSet();
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.Set( ds );
-
-    // found a match ?
-    if( strcmp( lowerdirectorytype, directoryrecordtype.GetValue() ) == 0 )
-      {
-      // Need to make sure belong to same parent record:
-      MyPair refval1 = GetReferenceValueForDirectoryType(item1);
-      MyPair refval2 = GetReferenceValueForDirectoryType(i);
-      bool b = ImageBelongToSeries(refval2.first.c_str(),
-        refval1.first.c_str(), refval2.second, refval1.second);
-      if( b ) return i;
-      }
-    //assert( strncmp( lowerdirectorytype, directoryrecordtype.GetValue(), strlen( lowerdirectorytype ) ) != 0 );
-    }
-
-  // Not found
-  return 0;
-
-}
-
-/*
- * Finding the next Directory Record type is easy, simply starting from the start and iterating
- * to the end guarantees traversing everything without omitting anyone.
- *
- * TODO: Need to make sure that Series belong to the same Study...
- */
-size_t DICOMDIRGenerator::FindNextDirectoryRecord( size_t item1, const char *directorytype )
-{
-  if( !directorytype ) return 0;
-  const SequenceOfItems *sqi = GetDirectoryRecordSequence();
-  SequenceOfItems::SizeType nitems = sqi->GetNumberOfItems();
-  for(SequenceOfItems::SizeType i = item1 + 1; i <= nitems; ++i)
-    {
-    const Item &item = sqi->GetItem(i);
-    const DataSet &ds = item.GetNestedDataSet();
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.Set( ds );
-
-    // found a match ?
-    if( strcmp( directorytype, directoryrecordtype.GetValue() ) == 0 )
-      {
-      // Need to make sure belong to same parent record:
-      MyPair refval1 = GetReferenceValueForDirectoryType(item1);
-      MyPair refval2 = GetReferenceValueForDirectoryType(i);
-      bool b = ImageBelongToSameSeries(refval1.first.c_str(), refval2.first.c_str(), refval1.second);
-      if( b ) return i;
-      }
-    //assert( strncmp( directorytype, directoryrecordtype.GetValue(), strlen( directorytype ) ) != 0 );
-    }
-
-  // Not found
-  return 0;
-}
-
-bool DICOMDIRGenerator::TraverseDirectoryRecords(VL start )
-{
-  SequenceOfItems *sqi = GetDirectoryRecordSequence();
-
-  ComputeDirectoryRecordsOffset(sqi, start);
-
-  SequenceOfItems::SizeType nitems = sqi->GetNumberOfItems();
-  for(SequenceOfItems::SizeType i = 1; i <= nitems; ++i)
-    {
-    Item &item = sqi->GetItem(i);
-    DataSet &ds = item.GetNestedDataSet();
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.Set( ds );
-    //std::cout << "FOUND DIRECTORY TYPE:" << directoryrecordtype.GetValue() << std::endl;
-    size_t next = FindNextDirectoryRecord( i, directoryrecordtype.GetValue() );
-    if( next )
-      {
-      Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
-      offsetofthenextdirectoryrecord.SetValue( Internals->OffsetTable[ next - 1 ] );
-      ds.Replace( offsetofthenextdirectoryrecord.GetAsDataElement() );
-      }
-    size_t lower = FindLowerLevelDirectoryRecord( i, directoryrecordtype.GetValue() );
-    if( lower )
-      {
-      Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
-      offsetofreferencedlowerleveldirectoryentity.SetValue( Internals->OffsetTable[ lower - 1 ] );
-      ds.Replace( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
-      }
-    }
-  return true;
-}
-
-template<uint16_t Group, uint16_t Element>
-void SingleDataElementInserter(DataSet &ds, Scanner const & scanner)
-{
-  Attribute<Group,Element> patientsname;
-  Scanner::ValuesType patientsnames = scanner.GetValues( patientsname.GetTag() );
-#ifndef NDEBUG
-  const unsigned int npatient = patientsnames.size();
-  assert( npatient == 1 );
-#endif
-
-  Scanner::ValuesType::const_iterator it = patientsnames.begin();
-  patientsname.SetValue( it->c_str() );
-  ds.Insert( patientsname.GetAsDataElement() );
-}
-
-
 /*
   (fffe,e000) na "Directory Record" PATIENT #=8           # u/l, 1 Item
   #  offset=$374
@@ -381,68 +131,22 @@ void SingleDataElementInserter(DataSet &ds, Scanner const & scanner)
     (0010,0040) CS (no value available)                     #   0, 0 PatientsSex
   (fffe,e00d) na "ItemDelimitationItem"                   #   0, 0 ItemDelimitationItem
 */
-bool DICOMDIRGenerator::AddPatientDirectoryRecord()
+static void MakePatientDirectoryRecord(Item &item, Scanner::TagToValue const &ttv)
 {
-  DataSet &rootds = GetFile().GetDataSet();
-  Scanner const & scanner = GetScanner();
+  item.SetVLToUndefined();
+  DataSet &ds = item.GetNestedDataSet();
+  InsertDirectoryRecordHeader( ds, "PATIENT" );
 
   Attribute<0x10,0x20> patientid;
-  Scanner::ValuesType patientids = scanner.GetValues( patientid.GetTag() );
-  //unsigned int npatients = patientids.size();
-
-  const DataElement &de = rootds.GetDataElement( Tag(0x4,0x1220) );
-  //SequenceOfItems * sqi = (SequenceOfItems*)de.GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
+  patientid.SetValue( ttv.find(patientid.GetTag())->second );
+  ds.Insert( patientid.GetAsDataElement() );
 
-  Scanner::ValuesType::const_iterator it = patientids.begin();
-  for( ; it  != patientids.end(); ++it)
+  Attribute<0x10,0x10> patientsname;
+  if( ttv.find( patientsname.GetTag() ) != ttv.end() )
     {
-    Item item;
-    item.SetVLToUndefined();
-    DataSet &ds = item.GetNestedDataSet();
-
-    // (0004,1400) up 0                                        #   4, 1 OffsetOfTheNextDirectoryRecord
-    // (0004,1410) US 65535                                    #   2, 1 RecordInUseFlag
-    // (0004,1420) up 502                                      #   4, 1 OffsetOfReferencedLowerLevelDirectoryEntity
-    // (0004,1430) CS [PATIENT]                                #   8, 1 DirectoryRecordType
-    Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
-    ds.Insert( offsetofthenextdirectoryrecord.GetAsDataElement() );
-    Attribute<0x4,0x1410> recordinuseflag = {0xFFFF};
-    ds.Insert( recordinuseflag.GetAsDataElement() );
-    Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
-    ds.Insert( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.SetValue( "PATIENT" );
-    ds.Insert( directoryrecordtype.GetAsDataElement() );
-    const char *pid = it->c_str();
-    if( ! (pid && *pid) )
-      {
-      const char *fn = scanner.GetFilenameFromTagToValue(patientid.GetTag(), pid);
-      gdcmErrorMacro( "Missing Patient ID from file: " << fn );
-      (void)fn; //warning removal
-      return false;
-      }
-    gdcmAssertAlwaysMacro( pid && *pid );
-    patientid.SetValue( pid );
-    ds.Insert( patientid.GetAsDataElement() );
-
-    Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(patientid.GetTag(), pid);
-    Attribute<0x10,0x10> patientsname;
-    if( ttv.find( patientsname.GetTag() ) != ttv.end() )
-      {
-      patientsname.SetValue( ttv.find(patientsname.GetTag())->second );
-      ds.Insert( patientsname.GetAsDataElement() );
-      }
-
-    //SingleDataElementInserter<0x10,0x10>(ds, scanner);
-    //SingleDataElementInserter<0x10,0x20>(ds, scanner);
-    //SingleDataElementInserter<0x10,0x30>(ds, scanner);
-    //SingleDataElementInserter<0x10,0x40>(ds, scanner);
-
-    sqi->AddItem( item );
+    patientsname.SetValue( ttv.find(patientsname.GetTag())->second );
+    ds.Insert( patientsname.GetAsDataElement() );
     }
-
-  return true;
 }
 
 /*
@@ -460,89 +164,46 @@ bool DICOMDIRGenerator::AddPatientDirectoryRecord()
     (0020,0010) SH [734591762345]                           #  12, 1 StudyID
   (fffe,e00d) na "ItemDelimitationItem"                   #   0, 0 ItemDelimitationItem
 */
-bool DICOMDIRGenerator::AddStudyDirectoryRecord()
+static void MakeStudyDirectoryRecord(Item &item, Scanner::TagToValue const &ttv)
 {
-  DataSet &rootds = GetFile().GetDataSet();
-  Scanner const & scanner = GetScanner();
+  item.SetVLToUndefined();
+  DataSet &ds = item.GetNestedDataSet();
+  InsertDirectoryRecordHeader( ds, "STUDY" );
 
   Attribute<0x20,0xd> studyinstanceuid;
-  Scanner::ValuesType studyinstanceuids = scanner.GetValues( studyinstanceuid.GetTag() );
-
-  const DataElement &de = rootds.GetDataElement( Tag(0x4,0x1220) );
-  //SequenceOfItems * sqi = (SequenceOfItems*)de.GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
+  studyinstanceuid.SetValue( ttv.find(studyinstanceuid.GetTag())->second );
+  ds.Insert( studyinstanceuid.GetAsDataElement() );
 
-  Scanner::ValuesType::const_iterator it = studyinstanceuids.begin();
-  for( ; it  != studyinstanceuids.end(); ++it)
+  Attribute<0x8,0x20> studydate;
+  if( ttv.find( studydate.GetTag() ) != ttv.end() )
     {
-    Item item;
-    item.SetVLToUndefined();
-    DataSet &ds = item.GetNestedDataSet();
-
-    Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
-    ds.Insert( offsetofthenextdirectoryrecord.GetAsDataElement() );
-    Attribute<0x4,0x1410> recordinuseflag = {0xFFFF};
-    ds.Insert( recordinuseflag.GetAsDataElement() );
-    Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
-    ds.Insert( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.SetValue( "STUDY" );
-    ds.Insert( directoryrecordtype.GetAsDataElement() );
-    const char *studyuid = it->c_str();
-    if( ! (studyuid && *studyuid) )
-      {
-      const char *fn = scanner.GetFilenameFromTagToValue(studyinstanceuid.GetTag(), studyuid);
-      gdcmErrorMacro( "Missing Study Instance UID from file: " << fn );
-      (void)fn;//warning removal
-      return false;
-      }
-    gdcmAssertAlwaysMacro( studyuid && *studyuid );
-    studyinstanceuid.SetValue( studyuid );
-    ds.Insert( studyinstanceuid.GetAsDataElement() );
-
-    //SingleDataElementInserter<0x20,0xd>(ds, scanner);
-    //SingleDataElementInserter<0x8,0x20>(ds, scanner);
-    //SingleDataElementInserter<0x8,0x30>(ds, scanner);
-    //SingleDataElementInserter<0x8,0x1030>(ds, scanner);
-    //SingleDataElementInserter<0x8,0x50>(ds, scanner);
-    //SingleDataElementInserter<0x20,0x10>(ds, scanner);
-    Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(studyinstanceuid.GetTag(), studyuid);
-
-    Attribute<0x8,0x20> studydate;
-    if( ttv.find( studydate.GetTag() ) != ttv.end() )
-      {
-      studydate.SetValue( ttv.find(studydate.GetTag())->second );
-      ds.Insert( studydate.GetAsDataElement() );
-      }
-    Attribute<0x8,0x30> studytime;
-    if( ttv.find( studytime.GetTag() ) != ttv.end() )
-      {
-      studytime.SetValue( ttv.find(studytime.GetTag())->second );
-      ds.Insert( studytime.GetAsDataElement() );
-      }
-    Attribute<0x8,0x1030> studydesc;
-    if( ttv.find( studydesc.GetTag() ) != ttv.end() )
-      {
-      studydesc.SetValue( ttv.find(studydesc.GetTag())->second );
-      ds.Insert( studydesc.GetAsDataElement() );
-      }
-    Attribute<0x8,0x50> accessionnumber;
-    if( ttv.find( accessionnumber.GetTag() ) != ttv.end() )
-      {
-      accessionnumber.SetValue( ttv.find(accessionnumber.GetTag())->second );
-      ds.Insert( accessionnumber.GetAsDataElement() );
-      }
-    Attribute<0x20,0x10> studyid;
-    if( ttv.find( studyid.GetTag() ) != ttv.end() )
-      {
-      studyid.SetValue( ttv.find(studyid.GetTag())->second );
-      ds.Insert( studyid.GetAsDataElement() );
-      }
-
-    sqi->AddItem( item );
+    studydate.SetValue( ttv.find(studydate.GetTag())->second );
+    ds.Insert( studydate.GetAsDataElement() );
+    }
+  Attribute<0x8,0x30> studytime;
+  if( ttv.find( studytime.GetTag() ) != ttv.end() )
+    {
+    studytime.SetValue( ttv.find(studytime.GetTag())->second );
+    ds.Insert( studytime.GetAsDataElement() );
+    }
+  Attribute<0x8,0x1030> studydesc;
+  if( ttv.find( studydesc.GetTag() ) != ttv.end() )
+    {
+    studydesc.SetValue( ttv.find(studydesc.GetTag())->second );
+    ds.Insert( studydesc.GetAsDataElement() );
+    }
+  Attribute<0x8,0x50> accessionnumber;
+  if( ttv.find( accessionnumber.GetTag() ) != ttv.end() )
+    {
+    accessionnumber.SetValue( ttv.find(accessionnumber.GetTag())->second );
+    ds.Insert( accessionnumber.GetAsDataElement() );
+    }
+  Attribute<0x20,0x10> studyid;
+  if( ttv.find( studyid.GetTag() ) != ttv.end() )
+    {
+    studyid.SetValue( ttv.find(studyid.GetTag())->second );
+    ds.Insert( studyid.GetAsDataElement() );
     }
-
-  return true;
 }
 
 /*
@@ -561,64 +222,28 @@ bool DICOMDIRGenerator::AddStudyDirectoryRecord()
     (0020,0011) IS [4]                                      #   2, 1 SeriesNumber
   (fffe,e00d) na "ItemDelimitationItem"                   #   0, 0 ItemDelimitationItem
 */
-bool DICOMDIRGenerator::AddSeriesDirectoryRecord()
+static void MakeSeriesDirectoryRecord(Item &item, Scanner::TagToValue const &ttv)
 {
-  DataSet &rootds = GetFile().GetDataSet();
-  Scanner const & scanner = GetScanner();
+  item.SetVLToUndefined();
+  DataSet &ds = item.GetNestedDataSet();
+  InsertDirectoryRecordHeader( ds, "SERIES" );
 
   Attribute<0x20,0xe> seriesinstanceuid;
-  Scanner::ValuesType seriesinstanceuids = scanner.GetValues( seriesinstanceuid.GetTag() );
-
-  const DataElement &de = rootds.GetDataElement( Tag(0x4,0x1220) );
-  //SequenceOfItems * sqi = (SequenceOfItems*)de.GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
+  seriesinstanceuid.SetValue( ttv.find(seriesinstanceuid.GetTag())->second );
+  ds.Insert( seriesinstanceuid.GetAsDataElement() );
 
-  Scanner::ValuesType::const_iterator it = seriesinstanceuids.begin();
-  for( ; it  != seriesinstanceuids.end(); ++it)
+  Attribute<0x8,0x60> modality;
+  if( ttv.find( modality.GetTag() ) != ttv.end() )
     {
-    Item item;
-    item.SetVLToUndefined();
-    DataSet &ds = item.GetNestedDataSet();
-
-    Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
-    ds.Insert( offsetofthenextdirectoryrecord.GetAsDataElement() );
-    Attribute<0x4,0x1410> recordinuseflag = {0xFFFF};
-    ds.Insert( recordinuseflag.GetAsDataElement() );
-    Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
-    ds.Insert( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.SetValue( "SERIES" );
-    ds.Insert( directoryrecordtype.GetAsDataElement() );
-    const char *seriesuid = it->c_str();
-    if( ! (seriesuid && *seriesuid) )
-      {
-      const char *fn = scanner.GetFilenameFromTagToValue(seriesinstanceuid.GetTag(), seriesuid);
-      gdcmErrorMacro( "Missing Study Instance UID from file: " << fn );
-      (void)fn;//warning removal
-      return false;
-      }
-    gdcmAssertAlwaysMacro( seriesuid && *seriesuid );
-    seriesinstanceuid.SetValue( seriesuid );
-    ds.Insert( seriesinstanceuid.GetAsDataElement() );
-
-    Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(seriesinstanceuid.GetTag(), seriesuid);
-    Attribute<0x8,0x60> modality;
-    if( ttv.find( modality.GetTag() ) != ttv.end() )
-      {
-      modality.SetValue( ttv.find(modality.GetTag())->second );
-      ds.Insert( modality.GetAsDataElement() );
-      }
-    Attribute<0x20,0x11> seriesnumber;
-    if( ttv.find( seriesnumber.GetTag() ) != ttv.end() )
-      {
-      seriesnumber.SetValue( atoi(ttv.find(seriesnumber.GetTag())->second) );
-      ds.Insert( seriesnumber.GetAsDataElement() );
-      }
-
-    sqi->AddItem( item );
+    modality.SetValue( ttv.find(modality.GetTag())->second );
+    ds.Insert( modality.GetAsDataElement() );
+    }
+  Attribute<0x20,0x11> seriesnumber;
+  if( ttv.find( seriesnumber.GetTag() ) != ttv.end() )
+    {
+    seriesnumber.SetValue( atoi(ttv.find(seriesnumber.GetTag())->second) );
+    ds.Insert( seriesnumber.GetAsDataElement() );
     }
-
-  return true;
 }
 
 /*
@@ -639,102 +264,342 @@ bool DICOMDIRGenerator::AddSeriesDirectoryRecord()
     (0050,0004) CS (no value available)                     #   0, 0 CalibrationImage
   (fffe,e00d) na "ItemDelimitationItem"                   #   0, 0 ItemDelimitationItem
 */
-bool DICOMDIRGenerator::AddImageDirectoryRecord()
+static void MakeImageDirectoryRecord(Item &item, Scanner::TagToValue const &ttv,
+  const char *fn_str, const char *rd)
 {
-  DataSet &rootds = GetFile().GetDataSet();
-  Scanner const & scanner = GetScanner();
+  item.SetVLToUndefined();
+  DataSet &ds = item.GetNestedDataSet();
+  InsertDirectoryRecordHeader( ds, "IMAGE" );
 
   const Attribute<0x8,0x18> sopinstanceuid = { "" };
-  Scanner::ValuesType sopinstanceuids = scanner.GetValues( sopinstanceuid.GetTag() );
-  //unsigned int ninstance = sopinstanceuids.size();
+  Attribute<0x0004,0x1500> referencedfileid;
+  referencedfileid.SetNumberOfValues( 1 );
+  Filename fn = fn_str;
+  std::string relative = fn.ToWindowsSlashes();
+  std::string::size_type l = relative.find( rd );
+  if( l != std::string::npos )
+    {
+    assert( l == 0 ); // FIXME
+    relative.replace( l, strlen( rd ), "" );
+    fn = relative.c_str() + 1;
+    }
+  referencedfileid.SetValue( fn.ToWindowsSlashes() );
+  ds.Insert( referencedfileid.GetAsDataElement() );
+  Attribute<0x0004,0x1510> referencedsopclassuidinfile;
+  Attribute<0x8,0x16> sopclassuid;
+  if( ttv.find( sopclassuid.GetTag() ) != ttv.end() )
+    {
+    referencedsopclassuidinfile.SetValue( ttv.find(sopclassuid.GetTag())->second );
+    }
+  ds.Insert( referencedsopclassuidinfile.GetAsDataElement() );
+  Attribute<0x0004,0x1511> referencedsopinstanceuidinfile;
+  if( ttv.find( sopinstanceuid.GetTag() ) != ttv.end() )
+    {
+    referencedsopinstanceuidinfile.SetValue( ttv.find(sopinstanceuid.GetTag())->second );
+    }
+  ds.Insert( referencedsopinstanceuidinfile.GetAsDataElement() );
+  Attribute<0x0004,0x1512> referencedtransfersyntaxuidinfile;
+  Attribute<0x2,0x10> transfersyntaxuid;
+  if( ttv.find( transfersyntaxuid.GetTag() ) != ttv.end() )
+    {
+    referencedtransfersyntaxuidinfile.SetValue( ttv.find(transfersyntaxuid.GetTag())->second );
+    }
+  ds.Insert( referencedtransfersyntaxuidinfile.GetAsDataElement() );
 
-  const DataElement &de = rootds.GetDataElement( Tag(0x4,0x1220) );
-  //SequenceOfItems * sqi = (SequenceOfItems*)de.GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
+  Attribute<0x20,0x13> instancenumber = { 0 };
+  if( ttv.find( instancenumber.GetTag() ) != ttv.end() )
+    {
+    instancenumber.SetValue( atoi(ttv.find(instancenumber.GetTag())->second) );
+    }
+  ds.Insert( instancenumber.GetAsDataElement() );
 
-  Scanner::ValuesType::const_iterator it = sopinstanceuids.begin();
+  Attribute<0x8,0x8> imagetype;
+  DataElement de2( imagetype.GetTag() );
+  de2.SetVR( imagetype.GetVR() );
+  if( ttv.find( imagetype.GetTag() ) != ttv.end() )
+    {
+    const char *v = ttv.find(imagetype.GetTag())->second;
+    VL::Type strlenV = (VL::Type)strlen(v);
+    de2.SetByteValue( v, strlenV );
+    }
+  ds.Insert( de2 );
+}
+
+/*
+ * Single pass over the scanned files: each file is added to the
+ * patient -> study -> series -> image tree, the records of the entities seen
+ * for the first time being created from this file.
+ */
+bool DICOMDIRGenerator::AddDirectoryRecords()
+{
+  Scanner const & scanner = GetScanner();
   Filename rootdir = Internals->rootdir.c_str();
-  const char *rd = rootdir.ToWindowsSlashes();
-  size_t strlen_rd = strlen( rd );
-  for( ; it  != sopinstanceuids.end(); ++it)
+  const std::string rd = rootdir.ToWindowsSlashes();
+
+  const Directory::FilenamesType &filenames = scanner.GetFilenames();
+  Directory::FilenamesType::const_iterator file = filenames.begin();
+  for( ; file != filenames.end(); ++file )
     {
-    Item item;
-    item.SetVLToUndefined();
-    DataSet &ds = item.GetNestedDataSet();
+    const char *filename = file->c_str();
+    if( !scanner.IsKey( filename ) ) continue; // could not be read
+    Scanner::TagToValue const &ttv = scanner.GetMapping( filename );
+    if( ttv.find( KeyTags[IMAGE] ) == ttv.end() )
+      {
+      gdcmDebugMacro( "No SOP Instance UID, skipping: " << filename );
+      continue;
+      }
+
+    std::map<std::string, size_t> *children = &Internals->Patients;
+    for( int level = PATIENT; level < NUMBER_OF_LEVELS; ++level )
+      {
+      Scanner::TagToValue::const_iterator value = ttv.find( KeyTags[level] );
+      const std::string key = TrimValue( value != ttv.end() ? value->second : nullptr );
+      if( key.empty() )
+        {
+        gdcmErrorMacro( "Missing " << KeyNames[level] << " from file: " << filename );
+        return false;
+        }
+      std::vector<DirectoryRecord> &records = Internals->Records[level];
+      std::map<std::string, size_t>::const_iterator it = children->find( key );
+      if( it != children->end() )
+        {
+        if( level == IMAGE )
+          {
+          gdcmWarningMacro( "SOP Instance UID " << key << " already in DICOMDIR, skipping: " << filename );
+          break;
+          }
+        children = &records[it->second].Children;
+        continue;
+        }
+      (*children)[key] = records.size();
+      records.push_back( DirectoryRecord() );
+      Item &item = records.back().Record;
+      switch( level )
+        {
+      case PATIENT:
+        MakePatientDirectoryRecord( item, ttv );
+        break;
+      case STUDY:
+        MakeStudyDirectoryRecord( item, ttv );
+        break;
+      case SERIES:
+        MakeSeriesDirectoryRecord( item, ttv );
+        break;
+      default:
+        MakeImageDirectoryRecord( item, ttv, filename, rd.c_str() );
+        }
+      children = &records.back().Children;
+      }
+    }
 
-    Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
-    ds.Insert( offsetofthenextdirectoryrecord.GetAsDataElement() );
+  return true;
+}
+
+// Read back the chain of records starting at offset
+static bool LoadDirectoryRecordChain(DICOMDIRGeneratorInternal &internals,
+  SequenceOfItems const &sqi, std::map<uint32_t, size_t> const &items,
+  uint32_t offset, int level, std::map<std::string, size_t> &children,
+  std::set<uint32_t> &visited)
+{
+  while( offset )
+    {
+    std::map<uint32_t, size_t>::const_iterator it = items.find( offset );
+    if( it == items.end() || !visited.insert( offset ).second )
+      {
+      gdcmErrorMacro( "Invalid Directory Record offset: " << offset );
+      return false;
+      }
+    const Item &item = sqi.GetItem( it->second );
+    const DataSet &ds = item.GetNestedDataSet();
+    Attribute<0x4,0x1400> next = {0};
+    next.SetFromDataSet( ds );
+    Attribute<0x4,0x1420> lower = {0};
+    lower.SetFromDataSet( ds );
+    offset = next.GetValue();
     Attribute<0x4,0x1410> recordinuseflag = {0xFFFF};
-    ds.Insert( recordinuseflag.GetAsDataElement() );
-    Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
-    ds.Insert( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
-    Attribute<0x4,0x1430> directoryrecordtype;
-    directoryrecordtype.SetValue( "IMAGE" );
-    ds.Insert( directoryrecordtype.GetAsDataElement() );
-
-    const char *sopuid = it->c_str();
-    Scanner::TagToValue const &ttv = scanner.GetMappingFromTagToValue(sopinstanceuid.GetTag(), sopuid);
-    Attribute<0x0004,0x1500> referencedfileid;
-    const char *fn_str = scanner.GetFilenameFromTagToValue(sopinstanceuid.GetTag(), sopuid);
-    referencedfileid.SetNumberOfValues( 1 );
-    Filename fn = fn_str;
-    std::string relative = fn.ToWindowsSlashes();
-    std::string::size_type l = relative.find( rd );
-    if( l != std::string::npos )
+    recordinuseflag.SetFromDataSet( ds );
+    if( recordinuseflag.GetValue() == 0 ) continue; // inactive
+
+    const std::string type = GetKey( ds, Tag(0x4,0x1430) );
+    if( RecordTypes[level] ? type != RecordTypes[level] : lower.GetValue() != 0 )
       {
-      assert( l == 0 ); // FIXME
-      relative.replace( l, strlen_rd, "" );
-      fn = relative.c_str() + 1;
+      gdcmErrorMacro( "Unsupported Directory Record: " << type );
+      return false;
       }
-    referencedfileid.SetValue( fn.ToWindowsSlashes() );
-    ds.Insert( referencedfileid.GetAsDataElement() );
-    Attribute<0x0004,0x1510> referencedsopclassuidinfile;
-    Attribute<0x8,0x16> sopclassuid;
-    if( ttv.find( sopclassuid.GetTag() ) != ttv.end() )
+    const std::string key = GetKey( ds, RecordKeyTags[level] );
+    if( key.empty() )
       {
-      referencedsopclassuidinfile.SetValue( ttv.find(sopclassuid.GetTag())->second );
+      gdcmErrorMacro( "Missing " << KeyNames[level] << " in Directory Record" );
+      return false;
       }
-    ds.Insert( referencedsopclassuidinfile.GetAsDataElement() );
-    Attribute<0x0004,0x1511> referencedsopinstanceuidinfile;
-    if( ttv.find( sopinstanceuid.GetTag() ) != ttv.end() )
+    if( children.count( key ) )
+      {
+      gdcmWarningMacro( "Duplicate Directory Record: " << key );
+      continue;
+      }
+    std::vector<DirectoryRecord> &records = internals.Records[level];
+    const size_t idx = records.size();
+    children[key] = idx;
+    records.push_back( DirectoryRecord( item ) );
+    std::map<std::string, size_t> lowerlevel;
+    if( level + 1 < NUMBER_OF_LEVELS
+      && !LoadDirectoryRecordChain( internals, sqi, items, lower.GetValue(),
+        level + 1, lowerlevel, visited ) )
+      {
+      return false;
+      }
+    records[idx].Children.swap( lowerlevel );
+    }
+  return true;
+}
+
+// Offset of the first Directory Record (first item of the Directory Record
+// Sequence) in the DICOMDIR file
+static VL ComputeFirstDirectoryRecordOffset(File const &f)
+{
+  const DataSet &ds = f.GetDataSet();
+  VL fmi_len = f.GetHeader().GetFullLength();
+  VL fmi_len_offset = 0;
+  DataSet::ConstIterator it = ds.Begin();
+  for(; it != ds.End() && it->GetTag() != Tag(0x0004,0x1220); ++it)
+    {
+    const DataElement &detmp = *it;
+    fmi_len_offset += detmp.GetLength<ExplicitDataElement>();
+    }
+  // Now add the partial length for attribute 0004,1220:
+  fmi_len_offset += it->GetTag().GetLength();
+  fmi_len_offset += it->GetVR().GetLength();
+  fmi_len_offset += it->GetVR().GetLength();
+  return fmi_len + fmi_len_offset;
+}
+
+bool DICOMDIRGenerator::LoadDirectoryRecords()
+{
+  const File &f = GetFile();
+  const DataSet &ds = f.GetDataSet();
+  if( !ds.FindDataElement( Tag(0x4,0x1220) ) )
+    {
+    gdcmErrorMacro( "No Directory Record Sequence, not a DICOMDIR" );
+    return false;
+    }
+  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( Tag(0x4,0x1220) ).GetValueAsSQ();
+  if( !sqi ) return true; // empty
+  // Where each item is located in the file
+  std::map<uint32_t, size_t> items;
+  VL offset = ComputeFirstDirectoryRecordOffset( f );
+  for( SequenceOfItems::SizeType i = 1; i <= sqi->GetNumberOfItems(); ++i )
+    {
+    items[offset] = i;
+    offset += sqi->GetItem(i).GetLength<ExplicitDataElement>();
+    }
+  Attribute<0x4,0x1200> offsetofthefirstdirectoryrecordoftherootdirectoryentity = {0};
+  offsetofthefirstdirectoryrecordoftherootdirectoryentity.SetFromDataSet( ds );
+  std::set<uint32_t> visited;
+  return LoadDirectoryRecordChain( *Internals, *sqi, items,
+    offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetValue(),
+    PATIENT, Internals->Patients, visited );
+}
+
+/*
+ * Single pass over the records: they are laid out level by level (all
+ * patients, then all studies...), grouped by parent, and linked together.
+ */
+bool DICOMDIRGenerator::ComputeDirectoryRecordsOffset(VL start)
+{
+  // Layout
+  std::vector<size_t> layout[NUMBER_OF_LEVELS];
+  std::map<std::string, size_t>::const_iterator it = Internals->Patients.begin();
+  for( ; it != Internals->Patients.end(); ++it )
+    layout[PATIENT].push_back( it->second );
+  for( int level = PATIENT; level + 1 < NUMBER_OF_LEVELS; ++level )
+    {
+    for( size_t i = 0; i < layout[level].size(); ++i )
       {
-      referencedsopinstanceuidinfile.SetValue( ttv.find(sopinstanceuid.GetTag())->second );
+      const DirectoryRecord &parent = Internals->Records[level][ layout[level][i] ];
+      for( it = parent.Children.begin(); it != parent.Children.end(); ++it )
+        layout[level+1].push_back( it->second );
       }
-    ds.Insert( referencedsopinstanceuidinfile.GetAsDataElement() );
-    Attribute<0x0004,0x1512> referencedtransfersyntaxuidinfile;
-    Attribute<0x2,0x10> transfersyntaxuid;
-    if( ttv.find( transfersyntaxuid.GetTag() ) != ttv.end() )
+    }
+
+  // Offsets
+  std::vector<uint32_t> offsets[NUMBER_OF_LEVELS];
+  VL offset = start;
+  for( int level = PATIENT; level < NUMBER_OF_LEVELS; ++level )
+    {
+    std::vector<DirectoryRecord> &records = Internals->Records[level];
+    offsets[level].resize( records.size() );
+    for( size_t i = 0; i < layout[level].size(); ++i )
       {
-      referencedtransfersyntaxuidinfile.SetValue( ttv.find(transfersyntaxuid.GetTag())->second );
+      Item &item = records[ layout[level][i] ].Record;
+      item.SetVLToUndefined();
+      offsets[level][ layout[level][i] ] = offset;
+      offset += item.GetLength<ExplicitDataElement>();
       }
-    ds.Insert( referencedtransfersyntaxuidinfile.GetAsDataElement() );
+    }
 
-    Attribute<0x20,0x13> instancenumber = { 0 };
-    if( ttv.find( instancenumber.GetTag() ) != ttv.end() )
+  // Links
+  for( int level = PATIENT; level < NUMBER_OF_LEVELS; ++level )
+    {
+    std::vector<DirectoryRecord> &records = Internals->Records[level];
+    for( size_t i = 0; i < layout[level].size(); ++i )
       {
-      instancenumber.SetValue( atoi(ttv.find(instancenumber.GetTag())->second) );
+      DirectoryRecord &record = records[ layout[level][i] ];
+      DataSet &ds = record.Record.GetNestedDataSet();
+      Attribute<0x4,0x1420> offsetofreferencedlowerleveldirectoryentity = {0};
+      if( !record.Children.empty() )
+        {
+        offsetofreferencedlowerleveldirectoryentity.SetValue(
+          offsets[level+1][ record.Children.begin()->second ] );
+        }
+      ds.Replace( offsetofreferencedlowerleveldirectoryentity.GetAsDataElement() );
       }
-    ds.Insert( instancenumber.GetAsDataElement() );
-
-    Attribute<0x8,0x8> imagetype;
-    //Scanner::ValuesType imagetypes = scanner.GetValues( imagetype.GetTag() );
-    //Scanner::ValuesType::const_iterator it = imagetypes.begin();
-    //assert( imagetypes.size() == 1 );
-    //imagetype.SetNumberOfValues( 1 );
-    //imagetype.SetValue( it->c_str() );
-    //ds.Replace( imagetype.GetAsDataElement() );
-    DataElement de2( imagetype.GetTag() );
-    de2.SetVR( imagetype.GetVR() );
-    if( ttv.find( imagetype.GetTag() ) != ttv.end() )
+    }
+  std::vector<const std::map<std::string, size_t>*> siblings( 1, &Internals->Patients );
+  for( int level = PATIENT; level < NUMBER_OF_LEVELS; ++level )
+    {
+    std::vector<const std::map<std::string, size_t>*> lowerlevel;
+    for( size_t i = 0; i < siblings.size(); ++i )
       {
-      const char *v = ttv.find(imagetype.GetTag())->second;
-      VL::Type strlenV = (VL::Type)strlen(v);
-      de2.SetByteValue( v, strlenV );
+      for( it = siblings[i]->begin(); it != siblings[i]->end(); ++it )
+        {
+        std::map<std::string, size_t>::const_iterator next = it;
+        ++next;
+        DirectoryRecord &record = Internals->Records[level][it->second];
+        Attribute<0x4,0x1400> offsetofthenextdirectoryrecord = {0};
+        if( next != siblings[i]->end() )
+          {
+          offsetofthenextdirectoryrecord.SetValue( offsets[level][next->second] );
+          }
+        record.Record.GetNestedDataSet().Replace( offsetofthenextdirectoryrecord.GetAsDataElement() );
+        lowerlevel.push_back( &record.Children );
+        }
       }
-    ds.Insert( de2 );
+    siblings.swap( lowerlevel );
+    }
+
+  // Root
+  DataSet &rootds = GetFile().GetDataSet();
+  Attribute<0x4,0x1200> offsetofthefirstdirectoryrecordoftherootdirectoryentity = {0};
+  Attribute<0x4,0x1202> offsetofthelastdirectoryrecordoftherootdirectoryentity = {0};
+  if( !layout[PATIENT].empty() )
+    {
+    offsetofthefirstdirectoryrecordoftherootdirectoryentity.SetValue( offsets[PATIENT][ layout[PATIENT].front() ] );
+    offsetofthelastdirectoryrecordoftherootdirectoryentity.SetValue( offsets[PATIENT][ layout[PATIENT].back() ] );
+    }
+  rootds.Replace( offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
+  rootds.Replace( offsetofthelastdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
 
-    sqi->AddItem( item );
+  SmartPointer<SequenceOfItems> sqi = new SequenceOfItems;
+  for( int level = PATIENT; level < NUMBER_OF_LEVELS; ++level )
+    {
+    for( size_t i = 0; i < layout[level].size(); ++i )
+      sqi->AddItem( Internals->Records[level][ layout[level][i] ].Record );
     }
+  DataElement de_drs( Tag(0x4,0x1220) ); // DirectoryRecordSequence
+  de_drs.SetVR( VR::SQ );
+  de_drs.SetValue( *sqi );
+  de_drs.SetVLToUndefined();
+  rootds.Replace( de_drs );
 
   return true;
 }
@@ -883,9 +748,10 @@ bool DICOMDIRGenerator::Generate()
   Scanner::ValuesType vt = scanner.GetValues( Tag(0x2,0x10) );
   Scanner::ValuesType vtref;
   vtref.insert( TransferSyntax::GetTSString( TransferSyntax::ExplicitVRLittleEndian ) );
-  if( vt == vtref )
+  if( vt == vtref || ( Internals->Append && filenames.empty() ) )
     {
     // All files are ExplicitVRLittleEndian which is required for DICOMDIR
+    // (there is none to check when only rewriting the appended DICOMDIR)
     }
   else
     {
@@ -893,13 +759,32 @@ bool DICOMDIRGenerator::Generate()
     return false;
     }
 
+  Internals->Clear();
+  if( Internals->Append && !LoadDirectoryRecords() )
+    {
+    return false;
+    }
+  if( !AddDirectoryRecords() )
+    {
+    return false;
+    }
+
   // (0004,1220) SQ (Sequence with undefined length #=8)     # u/l, 1 DirectoryRecordSequence
 
   DataSet &ds = GetFile().GetDataSet();
 
   Attribute<0x4,0x1130> filesetid;
-  filesetid.SetValue( Internals->FileSetID.c_str() );
-  ds.Insert( filesetid.GetAsDataElement() );
+  if( Internals->Append && !Internals->HasFileSetID
+    && ds.FindDataElement( filesetid.GetTag() ) )
+    {
+    // keep the File-set ID of the DICOMDIR appended to
+    filesetid.SetFromDataSet( ds );
+    }
+  else
+    {
+    filesetid.SetValue( Internals->FileSetID.c_str() );
+    ds.Replace( filesetid.GetAsDataElement() );
+    }
 
   CodeString cs = filesetid.GetValue();
   if( !cs.IsValid() )
@@ -909,31 +794,17 @@ bool DICOMDIRGenerator::Generate()
     }
 
   Attribute<0x4,0x1200> offsetofthefirstdirectoryrecordoftherootdirectoryentity = {0};
-  ds.Insert( offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
+  ds.Replace( offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
   Attribute<0x4,0x1202> offsetofthelastdirectoryrecordoftherootdirectoryentity = { 0 };
-  ds.Insert( offsetofthelastdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
+  ds.Replace( offsetofthelastdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
   Attribute<0x4,0x1212> filesetconsistencyflag = {0};
-  ds.Insert( filesetconsistencyflag.GetAsDataElement() );
-
+  ds.Replace( filesetconsistencyflag.GetAsDataElement() );
 
+  // Filled by ComputeDirectoryRecordsOffset
   DataElement de_drs( Tag(0x4,0x1220) ); // DirectoryRecordSequence
-
-  SequenceOfItems * sqi0 = new SequenceOfItems;
   de_drs.SetVR( VR::SQ );
-  de_drs.SetValue( *sqi0 );
   de_drs.SetVLToUndefined();
-
-  ds.Insert( de_drs );
-
-  bool b;
-  b = AddPatientDirectoryRecord();
-  if( !b ) return false;
-  b = AddStudyDirectoryRecord();
-  if( !b ) return false;
-  b = AddSeriesDirectoryRecord();
-  if( !b ) return false;
-  b = AddImageDirectoryRecord();
-  if( !b ) return false;
+  ds.Replace( de_drs );
 
 /*
 The DICOMDIR File shall use the Explicit VR Little Endian Transfer Syntax (UID=1.2.840.10008.1.2.1) to
@@ -952,17 +823,21 @@ the File-set.
   MediaStorage ms = MediaStorage::MediaStorageDirectoryStorage;
   const char* msstr = MediaStorage::GetMSString(ms);
   at1.SetValue( msstr );
-  h.Insert( at1.GetAsDataElement() );
+  h.Replace( at1.GetAsDataElement() );
 
+  // When appending, the File-set UID of the DICOMDIR is kept
   Attribute<0x2,0x3> at2;
-  UIDGenerator uid;
-  const char *mediastoragesopinstanceuid = uid.Generate();
-  if( !UIDGenerator::IsValid( mediastoragesopinstanceuid ) )
+  if( !h.FindDataElement( at2.GetTag() ) || h.GetDataElement( at2.GetTag() ).IsEmpty() )
     {
-    return true;
+    UIDGenerator uid;
+    const char *mediastoragesopinstanceuid = uid.Generate();
+    if( !UIDGenerator::IsValid( mediastoragesopinstanceuid ) )
+      {
+      return true;
+      }
+    at2.SetValue( mediastoragesopinstanceuid );
+    h.Replace( at2.GetAsDataElement() );
     }
-  at2.SetValue( mediastoragesopinstanceuid );
-  h.Insert( at2.GetAsDataElement() );
 
   TransferSyntax ts = TransferSyntax::ExplicitVRLittleEndian;
   h.SetDataSetTransferSyntax( ts );
@@ -973,51 +848,8 @@ the File-set.
 
   /* Very important step it should be the *VERY* last one */
   // We need to compute all offset, which can be only done when all attributes have been inserted.
-  // Let's start with offsetofthefirstdirectoryrecordoftherootdirectoryentity :
   h.FillFromDataSet( ds );
-  VL fmi_len = h.GetFullLength();
-  VL fmi_len_offset = 0;
-{
-  DataSet::ConstIterator it = ds.Begin();
-  for(; it != ds.End() && it->GetTag() != Tag(0x0004,0x1220); ++it)
-    {
-    const DataElement &detmp = *it;
-    fmi_len_offset += detmp.GetLength<ExplicitDataElement>();
-    }
-  // Now add the partial length for attribute 0004,1220:
-  fmi_len_offset += it->GetTag().GetLength();
-  fmi_len_offset += it->GetVR().GetLength();
-  fmi_len_offset += it->GetVR().GetLength();
-}
-  //std::cerr << fmi_len << " and " << fmi_len_offset << std::endl;
-  offsetofthefirstdirectoryrecordoftherootdirectoryentity.SetValue( fmi_len + fmi_len_offset );
-  ds.Replace( offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
-
-  VL fmi_len_offset2 = 0;
-{
-  DataSet::ConstIterator it = ds.Begin();
-  for( ; it != ds.End() && it->GetTag() <= Tag(0x0004,0x1220); ++it)
-    {
-    const DataElement &detmp = *it;
-    fmi_len_offset2 += detmp.GetLength<ExplicitDataElement>();
-    }
-}
-
-{
-  //const DataElement &de_drs = ds.GetDataElement( Tag(0x4,0x1220) ); // DirectoryRecordSequence
-  SmartPointer<SequenceOfItems> sqi = de_drs.GetValueAsSQ();
-  SequenceOfItems::SizeType n = sqi->GetNumberOfItems();
-  const Item &item = sqi->GetItem( n ); // last item
-  VL sub = item.GetLength<ExplicitDataElement>();
-  // Let's subtract item length as well as the item sequence delimiter end (tag + vl => 8)
-  offsetofthelastdirectoryrecordoftherootdirectoryentity.SetValue( fmi_len + fmi_len_offset2 - sub - 8 );
-
-  ds.Replace( offsetofthelastdirectoryrecordoftherootdirectoryentity.GetAsDataElement() );
-
-  TraverseDirectoryRecords(offsetofthefirstdirectoryrecordoftherootdirectoryentity.GetValue() );
-}
-
-  return true;
+  return ComputeDirectoryRecordsOffset( ComputeFirstDirectoryRecordOffset( GetFile() ) );
 }
 
 void DICOMDIRGenerator::SetFile(const File& f)
@@ -1035,15 +867,6 @@ Scanner &DICOMDIRGenerator::GetScanner()
   return Internals->scanner;
 }
 
-SequenceOfItems *DICOMDIRGenerator::GetDirectoryRecordSequence()
-{
-  DataSet &ds = GetFile().GetDataSet();
-  const DataElement &de = ds.GetDataElement( Tag(0x4,0x1220) );
-  //SequenceOfItems * sqi = (SequenceOfItems*)de.GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = de.GetValueAsSQ();
-  return sqi;
-}
-
 const char *DICOMDIRGenerator::ComputeFileID(const char *input)
 {
   assert( 0 ); (void)input;
@@ -1053,6 +876,17 @@ const char *DICOMDIRGenerator::ComputeFileID(const char *input)
 void DICOMDIRGenerator::SetDescriptor( const char *d )
 {
   Internals->FileSetID = d;
+  Internals->HasFileSetID = true;
+}
+
+void DICOMDIRGenerator::SetAppend( bool append )
+{
+  Internals->Append = append;
+}
+
+bool DICOMDIRGenerator::GetAppend() const
+{
+  return Internals->Append;
 }
 
 } // end namespace gdcm
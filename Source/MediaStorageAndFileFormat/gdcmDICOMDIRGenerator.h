@@ -16,13 +16,11 @@
 
 #include "gdcmDirectory.h"
 #include "gdcmTag.h"
-#include <utility> // std::pair
 
 namespace gdcm
 {
 class File;
 class Scanner;
-class SequenceOfItems;
 class VL;
 class DICOMDIRGeneratorInternal;
 
@@ -48,6 +46,12 @@ class DICOMDIRGeneratorInternal;
  * - Input files should be Explicit VR Little Endian
  * - filenames should be valid VR::CS value (16 bytes, upper case ...)
  *
+ * \note
+ * Files are grouped by Patient ID, Study Instance UID and Series Instance UID
+ * in a single pass, the records of each level are then written one after the
+ * other (all patients, then all studies...). Files without SOP Instance UID
+ * are skipped.
+ *
  * \bug:
  * There is a current limitation of not handling Referenced SOP Class UID /
  * Referenced SOP Instance UID simply because the Scanner does not allow us
@@ -67,10 +71,18 @@ public:
   /// Set the root directory from which the filenames should be considered.
   void SetRootDirectory( FilenameType const & root );
 
-  /// Set the File Set ID.
+  /// Set the File Set ID. In append mode (see SetAppend), the File Set ID of
+  /// the DICOMDIR is kept unless one is set.
   /// \warning this need to be a valid VR::CS value
   void SetDescriptor( const char *d );
 
+  /// Add the files to the DICOMDIR set with SetFile() (eg. read with Reader)
+  /// instead of creating a new one. The records already there are kept as is,
+  /// the files they reference are not read again. Files whose SOP Instance UID
+  /// is already referenced are skipped.
+  void SetAppend( bool append );
+  bool GetAppend() const;
+
   /// Main function to generate the DICOMDIR
   bool Generate();
 
@@ -80,23 +92,12 @@ public:
 
 protected:
   Scanner &GetScanner();
-  bool AddPatientDirectoryRecord();
-  bool AddStudyDirectoryRecord();
-  bool AddSeriesDirectoryRecord();
-  bool AddImageDirectoryRecord();
+  bool AddDirectoryRecords();
+  bool LoadDirectoryRecords();
 
 private:
   const char *ComputeFileID(const char *);
-  bool TraverseDirectoryRecords(VL start );
-  bool ComputeDirectoryRecordsOffset(const SequenceOfItems *sqi, VL start);
-  size_t FindNextDirectoryRecord( size_t item1, const char *directorytype );
-  SequenceOfItems *GetDirectoryRecordSequence();
-  size_t FindLowerLevelDirectoryRecord( size_t item1, const char *directorytype );
-  typedef std::pair< std::string, Tag> MyPair;
-  MyPair GetReferenceValueForDirectoryType(size_t item);
-  bool SeriesBelongToStudy(const char *seriesuid, const char *studyuid);
-  bool ImageBelongToSeries(const char *sopuid, const char *seriesuid, Tag const &t1, Tag const &t2);
-  bool ImageBelongToSameSeries(const char *sopuid, const char *seriesuid, Tag const &t);
+  bool ComputeDirectoryRecordsOffset(VL start);
 
   DICOMDIRGeneratorInternal * Internals;
 };
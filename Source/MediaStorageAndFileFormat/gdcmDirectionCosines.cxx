@@ -12,9 +12,10 @@
 
 =========================================================================*/
 #include "gdcmDirectionCosines.h"
+#include "gdcmASCIINumber.h"
 
 #include <cmath> // fabs
-#include <cstdio> // sscanf
+#include <cstring> // strlen
 #include <limits>
 
 namespace gdcm
@@ -145,8 +146,16 @@ bool DirectionCosines::SetFromString(const char *str)
 {
   if( str )
     {
-    const int n = sscanf( str, R"(%lf\%lf\%lf\%lf\%lf\%lf)",
-      Values, Values+1, Values+2, Values+3, Values+4, Values+5 );
+    // Same as sscanf( str, "%lf\\%lf\\%lf\\%lf\\%lf\\%lf" ), without the locale
+    const char *p = str;
+    const char *end = str + strlen(str);
+    int n = 0;
+    while( n < 6 && (p = ASCIINumber::Parse( p, end, Values[n] )) != nullptr )
+      {
+      ++n;
+      if( n == 6 || p == end || *p != '\\' ) break;
+      ++p;
+      }
     if( n == 6 )
       {
       return true;
@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmDummyValueMap.h"
+#include "gdcmDummyValueGenerator.h"
+#include "gdcmUIDGenerator.h"
+#include "gdcmSystem.h"
+#include "gdcmTrace.h"
+#include "gdcmTextFields.h"
+
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+
+namespace gdcm
+{
+
+class DummyValueMapInternals
+{
+public:
+  typedef std::pair< Tag, std::string > TagValueKey;
+  std::map< std::string, std::string > UIDs;
+  std::map< TagValueKey, std::string > Values;
+  mutable std::mutex Lock;
+};
+
+namespace
+{
+const char UIDKey[] = "UID";
+}
+
+DummyValueMap::DummyValueMap():Internals(new DummyValueMapInternals)
+{
+}
+
+DummyValueMap::~DummyValueMap()
+{
+  delete Internals;
+}
+
+std::string DummyValueMap::GetDummyUID(std::string const &uid)
+{
+  const std::string key = TrimValue( uid.data(), uid.size() );
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  std::string &dummy = Internals->UIDs[ key ];
+  if( dummy.empty() )
+    {
+    UIDGenerator uidgen;
+    dummy = uidgen.Generate();
+    }
+  return dummy;
+}
+
+std::string DummyValueMap::GetDummyValue(Tag const &t, std::string const &value)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  DummyValueMapInternals::TagValueKey tvk( t, value );
+  std::map< DummyValueMapInternals::TagValueKey, std::string >::iterator it =
+    Internals->Values.find( tvk );
+  if( it == Internals->Values.end() )
+    {
+    // DummyValueGenerator uses a static buffer, only call it with the lock
+    const char *ret = DummyValueGenerator::Generate( value.c_str() );
+    it = Internals->Values.insert( std::make_pair( tvk, ret ? ret : "" ) ).first;
+    }
+  return it->second;
+}
+
+size_t DummyValueMap::GetNumberOfUIDs() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->UIDs.size();
+}
+
+size_t DummyValueMap::GetNumberOfValues() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->Values.size();
+}
+
+void DummyValueMap::Clear()
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->UIDs.clear();
+  Internals->Values.clear();
+}
+
+bool DummyValueMap::Read(const char *filename)
+{
+  std::ifstream is( filename, std::ios::binary );
+  if( !is )
+    {
+    gdcmErrorMacro( "Could not open: " << filename );
+    return false;
+    }
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  std::string line, key, original, dummy;
+  unsigned int lineno = 0;
+  while( std::getline( is, line ) )
+    {
+    ++lineno;
+    if( !line.empty() && line[line.size()-1] == '\r' ) line.resize( line.size() - 1 );
+    if( line.empty() || line[0] == '#' ) continue;
+    std::string::size_type pos = 0;
+    if( !ReadTextField( line, pos, key ) || !ReadTextField( line, pos, original )
+      || !ReadTextField( line, pos, dummy ) || pos != line.size() )
+      {
+      gdcmErrorMacro( "Invalid line " << lineno << " in: " << filename );
+      return false;
+      }
+    if( key == UIDKey )
+      {
+      if( !UIDGenerator::IsValid( dummy.c_str() ) )
+        {
+        gdcmErrorMacro( "Invalid UID at line " << lineno << " in: " << filename );
+        return false;
+        }
+      Internals->UIDs.insert( std::make_pair( original, dummy ) );
+      }
+    else
+      {
+      Tag t;
+      if( !t.ReadFromCommaSeparatedString( key.c_str() ) )
+        {
+        gdcmErrorMacro( "Invalid tag at line " << lineno << " in: " << filename );
+        return false;
+        }
+      Internals->Values.insert( std::make_pair(
+          DummyValueMapInternals::TagValueKey( t, original ), dummy ) );
+      }
+    }
+  return is.eof();
+}
+
+bool DummyValueMap::Write(const char *filename) const
+{
+  const std::string tmpfilename = std::string( filename ) + ".tmp";
+    {
+    std::ofstream os( tmpfilename.c_str(), std::ios::binary );
+    if( !os )
+      {
+      gdcmErrorMacro( "Could not create: " << tmpfilename );
+      return false;
+      }
+    std::lock_guard<std::mutex> lock( Internals->Lock );
+    os << "# GDCM dummy value map\n";
+    for( std::map< std::string, std::string >::const_iterator it = Internals->UIDs.begin();
+      it != Internals->UIDs.end(); ++it )
+      {
+      os << UIDKey << '\t';
+      WriteTextField( os, it->first );
+      os << '\t';
+      WriteTextField( os, it->second );
+      os << '\n';
+      }
+    for( std::map< DummyValueMapInternals::TagValueKey, std::string >::const_iterator it =
+      Internals->Values.begin(); it != Internals->Values.end(); ++it )
+      {
+      const Tag &t = it->first.first;
+      os << std::hex << std::setw(4) << std::setfill('0') << t.GetGroup() << ','
+        << std::setw(4) << std::setfill('0') << t.GetElement() << std::dec << '\t';
+      WriteTextField( os, it->first.second );
+      os << '\t';
+      WriteTextField( os, it->second );
+      os << '\n';
+      }
+    os.close();
+    if( os.fail() )
+      {
+      gdcmErrorMacro( "Could not write: " << tmpfilename );
+      System::RemoveFile( tmpfilename.c_str() );
+      return false;
+      }
+    }
+  if( !System::RenameFile( tmpfilename.c_str(), filename ) )
+    {
+    gdcmErrorMacro( "Could not rename " << tmpfilename << " to: " << filename );
+    return false;
+    }
+  return true;
+}
+
+} // end namespace gdcm
@@ -0,0 +1,86 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMDUMMYVALUEMAP_H
+#define GDCMDUMMYVALUEMAP_H
+
+#include "gdcmTag.h"
+
+#include <string>
+
+namespace gdcm
+{
+
+class DummyValueMapInternals;
+
+/**
+ * \brief DummyValueMap
+ * \details Memory of the dummy values used by the Anonymizer when
+ * de-identifying: each UID is always replaced by the same generated UID, and
+ * the value of each Type 1 attribute by the same dummy value, so that
+ * relations between de-identified files (Study, Series...) are kept.
+ *
+ * All functions are thread safe, a single DummyValueMap can be shared by
+ * Anonymizer instances running in parallel.
+ *
+ * The mapping can be saved to a file (Write) and loaded back (Read), so that
+ * files de-identified in separate runs get consistent dummy values. The file
+ * is a text file with one mapping per line:
+ * \code
+ * UID<tab>original UID<tab>generated UID
+ * gggg,eeee<tab>original value<tab>dummy value
+ * \endcode
+ *
+ * \warning the file maps generated UIDs back to the original ones, it must be
+ * protected just like the original data.
+ *
+ * \see Anonymizer
+ */
+class GDCM_EXPORT DummyValueMap
+{
+public:
+  DummyValueMap();
+  ~DummyValueMap();
+  DummyValueMap(const DummyValueMap&) = delete;
+  void operator=(const DummyValueMap&) = delete;
+
+  /// Return the UID replacing uid, a new one is generated the first time.
+  /// Trailing padding of uid is ignored.
+  std::string GetDummyUID(std::string const &uid);
+
+  /// Return the dummy value replacing value for Tag t, a new one is
+  /// generated (see DummyValueGenerator) the first time.
+  std::string GetDummyValue(Tag const &t, std::string const &value);
+
+  /// Number of UIDs / values known
+  size_t GetNumberOfUIDs() const;
+  size_t GetNumberOfValues() const;
+
+  /// Forget all mappings
+  void Clear();
+
+  /// Load mappings from filename, in addition to the ones already known.
+  /// Mappings already known are kept when filename has another value.
+  bool Read(const char *filename);
+
+  /// Save all mappings to filename. The file is replaced only once it has
+  /// been fully written.
+  bool Write(const char *filename) const;
+
+private:
+  DummyValueMapInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMDUMMYVALUEMAP_H
@@ -16,6 +16,7 @@
 #include "gdcmReader.h"
 
 #include <fstream>
+#include <sstream>
 #include <set>
 #include <vector>
 #include <map>
@@ -69,11 +70,14 @@ public:
   std::map<Tag, std::string> ReplaceTags;
   TransferSyntax TS;
   std::vector<PositionEmpty> PositionEmptyArray;
+  bool InPlace;
+  Tag PaddingTag;
 };
 
 FileAnonymizer::FileAnonymizer()
 {
   Internals = new FileAnonymizerInternals;
+  Internals->InPlace = false;
 }
 
 FileAnonymizer::~FileAnonymizer()
@@ -127,6 +131,26 @@ void FileAnonymizer::SetOutputFileName(const char *filename_native)
     Internals->OutputFilename = filename_native;
 }
 
+void FileAnonymizer::SetInPlace(bool inplace)
+{
+  Internals->InPlace = inplace;
+}
+
+bool FileAnonymizer::GetInPlace() const
+{
+  return Internals->InPlace;
+}
+
+void FileAnonymizer::SetPaddingTag(Tag const &t)
+{
+  Internals->PaddingTag = t;
+}
+
+Tag const &FileAnonymizer::GetPaddingTag() const
+{
+  return Internals->PaddingTag;
+}
+
 // portable way to check for existence (actually: accessibility):
 static inline bool file_exist(const char *filename)
 {
@@ -149,7 +173,8 @@ bool FileAnonymizer::ComputeReplaceTagPosition()
   assert( !Internals->InputFilename.empty() );
   const char *filename = Internals->InputFilename.c_str();
   assert( filename );
-  const bool inplace = file_exist(Internals->OutputFilename.c_str());
+  // strict inplace mode (output file already there)
+  const bool inplace = !Internals->InPlace && file_exist(Internals->OutputFilename.c_str());
 
   std::map<Tag, std::string>::reverse_iterator rit = Internals->ReplaceTags.rbegin();
   for ( ; rit != Internals->ReplaceTags.rend(); rit++ )
@@ -238,7 +263,8 @@ bool FileAnonymizer::ComputeRemoveTagPosition()
   assert( !Internals->InputFilename.empty() );
   const char *filename = Internals->InputFilename.c_str();
   assert( filename );
-  const bool inplace = file_exist(Internals->OutputFilename.c_str());
+  // strict inplace mode (output file already there)
+  const bool inplace = !Internals->InPlace && file_exist(Internals->OutputFilename.c_str());
   if( inplace && !Internals->RemoveTags.empty())
     {
     gdcmErrorMacro( "inplace mode requires existing tag (cannot remove)" );
@@ -323,7 +349,8 @@ bool FileAnonymizer::ComputeEmptyTagPosition()
   assert( !Internals->InputFilename.empty() );
   const char *filename = Internals->InputFilename.c_str();
   assert( filename );
-  const bool inplace = file_exist(Internals->OutputFilename.c_str());
+  // strict inplace mode (output file already there)
+  const bool inplace = !Internals->InPlace && file_exist(Internals->OutputFilename.c_str());
   if( inplace && !Internals->EmptyTags.empty())
     {
     gdcmErrorMacro( "inplace mode requires existing tag (cannot empty)" );
@@ -422,55 +449,58 @@ bool FileAnonymizer::ComputeEmptyTagPosition()
 
   return true;
 }
-bool FileAnonymizer::Write()
+// Copy is, from its current position up to end, into os
+static bool CopyBytes(std::istream &is, std::ostream &os, std::streampos end)
 {
-  if( Internals->OutputFilename.empty() ) return false;
-  const char *outfilename = Internals->OutputFilename.c_str();
-  if( Internals->InputFilename.empty() ) return false;
-  const char *filename = Internals->InputFilename.c_str();
-
-  Internals->PositionEmptyArray.clear();
-
-  // Compute offsets
-  if( !ComputeRemoveTagPosition()
-    || !ComputeEmptyTagPosition()
-    || !ComputeReplaceTagPosition() )
+  std::vector<char> buffer( 64 * 1024 );
+  std::streamoff left = end - is.tellg();
+  while( left > 0 )
     {
-    return false;
+    const std::streamsize n = (std::streamsize)std::min( left, (std::streamoff)buffer.size() );
+    if( !is.read( &buffer[0], n ) ) return false;
+    os.write( &buffer[0], n );
+    left -= n;
     }
+  return !os.fail();
+}
 
-  // Make sure we will copy from lower offset to highest:
-  // need to loop from the end. Sometimes a replace operation will have *exact*
-  // same file offset for multiple attributes. In which case we need to insert
-  // first the last attribute, and at the end the first attribute
-  PositionEmpty pe_sort = {};
-  std::sort (Internals->PositionEmptyArray.begin(),
-    Internals->PositionEmptyArray.end(), pe_sort);
-
-  // Step 2. Copy & skip proper portion
-  std::ios::openmode om;
-  const bool inplace = file_exist(outfilename);
-  if( inplace )
+static bool WriteDataElement(DataElement const &de, TransferSyntax const &ts, std::ostream &os)
+{
+  if( ts.GetSwapCode() == SwapCode::BigEndian )
     {
-    // overwrite:
-    om = std::ofstream::in | std::ofstream::out | std::ios::binary;
+    if( ts.GetNegociatedType() == TransferSyntax::Implicit )
+      {
+      gdcmErrorMacro( "Cannot write Virtual Big Endian" );
+      return false;
+      }
+    de.Write<ExplicitDataElement,SwapperDoOp>( os );
     }
   else
     {
-    // create
-    om = std::ofstream::out | std::ios::binary;
+    if( ts.GetNegociatedType() == TransferSyntax::Implicit )
+      {
+      de.Write<ImplicitDataElement,SwapperNoOp>( os );
+      }
+    else
+      {
+      de.Write<ExplicitDataElement,SwapperNoOp>( os );
+      }
     }
-  std::fstream of( outfilename, om );
-  std::ifstream is( filename, std::ios::binary );
-  std::streampos prev = 0;
-  const TransferSyntax &ts = Internals->TS;
-  std::vector<PositionEmpty>::const_iterator it =
-    Internals->PositionEmptyArray.begin();
-  for( ; it != Internals->PositionEmptyArray.end(); ++it )
+  return true;
+}
+
+// Copy is into of, from its current position up to the last position, and
+// apply each action on the way
+static bool WritePositions(std::vector<PositionEmpty> const &positions,
+  TransferSyntax const &ts, std::istream &is, std::ostream &of)
+{
+  std::vector<PositionEmpty>::const_iterator it = positions.begin();
+  for( ; it != positions.end(); ++it )
     {
     const PositionEmpty & pe = *it;
     Action action = pe.action;
 
+    if( !CopyBytes( is, of, pe.BeginPos ) ) return false;
     if( pe.IsTagFound )
       {
       const DataElement & de = pe.DE;
@@ -480,16 +510,8 @@ bool FileAnonymizer::Write()
         vrlen = 4;
         }
 
-      std::streampos end = pe.BeginPos;
-
-      // FIXME: most efficient way to copy chunk of file in c++ ?
-      for( int i = (int)prev; i < end; ++i)
-        {
-        of.put( (char)is.get() );
-        }
       if( action == EMPTY )
         {
-        assert( !inplace );
         // Create a 0 Value Length (VR+Tag was copied in previous loop)
         for( int i = 0; i < vrlen; ++i)
           {
@@ -498,71 +520,193 @@ bool FileAnonymizer::Write()
         }
       else if( action == REPLACE )
         {
-        if( ts.GetSwapCode() == SwapCode::BigEndian )
-          {
-          if( ts.GetNegociatedType() == TransferSyntax::Implicit )
-            {
-            gdcmErrorMacro( "Cannot write Virtual Big Endian" );
-            return true;
-            }
-          else
-            {
-            pe.DE.Write<ExplicitDataElement,SwapperDoOp>( of );
-            }
-          }
-        else
-          {
-          if( ts.GetNegociatedType() == TransferSyntax::Implicit )
-            {
-            pe.DE.Write<ImplicitDataElement,SwapperNoOp>( of );
-            }
-          else
-            {
-            pe.DE.Write<ExplicitDataElement,SwapperNoOp>( of );
-            }
-          }
+        if( !WriteDataElement( pe.DE, ts, of ) ) return false;
         }
       // Skip the Value
       assert( is.good() );
       is.seekg( pe.EndPos );
       assert( is.good() );
-      prev = is.tellg();
-      assert( prev == pe.EndPos );
       }
     else
       {
-      std::streampos end = pe.BeginPos;
+      if( !WriteDataElement( pe.DE, ts, of ) ) return false;
+      }
+    }
+  return true;
+}
 
-      // FIXME: most efficient way to copy chunk of file in c++ ?
-      for( int i = (int)prev; i < end; ++i)
-        {
-        of.put( (char)is.get() );
-        }
-      if( ts.GetSwapCode() == SwapCode::BigEndian )
-        {
-        if( ts.GetNegociatedType() == TransferSyntax::Implicit )
-          {
-          gdcmErrorMacro( "Cannot write Virtual Big Endian" );
-          return true;
-          }
-        else
-          {
-          pe.DE.Write<ExplicitDataElement,SwapperDoOp>( of );
-          }
-        }
-      else
-        {
-        if( ts.GetNegociatedType() == TransferSyntax::Implicit )
-          {
-          pe.DE.Write<ImplicitDataElement,SwapperNoOp>( of );
-          }
-        else
-          {
-          pe.DE.Write<ExplicitDataElement,SwapperNoOp>( of );
-          }
-        }
-      prev = is.tellg();
+bool FileAnonymizer::WriteInPlace()
+{
+  const char *filename = Internals->InputFilename.c_str();
+  const std::vector<PositionEmpty> &positions = Internals->PositionEmptyArray;
+  if( positions.empty() ) return true;
+  const TransferSyntax &ts = Internals->TS;
+  const std::streampos begin = positions.front().BeginPos;
+  std::streampos end = begin;
+  for( std::vector<PositionEmpty>::const_iterator it = positions.begin();
+    it != positions.end(); ++it )
+    {
+    end = std::max( end, it->EndPos );
+    }
+
+  // Locate the padding. The rewritten region then spans the padding too, and
+  // the modified attributes on each side of it.
+  const Tag &paddingtag = Internals->PaddingTag;
+  const bool haspadding = paddingtag != Tag();
+  DataElement padding( paddingtag );
+  std::streampos paddingbegin = end;
+  std::streampos paddingend = end;
+  if( haspadding )
+    {
+    std::set<Tag> selected;
+    selected.insert( paddingtag );
+    std::ifstream is( filename, std::ios::binary );
+    Reader reader;
+    reader.SetStream( is );
+    if( !reader.ReadSelectedTags( selected ) )
+      {
+      return false;
       }
+    const DataSet &ds = reader.GetFile().GetDataSet();
+    if( !ds.FindDataElement( paddingtag ) )
+      {
+      gdcmErrorMacro( "No padding element: " << paddingtag );
+      return false;
+      }
+    const DataElement &de = ds.GetDataElement( paddingtag );
+    if( de.GetVL().IsUndefined() )
+      {
+      gdcmErrorMacro( "Padding element cannot be a SQ: " << paddingtag );
+      return false;
+      }
+    if( Internals->RemoveTags.count( paddingtag )
+      || Internals->EmptyTags.count( paddingtag )
+      || Internals->ReplaceTags.count( paddingtag ) )
+      {
+      gdcmErrorMacro( "Padding element cannot be modified: " << paddingtag );
+      return false;
+      }
+    padding.SetVR( de.GetVR() );
+    const std::streamoff paddinglen = ts.GetNegociatedType() == TransferSyntax::Implicit
+      ? de.GetLength<ImplicitDataElement>() : de.GetLength<ExplicitDataElement>();
+    if( !is.good() )
+      {
+      // the padding is the last element, the reader may have hit the end of
+      // the file
+      is.clear();
+      is.seekg( 0, std::ios::end );
+      }
+    paddingend = is.tellg();
+    paddingbegin = paddingend - paddinglen;
+    }
+  const std::streampos regionbegin = std::min( begin, paddingbegin );
+  const std::streampos regionend = std::max( end, paddingend );
+
+  // New content of the attributes before and after the padding
+  std::vector<PositionEmpty> before, after;
+  for( std::vector<PositionEmpty>::const_iterator it = positions.begin();
+    it != positions.end(); ++it )
+    {
+    if( it->BeginPos <= paddingbegin ) before.push_back( *it );
+    else after.push_back( *it );
+    }
+  std::ostringstream os1, os2;
+  std::ifstream is( filename, std::ios::binary );
+  is.seekg( regionbegin );
+  if( !WritePositions( before, ts, is, os1 )
+    || !CopyBytes( is, os1, paddingbegin ) )
+    {
+    return false;
+    }
+  is.seekg( paddingend );
+  if( !WritePositions( after, ts, is, os2 )
+    || !CopyBytes( is, os2, regionend ) )
+    {
+    return false;
+    }
+  is.close();
+  const std::streamoff available = regionend - regionbegin;
+  std::string bytes = os1.str();
+  if( haspadding )
+    {
+    const std::streamoff headerlen = ts.GetNegociatedType() == TransferSyntax::Implicit
+      ? 8 : 4 + 2 * padding.GetVR().GetLength();
+    const std::streamoff paddinglen = available
+      - (std::streamoff)(bytes.size() + os2.tellp()) - headerlen;
+    if( paddinglen < 0 || paddinglen % 2
+      || ( headerlen == 8 && ts.GetNegociatedType() == TransferSyntax::Explicit
+        && paddinglen > VL::GetVL16Max() ) )
+      {
+      gdcmErrorMacro( "Not enough space reserved by the padding element: " << paddingtag );
+      return false;
+      }
+    const std::string zeros( (size_t)paddinglen, 0 );
+    padding.SetByteValue( zeros.c_str(), (uint32_t)zeros.size() );
+    if( !WriteDataElement( padding, ts, os1 ) ) return false;
+    bytes = os1.str();
+    }
+  bytes += os2.str();
+  if( (std::streamoff)bytes.size() != available )
+    {
+    gdcmErrorMacro( "In place mode requires a padding element, or same length attributes" );
+    return false;
+    }
+
+  std::fstream of( filename, std::ios::in | std::ios::out | std::ios::binary );
+  of.seekp( regionbegin );
+  of.write( bytes.c_str(), (std::streamsize)bytes.size() );
+  of.close();
+  return !of.fail();
+}
+
+bool FileAnonymizer::Write()
+{
+  if( !Internals->InPlace && Internals->OutputFilename.empty() ) return false;
+  const char *outfilename = Internals->OutputFilename.c_str();
+  if( Internals->InputFilename.empty() ) return false;
+  const char *filename = Internals->InputFilename.c_str();
+
+  Internals->PositionEmptyArray.clear();
+
+  // Compute offsets
+  if( !ComputeRemoveTagPosition()
+    || !ComputeEmptyTagPosition()
+    || !ComputeReplaceTagPosition() )
+    {
+    return false;
+    }
+
+  // Make sure we will copy from lower offset to highest:
+  // need to loop from the end. Sometimes a replace operation will have *exact*
+  // same file offset for multiple attributes. In which case we need to insert
+  // first the last attribute, and at the end the first attribute
+  PositionEmpty pe_sort = {};
+  std::sort (Internals->PositionEmptyArray.begin(),
+    Internals->PositionEmptyArray.end(), pe_sort);
+
+  if( Internals->InPlace )
+    {
+    return WriteInPlace();
+    }
+
+  // Step 2. Copy & skip proper portion
+  std::ios::openmode om;
+  const bool inplace = file_exist(outfilename);
+  if( inplace )
+    {
+    // overwrite:
+    om = std::ofstream::in | std::ofstream::out | std::ios::binary;
+    }
+  else
+    {
+    // create
+    om = std::ofstream::out | std::ios::binary;
+    }
+  std::fstream of( outfilename, om );
+  std::ifstream is( filename, std::ios::binary );
+  if( !WritePositions( Internals->PositionEmptyArray, Internals->TS, is, of ) )
+    {
+    return false;
     }
 
   of << is.rdbuf();
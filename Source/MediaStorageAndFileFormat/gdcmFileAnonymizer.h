@@ -42,7 +42,7 @@ class FileAnonymizerInternals;
  * \li This class does neither recompute nor update the Group Length element,
  * \li This class currently does not update the File Meta Information header.
  * \li Only strict inplace Replace operation is supported when input and output
- *     file are the same.
+ *     file are the same (see SetInPlace() for a real in place mode).
  */
 class GDCM_EXPORT FileAnonymizer : public Subject
 {
@@ -72,6 +72,22 @@ public:
   /// Set output filename
   void SetOutputFileName(const char *filename_native);
 
+  /// Edit the input file itself, the output filename is not used. Only the
+  /// bytes spanning the modified attributes and the padding element (see
+  /// SetPaddingTag()) are rewritten: the rest of the file (eg. the Pixel Data)
+  /// is left untouched on disk. Write() fails, without modifying the file,
+  /// when the modified attributes do not fit.
+  void SetInPlace(bool inplace);
+  bool GetInPlace() const;
+
+  /// Data Element used as reserved space by the in place mode: its value
+  /// shrinks (or grows) by the amount the modified attributes grow (or
+  /// shrink). It is typically a private OB element next to the edited
+  /// attributes, reserved with Replace() when the file is first written out. When
+  /// not set (default), in place edits have to keep the same total length.
+  void SetPaddingTag(Tag const &t);
+  Tag const &GetPaddingTag() const;
+
   /// Write the output file
   bool Write();
 
@@ -79,6 +95,7 @@ private:
   bool ComputeEmptyTagPosition();
   bool ComputeRemoveTagPosition();
   bool ComputeReplaceTagPosition();
+  bool WriteInPlace();
   FileAnonymizerInternals *Internals;
 };
 
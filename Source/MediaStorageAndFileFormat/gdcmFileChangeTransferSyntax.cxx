@@ -28,6 +28,13 @@
 #include "gdcmAttribute.h"
 #include "gdcmFileDerivation.h"
 #include "gdcmFileAnonymizer.h"
+#include "gdcmFrameIndex.h"
+#include "gdcmImageChangePlanarConfiguration.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmParallelFor.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace gdcm
 {
@@ -41,8 +48,13 @@ public:
   ~FileChangeTransferSyntaxInternals()
     {
     delete IC;
+    delete Decoder;
     }
   ImageCodec *IC{nullptr};
+  // Decoder of the encapsulated input, only used as a template for the
+  // per-thread decoders
+  ImageCodec *Decoder{nullptr};
+  FrameIndex Index;
   bool InitializeCopy{false};
   std::streampos PixelDataPos;
   std::string InFilename;
@@ -50,12 +62,212 @@ public:
   TransferSyntax TS;
   std::vector<unsigned int> Dims;
   PixelFormat PF;
+  // of the decoded frames
   PhotometricInterpretation PI;
   unsigned int PC;
+  // decoded frames are planar, but the encoder wants interleaved samples
+  bool Interleave{false};
   bool Needbyteswap;
+  bool UseExtendedOffsetTable{false};
+  // position of the values of (7FE0,0001) and (7FE0,0002) in the output
+  std::streampos ExtendedOffsetTablePos;
+  std::streampos ExtendedOffsetTableLengthsPos;
+  unsigned int NumberOfThreads{0};
+  size_t MaximumMemory{256 * 1024 * 1024};
   double Progress;
 };
 
+namespace
+{
+// One frame going through the pipeline
+struct FrameJob
+{
+  // frame as read from the input, replaced by the decoded frame
+  std::vector<char> Frame;
+  std::string Encoded;
+  bool OK;
+};
+
+// In-memory output of one encoded frame. Unlike std::stringbuf, seeking past
+// the end is allowed, as with a file (the RLE encoder fills its segments
+// this way)
+class FrameStreamBuf : public std::streambuf
+{
+public:
+  std::string Data;
+
+protected:
+  std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+    if( Pos + (size_t)n > Data.size() ) Data.resize( Pos + (size_t)n );
+    memcpy( &Data[Pos], s, (size_t)n );
+    Pos += (size_t)n;
+    return n;
+    }
+  int_type overflow(int_type c) override
+    {
+    if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+      {
+      const char ch = traits_type::to_char_type( c );
+      xsputn( &ch, 1 );
+      }
+    return traits_type::not_eof( c );
+    }
+  pos_type seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode) override
+    {
+    const off_type base = dir == std::ios::beg ? 0
+      : (dir == std::ios::cur ? (off_type)Pos : (off_type)Data.size());
+    if( base + off < 0 ) return pos_type(off_type(-1));
+    Pos = (size_t)(base + off);
+    return pos_type((off_type)Pos);
+    }
+  pos_type seekpos(pos_type pos, std::ios::openmode which) override
+    {
+    return seekoff( off_type(pos), std::ios::beg, which );
+    }
+
+private:
+  size_t Pos{0};
+};
+
+// Own the per-thread codecs
+struct CodecList
+{
+  ~CodecList()
+    {
+    for( size_t i = 0; i < Codecs.size(); ++i ) delete Codecs[i];
+    }
+  std::vector<ImageCodec*> Codecs;
+};
+}
+
+static bool IsUncompressedOutput(TransferSyntax const &ts)
+{
+  return ts == TransferSyntax::ImplicitVRLittleEndian
+    || ts == TransferSyntax::ExplicitVRLittleEndian;
+}
+
+static ImageCodec *CreateDecoder(TransferSyntax const &ts)
+{
+  JPEGCodec jpeg;
+  JPEGLSCodec jpegls;
+  JPEG2000Codec jpeg2000;
+  RLECodec rle;
+
+  ImageCodec *codecs[] = {
+    &jpeg,
+    &jpegls,
+    &jpeg2000,
+    &rle
+  };
+  const int n = sizeof( codecs ) / sizeof( codecs[0] );
+  for( int i = 0; i < n; ++i )
+    {
+    if( codecs[i]->CanDecode( ts ) )
+      {
+      return codecs[i]->Clone();
+      }
+    }
+  return nullptr;
+}
+
+// Clone of the decoder template, ready to decode one frame
+static ImageCodec *CloneDecoder(ImageCodec const &decoder, size_t framelen)
+{
+  ImageCodec *codec = decoder.Clone();
+  codec->SetPixelFormat( decoder.GetPixelFormat() );
+  // not part of ImageCodec, thus not copied by Clone
+  if( RLECodec *rle = dynamic_cast<RLECodec*>(codec) )
+    rle->SetBufferLength( (unsigned long)framelen );
+  else if( JPEGLSCodec *jpegls = dynamic_cast<JPEGLSCodec*>(codec) )
+    jpegls->SetBufferLength( (unsigned long)framelen );
+  return codec;
+}
+
+// Decode a single frame (all its fragments concatenated)
+static bool DecodeFrame(ImageCodec &codec, std::vector<char> &frame, size_t framelen)
+{
+  SmartPointer<SequenceOfFragments> sq = new SequenceOfFragments;
+  Fragment frag;
+  frag.SetByteValue( frame.data(), (uint32_t)frame.size() );
+  sq->AddFragment( frag );
+  DataElement in( Tag(0x7fe0,0x0010) );
+  in.SetValue( *sq );
+  in.SetVLToUndefined();
+  DataElement out;
+  if( !codec.Decode( in, out ) ) return false;
+  const ByteValue *bv = out.GetByteValue();
+  if( !bv || bv->GetLength() < framelen ) return false;
+  frame.assign( bv->GetPointer(), bv->GetPointer() + framelen );
+  return true;
+}
+
+// Planar (RRR...GGG...BBB...) to interleaved (RGBRGB...)
+static void InterleaveFrame(std::vector<char> &frame, unsigned int bytespersample)
+{
+  const std::vector<char> planes( frame );
+  const size_t n = frame.size() / (3 * bytespersample);
+  if( bytespersample == 1 )
+    {
+    const uint8_t *p = (const uint8_t*)planes.data();
+    ImageChangePlanarConfiguration::RGBPlanesToRGBPixels(
+      (uint8_t*)frame.data(), p, p + n, p + 2 * n, n );
+    }
+  else
+    {
+    const uint16_t *p = (const uint16_t*)(const void*)planes.data();
+    ImageChangePlanarConfiguration::RGBPlanesToRGBPixels(
+      (uint16_t*)(void*)frame.data(), p, p + n, p + 2 * n, n );
+    }
+}
+
+// Fill the offset tables reserved in front of the fragments
+// Find the position of the value of data element t in filename
+static bool FindValuePosition(const char *filename, Tag const &t, std::streampos &pos)
+{
+  Reader reader;
+  reader.SetFileName( filename );
+  std::set<Tag> skiptags;
+  skiptags.insert( Tag(0x7fe0,0x0001) );
+  skiptags.insert( Tag(0x7fe0,0x0002) );
+  // t being skipped, the stream is left at the beginning of its value. Any
+  // other element read was not skipped: t is missing.
+  if( !reader.ReadUpToTag( t, skiptags ) ) return false;
+  const DataSet &ds = reader.GetFile().GetDataSet();
+  if( !ds.IsEmpty() && t <= ds.GetDES().rbegin()->GetTag() ) return false;
+  pos = (std::streampos)reader.GetStreamCurrentPosition();
+  return true;
+}
+
+static bool WriteOffsetTables(std::fstream &os, bool useeot,
+  std::streampos offsetspos, std::streampos lengthspos, std::streampos firstfragpos,
+  std::vector<uint64_t> &offsets, std::vector<uint64_t> &lengths)
+{
+  const size_t nframes = offsets.size();
+  if( nframes < 2 ) return true;
+  if( useeot )
+    {
+    const std::streamoff valuelen = (std::streamoff)(nframes * sizeof(uint64_t));
+    SwapperNoOp::SwapArray( &offsets[0], nframes );
+    SwapperNoOp::SwapArray( &lengths[0], nframes );
+    os.seekp( offsetspos, std::ios::beg );
+    os.write( (char*)&offsets[0], valuelen );
+    os.seekp( lengthspos, std::ios::beg );
+    os.write( (char*)&lengths[0], valuelen );
+    }
+  else
+    {
+    if( offsets.back() > 0xFFFFFFFF ) return false;
+    std::vector<uint32_t> table( offsets.begin(), offsets.end() );
+    SwapperNoOp::SwapArray( &table[0], nframes );
+    // Basic Offset Table value is right before the first fragment
+    os.seekp( (std::streamoff)firstfragpos - (std::streamoff)(nframes * sizeof(uint32_t)), std::ios::beg );
+    os.write( (char*)&table[0], nframes * sizeof(uint32_t) );
+    }
+  os.seekp( 0, std::ios::end );
+  return !os.fail();
+}
+
 FileChangeTransferSyntax::FileChangeTransferSyntax()
 {
   Internals = new FileChangeTransferSyntaxInternals;
@@ -85,18 +297,25 @@ bool FileChangeTransferSyntax::Change()
   const std::vector<unsigned int> & dims = Internals->Dims;
   const PixelFormat &pf = Internals->PF;
   const PhotometricInterpretation &pi = Internals->PI;
-  unsigned int pc = Internals->PC;
+  const bool interleave = Internals->Interleave;
+  unsigned int pc = interleave ? 0 : Internals->PC;
   const int pixsize = pf.GetPixelSize();
+  const size_t rowlen = (size_t)dims[0] * pixsize;
+  const size_t framelen = rowlen * dims[1];
+  const unsigned int nframes = dims[2];
 
   const bool needbyteswap = Internals->Needbyteswap;
   ImageCodec *codec = Internals->IC;
-  codec->SetDimensions( dims );
-  codec->SetNumberOfDimensions( 2 );
-  codec->SetPlanarConfiguration( pc );
-  codec->SetPhotometricInterpretation( pi );
-  codec->SetNeedByteSwap( needbyteswap );
-  codec->SetNeedOverlayCleanup( pf.GetBitsAllocated() != pf.GetBitsStored() );
-  codec->SetPixelFormat( pf ); // need to be last !
+  if( codec )
+    {
+    codec->SetDimensions( dims );
+    codec->SetNumberOfDimensions( 2 );
+    codec->SetPlanarConfiguration( pc );
+    codec->SetPhotometricInterpretation( pi );
+    codec->SetNeedByteSwap( needbyteswap );
+    codec->SetNeedOverlayCleanup( pf.GetBitsAllocated() != pf.GetBitsStored() );
+    codec->SetPixelFormat( pf ); // need to be last !
+    }
 
   VL vl;
   vl.SetToUndefined();
@@ -114,130 +333,199 @@ bool FileChangeTransferSyntax::Change()
   default:
     return false;
     }
+  const uint64_t rawlen = (uint64_t)framelen * nframes;
+  if( !codec )
+    {
+    // uncompressed Pixel Data has a defined (even) length
+    if( rawlen >= 0xFFFFFFFE )
+      {
+      gdcmErrorMacro( "Pixel Data too large for uncompressed transfer syntax" );
+      return false;
+      }
+    de.SetVL( (uint32_t)rawlen );
+    }
   de.GetTag().Write<SwapperNoOp>( os );
-  de.GetVR().Write( os );
+  if( Internals->TS.IsExplicit() )
+    de.GetVR().Write( os );
   de.GetVL().Write<SwapperNoOp>( os );
 
-  Fragment frag;
-  // Basic Offset Table
-  frag.Write<SwapperNoOp>( os );
+  // Basic Offset Table, values are filled once all frames are encoded. It
+  // stays empty when the Extended Offset Table is used instead.
+  const bool usebot = codec && nframes > 1 && !Internals->UseExtendedOffsetTable;
+  BasicOffsetTable bot;
+  if( usebot )
+    {
+    std::vector<uint32_t> zeros( nframes );
+    bot.SetByteValue( (char*)&zeros[0], (uint32_t)(nframes * sizeof(uint32_t)) );
+    }
+  if( codec ) bot.Write<SwapperNoOp>( os );
+  const std::streampos firstfragpos = os.tellp();
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> lengths;
+
+  // Frames are processed in batches: read sequentially, transcoded in
+  // parallel, then written in order. A batch holds at most MaximumMemory
+  // bytes, counting the input, decoded and encoded buffers of each frame.
+  size_t batch = Internals->MaximumMemory / (3 * framelen);
+  batch = std::max( batch, (size_t)1 );
+  batch = std::min( batch, (size_t)nframes );
+  const unsigned int nthreads =
+    ComputeNumberOfThreads( Internals->NumberOfThreads, batch );
+
+  CodecList decoders, encoders;
+  for( unsigned int t = 0; t < nthreads; ++t )
+    {
+    decoders.Codecs.push_back( Internals->Decoder
+      ? CloneDecoder( *Internals->Decoder, framelen ) : nullptr );
+    encoders.Codecs.push_back( codec ? codec->Clone() : nullptr );
+    }
+  std::vector<FrameJob> jobs( batch );
 
   Internals->Progress = 0;
-  bool b = Internals->IC->StartEncode(os);
+  bool b = !codec || codec->StartEncode(os);
   assert( b );
+  const double progresstick = 1. / (double)nframes;
+  const unsigned int bytespersample = pf.GetBitsAllocated() / 8;
   size_t len = 0; // actual size compressed:
-  if( Internals->IC->IsRowEncoder() )
+  // Decode and/or encode one frame. When there is no encoder (uncompressed
+  // output), job.Frame holds the result
+  auto transcodeframe = [&]( ImageCodec *decoder, ImageCodec *encoder, FrameJob &job ) {
+    if( decoder && !DecodeFrame( *decoder, job.Frame, framelen ) ) return false;
+    if( interleave ) InterleaveFrame( job.Frame, bytespersample );
+    if( !encoder ) return true;
+
+    char *data = job.Frame.data();
+    if( !encoder->CleanupUnusedBits( data, framelen ) ) return false;
+    FrameStreamBuf buf;
+    std::ostream fos( &buf );
+    if( encoder->IsRowEncoder() )
+      {
+      for( size_t pos = 0; pos < framelen; pos += rowlen )
+        {
+        if( !encoder->AppendRowEncode( fos, data + pos, rowlen ) ) return false;
+        }
+      }
+    else if( encoder->IsFrameEncoder() )
+      {
+      if( !encoder->AppendFrameEncode( fos, data, framelen ) ) return false;
+      }
+    else
+      {
+      return false;
+      }
+    if( fos.fail() ) return false;
+    job.Encoded.swap( buf.Data );
+    return true;
+  };
+  for( unsigned int z0 = 0; z0 < nframes; z0 += (unsigned int)batch )
     {
-    std::vector<char> vbuffer;
-    vbuffer.resize( dims[0] * pixsize );
-
-    char *data = vbuffer.data();
-    const size_t datalen = vbuffer.size();
-
-    const size_t nscanlines = dims[2] * dims[1];
-    const double progresstick = 1. / (double)nscanlines;
-
-    for( unsigned int z = 0; z < dims[2]; ++z )
+    const size_t n = std::min( batch, (size_t)(nframes - z0) );
+    for( size_t i = 0; i < n; ++i )
       {
-      // frag header:
-      frag.Write<SwapperNoOp>( os );
-      std::streampos start = os.tellp();
-      for( unsigned int y = 0; y < dims[1]; ++y )
+      std::vector<char> &frame = jobs[i].Frame;
+      if( Internals->Decoder )
         {
-        is.read( data, datalen );
-        assert( is.good() );
-        b = Internals->IC->CleanupUnusedBits(data, datalen);
-        if( !b ) return false;
-        b = Internals->IC->AppendRowEncode(os, data, datalen);
-        if( !b ) return false;
-        Internals->Progress += progresstick;
-        ProgressEvent pe;
-        pe.SetProgress( Internals->Progress );
-        this->InvokeEvent( pe );
+        b = Internals->Index.ReadFrame( is, z0 + (unsigned int)i, frame );
         }
-      const std::streampos end = os.tellp();
-
-      // Compute JPEG length:
-      const VL jpegvl = (uint32_t)(end - start);
-      len += jpegvl;
-      start -= 4;
-      if( jpegvl.IsOdd() )
+      else
         {
-        // 0 - padding:
-        os.put( 0 );
+        frame.resize( framelen );
+        b = !!is.read( frame.data(), framelen );
+        }
+      if( !b )
+        {
+        gdcmErrorMacro( "Could not read frame " << z0 + i );
+        return false;
         }
-      os.seekp( start, std::ios::beg );
-      jpegvl.Write<SwapperNoOp>( os );
-      os.seekp( 0, std::ios::end );
       }
-    }
-  else if( Internals->IC->IsFrameEncoder() )
-    {
-    std::vector<char> vbuffer;
-    vbuffer.resize( dims[0] * dims[1] * pixsize );
-
-    char *data = vbuffer.data();
-    const size_t datalen = vbuffer.size();
 
-    const size_t nscanlines = dims[2];
-    const double progresstick = 1. / (double)nscanlines;
+    // Failures are reported below, in frame order, once the whole batch is
+    // processed
+    ParallelFor( n, (unsigned int)std::min( (size_t)nthreads, n ),
+      [&]( size_t i, unsigned int t ) {
+        try
+          {
+          jobs[i].OK = transcodeframe( decoders.Codecs[t], encoders.Codecs[t], jobs[i] );
+          }
+        catch( ... )
+          {
+          jobs[i].OK = false;
+          }
+        return true;
+      } );
 
-    for( unsigned int z = 0; z < dims[2]; ++z )
+    for( size_t i = 0; i < n; ++i )
       {
-      // frag header:
-      frag.Write<SwapperNoOp>( os );
-      std::streampos start = os.tellp();
+      FrameJob &job = jobs[i];
+      if( !job.OK )
         {
-        is.read( data, datalen );
-        assert( is.good() );
-        b = Internals->IC->CleanupUnusedBits(data, datalen);
-        if( !b ) return false;
-        b = Internals->IC->AppendFrameEncode(os, data, datalen);
-        if( !b ) return false;
-        Internals->Progress += progresstick;
-        ProgressEvent pe;
-        pe.SetProgress( Internals->Progress );
-        this->InvokeEvent( pe );
+        gdcmErrorMacro( "Could not transcode frame " << z0 + i );
+        return false;
         }
-      const std::streampos end = os.tellp();
-
-      // Compute JPEG length:
-      const VL jpegvl = (uint32_t)(end - start);
-      len += jpegvl;
-      start -= 4;
-      if( jpegvl.IsOdd() )
+      if( codec )
         {
-        // 0 - padding:
-        os.put( 0 );
+        offsets.push_back( os.tellp() - firstfragpos );
+        // fragment length is rounded up to even, 0 - padding:
+        const VL fragvl = (uint32_t)job.Encoded.size();
+        const Tag itemStart(0xfffe,0xe000);
+        itemStart.Write<SwapperNoOp>( os );
+        fragvl.Write<SwapperNoOp>( os );
+        os.write( job.Encoded.data(), job.Encoded.size() );
+        if( fragvl.IsOdd() ) os.put( 0 );
+        len += fragvl;
+        lengths.push_back( fragvl );
+        std::string().swap( job.Encoded );
         }
-      os.seekp( start, std::ios::beg );
-      jpegvl.Write<SwapperNoOp>( os );
-      os.seekp( 0, std::ios::end );
+      else
+        {
+        os.write( job.Frame.data(), framelen );
+        }
+      Internals->Progress += progresstick;
+      ProgressEvent pe;
+      pe.SetProgress( Internals->Progress );
+      this->InvokeEvent( pe );
+      }
+    if( os.fail() )
+      {
+      gdcmErrorMacro( "Could not write to " << outfilename );
+      return false;
       }
     }
-  else
+
+  if( codec )
     {
-    // dead code ?
-    return false;
-    }
-  b = Internals->IC->StopEncode(os);
-  assert( b );
+    b = codec->StopEncode(os);
+    assert( b );
 
-  const Tag seqDelItem(0xfffe,0xe0dd);
-  seqDelItem.Write<SwapperNoOp>(os);
-  VL zero = 0;
-  zero.Write<SwapperNoOp>(os);
+    const Tag seqDelItem(0xfffe,0xe0dd);
+    seqDelItem.Write<SwapperNoOp>(os);
+    VL zero = 0;
+    zero.Write<SwapperNoOp>(os);
+
+    if( !WriteOffsetTables(os, Internals->UseExtendedOffsetTable,
+        Internals->ExtendedOffsetTablePos, Internals->ExtendedOffsetTableLengthsPos,
+        firstfragpos, offsets, lengths) )
+      {
+      gdcmErrorMacro( "Could not write offset tables" );
+      return false;
+      }
+    }
+  else if( rawlen % 2 )
+    {
+    os.put( 0 );
+    }
 
   is.close();
   os.close();
 
-  size_t reflen = dims[0] * dims[1] * pixsize;
-  double level = (double)reflen / (double)len;
-
-  if( !UpdateCompressionLevel(level) )
+  if( codec )
     {
-    gdcmDebugMacro( "Could not UpdateCompressionLevel" );
-    return false;
+    double level = (double)rawlen / (double)len;
+    if( !UpdateCompressionLevel(level) )
+      {
+      gdcmDebugMacro( "Could not UpdateCompressionLevel" );
+      return false;
+      }
     }
 
   this->InvokeEvent( EndEvent() );
@@ -275,6 +563,7 @@ void FileChangeTransferSyntax::SetTransferSyntax( TransferSyntax const & ts )
 {
   Internals->TS = ts;
   delete Internals->IC;
+  Internals->IC = nullptr;
 
   JPEGCodec jpeg;
   JPEGLSCodec jpegls;
@@ -295,7 +584,7 @@ void FileChangeTransferSyntax::SetTransferSyntax( TransferSyntax const & ts )
       Internals->IC = codecs[i]->Clone();
       }
     }
-  assert( Internals->TS );
+  assert( Internals->IC || IsUncompressedOutput( ts ) );
 }
 
 ImageCodec * FileChangeTransferSyntax::GetCodec()
@@ -303,6 +592,26 @@ ImageCodec * FileChangeTransferSyntax::GetCodec()
   return Internals->IC;
 }
 
+void FileChangeTransferSyntax::SetNumberOfThreads(unsigned int nthreads)
+{
+  Internals->NumberOfThreads = nthreads;
+}
+
+unsigned int FileChangeTransferSyntax::GetNumberOfThreads() const
+{
+  return Internals->NumberOfThreads;
+}
+
+void FileChangeTransferSyntax::SetMaximumMemory(size_t bytes)
+{
+  Internals->MaximumMemory = bytes;
+}
+
+size_t FileChangeTransferSyntax::GetMaximumMemory() const
+{
+  return Internals->MaximumMemory;
+}
+
 void FileChangeTransferSyntax::SetInputFileName(const char *filename_native)
 {
   if( filename_native )
@@ -315,9 +624,62 @@ void FileChangeTransferSyntax::SetOutputFileName(const char *filename_native)
     Internals->OutFilename = filename_native;
 }
 
+bool FileChangeTransferSyntax::InitializeDecoder(File &file, std::istream &is)
+{
+  const TransferSyntax &ts = file.GetHeader().GetDataSetTransferSyntax();
+  delete Internals->Decoder;
+  Internals->Decoder = CreateDecoder( ts );
+  if( !Internals->Decoder )
+    {
+    gdcmDebugMacro( "Don't know how to decode TS: " << ts );
+    return false;
+    }
+  const std::vector<unsigned int> & dims = Internals->Dims;
+  ImageCodec &decoder = *Internals->Decoder;
+  decoder.SetDimensions( dims );
+  decoder.SetNumberOfDimensions( 2 );
+  decoder.SetPlanarConfiguration( Internals->PC );
+  decoder.SetPhotometricInterpretation( Internals->PI );
+  decoder.SetNeedByteSwap( false );
+  decoder.SetPixelFormat( Internals->PF );
+
+  Internals->Index.Clear();
+  if( !Internals->Index.Build( is, dims[2], &file.GetDataSet() ) )
+    {
+    gdcmErrorMacro( "Could not index the frames of " << Internals->InFilename );
+    return false;
+    }
+
+  // Decode the first frame to find out the layout of decoded frames (eg.
+  // JPEG YBR_FULL_422 is decoded as RGB)
+  const size_t framelen = (size_t)dims[0] * dims[1] * Internals->PF.GetPixelSize();
+  std::vector<char> frame;
+  ImageCodec *codec = CloneDecoder( decoder, framelen );
+  bool b = Internals->Index.ReadFrame( is, 0, frame )
+    && DecodeFrame( *codec, frame, framelen );
+  if( b )
+    {
+    const PixelFormat &cpf = codec->GetPixelFormat();
+    if( cpf.GetBitsAllocated() != Internals->PF.GetBitsAllocated()
+      || cpf.GetSamplesPerPixel() != Internals->PF.GetSamplesPerPixel() )
+      {
+      gdcmDebugMacro( "Pixel Format mismatch: " << cpf << " vs " << Internals->PF );
+      b = false;
+      }
+    Internals->PI = codec->GetPhotometricInterpretation();
+    Internals->PC = codec->GetPlanarConfiguration();
+    }
+  else
+    {
+    gdcmErrorMacro( "Could not decode first frame of " << Internals->InFilename );
+    }
+  delete codec;
+  return b;
+}
+
 bool FileChangeTransferSyntax::InitializeCopy()
 {
-  if( !Internals->IC )
+  if( !Internals->IC && !IsUncompressedOutput( Internals->TS ) )
     {
     return false;
     }
@@ -346,12 +708,7 @@ bool FileChangeTransferSyntax::InitializeCopy()
         return false;
         }
       FileMetaInformation & fmi = file.GetHeader();
-      const TransferSyntax &ts = fmi.GetDataSetTransferSyntax();
-      if( ts.IsEncapsulated() )
-        {
-        gdcmDebugMacro( "Don't know how to handle encapsulated TS: " << ts );
-        return false;
-        }
+      const TransferSyntax ts = fmi.GetDataSetTransferSyntax();
       if( ts == TransferSyntax::ImplicitVRBigEndianPrivateGE
        || ts == TransferSyntax::ExplicitVRBigEndian )
         {
@@ -363,7 +720,7 @@ bool FileChangeTransferSyntax::InitializeCopy()
       Internals->Dims = ImageHelper::GetDimensionsValue(file);
       Internals->PF = ImageHelper::GetPixelFormatValue(file);
       Internals->PI = ImageHelper::GetPhotometricInterpretationValue(file);
-      if( Internals->PI == PhotometricInterpretation::YBR_FULL_422 &&
+      if( Internals->IC && Internals->PI == PhotometricInterpretation::YBR_FULL_422 &&
         ( ts == TransferSyntax::ImplicitVRLittleEndian
        || ts == TransferSyntax::ExplicitVRLittleEndian ) )
         {
@@ -371,15 +728,68 @@ bool FileChangeTransferSyntax::InitializeCopy()
         return false;
         }
       Internals->PC = ImageHelper::GetPlanarConfigurationValue(file);
-      if( Internals->PC )
+      const PhotometricInterpretation pi = Internals->PI;
+      const unsigned int pc = Internals->PC;
+      delete Internals->Decoder;
+      Internals->Decoder = nullptr;
+      if( ts.IsEncapsulated() && !InitializeDecoder( file, is ) )
         {
-        gdcmDebugMacro( "Don't know how to handle Planar Configuration" );
         return false;
         }
       is.close();
 
+      // Encoders expect interleaved samples
+      Internals->Interleave = Internals->IC && Internals->PC
+        && Internals->PF.GetSamplesPerPixel() == 3;
+      if( Internals->PC && !Internals->Interleave && Internals->IC )
+        {
+        gdcmDebugMacro( "Don't know how to handle Planar Configuration" );
+        return false;
+        }
+      if( Internals->Interleave && Internals->PF.GetBitsAllocated() != 8
+        && Internals->PF.GetBitsAllocated() != 16 )
+        {
+        gdcmDebugMacro( "Don't know how to handle Planar Configuration" );
+        return false;
+        }
+      if( Internals->PI != pi )
+        {
+        Attribute<0x0028,0x0004> piat;
+        piat.SetValue( Internals->PI.GetString() );
+        ds.Replace( piat.GetAsDataElement() );
+        }
+      const unsigned int outpc = Internals->Interleave ? 0 : Internals->PC;
+      if( outpc != pc && Internals->PF.GetSamplesPerPixel() == 3 )
+        {
+        Attribute<0x0028,0x0006> pcat;
+        pcat.SetValue( (uint16_t)outpc );
+        ds.Replace( pcat.GetAsDataElement() );
+        }
+
+      // Offsets of multi-frame Pixel Data. Use the Extended Offset Table when
+      // the encoded frames may not be addressable on 32bits (codestreams can
+      // be larger than their input, keep a margin). Values are written once
+      // all frames are encoded.
+      const std::vector<unsigned int> & dims = Internals->Dims;
+      const uint64_t rawlen = (uint64_t)dims[0] * dims[1] * dims[2]
+        * Internals->PF.GetPixelSize();
+      Internals->UseExtendedOffsetTable = Internals->IC && dims[2] > 1
+        && rawlen >= 0x80000000;
+      ds.Remove( Tag(0x7fe0,0x0001) );
+      ds.Remove( Tag(0x7fe0,0x0002) );
+      if( Internals->UseExtendedOffsetTable )
+        {
+        std::vector<uint64_t> zeros( dims[2] );
+        DataElement eot( Tag(0x7fe0,0x0001) );
+        eot.SetVR( VR::OV );
+        eot.SetByteValue( (char*)&zeros[0], (uint32_t)(zeros.size() * sizeof(uint64_t)) );
+        ds.Insert( eot );
+        eot.SetTag( Tag(0x7fe0,0x0002) );
+        ds.Insert( eot );
+        }
+
       // do the lossy transfer syntax handling:
-      if( Internals->IC->GetLossyFlag() )
+      if( Internals->IC && Internals->IC->GetLossyFlag() )
         {
         if( !ds.FindDataElement( Tag(0x0008,0x0016) )
           || ds.GetDataElement( Tag(0x0008,0x0016) ).IsEmpty() )
@@ -491,6 +901,14 @@ bool FileChangeTransferSyntax::InitializeCopy()
       writer.SetFileName( outfilename );
       writer.SetFile( file );
       if( !writer.Write() ) return false;
+      // the tables are filled once all frames are encoded
+      if( Internals->UseExtendedOffsetTable
+        && ( !FindValuePosition( outfilename, Tag(0x7fe0,0x0001), Internals->ExtendedOffsetTablePos )
+          || !FindValuePosition( outfilename, Tag(0x7fe0,0x0002), Internals->ExtendedOffsetTableLengthsPos ) ) )
+        {
+        gdcmErrorMacro( "Could not find the Extended Offset Table" );
+        return false;
+        }
       }
     this->Internals->InitializeCopy = true;
     }
@@ -22,6 +22,7 @@ namespace gdcm
 class FileChangeTransferSyntaxInternals;
 class ImageCodec;
 class TransferSyntax;
+class File;
 
 /**
  * \brief FileChangeTransferSyntax
@@ -29,12 +30,20 @@ class TransferSyntax;
  * \details This class is a file-based (limited) replacement of the in-memory
  * ImageChangeTransferSyntax.
  *
- * This class provide a file-based compression-only mechanism. It will take in
- * an uncompressed DICOM image file (Pixel Data element). Then produced as
- * output a compressed DICOM file (Transfer Syntax will be updated).
+ * This class provide a file-based streaming mechanism: the Pixel Data is
+ * never loaded as a whole, frames are read, transcoded and written in
+ * batches whose size is bounded by SetMaximumMemory(). Frames of a batch are
+ * transcoded in parallel (one decoder/encoder per thread), and are written in
+ * order, so the output does not depend on the number of threads.
  *
- * Currently it supports the following transfer syntax:
- * - JPEGLosslessProcess14_1
+ * Input can be uncompressed (little endian) or encapsulated with any of the
+ * transfer syntaxes below. Output is either encapsulated with one of:
+ * - JPEG (lossless and lossy)
+ * - JPEG-LS (lossless and near lossless)
+ * - JPEG 2000 (lossless and lossy)
+ * - RLE Lossless
+ *
+ * or uncompressed (Implicit or Explicit VR Little Endian).
  */
 class GDCM_EXPORT FileChangeTransferSyntax : public Subject
 {
@@ -55,14 +64,27 @@ public:
   void SetTransferSyntax( TransferSyntax const & ts );
 
   /// Retrieve the actual codec (valid after calling SetTransferSyntax)
-  /// Only advanced users should call this function.
+  /// Only advanced users should call this function. Return nullptr when the
+  /// target transfer syntax is not encapsulated.
   ImageCodec * GetCodec();
 
+  /// Set/Get the number of threads transcoding the frames of a batch (all
+  /// cores by default)
+  void SetNumberOfThreads(unsigned int nthreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /// Set/Get the approximate maximum number of bytes of frame buffers in use
+  /// at any time. At least one frame is always processed at a time, whatever
+  /// the value. Default is 256MB.
+  void SetMaximumMemory(size_t bytes);
+  size_t GetMaximumMemory() const;
+
   /// for wrapped language: instantiate a reference counted object
   static SmartPointer<FileChangeTransferSyntax> New() { return new FileChangeTransferSyntax; }
 
 private:
   bool InitializeCopy();
+  bool InitializeDecoder(File &file, std::istream &is);
   bool UpdateCompressionLevel(double level);
   FileChangeTransferSyntaxInternals *Internals;
 };
@@ -0,0 +1,230 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFrameIndex.h"
+#include "gdcmBasicOffsetTable.h"
+#include "gdcmDataSet.h"
+#include "gdcmSwapper.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gdcm
+{
+
+namespace
+{
+const Tag itemStart(0xfffe, 0xe000);
+const Tag seqDelItem(0xfffe, 0xe0dd);
+
+// Return whether there is a fragment item starting at pos
+bool IsItemStart(std::istream &is, std::streamoff pos)
+{
+  is.seekg( pos, std::ios::beg );
+  Tag t;
+  t.Read<SwapperNoOp>( is );
+  return is && t == itemStart;
+}
+
+// Return whether buf (first bytes of a fragment) is the beginning of a
+// codestream: JPEG / JPEG-LS SOI, J2K SOC or JP2 signature box
+bool IsCodestreamStart(const unsigned char *buf, size_t len)
+{
+  static const unsigned char jp2[] = { 0x00, 0x00, 0x00, 0x0C, 0x6A, 0x50, 0x20, 0x20 };
+  if( len >= 2 && buf[0] == 0xFF && ( buf[1] == 0xD8 || buf[1] == 0x4F ) )
+    return true;
+  return len >= sizeof(jp2) && memcmp( buf, jp2, sizeof(jp2) ) == 0;
+}
+}
+
+bool FrameIndex::Build(std::istream &is, unsigned int numberOfFrames, const DataSet *ds)
+{
+  Clear();
+  if( !numberOfFrames ) return false;
+  const std::streampos start = is.tellg();
+  bool ret = false;
+  try
+    {
+    BasicOffsetTable bot;
+    bot.Read<SwapperNoOp>( is );
+    const std::streamoff first = is.tellg();
+    std::vector<uint32_t> offsets;
+    const ByteValue *bv = bot.GetByteValue();
+    if( bv && bv->GetLength() >= 4 )
+      {
+      offsets.resize( bv->GetLength() / 4 );
+      memcpy( &offsets[0], bv->GetPointer(), offsets.size() * 4 );
+      // always little endian, whatever the host
+      SwapperNoOp::SwapArray( &offsets[0], offsets.size() );
+      }
+    if( numberOfFrames == 1 )
+      {
+      // Everything up to the Sequence Delimitation Item is the frame
+      FrameOffsets.push_back( first );
+      Source = FRAGMENT_SCAN;
+      ret = true;
+      }
+    else
+      {
+      ret = ( ds && BuildFromExtendedOffsetTable( is, *ds, numberOfFrames, first ) )
+        || BuildFromBasicOffsetTable( is, offsets, numberOfFrames, first )
+        || BuildFromFragments( is, numberOfFrames, first );
+      }
+    }
+  catch( Exception &ex )
+    {
+    (void)ex;
+    gdcmDebugMacro( "Could not index fragments: " << ex.what() );
+    ret = false;
+    }
+  is.clear();
+  is.seekg( start, std::ios::beg );
+  if( !ret ) Clear();
+  return ret;
+}
+
+bool FrameIndex::BuildFromExtendedOffsetTable(std::istream &is, const DataSet &ds,
+  unsigned int numberOfFrames, std::streamoff first)
+{
+  const Tag teot(0x7fe0,0x0001);
+  if( !ds.FindDataElement( teot ) ) return false;
+  const ByteValue *bv = ds.GetDataElement( teot ).GetByteValue();
+  if( !bv || bv->GetLength() != 8 * numberOfFrames )
+    {
+    gdcmWarningMacro( "Extended Offset Table does not match Number of Frames" );
+    return false;
+    }
+  std::vector<uint64_t> offsets( numberOfFrames );
+  memcpy( &offsets[0], bv->GetPointer(), offsets.size() * 8 );
+  SwapperNoOp::SwapArray( &offsets[0], offsets.size() );
+  for( unsigned int i = 0; i < numberOfFrames; ++i )
+    {
+    if( i && offsets[i] <= offsets[i-1] ) return false;
+    FrameOffsets.push_back( first + (std::streamoff)offsets[i] );
+    }
+  if( !IsItemStart( is, FrameOffsets.back() ) )
+    {
+    gdcmWarningMacro( "Invalid Extended Offset Table" );
+    FrameOffsets.clear();
+    return false;
+    }
+  Source = EXTENDED_OFFSET_TABLE;
+  return true;
+}
+
+bool FrameIndex::BuildFromBasicOffsetTable(std::istream &is, std::vector<uint32_t> const &bot,
+  unsigned int numberOfFrames, std::streamoff first)
+{
+  if( bot.size() != numberOfFrames || bot[0] != 0 ) return false;
+  for( unsigned int i = 0; i < numberOfFrames; ++i )
+    {
+    if( i && bot[i] <= bot[i-1] ) return false;
+    FrameOffsets.push_back( first + (std::streamoff)bot[i] );
+    }
+  if( !IsItemStart( is, FrameOffsets.back() ) )
+    {
+    gdcmWarningMacro( "Invalid Basic Offset Table" );
+    FrameOffsets.clear();
+    return false;
+    }
+  Source = BASIC_OFFSET_TABLE;
+  return true;
+}
+
+bool FrameIndex::BuildFromFragments(std::istream &is, unsigned int numberOfFrames,
+  std::streamoff first)
+{
+  std::vector<std::streamoff> fragments;
+  std::vector<std::streamoff> starts; // fragments starting a codestream
+  is.seekg( first, std::ios::beg );
+  Fragment frag;
+  for( ;; )
+    {
+    const std::streamoff pos = is.tellg();
+    frag.ReadPreValue<SwapperNoOp>( is );
+    if( frag.GetTag() == seqDelItem )
+      {
+      End = pos;
+      break;
+      }
+    if( frag.GetTag() != itemStart ) return false;
+    fragments.push_back( pos );
+    unsigned char buf[8];
+    const size_t len = std::min( (size_t)frag.GetVL(), sizeof(buf) );
+    is.read( (char*)buf, len );
+    if( !is ) return false;
+    if( IsCodestreamStart( buf, len ) ) starts.push_back( pos );
+    is.seekg( (std::streamoff)frag.GetVL() - (std::streamoff)len, std::ios::cur );
+    }
+  if( fragments.size() == numberOfFrames )
+    {
+    FrameOffsets = fragments;
+    }
+  else if( starts.size() == numberOfFrames && starts[0] == fragments[0] )
+    {
+    FrameOffsets = starts;
+    }
+  else
+    {
+    gdcmWarningMacro( "Could not find frame boundaries: " << fragments.size()
+      << " fragments for " << numberOfFrames << " frames" );
+    return false;
+    }
+  Source = FRAGMENT_SCAN;
+  return true;
+}
+
+void FrameIndex::Clear()
+{
+  Source = NONE;
+  FrameOffsets.clear();
+  End = -1;
+}
+
+std::streamoff FrameIndex::GetFrameOffset(unsigned int frame) const
+{
+  if( frame >= FrameOffsets.size() ) return -1;
+  return FrameOffsets[frame];
+}
+
+bool FrameIndex::ReadFrame(std::istream &is, unsigned int frame, std::vector<char> &out) const
+{
+  out.clear();
+  if( frame >= FrameOffsets.size() ) return false;
+  const std::streamoff stop = frame + 1 < FrameOffsets.size() ? FrameOffsets[frame+1] : End;
+  is.clear();
+  is.seekg( FrameOffsets[frame], std::ios::beg );
+  Fragment frag;
+  try
+    {
+    for( std::streamoff pos = FrameOffsets[frame]; stop < 0 || pos < stop; pos = is.tellg() )
+      {
+      frag.ReadPreValue<SwapperNoOp>( is );
+      if( frag.GetTag() != itemStart ) break;
+      const size_t len = frag.GetVL();
+      const size_t oldlen = out.size();
+      out.resize( oldlen + len );
+      is.read( &out[oldlen], len );
+      if( !is ) return false;
+      }
+    }
+  catch( Exception &ex )
+    {
+    // no Sequence Delimitation Item
+    (void)ex;
+    is.clear();
+    }
+  return !out.empty();
+}
+
+} // end namespace gdcm
@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMFRAMEINDEX_H
+#define GDCMFRAMEINDEX_H
+
+#include "gdcmTypes.h"
+
+#include <vector>
+#include <ios>
+
+namespace gdcm
+{
+
+class DataSet;
+/**
+ * \brief FrameIndex
+ * \details Map each frame of an encapsulated Pixel Data to the position of its
+ * first fragment in the stream, so that any frame can be reached with a single
+ * seek instead of walking all the preceding fragments.
+ *
+ * The index is built (in order of preference) from:
+ * - the Extended Offset Table (7FE0,0001) / (7FE0,0002),
+ * - the Basic Offset Table,
+ * - a one-time scan of the fragment headers. When there are more fragments
+ *   than frames, the first bytes of each fragment are checked for a start of
+ *   codestream marker (JPEG SOI, J2K SOC, JP2 signature) to find frame
+ *   boundaries.
+ *
+ * A frame may span multiple fragments, ReadFrame returns the concatenation of
+ * all of them.
+ *
+ * \see BasicOffsetTable ImageRegionReader
+ */
+class GDCM_EXPORT FrameIndex
+{
+public:
+  typedef enum {
+    NONE = 0,
+    EXTENDED_OFFSET_TABLE,
+    BASIC_OFFSET_TABLE,
+    FRAGMENT_SCAN
+  } SourceType;
+
+  FrameIndex() = default;
+
+  /// Build the index. is must be positioned on the first byte of the
+  /// Basic Offset Table item (ie. right after the Pixel Data element header),
+  /// the stream position is restored upon return. When ds is set it is used
+  /// to look for an Extended Offset Table.
+  bool Build(std::istream &is, unsigned int numberOfFrames, const DataSet *ds = nullptr);
+
+  /// Reset the index
+  void Clear();
+
+  /// Return whether Build succeeded
+  bool IsValid() const { return Source != NONE; }
+
+  /// Return how the index was built
+  SourceType GetSource() const { return Source; }
+
+  unsigned int GetNumberOfFrames() const { return (unsigned int)FrameOffsets.size(); }
+
+  /// Position (in the stream) of the item tag of the first fragment of frame
+  std::streamoff GetFrameOffset(unsigned int frame) const;
+
+  /// Read all the fragments of frame, and return their concatenated value
+  bool ReadFrame(std::istream &is, unsigned int frame, std::vector<char> &out) const;
+
+private:
+  bool BuildFromExtendedOffsetTable(std::istream &is, const DataSet &ds,
+    unsigned int numberOfFrames, std::streamoff first);
+  bool BuildFromBasicOffsetTable(std::istream &is, std::vector<uint32_t> const &bot,
+    unsigned int numberOfFrames, std::streamoff first);
+  bool BuildFromFragments(std::istream &is, unsigned int numberOfFrames,
+    std::streamoff first);
+
+  SourceType Source{NONE};
+  std::vector<std::streamoff> FrameOffsets;
+  // position of the Sequence Delimitation Item, -1 when unknown
+  std::streamoff End{-1};
+};
+
+} // end namespace gdcm
+
+#endif //GDCMFRAMEINDEX_H
@@ -12,9 +12,11 @@
 
 =========================================================================*/
 #include "gdcmIPPSorter.h"
-#include "gdcmScanner.h"
+#include "gdcmStringFilter.h"
 #include "gdcmElement.h"
 #include "gdcmDirectionCosines.h"
+#include "gdcmFile.h"
+#include "gdcmASCIINumber.h"
 
 #include <cmath>
 #include <map>
@@ -56,6 +58,57 @@ struct dircos_comp {
   }
 };
 
+// The sort keys of one file, extracted by the thread which read it. A missing
+// attribute and an empty one are not the same thing (an empty IPP is not a
+// position though: the file is skipped as if it had none).
+struct ipp_key {
+  bool read;
+  bool hasipp, hasiop, hasframe, hasgantry;
+  double ipp[3];
+  std::string iop;
+  std::string frame;
+  std::string gantry;
+  ipp_key():read(false),hasipp(false),hasiop(false),hasframe(false),hasgantry(false),ipp() {}
+};
+
+static const Tag tipp(0x0020,0x0032); // Image Position (Patient)
+static const Tag tiop(0x0020,0x0037); // Image Orientation (Patient)
+static const Tag tframe(0x0020,0x0052); // Frame of Reference UID
+static const Tag tgantry(0x0018,0x1120); // Gantry/Detector Tilt
+// Temporal Position Identifier (0020,0100) 3 Temporal order of a dynamic or functional set of Images.
+//static const Tag tpi(0x0020,0x0100);
+
+static void ExtractKey(File const & file, ipp_key & key)
+{
+  const DataSet & ds = file.GetDataSet();
+  StringFilter sf;
+  sf.SetFile( file );
+  key.read = true;
+  if( ds.FindDataElement( tipp ) && !ds.GetDataElement( tipp ).IsEmpty() )
+    {
+    key.hasipp = true;
+    Element<VR::DS,VM::VM3> ipp;
+    const std::string value = sf.ToString( tipp );
+    ipp.Read( value.data(), value.size() );
+    for (int i = 0; i < 3; ++i) key.ipp[i] = ipp[i];
+    }
+  if( ds.FindDataElement( tiop ) )
+    {
+    key.hasiop = true;
+    key.iop = sf.ToString( tiop );
+    }
+  if( ds.FindDataElement( tframe ) )
+    {
+    key.hasframe = true;
+    key.frame = sf.ToString( tframe );
+    }
+  if( ds.FindDataElement( tgantry ) )
+    {
+    key.hasgantry = true;
+    key.gantry = sf.ToString( tgantry );
+    }
+}
+
 bool IPPSorter::Sort(std::vector<std::string> const & filenames)
 {
   // BUG: I cannot clear Filenames since input filenames could also be the output of ourself...
@@ -67,24 +120,31 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
     return true;
     }
 
-  Scanner scanner;
-  const Tag tipp(0x0020,0x0032); // Image Position (Patient)
-  const Tag tiop(0x0020,0x0037); // Image Orientation (Patient)
-  const Tag tframe(0x0020,0x0052); // Frame of Reference UID
-  const Tag tgantry(0x0018,0x1120); // Gantry/Detector Tilt
-  // Temporal Position Identifier (0020,0100) 3 Temporal order of a dynamic or functional set of Images.
-  //const Tag tpi(0x0020,0x0100);
-  scanner.AddTag( tipp );
-  scanner.AddTag( tiop );
-  scanner.AddTag( tframe );
-  scanner.AddTag( tgantry );
-  bool b = scanner.Scan( filenames );
-  if( !b )
+  // Only read the sort keys (in parallel), and keep nothing else:
+  std::set<Tag> tags;
+  tags.insert( tipp );
+  tags.insert( tiop );
+  tags.insert( tframe );
+  tags.insert( tgantry );
+  std::vector<ipp_key> keys( filenames.size() );
+  ReadFiles( filenames, tags,
+    [&keys]( size_t i, File const *file ) {
+      if( file ) ExtractKey( *file, keys[i] );
+      return true;
+    } );
+
+  std::set<std::string> gantry, iops, frames;
+  // we cannot simply consider the first file, what if this is not DICOM ?
+  size_t reference = keys.size();
+  for( size_t i = 0; i < keys.size(); ++i )
     {
-    gdcmDebugMacro( "Scanner failed" );
-    return false;
+    const ipp_key & key = keys[i];
+    if( !key.read ) continue;
+    reference = i;
+    if( key.hasgantry ) gantry.insert( key.gantry );
+    if( key.hasiop ) iops.insert( key.iop );
+    if( key.hasframe ) frames.insert( key.frame );
     }
-  Scanner::ValuesType gantry = scanner.GetValues(tgantry);
   if( gantry.size() > 1 )
   {
     gdcmDebugMacro( "More than one Gantry/Detector Tilt" );
@@ -92,23 +152,21 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
   }
   if( gantry.size() == 1 )
   {
-    std::stringstream ss( *gantry.begin() );
+    const std::string & value = *gantry.begin();
     double tilt;
-    ss >> tilt;
+    ASCIINumber::Parse( value.data(), value.data() + value.size(), tilt );
     if( tilt != 0.0 )
     {
       gdcmDebugMacro( "Gantry/Detector Tilt is not 0" );
       return false;
     }
   }
-  Scanner::ValuesType iops = scanner.GetValues(tiop);
-  Scanner::ValuesType frames = scanner.GetValues(tframe);
   if( DirCosTolerance == 0. )
     {
     if( iops.size() != 1 )
       {
       std::set< dircos_key, dircos_comp > s;
-      for( Scanner::ValuesType::const_iterator it = iops.begin(); it != iops.end(); ++it )
+      for( std::set<std::string>::const_iterator it = iops.begin(); it != iops.end(); ++it )
       {
         dircos_key dk;
         dk.read( *it );
@@ -138,35 +196,15 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
     return false;
     }
 
-  const char *reference = filenames[0].c_str();
-  // we cannot simply consider the first file, what if this is not DICOM ?
-  for(std::vector<std::string>::const_iterator it1 = filenames.begin();
-    it1 != filenames.end(); ++it1)
-    {
-    const char *filename = it1->c_str();
-    bool iskey = scanner.IsKey(filename);
-    if( iskey )
-      {
-      reference = filename;
-      }
-    }
-  Scanner::TagToValue const &t2v = scanner.GetMapping(reference);
-  Scanner::TagToValue::const_iterator it = t2v.find( tiop );
-  // Take the first file in the list of filenames, if not IOP is found, simply gives up:
-  if( it == t2v.end() )
-    {
-    // DEAD CODE
-    gdcmDebugMacro( "No iop in: " << reference );
-    return false;
-    }
-  if( it->first != tiop )
+  // Take the last file which could be read, if no IOP is found, simply gives up:
+  if( reference == keys.size() || !keys[reference].hasiop )
     {
     // first file does not contains Image Orientation (Patient), let's give up
     gdcmDebugMacro( "No iop in first file ");
     return false;
     }
-  const char *dircos = it->second;
-  if( !dircos )
+  const char *dircos = keys[reference].iop.c_str();
+  if( !*dircos )
     {
     // first file does contains Image Orientation (Patient), but it is empty
     gdcmDebugMacro( "Empty iop in first file ");
@@ -190,20 +228,18 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
   using SortedFilenames = std::map<double, const char *>;
   SortedFilenames sorted;
 {
-  std::vector<std::string>::const_iterator it1 = filenames.begin();
   DirectionCosines dc2;
-  for(; it1 != filenames.end(); ++it1)
+  for( size_t i = 0; i < keys.size(); ++i )
     {
-    const char *filename = it1->c_str();
-    bool iskey = scanner.IsKey(filename);
-    if( iskey )
+    const char *filename = filenames[i].c_str();
+    const ipp_key & key = keys[i];
+    if( key.read )
       {
-      const char *value =  scanner.GetValue(filename, tipp);
-      if( value )
+      if( key.hasipp )
         {
         if( DirCosTolerance != 0. )
           {
-          const char *value2 =  scanner.GetValue(filename, tiop);
+          const char *value2 = key.hasiop && !key.iop.empty() ? key.iop.c_str() : nullptr;
           if( !dc2.SetFromString( value2 ) )
             {
             if( value2 ) {
@@ -222,13 +258,8 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
           //dc2.Normalize();
           //dc2.Print( std::cout << std::endl );
           }
-        //gdcmDebugMacro( filename << " has " << ipp << " = " << value );
-        Element<VR::DS,VM::VM3> ipp;
-        std::stringstream ss;
-        ss.str( value );
-        ipp.Read( ss );
         double dist = 0;
-        for (int i = 0; i < 3; ++i) dist += normal[i]*ipp[i];
+        for (int j = 0; j < 3; ++j) dist += normal[j]*key.ipp[j];
         // FIXME: This test is weak, since implicitly we are doing a != on floating point value
         if( sorted.find(dist) != sorted.end() )
           {
@@ -255,7 +286,11 @@ bool IPPSorter::Sort(std::vector<std::string> const & filenames)
       }
     }
 }
-  assert( !sorted.empty() );
+  if( sorted.empty() )
+    {
+    gdcmDebugMacro( "No file with a non empty Image Position (Patient)" );
+    return false;
+    }
 {
   SortedFilenames::const_iterator it2 = sorted.begin();
   double prev = it2->first;
@@ -26,7 +26,9 @@
 #include "gdcmDirectionCosines.h"
 #include "gdcmSegmentedPaletteColorLookupTable.h"
 #include "gdcmByteValue.h"
+#include "gdcmASCIINumber.h"
 
+#include <algorithm> // std::find
 #include <cmath> // fabs
 
   /* TODO:
@@ -51,192 +53,203 @@ bool ImageHelper::ForcePixelSpacing = false;
 // By default, this is off, if you want behavior documented in DICOM CP 2330, turn it on
 bool ImageHelper::SecondaryCaptureImagePlaneModule = false;
 
-static bool GetOriginValueFromSequence(const DataSet& ds, const Tag& tfgs, std::vector<double> &ori)
+// Functional groups found for a frame, see ExtractFrameGeometry
+enum {
+  FGOrigin = 1,               // Plane Position Sequence
+  FGDirectionCosines = 2,     // Plane Orientation Sequence
+  FGSpacing = 4,              // Pixel Measures Sequence / Pixel Spacing
+  FGSpacingBetweenSlices = 8, // Pixel Measures Sequence / Spacing Between Slices
+  FGInterceptSlope = 16,      // Pixel Value Transformation Sequence
+  FGPerFrameOrigin = 32       // Plane Position Sequence of the frame's own item
+};
+
+static SmartPointer<SequenceOfItems> GetFirstItemOf(const DataSet& ds, const Tag& t)
 {
-  if( !ds.FindDataElement( tfgs ) ) return false;
-  //const SequenceOfItems * sqi = ds.GetDataElement( tfgs ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( tfgs ).GetValueAsSQ();
-  if( !(sqi && sqi->GetNumberOfItems() > 0) ) return false;
-  // Get first item:
-  const Item &item = sqi->GetItem(1);
-  const DataSet & subds = item.GetNestedDataSet();
-  // Plane position Sequence
-  const Tag tpms(0x0020,0x9113);
-  if( !subds.FindDataElement(tpms) ) return false;
-  //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-  if( sqi2 && !sqi2->IsEmpty() )
-  {
-  const Item &item2 = sqi2->GetItem(1);
-  const DataSet & subds2 = item2.GetNestedDataSet();
-  //
-  const Tag tps(0x0020,0x0032);
-  if( !subds2.FindDataElement(tps) ) return false;
-  const DataElement &de = subds2.GetDataElement( tps );
-  //assert( bv );
-  Attribute<0x0020,0x0032> at;
-  at.SetFromDataElement( de );
-  //at.Print( std::cout );
-  ori.push_back( at.GetValue(0) );
-  ori.push_back( at.GetValue(1) );
-  ori.push_back( at.GetValue(2) );
-
-  return true;
-  }
-  return false;
-}
-
-static bool GetDirectionCosinesValueFromSequence(const DataSet& ds, const Tag& tfgs, std::vector<double> &dircos)
-{
-  if( !ds.FindDataElement( tfgs ) ) return false;
-  //const SequenceOfItems * sqi = ds.GetDataElement( tfgs ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( tfgs ).GetValueAsSQ();
-  if( !(sqi && sqi->GetNumberOfItems() > 0) ) return false;
-  // Get first item:
-  const Item &item = sqi->GetItem(1);
-  const DataSet & subds = item.GetNestedDataSet();
-  // Plane position Sequence
-  const Tag tpms(0x0020,0x9116);
-  if( !subds.FindDataElement(tpms) ) return false;
-  //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-  if( !(sqi2 && sqi2->GetNumberOfItems()) ) return false;
-  assert( sqi2 && sqi2->GetNumberOfItems() );
-  // Take it from the first item
-  const Item &item2 = sqi2->GetItem(1);
-  const DataSet & subds2 = item2.GetNestedDataSet();
-  //
-  const Tag tps(0x0020,0x0037);
-  if( !subds2.FindDataElement(tps) ) return false;
-  const DataElement &de = subds2.GetDataElement( tps );
-  //assert( bv );
-  Attribute<0x0020,0x0037> at;
-  at.SetFromDataElement( de );
-  dircos.push_back( at.GetValue(0) );
-  dircos.push_back( at.GetValue(1) );
-  dircos.push_back( at.GetValue(2) );
-  dircos.push_back( at.GetValue(3) );
-  dircos.push_back( at.GetValue(4) );
-  dircos.push_back( at.GetValue(5) );
-
-  return true;
+  if( !ds.FindDataElement( t ) ) return nullptr;
+  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( t ).GetValueAsSQ();
+  if( !(sqi && sqi->GetNumberOfItems() > 0) ) return nullptr;
+  return sqi;
 }
 
-static bool GetInterceptSlopeValueFromSequence(const DataSet& ds, const Tag& tfgs, std::vector<double> &intslope)
+// Fill in fg from one item of the Shared or Per-frame Functional Groups
+// Sequence, and return the functional groups which were found
+static unsigned int ReadFunctionalGroups(const DataSet& subds, FrameGeometry &fg)
 {
-  if( !ds.FindDataElement( tfgs ) ) return false;
-  //const SequenceOfItems * sqi = ds.GetDataElement( tfgs ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( tfgs ).GetValueAsSQ();
-  if( !(sqi && sqi->GetNumberOfItems() > 0) ) return false;
-  // Get first item:
-  const Item &item = sqi->GetItem(1);
-  const DataSet & subds = item.GetNestedDataSet();
-  // (0028,9145) SQ (Sequence with undefined length)               # u/l,1 Pixel Value Transformation Sequence
-  const Tag tpms(0x0028,0x9145);
-  if( !subds.FindDataElement(tpms) ) return false;
-  //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-  assert( sqi2 );
-  const Item &item2 = sqi2->GetItem(1);
-  const DataSet & subds2 = item2.GetNestedDataSet();
+  unsigned int found = 0;
+  // (0020,9113) SQ (Sequence with undefined length #=1)     # u/l, 1 PlanePositionSequence
+  SmartPointer<SequenceOfItems> sqi = GetFirstItemOf( subds, Tag(0x0020,0x9113) );
+  if( sqi )
     {
-    //  (0028,1052) DS [0]                                        # 2,1 Rescale Intercept
-    const Tag tps(0x0028,0x1052);
-    if( !subds2.FindDataElement(tps) ) return false;
-    const DataElement &de = subds2.GetDataElement( tps );
-    //assert( bv );
-    Attribute<0x0028,0x1052> at;
-    at.SetFromDataElement( de );
-    //at.Print( std::cout );
-    intslope.push_back( at.GetValue() );
+    const DataSet & subds2 = sqi->GetItem(1).GetNestedDataSet();
+    const Tag tps(0x0020,0x0032);
+    if( subds2.FindDataElement(tps) )
+      {
+      Attribute<0x0020,0x0032> at = {{0,0,0}};
+      at.SetFromDataElement( subds2.GetDataElement( tps ) );
+      for( unsigned int i = 0; i < 3; ++i ) fg.Origin[i] = at.GetValue(i);
+      found |= FGOrigin;
+      }
+    }
+  // (0020,9116) SQ PlaneOrientationSequence
+  sqi = GetFirstItemOf( subds, Tag(0x0020,0x9116) );
+  if( sqi )
+    {
+    const DataSet & subds2 = sqi->GetItem(1).GetNestedDataSet();
+    const Tag tps(0x0020,0x0037);
+    if( subds2.FindDataElement(tps) )
+      {
+      Attribute<0x0020,0x0037> at = {{1,0,0,0,1,0}};
+      at.SetFromDataElement( subds2.GetDataElement( tps ) );
+      for( unsigned int i = 0; i < 6; ++i ) fg.DirectionCosines[i] = at.GetValue(i);
+      found |= FGDirectionCosines;
+      }
+    }
+  //  (0028,9110) SQ (Sequence with undefined length #=1)     # u/l, 1 PixelMeasuresSequence
+  //      (fffe,e000) na (Item with undefined length #=2)         # u/l, 1 Item
+  //        (0018,0050) DS [0.5]                                    #   4, 1 SliceThickness
+  //        (0028,0030) DS [0.322\0.322]                            #  12, 2 PixelSpacing
+  sqi = GetFirstItemOf( subds, Tag(0x0028,0x9110) );
+  if( sqi )
+    {
+    const DataSet & subds2 = sqi->GetItem(1).GetNestedDataSet();
+    const Tag tps(0x0028,0x0030);
+    if( subds2.FindDataElement(tps) )
+      {
+      Attribute<0x0028,0x0030> at = {{1,1}};
+      at.SetFromDataElement( subds2.GetDataElement( tps ) );
+      fg.Spacing[0] = at.GetValue(1);
+      fg.Spacing[1] = at.GetValue(0);
+      found |= FGSpacing;
+      }
+    // BUG ! Slice Thickness is not the Z spacing, check for instance:
+    // gdcmData/BRTUM001.dcm
+    // Slice Thickness is 5.0 while the Zspacing should be 6.0 !
+    const Tag tsbs(0x0018,0x0088);
+    if( subds2.FindDataElement(tsbs) )
+      {
+      Attribute<0x0018,0x0088> at = {1};
+      at.SetFromDataElement( subds2.GetDataElement( tsbs ) );
+      fg.Spacing[2] = at.GetValue();
+      found |= FGSpacingBetweenSlices;
+      }
     }
+  // (0028,9145) SQ (Sequence with undefined length)               # u/l,1 Pixel Value Transformation Sequence
+  sqi = GetFirstItemOf( subds, Tag(0x0028,0x9145) );
+  if( sqi )
     {
-    // (0028,1053) DS [5.65470085470085]                         # 16,1 Rescale Slope
+    const DataSet & subds2 = sqi->GetItem(1).GetNestedDataSet();
+    //  (0028,1052) DS [0]                                        # 2,1 Rescale Intercept
+    //  (0028,1053) DS [5.65470085470085]                         # 16,1 Rescale Slope
+    const Tag tpi(0x0028,0x1052);
     const Tag tps(0x0028,0x1053);
-    if( !subds2.FindDataElement(tps) ) return false;
-    const DataElement &de = subds2.GetDataElement( tps );
-    //assert( bv );
-    Attribute<0x0028,0x1053> at;
-    at.SetFromDataElement( de );
-    //at.Print( std::cout );
-    intslope.push_back( at.GetValue() );
+    if( subds2.FindDataElement(tpi) && subds2.FindDataElement(tps) )
+      {
+      Attribute<0x0028,0x1052> ati = {0};
+      ati.SetFromDataElement( subds2.GetDataElement( tpi ) );
+      Attribute<0x0028,0x1053> ats = {1};
+      ats.SetFromDataElement( subds2.GetDataElement( tps ) );
+      fg.Intercept = ati.GetValue();
+      fg.Slope = ats.GetValue();
+      found |= FGInterceptSlope;
+      }
     }
+  return found;
+}
 
-  assert( intslope.size() == 2 );
+// Read the Shared (5200,9229) and Per-frame (5200,9230) Functional Groups
+// Sequences in a single pass, for the first maxframes frames (all of them when
+// 0). A functional group of the shared item applies to all frames. found[i]
+// holds the functional groups found for frame i.
+static bool ExtractFrameGeometry(const DataSet& ds, size_t maxframes,
+  std::vector<FrameGeometry> &frames, std::vector<unsigned int> &found)
+{
+  SmartPointer<SequenceOfItems> shared = GetFirstItemOf( ds, Tag(0x5200,0x9229) );
+  SmartPointer<SequenceOfItems> perframe = GetFirstItemOf( ds, Tag(0x5200,0x9230) );
+  if( !shared && !perframe ) return false;
+
+  FrameGeometry sharedfg = {{0,0,0}, {1,0,0,0,1,0}, {1,1,1}, 0, 1};
+  unsigned int sharedfound = 0;
+  if( shared )
+    sharedfound = ReadFunctionalGroups( shared->GetItem(1).GetNestedDataSet(), sharedfg );
+
+  size_t nframes = perframe ? perframe->GetNumberOfItems() : 1;
+  if( maxframes && nframes > maxframes ) nframes = maxframes;
+  frames.assign( nframes, sharedfg );
+  found.assign( nframes, sharedfound );
+  if( !perframe ) return true;
+  for( size_t i = 0; i < nframes; ++i )
+    {
+    FrameGeometry &fg = frames[i];
+    const unsigned int own = ReadFunctionalGroups(
+      perframe->GetItem( (SequenceOfItems::SizeType)(i + 1) ).GetNestedDataSet(), fg );
+    found[i] |= own;
+    if( own & FGOrigin ) found[i] |= FGPerFrameOrigin;
+    // the shared item wins:
+    if( own & sharedfound )
+      {
+      if( sharedfound & FGOrigin )
+        std::copy( sharedfg.Origin, sharedfg.Origin + 3, fg.Origin );
+      if( sharedfound & FGDirectionCosines )
+        std::copy( sharedfg.DirectionCosines, sharedfg.DirectionCosines + 6, fg.DirectionCosines );
+      if( sharedfound & FGSpacing )
+        std::copy( sharedfg.Spacing, sharedfg.Spacing + 2, fg.Spacing );
+      if( sharedfound & FGSpacingBetweenSlices )
+        fg.Spacing[2] = sharedfg.Spacing[2];
+      if( sharedfound & FGInterceptSlope )
+        {
+        fg.Intercept = sharedfg.Intercept;
+        fg.Slope = sharedfg.Slope;
+        }
+      }
+    }
   return true;
 }
 
-static bool ComputeZSpacingFromIPP(const DataSet &ds, double &zspacing)
+static bool ComputeZSpacingFromIPP(const DataSet &ds,
+  std::vector<FrameGeometry> const &frames, std::vector<unsigned int> const &found,
+  double &zspacing)
 {
   // first we need to get the direction cosines:
-  const Tag t1(0x5200,0x9229);
-  const Tag t2(0x5200,0x9230);
-  std::vector<double> cosines;
+  std::vector<double> cosines( 6 );
   // For some reason TOSHIBA-EnhancedCT.dcm is storing the direction cosines in the per-frame section
   // and not the shared one... oh well
-  bool b1 = GetDirectionCosinesValueFromSequence(ds, t1, cosines)
-    || GetDirectionCosinesValueFromSequence(ds,t2,cosines);
-  if(!b1)
+  if( found[0] & FGDirectionCosines )
     {
-    cosines.resize( 6 );
-    bool b2 = ImageHelper::GetDirectionCosinesFromDataSet(ds, cosines);
-    if( b2 )
-      {
-      gdcmWarningMacro( "Image Orientation (Patient) cannot be stored here!. Continuing" );
-      b1 = b2;
-      }
-    else
-      {
-      gdcmErrorMacro( "Image Orientation (Patient) was not found" );
-      cosines[0] = 1;
-      cosines[1] = 0;
-      cosines[2] = 0;
-      cosines[3] = 0;
-      cosines[4] = 1;
-      cosines[5] = 0;
-      }
+    std::copy( frames[0].DirectionCosines, frames[0].DirectionCosines + 6, cosines.begin() );
+    }
+  else if( ImageHelper::GetDirectionCosinesFromDataSet(ds, cosines) )
+    {
+    gdcmWarningMacro( "Image Orientation (Patient) cannot be stored here!. Continuing" );
+    }
+  else
+    {
+    gdcmErrorMacro( "Image Orientation (Patient) was not found" );
+    cosines[0] = 1;
+    cosines[1] = 0;
+    cosines[2] = 0;
+    cosines[3] = 0;
+    cosines[4] = 1;
+    cosines[5] = 0;
     }
-  assert( b1 && cosines.size() == 6 ); // yeah we really need that
 
   const Tag tfgs(0x5200,0x9230);
   if( !ds.FindDataElement( tfgs ) ) return false;
-  //const SequenceOfItems * sqi = ds.GetDataElement( tfgs ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( tfgs ).GetValueAsSQ();
-  if( !sqi ) return false;
-  assert( sqi );
   double normal[3];
   DirectionCosines dc( cosines.data() );
   dc.Cross( normal );
   DirectionCosines::Normalize(normal);
 
-  // For each item
-  SequenceOfItems::SizeType nitems = sqi->GetNumberOfItems();
+  // For each frame
+  const size_t nitems = frames.size();
   if( nitems > 1 ) {
-  std::vector<double> dircos_subds2; dircos_subds2.resize(6);
   std::vector<double> distances;
-  for(SequenceOfItems::SizeType i0 = 1; i0 <= nitems; ++i0)
+  distances.reserve( nitems );
+  for(size_t i0 = 0; i0 < nitems; ++i0)
     {
-    const Item &item = sqi->GetItem(i0);
-    const DataSet & subds = item.GetNestedDataSet();
-    // (0020,9113) SQ (Sequence with undefined length #=1)     # u/l, 1 PlanePositionSequence
-    const Tag tpms(0x0020,0x9113);
-    if( !subds.FindDataElement(tpms) ) return false;
-    //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-    SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-    assert( sqi2 );
-    const Item &item2 = sqi2->GetItem(1);
-    const DataSet & subds2 = item2.GetNestedDataSet();
-    // Check Image Orientation (Patient)
-    if( ImageHelper::GetDirectionCosinesFromDataSet(subds2, dircos_subds2) )
-      {
-      assert( dircos_subds2 == cosines );
-      }
     // (0020,0032) DS [-82.5\-82.5\1153.75]                    #  20, 3 ImagePositionPatient
-    const Tag tps(0x0020,0x0032);
-    if( !subds2.FindDataElement(tps) ) return false;
-    const DataElement &de = subds2.GetDataElement( tps );
-    Attribute<0x0020,0x0032> ipp;
-    ipp.SetFromDataElement(de);
+    // a position shared by all frames is no use here:
+    if( !(found[i0] & FGPerFrameOrigin) ) return false;
+    const double *ipp = frames[i0].Origin;
     double dist = 0;
     for (int i = 0; i < 3; ++i) dist += normal[i]*ipp[i];
     distances.push_back( dist );
@@ -244,35 +257,31 @@ static bool ComputeZSpacingFromIPP(const DataSet &ds, double &zspacing)
   assert( distances.size() == nitems );
   double meanspacing = 0;
   double prev = distances[0];
-  for(unsigned int i = 1; i < nitems; ++i)
+  for(size_t i = 1; i < nitems; ++i)
     {
     const double current = distances[i] - prev;
     meanspacing += current;
     prev = distances[i];
     }
   bool timeseries = false;
-  if( nitems > 1 )
+  meanspacing /= (double)(nitems - 1);
+  if( meanspacing == 0.0 )
     {
-    meanspacing /= (double)(nitems - 1);
-    if( meanspacing == 0.0 )
-      {
-      // Could be a time series. Assume time spacing of 1. for now:
-      gdcmDebugMacro( "Assuming time series for Z-spacing" );
-      meanspacing = 1.0;
-      timeseries = true;
-      }
+    // Could be a time series. Assume time spacing of 1. for now:
+    gdcmDebugMacro( "Assuming time series for Z-spacing" );
+    meanspacing = 1.0;
+    timeseries = true;
     }
 
   zspacing = meanspacing;
-  if( nitems > 1 )
-    assert( zspacing != 0.0 ); // technically this should not happen
+  assert( zspacing != 0.0 ); // technically this should not happen
 
   if( !timeseries )
     {
     // Check spacing is consistent:
     const double ZTolerance = 1e-3; // ??? FIXME
     prev = distances[0];
-    for(unsigned int i = 1; i < nitems; ++i)
+    for(size_t i = 1; i < nitems; ++i)
       {
       const double current = distances[i] - prev;
       if( fabs(current - zspacing) > ZTolerance )
@@ -286,86 +295,27 @@ static bool ComputeZSpacingFromIPP(const DataSet &ds, double &zspacing)
     }
   } else {
     // single slice, this is not an error to not find the zspacing in this case.
+    // <entry group="0018" element="0088" vr="DS" vm="1" name="Spacing Between Slices"/>
     zspacing = 1.0;
-    const Tag tfgs0(0x5200,0x9229);
-    if( !ds.FindDataElement( tfgs0 ) ) return true;
-    SmartPointer<SequenceOfItems> sqi0 = ds.GetDataElement( tfgs0 ).GetValueAsSQ();
-    if( !(sqi0 && sqi0->GetNumberOfItems() > 0) ) return true;
-    // Get first item:
-    const Item &item = sqi0->GetItem(1);
-    const DataSet & subds = item.GetNestedDataSet();
-    // <entry group="0028" element="9110" vr="SQ" vm="1" name="Pixel Measures Sequence"/>
-    const Tag tpms(0x0028,0x9110);
-    if( !subds.FindDataElement(tpms) ) return true;
-    //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-    SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-    assert( sqi2 );
-    const Item &item2 = sqi2->GetItem(1);
-    const DataSet & subds2 = item2.GetNestedDataSet();
-    // <entry group="0028" element="0030" vr="DS" vm="2" name="Pixel Spacing"/>
-    const Tag tps(0x0018,0x0088);
-    if( !subds2.FindDataElement(tps) ) return true;
-    const DataElement &de = subds2.GetDataElement( tps );
-    Attribute<0x0018,0x0088> at;
-    at.SetFromDataElement( de );
-    zspacing = at.GetValue();
+    if( found[0] & FGSpacingBetweenSlices )
+      zspacing = frames[0].Spacing[2];
   }
   return true;
 }
 
 // EnhancedMRImageStorage & EnhancedCTImageStorage
-static bool GetSpacingValueFromSequence(const DataSet& ds, const Tag& tfgs, std::vector<double> &sp)
+static bool GetSpacingValueFromSequence(const DataSet& ds, std::vector<double> &sp)
 {
-  //  (0028,9110) SQ (Sequence with undefined length #=1)     # u/l, 1 PixelMeasuresSequence
-  //      (fffe,e000) na (Item with undefined length #=2)         # u/l, 1 Item
-  //        (0018,0050) DS [0.5]                                    #   4, 1 SliceThickness
-  //        (0028,0030) DS [0.322\0.322]                            #  12, 2 PixelSpacing
-  // <entry group="5200" element="9229" vr="SQ" vm="1" name="Shared Functional Groups Sequence"/>
-  //const Tag tfgs(0x5200,0x9229);
-  //const Tag tfgs(0x5200,0x9230);
-  //assert( ds.FindDataElement( tfgs ) );
-  if( !ds.FindDataElement( tfgs ) ) return false;
-  //const SequenceOfItems * sqi = ds.GetDataElement( tfgs ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi = ds.GetDataElement( tfgs ).GetValueAsSQ();
-  if( !(sqi && sqi->GetNumberOfItems() > 0) ) return false;
-  // Get first item:
-  const Item &item = sqi->GetItem(1);
-  const DataSet & subds = item.GetNestedDataSet();
-  // <entry group="0028" element="9110" vr="SQ" vm="1" name="Pixel Measures Sequence"/>
-  const Tag tpms(0x0028,0x9110);
-  if( !subds.FindDataElement(tpms) ) return false;
-  //const SequenceOfItems * sqi2 = subds.GetDataElement( tpms ).GetSequenceOfItems();
-  SmartPointer<SequenceOfItems> sqi2 = subds.GetDataElement( tpms ).GetValueAsSQ();
-  assert( sqi2 );
-  const Item &item2 = sqi2->GetItem(1);
-  const DataSet & subds2 = item2.GetNestedDataSet();
+  std::vector<FrameGeometry> frames;
+  std::vector<unsigned int> found;
+  if( !ExtractFrameGeometry(ds, 0, frames, found) ) return false;
   // <entry group="0028" element="0030" vr="DS" vm="2" name="Pixel Spacing"/>
-  const Tag tps(0x0028,0x0030);
-  if( !subds2.FindDataElement(tps) ) return false;
-  const DataElement &de = subds2.GetDataElement( tps );
-  //assert( bv );
-  Attribute<0x0028,0x0030> at;
-  at.SetFromDataElement( de );
-  //at.Print( std::cout );
-  sp.push_back( at.GetValue(1) );
-  sp.push_back( at.GetValue(0) );
-
-  // BUG ! Check for instance:
-  // gdcmData/BRTUM001.dcm
-  // Slice Thickness is 5.0 while the Zspacing should be 6.0 !
-#if 0
-  // Do the 3rd dimension zspacing:
-  // <entry group="0018" element="0050" vr="DS" vm="1" name="Slice Thickness"/>
-  const Tag tst(0x0018,0x0050);
-  if( !subds2.FindDataElement(tst) ) return false;
-  const DataElement &de2 = subds2.GetDataElement( tst );
-  Attribute<0x0018,0x0050> at2;
-  at2.SetFromDataElement( de2 );
-  //at2.Print( std::cout );
-  sp.push_back( at2.GetValue(0) );
-#endif
+  if( !(found[0] & FGSpacing) ) return false;
+  sp.push_back( frames[0].Spacing[0] );
+  sp.push_back( frames[0].Spacing[1] );
+
   double zspacing;
-  bool b = ComputeZSpacingFromIPP(ds, zspacing);
+  bool b = ComputeZSpacingFromIPP(ds, frames, found, zspacing);
   if( !b ) return false;
 
   sp.push_back( zspacing );
@@ -537,12 +487,11 @@ std::vector<double> ImageHelper::GetOriginValue(File const & f)
    || ms == MediaStorage::LegacyConvertedEnhancedCTImageStorage
    || ms == MediaStorage::LegacyConvertedEnhancedPETImageStorage )
     {
-    const Tag t1(0x5200,0x9229);
-    const Tag t2(0x5200,0x9230);
-    if( GetOriginValueFromSequence(ds,t1, ori)
-     || GetOriginValueFromSequence(ds, t2, ori) )
+    std::vector<FrameGeometry> frames;
+    std::vector<unsigned int> found;
+    if( ExtractFrameGeometry(ds, 1, frames, found) && (found[0] & FGOrigin) )
       {
-      assert( ori.size() == 3 );
+      ori.assign( frames[0].Origin, frames[0].Origin + 3 );
       return ori;
       }
     ori.resize( 3 );
@@ -670,12 +619,11 @@ std::vector<double> ImageHelper::GetDirectionCosinesValue(File const & f)
    || ms == MediaStorage::LegacyConvertedEnhancedCTImageStorage
    || ms == MediaStorage::LegacyConvertedEnhancedPETImageStorage )
     {
-    const Tag t1(0x5200,0x9229);
-    const Tag t2(0x5200,0x9230);
-    if( GetDirectionCosinesValueFromSequence(ds,t1, dircos)
-     || GetDirectionCosinesValueFromSequence(ds, t2, dircos) )
+    std::vector<FrameGeometry> frames;
+    std::vector<unsigned int> found;
+    if( ExtractFrameGeometry(ds, 1, frames, found) && (found[0] & FGDirectionCosines) )
       {
-      assert( dircos.size() == 6 );
+      dircos.assign( frames[0].DirectionCosines, frames[0].DirectionCosines + 6 );
       return dircos;
       }
     else
@@ -746,6 +694,31 @@ std::vector<double> ImageHelper::GetDirectionCosinesValue(File const & f)
   return dircos;
 }
 
+bool ImageHelper::GetFrameGeometryValues(File const & f, std::vector<FrameGeometry> & frames)
+{
+  const DataSet& ds = f.GetDataSet();
+  std::vector<unsigned int> found;
+  if( !ExtractFrameGeometry(ds, 0, frames, found) )
+    {
+    frames.clear();
+    return false;
+    }
+  std::vector<double> dircos( 6 );
+  bool hasdircos = false, checked = false;
+  for( size_t i = 0; i < frames.size(); ++i )
+    {
+    if( found[i] & FGDirectionCosines ) continue;
+    if( !checked )
+      {
+      hasdircos = GetDirectionCosinesFromDataSet(ds, dircos);
+      checked = true;
+      }
+    if( hasdircos )
+      std::copy( dircos.begin(), dircos.end(), frames[i].DirectionCosines );
+    }
+  return true;
+}
+
 void ImageHelper::SetForceRescaleInterceptSlope(bool b)
 {
   ForceRescaleInterceptSlope = b;
@@ -1061,12 +1034,12 @@ std::vector<double> ImageHelper::GetRescaleInterceptSlopeValue(File const & f)
    || ms == MediaStorage::LegacyConvertedEnhancedCTImageStorage
    || ms == MediaStorage::LegacyConvertedEnhancedPETImageStorage )
     {
-    const Tag t1(0x5200,0x9229);
-    const Tag t2(0x5200,0x9230);
-    if( GetInterceptSlopeValueFromSequence(ds,t1, interceptslope)
-     || GetInterceptSlopeValueFromSequence(ds,t2, interceptslope) )
+    std::vector<FrameGeometry> frames;
+    std::vector<unsigned int> found;
+    if( ExtractFrameGeometry(ds, 1, frames, found) && (found[0] & FGInterceptSlope) )
       {
-      assert( interceptslope.size() == 2 );
+      interceptslope.push_back( frames[0].Intercept );
+      interceptslope.push_back( frames[0].Slope );
       return interceptslope;
       }
 
@@ -1442,10 +1415,7 @@ std::vector<double> ImageHelper::GetSpacingValue(File const & f)
     || ms == MediaStorage::LegacyConvertedEnhancedPETImageStorage)
     {
     // <entry group="5200" element="9230" vr="SQ" vm="1" name="Per-frame Functional Groups Sequence"/>
-    const Tag t1(0x5200,0x9229);
-    const Tag t2(0x5200,0x9230);
-    if( GetSpacingValueFromSequence(ds,t1, sp)
-      || GetSpacingValueFromSequence(ds, t2, sp) )
+    if( GetSpacingValueFromSequence(ds, sp) )
       {
       assert( sp.size() == 3 );
       return sp;
@@ -1514,19 +1484,17 @@ std::vector<double> ImageHelper::GetSpacingValue(File const & f)
     case VR::DS:
         {
         Element<VR::DS,VM::VM1_n> el;
-        std::stringstream ss;
         const ByteValue *bv = de.GetByteValue();
         assert( bv );
-        std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-        ss.str( s );
+        const char *begin = bv->GetPointer();
+        const char *end = begin + bv->GetLength();
         // Stupid file: CT-MONO2-8-abdo.dcm
         // The spacing is something like that: [0.2\0\0.200000]
         // I would need to throw an exception that VM is not compatible
         el.SetLength( entry.GetVM().GetLength() * entry.GetVR().GetSizeof() );
-        std::string::size_type found = s.find('\\');
-        if( found != std::string::npos )
+        if( std::find( begin, end, '\\' ) != end )
           {
-          el.Read( ss );
+          el.Read( begin, bv->GetLength() );
           assert( el.GetLength() == 2 );
           for(unsigned int i = 0; i < el.GetLength(); ++i)
             {
@@ -1545,7 +1513,7 @@ std::vector<double> ImageHelper::GetSpacingValue(File const & f)
         else
           {
           double singleval;
-          ss >> singleval;
+          ASCIINumber::Parse( begin, end, singleval );
           if( singleval == 0.0 )
             {
             singleval = 1.0;
@@ -1559,13 +1527,10 @@ std::vector<double> ImageHelper::GetSpacingValue(File const & f)
     case VR::IS:
         {
         Element<VR::IS,VM::VM1_n> el;
-        std::stringstream ss;
         const ByteValue *bv = de.GetByteValue();
         assert( bv );
-        std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-        ss.str( s );
         el.SetLength( entry.GetVM().GetLength() * entry.GetVR().GetSizeof() );
-        el.Read( ss );
+        el.Read( bv->GetPointer(), bv->GetLength() );
         for(unsigned int i = 0; i < el.GetLength(); ++i)
         {
           if( el.GetValue(i) )
@@ -1617,13 +1582,10 @@ std::vector<double> ImageHelper::GetSpacingValue(File const & f)
         case VR::DS:
             {
             Element<VR::DS,VM::VM1_n> el;
-            std::stringstream ss;
             const ByteValue *bv = de.GetByteValue();
             assert( bv );
-            std::string s = std::string( bv->GetPointer(), bv->GetLength() );
-            ss.str( s );
             el.SetLength( entry.GetVM().GetLength() * entry.GetVR().GetSizeof() );
-            el.Read( ss );
+            el.Read( bv->GetPointer(), bv->GetLength() );
             for(unsigned int i = 0; i < el.GetLength(); ++i)
               {
               const double value = el.GetValue(i);
@@ -41,6 +41,16 @@ struct RealWorldValueMappingContent {
   std::string CodeMeaning;
 };
 
+// Geometry and Modality LUT of one frame, see ImageHelper::GetFrameGeometryValues
+struct FrameGeometry {
+  double Origin[3];
+  double DirectionCosines[6];
+  // Pixel Spacing (column spacing first), then Spacing Between Slices
+  double Spacing[3];
+  double Intercept;
+  double Slope;
+};
+
 /**
  * \brief ImageHelper (internal class, not intended for user level)
  *
@@ -137,6 +147,14 @@ public:
 
   static bool GetDirectionCosinesFromDataSet(DataSet const & ds, std::vector<double> & dircos);
 
+  /// Get the geometry of each frame of an enhanced multi-frame image. The
+  /// Shared and Per-frame Functional Groups Sequences are read in a single
+  /// pass; a functional group missing for a frame keeps its default value
+  /// (no translation, Image Orientation (Patient) of the top level dataset or
+  /// identity, unit spacing, identity Modality LUT).
+  /// Return false when there is no functional group at all.
+  static bool GetFrameGeometryValues(File const & f, std::vector<FrameGeometry> & frames);
+
   //functions to get more information from a file
   //useful for the stream image reader, which fills in necessary image information
   //distinctly from the reader-style data input
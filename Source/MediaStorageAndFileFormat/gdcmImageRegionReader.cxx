@@ -14,6 +14,8 @@
 #include "gdcmImageRegionReader.h"
 #include "gdcmImageHelper.h"
 #include "gdcmBoxRegion.h"
+#include "gdcmFrameIndex.h"
+#include "gdcmJPEG2000TileCache.h"
 
 #include "gdcmRAWCodec.h"
 #include "gdcmRLECodec.h"
@@ -21,9 +23,26 @@
 #include "gdcmJPEGCodec.h"
 #include "gdcmJPEGLSCodec.h"
 
+#if defined(GDCM_HAVE_PREADV)
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#endif
+
 namespace gdcm
 {
 
+// A run of contiguous bytes in the file, going to a run of contiguous bytes
+// in the output buffer
+struct RawExtent
+{
+  std::streamoff Offset;
+  char *Buffer;
+  size_t Length;
+};
+
 class ImageRegionReaderInternals
 {
 public:
@@ -36,6 +55,9 @@ public:
   ~ImageRegionReaderInternals()
     {
     delete TheRegion;
+#if defined(GDCM_HAVE_PREADV)
+    if( FD >= 0 ) close( FD );
+#endif
     }
   void SetRegion(Region const & r)
     {
@@ -55,11 +77,129 @@ public:
   void SetFileOffset( std::streampos f )
     {
     FileOffset = f;
+    Index.Clear();
+    TileCache.Clear();
+    }
+  JPEG2000TileCache &GetTileCache()
+    {
+    return TileCache;
+    }
+  // Frame index of the encapsulated Pixel Data, built once per file
+  const FrameIndex *GetFrameIndex( std::istream &is, unsigned int nframes, const DataSet &ds )
+    {
+    if( !Index.IsValid() )
+      {
+      is.seekg( FileOffset, std::ios::beg );
+      if( !Index.Build( is, nframes, &ds ) )
+        {
+        return nullptr;
+        }
+      }
+    return &Index;
+    }
+  // Read all extents (sorted by Offset). When the file name is known, small
+  // gaps between extents are read into a scratch buffer so that a whole
+  // batch of rows is read by a single preadv call. Otherwise each extent is
+  // read from the stream.
+  bool ReadExtents( std::istream &is, std::string const &filename,
+    std::vector<RawExtent> const &extents )
+    {
+#if defined(GDCM_HAVE_PREADV)
+    if( !filename.empty() && OpenFile( filename ) )
+      {
+      return ReadExtentsVectored( extents );
+      }
+#else
+    (void)filename;
+#endif
+    for( std::vector<RawExtent>::const_iterator it = extents.begin();
+      it != extents.end(); ++it )
+      {
+      is.seekg( it->Offset, std::ios::beg );
+      is.read( it->Buffer, it->Length );
+      if( (size_t)is.gcount() != it->Length ) return false;
+      }
+    return true;
     }
 private:
+#if defined(GDCM_HAVE_PREADV)
+  bool OpenFile( std::string const &filename )
+    {
+    if( FD >= 0 && filename == FDFileName ) return true;
+    if( FD >= 0 ) close( FD );
+    FD = open( filename.c_str(), O_RDONLY );
+    FDFileName = filename;
+    return FD >= 0;
+    }
+  bool ReadExtentsVectored( std::vector<RawExtent> const &extents )
+    {
+#ifdef IOV_MAX
+    const size_t maxiov = IOV_MAX;
+#else
+    const size_t maxiov = 1024;
+#endif
+    // gaps larger than this are skipped with a new call
+    const size_t maxgap = 64 * 1024;
+    Scratch.resize( maxgap );
+    std::vector<struct iovec> iov;
+    size_t i = 0;
+    while( i < extents.size() )
+      {
+      iov.clear();
+      const std::streamoff start = extents[i].Offset;
+      std::streamoff pos = start;
+      for( ; i < extents.size() && iov.size() + 2 <= maxiov; ++i )
+        {
+        const RawExtent &e = extents[i];
+        if( e.Offset < pos || (size_t)(e.Offset - pos) > maxgap ) break;
+        if( e.Offset > pos )
+          {
+          struct iovec gap;
+          gap.iov_base = &Scratch[0];
+          gap.iov_len = (size_t)(e.Offset - pos);
+          iov.push_back( gap );
+          }
+        struct iovec v;
+        v.iov_base = e.Buffer;
+        v.iov_len = e.Length;
+        iov.push_back( v );
+        pos = e.Offset + (std::streamoff)e.Length;
+        }
+      if( iov.empty() ) return false;
+      // preadv may return less than requested, resume after the last byte
+      size_t first = 0;
+      std::streamoff offset = start;
+      while( first < iov.size() )
+        {
+        const ssize_t n = preadv( FD, &iov[first], (int)(iov.size() - first), (off_t)offset );
+        if( n < 0 && errno == EINTR ) continue;
+        if( n <= 0 ) return false;
+        offset += n;
+        size_t remain = (size_t)n;
+        while( first < iov.size() && remain >= iov[first].iov_len )
+          {
+          remain -= iov[first].iov_len;
+          ++first;
+          }
+        if( remain )
+          {
+          iov[first].iov_base = (char*)iov[first].iov_base + remain;
+          iov[first].iov_len -= remain;
+          }
+        }
+      }
+    return true;
+    }
+  int FD{-1};
+  std::string FDFileName;
+  std::vector<char> Scratch;
+#endif
   Region *TheRegion;
   bool Modified;
   std::streamoff FileOffset;
+  FrameIndex Index;
+  // decoded J2K tiles, kept across calls to ReadIntoBuffer
+  JPEG2000TileCache TileCache;
 };
 
 ImageRegionReader::ImageRegionReader()
@@ -127,6 +267,16 @@ size_t ImageRegionReader::ComputeBufferLength() const
   return npixels*bytesPerPixel;
 }
 
+void ImageRegionReader::SetTileCacheSize(size_t bytes)
+{
+  Internals->GetTileCache().SetMaximumSize( bytes );
+}
+
+const JPEG2000TileCache &ImageRegionReader::GetTileCache() const
+{
+  return Internals->GetTileCache();
+}
+
 bool ImageRegionReader::ReadInformation()
 {
   std::set<Tag> st;
@@ -223,7 +373,6 @@ BoxRegion ImageRegionReader::ComputeBoundingBox()
 
 bool ImageRegionReader::ReadRAWIntoBuffer(char *buffer, size_t buflen)
 {
-  (void)buflen;
   std::vector<unsigned int> dimensions = ImageHelper::GetDimensionsValue(GetFile());
   PixelFormat pixelInfo = ImageHelper::GetPixelFormatValue(GetFile());
 
@@ -233,6 +382,11 @@ bool ImageRegionReader::ReadRAWIntoBuffer(char *buffer, size_t buflen)
   bool needbyteswap = (ts == TransferSyntax::ImplicitVRBigEndianPrivateGE || ts == TransferSyntax::ExplicitVRBigEndian );
   RAWCodec theCodec;
   if( !theCodec.CanDecode( ts ) ) return false;
+  if( pixelInfo.GetBitsAllocated() == 12 )
+    {
+    gdcmDebugMacro( "12bits packed data is not supported" );
+    return false;
+    }
   theCodec.SetPlanarConfiguration(
     ImageHelper::GetPlanarConfigurationValue(GetFile()));
   if( ImageHelper::GetPhotometricInterpretationValue(GetFile()) == PhotometricInterpretation::YBR_FULL_422 ) return false;
@@ -257,37 +411,47 @@ bool ImageRegionReader::ReadRAWIntoBuffer(char *buffer, size_t buflen)
   unsigned int rowsize = xmax - xmin + 1;
   unsigned int colsize = ymax - ymin + 1;
   unsigned int bytesPerPixel = pixelInfo.GetPixelSize();
-
-  std::vector<char> buffer1;
-  buffer1.resize( rowsize*bytesPerPixel );
-  char *tmpBuffer1 = buffer1.data();
-  std::vector<char> buffer2;
-  buffer2.resize( rowsize*bytesPerPixel );
-  char *tmpBuffer2 = buffer2.data();
-  unsigned int y, z;
-  std::streamoff theOffset;
-  for (z = zmin; z <= zmax; ++z)
+  const size_t rowlen = (size_t)rowsize * bytesPerPixel;
+  const size_t len = rowlen * colsize * (zmax - zmin + 1);
+  if( len > buflen ) return false;
+
+  // Rows are read straight into the output buffer. Adjacent rows are merged,
+  // so that full rows read as one extent per frame, and full frames as a
+  // single extent.
+  std::vector<RawExtent> extents;
+  for (unsigned int z = zmin; z <= zmax; ++z)
     {
-    for (y = ymin; y <= ymax; ++y)
+    for (unsigned int y = ymin; y <= ymax; ++y)
       {
-      theStream->seekg(std::ios::beg);
-      theOffset = (size_t)Internals->GetFileOffset() + (z*dimensions[1]*dimensions[0] + y*dimensions[0] + xmin)*bytesPerPixel;
-      theStream->seekg(theOffset);
-      theStream->read(tmpBuffer1, rowsize*bytesPerPixel);
-      if (!theCodec.DecodeBytes(tmpBuffer1, rowsize*bytesPerPixel,
-          tmpBuffer2, rowsize*bytesPerPixel))
+      RawExtent e;
+      e.Offset = (std::streamoff)Internals->GetFileOffset() +
+        (std::streamoff)(((size_t)z*dimensions[1]*dimensions[0] + (size_t)y*dimensions[0] + xmin)*bytesPerPixel);
+      e.Buffer = buffer + ((size_t)(z-zmin)*rowsize*colsize + (size_t)(y-ymin)*rowsize)*bytesPerPixel;
+      e.Length = rowlen;
+      if( !extents.empty() )
         {
-        return false;
+        RawExtent &last = extents.back();
+        if( last.Offset + (std::streamoff)last.Length == e.Offset
+          && last.Buffer + last.Length == e.Buffer )
+          {
+          last.Length += e.Length;
+          continue;
+          }
         }
-#if 0
-      const char * check = &(buffer[((z-zmin)*rowsize*colsize + (y-ymin)*rowsize)*bytesPerPixel]);
-      assert( check >= buffer && check < buffer + buflen );
-      assert( check + rowsize*bytesPerPixel <= buffer + buflen );
-#endif
-      memcpy(&(buffer[((z-zmin)*rowsize*colsize + (y-ymin)*rowsize)*bytesPerPixel]),
-        tmpBuffer2, rowsize*bytesPerPixel);
+      extents.push_back( e );
       }
     }
+  if( !Internals->ReadExtents( *theStream, GetFileName(), extents ) )
+    {
+    gdcmErrorMacro( "Could not read Pixel Data" );
+    return false;
+    }
+
+  // byte swapping, overlay cleanup... are done in place, on the whole region
+  if (!theCodec.DecodeBytes(buffer, len, buffer, len))
+    {
+    return false;
+    }
   return true;
 }
 
@@ -329,12 +493,15 @@ bool ImageRegionReader::ReadRLEIntoBuffer(char *buffer, size_t buflen)
   assert( xmax >= xmin );
   assert( ymax >= ymin );
 
+  const FrameIndex *index =
+    Internals->GetFrameIndex( *theStream, d[2], GetFile().GetDataSet() );
+  if( !index ) return false;
   bool ret = theCodec.DecodeExtent(
     buffer,
     xmin, xmax,
     ymin, ymax,
     zmin, zmax,
-    *theStream
+    *theStream, *index
   );
 
   return ret;
@@ -352,6 +519,9 @@ bool ImageRegionReader::ReadJPEG2000IntoBuffer(char *buffer, size_t buflen)
   bool needbyteswap = (ts == TransferSyntax::ImplicitVRBigEndianPrivateGE || ts == TransferSyntax::ExplicitVRBigEndian );
   JPEG2000Codec theCodec;
   if( !theCodec.CanDecode( ts ) ) return false;
+  // A cache of size 0 disables the tile path altogether
+  if( Internals->GetTileCache().GetMaximumSize() )
+    theCodec.SetTileCache( &Internals->GetTileCache() );
   theCodec.SetPlanarConfiguration(
     ImageHelper::GetPlanarConfigurationValue(GetFile()));
   theCodec.SetPhotometricInterpretation(
@@ -378,12 +548,15 @@ bool ImageRegionReader::ReadJPEG2000IntoBuffer(char *buffer, size_t buflen)
   assert( xmax >= xmin );
   assert( ymax >= ymin );
 
+  const FrameIndex *index =
+    Internals->GetFrameIndex( *theStream, d[2], GetFile().GetDataSet() );
+  if( !index ) return false;
   bool ret = theCodec.DecodeExtent(
     buffer,
     xmin, xmax,
     ymin, ymax,
     zmin, zmax,
-    *theStream
+    *theStream, *index
   );
 
   return ret;
@@ -428,12 +601,15 @@ bool ImageRegionReader::ReadJPEGIntoBuffer(char *buffer, size_t buflen)
   assert( xmax >= xmin );
   assert( ymax >= ymin );
 
+  const FrameIndex *index =
+    Internals->GetFrameIndex( *theStream, d[2], GetFile().GetDataSet() );
+  if( !index ) return false;
   bool ret = theCodec.DecodeExtent(
     buffer,
     xmin, xmax,
     ymin, ymax,
     zmin, zmax,
-    *theStream
+    *theStream, *index
   );
 
   return ret;
@@ -477,12 +653,15 @@ bool ImageRegionReader::ReadJPEGLSIntoBuffer(char *buffer, size_t buflen)
   assert( xmax >= xmin );
   assert( ymax >= ymin );
 
+  const FrameIndex *index =
+    Internals->GetFrameIndex( *theStream, d[2], GetFile().GetDataSet() );
+  if( !index ) return false;
   bool ret = theCodec.DecodeExtent(
     buffer,
     xmin, xmax,
     ymin, ymax,
     zmin, zmax,
-    *theStream
+    *theStream, *index
   );
 
   return ret;
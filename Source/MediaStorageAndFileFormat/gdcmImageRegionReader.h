@@ -22,6 +22,7 @@ namespace gdcm
 {
 
 class ImageRegionReaderInternals;
+class JPEG2000TileCache;
 /**
  * \brief ImageRegionReader
  * \details This class is able to read a region from a DICOM file containing an image. This implementation
@@ -56,6 +57,13 @@ public:
   /// \return false upon error
   bool ReadIntoBuffer(char *inreadbuffer, size_t buflen);
 
+  /// Decoded JPEG 2000 tiles are kept from one ReadIntoBuffer call to the
+  /// next, so that overlapping regions of a tiled codestream are not decoded
+  /// twice. Set the maximum amount of memory used (default 64MB, 0 disables
+  /// the cache)
+  void SetTileCacheSize(size_t bytes);
+  const JPEG2000TileCache &GetTileCache() const;
+
 protected:
   /// To prevent user from calling super class Read() function
   bool Read() override;
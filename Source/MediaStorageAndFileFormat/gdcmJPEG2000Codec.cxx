@@ -17,10 +17,14 @@
 #include "gdcmDataElement.h"
 #include "gdcmSequenceOfFragments.h"
 #include "gdcmSwapper.h"
+#include "gdcmFrameIndex.h"
+#include "gdcmJPEG2000TileCache.h"
 
 #include <cstring>
 #include <cstdio> // snprintf
 #include <numeric>
+#include <algorithm>
+#include <set>
 #if defined(_MSC_VER) && (_MSC_VER < 1900)
 #define snprintf _snprintf
 #endif
@@ -390,6 +394,17 @@ inline int int_ceildivpow2(int a, int b) {
   return (a + (1 << b) - 1) >> b;
 }
 
+// opj_codec_set_threads is only available starting with OpenJPEG 2.3
+static inline void SetDecompressionThreads(opj_codec_t *codec, int nthreads)
+{
+#if ((OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3) || (OPJ_VERSION_MAJOR > 2))
+  opj_codec_set_threads(codec, nthreads);
+#else
+  (void)codec;
+  (void)nthreads;
+#endif
+}
+
 class JPEG2000Internals
 {
 public:
@@ -402,6 +417,7 @@ public:
 
   opj_cparameters coder_param;
   int nNumberOfThreadsForDecompression{ -1 };
+  JPEG2000TileCache *TileCache{ nullptr };
 };
 
 void JPEG2000Codec::SetRate(unsigned int idx, double rate)
@@ -685,9 +701,7 @@ std::pair<char *, size_t> JPEG2000Codec::DecodeByStreamsCommon(char *dummy_buffe
     gdcmErrorMacro( "Impossible happen" );
     return std::pair<char*,size_t>(nullptr,0);
     }
-#if ((OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3) || (OPJ_VERSION_MAJOR > 2))
-  opj_codec_set_threads(dinfo, Internals->nNumberOfThreadsForDecompression);
-#endif
+  SetDecompressionThreads(dinfo, Internals->nNumberOfThreadsForDecompression);
 
   int reversible;
   myfile mysrc;
@@ -1395,6 +1409,11 @@ bool JPEG2000Codec::Code(DataElement const &in, DataElement &out)
     }
 
   assert( sq->GetNumberOfFragments() == dims[2] );
+  // one fragment per frame, so that readers can seek to any frame
+  if( dims[2] > 1 && !sq->FillBasicOffsetTable() )
+    {
+    gdcmDebugMacro( "Offsets do not fit in Basic Offset Table" );
+    }
   out.SetValue( *sq );
 
   return true;
@@ -1457,9 +1476,7 @@ bool JPEG2000Codec::GetHeaderInfo(const char * dummy_buffer, size_t buf_size, Tr
     return false;
     }
 
-#if ((OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 3) || (OPJ_VERSION_MAJOR > 2)) 
-  opj_codec_set_threads(dinfo, Internals->nNumberOfThreadsForDecompression);
-#endif
+  SetDecompressionThreads(dinfo, Internals->nNumberOfThreadsForDecompression);
 
   myfile mysrc;
   myfile *fsrc = &mysrc;
@@ -1684,18 +1701,52 @@ bool JPEG2000Codec::DecodeExtent(
   std::istream & is
 )
 {
-  BasicOffsetTable bot;
-  bot.Read<SwapperNoOp>( is );
+  FrameIndex index;
+  if( !index.Build( is, NumberOfDimensions == 3 ? Dimensions[2] : 1 ) )
+    {
+    gdcmErrorMacro( "Could not locate frames" );
+    return false;
+    }
+  return DecodeExtent( buffer, xmin, xmax, ymin, ymax, zmin, zmax, is, index );
+}
 
+bool JPEG2000Codec::DecodeExtent(
+  char *buffer,
+  unsigned int xmin, unsigned int xmax,
+  unsigned int ymin, unsigned int ymax,
+  unsigned int zmin, unsigned int zmax,
+  std::istream & is, FrameIndex const & index
+)
+{
   const unsigned int * dimensions = this->GetDimensions();
   // retrieve pixel format *after* DecodeByStreamsCommon !
   const PixelFormat pf = this->GetPixelFormat(); // make a copy !
   assert( pf.GetBitsAllocated() % 8 == 0 );
   assert( pf != PixelFormat::SINGLEBIT );
   assert( pf != PixelFormat::UINT12 && pf != PixelFormat::INT12 );
+  if( zmax >= index.GetNumberOfFrames() )
+    {
+    gdcmErrorMacro( "Frame " << zmax << " is out of range" );
+    return false;
+    }
+
+  if( Internals->TileCache )
+    {
+    const size_t framelen =
+      (size_t)(xmax - xmin + 1) * (ymax - ymin + 1) * pf.GetPixelSize();
+    bool tiled = true;
+    for( unsigned int z = zmin; z <= zmax && tiled; ++z )
+      {
+      tiled = DecodeExtentFromTiles( buffer + (z - zmin) * framelen,
+        xmin, xmax, ymin, ymax, z, is, index );
+      }
+    if( tiled ) return true;
+    // fall back to whole frame decoding
+    }
 
   if( NumberOfDimensions == 2 )
     {
+    is.seekg( index.GetFrameOffset( 0 ), std::ios::beg );
     char *dummy_buffer = nullptr;
     std::vector<char> vdummybuffer;
     size_t buf_size = 0;
@@ -1755,40 +1806,11 @@ bool JPEG2000Codec::DecodeExtent(
     }
   else if ( NumberOfDimensions == 3 )
     {
-    const Tag seqDelItem(0xfffe,0xe0dd);
-    Fragment frag;
-    std::streamoff thestart = is.tellg();
-    unsigned int numfrags = 0;
-    std::vector< size_t > offsets;
-    while( frag.ReadPreValue<SwapperNoOp>(is) && frag.GetTag() != seqDelItem )
-      {
-      //std::streamoff relstart = is.tellg();
-      //assert( relstart - thestart == 8 );
-      std::streamoff off = frag.GetVL();
-      offsets.push_back( (size_t)off );
-      is.seekg( off, std::ios::cur );
-      ++numfrags;
-      }
-    assert( frag.GetTag() == seqDelItem && frag.GetVL() == 0 );
-    assert( numfrags == offsets.size() );
-    if( numfrags != Dimensions[2] )
-      {
-      gdcmErrorMacro( "Not handled" );
-      return false;
-      }
-
+    std::vector<char> vframe;
     for( unsigned int z = zmin; z <= zmax; ++z )
       {
-      size_t curoffset = std::accumulate( offsets.begin(), offsets.begin() + z, size_t(0) );
-      is.seekg( thestart + curoffset + 8 * z, std::ios::beg );
-      is.seekg( 8, std::ios::cur );
-
-      const size_t buf_size = offsets[z];
-      char *dummy_buffer = new char[ buf_size ];
-      is.read( dummy_buffer, buf_size );
-      std::pair<char*,size_t> raw_len = this->DecodeByStreamsCommon(dummy_buffer, buf_size);
-      /* free the memory containing the code-stream */
-      delete[] dummy_buffer;
+      if( !index.ReadFrame( is, z, vframe ) ) return false;
+      std::pair<char*,size_t> raw_len = this->DecodeByStreamsCommon(vframe.data(), vframe.size());
       if( !raw_len.first || !raw_len.second ) return false;
       // check pixel format *after* DecodeByStreamsCommon !
       const PixelFormat & pf2 = this->GetPixelFormat();
@@ -1821,9 +1843,226 @@ bool JPEG2000Codec::DecodeExtent(
   return true;
 }
 
+namespace
+{
+// Decoder of the tiles of one J2K (or JP2) frame, held in memory
+class TileDecoder
+{
+public:
+  TileDecoder():Codec(nullptr),Stream(nullptr),Image(nullptr) {}
+  ~TileDecoder()
+    {
+    if( Stream ) opj_stream_destroy( Stream );
+    if( Codec ) opj_destroy_codec( Codec );
+    if( Image ) opj_image_destroy( Image );
+    }
+  bool Open( std::vector<char> &frame, int nthreads )
+    {
+    const unsigned char *src = (const unsigned char*)frame.data();
+    size_t len = frame.size();
+    // same as DecodeByStreamsCommon: remove anything after EOC
+    while( len > 0 && src[len-1] != 0xd9 ) --len;
+    if( len == 0 ) return false;
+    const char jp2magic[] = "\x00\x00\x00\x0C\x6A\x50\x20\x20\x0D\x0A\x87\x0A";
+    const bool isjp2 = len >= sizeof(jp2magic)
+      && memcmp( src, jp2magic, sizeof(jp2magic) ) == 0;
+    Codec = opj_create_decompress( isjp2 ? CODEC_JP2 : CODEC_J2K );
+    if( !Codec ) return false;
+    SetDecompressionThreads( Codec, nthreads );
+    opj_set_error_handler( Codec, gdcm_error_callback, nullptr );
+    opj_dparameters_t parameters;
+    opj_set_default_decoder_parameters( &parameters );
+    if( !opj_setup_decoder( Codec, &parameters ) ) return false;
+    Mem.mem = Mem.cur = &frame[0];
+    Mem.len = len;
+    Stream = opj_stream_create_memory_stream( &Mem, OPJ_J2K_STREAM_CHUNK_SIZE, true );
+    return Stream && opj_read_header( Stream, Codec, &Image ) && Image;
+    }
+  // Tile grid, Tiled is false when tiles cannot be copied as is into the
+  // output (offset image, sub-sampling, precision not matching pf)
+  JPEG2000TileCache::Grid GetGrid( const unsigned int *dims, PixelFormat const &pf ) const
+    {
+    JPEG2000TileCache::Grid grid = {};
+    opj_codestream_info_v2_t *info = opj_get_cstr_info( Codec );
+    if( !info ) return grid;
+    grid.TileWidth = info->tdx;
+    grid.TileHeight = info->tdy;
+    grid.TilesX = info->tw;
+    grid.TilesY = info->th;
+    grid.Tiled = info->tx0 == 0 && info->ty0 == 0
+      && Image->x0 == 0 && Image->y0 == 0
+      && Image->x1 == dims[0] && Image->y1 == dims[1]
+      && grid.TileWidth && grid.TileHeight
+      && Image->numcomps == pf.GetSamplesPerPixel();
+    for( unsigned int c = 0; grid.Tiled && c < Image->numcomps; ++c )
+      {
+      const opj_image_comp_t &comp = Image->comps[c];
+      // decoded samples are 1, 2 or 4 bytes depending on precision
+      const unsigned int compsize = comp.prec <= 8 ? 1 : comp.prec <= 16 ? 2 : 4;
+      grid.Tiled = comp.dx == 1 && comp.dy == 1
+        && compsize * 8 == pf.GetBitsAllocated()
+        && (unsigned int)comp.sgnd == pf.GetPixelRepresentation();
+      }
+    opj_destroy_cstr_info( &info );
+    return grid;
+    }
+  opj_codec_t *Codec;
+  opj_stream_t *Stream;
+  opj_image_t *Image;
+private:
+  myfile Mem;
+};
+
+// Copy the part of tile within [xmin,xmax] x [ymin,ymax] into out (which
+// holds this region)
+void CopyTile( JPEG2000TileCache::Tile const &t, size_t pixelsize,
+  unsigned int xmin, unsigned int xmax, unsigned int ymin, unsigned int ymax,
+  char *out )
+{
+  const unsigned int x0 = std::max( t.X0, xmin );
+  const unsigned int x1 = std::min( t.X1 - 1, xmax );
+  const unsigned int y0 = std::max( t.Y0, ymin );
+  const unsigned int y1 = std::min( t.Y1 - 1, ymax );
+  if( x0 > x1 || y0 > y1 ) return;
+  const size_t tilerow = (size_t)(t.X1 - t.X0) * pixelsize;
+  const size_t outrow = (size_t)(xmax - xmin + 1) * pixelsize;
+  const size_t len = (size_t)(x1 - x0 + 1) * pixelsize;
+  for( unsigned int y = y0; y <= y1; ++y )
+    {
+    memcpy( out + (y - ymin) * outrow + (x0 - xmin) * pixelsize,
+      &t.Data[(y - t.Y0) * tilerow + (x0 - t.X0) * pixelsize], len );
+    }
+}
+}
+
+void JPEG2000Codec::SetTileCache(JPEG2000TileCache *cache)
+{
+  Internals->TileCache = cache;
+}
+
+bool JPEG2000Codec::DecodeExtentFromTiles(
+  char *out,
+  unsigned int xmin, unsigned int xmax,
+  unsigned int ymin, unsigned int ymax,
+  unsigned int z,
+  std::istream & is, FrameIndex const & index
+)
+{
+  JPEG2000TileCache *cache = Internals->TileCache;
+  const PixelFormat &pf = this->GetPixelFormat();
+  const unsigned int *dimensions = this->GetDimensions();
+  const unsigned int resolution = 0; // always full resolution
+  const size_t pixelsize = pf.GetPixelSize();
+  const size_t bps = pf.GetBitsAllocated() / 8;
+
+  std::vector<char> frame;
+  TileDecoder decoder;
+  const JPEG2000TileCache::Grid *grid = cache->GetGrid( z );
+  if( !grid )
+    {
+    if( !index.ReadFrame( is, z, frame )
+      || !decoder.Open( frame, Internals->nNumberOfThreadsForDecompression ) )
+      {
+      return false;
+      }
+    cache->SetGrid( z, decoder.GetGrid( dimensions, pf ) );
+    grid = cache->GetGrid( z );
+    }
+  if( !grid->Tiled ) return false;
+
+  // copy cached tiles, and compute the bounding box of the missing ones
+  const unsigned int tx0 = xmin / grid->TileWidth;
+  const unsigned int tx1 = xmax / grid->TileWidth;
+  const unsigned int ty0 = ymin / grid->TileHeight;
+  const unsigned int ty1 = ymax / grid->TileHeight;
+  unsigned int mx0 = tx1 + 1, mx1 = 0, my0 = ty1 + 1, my1 = 0;
+  std::set<unsigned int> missing;
+  for( unsigned int ty = ty0; ty <= ty1; ++ty )
+    for( unsigned int tx = tx0; tx <= tx1; ++tx )
+      {
+      const unsigned int tileindex = ty * grid->TilesX + tx;
+      const JPEG2000TileCache::Tile *t = cache->Find( z, tileindex, resolution );
+      if( t )
+        {
+        CopyTile( *t, pixelsize, xmin, xmax, ymin, ymax, out );
+        }
+      else
+        {
+        missing.insert( tileindex );
+        mx0 = std::min( mx0, tx ); mx1 = std::max( mx1, tx );
+        my0 = std::min( my0, ty ); my1 = std::max( my1, ty );
+        }
+      }
+  if( missing.empty() ) return true;
+
+  if( frame.empty() )
+    {
+    if( !index.ReadFrame( is, z, frame )
+      || !decoder.Open( frame, Internals->nNumberOfThreadsForDecompression ) )
+      {
+      return false;
+      }
+    }
+  // decode area on tile boundaries, so that whole tiles are decoded
+  if( !opj_set_decode_area( decoder.Codec, decoder.Image,
+      (OPJ_INT32)(mx0 * grid->TileWidth), (OPJ_INT32)(my0 * grid->TileHeight),
+      (OPJ_INT32)std::min( (mx1 + 1) * grid->TileWidth, dimensions[0] ),
+      (OPJ_INT32)std::min( (my1 + 1) * grid->TileHeight, dimensions[1] ) ) )
+    {
+    return false;
+    }
+  const unsigned int ncomps = pf.GetSamplesPerPixel();
+  std::vector<OPJ_BYTE> data;
+  for( ;; )
+    {
+    OPJ_UINT32 tileindex, datasize, nbcomps;
+    OPJ_INT32 x0, y0, x1, y1;
+    OPJ_BOOL goon;
+    if( !opj_read_tile_header( decoder.Codec, decoder.Stream, &tileindex,
+        &datasize, &x0, &y0, &x1, &y1, &nbcomps, &goon ) )
+      {
+      return false;
+      }
+    if( !goon ) break;
+    data.resize( datasize );
+    if( nbcomps != ncomps || !opj_decode_tile_data( decoder.Codec, tileindex,
+        data.data(), datasize, decoder.Stream ) )
+      {
+      return false;
+      }
+    JPEG2000TileCache::Tile t;
+    t.X0 = x0; t.Y0 = y0; t.X1 = x1; t.Y1 = y1;
+    const size_t npixels = (size_t)(x1 - x0) * (y1 - y0);
+    if( datasize < npixels * pixelsize ) return false;
+    // one plane per component, interleave them
+    t.Data.resize( npixels * pixelsize );
+    for( unsigned int c = 0; c < ncomps; ++c )
+      {
+      const OPJ_BYTE *plane = data.data() + c * npixels * bps;
+      char *dest = &t.Data[c * bps];
+      if( ncomps == 1 )
+        {
+        memcpy( dest, plane, npixels * bps );
+        continue;
+        }
+      for( size_t i = 0; i < npixels; ++i, plane += bps, dest += pixelsize )
+        memcpy( dest, plane, bps );
+      }
+    CopyTile( t, pixelsize, xmin, xmax, ymin, ymax, out );
+    cache->Insert( z, tileindex, resolution, t );
+    missing.erase( tileindex );
+    }
+  return missing.empty();
+}
+
 ImageCodec * JPEG2000Codec::Clone() const
 {
   JPEG2000Codec * copy = new JPEG2000Codec;
+  ImageCodec &ic = *copy;
+  ic = *this;
+  // encoding parameters, but not the tile cache of this instance
+  copy->Internals->coder_param = Internals->coder_param;
+  copy->Internals->nNumberOfThreadsForDecompression = Internals->nNumberOfThreadsForDecompression;
   return copy;
 }
 
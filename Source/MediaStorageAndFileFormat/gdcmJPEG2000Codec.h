@@ -19,6 +19,8 @@
 namespace gdcm
 {
 
+class FrameIndex;
+class JPEG2000TileCache;
 class JPEG2000Internals;
 /**
  * \brief Class to do JPEG 2000
@@ -71,6 +73,16 @@ protected:
     unsigned int zmin, unsigned int zmax,
     std::istream & is
   );
+  /// Same as above, frames are located with index (no fragment walk)
+  bool DecodeExtent(
+    char *buffer,
+    unsigned int xmin, unsigned int xmax,
+    unsigned int ymin, unsigned int ymax,
+    unsigned int zmin, unsigned int zmax,
+    std::istream & is, FrameIndex const & index
+  );
+  /// Decoded tiles are looked up in / stored into cache by DecodeExtent
+  void SetTileCache(JPEG2000TileCache *cache);
 
   bool DecodeByStreams(std::istream &is, std::ostream &os) override;
 
@@ -83,6 +95,16 @@ protected:
 
 private:
   std::pair<char *, size_t> DecodeByStreamsCommon(char *dummy_buffer, size_t buf_size);
+  /// Decode region of frame z from the tiles it intersects, only the tiles
+  /// missing from the cache are decoded. Return false when the frame is not
+  /// suitable (eg. not the same precision as the Pixel Format)
+  bool DecodeExtentFromTiles(
+    char *out,
+    unsigned int xmin, unsigned int xmax,
+    unsigned int ymin, unsigned int ymax,
+    unsigned int z,
+    std::istream & is, FrameIndex const & index
+  );
   bool CodeFrameIntoBuffer(char * outdata, size_t outlen, size_t & complen, const char * indata, size_t inlen );
   bool GetHeaderInfo(const char * dummy_buffer, size_t len, TransferSyntax &ts);
   JPEG2000Internals *Internals;
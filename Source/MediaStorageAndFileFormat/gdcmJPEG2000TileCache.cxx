@@ -0,0 +1,104 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmJPEG2000TileCache.h"
+
+namespace gdcm
+{
+
+JPEG2000TileCache::JPEG2000TileCache():
+  MaximumSize(64 * 1024 * 1024),
+  Size(0),
+  Hits(0),
+  Misses(0)
+{
+}
+
+void JPEG2000TileCache::SetMaximumSize(size_t bytes)
+{
+  MaximumSize = bytes;
+  Shrink( MaximumSize );
+}
+
+void JPEG2000TileCache::Clear()
+{
+  Tiles.clear();
+  Lookup.clear();
+  Grids.clear();
+  Size = 0;
+}
+
+void JPEG2000TileCache::SetGrid(unsigned int frame, Grid const &grid)
+{
+  Grids[frame] = grid;
+}
+
+const JPEG2000TileCache::Grid *JPEG2000TileCache::GetGrid(unsigned int frame) const
+{
+  std::map<unsigned int, Grid>::const_iterator it = Grids.find( frame );
+  if( it == Grids.end() ) return nullptr;
+  return &it->second;
+}
+
+const JPEG2000TileCache::Tile *JPEG2000TileCache::Find(unsigned int frame,
+  unsigned int tile, unsigned int resolution)
+{
+  Key k = { frame, tile, resolution };
+  std::map<Key, TileList::iterator>::const_iterator it = Lookup.find( k );
+  if( it == Lookup.end() )
+    {
+    ++Misses;
+    return nullptr;
+    }
+  ++Hits;
+  // move to front, iterators stay valid
+  Tiles.splice( Tiles.begin(), Tiles, it->second );
+  return &it->second->second;
+}
+
+void JPEG2000TileCache::Insert(unsigned int frame, unsigned int tile,
+  unsigned int resolution, Tile &t)
+{
+  const size_t len = t.Data.size();
+  if( len > MaximumSize ) return;
+  Key k = { frame, tile, resolution };
+  std::map<Key, TileList::iterator>::iterator it = Lookup.find( k );
+  if( it != Lookup.end() )
+    {
+    Size -= it->second->second.Data.size();
+    Tiles.erase( it->second );
+    Lookup.erase( it );
+    }
+  Shrink( MaximumSize - len );
+  Tiles.push_front( std::make_pair( k, Tile() ) );
+  Tile &dest = Tiles.front().second;
+  dest.X0 = t.X0;
+  dest.Y0 = t.Y0;
+  dest.X1 = t.X1;
+  dest.Y1 = t.Y1;
+  dest.Data.swap( t.Data );
+  Lookup[k] = Tiles.begin();
+  Size += len;
+}
+
+void JPEG2000TileCache::Shrink(size_t maxsize)
+{
+  while( Size > maxsize && !Tiles.empty() )
+    {
+    Size -= Tiles.back().second.Data.size();
+    Lookup.erase( Tiles.back().first );
+    Tiles.pop_back();
+    }
+}
+
+} // end namespace gdcm
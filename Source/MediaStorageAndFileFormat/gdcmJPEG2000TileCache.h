@@ -0,0 +1,112 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMJPEG2000TILECACHE_H
+#define GDCMJPEG2000TILECACHE_H
+
+#include "gdcmTypes.h"
+
+#include <vector>
+#include <list>
+#include <map>
+
+namespace gdcm
+{
+
+/**
+ * \brief JPEG2000TileCache
+ * \details Keep decoded JPEG 2000 tiles of the frames of one Pixel Data,
+ * so that overlapping region reads do not decode the same tiles again (see
+ * gdcmconv -t to produce tiled codestreams).
+ *
+ * Tiles are keyed by frame, tile index and resolution (number of discarded
+ * resolution levels, 0 is full resolution) and stored with the output pixel
+ * layout (samples interleaved). The least recently used tiles are discarded
+ * once the total size goes above GetMaximumSize().
+ *
+ * \see ImageRegionReader JPEG2000Codec
+ */
+class GDCM_EXPORT JPEG2000TileCache
+{
+public:
+  /// Tile grid of a frame, as found in the SIZ marker
+  struct Grid
+  {
+    /// false when the codestream cannot be decoded tile by tile
+    bool Tiled;
+    unsigned int TileWidth, TileHeight;
+    unsigned int TilesX, TilesY;
+  };
+
+  /// A decoded tile, covering [X0,X1[ x [Y0,Y1[ in the frame
+  struct Tile
+  {
+    unsigned int X0, Y0, X1, Y1;
+    std::vector<char> Data;
+  };
+
+  JPEG2000TileCache();
+
+  /// Set/Get the maximum number of bytes of decoded tiles. 0 disables the
+  /// cache. Default is 64MB
+  void SetMaximumSize(size_t bytes);
+  size_t GetMaximumSize() const { return MaximumSize; }
+
+  /// Current number of bytes of decoded tiles
+  size_t GetSize() const { return Size; }
+
+  /// Forget every frame (call when the Pixel Data changes)
+  void Clear();
+
+  /// Set/Get tile grid of frame
+  void SetGrid(unsigned int frame, Grid const &grid);
+  const Grid *GetGrid(unsigned int frame) const;
+
+  /// Return the cached tile (and mark it as most recently used), or nullptr
+  const Tile *Find(unsigned int frame, unsigned int tileindex, unsigned int resolution);
+
+  /// Store tile, possibly discarding the least recently used tiles. The
+  /// content of tile is moved into the cache.
+  void Insert(unsigned int frame, unsigned int tileindex, unsigned int resolution, Tile &tile);
+
+  /// Number of Find calls which returned a tile / nullptr
+  unsigned long GetNumberOfHits() const { return Hits; }
+  unsigned long GetNumberOfMisses() const { return Misses; }
+
+private:
+  struct Key
+  {
+    unsigned int Frame, TileIndex, Resolution;
+    bool operator<(Key const &k) const
+      {
+      if( Frame != k.Frame ) return Frame < k.Frame;
+      if( TileIndex != k.TileIndex ) return TileIndex < k.TileIndex;
+      return Resolution < k.Resolution;
+      }
+  };
+  typedef std::list< std::pair<Key, Tile> > TileList;
+  void Shrink(size_t maxsize);
+
+  size_t MaximumSize;
+  size_t Size;
+  unsigned long Hits;
+  unsigned long Misses;
+  // most recently used first
+  TileList Tiles;
+  std::map<Key, TileList::iterator> Lookup;
+  std::map<unsigned int, Grid> Grids;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMJPEG2000TILECACHE_H
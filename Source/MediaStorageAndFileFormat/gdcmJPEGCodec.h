@@ -19,6 +19,7 @@
 namespace gdcm
 {
 
+class FrameIndex;
 class PixelFormat;
 class TransferSyntax;
 /**
@@ -76,6 +77,14 @@ protected:
     unsigned int zmin, unsigned int zmax,
     std::istream & is
   );
+  /// Same as above, frames are located with index (no fragment walk)
+  bool DecodeExtent(
+    char *buffer,
+    unsigned int xmin, unsigned int xmax,
+    unsigned int ymin, unsigned int ymax,
+    unsigned int zmin, unsigned int zmax,
+    std::istream & is, FrameIndex const & index
+  );
 
   bool DecodeByStreams(std::istream &is, std::ostream &os) override;
   bool IsValid(PhotometricInterpretation const &pi) override;
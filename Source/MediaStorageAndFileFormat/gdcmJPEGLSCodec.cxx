@@ -16,6 +16,7 @@
 #include "gdcmSequenceOfFragments.h"
 #include "gdcmDataElement.h"
 #include "gdcmSwapper.h"
+#include "gdcmFrameIndex.h"
 
 #include <numeric>
 #include <cstring> // memcpy
@@ -441,6 +442,11 @@ bool JPEGLSCodec::Code(DataElement const &in, DataElement &out)
     }
 
   assert( sq->GetNumberOfFragments() == dims[2] );
+  // one fragment per frame, so that readers can seek to any frame
+  if( dims[2] > 1 && !sq->FillBasicOffsetTable() )
+    {
+    gdcmDebugMacro( "Offsets do not fit in Basic Offset Table" );
+    }
   out.SetValue( *sq );
 
   return true;
@@ -468,17 +474,37 @@ bool JPEGLSCodec::DecodeExtent(
     std::istream & is
   )
 {
-  BasicOffsetTable bot;
-  bot.Read<SwapperNoOp>( is );
+  FrameIndex index;
+  if( !index.Build( is, NumberOfDimensions == 3 ? Dimensions[2] : 1 ) )
+    {
+    gdcmErrorMacro( "Could not locate frames" );
+    return false;
+    }
+  return DecodeExtent( buffer, xmin, xmax, ymin, ymax, zmin, zmax, is, index );
+}
 
+bool JPEGLSCodec::DecodeExtent(
+    char *buffer,
+    unsigned int xmin, unsigned int xmax,
+    unsigned int ymin, unsigned int ymax,
+    unsigned int zmin, unsigned int zmax,
+    std::istream & is, FrameIndex const & index
+  )
+{
   const unsigned int * dimensions = this->GetDimensions();
   const PixelFormat & pf = this->GetPixelFormat();
   assert( pf.GetBitsAllocated() % 8 == 0 );
   assert( pf != PixelFormat::SINGLEBIT );
   assert( pf != PixelFormat::UINT12 && pf != PixelFormat::INT12 );
+  if( zmax >= index.GetNumberOfFrames() )
+    {
+    gdcmErrorMacro( "Frame " << zmax << " is out of range" );
+    return false;
+    }
 
   if( NumberOfDimensions == 2 )
     {
+    is.seekg( index.GetFrameOffset( 0 ), std::ios::beg );
     char *dummy_buffer = nullptr;
     std::vector<char> vdummybuffer;
     size_t buf_size = 0;
@@ -528,41 +554,13 @@ bool JPEGLSCodec::DecodeExtent(
     }
   else if ( NumberOfDimensions == 3 )
     {
-    const Tag seqDelItem(0xfffe,0xe0dd);
-    Fragment frag;
-    std::streamoff thestart = is.tellg();
-    unsigned int numfrags = 0;
-    std::vector< size_t > offsets;
-    while( frag.ReadPreValue<SwapperNoOp>(is) && frag.GetTag() != seqDelItem )
-      {
-      //std::streamoff relstart = is.tellg();
-      //assert( relstart - thestart == 8 );
-      std::streamoff off = frag.GetVL();
-      offsets.push_back( (size_t)off );
-      is.seekg( off, std::ios::cur );
-      ++numfrags;
-      }
-    assert( frag.GetTag() == seqDelItem && frag.GetVL() == 0 );
-    assert( numfrags == offsets.size() );
-    if( numfrags != Dimensions[2] )
-      {
-      gdcmErrorMacro( "Not handled" );
-      return false;
-      }
-
+    std::vector<char> vframe;
     for( unsigned int z = zmin; z <= zmax; ++z )
       {
-      size_t curoffset = std::accumulate( offsets.begin(), offsets.begin() + z, size_t(0) );
-      is.seekg( thestart + curoffset + 8 * z, std::ios::beg );
-      is.seekg( 8, std::ios::cur );
-
-      const size_t buf_size = offsets[z];
-      char *dummy_buffer = new char[ buf_size ];
-      is.read( dummy_buffer, buf_size );
+      if( !index.ReadFrame( is, z, vframe ) ) return false;
 
       std::vector <unsigned char> outv;
-      bool b = DecodeByStreamsCommon(dummy_buffer, buf_size, outv);
-      delete[] dummy_buffer;
+      bool b = DecodeByStreamsCommon(vframe.data(), vframe.size(), outv);
 
       if( !b ) return false;
 
@@ -594,6 +592,9 @@ bool JPEGLSCodec::DecodeExtent(
 ImageCodec * JPEGLSCodec::Clone() const
 {
   JPEGLSCodec * copy = new JPEGLSCodec;
+  ImageCodec &ic = *copy;
+  ic = *this;
+  copy->LossyError = LossyError;
   return copy;
 }
 
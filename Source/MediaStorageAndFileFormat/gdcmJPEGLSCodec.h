@@ -19,6 +19,7 @@
 namespace gdcm
 {
 
+class FrameIndex;
 class JPEGLSInternals;
 /**
  * \brief JPEG-LS
@@ -72,6 +73,14 @@ protected:
     unsigned int zmin, unsigned int zmax,
     std::istream & is
   );
+  /// Same as above, frames are located with index (no fragment walk)
+  bool DecodeExtent(
+    char *buffer,
+    unsigned int xmin, unsigned int xmax,
+    unsigned int ymin, unsigned int ymax,
+    unsigned int zmin, unsigned int zmax,
+    std::istream & is, FrameIndex const & index
+  );
 
   bool StartEncode( std::ostream & ) override;
   bool IsRowEncoder() override;
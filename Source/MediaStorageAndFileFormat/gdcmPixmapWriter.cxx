@@ -23,6 +23,8 @@
 #include "gdcmLookupTable.h"
 #include "gdcmItem.h"
 #include "gdcmSequenceOfItems.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmSwapper.h"
 
 namespace gdcm
 {
@@ -642,6 +644,41 @@ bool PixmapWriter::PrepareWrite( MediaStorage const & ref_ms )
     ds.Replace( depixdata );
     }
 
+  // Extended Offset Table: only needed when the Basic Offset Table cannot
+  // address all the frames (> 4GB)
+  const Tag teot(0x7fe0,0x0001);
+  const Tag teotlengths(0x7fe0,0x0002);
+  const SequenceOfFragments *sqf = depixdata.GetSequenceOfFragments();
+  const unsigned int nframes =
+    PixelData->GetNumberOfDimensions() > 2 ? PixelData->GetDimension(2) : 1;
+  if( sqf && sqf->GetTable().GetVL() == 0 && nframes > 1
+    && sqf->GetNumberOfFragments() == nframes )
+    {
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> lengths;
+    sqf->ComputeFragmentOffsets( offsets, lengths );
+    if( offsets.back() > 0xFFFFFFFF || ds.FindDataElement( teot ) )
+      {
+      SwapperNoOp::SwapArray( &offsets[0], offsets.size() );
+      SwapperNoOp::SwapArray( &lengths[0], lengths.size() );
+      const uint32_t len = (uint32_t)(nframes * sizeof(uint64_t));
+      DataElement deeot( teot );
+      deeot.SetVR( VR::OV );
+      deeot.SetByteValue( (char*)&offsets[0], len );
+      ds.Replace( deeot );
+      DataElement deeotlengths( teotlengths );
+      deeotlengths.SetVR( VR::OV );
+      deeotlengths.SetByteValue( (char*)&lengths[0], len );
+      ds.Replace( deeotlengths );
+      }
+    }
+  else if( !pde.IsEmpty() && ( !sqf || sqf->GetTable().GetVL() != 0 ) )
+    {
+    // Any previous table does not describe this Pixel Data
+    ds.Remove( teot );
+    ds.Remove( teotlengths );
+    }
+
   // Do Icon Image
   DoIconImage(ds, GetPixmap());
 
@@ -90,7 +90,13 @@ bool RAWCodec::DecodeBytes(const char* inBytes, size_t inBufferLength,
     // pixel of the tiled image.
     // removal of this assert also solve an issue with: SIEMENS_GBS_III-16-ACR_NEMA_1.acr
     // where we need to discard trailing pixel data bytes.
-    if( inOutBufferLength <= inBufferLength )
+    // in-place decoding (outBytes == inBytes) is a no-op
+    if( outBytes == inBytes )
+      {
+      if( inOutBufferLength > inBufferLength )
+        gdcmWarningMacro( "Requesting too much data. Truncating result" );
+      }
+    else if( inOutBufferLength <= inBufferLength )
       {
       memcpy(outBytes, inBytes, inOutBufferLength);
       }
@@ -38,6 +38,8 @@ public:
 
   /// Used by the ImageStreamReader-- converts a read in 
   /// buffer into one with the proper encodings.
+  /// Decoding can be done in place (outBytes == inBytes), except for 12bits
+  /// packed data.
   bool DecodeBytes(const char* inBytes, size_t inBufferLength,
     char* outBytes, size_t inOutBufferLength);
 
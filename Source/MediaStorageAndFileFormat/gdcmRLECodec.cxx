@@ -19,6 +19,7 @@
 #include "gdcmSequenceOfFragments.h"
 #include "gdcmSmartPointer.h"
 #include "gdcmSwapper.h"
+#include "gdcmFrameIndex.h"
 
 #include <algorithm> // req C++11
 #include <cstddef> // ptrdiff_t fix
@@ -538,6 +539,11 @@ bool RLECodec::Code(DataElement const &in, DataElement &out)
     frag.SetByteValue( str.data(), strSize );
     sq->AddFragment( frag );
     }
+  // one fragment per frame, so that readers can seek to any frame
+  if( dims[2] > 1 && !sq->FillBasicOffsetTable() )
+    {
+    gdcmDebugMacro( "Offsets do not fit in Basic Offset Table" );
+    }
   out.SetValue( *sq );
 
   delete[] buffer;
@@ -667,6 +673,76 @@ bool RLECodec::Decode(DataElement const &in, DataElement &out)
   return false;
 }
 
+namespace
+{
+// Where the bytes of one RLE segment (one byte plane of one sample) go in
+// the output region
+struct RLESegmentRegion
+{
+  size_t Width;
+  size_t XMin, XMax, YMin;
+  size_t End;          // plane position after the last requested row
+  char *Out;           // output byte of pixel (XMin,YMin)
+  size_t PixelStride;  // distance between two pixels in Out
+  size_t RowStride;    // distance between two rows in Out
+
+  // Copy a literal (src) or replicated (value) run of n bytes, starting at
+  // plane position pos. Bytes outside the region are dropped.
+  void Emit(size_t pos, const char *src, char value, size_t n) const
+    {
+    const size_t last = std::min( pos + n, End );
+    while( pos < last )
+      {
+      const size_t y = pos / Width;
+      const size_t x = pos % Width;
+      const size_t rowend = std::min( last, (y + 1) * Width );
+      if( y >= YMin )
+        {
+        const size_t x0 = std::max( x, XMin );
+        const size_t x1 = std::min( rowend - y * Width, XMax + 1 );
+        char *o = Out + (y - YMin) * RowStride + (x0 - XMin) * PixelStride;
+        for( size_t xx = x0; xx < x1; ++xx, o += PixelStride )
+          {
+          *o = src ? src[xx - x] : value;
+          }
+        }
+      if( src ) src += rowend - pos;
+      pos = rowend;
+      }
+    }
+};
+
+// PackBits decoding of one segment, stopping as soon as the last requested
+// row is complete. Return false when the segment is truncated.
+bool DecodeSegmentRegion(const char *data, size_t len, RLESegmentRegion const &r)
+{
+  const char *p = data;
+  const char *end = data + len;
+  size_t pos = 0;
+  while( pos < r.End )
+    {
+    if( p >= end ) return false;
+    const signed char byte = (signed char)*p++;
+    if( byte >= 0 )
+      {
+      size_t n = (size_t)byte + 1;
+      if( n > (size_t)(end - p) ) return false;
+      r.Emit( pos, p, 0, n );
+      p += n;
+      pos += n;
+      }
+    else if( byte != -128 )
+      {
+      if( p >= end ) return false;
+      const size_t n = (size_t)(1 - byte);
+      r.Emit( pos, nullptr, *p++, n );
+      pos += n;
+      }
+    }
+  return true;
+}
+}
+
 bool RLECodec::DecodeExtent(
   char *buffer,
   unsigned int xmin, unsigned int xmax,
@@ -675,81 +751,114 @@ bool RLECodec::DecodeExtent(
   std::istream & is
 )
 {
-  std::stringstream tmpos;
-  BasicOffsetTable bot;
-  bot.Read<SwapperNoOp>( is );
-  //std::cout << bot << std::endl;
+  FrameIndex index;
+  if( !index.Build( is, NumberOfDimensions == 3 ? Dimensions[2] : 1 ) )
+    {
+    gdcmErrorMacro( "Could not locate frames" );
+    return false;
+    }
+  return DecodeExtent( buffer, xmin, xmax, ymin, ymax, zmin, zmax, is, index );
+}
 
+bool RLECodec::DecodeExtent(
+  char *buffer,
+  unsigned int xmin, unsigned int xmax,
+  unsigned int ymin, unsigned int ymax,
+  unsigned int zmin, unsigned int zmax,
+  std::istream & is, FrameIndex const & index
+)
+{
   const unsigned int * dimensions = this->GetDimensions();
   const PixelFormat & pf = this->GetPixelFormat();
   assert( pf.GetBitsAllocated() % 8 == 0 );
   assert( pf != PixelFormat::SINGLEBIT );
   assert( pf != PixelFormat::UINT12 && pf != PixelFormat::INT12 );
+  if( zmax >= index.GetNumberOfFrames() )
+    {
+    gdcmErrorMacro( "Frame " << zmax << " is out of range" );
+    return false;
+    }
 
-  // skip
-  std::stringstream os;
-  Fragment frag;
-  for( unsigned int z = 0; z < zmin; ++z )
+  const unsigned int spp = pf.GetSamplesPerPixel();
+  const unsigned int bps = pf.GetBitsAllocated() / 8; // bytes per sample
+  if( (spp != 1 && spp != 3) || (bps != 1 && bps != 2 && bps != 4) )
     {
-    frag.ReadPreValue<SwapperNoOp>(is);
-    std::streamoff off = frag.GetVL();
-    is.seekg( off, std::ios::cur );
+    gdcmErrorMacro( "Unhandled Pixel Format: " << pf );
+    return false;
     }
+  // RLE frames are always stored with Planar Configuration = 1, the output
+  // follows the declared Planar Configuration
+  const bool planar = spp == 3 && GetPlanarConfiguration() == 1;
+  const size_t rowsize = xmax - xmin + 1;
+  const size_t colsize = ymax - ymin + 1;
+  const size_t pixelsize = (size_t)spp * bps;
+  const size_t framelen = rowsize * colsize * pixelsize;
+  memset( buffer, 0, framelen * (zmax - zmin + 1) );
+
+  std::vector<char> data;
+  Fragment frag;
   for( unsigned int z = zmin; z <= zmax; ++z )
     {
+    // RLE: one frame is one fragment
+    is.seekg( index.GetFrameOffset( z ), std::ios::beg );
     frag.ReadPreValue<SwapperNoOp>(is);
-    std::streampos start = is.tellg();
-
-    SetLength( dimensions[0] * dimensions[1] * pf.GetPixelSize() );
-    const bool r = DecodeByStreams(is, os); (void)r;
-    if( !r ) return false;
-    assert( r );
-
-    // handle DICOM padding
-    std::streampos end = is.tellg();
-    size_t numberOfReadBytes = (size_t)(end - start);
-    if( numberOfReadBytes > frag.GetVL() )
+    data.resize( frag.GetVL() );
+    if( data.size() < sizeof(RLEHeader) ) return false;
+    is.read( &data[0], data.size() );
+    if( (size_t)is.gcount() != data.size() ) return false;
+    RLEHeader header;
+    memcpy( &header, &data[0], sizeof(header) );
+    SwapperNoOp::SwapArray( (uint32_t*)&header, 16 );
+    if( header.NumSegments != spp * bps )
       {
-      // Special handling for ALOKA_SSD-8-MONO2-RLE-SQ.dcm
-      size_t diff = numberOfReadBytes - frag.GetVL();
-      assert( diff == 1 );
-      os.seekp( 0 - (int)diff, std::ios::cur );
-      os.put( 0 );
-      end = (size_t)end - 1;
+      gdcmErrorMacro( "Wrong number of RLE segments: " << header.NumSegments );
+      return false;
       }
-    assert( end - start == frag.GetVL() || (size_t)(end - start) + 1 == frag.GetVL() );
-    // sync is (rle16loo.dcm)
-    if( (end - start) % 2 == 1 )
+
+    char *out = buffer + (z - zmin) * framelen;
+    for( unsigned int seg = 0; seg < header.NumSegments; ++seg )
       {
-      is.get();
+      // segments are ordered by sample, then most significant byte first
+      const unsigned int sample = seg / bps;
+#ifdef GDCM_WORDS_BIGENDIAN
+      const unsigned int byte = seg % bps;
+#else
+      const unsigned int byte = bps - 1 - seg % bps;
+#endif
+      RLESegmentRegion r;
+      r.Width = dimensions[0];
+      r.XMin = xmin;
+      r.XMax = xmax;
+      r.YMin = ymin;
+      r.End = ((size_t)ymax + 1) * dimensions[0];
+      if( planar )
+        {
+        r.Out = out + sample * rowsize * colsize * bps + byte;
+        r.PixelStride = bps;
+        }
+      else
+        {
+        r.Out = out + sample * bps + byte;
+        r.PixelStride = pixelsize;
+        }
+      r.RowStride = rowsize * r.PixelStride;
+      const size_t offset = header.Offset[seg];
+      if( offset >= data.size() )
+        {
+        gdcmErrorMacro( "Invalid RLE segment offset: " << offset );
+        return false;
+        }
+      if( !DecodeSegmentRegion( &data[offset], data.size() - offset, r ) )
+        {
+        // ALOKA_SSD-8-MONO2-RLE-SQ.dcm is short by one byte
+        gdcmWarningMacro( "Truncated RLE segment " << seg << " in frame " << z );
+        }
       }
     } // for each z
 
-  os.seekg(0, std::ios::beg );
-  assert( os.good() );
-  std::istream *theStream = &os;
-
-  unsigned int rowsize = xmax - xmin + 1;
-  unsigned int colsize = ymax - ymin + 1;
-  unsigned int bytesPerPixel = pf.GetPixelSize();
-
-  std::vector<char> buffer1;
-  buffer1.resize( rowsize*bytesPerPixel );
-  char *tmpBuffer1 = buffer1.data();
-  unsigned int y, z;
-  std::streamoff theOffset;
-  for (z = zmin; z <= zmax; ++z)
+  if( pf.GetBitsAllocated() == 16 && pf.GetBitsStored() != 16 )
     {
-    for (y = ymin; y <= ymax; ++y)
-      {
-      theStream->seekg(std::ios::beg);
-      theOffset = 0 + ((z-zmin)*dimensions[1]*dimensions[0] + y*dimensions[0] + xmin)*bytesPerPixel;
-      theStream->seekg(theOffset);
-      theStream->read(tmpBuffer1, rowsize*bytesPerPixel);
-      memcpy(&(buffer[((z-zmin)*rowsize*colsize +
-            (y-ymin)*rowsize)*bytesPerPixel]),
-        tmpBuffer1, rowsize*bytesPerPixel);
-      }
+    return CleanupUnusedBits( buffer, framelen * (zmax - zmin + 1) );
     }
   return true;
 }
@@ -885,7 +994,10 @@ bool RLECodec::GetHeaderInfo(std::istream &is, TransferSyntax &ts)
 
 ImageCodec * RLECodec::Clone() const
 {
-  return new RLECodec;
+  RLECodec *copy = new RLECodec;
+  ImageCodec &ic = *copy;
+  ic = *this;
+  return copy;
 }
 
 bool RLECodec::StartEncode( std::ostream & )
@@ -20,6 +20,7 @@ namespace gdcm
 {
 
 class Fragment;
+class FrameIndex;
 class RLEInternals;
 /**
  * \brief Class to do RLE
@@ -57,6 +58,14 @@ protected:
     unsigned int ZMin, unsigned int ZMax,
     std::istream & is
   );
+  /// Same as above, frames are located with index (no fragment walk)
+  bool DecodeExtent(
+    char *buffer,
+    unsigned int XMin, unsigned int XMax,
+    unsigned int YMin, unsigned int YMax,
+    unsigned int ZMin, unsigned int ZMax,
+    std::istream & is, FrameIndex const & index
+  );
 
   bool DecodeByStreams(std::istream &is, std::ostream &os) override;
 public:
@@ -23,6 +23,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <string.h> // strcmp
 
@@ -56,7 +57,7 @@ class GDCM_EXPORT Scanner : public Subject
 {
   friend std::ostream& operator<<(std::ostream &_os, const Scanner &s);
 public:
-  Scanner():Values(),Filenames(),Mappings(),Progress(0.0) {}
+  Scanner():Values(),Filenames(),Mappings(),Progress(0.0),ReadAhead(0) {}
   ~Scanner() override;
 
   /// struct to map a filename to a value
@@ -81,6 +82,11 @@ public:
   void AddSkipTag( Tag const & t );
   void ClearSkipTags();
 
+  /// Set/Get the number of files read ahead, in the background, of the one
+  /// being parsed (see FilePrefetcher). 0 (default) disables read-ahead.
+  void SetReadAhead(unsigned int n) { ReadAhead = n; }
+  unsigned int GetReadAhead() const { return ReadAhead; }
+
   /// Start the scan !
   bool Scan( Directory::FilenamesType const & filenames );
 
@@ -134,12 +140,12 @@ public:
   /// Get the std::map mapping filenames to value for file 'filename'
   TagToValue const & GetMapping(const char *filename) const;
 
-  /// Will loop over all files and return the first file where value match the reference value
-  /// 'valueref'
+  /// Return the first file where value match the reference value 'valueref'
+  /// (an inverted index built during Scan() is used, no loop over all files)
   const char *GetFilenameFromTagToValue(Tag const &t, const char *valueref) const;
 
-  /// Will loop over all files and return a vector of std::strings of filenames
-  /// where value match the reference value 'valueref'
+  /// Return a vector of std::strings of filenames where value match the
+  /// reference value 'valueref'
   Directory::FilenamesType GetAllFilenamesFromTagToValue(Tag const &t, const char *valueref) const;
 
   /// See GetFilenameFromTagToValue(). This is simply GetFilenameFromTagToValue followed
@@ -171,7 +177,17 @@ private:
   // Main struct that will hold all mapping:
   MappingType Mappings;
 
+  // Inverted index: for each tag, map each value to the files (position in
+  // Filenames, in ascending order) where it was found
+  typedef std::vector<size_t> FileIdsType;
+  typedef std::map<const char *, FileIdsType, ltstr> ValueToFileIdsType;
+  std::map<Tag, ValueToFileIdsType> ValueIndex;
+  // Same, with values trimmed of leading and trailing spaces
+  std::map<Tag, std::map<std::string, FileIdsType> > TrimmedValueIndex;
+  void IndexFile(const char *filename, size_t id);
+
   double Progress;
+  unsigned int ReadAhead;
 };
 //-----------------------------------------------------------------------------
 inline std::ostream& operator<<(std::ostream &os, const Scanner &s)
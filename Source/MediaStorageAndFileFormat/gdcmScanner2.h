@@ -23,6 +23,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <string.h> // strcmp
 
@@ -56,7 +57,7 @@ class GDCM_EXPORT Scanner2 : public Subject
 {
   friend std::ostream& operator<<(std::ostream &_os, const Scanner2 &s);
 public:
-  Scanner2():Values(),Filenames(),PublicMappings(),PrivateMappings(),Progress(0.0) {}
+  Scanner2():Values(),Filenames(),PublicMappings(),PrivateMappings(),Progress(0.0),ReadAhead(0) {}
   ~Scanner2() override;
 
   /// struct to map a filename to a value
@@ -83,6 +84,11 @@ public:
   bool AddSkipTag( Tag const & t );
   void ClearSkipTags();
 
+  /// Set/Get the number of files read ahead, in the background, of the one
+  /// being parsed (see FilePrefetcher). 0 (default) disables read-ahead.
+  void SetReadAhead(unsigned int n) { ReadAhead = n; }
+  unsigned int GetReadAhead() const { return ReadAhead; }
+
   /// Start the scan !
   bool Scan( Directory::FilenamesType const & filenames );
 
@@ -150,13 +156,13 @@ public:
   PublicTagToValue const & GetPublicMapping(const char *filename) const;
   PrivateTagToValue const & GetPrivateMapping(const char *filename) const;
 
-  /// Will loop over all files and return the first file where value match the reference value
-  /// 'valueref'
+  /// Return the first file where value match the reference value 'valueref'
+  /// (an inverted index built during Scan() is used, no loop over all files)
   const char *GetFilenameFromPublicTagToValue(Tag const &t, const char *valueref) const;
   const char *GetFilenameFromPrivateTagToValue(PrivateTag const &pt, const char *valueref) const;
 
-  /// Will loop over all files and return a vector of std::strings of filenames
-  /// where value match the reference value 'valueref'
+  /// Return a vector of std::strings of filenames where value match the
+  /// reference value 'valueref'
   Directory::FilenamesType GetAllFilenamesFromPublicTagToValue(Tag const &t, const char *valueref) const;
   Directory::FilenamesType GetAllFilenamesFromPrivateTagToValue(PrivateTag const &pt, const char *valueref) const;
 
@@ -194,7 +200,16 @@ private:
   // Main struct that will hold all private mapping:
   PrivateMappingType PrivateMappings;
 
+  // Inverted indexes: for each tag, map each value to the files (position in
+  // Filenames, in ascending order) where it was found
+  typedef std::vector<size_t> FileIdsType;
+  typedef std::map<const char *, FileIdsType, ltstr> ValueToFileIdsType;
+  std::map<Tag, ValueToFileIdsType> PublicValueIndex;
+  std::map<PrivateTag, ValueToFileIdsType> PrivateValueIndex;
+  void IndexFile(const char *filename, size_t id);
+
   double Progress;
+  unsigned int ReadAhead;
 };
 //-----------------------------------------------------------------------------
 inline std::ostream& operator<<(std::ostream &os, const Scanner2 &s)
@@ -16,7 +16,6 @@
 #include "gdcmStringFilter.h"
 #include "gdcmDirectory.h"
 #include "gdcmIPPSorter.h"
-#include "gdcmImageReader.h"
 #include "gdcmImageHelper.h"
 #include "gdcmAttribute.h"
 #include "gdcmTrace.h"
@@ -31,6 +30,7 @@ SerieHelper::SerieHelper()
   Clear();
   UserLessThanFunction = nullptr;
   DirectOrder = true;
+  ReadAhead = 0;
   //LoadMode = 0;
 }
 
@@ -124,28 +124,45 @@ void SerieHelper::SetDirectory(std::string const &dir, bool recursive)
   Directory dirList;
   unsigned int nfiles = dirList.Load(dir, recursive); (void)nfiles;
 
-  Directory::FilenamesType const &filenames = dirList.GetFilenames();
-  for( Directory::FilenamesType::const_iterator it = filenames.begin();
-    it != filenames.end(); ++it)
-    {
-    AddFileName( *it );
-    }
+  AddFileNames( dirList.GetFilenames() );
 }
 
 void SerieHelper::AddFileName(std::string const &filename)
 {
-  // Only accept DICOM file containing Image (Pixel Data element):
-  ImageReader reader;
-  reader.SetFileName( filename.c_str() );
-  if( !reader.Read() )
-    {
-    gdcmWarningMacro("Could not read file: " << filename );
-    }
-  else
+  AddFileNames( std::vector<std::string>(1, filename) );
+}
+
+void SerieHelper::AddFileNames(std::vector<std::string> const &filenames)
+{
+  // The headers are read in parallel, without the value of the Pixel Data:
+  std::vector< SmartPointer<FileWithName> > files( filenames.size() );
+  Sorter sorter;
+  sorter.SetReadAhead( ReadAhead );
+  sorter.ReadFiles( filenames, std::set<Tag>(),
+    [&]( size_t i, File const *file ) {
+      if( !file )
+        {
+        gdcmWarningMacro("Could not read file: " << filenames[i] );
+        return true;
+        }
+      // Only accept DICOM file containing Image (Pixel Data element):
+      const DataSet &ds = file->GetDataSet();
+      if( !ds.FindDataElement( Tag(0x7fe0,0x0010) )
+        && !ds.FindDataElement( Tag(0x7fe0,0x0008) )
+        && !ds.FindDataElement( Tag(0x7fe0,0x0009) ) )
+        {
+        gdcmWarningMacro("No Pixel Data in file: " << filenames[i] );
+        return true;
+        }
+      SmartPointer<FileWithName> f = new FileWithName( *file );
+      f->filename = filenames[i];
+      files[i] = f;
+      return true;
+    } );
+  for( size_t i = 0; i < files.size(); ++i )
     {
-    SmartPointer<FileWithName> f = new FileWithName( reader.GetFile() );
-    f->filename = filename;
-    (void)AddFile( *f /*reader.GetFile()*/ ); // discard return value
+    if( files[i] )
+      (void)AddFile( *files[i] ); // discard return value
     }
 }
 
@@ -263,16 +280,9 @@ bool MyFileNameSortPredicate(const SmartPointer<FileWithName>& d1, const SmartPo
 {
   return d1->filename < d2->filename;
 }
-bool MyInstanceSortPredicate(const SmartPointer<FileWithName>& d1, const SmartPointer<FileWithName>& d2)
+bool MyInstanceSortPredicate(const std::pair<int, SmartPointer<FileWithName> >& d1, const std::pair<int, SmartPointer<FileWithName> >& d2)
 {
-  Attribute<0x0020,0x0013> instancenumber1;
-  Attribute<0x0020,0x0013> instancenumber2;
-  const DataSet& ds1 = d1->GetDataSet();
-  instancenumber1.SetFromDataSet( ds1 );
-  const DataSet& ds2 = d2->GetDataSet();
-  instancenumber2.SetFromDataSet( ds2 );
-
-  return instancenumber1.GetValue() < instancenumber2.GetValue();
+  return d1.first < d2.first;
 }
 }
 
@@ -285,7 +295,9 @@ bool SerieHelper::FileNameOrdering( FileList *fileList )
 
 bool SerieHelper::ImageNumberOrdering( FileList *fileList )
 {
+  // Parse each Instance Number once, not on each comparison:
   Attribute<0x0020,0x0013> instancenumber;
+  std::vector< std::pair<int, SmartPointer<FileWithName> > > instances;
   std::set<int> instancenumbers;
   for ( FileList::const_iterator
     it = fileList->begin();
@@ -296,10 +308,13 @@ bool SerieHelper::ImageNumberOrdering( FileList *fileList )
     instancenumber.SetFromDataSet( ds );
     int in = instancenumber.GetValue();
     instancenumbers.insert( in );
+    instances.emplace_back( in, *it );
     }
   if( instancenumbers.size() == fileList->size() )
     {
-    std::sort(fileList->begin(), fileList->end(), details::MyInstanceSortPredicate);
+    std::sort(instances.begin(), instances.end(), details::MyInstanceSortPredicate);
+    for( size_t i = 0; i < instances.size(); ++i )
+      (*fileList)[i] = instances[i].second;
     return true;
     }
   return false;
@@ -50,7 +50,7 @@ enum LodModeType
 class GDCM_EXPORT FileWithName : public File
 {
 public:
-  FileWithName(File &f):File(f),filename(){}
+  FileWithName(File const &f):File(f),filename(){}
   std::string filename;
 };
 
@@ -73,8 +73,16 @@ public:
 
   void Clear();
   void SetLoadMode (int ) {}
+  /// Parse the files of dir. The files of the FileList are the whole headers,
+  /// the Pixel Data element being present but empty (its value is not read).
   void SetDirectory(std::string const &dir, bool recursive=false);
 
+  /// Set/Get the number of files read ahead, in the background, of the one
+  /// being parsed by SetDirectory (see FilePrefetcher). 0 (default) reads
+  /// the files in parallel instead.
+  void SetReadAhead(unsigned int n) { ReadAhead = n; }
+  unsigned int GetReadAhead() const { return ReadAhead; }
+
   void AddRestriction(const std::string & tag);
   void SetUseSeriesDetails( bool useSeriesDetails );
   void CreateDefaultUniqueSeriesIdentifier();
@@ -87,6 +95,7 @@ public:
 protected:
   bool UserOrdering(FileList *fileSet);
   void AddFileName(std::string const &filename);
+  void AddFileNames(std::vector<std::string> const &filenames);
   bool AddFile(FileWithName &header);
   void AddRestriction(const Tag& tag);
   bool ImagePositionPatientOrdering(FileList *fileSet);
@@ -111,6 +120,7 @@ private:
 
   bool UseSeriesDetails;
   bool DirectOrder;
+  unsigned int ReadAhead;
 
   BOOL_FUNCTION_PFILE_PFILE_POINTER UserLessThanFunction;
 };
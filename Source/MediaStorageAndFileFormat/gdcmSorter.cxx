@@ -16,10 +16,13 @@
 #include "gdcmSerieHelper.h"
 #include "gdcmFile.h"
 #include "gdcmReader.h"
+#include "gdcmFilePrefetcher.h"
+#include "gdcmParallelFor.h"
 
 #include <map>
 #include <algorithm>
 #include <set>
+#include <fstream>
 
 namespace gdcm
 {
@@ -28,6 +31,8 @@ Sorter::Sorter()
 {
   SortFunc = nullptr;
   TagsToRead = std::set<Tag>();
+  ReadAhead = 0;
+  NumberOfThreads = 0;
 }
 
 Sorter::~Sorter()
@@ -68,6 +73,88 @@ public:
 };
 }
 
+static const Tag PixelDataTag(0x7fe0,0x0010);
+
+// Read tags from is (every attribute but the Pixel Data value when empty),
+// and pass the result to f
+static bool ReadOneFile(std::istream &is, std::set<Tag> const & tags,
+  size_t index, Sorter::ReadFunction const & f)
+{
+  Reader reader;
+  reader.SetStream( is );
+  bool read = false;
+  try
+    {
+    if( !tags.empty() )
+      {
+      read = reader.ReadSelectedTags( tags );
+      }
+    else
+      {
+      std::set<Tag> skiptags;
+      skiptags.insert( PixelDataTag );
+      read = reader.ReadUpToTag( PixelDataTag, skiptags );
+      // The Reader stopped on the Pixel Data, unless there was none and it
+      // read the end of the file (or the first element after it)
+      DataSet &ds = reader.GetFile().GetDataSet();
+      if( read && is.good()
+        && ( ds.IsEmpty() || ds.GetDES().rbegin()->GetTag() < PixelDataTag ) )
+        ds.Insert( DataElement( PixelDataTag ) );
+      }
+    }
+  catch(std::exception & ex)
+    {
+    (void)ex;
+    gdcmWarningMacro( "Failed to read file #" << index << " with ex:" << ex.what() );
+    read = false;
+    }
+  return f( index, read ? &reader.GetFile() : nullptr );
+}
+
+bool Sorter::ReadFiles(std::vector<std::string> const & filenames,
+  std::set<Tag> const & tags, ReadFunction const & f) const
+{
+  const size_t nfiles = filenames.size();
+  if( ReadAhead )
+    {
+    FilePrefetcher prefetcher;
+    prefetcher.SetReadAhead( ReadAhead );
+    prefetcher.SetFileNames( filenames );
+    for( size_t i = 0; i < nfiles; ++i )
+      {
+      if( !ReadOneFile( prefetcher.GetStream( i ), tags, i, f ) ) return false;
+      }
+    return true;
+    }
+
+  // Each thread takes the next file to read, until there is none left or f
+  // asked to stop
+  return ParallelFor( nfiles, ComputeNumberOfThreads( NumberOfThreads, nfiles ),
+    [&]( size_t i, unsigned int ) {
+      std::ifstream is( filenames[i].c_str(), std::ios::binary );
+      return ReadOneFile( is, tags, i, f );
+    } );
+}
+
+// Keep the headers of all files, to be sorted
+static bool ReadFileList(Sorter const & sorter,
+  std::vector<std::string> const & filenames, std::set<Tag> const & tagstoread,
+  std::vector< SmartPointer<FileWithName> > & filelist)
+{
+  return sorter.ReadFiles( filenames, tagstoread,
+    [&]( size_t i, File const *file ) {
+      if( !file )
+        {
+        gdcmErrorMacro( "File could not be read: " << filenames[i] );
+        return false;
+        }
+      SmartPointer<FileWithName> f = new FileWithName( *file );
+      f->filename = filenames[i];
+      filelist[i] = f;
+      return true;
+    } );
+}
+
 bool Sorter::StableSort(std::vector<std::string> const & filenames)
 {
   // BUG: I cannot clear Filenames since input filenames could also be the output of ourself...
@@ -81,26 +168,8 @@ bool Sorter::StableSort(std::vector<std::string> const & filenames)
   std::vector< SmartPointer<FileWithName> > filelist;
   filelist.resize( filenames.size() );
 
-  std::vector< SmartPointer<FileWithName> >::iterator it2 = filelist.begin();
-  for( Directory::FilenamesType::const_iterator it = filenames.begin();
-    it != filenames.end() && it2 != filelist.end(); ++it, ++it2)
-    {
-    Reader reader;
-    reader.SetFileName( it->c_str() );
-    SmartPointer<FileWithName> &f = *it2;
-
-    bool readWasSuccessful = TagsToRead.empty() ? reader.Read() : reader.ReadSelectedTags(TagsToRead);
-    if (readWasSuccessful)
-      {
-      f = new FileWithName( reader.GetFile() );
-      f->filename = *it;
-      }
-    else
-      {
-      gdcmErrorMacro( "File could not be read: " << it->c_str() );
-      return false;
-      }
-    }
+  if( !ReadFileList( *this, filenames, TagsToRead, filelist ) ) return false;
+  std::vector< SmartPointer<FileWithName> >::iterator it2;
   SortFunctor sf;
   sf = Sorter::SortFunc;
   std::stable_sort( filelist.begin(), filelist.end(), sf);
@@ -125,25 +194,8 @@ bool Sorter::Sort(std::vector<std::string> const & filenames)
   std::vector< SmartPointer<FileWithName> > filelist;
   filelist.resize( filenames.size() );
 
-  std::vector< SmartPointer<FileWithName> >::iterator it2 = filelist.begin();
-  for( Directory::FilenamesType::const_iterator it = filenames.begin();
-    it != filenames.end() && it2 != filelist.end(); ++it, ++it2)
-    {
-    Reader reader;
-    reader.SetFileName( it->c_str() );
-    SmartPointer<FileWithName> &f = *it2;
-    bool readWasSuccessful = TagsToRead.empty() ? reader.Read() : reader.ReadSelectedTags(TagsToRead);
-    if (readWasSuccessful)
-      {
-      f = new FileWithName( reader.GetFile() );
-      f->filename = *it;
-      }
-    else
-      {
-      gdcmErrorMacro( "File could not be read: " << it->c_str() );
-      return false;
-      }
-    }
+  if( !ReadFileList( *this, filenames, TagsToRead, filelist ) ) return false;
+  std::vector< SmartPointer<FileWithName> >::iterator it2;
   //std::sort( filelist.begin(), filelist.end(), Sorter::SortFunc);
   SortFunctor sf;
   sf = Sorter::SortFunc;
@@ -21,10 +21,12 @@
 #include <string>
 #include <map>
 #include <set>
+#include <functional>
 
 namespace gdcm
 {
 class DataSet;
+class File;
 
 /**
  * \brief Sorter
@@ -33,6 +35,7 @@ class DataSet;
  *
  * \warning implementation details. For now there is no cache mechanism. Which means
  * that every time you call Sort, all files specified as input parameter are *read*
+ * (in parallel, see SetNumberOfThreads). The value of the Pixel Data is never read.
  *
  * \see Scanner
  */
@@ -57,8 +60,9 @@ public:
   bool AddSelect( Tag const &tag, const char *value );
 
   /// Specify a set of tags to be read in during the sort procedure.
-  /// By default this set is empty, in which case the entire image,
-  /// including pixel data, is read in.
+  /// By default this set is empty, in which case every attribute but the
+  /// value of the Pixel Data is read in (the Pixel Data element is present,
+  /// but empty).
   void SetTagsToRead( std::set<Tag> const & tags );
 
   /// Set the sort function which compares one dataset to the other
@@ -67,12 +71,37 @@ public:
 
   virtual bool StableSort(std::vector<std::string> const & filenames);
 
+  /// Set/Get the number of files read ahead, in the background, of the one
+  /// being parsed (see FilePrefetcher). 0 (default) disables read-ahead.
+  void SetReadAhead(unsigned int n) { ReadAhead = n; }
+  unsigned int GetReadAhead() const { return ReadAhead; }
+
+  /// Set/Get the number of threads reading the files, when read-ahead is
+  /// disabled (all cores by default).
+  void SetNumberOfThreads(unsigned int n) { NumberOfThreads = n; }
+  unsigned int GetNumberOfThreads() const { return NumberOfThreads; }
+
+#if !defined(SWIGPYTHON) && !defined(SWIGCSHARP) && !defined(SWIGJAVA) && !defined(SWIGPHP)
+  /// Called by ReadFiles from the thread which read filenames[index]. file is
+  /// nullptr when it could not be read. Return false to stop reading.
+  typedef std::function<bool (size_t index, File const *file)> ReadFunction;
+
+  /// Read the files, with the threads or the read-ahead set, and pass each of
+  /// them to f. Only tags are read, or every attribute but the value of the
+  /// Pixel Data when tags is empty (see SetTagsToRead).
+  /// Return false when f stopped the reading.
+  bool ReadFiles(std::vector<std::string> const & filenames,
+    std::set<Tag> const & tags, ReadFunction const & f) const;
+#endif
+
 protected:
   std::vector<std::string> Filenames;
   typedef std::map<Tag,std::string> SelectionMap;
   std::map<Tag,std::string> Selection;
   SortFunction SortFunc;
   std::set<Tag> TagsToRead;
+  unsigned int ReadAhead;
+  unsigned int NumberOfThreads;
 };
 //-----------------------------------------------------------------------------
 inline std::ostream& operator<<(std::ostream &os, const Sorter &s)
@@ -0,0 +1,342 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmStreamingAnonymizer.h"
+#include "gdcmAnonymizer.h"
+#include "gdcmReader.h"
+#include "gdcmWriter.h"
+#include "gdcmMediaStorage.h"
+#include "gdcmDefs.h"
+#include "gdcmSwapper.h"
+#include "gdcmExplicitDataElement.h"
+#include "gdcmImplicitDataElement.h"
+#include "gdcmSystem.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace gdcm
+{
+
+class StreamingAnonymizerInternals
+{
+public:
+  std::string InputFileName;
+  std::string OutputFileName;
+  CryptographicMessageSyntax *CMS{nullptr};
+  DummyValueMap *DVM{nullptr};
+  bool InputFileUnreadable{false};
+};
+
+static const Tag PixelDataTag(0x7fe0,0x0010);
+
+// Read a tag and a 32bits length (item or element header)
+static Tag ReadTagAndLength(const char *p, bool swap, uint32_t &length, unsigned int lengthoffset)
+{
+  uint16_t group, element;
+  memcpy( &group, p, 2 );
+  memcpy( &element, p + 2, 2 );
+  memcpy( &length, p + lengthoffset, 4 );
+  if( swap )
+    {
+    group = SwapperDoOp::Swap( group );
+    element = SwapperDoOp::Swap( element );
+    length = SwapperDoOp::Swap( length );
+    }
+  return Tag( group, element );
+}
+
+// The Reader stopped right after the header of the Pixel Data element: find
+// the offsets of the whole element, and leave is at its end
+static bool LocatePixelData(std::istream &is, TransferSyntax const &ts,
+  std::streampos &begin, std::streampos &end)
+{
+  const bool explicitvr = ts.GetNegociatedType() == TransferSyntax::Explicit;
+  const bool swap = ts.GetSwapCode() == SwapCode::BigEndian;
+  const unsigned int headerlen = explicitvr ? 12 : 8;
+  const std::streampos pos = is.tellg();
+  if( pos < (std::streamoff)headerlen ) return false;
+
+  // Double check we are where we think we are
+  char header[12];
+  begin = pos - (std::streamoff)headerlen;
+  is.seekg( begin, std::ios::beg );
+  if( !is.read( header, headerlen ) ) return false;
+  uint32_t vl;
+  if( ReadTagAndLength( header, swap, vl, headerlen - 4 ) != PixelDataTag ) return false;
+  // OB, OW or UN: reserved bytes
+  if( explicitvr && ( header[6] || header[7] ) ) return false;
+
+  if( vl != 0xFFFFFFFF )
+    {
+    is.seekg( 0, std::ios::end );
+    const std::streampos size = is.tellg();
+    end = pos + (std::streamoff)vl;
+    if( end > size ) return false;
+    is.seekg( end, std::ios::beg );
+    return true;
+    }
+
+  // Encapsulated: skip over the fragments
+  for(;;)
+    {
+    char item[8];
+    if( !is.read( item, 8 ) ) return false;
+    uint32_t length;
+    const Tag t = ReadTagAndLength( item, swap, length, 4 );
+    if( t == Tag(0xfffe,0xe0dd) ) break;
+    if( t != Tag(0xfffe,0xe000) || length == 0xFFFFFFFF ) return false;
+    is.seekg( length, std::ios::cur );
+    }
+  end = is.tellg();
+  return true;
+}
+
+// Read the elements after the Pixel Data (digital signatures, padding, ...)
+static bool ReadTrailingElements(std::istream &is, TransferSyntax const &ts, DataSet &ds)
+{
+  if( ts.GetSwapCode() == SwapCode::BigEndian )
+    {
+    if( ts.GetNegociatedType() == TransferSyntax::Implicit )
+      {
+      gdcmErrorMacro( "Cannot read Virtual Big Endian" );
+      return false;
+      }
+    ds.Read<ExplicitDataElement,SwapperDoOp>( is );
+    }
+  else
+    {
+    if( ts.GetNegociatedType() == TransferSyntax::Implicit )
+      ds.Read<ImplicitDataElement,SwapperNoOp>( is );
+    else
+      ds.Read<ExplicitDataElement,SwapperNoOp>( is );
+    }
+  return is.eof() && !is.bad();
+}
+
+static bool WriteTrailingElements(DataSet const &ds, TransferSyntax const &ts, std::ostream &os)
+{
+  if( ts.GetSwapCode() == SwapCode::BigEndian )
+    {
+    ds.Write<ExplicitDataElement,SwapperDoOp>( os );
+    }
+  else
+    {
+    if( ts.GetNegociatedType() == TransferSyntax::Implicit )
+      ds.Write<ImplicitDataElement,SwapperNoOp>( os );
+    else
+      ds.Write<ExplicitDataElement,SwapperNoOp>( os );
+    }
+  return !os.fail();
+}
+
+// Copy is, from begin up to end, into os
+static bool CopyBytes(std::istream &is, std::ostream &os, std::streampos begin, std::streampos end)
+{
+  is.clear();
+  is.seekg( begin, std::ios::beg );
+  std::vector<char> buffer( 1024 * 1024 );
+  std::streamoff left = end - begin;
+  while( left > 0 )
+    {
+    const std::streamsize n = (std::streamsize)std::min( left, (std::streamoff)buffer.size() );
+    if( !is.read( &buffer[0], n ) ) return false;
+    os.write( &buffer[0], n );
+    left -= n;
+    }
+  return !os.fail();
+}
+
+StreamingAnonymizer::StreamingAnonymizer():Internals(new StreamingAnonymizerInternals)
+{
+}
+
+StreamingAnonymizer::~StreamingAnonymizer()
+{
+  delete Internals;
+}
+
+void StreamingAnonymizer::SetInputFileName(const char *filename_native)
+{
+  if( filename_native )
+    Internals->InputFileName = filename_native;
+}
+
+void StreamingAnonymizer::SetOutputFileName(const char *filename_native)
+{
+  if( filename_native )
+    Internals->OutputFileName = filename_native;
+}
+
+void StreamingAnonymizer::SetCryptographicMessageSyntax( CryptographicMessageSyntax *cms )
+{
+  Internals->CMS = cms;
+}
+
+const CryptographicMessageSyntax *StreamingAnonymizer::GetCryptographicMessageSyntax() const
+{
+  return Internals->CMS;
+}
+
+void StreamingAnonymizer::SetDummyValueMap( DummyValueMap *dvm )
+{
+  Internals->DVM = dvm;
+}
+
+DummyValueMap *StreamingAnonymizer::GetDummyValueMap() const
+{
+  return Internals->DVM;
+}
+
+bool StreamingAnonymizer::BasicApplicationLevelConfidentialityProfile(bool deidentify)
+{
+  const std::string &filename = Internals->InputFileName;
+  const std::string &outfilename = Internals->OutputFileName;
+  Internals->InputFileUnreadable = false;
+  if( filename.empty() || outfilename.empty() )
+    {
+    gdcmErrorMacro( "Input and output filenames are required" );
+    return false;
+    }
+
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  if( !is )
+    {
+    gdcmErrorMacro( "Could not open: " << filename );
+    Internals->InputFileUnreadable = true;
+    return false;
+    }
+  // Read everything but the Pixel Data value
+  Reader reader;
+  reader.SetStream( is );
+  std::set<Tag> skiptags;
+  skiptags.insert( PixelDataTag );
+  if( !reader.ReadUpToTag( PixelDataTag, skiptags ) )
+    {
+    gdcmErrorMacro( "Could not read: " << filename );
+    Internals->InputFileUnreadable = true;
+    return false;
+    }
+  File &file = reader.GetFile();
+  const TransferSyntax ts = file.GetHeader().GetDataSetTransferSyntax();
+  if( ts == TransferSyntax::DeflatedExplicitVRLittleEndian )
+    {
+    gdcmErrorMacro( "Deflated Transfer Syntax is not supported: " << filename );
+    Internals->InputFileUnreadable = true;
+    return false;
+    }
+
+  DataSet &ds = file.GetDataSet();
+  // No Pixel Data means an empty range
+  std::streampos pixelbegin = 0, pixelend = 0;
+  if( is.good() )
+    {
+    // The Reader stopped on Pixel Data, unless there was none and it read the
+    // first element after it
+    if( ds.IsEmpty() || ds.GetDES().rbegin()->GetTag() < PixelDataTag )
+      {
+      if( !LocatePixelData( is, ts, pixelbegin, pixelend ) )
+        {
+        gdcmErrorMacro( "Could not locate Pixel Data in: " << filename );
+        Internals->InputFileUnreadable = true;
+        return false;
+        }
+      }
+    try
+      {
+      if( !ReadTrailingElements( is, ts, ds ) )
+        {
+        gdcmErrorMacro( "Could not read trailing elements in: " << filename );
+        Internals->InputFileUnreadable = true;
+        return false;
+        }
+      }
+    catch( std::exception &ex )
+      {
+      (void)ex;
+      gdcmErrorMacro( "Could not read trailing elements in: " << filename
+        << ": " << ex.what() );
+      Internals->InputFileUnreadable = true;
+      return false;
+      }
+    }
+
+  MediaStorage ms;
+  ms.SetFromFile( file );
+  if( !Defs::GetIODNameFromMediaStorage( ms ) )
+    {
+    gdcmErrorMacro( "The Media Storage Type is not supported: " << ms
+      << " for: " << filename );
+    Internals->InputFileUnreadable = true;
+    return false;
+    }
+
+  Anonymizer anon;
+  anon.SetCryptographicMessageSyntax( Internals->CMS );
+  anon.SetDummyValueMap( Internals->DVM );
+  anon.SetFile( file );
+  if( !anon.BasicApplicationLevelConfidentialityProfile( deidentify ) )
+    {
+    gdcmErrorMacro( "Could not " << (deidentify ? "de" : "re")
+      << "-identify: " << filename );
+    return false;
+    }
+  file.GetHeader().Clear();
+
+  // Elements after the Pixel Data are written after its raw copy
+  DataSet trailing;
+  while( !ds.IsEmpty() && PixelDataTag < ds.GetDES().rbegin()->GetTag() )
+    {
+    const DataElement de = *ds.GetDES().rbegin();
+    trailing.Insert( de );
+    ds.Remove( de.GetTag() );
+    }
+
+  // Write into a temporary file: the input file can be the output file, and
+  // no partial output is left on error
+  const std::string tmpfilename = outfilename + ".tmp";
+  bool success;
+    {
+    std::ofstream os( tmpfilename.c_str(), std::ios::binary );
+    Writer writer;
+    writer.SetStream( os );
+    writer.SetFile( file );
+    success = os && writer.Write()
+      && CopyBytes( is, os, pixelbegin, pixelend )
+      && WriteTrailingElements( trailing, ts, os );
+    os.close();
+    success = success && !os.fail();
+    }
+  is.close();
+  if( !success )
+    {
+    gdcmErrorMacro( "Could not write: " << outfilename );
+    System::RemoveFile( tmpfilename.c_str() );
+    return false;
+    }
+  if( !System::RenameFile( tmpfilename.c_str(), outfilename.c_str() ) )
+    {
+    gdcmErrorMacro( "Could not rename " << tmpfilename << " to: " << outfilename );
+    return false;
+    }
+  return true;
+}
+
+bool StreamingAnonymizer::IsInputFileUnreadable() const
+{
+  return Internals->InputFileUnreadable;
+}
+
+} // end namespace gdcm
@@ -0,0 +1,83 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMSTREAMINGANONYMIZER_H
+#define GDCMSTREAMINGANONYMIZER_H
+
+#include "gdcmTypes.h"
+
+namespace gdcm
+{
+
+class CryptographicMessageSyntax;
+class DummyValueMap;
+class StreamingAnonymizerInternals;
+
+/**
+ * \brief StreamingAnonymizer
+ * \details Apply the Basic Application Level Confidentiality Profile (see
+ * Anonymizer) to a file, without loading the Pixel Data in memory.
+ *
+ * Like FileAnonymizer, it uses the Value Length to skip over the Pixel Data
+ * (7fe0,0010): only the other attributes are read. They are de-identified
+ * (or re-identified) with the exact same rules as Anonymizer, including the
+ * nested sequences and the IOD based decisions. The Pixel Data is then copied
+ * from the input to the output file as raw bytes, so memory usage does not
+ * depend on the size of the image.
+ *
+ * caveats:
+ * \li Deflated Explicit VR Little Endian is not supported (use Anonymizer),
+ * \li The Pixel Data is copied as found in the input file, so the Transfer
+ *     Syntax of the output file is the one of the input file.
+ *
+ * \see Anonymizer FileAnonymizer
+ */
+class GDCM_EXPORT StreamingAnonymizer
+{
+public:
+  StreamingAnonymizer();
+  ~StreamingAnonymizer();
+  StreamingAnonymizer(const StreamingAnonymizer&) = delete;
+  void operator=(const StreamingAnonymizer&) = delete;
+
+  /// Set input filename
+  void SetInputFileName(const char *filename_native);
+
+  /// Set output filename (can be the same as the input filename)
+  void SetOutputFileName(const char *filename_native);
+
+  /// Set/Get CMS key used to encrypt (decrypt) the attributes
+  void SetCryptographicMessageSyntax( CryptographicMessageSyntax *cms );
+  const CryptographicMessageSyntax *GetCryptographicMessageSyntax() const;
+
+  /// Set/Get the mapping of original values to dummy values. When not set
+  /// (nullptr) the one shared by all Anonymizer instances is used.
+  void SetDummyValueMap( DummyValueMap *dvm );
+  DummyValueMap *GetDummyValueMap() const;
+
+  /// De-identify (or re-identify) the input file and write the output file.
+  /// The output file is not created (nor modified) on error.
+  bool BasicApplicationLevelConfidentialityProfile(bool deidentify = true);
+
+  /// After BasicApplicationLevelConfidentialityProfile failed: true when the
+  /// input file could not be read (or is not supported), false when it could
+  /// not be de-identified (re-identified) or the output file written.
+  bool IsInputFileUnreadable() const;
+
+private:
+  StreamingAnonymizerInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMSTREAMINGANONYMIZER_H
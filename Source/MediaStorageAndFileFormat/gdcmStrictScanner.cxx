@@ -107,6 +107,8 @@ bool StrictScanner::Scan( Directory::FilenamesType const & filenames )
     // Prepare hash table:
     Mappings.clear();
     Mappings[""]; // Create a fake table for dummy file
+    ValueIndex.clear();
+    TrimmedValueIndex.clear();
 
     // Make our own copy:
     Filenames = filenames;
@@ -161,6 +163,7 @@ bool StrictScanner::Scan( Directory::FilenamesType const & filenames )
         // Keep the mapping:
         sf.SetFile( reader.GetFile() );
         StrictScanner::ProcessPublicTag(sf, filename);
+        IndexFile(filename, it - Filenames.begin());
         //StrictScanner::ProcessPrivateTag(sf, filename);
         }
         }
@@ -312,30 +315,35 @@ const char* StrictScanner::GetValue(const char *filename, Tag const &t) const
 const char *StrictScanner::GetFilenameFromTagToValue(Tag const &t, const char *valueref) const
 {
   const char *filenameref = nullptr;
-  if( valueref )
+  std::map<Tag, ValueToFileIdsType>::const_iterator index = ValueIndex.find( t );
+  if( valueref && index != ValueIndex.end() )
     {
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
     size_t len = strlen( valueref );
     if( len && valueref[ len - 1 ] == ' ' )
       {
       --len;
       }
-    for(; file != Filenames.end() && !filenameref; ++file)
+    // All values starting with valueref are contiguous, find the one used by
+    // the first file
+    const std::string prefix( valueref, len );
+    const ValueToFileIdsType &valuetofiles = index->second;
+    size_t first = Filenames.size();
+    ValueToFileIdsType::const_iterator it = valuetofiles.lower_bound( prefix.c_str() );
+    for( ; it != valuetofiles.end() && strncmp( it->first, valueref, len ) == 0; ++it )
       {
-      const char *filename = file->c_str();
-      const char * value = GetValue(filename, t);
-      if( value && strncmp(value, valueref, len ) == 0 )
-        {
-        filenameref = filename;
-        }
+      first = std::min( first, it->second.front() );
+      }
+    if( first < Filenames.size() )
+      {
+      filenameref = Filenames[first].c_str();
       }
     }
   return filenameref;
 }
 
 
-/// Will loop over all files and return a vector of std::strings of filenames
-/// where value match the reference value 'valueref'
+/// Return a vector of std::strings of filenames where value match the
+/// reference value 'valueref'
 Directory::FilenamesType
 StrictScanner::GetAllFilenamesFromTagToValue(Tag const &t, const char *valueref) const
 {
@@ -343,15 +351,33 @@ StrictScanner::GetAllFilenamesFromTagToValue(Tag const &t, const char *valueref)
   if( valueref )
     {
     const std::string valueref_str = String<>::Trim( valueref );
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
-    for(; file != Filenames.end(); ++file)
+    if( valueref_str.empty() )
+      {
+      // files without this tag are also a match
+      Directory::FilenamesType::const_iterator file = Filenames.begin();
+      for(; file != Filenames.end(); ++file)
+        {
+        const char *filename = file->c_str();
+        const char * value = GetValue(filename, t);
+        if( String<>::Trim( value ).empty() )
+          {
+          theReturn.push_back( filename );
+          }
+        }
+      return theReturn;
+      }
+    std::map<Tag, std::map<std::string, FileIdsType> >::const_iterator index =
+      TrimmedValueIndex.find( t );
+    if( index != TrimmedValueIndex.end() )
       {
-      const char *filename = file->c_str();
-      const char * value = GetValue(filename, t);
-      const std::string value_str = String<>::Trim( value );
-      if( value_str == valueref_str )
+      std::map<std::string, FileIdsType>::const_iterator it = index->second.find( valueref_str );
+      if( it != index->second.end() )
         {
-        theReturn.push_back( filename );
+        const FileIdsType &ids = it->second;
+        for( FileIdsType::const_iterator id = ids.begin(); id != ids.end(); ++id )
+          {
+          theReturn.push_back( Filenames[*id] );
+          }
         }
       }
     }
@@ -367,14 +393,13 @@ StrictScanner::TagToValue const & StrictScanner::GetMappingFromTagToValue(Tag co
 StrictScanner::ValuesType StrictScanner::GetValues(Tag const &t) const
 {
   ValuesType vt;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
+  std::map<Tag, ValueToFileIdsType>::const_iterator index = ValueIndex.find( t );
+  if( index != ValueIndex.end() )
     {
-    const char *filename = file->c_str();
-    TagToValue const &ttv = GetMapping(filename);
-    if( ttv.find(t) != ttv.end() )
+    ValueToFileIdsType::const_iterator it = index->second.begin();
+    for( ; it != index->second.end(); ++it )
       {
-      vt.insert( ttv.find(t)->second );
+      vt.insert( vt.end(), it->first );
       }
     }
   return vt;
@@ -384,22 +409,38 @@ StrictScanner::ValuesType StrictScanner::GetValues(Tag const &t) const
 Directory::FilenamesType StrictScanner::GetOrderedValues(Tag const &t) const
 {
   Directory::FilenamesType theReturn;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
+  std::map<Tag, ValueToFileIdsType>::const_iterator index = ValueIndex.find( t );
+  if( index != ValueIndex.end() )
     {
-    const char *filename = file->c_str();
-    TagToValue const &ttv = GetMapping(filename);
-    if( ttv.find(t) != ttv.end() )
+    // order the values by the first file they were found in
+    std::vector< std::pair<size_t, const char*> > firsts;
+    ValueToFileIdsType::const_iterator it = index->second.begin();
+    for( ; it != index->second.end(); ++it )
       {
-        std::string theVal = std::string(ttv.find(t)->second);
-        if (std::find(theReturn.begin(), theReturn.end(), theVal) == theReturn.end()){
-          theReturn.push_back( theVal );//only add new tags to the list
-        }
+      firsts.push_back( std::make_pair( it->second.front(), it->first ) );
+      }
+    std::sort( firsts.begin(), firsts.end() );
+    for( size_t i = 0; i < firsts.size(); ++i )
+      {
+      theReturn.push_back( firsts[i].second );
       }
     }
   return theReturn;
 }
 
+void StrictScanner::IndexFile(const char *filename, size_t id)
+{
+  const TagToValue &mapping = GetMapping( filename );
+  TagToValue::const_iterator it = mapping.begin();
+  for( ; it != mapping.end(); ++it )
+    {
+    const Tag &tag = it->first;
+    const char *value = it->second;
+    ValueIndex[tag][value].push_back( id );
+    TrimmedValueIndex[tag][String<>::Trim( value )].push_back( id );
+    }
+}
+
 void StrictScanner::ProcessPublicTag(StringFilter &sf, const char *filename)
 {
   assert( filename );
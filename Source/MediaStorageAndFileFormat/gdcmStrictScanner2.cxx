@@ -114,6 +114,8 @@ bool StrictScanner2::Scan( Directory::FilenamesType const & filenames )
     PublicMappings[""]; // Create a fake table for dummy file
     PrivateMappings.clear();
     PrivateMappings[""]; // Create a fake table for dummy file
+    PublicValueIndex.clear();
+    PrivateValueIndex.clear();
 
     // Make our own copy:
     Filenames = filenames;
@@ -173,6 +175,7 @@ bool StrictScanner2::Scan( Directory::FilenamesType const & filenames )
         sf.SetFile( reader.GetFile() );
         StrictScanner2::ProcessPublicTag(sf, filename);
         StrictScanner2::ProcessPrivateTag(sf, filename);
+        IndexFile(filename, it - Filenames.begin());
         }
         }
       // Update progress
@@ -383,88 +386,95 @@ const char* StrictScanner2::GetPrivateValue(const char *filename, PrivateTag con
   return nullptr;
 }
 
-const char *StrictScanner2::GetFilenameFromPublicTagToValue(Tag const &t, const char *valueref) const
+// Files (in ascending order) where tag t has the value valueref
+template <typename TIndex, typename TTag>
+static const std::vector<size_t> *FindFileIds(TIndex const &index, TTag const &t,
+  const char *valueref)
 {
-  const char *filenameref = nullptr;
-  if( valueref )
+  if( !valueref ) return nullptr;
+  typename TIndex::const_iterator it = index.find( t );
+  if( it == index.end() ) return nullptr;
+  const std::string valueref_str = String<>::Trim( valueref );
+  typename TIndex::mapped_type::const_iterator v = it->second.find( valueref_str.c_str() );
+  if( v == it->second.end() ) return nullptr;
+  return &v->second;
+}
+
+template <typename TIndex, typename TTag>
+static Directory::FilenamesType FindFilenames(TIndex const &index, TTag const &t,
+  const char *valueref, Directory::FilenamesType const &filenames)
+{
+  Directory::FilenamesType theReturn;
+  const std::vector<size_t> *ids = FindFileIds( index, t, valueref );
+  if( ids )
     {
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
-    const std::string valueref_str = String<>::Trim( valueref );
-    for(; file != Filenames.end() && !filenameref; ++file)
+    for( std::vector<size_t>::const_iterator id = ids->begin(); id != ids->end(); ++id )
       {
-      const char *filename = file->c_str();
-      const char * value = GetPublicValue(filename, t);
-      if( value && valueref == value )
-        {
-        filenameref = filename;
-        }
+      theReturn.push_back( filenames[*id] );
       }
     }
-  return filenameref;
+  return theReturn;
 }
 
-const char *StrictScanner2::GetFilenameFromPrivateTagToValue(PrivateTag const &pt, const char *valueref) const
+template <typename TIndex, typename TTag>
+static StrictScanner2::ValuesType FindValues(TIndex const &index, TTag const &t)
 {
-  const char *filenameref = nullptr;
-  if( valueref )
+  StrictScanner2::ValuesType vt;
+  typename TIndex::const_iterator it = index.find( t );
+  if( it != index.end() )
     {
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
-    const std::string valueref_str = String<>::Trim( valueref );
-    for(; file != Filenames.end() && !filenameref; ++file)
+    typename TIndex::mapped_type::const_iterator v = it->second.begin();
+    for( ; v != it->second.end(); ++v )
       {
-      const char *filename = file->c_str();
-      const char * value = GetPrivateValue(filename, pt);
-      if( value && valueref_str == value )
-        {
-        filenameref = filename;
-        }
+      vt.insert( vt.end(), v->first );
       }
     }
-  return filenameref;
+  return vt;
 }
 
-
-
-/// Will loop over all files and return a vector of std::strings of filenames
-/// where value match the reference value 'valueref'
-Directory::FilenamesType StrictScanner2::GetAllFilenamesFromPublicTagToValue(Tag const &t, const char *valueref) const
+template <typename TIndex, typename TTag>
+static Directory::FilenamesType FindOrderedValues(TIndex const &index, TTag const &t)
 {
   Directory::FilenamesType theReturn;
-  if( valueref )
+  typename TIndex::const_iterator it = index.find( t );
+  if( it != index.end() )
     {
-    const std::string valueref_str = String<>::Trim( valueref );
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
-    for(; file != Filenames.end(); ++file)
+    // order the values by the first file they were found in
+    std::vector< std::pair<size_t, const char*> > firsts;
+    typename TIndex::mapped_type::const_iterator v = it->second.begin();
+    for( ; v != it->second.end(); ++v )
       {
-      const char *filename = file->c_str();
-      const char * value = GetPublicValue(filename, t);
-      if( value && valueref_str == value )
-        {
-        theReturn.push_back( filename );
-        }
+      firsts.push_back( std::make_pair( v->second.front(), v->first ) );
+      }
+    std::sort( firsts.begin(), firsts.end() );
+    for( size_t i = 0; i < firsts.size(); ++i )
+      {
+      theReturn.push_back( firsts[i].second );
       }
     }
   return theReturn;
 }
 
+const char *StrictScanner2::GetFilenameFromPublicTagToValue(Tag const &t, const char *valueref) const
+{
+  const FileIdsType *ids = FindFileIds( PublicValueIndex, t, valueref );
+  return ids ? Filenames[ ids->front() ].c_str() : nullptr;
+}
+
+const char *StrictScanner2::GetFilenameFromPrivateTagToValue(PrivateTag const &pt, const char *valueref) const
+{
+  const FileIdsType *ids = FindFileIds( PrivateValueIndex, pt, valueref );
+  return ids ? Filenames[ ids->front() ].c_str() : nullptr;
+}
+
+Directory::FilenamesType StrictScanner2::GetAllFilenamesFromPublicTagToValue(Tag const &t, const char *valueref) const
+{
+  return FindFilenames( PublicValueIndex, t, valueref, Filenames );
+}
+
 Directory::FilenamesType StrictScanner2::GetAllFilenamesFromPrivateTagToValue(PrivateTag const &pt, const char *valueref) const
 {
-  Directory::FilenamesType theReturn;
-  if( valueref )
-    {
-    const std::string valueref_str = String<>::Trim( valueref );
-    Directory::FilenamesType::const_iterator file = Filenames.begin();
-    for(; file != Filenames.end(); ++file)
-      {
-      const char *filename = file->c_str();
-      const char * value = GetPrivateValue(filename, pt);
-      if( value && valueref_str == value )
-        {
-        theReturn.push_back( filename );
-        }
-      }
-    }
-  return theReturn;
+  return FindFilenames( PrivateValueIndex, pt, valueref, Filenames );
 }
 
 StrictScanner2::PublicTagToValue const & StrictScanner2::GetMappingFromPublicTagToValue(Tag const &t, const char *valueref) const
@@ -479,72 +489,38 @@ StrictScanner2::PrivateTagToValue const & StrictScanner2::GetMappingFromPrivateT
 
 StrictScanner2::ValuesType StrictScanner2::GetPublicValues(Tag const &t) const
 {
-  ValuesType vt;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
-    {
-    const char *filename = file->c_str();
-    PublicTagToValue const &ttv = GetPublicMapping(filename);
-    if( ttv.find(t) != ttv.end() )
-      {
-      vt.insert( ttv.find(t)->second );
-      }
-    }
-  return vt;
+  return FindValues( PublicValueIndex, t );
 }
 
 StrictScanner2::ValuesType StrictScanner2::GetPrivateValues(PrivateTag const &pt) const
 {
-  ValuesType vt;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
-    {
-    const char *filename = file->c_str();
-    PrivateTagToValue const &ttv = GetPrivateMapping(filename);
-    if( ttv.find(pt) != ttv.end() )
-      {
-      vt.insert( ttv.find(pt)->second );
-      }
-    }
-  return vt;
+  return FindValues( PrivateValueIndex, pt );
 }
 
 Directory::FilenamesType StrictScanner2::GetPublicOrderedValues(Tag const &t) const
 {
-  Directory::FilenamesType theReturn;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
-    {
-    const char *filename = file->c_str();
-    PublicTagToValue const &ttv = GetPublicMapping(filename);
-    if( ttv.find(t) != ttv.end() )
-      {
-        std::string theVal = std::string(ttv.find(t)->second);
-        if (std::find(theReturn.begin(), theReturn.end(), theVal) == theReturn.end()){
-          theReturn.push_back( theVal );//only add new tags to the list
-        }
-      }
-    }
-  return theReturn;
+  return FindOrderedValues( PublicValueIndex, t );
 }
 
 Directory::FilenamesType StrictScanner2::GetPrivateOrderedValues(PrivateTag const &pt) const
 {
-  Directory::FilenamesType theReturn;
-  Directory::FilenamesType::const_iterator file = Filenames.begin();
-  for(; file != Filenames.end(); ++file)
+  return FindOrderedValues( PrivateValueIndex, pt );
+}
+
+void StrictScanner2::IndexFile(const char *filename, size_t id)
+{
+  const PublicTagToValue &publicmapping = GetPublicMapping( filename );
+  for( PublicTagToValue::const_iterator it = publicmapping.begin();
+    it != publicmapping.end(); ++it )
     {
-    const char *filename = file->c_str();
-    PrivateTagToValue const &ttv = GetPrivateMapping(filename);
-    if( ttv.find(pt) != ttv.end() )
-      {
-        std::string theVal = std::string(ttv.find(pt)->second);
-        if (std::find(theReturn.begin(), theReturn.end(), theVal) == theReturn.end()){
-          theReturn.push_back( theVal );//only add new tags to the list
-        }
-      }
+    PublicValueIndex[it->first][it->second].push_back( id );
+    }
+  const PrivateTagToValue &privatemapping = GetPrivateMapping( filename );
+  for( PrivateTagToValue::const_iterator it = privatemapping.begin();
+    it != privatemapping.end(); ++it )
+    {
+    PrivateValueIndex[it->first][it->second].push_back( id );
     }
-  return theReturn;
 }
 
 void StrictScanner2::ProcessPublicTag(StringFilter &sf, const char *filename)
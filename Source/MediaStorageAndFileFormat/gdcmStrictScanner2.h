@@ -23,6 +23,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <string.h>  // strcmp
 
@@ -157,8 +158,8 @@ class GDCM_EXPORT StrictScanner2 : public Subject {
   const char *GetFilenameFromPrivateTagToValue(PrivateTag const &pt,
                                                const char *valueref) const;
 
-  /// Will loop over all files and return a vector of std::strings of filenames
-  /// where value match the reference value 'valueref'
+  /// Return a vector of std::strings of filenames where value match the
+  /// reference value 'valueref'
   Directory::FilenamesType GetAllFilenamesFromPublicTagToValue(
       Tag const &t, const char *valueref) const;
   Directory::FilenamesType GetAllFilenamesFromPrivateTagToValue(
@@ -202,6 +203,14 @@ class GDCM_EXPORT StrictScanner2 : public Subject {
   // Main struct that will hold all private mapping:
   PrivateMappingType PrivateMappings;
 
+  // Inverted indexes: for each tag, map each value to the files (position in
+  // Filenames, in ascending order) where it was found
+  typedef std::vector<size_t> FileIdsType;
+  typedef std::map<const char *, FileIdsType, ltstr> ValueToFileIdsType;
+  std::map<Tag, ValueToFileIdsType> PublicValueIndex;
+  std::map<PrivateTag, ValueToFileIdsType> PrivateValueIndex;
+  void IndexFile(const char *filename, size_t id);
+
   double Progress;
 };
 //-----------------------------------------------------------------------------
@@ -490,6 +490,19 @@ std::pair<std::string, std::string> StringFilter::ToStringPairInternal(const Dat
       } \
     break
 
+// Same as above for numbers, parsed directly from value (see ASCIINumber)
+#define FromStringFilterNumberCase(type) \
+  case VR::type: \
+      { \
+      Element<VR::type,VM::VM1_n> el; \
+      el.SetLength( vl );  \
+      if( el.GetLength() ) \
+        EncodingImplementation<VR::VRASCII>::Read(&el.GetValue(), \
+          el.GetLength(), value, value + len); \
+      el.Write(os); \
+      } \
+    break
+
 #if 0
 static inline size_t count_backslash(const char *s, size_t len)
 {
@@ -577,17 +590,17 @@ std::string StringFilter::FromString(const Tag&t, const char * value, size_t len
   switch(vr)
     {
     FromStringFilterCase(AT);
-    FromStringFilterCase(FL);
-    FromStringFilterCase(FD);
+    FromStringFilterNumberCase(FL);
+    FromStringFilterNumberCase(FD);
     //FromStringFilterCase(OB);
-    FromStringFilterCase(OF);
+    FromStringFilterNumberCase(OF);
     //FromStringFilterCase(OW);
-    FromStringFilterCase(SL);
+    FromStringFilterNumberCase(SL);
     //FromStringFilterCase(SQ);
-    FromStringFilterCase(SS);
-    FromStringFilterCase(UL);
+    FromStringFilterNumberCase(SS);
+    FromStringFilterNumberCase(UL);
     //FromStringFilterCase(UN);
-    FromStringFilterCase(US);
+    FromStringFilterNumberCase(US);
   default:
     gdcmErrorMacro( "Not implemented" );
     assert(0);
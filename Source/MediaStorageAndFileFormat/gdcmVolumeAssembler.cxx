@@ -0,0 +1,313 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmVolumeAssembler.h"
+#include "gdcmImageRegionReader.h"
+#include "gdcmImageReader.h"
+#include "gdcmDirectionCosines.h"
+#include "gdcmParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gdcm
+{
+
+class VolumeAssemblerInternals
+{
+public:
+  std::vector<std::string> FileNames;
+  Image Volume;
+  // The first slice, all others are compared to it
+  Image Reference;
+  unsigned int NumberOfFrames{0}; // per file
+  size_t SliceLength{0};
+  std::vector<char> Buffer;
+  unsigned int NumberOfThreads{0};
+  double Tolerance{1e-3};
+};
+
+VolumeAssembler::VolumeAssembler():Internals(new VolumeAssemblerInternals)
+{
+}
+
+VolumeAssembler::~VolumeAssembler()
+{
+  delete Internals;
+}
+
+void VolumeAssembler::SetNumberOfThreads(unsigned int nthreads)
+{
+  Internals->NumberOfThreads = nthreads;
+}
+
+unsigned int VolumeAssembler::GetNumberOfThreads() const
+{
+  return Internals->NumberOfThreads;
+}
+
+void VolumeAssembler::SetTolerance(double tolerance)
+{
+  Internals->Tolerance = tolerance;
+}
+
+double VolumeAssembler::GetTolerance() const
+{
+  return Internals->Tolerance;
+}
+
+static unsigned int GetNumberOfFrames(Image const & img)
+{
+  return img.GetNumberOfDimensions() > 2 ? img.GetDimension(2) : 1;
+}
+
+bool VolumeAssembler::ReadInformation(std::vector<std::string> const & filenames)
+{
+  Internals->FileNames.clear();
+  Internals->SliceLength = 0;
+  if( filenames.empty() )
+    {
+    gdcmErrorMacro( "No file to read" );
+    return false;
+    }
+  ImageRegionReader reader;
+  reader.SetFileName( filenames[0].c_str() );
+  if( !reader.ReadInformation() )
+    {
+    gdcmErrorMacro( "Could not read: " << filenames[0] );
+    return false;
+    }
+  const Image &ref = reader.GetImage();
+  const unsigned int nframes = GetNumberOfFrames( ref );
+  if( filenames.size() > 1 && nframes != 1 )
+    {
+    gdcmErrorMacro( "Only single frame slices can be assembled: " << filenames[0] );
+    return false;
+    }
+  Internals->Reference = ref;
+  Internals->NumberOfFrames = nframes;
+  Internals->SliceLength = ref.GetBufferLength();
+  if( !Internals->SliceLength )
+    {
+    gdcmErrorMacro( "Cannot load an image of 0 bytes: " << filenames[0] );
+    return false;
+    }
+  Internals->FileNames = filenames;
+
+  Image &volume = Internals->Volume;
+  volume = Image();
+  volume.SetNumberOfDimensions( 3 );
+  volume.SetDimension( 0, ref.GetDimension(0) );
+  volume.SetDimension( 1, ref.GetDimension(1) );
+  volume.SetDimension( 2, (unsigned int)filenames.size() * nframes );
+  volume.SetPixelFormat( ref.GetPixelFormat() );
+  volume.SetPhotometricInterpretation( ref.GetPhotometricInterpretation() );
+  volume.SetPlanarConfiguration( ref.GetPlanarConfiguration() );
+  // A single slice image only has 2 dimensions
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    volume.SetSpacing( i, i < ref.GetNumberOfDimensions() ? ref.GetSpacing(i) : 1. );
+    volume.SetOrigin( i, ref.GetOrigin(i) );
+    }
+  double dircos[6];
+  for( unsigned int i = 0; i < 6; ++i )
+    dircos[i] = ref.GetDirectionCosines(i);
+  volume.SetDirectionCosines( dircos );
+  volume.SetIntercept( ref.GetIntercept() );
+  volume.SetSlope( ref.GetSlope() );
+  return true;
+}
+
+size_t VolumeAssembler::ComputeBufferLength() const
+{
+  return Internals->SliceLength * Internals->FileNames.size();
+}
+
+// Check that img can be stored next to ref in the volume
+static bool IsCompatible(Image const & ref, Image const & img, double tolerance)
+{
+  if( img.GetDimension(0) != ref.GetDimension(0)
+    || img.GetDimension(1) != ref.GetDimension(1)
+    || GetNumberOfFrames(img) != GetNumberOfFrames(ref) )
+    {
+    gdcmErrorMacro( "Dimensions do not match" );
+    return false;
+    }
+  if( img.GetPixelFormat() != ref.GetPixelFormat()
+    || img.GetPhotometricInterpretation() != ref.GetPhotometricInterpretation()
+    || img.GetPlanarConfiguration() != ref.GetPlanarConfiguration() )
+    {
+    gdcmErrorMacro( "Pixel format does not match" );
+    return false;
+    }
+  if( img.GetIntercept() != ref.GetIntercept() || img.GetSlope() != ref.GetSlope() )
+    {
+    gdcmErrorMacro( "Rescale Intercept/Slope do not match" );
+    return false;
+    }
+  for( unsigned int i = 0; i < 6; ++i )
+    {
+    if( std::fabs( img.GetDirectionCosines(i) - ref.GetDirectionCosines(i) ) > tolerance )
+      {
+      gdcmErrorMacro( "Direction cosines do not match" );
+      return false;
+      }
+    }
+  if( std::fabs( img.GetSpacing(0) - ref.GetSpacing(0) ) > tolerance
+    || std::fabs( img.GetSpacing(1) - ref.GetSpacing(1) ) > tolerance )
+    {
+    gdcmErrorMacro( "Pixel spacing does not match" );
+    return false;
+    }
+  return true;
+}
+
+// Decode one slice at buffer. ImageRegionReader reads (or decodes) straight
+// into the output buffer, the ImageReader is only used for what it does not
+// support (12 bits, deflated data...)
+static bool ReadSlice(const char *filename, Image const & ref, double tolerance,
+  char *buffer, size_t len, double origin[3])
+{
+  {
+  ImageRegionReader reader;
+  reader.SetFileName( filename );
+  if( !reader.ReadInformation() )
+    {
+    gdcmErrorMacro( "Could not read: " << filename );
+    return false;
+    }
+  const Image &img = reader.GetImage();
+  if( !IsCompatible( ref, img, tolerance ) )
+    {
+    gdcmErrorMacro( "Slice cannot be part of the volume: " << filename );
+    return false;
+    }
+  for( unsigned int i = 0; i < 3; ++i )
+    origin[i] = img.GetOrigin(i);
+  if( reader.ComputeBufferLength() == len && reader.ReadIntoBuffer( buffer, len ) )
+    {
+    return true;
+    }
+  }
+  gdcmDebugMacro( "Decoding the whole image: " << filename );
+  ImageReader reader;
+  reader.SetFileName( filename );
+  if( !reader.Read() )
+    {
+    gdcmErrorMacro( "Could not read: " << filename );
+    return false;
+    }
+  const Image &img = reader.GetImage();
+  if( img.GetBufferLength() != len || !img.GetBuffer( buffer ) )
+    {
+    gdcmErrorMacro( "Could not decode: " << filename );
+    return false;
+    }
+  return true;
+}
+
+bool VolumeAssembler::ReadIntoBuffer(char *buffer, size_t buflen)
+{
+  const std::vector<std::string> &filenames = Internals->FileNames;
+  const size_t nfiles = filenames.size();
+  const size_t slicelen = Internals->SliceLength;
+  if( !nfiles || !slicelen )
+    {
+    gdcmErrorMacro( "ReadInformation was not called" );
+    return false;
+    }
+  if( !buffer || buflen < slicelen * nfiles )
+    {
+    gdcmErrorMacro( "Buffer is too small" );
+    return false;
+    }
+
+  // Each thread takes the next slice to decode, until there is none left or
+  // a slice failed
+  std::vector<double> origins( 3 * nfiles );
+  const Image &ref = Internals->Reference;
+  const double tolerance = Internals->Tolerance;
+  const bool decoded = ParallelFor( nfiles,
+    ComputeNumberOfThreads( Internals->NumberOfThreads, nfiles ),
+    [&]( size_t i, unsigned int ) {
+      try
+        {
+        return ReadSlice( filenames[i].c_str(), ref, tolerance,
+          buffer + i * slicelen, slicelen, &origins[3 * i] );
+        }
+      catch( std::exception &ex )
+        {
+        gdcmErrorMacro( "Exception while reading: " << filenames[i] << ": " << ex.what() );
+        return false;
+        }
+    } );
+  if( !decoded ) return false;
+
+  // Slices must be evenly spaced along the normal:
+  if( nfiles > 1 )
+    {
+    double normal[3];
+    const DirectionCosines dc( Internals->Volume.GetDirectionCosines() );
+    dc.Cross( normal );
+    DirectionCosines::Normalize( normal );
+    std::vector<double> distances( nfiles );
+    for( size_t i = 0; i < nfiles; ++i )
+      {
+      const double *ipp = &origins[3 * i];
+      distances[i] = normal[0] * ipp[0] + normal[1] * ipp[1] + normal[2] * ipp[2];
+      }
+    const double zspacing = (distances[nfiles - 1] - distances[0]) / (double)(nfiles - 1);
+    if( zspacing <= tolerance )
+      {
+      gdcmErrorMacro( "Slices are not sorted along the normal" );
+      return false;
+      }
+    for( size_t i = 1; i < nfiles; ++i )
+      {
+      if( std::fabs( distances[i] - distances[i - 1] - zspacing ) > tolerance )
+        {
+        gdcmErrorMacro( "Slices are not evenly spaced: " << filenames[i] );
+        return false;
+        }
+      }
+    Internals->Volume.SetSpacing( 2, zspacing );
+    }
+  return true;
+}
+
+bool VolumeAssembler::Assemble(std::vector<std::string> const & filenames)
+{
+  Internals->Buffer.clear();
+  if( !ReadInformation( filenames ) ) return false;
+  std::vector<char> buffer( ComputeBufferLength() );
+  if( !ReadIntoBuffer( buffer.data(), buffer.size() ) ) return false;
+  Internals->Buffer.swap( buffer );
+  return true;
+}
+
+const Image & VolumeAssembler::GetImage() const
+{
+  return Internals->Volume;
+}
+
+const char *VolumeAssembler::GetBuffer() const
+{
+  return Internals->Buffer.empty() ? nullptr : Internals->Buffer.data();
+}
+
+size_t VolumeAssembler::GetBufferLength() const
+{
+  return Internals->Buffer.size();
+}
+
+} // end namespace gdcm
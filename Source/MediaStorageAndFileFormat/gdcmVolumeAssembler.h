@@ -0,0 +1,101 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef GDCMVOLUMEASSEMBLER_H
+#define GDCMVOLUMEASSEMBLER_H
+
+#include "gdcmImage.h"
+
+#include <string>
+#include <vector>
+
+namespace gdcm
+{
+
+class VolumeAssemblerInternals;
+
+/**
+ * \brief VolumeAssembler
+ * \details Read a series of slices (one file per slice, already sorted, for
+ * instance with IPPSorter) into a single volume buffer. Each slice is decoded
+ * directly at its offset in the buffer, several slices in parallel, so there
+ * is no intermediate copy of the volume.
+ *
+ * All slices must have the same dimensions, pixel format, photometric
+ * interpretation, planar configuration, direction cosines and Rescale
+ * Intercept/Slope than the first one, and be evenly spaced along the slice
+ * normal (in increasing order).
+ *
+ * Usage:
+ * \code
+ * VolumeAssembler va;
+ * va.Assemble( sorter.GetFilenames() );
+ * const Image &volume = va.GetImage();
+ * const char *buffer = va.GetBuffer();
+ * \endcode
+ * or, to decode into a buffer owned by the caller, ReadInformation and
+ * ReadIntoBuffer.
+ *
+ * \see IPPSorter ImageRegionReader
+ */
+class GDCM_EXPORT VolumeAssembler
+{
+public:
+  VolumeAssembler();
+  ~VolumeAssembler();
+  VolumeAssembler(const VolumeAssembler&) = delete;
+  void operator=(const VolumeAssembler&) = delete;
+
+  /// Limit the number of slices decoded concurrently (by default, one per core)
+  void SetNumberOfThreads(unsigned int nthreads);
+  unsigned int GetNumberOfThreads() const;
+
+  /// Set/Get the tolerance used to compare the direction cosines and the
+  /// spacing in between slices (default 1e-3)
+  void SetTolerance(double tolerance);
+  double GetTolerance() const;
+
+  /// Read the meta information of the first slice of filenames, and compute
+  /// the volume (see GetImage) and buffer length.
+  /// \return false upon error
+  bool ReadInformation(std::vector<std::string> const & filenames);
+
+  /// Minimal length of the buffer which can hold the whole volume
+  /// \return 0 upon error
+  size_t ComputeBufferLength() const;
+
+  /// Decode all slices into buffer, slice i at offset i * (slice length).
+  /// The Z spacing of the volume is computed from the Image Position
+  /// (Patient) of the slices.
+  /// \return false upon error, or when a slice does not match the first one
+  bool ReadIntoBuffer(char *buffer, size_t buflen);
+
+  /// ReadInformation, then ReadIntoBuffer into a buffer allocated
+  /// internally (see GetBuffer)
+  bool Assemble(std::vector<std::string> const & filenames);
+
+  /// The volume: dimensions, spacing, origin (the one of the first slice),
+  /// direction cosines, pixel format... There is no Pixel Data attached.
+  const Image & GetImage() const;
+
+  /// Buffer filled by the last call to Assemble
+  const char *GetBuffer() const;
+  size_t GetBufferLength() const;
+
+private:
+  VolumeAssemblerInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif //GDCMVOLUMEASSEMBLER_H
@@ -227,6 +227,13 @@ void AAssociateACPDU::InitFromRQ( AAssociateRQPDU const & rqpdu )
 }
 
 
+void AAssociateACPDU::SetUserInformation( UserInformation const & ui )
+{
+  UserInfo = ui;
+  PDULength = (uint32_t)Size() - 6;
+  assert( (PDULength + 4 + 1 + 1) == Size() );
+}
+
 void AAssociateACPDU::InitSimple( AAssociateRQPDU const & rqpdu )
 {
   TransferSyntaxSub ts1;
@@ -43,7 +43,8 @@ namespace gdcm
     {
     eFind= 0,
     eMove,
-    eWLMFind
+    eWLMFind,
+    eGet
     };
 
 /**
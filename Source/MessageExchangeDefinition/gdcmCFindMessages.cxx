@@ -27,6 +27,7 @@ this file defines the messages for the cfind action
 #include "gdcmPresentationContextRQ.h"
 #include "gdcmCommandDataSet.h"
 #include "gdcmULConnection.h"
+#include "gdcmPDataTFPDU.h"
 
 namespace gdcm{
 namespace network{
@@ -117,6 +118,63 @@ std::vector<PresentationDataValue>  CFindCancelRQ::ConstructPDVByDataSet(const D
   return thePDV;
 }
 
+std::vector<PresentationDataValue> CFindCancelRQ::ConstructPDV(const ULConnection &, const BaseRootQuery* inRootQuery)
+{
+  std::vector<PresentationDataValue> thePDVs;
+  (void)inRootQuery;
+  assert( 0 && "TODO" );
+  return thePDVs;
+}
+
+std::vector<PresentationDataValue> CFindCancelRQ::ConstructPDV(const DataSet* inDataSet,
+  const BasePDU* inPDU)
+{
+  std::vector<PresentationDataValue> thePDVs;
+  const PDataTFPDU* theDataPDU = dynamic_cast<const PDataTFPDU*>(inPDU);
+  if( !theDataPDU || !theDataPDU->GetNumberOfPresentationDataValues() )
+    {
+    gdcmErrorMacro( "Could not find Pres Cont ID" );
+    return thePDVs;
+    }
+  PresentationDataValue thePDV;
+  thePDV.SetPresentationContextID(
+    theDataPDU->GetPresentationDataValue(0).GetPresentationContextID() );
+  thePDV.SetCommand(true);
+  thePDV.SetLastFragment(true);
+
+  // PS 3.7 / C-CANCEL-FIND-RQ Message Fields (Table 9.1-3)
+  CommandDataSet ds;
+  {
+  Attribute<0x0,0x100> at = { 0x0FFF };
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x120> at = { 1 };
+  Attribute<0x0,0x120> msgid;
+  if( inDataSet->FindDataElement( msgid.GetTag() ) )
+    {
+    msgid.SetFromDataSet( *inDataSet );
+    at.SetValue( msgid.GetValue() );
+    }
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x800> at = { 0x0101 };
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x0> at = { 0 };
+  unsigned int glen = ds.GetLength<ImplicitDataElement>();
+  assert( (glen % 2) == 0 );
+  at.SetValue( glen );
+  ds.Insert( at.GetAsDataElement() );
+  }
+
+  thePDV.SetDataSet(ds);
+  thePDVs.push_back(thePDV);
+  return thePDVs;
+}
+
 
 }//namespace network
 }//namespace gdcm
@@ -25,6 +25,7 @@ namespace gdcm
 {
 namespace network
 {
+class BasePDU;
 
 /**
  * \brief CFindRQ
@@ -52,7 +53,11 @@ public:
  */
   class CFindCancelRQ : public BaseCompositeMessage {
   public:
+    std::vector<PresentationDataValue> ConstructPDV(const ULConnection &inConnection, const BaseRootQuery* inRootQuery) override;//to fulfill the virtual contract
     std::vector<PresentationDataValue> ConstructPDVByDataSet(const DataSet* inDataSet);
+    /// build the C-CANCEL-RQ for the C-FIND being responded to by inDataSet
+    /// (a C-FIND-RSP command set) received in inPDU
+    std::vector<PresentationDataValue> ConstructPDV(const DataSet* inDataSet, const BasePDU* inPDU);
   };
 }
 }
@@ -0,0 +1,101 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmCGetMessages.h"
+#include "gdcmUIDs.h"
+#include "gdcmAttribute.h"
+#include "gdcmImplicitDataElement.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmPresentationContextRQ.h"
+#include "gdcmULConnection.h"
+#include "gdcmTrace.h"
+
+namespace gdcm{
+namespace network{
+
+std::vector<PresentationDataValue> CGetRQ::ConstructPDV(
+  const ULConnection &inConnection,
+  const BaseRootQuery* inRootQuery)
+{
+  std::vector<PresentationDataValue> thePDVs;
+  PresentationContextRQ pc( inRootQuery->GetAbstractSyntaxUID() );
+  const uint8_t prescontid =
+    inConnection.GetPresentationContextIDFromPresentationContext(pc);
+{
+  PresentationDataValue thePDV;
+  thePDV.SetPresentationContextID( prescontid );
+  thePDV.SetCommand(true);
+  thePDV.SetLastFragment(true);
+
+  CommandDataSet ds;
+  ds.Insert( pc.GetAbstractSyntax().GetAsDataElement() );
+  {
+  Attribute<0x0,0x100> at = { 0x0010 };// C-GET-RQ
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x110> at = { 1 };
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x700> at = { 0 };
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x800> at = { 1 };
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  Attribute<0x0,0x0> at = { 0 };
+  unsigned int glen = ds.GetLength<ImplicitDataElement>();
+  assert( (glen % 2) == 0 );
+  at.SetValue( glen );
+  ds.Insert( at.GetAsDataElement() );
+  }
+
+  thePDV.SetDataSet(ds);
+  thePDVs.push_back(thePDV);
+}
+  {
+  PresentationDataValue thePDV;
+  thePDV.SetPresentationContextID( prescontid );
+  thePDV.SetDataSet(inRootQuery->GetQueryDataSet());
+  thePDV.SetMessageHeader( 2 );
+  thePDVs.push_back(thePDV);
+  }
+  return thePDVs;
+}
+
+// A C-GET-RQ is built from a query (see ConstructPDV), not from a data set
+std::vector<PresentationDataValue> CGetRQ::ConstructPDVByDataSet(const DataSet* inDataSet){
+  std::vector<PresentationDataValue> thePDVs;
+  (void)inDataSet;
+  gdcmErrorMacro( "C-GET-RQ cannot be built from a data set" );
+  return thePDVs;
+}
+
+// The C-GET-RSP depend on the state of the sub-operations, they are sent by
+// ULGetSCPCallback
+std::vector<PresentationDataValue>  CGetRSP::ConstructPDVByDataSet(const DataSet* inDataSet){
+  std::vector<PresentationDataValue> thePDV;
+  (void)inDataSet;
+  gdcmErrorMacro( "C-GET-RSP cannot be built from a data set, see ULGetSCPCallback" );
+  return thePDV;
+}
+
+}//namespace network
+}//namespace gdcm
@@ -0,0 +1,51 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef GDCMCGETMESSAGES_H
+#define GDCMCGETMESSAGES_H
+
+#include "gdcmBaseCompositeMessage.h"
+#include "gdcmBaseRootQuery.h"
+
+namespace gdcm{
+  namespace network{
+  class ULConnection;
+/**
+ * \brief CGetRQ
+ * \details this file defines the messages for the cget action.
+ * Contrary to C-MOVE, the sub-operations C-STORE are sent back over the very
+ * same association, so no Move Destination is needed.
+ */
+class CGetRQ : public BaseCompositeMessage {
+      std::vector<PresentationDataValue> ConstructPDVByDataSet(const DataSet* inDataSet);
+    public:
+      std::vector<PresentationDataValue> ConstructPDV(
+        const ULConnection &inConnection,
+        const BaseRootQuery* inRootQuery) override;
+    };
+
+/**
+ * \brief CGetRSP
+ * this file defines the messages for the cget action
+ */
+class CGetRSP : public BaseCompositeMessage {
+    public:
+      std::vector<PresentationDataValue> ConstructPDVByDataSet(const DataSet* inDataSet);
+    };
+  }
+}
+#endif
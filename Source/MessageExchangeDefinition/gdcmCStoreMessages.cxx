@@ -218,20 +218,11 @@ if( !writeDataSet )
   // now let's chunk'ate the dataset:
 {
   std::stringstream ss;
-#if 0
-  inDataSet->Write<ImplicitDataElement,SwapperNoOp>( ss );
-#else
-  DataSetWriter writer;
-  writer.SetStream( ss );
-  writer.SetFile( file );
-  writer.Write();
-#endif
+  WriteDataSet( file, ss );
 
   std::string ds_copy = ss.str();
   // E: 0006:0308 DUL Illegal PDU Length 16390.  Max expected 16384
-  //const size_t maxpdu = 16384 - 6;
-  size_t maxpdu = 16378;
-  maxpdu = inConnection.GetMaxPDUSize() - 6;
+  const size_t maxpdu = inConnection.GetMaxPDVLength();
   size_t len = ds_copy.size();
   const char *begin = ds_copy.c_str();
   const char *end = begin + len;
@@ -263,6 +254,14 @@ if( !writeDataSet )
 
 }
 
+bool CStoreRQ::WriteDataSet(const File& file, std::ostream &os)
+{
+  DataSetWriter writer;
+  writer.SetStream( os );
+  writer.SetFile( file );
+  return writer.Write();
+}
+
 //private hack
 std::vector<PresentationDataValue> CStoreRQ::ConstructPDV(
 const ULConnection &inConnection, const BaseRootQuery* inRootQuery)
@@ -283,7 +282,7 @@ std::vector<PresentationDataValue>  CStoreRSP::ConstructPDV(const ULConnection &
   return thePDVs;
 }
 
-std::vector<PresentationDataValue> CStoreRSP::ConstructPDV(const DataSet* inDataSet, const BasePDU* inPDU){
+std::vector<PresentationDataValue> CStoreRSP::ConstructPDV(const DataSet* inDataSet, const BasePDU* inPDU, uint16_t inStatus){
   std::vector<PresentationDataValue> thePDVs;
 
 ///should be passed the received dataset, ie, the cstorerq, so that
@@ -318,7 +317,7 @@ std::vector<PresentationDataValue> CStoreRSP::ConstructPDV(const DataSet* inData
     ds.Insert( at.GetAsDataElement() );
     }
     {
-    Attribute<0x0,0x900> at = { 0 };
+    Attribute<0x0,0x900> at = { inStatus };
     ds.Insert( at.GetAsDataElement() );
     }
     {
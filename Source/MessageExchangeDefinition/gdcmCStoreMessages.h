@@ -33,6 +33,9 @@ class CStoreRQ : public BaseCompositeMessage {
     public:
       std::vector<PresentationDataValue> ConstructPDV(const ULConnection &inConnection,
         const File& file,  bool writeDataSet = true );
+      /// Write the data set of file, as it should be sent after the command
+      /// set (ie. ConstructPDV called with writeDataSet = false)
+      static bool WriteDataSet(const File& file, std::ostream &os);
     };
 
 /**
@@ -42,7 +45,7 @@ class CStoreRQ : public BaseCompositeMessage {
     class CStoreRSP : public BaseCompositeMessage {
       std::vector<PresentationDataValue> ConstructPDV(const ULConnection &inConnection, const BaseRootQuery* inRootQuery) override;//to fulfill the virtual contract
     public:
-      std::vector<PresentationDataValue> ConstructPDV(const DataSet* inDataSet, const BasePDU* inPC);
+      std::vector<PresentationDataValue> ConstructPDV(const DataSet* inDataSet, const BasePDU* inPC, uint16_t inStatus = 0);
     };
   }
 }
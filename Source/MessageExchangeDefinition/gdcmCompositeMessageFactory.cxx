@@ -30,6 +30,7 @@ name and date: 4 oct 2010 mmr
 #include "gdcmCStoreMessages.h"
 #include "gdcmCFindMessages.h"
 #include "gdcmCMoveMessages.h"
+#include "gdcmCGetMessages.h"
 #include "gdcmBaseRootQuery.h"
 
 namespace gdcm {
@@ -45,17 +46,26 @@ namespace network {
     CStoreRQ theStoreRQ;
     return theStoreRQ.ConstructPDV( inConnection, file, writeDataSet );
     }
-  std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCStoreRSP(const DataSet *inDataSet, const BasePDU* inPDU) {
+  std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCStoreRSP(const DataSet *inDataSet, const BasePDU* inPDU, uint16_t inStatus) {
     CStoreRSP theStoreRSP;
-    return theStoreRSP.ConstructPDV(inDataSet, inPDU);
+    return theStoreRSP.ConstructPDV(inDataSet, inPDU, inStatus);
   }
   std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCFindRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery) {
     CFindRQ theFindRQ;
     return theFindRQ.ConstructPDV(inConnection, inRootQuery);
   }
+  std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCFindCancelRQ(const DataSet *inDataSet, const BasePDU* inPDU) {
+    CFindCancelRQ theFindCancelRQ;
+    return theFindCancelRQ.ConstructPDV(inDataSet, inPDU);
+  }
   std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCMoveRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery) {
     CMoveRQ theMoveRQ;
     return theMoveRQ.ConstructPDV(inConnection, inRootQuery);
   }
+
+  std::vector<PresentationDataValue> CompositeMessageFactory::ConstructCGetRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery) {
+    CGetRQ theGetRQ;
+    return theGetRQ.ConstructPDV(inConnection, inRootQuery);
+  }
 }
 }
@@ -44,12 +44,15 @@ class CompositeMessageFactory
       static std::vector<PresentationDataValue> ConstructCEchoRQ(const ULConnection& inConnection);
 
       static std::vector<PresentationDataValue> ConstructCStoreRQ(const ULConnection& inConnection,const File &file, bool writeDataSet = true );
-      static std::vector<PresentationDataValue> ConstructCStoreRSP(const DataSet *inDataSet, const BasePDU* inPC);
+      static std::vector<PresentationDataValue> ConstructCStoreRSP(const DataSet *inDataSet, const BasePDU* inPC, uint16_t inStatus = 0);
 
       static  std::vector<PresentationDataValue> ConstructCFindRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
+      static  std::vector<PresentationDataValue> ConstructCFindCancelRQ(const DataSet *inDataSet, const BasePDU* inPC);
 
       static  std::vector<PresentationDataValue> ConstructCMoveRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
 
+      static  std::vector<PresentationDataValue> ConstructCGetRQ(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
+
 
     };
   }
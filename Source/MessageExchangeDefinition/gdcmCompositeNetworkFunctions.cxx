@@ -37,10 +37,27 @@
 #include "gdcmULWritingCallback.h"
 #include "gdcmULBasicCallback.h"
 #include "gdcmPresentationContextGenerator.h"
+#include "gdcmServiceClassUserPool.h"
+#include "gdcmServiceClassUser.h"
+
+#include <algorithm>
+#include <set>
 
 namespace gdcm
 {
 
+static ServiceClassUserPool *AssociationPool = nullptr;
+
+void CompositeNetworkFunctions::SetAssociationPool( ServiceClassUserPool *pool )
+{
+  AssociationPool = pool;
+}
+
+ServiceClassUserPool *CompositeNetworkFunctions::GetAssociationPool()
+{
+  return AssociationPool;
+}
+
 // Execute like this:
 // gdcmscu --echo www.dicomserver.co.uk 11112
 bool CompositeNetworkFunctions::CEcho(const char *remote, uint16_t portno,
@@ -64,6 +81,20 @@ bool CompositeNetworkFunctions::CEcho(const char *remote, uint16_t portno,
     return false;
     }
 
+  if( AssociationPool )
+    {
+    ServiceClassUser *scu = AssociationPool->Acquire( remote, portno,
+      generator.GetPresentationContexts(), aetitle, call );
+    if( !scu )
+      {
+      gdcmErrorMacro( "Failed to establish connection." );
+      return false;
+      }
+    const bool ret = scu->SendEcho();
+    AssociationPool->Release( scu, ret );
+    return ret;
+    }
+
   network::ULConnectionManager theManager;
   if (!theManager.EstablishConnection(aetitle, call, remote, 0, portno, 1000,
       generator.GetPresentationContexts() ))
@@ -131,6 +162,8 @@ BaseRootQuery* CompositeNetworkFunctions::ConstructQuery( ERootType inRootType,
     outQuery = QueryFactory::ProduceQuery(inRootType, eFind, inQueryLevel);
   else if( queryType == eWLMFind )
     outQuery = QueryFactory::ProduceQuery(inRootType, eWLMFind, inQueryLevel);
+  else if( queryType == eGet )
+    outQuery = QueryFactory::ProduceQuery(inRootType, eGet, inQueryLevel);
 
   if (!outQuery)
     {
@@ -209,6 +242,82 @@ bool CompositeNetworkFunctions::CMove( const char *remote, uint16_t portno,
   return ret;
 }
 
+bool CompositeNetworkFunctions::CGet( const char *remote, uint16_t portno,
+  const BaseRootQuery* query, const char *aetitle,
+  const char *call, const char* outputdir)
+{
+  if( !remote || !query ) return false;
+  if( !aetitle )
+    {
+    aetitle = "GDCMSCU";
+    }
+  if( !call )
+    {
+    call = "ANY-SCP";
+    }
+  if (!outputdir || !*outputdir)
+    {
+    outputdir = ".";
+    }
+
+  // Generate the PresentationContext array from the query UID:
+  PresentationContextGenerator generator;
+  if( !generator.GenerateFromUID( query->GetAbstractSyntaxUID() ) )
+    {
+    gdcmErrorMacro( "Failed to generate pres context." );
+    return false;
+    }
+  // The sub-operations come back on the same association, so the storage
+  // contexts have to be proposed upfront: all image storage SOP classes, in
+  // Implicit and Explicit VR Little Endian
+  std::vector<PresentationContext> pcs = generator.GetPresentationContexts();
+  uint8_t pcid = 1;
+  for( size_t i = 0; i < pcs.size(); ++i )
+    {
+    pcid = std::max( pcid, pcs[i].GetPresentationContextID() );
+    }
+  std::set<std::string> sopclasses;
+  for( int i = 0; i < MediaStorage::MS_END; ++i )
+    {
+    const MediaStorage::MSType mst = (MediaStorage::MSType)i;
+    const char *sopclass = MediaStorage::GetMSString( mst );
+    if( !MediaStorage::IsImage( mst ) || !sopclass || !sopclasses.insert( sopclass ).second )
+      continue;
+    if( pcid >= 253 )
+      {
+      gdcmWarningMacro( "Too many presentation contexts, skipping: " << sopclass );
+      break;
+      }
+    PresentationContext pc;
+    pc.SetAbstractSyntax( sopclass );
+    pc.AddTransferSyntax( UIDs::GetUIDString( UIDs::ImplicitVRLittleEndianDefaultTransferSyntaxforDICOM ) );
+    pc.AddTransferSyntax( UIDs::GetUIDString( UIDs::ExplicitVRLittleEndian ) );
+    pcid = (uint8_t)(pcid + 2);
+    pc.SetPresentationContextID( pcid );
+    pcs.push_back( pc );
+    }
+
+  SmartPointer<ServiceClassUser> scu = new ServiceClassUser;
+  scu->SetHostname( remote );
+  scu->SetPort( portno );
+  scu->SetAETitle( aetitle );
+  scu->SetCalledAETitle( call );
+  if( !scu->InitializeConnection() )
+    {
+    gdcmErrorMacro( "Failed to establish connection." );
+    return false;
+    }
+  scu->SetPresentationContexts( pcs );
+  if( !scu->StartAssociation() )
+    {
+    gdcmErrorMacro( "Failed to start association." );
+    return false;
+    }
+  const bool ret = scu->SendGet( query, outputdir );
+  if( !scu->StopAssociation() ) return false;
+  return ret;
+}
+
 //note that pointer to the base root query-- the caller must instantiated and delete
 bool CompositeNetworkFunctions::CFind( const char *remote, uint16_t portno,
   const BaseRootQuery* query, std::vector<DataSet> &retDataSets,
@@ -236,6 +345,20 @@ bool CompositeNetworkFunctions::CFind( const char *remote, uint16_t portno,
     return false;
     }
 
+  if( AssociationPool )
+    {
+    ServiceClassUser *scu = AssociationPool->Acquire( remote, portno,
+      generator.GetPresentationContexts(), aetitle, call );
+    if( !scu )
+      {
+      gdcmErrorMacro( "Failed to establish connection." );
+      return false;
+      }
+    const bool ret = scu->SendFind( query, retDataSets );
+    AssociationPool->Release( scu, ret );
+    return ret;
+    }
+
   network::ULConnectionManager theManager;
   if (!theManager.EstablishConnection(aetitle, call, remote, 0, portno, 1000,
       generator.GetPresentationContexts()))
@@ -339,6 +462,46 @@ public:
   void ShowDataSet(Subject *, const Event &) override {}
 };
 
+static bool CStoreWithPool( ServiceClassUserPool &pool, const char *remote,
+  uint16_t portno, const Directory::FilenamesType& files,
+  std::vector<PresentationContext> const & pcs,
+  const char *aetitle, const char *call)
+{
+  ServiceClassUser *scu = pool.Acquire( remote, portno, pcs, aetitle, call );
+  if( !scu )
+    {
+    gdcmErrorMacro( "Failed to establish connection." );
+    return false;
+    }
+
+  bool ret = true; // by default no error
+  bool reusable = true;
+  try
+    {
+    // observers are removed before the association goes back to the pool
+    MyWatcher watcher(scu, "cstore", files.size() );
+    for( size_t i = 0; i < files.size(); ++i )
+      {
+      const std::string & filename = files[i];
+      gdcmDebugMacro( "Processing: " << filename );
+      if( !scu->SendStore( filename.c_str() ) )
+        {
+        gdcmErrorMacro( "Could not C-STORE: " << filename );
+        ret = false; // at least one file was not sent correctly
+        }
+      scu->InvokeEvent( IterationEvent() );
+      }
+    }
+  catch ( std::exception &e )
+    {
+    (void)e;  //to avoid unreferenced variable warning on release
+    gdcmErrorMacro( "C-Store was unsuccessful, aborting. Error was " << e.what() );
+    ret = reusable = false;
+    }
+  pool.Release( scu, reusable );
+  return ret;
+}
+
 bool CompositeNetworkFunctions::CStore( const char *remote, uint16_t portno,
   const Directory::FilenamesType& filenames,
   const char *aetitle, const char *call)
@@ -354,13 +517,6 @@ bool CompositeNetworkFunctions::CStore( const char *remote, uint16_t portno,
     call = "ANY-SCP";
     }
 
-  SmartPointer<network::ULConnectionManager> ps = new network::ULConnectionManager;
-  network::ULConnectionManager &theManager = *ps;
-  Directory::FilenamesType const &files = filenames;
-
-  //SimpleSubjectWatcher watcher(ps, "cstore");
-  MyWatcher watcher(ps, "cstore", files.size() );
-
   // Generate the PresentationContext array from the File-Set:
   PresentationContextGenerator generator;
   if( !generator.GenerateFromFilenames(filenames) )
@@ -369,6 +525,19 @@ bool CompositeNetworkFunctions::CStore( const char *remote, uint16_t portno,
     return false;
     }
 
+  if( AssociationPool )
+    {
+    return CStoreWithPool( *AssociationPool, remote, portno, filenames,
+      generator.GetPresentationContexts(), aetitle, call );
+    }
+
+  SmartPointer<network::ULConnectionManager> ps = new network::ULConnectionManager;
+  network::ULConnectionManager &theManager = *ps;
+  Directory::FilenamesType const &files = filenames;
+
+  //SimpleSubjectWatcher watcher(ps, "cstore");
+  MyWatcher watcher(ps, "cstore", files.size() );
+
   if (!theManager.EstablishConnection(aetitle, call, remote, 0,
       portno, 1000, generator.GetPresentationContexts() ))
     {
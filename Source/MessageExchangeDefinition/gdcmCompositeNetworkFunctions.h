@@ -26,6 +26,7 @@
 
 namespace gdcm
 {
+class ServiceClassUserPool;
 /**
  * \brief Composite Network Functions
  * \details These functions provide a generic API to the DICOM functions implemented in
@@ -92,6 +93,19 @@ public:
     uint16_t portscp, const char *aetitle = nullptr,
     const char *call = nullptr, const char *outputdir = nullptr);
 
+  /// This function will use the provided query to get files from a remote
+  /// server using C-GET: contrary to CMove, the files are sent back over the
+  /// same association (no inbound connection is needed). Presentation contexts
+  /// for all image storage SOP classes are proposed (Implicit and Explicit VR
+  /// Little Endian). Files will be written to the given output directory.
+  /// \param aetitle when not set will default to 'GDCMSCU'
+  /// \param call when not set will default to 'ANY-SCP'
+  /// when \param outputdir is not set default to current dir ('.')
+  /// \return true if it worked.
+  static bool CGet( const char *remote, uint16_t portno, const BaseRootQuery* query,
+    const char *aetitle = nullptr, const char *call = nullptr,
+    const char *outputdir = nullptr);
+
   /// This function will use the provided query to determine what files a remote
   /// server contains that match the query strings.  The return is a vector of
   /// datasets that contain tags as reported by the server.  If the dataset is
@@ -117,6 +131,13 @@ public:
   static bool CStore( const char *remote, uint16_t portno,
     const Directory::FilenamesType & filenames,
     const char *aetitle = nullptr, const char *call = nullptr);
+
+  /// When a pool is set, CEcho, CFind and CStore reuse the associations kept
+  /// in it instead of negotiating a new association on each call. Set to NULL
+  /// (default) to go back to one association per call. The pool is not
+  /// owned, and should be set before any concurrent call is made.
+  static void SetAssociationPool( ServiceClassUserPool *pool );
+  static ServiceClassUserPool *GetAssociationPool();
 };
 
 } // end namespace gdcm
@@ -0,0 +1,33 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmGetPatientRootQuery.h"
+
+namespace gdcm
+{
+
+GetPatientRootQuery::GetPatientRootQuery()
+{
+  mHelpDescription = "Patient-level root query (C-GET)";
+}
+
+UIDs::TSName GetPatientRootQuery::GetAbstractSyntaxUID() const
+{
+  return UIDs::PatientRootQueryRetrieveInformationModelGET;
+}
+
+} // end namespace gdcm
@@ -0,0 +1,33 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmGetStudyRootQuery.h"
+
+namespace gdcm
+{
+
+GetStudyRootQuery::GetStudyRootQuery()
+{
+  mHelpDescription = "Study-level root query (C-GET)";
+}
+
+UIDs::TSName GetStudyRootQuery::GetAbstractSyntaxUID() const
+{
+  return UIDs::StudyRootQueryRetrieveInformationModelGET;
+}
+
+} // end namespace gdcm
@@ -0,0 +1,42 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef GDCMGETSTUDYROOTQUERY_H
+#define GDCMGETSTUDYROOTQUERY_H
+
+#include "gdcmMoveStudyRootQuery.h"
+
+namespace gdcm
+{
+/**
+ * \brief GetStudyRootQuery
+ * \details contains: the class which will produce a dataset for C-GET with study root
+ * The identifier follows the very same rules as for C-MOVE, only the
+ * Information Model differs.
+ */
+class GDCM_EXPORT GetStudyRootQuery : public MoveStudyRootQuery
+{
+  friend class QueryFactory;
+public:
+  GetStudyRootQuery();
+
+  UIDs::TSName GetAbstractSyntaxUID() const override;
+};
+
+} // end namespace gdcm
+
+#endif // GDCMGETSTUDYROOTQUERY_H
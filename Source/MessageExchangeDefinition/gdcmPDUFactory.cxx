@@ -178,6 +178,22 @@ std::vector<BasePDU*> PDUFactory::CreateCMovePDU(const ULConnection&
   return outVector;
 }
 
+std::vector<BasePDU*> PDUFactory::CreateCGetPDU(const ULConnection&
+  inConnection, const BaseRootQuery* inRootQuery)
+{
+  std::vector<PresentationDataValue> pdv =
+    CompositeMessageFactory::ConstructCGetRQ(inConnection, inRootQuery );
+  std::vector<PresentationDataValue>::iterator pdvItor;
+  std::vector<BasePDU*> outVector;
+  for (pdvItor = pdv.begin(); pdvItor < pdv.end(); pdvItor++)
+    {
+    PDataTFPDU* thePDataTFPDU = new PDataTFPDU();
+    thePDataTFPDU->AddPresentationDataValue( *pdvItor );
+    outVector.push_back(thePDataTFPDU);
+    }
+  return outVector;
+}
+
 std::vector<BasePDU*> PDUFactory::CreateCStoreRQPDU(const ULConnection& inConnection,
   const File& file, bool writeDataSet /*= true*/ )
 {
@@ -195,10 +211,26 @@ std::vector<BasePDU*> PDUFactory::CreateCStoreRQPDU(const ULConnection& inConnec
 }
 
 std::vector<BasePDU*> PDUFactory::CreateCStoreRSPPDU(const DataSet* inDataSet,
+  const BasePDU* inPDU, uint16_t inStatus /*= 0*/)
+{
+  std::vector<PresentationDataValue> pdv =
+    CompositeMessageFactory::ConstructCStoreRSP(inDataSet, inPDU, inStatus );
+  std::vector<PresentationDataValue>::iterator pdvItor;
+  std::vector<BasePDU*> outVector;
+  for (pdvItor = pdv.begin(); pdvItor < pdv.end(); pdvItor++)
+    {
+    PDataTFPDU* thePDataTFPDU = new PDataTFPDU;
+    thePDataTFPDU->AddPresentationDataValue( *pdvItor );
+    outVector.push_back(thePDataTFPDU);
+    }
+  return outVector;
+}
+
+std::vector<BasePDU*> PDUFactory::CreateCFindCancelPDU(const DataSet* inDataSet,
   const BasePDU* inPDU)
 {
   std::vector<PresentationDataValue> pdv =
-    CompositeMessageFactory::ConstructCStoreRSP(inDataSet, inPDU );
+    CompositeMessageFactory::ConstructCFindCancelRQ(inDataSet, inPDU );
   std::vector<PresentationDataValue>::iterator pdvItor;
   std::vector<BasePDU*> outVector;
   for (pdvItor = pdv.begin(); pdvItor < pdv.end(); pdvItor++)
@@ -49,9 +49,11 @@ namespace gdcm{
       //be then placed into the vector of PDUs
       static std::vector<BasePDU*> CreateCEchoPDU(const ULConnection& inConnection);
       static std::vector<BasePDU*> CreateCStoreRQPDU(const ULConnection& inConnection, const File &file, bool writeDataSet = true );
-      static std::vector<BasePDU*> CreateCStoreRSPPDU(const DataSet *inDataSet, const BasePDU* inPC);
+      static std::vector<BasePDU*> CreateCStoreRSPPDU(const DataSet *inDataSet, const BasePDU* inPC, uint16_t inStatus = 0);
       static std::vector<BasePDU*> CreateCFindPDU(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
+      static std::vector<BasePDU*> CreateCFindCancelPDU(const DataSet *inDataSet, const BasePDU* inPC);
       static std::vector<BasePDU*> CreateCMovePDU(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
+      static std::vector<BasePDU*> CreateCGetPDU(const ULConnection& inConnection, const BaseRootQuery* inRootQuery);
 
 	  static std::vector<BasePDU*> CreateNEventReportPDU	(const ULConnection& inConnection, const BaseQuery *inQuery);
 	  static std::vector<BasePDU*> CreateNGetPDU			(const ULConnection& inConnection, const BaseQuery *inQuery);
@@ -20,6 +20,8 @@
 #include "gdcmMovePatientRootQuery.h"
 #include "gdcmFindStudyRootQuery.h"
 #include "gdcmMoveStudyRootQuery.h"
+#include "gdcmGetPatientRootQuery.h"
+#include "gdcmGetStudyRootQuery.h"
 #include "gdcmWLMFindQuery.h"
 
 
@@ -79,6 +81,18 @@ BaseRootQuery* QueryFactory::ProduceQuery(ERootType inRootType, EQueryType inQue
   case eWLMFind:
 	theReturn = new WLMFindQuery();
 	  break;
+  case eGet:
+    switch (inRootType)
+      {
+    case ePatientRootType:
+      theReturn = new GetPatientRootQuery();
+      break;
+    case eStudyRootType:
+      if (inQueryLevel != ePatient)
+        theReturn = new GetStudyRootQuery();
+      break;
+      }
+    break;
     }
 
 
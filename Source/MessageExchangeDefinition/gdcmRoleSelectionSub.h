@@ -39,6 +39,9 @@ public:
   void Print(std::ostream &os) const;
 
   void SetTuple(const char *uid, uint8_t scurole, uint8_t scprole);
+  const char *GetName() const { return Name.c_str(); }
+  uint8_t GetSCURole() const { return SCURole; }
+  uint8_t GetSCPRole() const { return SCPRole; }
 
 private:
   static const uint8_t ItemType;
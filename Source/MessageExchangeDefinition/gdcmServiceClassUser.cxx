@@ -23,10 +23,17 @@
 #include "gdcmPDUFactory.h"
 #include "gdcmAttribute.h"
 #include "gdcmULWritingCallback.h"
+#include "gdcmCStoreMessages.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmFileMetaInformation.h"
+#include "gdcmSystem.h"
+#include "gdcmUIDGenerator.h"
 
 #include "gdcmPrinter.h" // FIXME
 #include "gdcmReader.h" // FIXME
 
+#include <fstream>
+
 namespace gdcm
 {
 static const char GDCM_AETITLE[] = "GDCMSCU";
@@ -45,6 +52,7 @@ public:
   std::string aetitle;
   std::string calledaetitle;
   double timeout;
+  uint32_t maxpdulength;
 
   ServiceClassUserInternals()= default;
   ~ServiceClassUserInternals(){
@@ -62,6 +70,7 @@ ServiceClassUser::ServiceClassUser()
   Internals->aetitle = GDCM_AETITLE;
   Internals->calledaetitle = "ANY-SCP";
   Internals->timeout = 10;
+  Internals->maxpdulength = 0x4000;
 }
 
 ServiceClassUser::~ServiceClassUser()
@@ -122,6 +131,8 @@ bool ServiceClassUser::InitializeConnection()
     return false;
     }
 
+  connectInfo.SetMaxPDULength( Internals->maxpdulength );
+
   ULConnection* mConnection = Internals->mConnection;
   delete mConnection;
 
@@ -178,6 +189,16 @@ double ServiceClassUser::GetTimeout() const
   return Internals->timeout;
 }
 
+void ServiceClassUser::SetMaxPDULength(uint32_t length)
+{
+  Internals->maxpdulength = length;
+}
+
+uint32_t ServiceClassUser::GetMaxPDULength() const
+{
+  return Internals->maxpdulength;
+}
+
 void ServiceClassUser::SetCalledAETitle(const char *aetitle)
 {
   if( aetitle )
@@ -256,21 +277,29 @@ bool ServiceClassUser::SendStore(File const &file)
   ULConnection* mConnection = Internals->mConnection;
 
   std::vector<BasePDU*> theDataPDU;
+  // the data set is serialized only once, and then sent chunk by chunk
+  // straight from this buffer (see ULActionDT1)
+  std::stringstream ss;
   try
     {
-    theDataPDU = PDUFactory::CreateCStoreRQPDU(*mConnection, file);
+    theDataPDU = PDUFactory::CreateCStoreRQPDU(*mConnection, file, false);
+    if( !CStoreRQ::WriteDataSet( file, ss ) )
+      {
+      throw Exception( "Could not write data set" );
+      }
     }
   catch ( std::exception &ex )
     {
     (void)ex;  //to avoid unreferenced variable warning on release
     gdcmErrorMacro( "Could not C-STORE: " << ex.what() );
+    for( size_t i = 0; i < theDataPDU.size(); ++i ) delete theDataPDU[i];
     return false;
     }
 
   network::ULBasicCallback theCallback;
   network::ULConnectionCallback* inCallback = &theCallback;
 
-  ULEvent theEvent(ePDATArequest, theDataPDU);
+  ULEvent theEvent(ePDATArequest, theDataPDU, &ss);
   EStateID stateid = RunEventLoop(theEvent, mConnection, inCallback, false);
   assert( stateid == eSta6TransferReady ); (void)stateid;
   std::vector<DataSet> const &theDataSets = theCallback.GetResponses();
@@ -312,24 +341,63 @@ bool ServiceClassUser::SendStore(File const &file)
   return ret;
 }
 
+namespace
+{
+// Forward everything to the user callback, only keep track of the last
+// response (the one holding the final status)
+class FindCallback : public network::ULConnectionCallback
+{
+  network::ULConnectionCallback *mUserCallback;
+  DataSet mLastResponse;
+public:
+  FindCallback(network::ULConnectionCallback *inCallback):mUserCallback(inCallback){}
+  void HandleDataSet(const DataSet& inDataSet) override
+    {
+    mUserCallback->HandleDataSet(inDataSet);
+    if( mUserCallback->IsCancelRequested() ) RequestCancel();
+    }
+  void HandleResponse(const DataSet& inDataSet) override
+    {
+    mLastResponse = inDataSet;
+    mUserCallback->HandleResponse(inDataSet);
+    }
+  const DataSet &GetLastResponse() const { return mLastResponse; }
+};
+}
+
 bool ServiceClassUser::SendFind(const BaseRootQuery* query, std::vector<DataSet> &retDataSets)
 {
-  ULConnection* mConnection = Internals->mConnection;
   network::ULBasicCallback theCallback;
+  if( !SendFind( query, &theCallback ) )
+    {
+    return false;
+    }
+  std::vector<DataSet> const & theDataSets = theCallback.GetDataSets();
+  // Append the new DataSet to the ret one:
+  retDataSets.insert( retDataSets.end(), theDataSets.begin(), theDataSets.end() );
+  return true;
+}
+
+bool ServiceClassUser::SendFind(const BaseRootQuery* query, network::ULConnectionCallback* callback)
+{
+  ULConnection* mConnection = Internals->mConnection;
+  if( !callback ) return false;
+  callback->ResetCancel();
+  FindCallback theCallback( callback );
   network::ULConnectionCallback* inCallback = &theCallback;
 
   std::vector<BasePDU*> theDataPDU = PDUFactory::CreateCFindPDU( *mConnection, query);
   ULEvent theEvent(ePDATArequest, theDataPDU);
   RunEventLoop(theEvent, mConnection, inCallback, false);
 
-  std::vector<DataSet> const & theDataSets = theCallback.GetDataSets();
-  std::vector<DataSet> const & theResponses = theCallback.GetResponses();
-
   bool ret = false; // by default an error
-  assert( !theResponses.empty() );
   // take the last one:
-  const DataSet &ds = theResponses[ theResponses.size() - 1 ]; // FIXME
-  assert ( ds.FindDataElement(Tag(0x0, 0x0900)) );
+  const DataSet &ds = theCallback.GetLastResponse();
+  if( !ds.FindDataElement(Tag(0x0, 0x0900)) )
+    {
+    gdcmErrorMacro( "No C-FIND response" );
+    return false;
+    }
   Attribute<0x0,0x0900> at;
   at.SetFromDataSet( ds );
 
@@ -340,8 +408,6 @@ bool ServiceClassUser::SendFind(const BaseRootQuery* query, std::vector<DataSet>
     {
   case 0x0: // Matching is complete - No final Identifier is supplied.
     gdcmDebugMacro( "C-Find was successful." );
-    // Append the new DataSet to the ret one:
-    retDataSets.insert( retDataSets.end(), theDataSets.begin(), theDataSets.end() );
     ret = true;
     break;
   case 0xA900: // Identifier Does Not Match SOP Class
@@ -372,7 +438,15 @@ bool ServiceClassUser::SendFind(const BaseRootQuery* query, std::vector<DataSet>
     gdcmErrorMacro( "SOP Class not Supported" );
     break;
   case 0xfe00: // Matching terminated due to Cancel request
-    gdcmErrorMacro( "Matching terminated due to Cancel request" );
+    if( callback->IsCancelRequested() )
+      {
+      gdcmDebugMacro( "C-Find was canceled." );
+      ret = true;
+      }
+    else
+      {
+      gdcmErrorMacro( "Matching terminated due to Cancel request" );
+      }
     break;
   default:
       {
@@ -400,6 +474,8 @@ bool ServiceClassUser::SendMove(const BaseRootQuery* query, const char *outputdi
     return false;
     }
 
+  connectInfo2.SetMaxPDULength( Internals->maxpdulength );
+
   // let's start the secondary connection
   ULConnection* mSecondaryConnection = Internals->mSecondaryConnection;
   delete mSecondaryConnection;
@@ -433,6 +509,8 @@ bool ServiceClassUser::SendMove(const BaseRootQuery* query, std::vector<DataSet>
     return false;
     }
 
+  connectInfo2.SetMaxPDULength( Internals->maxpdulength );
+
   // let's start the secondary connection
   ULConnection* mSecondaryConnection = Internals->mSecondaryConnection;
   delete mSecondaryConnection;
@@ -466,6 +544,251 @@ bool ServiceClassUser::SendMove(const BaseRootQuery* query, std::vector<File> &r
   return false;
 }
 
+namespace
+{
+// UI values in a command are padded with \0, trim it (and any space)
+std::string GetCommandUID(const DataSet &command, const Tag &t)
+{
+  std::string ret;
+  if( command.FindDataElement( t ) )
+    {
+    const ByteValue *bv = command.GetDataElement( t ).GetByteValue();
+    if( bv ) ret.assign( bv->GetPointer(), bv->GetLength() );
+    }
+  while( !ret.empty() && ( ret[ret.size()-1] == '\0' || ret[ret.size()-1] == ' ' ) )
+    ret.erase( ret.size() - 1 );
+  return ret;
+}
+
+// Start the file for a C-STORE sub-operation: preamble + File Meta
+// Information. The data set PDVs can then be appended as they are received.
+bool OpenSubOperationFile(std::ofstream &out, const char *outputdir,
+  const DataSet &command, const TransferSyntax &ts)
+{
+  const std::string sopclass = GetCommandUID( command, Tag(0x0,0x0002) );
+  const std::string sopinstance = GetCommandUID( command, Tag(0x0,0x1000) );
+  if( sopclass.empty() || sopinstance.empty() || !ts.IsValid() )
+    {
+    gdcmErrorMacro( "Invalid C-STORE-RQ" );
+    return false;
+    }
+  // the file name comes from the peer: no path separator, no '..'
+  if( !UIDGenerator::IsValid( sopinstance.c_str() ) )
+    {
+    gdcmErrorMacro( "Invalid Affected SOP Instance UID: " << sopinstance );
+    return false;
+    }
+  std::string filename = outputdir;
+  filename += '/';
+  filename += sopinstance;
+  filename += ".dcm";
+  out.open( filename.c_str(), std::ios::out | std::ios::binary );
+  if( !out.is_open() )
+    {
+    gdcmErrorMacro( "Could not open: " << filename );
+    return false;
+    }
+  DataSet ids;
+  const Tag tags[] = { Tag(0x8,0x16), Tag(0x8,0x18) };
+  const std::string *values[] = { &sopclass, &sopinstance };
+  for( int i = 0; i < 2; ++i )
+    {
+    std::string value = *values[i];
+    if( value.size() % 2 ) value.push_back( '\0' );
+    DataElement de( tags[i] );
+    de.SetVR( VR::UI );
+    de.SetByteValue( value.c_str(), (uint32_t)value.size() );
+    ids.Insert( de );
+    }
+  FileMetaInformation fmi;
+  fmi.GetPreamble().Create();
+  fmi.SetDataSetTransferSyntax( ts );
+  try
+    {
+    fmi.FillFromDataSet( ids );
+    }
+  catch( std::exception &ex )
+    {
+    (void)ex;
+    gdcmErrorMacro( "Could not create File Meta Information: " << ex.what() );
+    return false;
+    }
+  fmi.Write( out );
+  return out.good();
+}
+}
+
+bool ServiceClassUser::SendGet(const BaseRootQuery* query, const char *outputdir)
+{
+  ULConnection* mConnection = Internals->mConnection;
+  if( !mConnection || !query || !outputdir || !System::FileIsDirectory( outputdir ) )
+    {
+    gdcmErrorMacro( "Invalid C-GET request" );
+    return false;
+    }
+
+  std::vector<BasePDU*> theDataPDU = PDUFactory::CreateCGetPDU( *mConnection, query );
+  ULEvent theEvent(ePDATArequest, theDataPDU);
+  bool waitingForEvent = false;
+  EEventID raisedEvent = eEventDoesNotExist;
+  Internals->mTransitions.HandleEvent(this, theEvent, *mConnection, waitingForEvent, raisedEvent);
+  if( mConnection->GetState() != eSta6TransferReady )
+    {
+    return false;
+    }
+
+  // The C-STORE sub-operations come back on the same association, interleaved
+  // with the pending C-GET-RSP. Data set PDVs are written straight to disk,
+  // so that an instance is never held in memory.
+  std::iostream &ios = *mConnection->GetProtocol();
+  std::vector<PresentationDataValue> commandPDVs;
+  DataSet theCommand;
+  std::ofstream out;
+  bool storing = false;       // receiving the data set of a C-STORE-RQ
+  bool storeFailed = false;
+  bool finalResponse = false; // final C-GET-RSP received, waiting for its identifier
+  uint16_t theStatus = 0xFFFF;
+  bool done = false;
+  while( !done )
+    {
+    uint8_t itemtype = 0x0;
+    ios.read( (char*)&itemtype, 1 );
+    if( !ios )
+      {
+      gdcmErrorMacro( "Connection lost during C-GET" );
+      return false;
+      }
+    BasePDU *thePDU = PDUFactory::ConstructPDU( itemtype );
+    if( !thePDU )
+      {
+      gdcmErrorMacro( "Unknown PDU: " << (int)itemtype );
+      return false;
+      }
+    thePDU->Read( ios );
+    if( itemtype != 0x4 )
+      {
+      // A-ABORT or A-RELEASE-RQ: let the state machine handle it
+      std::vector<BasePDU*> thePDUs( 1, thePDU );
+      ULEvent theAbortEvent( PDUFactory::DetermineEventByPDU( thePDU ), thePDUs );
+      Internals->mTransitions.HandleEvent(this, theAbortEvent, *mConnection, waitingForEvent, raisedEvent);
+      delete thePDU;
+      gdcmErrorMacro( "C-GET interrupted by peer" );
+      return false;
+      }
+    std::vector<BasePDU*> thePDUs( 1, thePDU );
+    std::vector<PresentationDataValue> const thePDVs = PDUFactory::GetPDVs( thePDUs );
+    delete thePDU;
+    for( std::vector<PresentationDataValue>::const_iterator pdv = thePDVs.begin();
+      pdv != thePDVs.end() && !done; ++pdv )
+      {
+      if( pdv->GetIsCommand() )
+        {
+        commandPDVs.push_back( *pdv );
+        if( !pdv->GetIsLastFragment() ) continue;
+        theCommand = PresentationDataValue::ConcatenatePDVBlobs( commandPDVs );
+        commandPDVs.clear();
+        if( Trace::GetDebugFlag() )
+          {
+          Printer thePrinter;
+          thePrinter.PrintDataSet( theCommand, Trace::GetStream() );
+          }
+        Attribute<0x0,0x0100> commandfield = { 0 };
+        commandfield.SetFromDataSet( theCommand );
+        Attribute<0x0,0x0800> datasettype = { 0x0101 };
+        datasettype.SetFromDataSet( theCommand );
+        if( commandfield.GetValue() == 0x0001 ) // C-STORE-RQ
+          {
+          const PresentationContextAC *pc =
+            mConnection->GetPresentationContextACByID( pdv->GetPresentationContextID() );
+          TransferSyntax ts;
+          if( pc )
+            {
+            ts = TransferSyntax::GetTSType( pc->GetTransferSyntax().GetName() );
+            }
+          storing = true;
+          storeFailed = !OpenSubOperationFile( out, outputdir, theCommand, ts );
+          }
+        else if( commandfield.GetValue() == 0x8010 ) // C-GET-RSP
+          {
+          Attribute<0x0,0x0900> status = { 0xFFFF };
+          status.SetFromDataSet( theCommand );
+          theStatus = status.GetValue();
+          if( theStatus != 0xFF00 && theStatus != 0xFF01 )
+            {
+            finalResponse = true;
+            // an identifier (Failed SOP Instance UID List) may follow
+            done = datasettype.GetValue() == 0x0101;
+            }
+          }
+        else
+          {
+          gdcmWarningMacro( "Unexpected command: " << commandfield.GetValue() );
+          }
+        }
+      else
+        {
+        if( storing && !storeFailed )
+          {
+          const std::string &blob = pdv->GetBlob();
+          out.write( blob.c_str(), blob.size() );
+          storeFailed = !out.good();
+          }
+        // else: identifier of a C-GET-RSP, ignored
+        if( !pdv->GetIsLastFragment() ) continue;
+        if( storing )
+          {
+          if( out.is_open() ) out.close();
+          storeFailed = storeFailed || out.fail();
+          out.clear();
+          storing = false;
+          // C-STORE-RSP on the presentation context of the request
+          PDataTFPDU theRQPDU;
+          PresentationDataValue theRQPDV;
+          theRQPDV.SetPresentationContextID( pdv->GetPresentationContextID() );
+          theRQPDU.AddPresentationDataValue( theRQPDV );
+          std::vector<BasePDU*> theRSP = PDUFactory::CreateCStoreRSPPDU( &theCommand, &theRQPDU,
+            storeFailed ? (uint16_t)0xA700 : (uint16_t)0x0000 );
+          for( size_t i = 0; i < theRSP.size(); ++i )
+            {
+            theRSP[i]->Write( ios );
+            delete theRSP[i];
+            }
+          ios.flush();
+          }
+        else if( finalResponse )
+          {
+          done = true;
+          }
+        }
+      }
+    }
+
+  switch( theStatus )
+    {
+  case 0x0000:
+    gdcmDebugMacro( "C-GET was successful." );
+    return true;
+  case 0xB000:
+    gdcmWarningMacro( "Sub-operations complete - One or more failures or warnings" );
+    break;
+  case 0xFE00:
+    gdcmErrorMacro( "Sub-operations terminated due to Cancel indication" );
+    break;
+  case 0xA701:
+    gdcmErrorMacro( "Refused: Out of Resources Unable to calculate number of matches" );
+    break;
+  case 0xA702:
+    gdcmErrorMacro( "Refused: Out of Resources Unable to perform sub-operations" );
+    break;
+  case 0xA900:
+    gdcmErrorMacro( "Identifier does not match SOP Class" );
+    break;
+  default:
+    gdcmErrorMacro( "C-GET failed with code " << theStatus );
+    }
+  return false;
+}
+
 //event handler loop.
 //will just keep running until the current event is nonexistent.
 //at which point, it will return the current state of the connection
@@ -484,6 +807,7 @@ EStateID ServiceClassUser::RunEventLoop(network::ULEvent& currentEvent,
   EEventID raisedEvent;
 
   bool receivingData = false;
+  bool cancelSent = false; // C-CANCEL-RQ already sent for the running C-FIND
   //bool justWaiting = startWaiting;
   //not sure justwaiting is useful; for now, go back to waiting for event
 
@@ -594,7 +918,11 @@ EStateID ServiceClassUser::RunEventLoop(network::ULEvent& currentEvent,
                 theCommandCode = at2.GetValues()[0];
                 }
 
-              if (theVal != pendingDE1 && theVal != pendingDE2 && theVal != success)
+              if (cancelSent && theVal == 0xFE00)
+                {
+                gdcmDebugMacro( "Matching terminated due to Cancel request" );
+                }
+              else if (theVal != pendingDE1 && theVal != pendingDE2 && theVal != success)
                 {
                 //check for other error fields
                 const ByteValue *err1 = nullptr, *err2 = nullptr;
@@ -698,10 +1026,24 @@ EStateID ServiceClassUser::RunEventLoop(network::ULEvent& currentEvent,
                     delete theData[i];
                     }
                   //outDataSet.push_back(theCompleteFindResponse);
-                  if (inCallback)
+                  if (inCallback && !cancelSent)
                     {
                     inCallback->HandleDataSet(theCompleteFindResponse);
                     }
+                  if (inCallback && inCallback->IsCancelRequested() && !cancelSent
+                    && theCommandCode == 0x8020)
+                    {
+                    //the user does not want any more results, tell the peer. The
+                    //final response (Cancel status) will end this loop.
+                    std::vector<BasePDU*> theCancelPDU = PDUFactory::CreateCFindCancelPDU(&theRSP, theFirstPDU);
+                    std::vector<BasePDU*>::iterator itor;
+                    for (itor = theCancelPDU.begin(); itor < theCancelPDU.end(); itor++){
+                      (*itor)->Write(*inWhichConnection->GetProtocol());
+                      delete *itor;
+                    }
+                    inWhichConnection->GetProtocol()->flush();
+                    cancelSent = true;
+                    }
                   //  DataSetEvent dse( &theCompleteFindResponse );
                   //  this->InvokeEvent( dse );
 
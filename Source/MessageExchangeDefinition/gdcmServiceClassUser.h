@@ -65,6 +65,13 @@ public:
   void SetTimeout(double t);
   double GetTimeout() const;
 
+  /// set/get the maximum length of the PDUs we accept to receive (0 means
+  /// no limit). This is negotiated during association, the peer limit is
+  /// honored when sending. Need to be called before InitializeConnection.
+  /// Default is 16384 (PS 3.8 default).
+  void SetMaxPDULength(uint32_t length);
+  uint32_t GetMaxPDULength() const;
+
   /// Will try to connect
   /// This will setup the actual timeout used during the whole connection time. Need to call
   /// SetTimeout first
@@ -95,6 +102,11 @@ public:
 
   /// C-FIND a query, return result are in retDatasets
   bool SendFind(const BaseRootQuery* query, std::vector<DataSet> &retDatasets);
+  /// C-FIND a query, each matching identifier is passed to
+  /// callback->HandleDataSet as soon as it is received (nothing is
+  /// accumulated in memory). Call callback->RequestCancel() to send a
+  /// C-CANCEL-RQ, a canceled query is not an error.
+  bool SendFind(const BaseRootQuery* query, network::ULConnectionCallback* callback);
 
   /// Execute a C-MOVE, based on query, return files are written in outputdir
   bool SendMove(const BaseRootQuery* query, const char *outputdir);
@@ -103,6 +115,12 @@ public:
   /// Execute a C-MOVE, based on query, returned Files are stored in vector
   bool SendMove(const BaseRootQuery* query, std::vector<File> &retFile);
 
+  /// Execute a C-GET, based on query. The C-STORE sub-operations are received
+  /// over the same association and written straight to disk in outputdir
+  /// (data set PDVs are appended as they arrive). The storage presentation
+  /// contexts must have been proposed, see PresentationContextGenerator.
+  bool SendGet(const BaseRootQuery* query, const char *outputdir);
+
   /// for wrapped language: instantiate a reference counted object
   static SmartPointer<ServiceClassUser> New() { return new ServiceClassUser; }
 
@@ -0,0 +1,368 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmServiceClassUserPool.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace gdcm
+{
+static const char GDCM_POOL_AETITLE[] = "GDCMSCU";
+static const char GDCM_POOL_CALLEDAETITLE[] = "ANY-SCP";
+
+// The pool owns its associations: they are handed out as raw pointers, and
+// are only ever created, moved between Idle and InUse, or deleted by the pool
+// (the reference count of an Object is not thread safe, so no SmartPointer
+// copy can be shared between threads)
+class ServiceClassUserPoolInternals
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+  struct IdleAssociation
+    {
+    std::string Key;
+    ServiceClassUser *SCU;
+    ClockType::time_point LastUsed;
+    };
+
+  mutable std::mutex Lock;
+  std::vector<IdleAssociation> Idle; // most recently used last
+  std::map<ServiceClassUser*, std::string> InUse;
+
+  double IdleTimeout{60};
+  double HealthCheckInterval{5};
+  unsigned int MaximumNumberOfIdleAssociations{8};
+  double Timeout{10};
+  uint32_t MaxPDULength{0x4000};
+
+  static double Elapsed(ClockType::time_point const & since)
+    {
+    return std::chrono::duration<double>( ClockType::now() - since ).count();
+    }
+
+  // To be called with Lock held. Expired associations are moved to the
+  // output vector, so that they can be released without holding the Lock
+  void CollectExpired(std::vector<ServiceClassUser*> & expired, bool all)
+    {
+    std::vector<IdleAssociation>::iterator it = Idle.begin();
+    while( it != Idle.end() )
+      {
+      if( all || Elapsed( it->LastUsed ) >= IdleTimeout )
+        {
+        expired.push_back( it->SCU );
+        it = Idle.erase( it );
+        }
+      else
+        {
+        ++it;
+        }
+      }
+    }
+
+  // Release and destroy associations no longer referenced by the pool
+  static void StopAll(std::vector<ServiceClassUser*> const & scus)
+    {
+    for( size_t i = 0; i < scus.size(); ++i )
+      {
+      try
+        {
+        scus[i]->StopAssociation();
+        }
+      catch( std::exception & ex )
+        {
+        (void)ex;
+        gdcmDebugMacro( "Could not release association: " << ex.what() );
+        }
+      delete scus[i];
+      }
+    }
+};
+
+namespace
+{
+// Make sure a C-ECHO can be sent on the association
+std::vector<PresentationContext> AddVerificationContext(
+  std::vector<PresentationContext> const & pcs)
+{
+  const PresentationContext verification( UIDs::VerificationSOPClass );
+  uint8_t maxid = 0;
+  for( std::vector<PresentationContext>::const_iterator it = pcs.begin();
+    it != pcs.end(); ++it )
+    {
+    if( it->GetNumberOfTransferSyntaxes() == 1 && *it == verification )
+      {
+      return pcs;
+      }
+    if( it->GetPresentationContextID() > maxid ) maxid = it->GetPresentationContextID();
+    }
+  std::vector<PresentationContext> ret = pcs;
+  if( maxid < 255 )
+    {
+    PresentationContext pc = verification;
+    pc.SetPresentationContextID( (uint8_t)(maxid + 2) );
+    ret.push_back( pc );
+    }
+  return ret;
+}
+
+std::string MakeKey(const char *hostname, uint16_t port,
+  const char *aetitle, const char *call,
+  std::vector<PresentationContext> const & pcs)
+{
+  std::ostringstream os;
+  os << hostname << ':' << port << '\\' << aetitle << '\\' << call;
+  for( std::vector<PresentationContext>::const_iterator it = pcs.begin();
+    it != pcs.end(); ++it )
+    {
+    os << '\\' << (int)it->GetPresentationContextID() << '=' << it->GetAbstractSyntax();
+    for( PresentationContext::SizeType i = 0; i < it->GetNumberOfTransferSyntaxes(); ++i )
+      {
+      os << '/' << it->GetTransferSyntax( i );
+      }
+    }
+  return os.str();
+}
+}
+
+ServiceClassUserPool::ServiceClassUserPool()
+{
+  Internals = new ServiceClassUserPoolInternals;
+}
+
+ServiceClassUserPool::~ServiceClassUserPool()
+{
+  Clear();
+  delete Internals;
+}
+
+void ServiceClassUserPool::SetIdleTimeout(double t)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->IdleTimeout = t;
+}
+
+double ServiceClassUserPool::GetIdleTimeout() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->IdleTimeout;
+}
+
+void ServiceClassUserPool::SetHealthCheckInterval(double t)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->HealthCheckInterval = t;
+}
+
+double ServiceClassUserPool::GetHealthCheckInterval() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->HealthCheckInterval;
+}
+
+void ServiceClassUserPool::SetMaximumNumberOfIdleAssociations(unsigned int n)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->MaximumNumberOfIdleAssociations = n;
+}
+
+unsigned int ServiceClassUserPool::GetMaximumNumberOfIdleAssociations() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->MaximumNumberOfIdleAssociations;
+}
+
+void ServiceClassUserPool::SetTimeout(double t)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->Timeout = t;
+}
+
+double ServiceClassUserPool::GetTimeout() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->Timeout;
+}
+
+void ServiceClassUserPool::SetMaxPDULength(uint32_t length)
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->MaxPDULength = length;
+}
+
+uint32_t ServiceClassUserPool::GetMaxPDULength() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->MaxPDULength;
+}
+
+ServiceClassUser *ServiceClassUserPool::Acquire(const char *hostname,
+  uint16_t port, std::vector<PresentationContext> const & inpcs,
+  const char *aetitle, const char *call)
+{
+  if( !hostname || !port || inpcs.empty() ) return nullptr;
+  if( !aetitle ) aetitle = GDCM_POOL_AETITLE;
+  if( !call ) call = GDCM_POOL_CALLEDAETITLE;
+  const std::string key = MakeKey( hostname, port, aetitle, call, inpcs );
+
+  std::vector<ServiceClassUser*> expired;
+  double healthcheck, timeout;
+  uint32_t maxpdulength;
+  for(;;)
+    {
+    ServiceClassUser *scu = nullptr;
+    double idletime = 0;
+      {
+      std::lock_guard<std::mutex> lock( Internals->Lock );
+      healthcheck = Internals->HealthCheckInterval;
+      timeout = Internals->Timeout;
+      maxpdulength = Internals->MaxPDULength;
+      Internals->CollectExpired( expired, false );
+      // most recently used first, it is the most likely to still be alive
+      std::vector<ServiceClassUserPoolInternals::IdleAssociation> &idle = Internals->Idle;
+      for( size_t i = idle.size(); i > 0; --i )
+        {
+        if( idle[i-1].Key == key )
+          {
+          scu = idle[i-1].SCU;
+          idletime = ServiceClassUserPoolInternals::Elapsed( idle[i-1].LastUsed );
+          idle.erase( idle.begin() + (i-1) );
+          Internals->InUse[ scu ] = key;
+          break;
+          }
+        }
+      }
+    if( !scu ) break;
+    if( healthcheck < 0 || idletime < healthcheck )
+      {
+      ServiceClassUserPoolInternals::StopAll( expired );
+      return scu;
+      }
+    bool alive = false;
+    try
+      {
+      alive = scu->SendEcho();
+      }
+    catch( std::exception & ex )
+      {
+      (void)ex;
+      gdcmDebugMacro( "C-ECHO failed: " << ex.what() );
+      }
+    if( alive )
+      {
+      ServiceClassUserPoolInternals::StopAll( expired );
+      return scu;
+      }
+    // peer went away, drop it and try the next one
+    gdcmDebugMacro( "Dropping stale association to " << hostname << ":" << port );
+    std::lock_guard<std::mutex> lock( Internals->Lock );
+    Internals->InUse.erase( scu );
+    expired.push_back( scu );
+    }
+  ServiceClassUserPoolInternals::StopAll( expired );
+
+  ServiceClassUser *scu = new ServiceClassUser;
+  scu->SetHostname( hostname );
+  scu->SetPort( port );
+  scu->SetAETitle( aetitle );
+  scu->SetCalledAETitle( call );
+  scu->SetTimeout( timeout );
+  scu->SetMaxPDULength( maxpdulength );
+  if( !scu->InitializeConnection() )
+    {
+    gdcmErrorMacro( "Could not connect to " << hostname << ":" << port );
+    delete scu;
+    return nullptr;
+    }
+  scu->SetPresentationContexts( AddVerificationContext( inpcs ) );
+  if( !scu->StartAssociation() )
+    {
+    gdcmErrorMacro( "Could not start association with " << hostname << ":" << port );
+    delete scu;
+    return nullptr;
+    }
+
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  Internals->InUse[ scu ] = key;
+  return scu;
+}
+
+void ServiceClassUserPool::Release(ServiceClassUser *scu, bool reusable)
+{
+  if( !scu ) return;
+  std::vector<ServiceClassUser*> expired;
+    {
+    std::lock_guard<std::mutex> lock( Internals->Lock );
+    std::map<ServiceClassUser*, std::string>::iterator it = Internals->InUse.find( scu );
+    if( it == Internals->InUse.end() )
+      {
+      gdcmWarningMacro( "Association was not acquired from this pool" );
+      return;
+      }
+    ServiceClassUserPoolInternals::IdleAssociation entry;
+    entry.Key = it->second;
+    entry.SCU = scu;
+    entry.LastUsed = ServiceClassUserPoolInternals::ClockType::now();
+    Internals->InUse.erase( it );
+    Internals->CollectExpired( expired, false );
+
+    unsigned int count = 0;
+    for( size_t i = 0; i < Internals->Idle.size(); ++i )
+      {
+      if( Internals->Idle[i].Key == entry.Key ) ++count;
+      }
+    if( !reusable || count >= Internals->MaximumNumberOfIdleAssociations )
+      {
+      expired.push_back( entry.SCU );
+      }
+    else
+      {
+      Internals->Idle.push_back( entry );
+      }
+    }
+  ServiceClassUserPoolInternals::StopAll( expired );
+}
+
+void ServiceClassUserPool::Purge()
+{
+  std::vector<ServiceClassUser*> expired;
+    {
+    std::lock_guard<std::mutex> lock( Internals->Lock );
+    Internals->CollectExpired( expired, false );
+    }
+  ServiceClassUserPoolInternals::StopAll( expired );
+}
+
+void ServiceClassUserPool::Clear()
+{
+  std::vector<ServiceClassUser*> expired;
+    {
+    std::lock_guard<std::mutex> lock( Internals->Lock );
+    Internals->CollectExpired( expired, true );
+    }
+  ServiceClassUserPoolInternals::StopAll( expired );
+}
+
+size_t ServiceClassUserPool::GetNumberOfIdleAssociations() const
+{
+  std::lock_guard<std::mutex> lock( Internals->Lock );
+  return Internals->Idle.size();
+}
+
+} // end namespace gdcm
@@ -0,0 +1,104 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef GDCMSERVICECLASSUSERPOOL_H
+#define GDCMSERVICECLASSUSERPOOL_H
+
+#include "gdcmServiceClassUser.h"
+
+namespace gdcm
+{
+class ServiceClassUserPoolInternals;
+/**
+ * \brief ServiceClassUserPool
+ * \details Keep established associations around so that they can be reused
+ * by subsequent operations toward the same peer. Associations are keyed by
+ * (hostname, port, calling AE-Title, called AE-Title, presentation contexts).
+ *
+ * Acquire returns a ServiceClassUser in state Sta6 (transfer ready), either
+ * an idle pooled one, or a newly negotiated one. The pool keeps ownership of
+ * it: the caller must neither delete it nor hold it in a SmartPointer, and
+ * must give it back with Release once done. An association is never handed
+ * to two callers at the same time, so the pool can be shared by multiple
+ * threads.
+ *
+ * Idle associations are released after SetIdleTimeout seconds. An association
+ * which has been idle for more than SetHealthCheckInterval seconds is
+ * verified with a C-ECHO before being reused (the Verification presentation
+ * context is added when missing).
+ */
+class GDCM_EXPORT ServiceClassUserPool
+{
+public:
+  ServiceClassUserPool();
+  ~ServiceClassUserPool();
+  ServiceClassUserPool(const ServiceClassUserPool&) = delete;
+  void operator=(const ServiceClassUserPool &) = delete;
+
+  /// set/get the time (in seconds) an association can stay idle in the pool
+  /// Default is 60s
+  void SetIdleTimeout(double t);
+  double GetIdleTimeout() const;
+
+  /// set/get the idle time (in seconds) after which a C-ECHO is sent before
+  /// reusing an association. A negative value disables health checks.
+  /// Default is 5s
+  void SetHealthCheckInterval(double t);
+  double GetHealthCheckInterval() const;
+
+  /// set/get the maximum number of idle associations kept per key.
+  /// Default is 8
+  void SetMaximumNumberOfIdleAssociations(unsigned int n);
+  unsigned int GetMaximumNumberOfIdleAssociations() const;
+
+  /// set/get Timeout used for new associations
+  void SetTimeout(double t);
+  double GetTimeout() const;
+
+  /// set/get max PDU length used for new associations
+  void SetMaxPDULength(uint32_t length);
+  uint32_t GetMaxPDULength() const;
+
+  /// Return an association ready for transfer, or NULL if none could be
+  /// established.
+  /// \param aetitle when not set will default to 'GDCMSCU'
+  /// \param call when not set will default to 'ANY-SCP'
+  ServiceClassUser *Acquire(const char *hostname, uint16_t port,
+    std::vector<PresentationContext> const & pcs,
+    const char *aetitle = nullptr, const char *call = nullptr);
+
+  /// Give back an association obtained with Acquire. When reusable is
+  /// false (eg. an operation failed), the association is released instead
+  /// of being put back in the pool.
+  void Release(ServiceClassUser *scu, bool reusable = true);
+
+  /// Release all idle associations which have reached the idle timeout
+  void Purge();
+
+  /// Release all idle associations
+  void Clear();
+
+  /// Return the number of idle associations currently in the pool
+  size_t GetNumberOfIdleAssociations() const;
+
+private:
+  ServiceClassUserPoolInternals *Internals;
+};
+
+} // end namespace gdcm
+
+#endif // GDCMSERVICECLASSUSERPOOL_H
@@ -30,9 +30,13 @@ each class have its own file for the sake of brevity of the number of files.
 #include "gdcmAAssociateRQPDU.h"
 #include "gdcmAAssociateACPDU.h"
 #include "gdcmAAssociateRJPDU.h"
+#include "gdcmRoleSelectionSub.h"
+#include "gdcmMediaStorage.h"
 
 #include <socket++/echo.h>//for setting up the local socket
 
+#include <algorithm>
+
 namespace gdcm
 {
 namespace network
@@ -79,6 +83,49 @@ EStateID ULActionAE2::PerformAction(Subject *, ULEvent& , ULConnection& inConnec
     thePDU.AddPresentationContext(*itor);
     }
 
+  // let the peer know how large the PDUs it sends us can be
+  UserInformation userInfo;
+  userInfo.GetMaximumLengthSub().SetMaximumLength(
+    (uint32_t)inConnection.GetConnectionInfo().GetMaxPDULength() );
+
+  // With C-GET the sub-operations C-STORE are sent back over this very
+  // association, so propose the SCP role for every storage SOP Class
+  bool retrieveget = false;
+  for (itor = thePCS.begin(); itor < thePCS.end(); itor++)
+    {
+    UIDs uid;
+    if( uid.SetFromUID( itor->GetAbstractSyntax().GetName() ) )
+      {
+      switch( (UIDs::TSType)uid )
+        {
+      case UIDs::PatientRootQueryRetrieveInformationModelGET:
+      case UIDs::StudyRootQueryRetrieveInformationModelGET:
+      case UIDs::PatientStudyOnlyQueryRetrieveInformationModelGETRetired:
+      case UIDs::CompositeInstanceRootRetrieveGET:
+      case UIDs::CompositeInstanceRetrieveWithoutBulkDataGET:
+        retrieveget = true;
+        break;
+      default:
+        break;
+        }
+      }
+    }
+  if( retrieveget )
+    {
+    std::vector<std::string> done;
+    for (itor = thePCS.begin(); itor < thePCS.end(); itor++)
+      {
+      const std::string name = itor->GetAbstractSyntax().GetName();
+      if( MediaStorage::GetMSType( name.c_str() ) == MediaStorage::MS_END ) continue;
+      if( std::find( done.begin(), done.end(), name ) != done.end() ) continue;
+      RoleSelectionSub rss;
+      rss.SetTuple( name.c_str(), 0, 1 );
+      userInfo.AddRoleSelectionSub( rss );
+      done.push_back( name );
+      }
+    }
+  thePDU.SetUserInformation( userInfo );
+
   thePDU.Write(*inConnection.GetProtocol());
   inConnection.GetProtocol()->flush();
 
@@ -174,6 +221,7 @@ EStateID ULActionAE6::PerformAction(Subject *, ULEvent& inEvent, ULConnection& i
     ts1.SetNameFromUID( UIDs::ImplicitVRLittleEndianDefaultTransferSyntaxforDICOM );
 
     AAssociateACPDU acpdu;
+    std::vector<PresentationContextRQ> acceptedRQ;
 
     assert( rqpdu->GetNumberOfPresentationContext() );
     for( unsigned int index = 0; index < rqpdu->GetNumberOfPresentationContext(); index++ )
@@ -228,12 +276,60 @@ EStateID ULActionAE6::PerformAction(Subject *, ULEvent& inEvent, ULConnection& i
       pcac1.SetPresentationContextID( id );
       pcac1.SetReason( result );
       acpdu.AddPresentationContextAC( pcac1 );
+      if( !result )
+        {
+        PresentationContextRQ pcrq;
+        pcrq.SetPresentationContextID( id );
+        pcrq.GetAbstractSyntax() = pc.GetAbstractSyntax();
+        pcrq.AddTransferSyntax( pcac1.GetTransferSyntax() );
+        acceptedRQ.push_back( pcrq );
+        }
     }
     assert( acpdu.GetNumberOfPresentationContextAC() );
 
     // Init AE-Titles:
     acpdu.InitFromRQ( *rqpdu );
 
+    // PDUs sent to the requestor must fit its own limit, while the
+    // requestor is told about ours:
+    inConnection.SetMaxPDUSize(
+      rqpdu->GetUserInformation().GetMaximumLengthSub().GetMaximumLength() );
+    UserInformation userInfo;
+    userInfo.GetMaximumLengthSub().SetMaximumLength(
+      (uint32_t)inConnection.GetConnectionInfo().GetMaxPDULength() );
+    // accept the proposed roles (eg. SCP role for the C-STORE of a C-GET),
+    // but only for the SOP Classes of an accepted presentation context. No
+    // answer for the others means that the default roles apply.
+    UserInformation const &rqUserInfo = rqpdu->GetUserInformation();
+    for( size_t i = 0; i < rqUserInfo.GetNumberOfRoleSelectionSubs(); ++i )
+      {
+      RoleSelectionSub const &rss = rqUserInfo.GetRoleSelectionSub(i);
+      std::string name = rss.GetName();
+      while( !name.empty() && name[name.size()-1] == '\0' ) name.erase( name.size() - 1 );
+      for( size_t j = 0; j < acceptedRQ.size(); ++j )
+        {
+        if( name == acceptedRQ[j].GetAbstractSyntax().GetName() )
+          {
+          userInfo.AddRoleSelectionSub( rss );
+          break;
+          }
+        }
+      }
+    acpdu.SetUserInformation( userInfo );
+
+    // remember what was agreed upon, so that the acceptor can later send
+    // messages on its own (eg. the C-STORE sub-operations of a C-GET)
+    inConnection.SetPresentationContexts( acceptedRQ );
+    inConnection.GetAcceptedPresentationContexts().clear();
+    for( unsigned int index = 0; index < acpdu.GetNumberOfPresentationContextAC(); index++ )
+      {
+      PresentationContextAC const &pcac = acpdu.GetPresentationContextAC(index);
+      if( pcac.GetReason() == 0 )
+        {
+        inConnection.AddAcceptedPresentationContext( pcac );
+        }
+      }
+
     acpdu.Write( *inConnection.GetProtocol() );
     inConnection.GetProtocol()->flush();
 
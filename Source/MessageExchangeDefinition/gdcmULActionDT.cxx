@@ -212,47 +212,39 @@ EStateID ULActionDT1::PerformAction(Subject *s, ULEvent& inEvent, ULConnection&
       throw Exception("Data sending event PDU malformed.");
       }
     uint8_t prescontid = dataPDU->GetPresentationDataValue(0).GetPresentationContextID();
-    size_t maxpdu = 16378;
-    maxpdu = inConnection.GetMaxPDUSize() - 6;
+    const size_t maxpdv = inConnection.GetMaxPDVLength();
     pStream->seekg( 0, std::ios::beg );
     pStream->seekg( 0, std::ios::end );
     std::streampos len = pStream->tellg();
-    char * contents = new char [maxpdu];
     std::streampos cur = inEvent.GetDataSetPos() ;
     pStream->seekg( cur );
-    PresentationDataValue thePDV;
-    PDataTFPDU basePDU ;
+    // the value bytes are read once into this buffer, and sent from there
+    // along with the PDU header (no intermediate PDataTFPDU / std::string):
+    std::vector<char> contents( std::min( maxpdv, (size_t)(len - cur) ) );
+    const double streamtick =
+      1. / (double)(theDataPDUs.size() + (len - cur + maxpdv - 1) / maxpdv);
+    Progress = (double)theDataPDUs.size() * streamtick;
     while( cur < len )
       {
-      size_t remaining = std::min( maxpdu , (size_t)(len - cur) );
-      pStream->read( contents, remaining );
-      std::string sub( contents, remaining );
-      std::string UIDString;
-      thePDV.SetPresentationContextID( prescontid );
-      thePDV.SetBlob( sub );
-
-      if( remaining == maxpdu )
-        thePDV.SetMessageHeader( 0 );
-      else
-        thePDV.SetMessageHeader( 2 );
-
+      size_t remaining = std::min( maxpdv , (size_t)(len - cur) );
+      pStream->read( &contents[0], remaining );
+      if( !pStream->good() )
+        {
+        throw Exception("Could not read data set.");
+        }
       cur += remaining;
-      basePDU = PDataTFPDU();
-      basePDU.AddPresentationDataValue( thePDV );
-      basePDU.Write(*inConnection.GetProtocol());
-      Progress += progresstick;
+      const uint8_t messageheader = cur < len ? 0 : 2;
+      if( !inConnection.WritePDataTF( prescontid, messageheader,
+          &contents[0], remaining ) )
+        {
+        throw Exception("Could not send data set.");
+        }
+      Progress += streamtick;
       ProgressEvent pe;
       pe.SetProgress( Progress );
       s->InvokeEvent( pe );
-
-      //if( !inConnection.GetProtocol()->good() );
-      //  {
-      //  throw new Exception("Protocol is not good.");
-      //  return eStaDoesNotExist;
-      //  }
-      inConnection.GetProtocol()->flush();
       }
-    delete [] contents ;
+    inConnection.GetProtocol()->flush();
     }
   // When doing a C-MOVE we receive the Requested DataSet over
   // another channel (technically this is send to an SCP)
@@ -17,9 +17,18 @@
  *=========================================================================*/
 #include "gdcmULConnection.h"
 
+#include "gdcmSwapper.h"
+
 #include <algorithm> // std::find
+#include <cerrno>
+#include <cstring>
 #include <socket++/echo.h>
 
+#if defined(_WIN32)
+#else
+#include <sys/uio.h>
+#endif
+
 namespace gdcm
 {
 namespace network
@@ -29,7 +38,10 @@ ULConnection::ULConnection(const ULConnectionInfo& inConnectInfo)
   mCurrentState = eSta1Idle;
   mSocket = nullptr;
   mEcho = nullptr;
+  mBufferedStream = nullptr;
   mInfo = inConnectInfo;
+  // until the peer tells us otherwise, assume the PS 3.8 default
+  mMaxPDUSize = 0x4000;
 
   TransferSyntaxSub ts1;
   ts1.SetNameFromUID( UIDs::ImplicitVRLittleEndianDefaultTransferSyntaxforDICOM );
@@ -63,6 +75,10 @@ void ULConnection::SetState(const EStateID& inState)
 //echo* ULConnection::GetProtocol(){
 std::iostream* ULConnection::GetProtocol()
 {
+  if (mBufferedStream)
+    {
+    return mBufferedStream;
+    }
   if (mEcho)
     {
     return mEcho;
@@ -76,6 +92,11 @@ std::iostream* ULConnection::GetProtocol()
   return nullptr;
 }
 
+void ULConnection::SetBufferedProtocol(std::iostream* inStream)
+{
+  mBufferedStream = inStream;
+}
+
 ARTIMTimer& ULConnection::GetTimer()
 {
   return mTimer;
@@ -96,6 +117,103 @@ uint32_t ULConnection::GetMaxPDUSize() const
   return mMaxPDUSize;
 }
 
+size_t ULConnection::GetMaxPDVLength() const
+{
+  // 4 bytes item length + 1 byte pres context id + 1 byte message header
+  static const size_t pdvheader = 6;
+  static const size_t maxpdv = 0x400000;
+  if( mMaxPDUSize == 0 )
+    {
+    return maxpdv;
+    }
+  if( mMaxPDUSize <= pdvheader )
+    {
+    // bogus value, use the default
+    return 0x4000 - pdvheader;
+    }
+  return std::min( (size_t)mMaxPDUSize - pdvheader, maxpdv );
+}
+
+bool ULConnection::WritePDataTF(uint8_t inPresentationContextID,
+  uint8_t inMessageHeader, const char *inData, size_t inLength)
+{
+  std::iostream *protocol = GetProtocol();
+  if( !protocol || inLength > GetMaxPDVLength() ) return false;
+
+  // PS 3.8 / Table 9-22 P-DATA-TF PDU FIELDS followed by
+  // Table 9-23 PRESENTATION-DATA-VALUE ITEM FIELDS
+  char header[12];
+  const uint32_t pdvlength = (uint32_t)inLength + 2;
+  const uint32_t pdulength = pdvlength + 4;
+  uint32_t copy;
+  header[0] = 0x04; // PDU-type
+  header[1] = 0x00; // Reserved
+  copy = pdulength;
+  SwapperDoOp::SwapArray(&copy,1);
+  memcpy( header + 2, &copy, sizeof(copy) );
+  copy = pdvlength;
+  SwapperDoOp::SwapArray(&copy,1);
+  memcpy( header + 6, &copy, sizeof(copy) );
+  header[10] = (char)inPresentationContextID;
+  header[11] = (char)inMessageHeader;
+
+#if defined(_WIN32)
+#else
+  sockbuf *sb = nullptr;
+  if( !mBufferedStream )
+    {
+    if( mEcho ) sb = mEcho->rdbuf();
+    else if( mSocket ) sb = mSocket->rdbuf();
+    }
+  if( sb )
+    {
+    // whatever was previously written to the iostream must go first:
+    protocol->flush();
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<char*>(inData);
+    iov[1].iov_len = inLength;
+    struct iovec *cur = iov;
+    int niov = inLength ? 2 : 1;
+    const int timeout = (int)GetTimer().GetTimeout();
+    while( niov )
+      {
+      // same semantic as sockbuf::write
+      if( timeout > 0 && !sb->is_writeready( timeout ) )
+        {
+        gdcmErrorMacro( "Timeout while sending P-DATA-TF" );
+        return false;
+        }
+      const ssize_t n = writev( sb->sd(), cur, niov );
+      if( n < 0 )
+        {
+        if( errno == EINTR ) continue;
+        gdcmErrorMacro( "Could not send P-DATA-TF: " << strerror(errno) );
+        return false;
+        }
+      size_t written = (size_t)n;
+      // partial write, skip whatever went through
+      while( niov && written >= cur->iov_len )
+        {
+        written -= cur->iov_len;
+        ++cur;
+        --niov;
+        }
+      if( niov )
+        {
+        cur->iov_base = (char*)cur->iov_base + written;
+        cur->iov_len -= written;
+        }
+      }
+    return true;
+    }
+#endif
+  protocol->write( header, sizeof(header) );
+  protocol->write( inData, inLength );
+  return protocol->good();
+}
+
 std::vector<PresentationContextRQ> const &
 ULConnection::GetPresentationContexts() const
 {
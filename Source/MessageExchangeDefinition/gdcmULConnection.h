@@ -65,6 +65,7 @@ class GDCM_EXPORT ULConnection
       iosockinet* mSocket;//of the three protocols offered by socket++-- echo, smtp, and ftp--
       //echo most closely matches what the DICOM standard describes as a network connection
       ARTIMTimer mTimer;
+      std::iostream* mBufferedStream;//set by ULNonBlockingTransport, not owned
 
       EStateID mCurrentState;
 
@@ -80,6 +81,7 @@ class GDCM_EXPORT ULConnection
       friend class ULActionAE6;
       void SetCStoreTransferSyntax( TransferSyntaxSub const & ts );
       friend class ULConnectionManager;
+      friend class ULNonBlockingTransportInternals;
       TransferSyntaxSub const & GetCStoreTransferSyntax( ) const;
     public:
 
@@ -94,6 +96,10 @@ class GDCM_EXPORT ULConnection
       std::iostream* GetProtocol();
       void StopProtocol();
 
+      /// used by ULNonBlockingTransport: PDUs are then read from and written
+      /// to this in-memory stream instead of the socket++ iostream
+      void SetBufferedProtocol(std::iostream* inStream);
+
       ARTIMTimer& GetTimer();
 
       const ULConnectionInfo &GetConnectionInfo() const;
@@ -104,6 +110,18 @@ class GDCM_EXPORT ULConnection
       void SetMaxPDUSize(uint32_t inSize);
       uint32_t GetMaxPDUSize() const;
 
+      /// Maximum number of bytes of the value field that can be put in a
+      /// single PDV sent to the peer (ie. GetMaxPDUSize minus the PDV item
+      /// header). A peer advertising no limit (0) gets 4MB sized PDVs.
+      size_t GetMaxPDVLength() const;
+
+      /// Send a single P-DATA-TF PDU holding one PDV made of inLength bytes
+      /// of inData. The PDU and PDV headers and the value are written with a
+      /// single scatter/gather write, inData is never copied.
+      /// Return false upon error.
+      bool WritePDataTF(uint8_t inPresentationContextID, uint8_t inMessageHeader,
+        const char *inData, size_t inLength);
+
       const PresentationContextAC *GetPresentationContextACByID(uint8_t id) const;
       const PresentationContextRQ *GetPresentationContextRQByID(uint8_t id) const;
 
@@ -36,14 +36,22 @@ namespace gdcm
     ///the callback function MUST set mHandledDataSet to true.
     ///otherwise, the cmove event loop handler will not know data was received, and
     ///proceed to end the loop prematurely.
+    ///HandleDataSet is called synchronously from the receiving loop, as soon as
+    ///a complete dataset was read: nothing more is read from the network until
+    ///it returns. A slow callback thus throttles the peer (through TCP flow
+    ///control) instead of having the results piling up in memory.
+    ///For C-FIND, calling RequestCancel from within the callback makes the
+    ///receiving loop send a C-CANCEL-RQ; pending results received afterwards
+    ///are dropped until the final response arrives.
     class GDCM_EXPORT ULConnectionCallback {
       bool mHandledDataSet;
+      bool mCancelRequested;
     protected:
       bool mImplicit;
       //inherited callbacks MUST call this function for the cmove loop to work properly
       void DataSetHandled() { mHandledDataSet = true; }
     public:
-      ULConnectionCallback():mHandledDataSet(false),mImplicit(true){}
+      ULConnectionCallback():mHandledDataSet(false),mCancelRequested(false),mImplicit(true){}
       virtual ~ULConnectionCallback() = default; //placeholder for inherited objects
       virtual void HandleDataSet(const DataSet& inDataSet) = 0;
       virtual void HandleResponse(const DataSet& inDataSet) = 0;
@@ -51,6 +59,10 @@ namespace gdcm
       bool DataSetHandles() const { return mHandledDataSet; }
       void ResetHandledDataSet() { mHandledDataSet = false; }
 
+      void RequestCancel() { mCancelRequested = true; }
+      bool IsCancelRequested() const { return mCancelRequested; }
+      void ResetCancel() { mCancelRequested = false; }
+
       void SetImplicitFlag( const bool imp ) { mImplicit = imp; }
     };
   }
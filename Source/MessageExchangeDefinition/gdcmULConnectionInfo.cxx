@@ -44,7 +44,13 @@ namespace network
 {
 
 ULConnectionInfo::ULConnectionInfo()
-= default;
+{
+  mCalledIPAddress = 0;
+  mCalledIPPort = 0;
+  // PS 3.8 / D.1: what we advertise as our own receive limit, same default as
+  // the one found in MaximumLengthSub
+  mMaxPDULength = 0x4000;
+}
 
       //it is possible to misinitialize this object, so
       //have it return false if something breaks (ie, given AEs are bigger than 16 characters,
@@ -65,8 +65,10 @@ class ULConnectionInfo {
       int GetCalledIPPort() const;
       std::string GetCalledComputerName() const;
 
-      //CStore needs to know the max pdu length, so the value gets initialized
-      //when a cstore connection is established (but not for the others).
+      //maximum length of the PDUs this application is willing to receive.
+      //it is sent to the peer in the A-ASSOCIATE-RQ (scu) or A-ASSOCIATE-AC
+      //(scp) user information. 0 means no limit. Default is 16384.
+      //the peer own limit is stored in ULConnection::GetMaxPDUSize
       void SetMaxPDULength(unsigned long inMaxPDULength);
       unsigned long GetMaxPDULength() const;
     };
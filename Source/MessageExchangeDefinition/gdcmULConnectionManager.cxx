@@ -29,6 +29,7 @@
 #include "gdcmAReleaseRPPDU.h"
 
 #include "gdcmULBasicCallback.h"
+#include "gdcmCStoreMessages.h"
 
 #include <vector>
 #include <socket++/echo.h>//for setting up the local socket
@@ -45,6 +46,7 @@ ULConnectionManager::ULConnectionManager()
 {
   mConnection = nullptr;
   mSecondaryConnection = nullptr;
+  mMaxPDULength = 0x4000;
 }
 
 ULConnectionManager::~ULConnectionManager()
@@ -61,6 +63,16 @@ ULConnectionManager::~ULConnectionManager()
     }
 }
 
+void ULConnectionManager::SetMaxPDULength(uint32_t inMaxPDULength)
+{
+  mMaxPDULength = inMaxPDULength;
+}
+
+uint32_t ULConnectionManager::GetMaxPDULength() const
+{
+  return mMaxPDULength;
+}
+
 bool ULConnectionManager::EstablishConnection(const std::string& inAETitle,
   const std::string& inConnectAETitle,
   const std::string& inComputerName, long inIPAddress,
@@ -80,6 +92,8 @@ bool ULConnectionManager::EstablishConnection(const std::string& inAETitle,
     return false;
     }
 
+  connectInfo.SetMaxPDULength(mMaxPDULength);
+
   delete mConnection;
   mConnection = new ULConnection(connectInfo);
 
@@ -245,6 +259,7 @@ bool ULConnectionManager::EstablishConnectionMove(const std::string& inAETitle,
     gdcmDebugMacro( "delete mSecondaryConnection" );
     delete mSecondaryConnection;
     }
+  connectInfo.SetMaxPDULength(mMaxPDULength);
   mSecondaryConnection = new ULConnection(connectInfo);
   mSecondaryConnection->GetTimer().SetTimeout(inTimeout);
 
@@ -266,6 +281,7 @@ bool ULConnectionManager::EstablishConnectionMove(const std::string& inAETitle,
     gdcmDebugMacro( "delete mConnection" );
     delete mConnection;
     }
+  connectInfo2.SetMaxPDULength(mMaxPDULength);
   mConnection = new ULConnection(connectInfo2);
   mConnection->GetTimer().SetTimeout(inTimeout);
 
@@ -413,8 +429,16 @@ void ULConnectionManager::SendStore(const File & file, ULConnectionCallback* inC
     {
     return;
     }
-  bool writeDataSet = pStream == nullptr ;
-  std::vector<BasePDU*> theDataPDU = PDUFactory::CreateCStoreRQPDU(*mConnection, file, writeDataSet);
+  // when no stream is given, serialize the data set once so that it can be
+  // sent chunk by chunk straight from memory (see ULActionDT1)
+  std::stringstream ss;
+  if( pStream == nullptr )
+    {
+    CStoreRQ::WriteDataSet( file, ss );
+    pStream = &ss;
+    dataSetOffset = 0;
+    }
+  std::vector<BasePDU*> theDataPDU = PDUFactory::CreateCStoreRQPDU(*mConnection, file, false);
   const DataSet* inDataSet = &file.GetDataSet();
   DataSetEvent dse( inDataSet );
   this->InvokeEvent( dse );
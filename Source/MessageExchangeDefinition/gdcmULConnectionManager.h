@@ -48,6 +48,7 @@ namespace gdcm {
       ULConnection* mConnection;
       ULConnection* mSecondaryConnection;
       ULTransitionTable mTransitions;
+      uint32_t mMaxPDULength;
 
       //no copying
       ULConnectionManager(const ULConnectionManager& inCM);
@@ -70,6 +71,12 @@ namespace gdcm {
       ULConnectionManager();
       ~ULConnectionManager() override;
 
+      //maximum length of the PDUs this application accepts to receive,
+      //advertised during association (0 means no limit, default is 16384).
+      //must be set before establishing the connection.
+      void SetMaxPDULength(uint32_t inMaxPDULength);
+      uint32_t GetMaxPDULength() const;
+
       // NOTE: (MM) The following two functions are difficult to use, therefore marking
       // them as internal for now.
 
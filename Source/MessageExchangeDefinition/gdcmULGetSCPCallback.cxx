@@ -0,0 +1,332 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULGetSCPCallback.h"
+#include "gdcmULConnection.h"
+#include "gdcmPDUFactory.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmAttribute.h"
+#include "gdcmReader.h"
+
+#include <map>
+#include <cstring>
+
+namespace gdcm
+{
+namespace network
+{
+namespace
+{
+// State of the C-GET running on one association
+struct GetOperation
+{
+  std::vector<std::string> Filenames;
+  size_t Next{0};
+  uint16_t MessageID{0};
+  uint8_t PresentationContextID{0};
+  std::string AffectedSOPClassUID;
+  uint16_t Completed{0};
+  uint16_t Failed{0};
+  uint16_t Warning{0};
+  bool Canceled{false};
+  std::vector<std::string> FailedSOPInstanceUIDs;
+};
+
+std::string GetCommandUID(const DataSet &command, const Tag &t)
+{
+  std::string ret;
+  if( command.FindDataElement( t ) )
+    {
+    const ByteValue *bv = command.GetDataElement( t ).GetByteValue();
+    if( bv ) ret.assign( bv->GetPointer(), bv->GetLength() );
+    }
+  while( !ret.empty() && ( ret[ret.size()-1] == '\0' || ret[ret.size()-1] == ' ' ) )
+    ret.erase( ret.size() - 1 );
+  return ret;
+}
+
+// Return the id of the presentation context negotiated for (abstract syntax,
+// transfer syntax), 0 when there is none
+uint8_t FindPresentationContextID(ULConnection const &conn,
+  std::string const &as, const char *ts)
+{
+  std::vector<PresentationContextRQ> const &pcs = conn.GetPresentationContexts();
+  for( std::vector<PresentationContextRQ>::const_iterator it = pcs.begin();
+    it != pcs.end(); ++it )
+    {
+    if( as != it->GetAbstractSyntax().GetName() ) continue;
+    for( PresentationContextRQ::SizeType i = 0; i < it->GetNumberOfTransferSyntaxes(); ++i )
+      {
+      if( !ts || strcmp( ts, it->GetTransferSyntax(i).GetName() ) == 0 )
+        return it->GetPresentationContextID();
+      }
+    }
+  return 0;
+}
+}
+
+class ULGetSCPCallbackInternals
+{
+public:
+  ULNonBlockingTransport *Transport{nullptr};
+  std::map<ULConnection*, GetOperation> Operations;
+
+  void SendResponse(ULConnection &conn, GetOperation const &op,
+    uint16_t status, bool final)
+    {
+    CommandDataSet ds;
+    {
+    Attribute<0x0,0x2> at;
+    at.SetValue( op.AffectedSOPClassUID.c_str() );
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x100> at = { 0x8010 };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x120> at = { op.MessageID };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    const bool hasidentifier = final && !op.FailedSOPInstanceUIDs.empty();
+    {
+    Attribute<0x0,0x800> at = { hasidentifier ? (uint16_t)0x0000 : (uint16_t)0x0101 };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x900> at = { status };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    if( !final || status == 0xFE00 )
+      {
+      Attribute<0x0,0x1020> at = { (uint16_t)( op.Filenames.size() - op.Next ) };
+      ds.Insert( at.GetAsDataElement() );
+      }
+    {
+    Attribute<0x0,0x1021> at = { op.Completed };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x1022> at = { op.Failed };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x1023> at = { op.Warning };
+    ds.Insert( at.GetAsDataElement() );
+    }
+    {
+    Attribute<0x0,0x0> at = { 0 };
+    at.SetValue( ds.GetLength<ImplicitDataElement>() );
+    ds.Insert( at.GetAsDataElement() );
+    }
+
+    std::vector<BasePDU*> pdus;
+    PresentationDataValue pdv;
+    pdv.SetPresentationContextID( op.PresentationContextID );
+    pdv.SetCommand( true );
+    pdv.SetLastFragment( true );
+    pdv.SetDataSet( ds );
+    PDataTFPDU *pdu = new PDataTFPDU;
+    pdu->AddPresentationDataValue( pdv );
+    pdus.push_back( pdu );
+    if( hasidentifier )
+      {
+      // Failed SOP Instance UID List
+      std::string uids;
+      for( size_t i = 0; i < op.FailedSOPInstanceUIDs.size(); ++i )
+        {
+        if( i ) uids += '\\';
+        uids += op.FailedSOPInstanceUIDs[i];
+        }
+      if( uids.size() % 2 ) uids.push_back( '\0' );
+      DataElement de( Tag(0x8,0x58) );
+      de.SetVR( VR::UI );
+      de.SetByteValue( uids.c_str(), (uint32_t)uids.size() );
+      DataSet identifier;
+      identifier.Insert( de );
+      PresentationDataValue data;
+      data.SetPresentationContextID( op.PresentationContextID );
+      data.SetMessageHeader( 2 );
+      data.SetDataSet( identifier );
+      PDataTFPDU *datapdu = new PDataTFPDU;
+      datapdu->AddPresentationDataValue( data );
+      pdus.push_back( datapdu );
+      }
+    Transport->Send( conn, pdus );
+    }
+
+  // Send the next C-STORE sub-operation, or the final C-GET-RSP when done.
+  // Return false once the operation is over.
+  bool Continue(ULConnection &conn, GetOperation &op)
+    {
+    while( !op.Canceled && op.Next < op.Filenames.size() )
+      {
+      const std::string &filename = op.Filenames[ op.Next++ ];
+      Reader reader;
+      reader.SetFileName( filename.c_str() );
+      std::vector<BasePDU*> pdus;
+      if( reader.Read() )
+        {
+        const File &file = reader.GetFile();
+        const std::string sopclass = GetCommandUID( file.GetDataSet(), Tag(0x8,0x16) );
+        const char *ts = file.GetHeader().GetDataSetTransferSyntax().GetString();
+        if( FindPresentationContextID( conn, sopclass, ts ) )
+          {
+          try
+            {
+            pdus = PDUFactory::CreateCStoreRQPDU( conn, file );
+            }
+          catch( std::exception &ex )
+            {
+            (void)ex;
+            gdcmErrorMacro( "Could not create C-STORE-RQ: " << ex.what() );
+            }
+          }
+        else
+          {
+          gdcmWarningMacro( "No presentation context for: " << filename );
+          }
+        if( pdus.empty() )
+          {
+          op.FailedSOPInstanceUIDs.push_back(
+            GetCommandUID( file.GetDataSet(), Tag(0x8,0x18) ) );
+          }
+        }
+      else
+        {
+        gdcmErrorMacro( "Could not read: " << filename );
+        }
+      if( !pdus.empty() )
+        {
+        Transport->Send( conn, pdus );
+        return true;
+        }
+      ++op.Failed;
+      }
+    uint16_t status = 0x0000;
+    if( op.Canceled ) status = 0xFE00;
+    else if( op.Failed || op.Warning ) status = 0xB000;
+    SendResponse( conn, op, status, true );
+    return false;
+    }
+};
+
+ULGetSCPCallback::ULGetSCPCallback()
+{
+  Internals = new ULGetSCPCallbackInternals;
+}
+
+ULGetSCPCallback::~ULGetSCPCallback()
+{
+  delete Internals;
+}
+
+void ULGetSCPCallback::SetTransport(ULNonBlockingTransport *transport)
+{
+  Internals->Transport = transport;
+}
+
+ULNonBlockingTransport *ULGetSCPCallback::GetTransport() const
+{
+  return Internals->Transport;
+}
+
+void ULGetSCPCallback::HandleMessage(ULConnection &inConnection,
+  const DataSet &inCommand, const DataSet &inDataSet)
+{
+  Attribute<0x0,0x100> commandfield = { 0 };
+  commandfield.SetFromDataSet( inCommand );
+  std::map<ULConnection*, GetOperation>::iterator it =
+    Internals->Operations.find( &inConnection );
+  switch( commandfield.GetValue() )
+    {
+  case 0x0010: // C-GET-RQ
+      {
+      if( !Internals->Transport ) return;
+      if( it != Internals->Operations.end() )
+        {
+        gdcmWarningMacro( "C-GET already running on this association" );
+        return;
+        }
+      GetOperation op;
+      Attribute<0x0,0x110> msgid = { 0 };
+      msgid.SetFromDataSet( inCommand );
+      op.MessageID = msgid.GetValue();
+      op.AffectedSOPClassUID = GetCommandUID( inCommand, Tag(0x0,0x2) );
+      op.PresentationContextID =
+        FindPresentationContextID( inConnection, op.AffectedSOPClassUID, nullptr );
+      if( !GetFilenames( inDataSet, op.Filenames ) )
+        {
+        op.Filenames.clear();
+        Internals->SendResponse( inConnection, op, 0xA900, true );
+        return;
+        }
+      if( Internals->Continue( inConnection, op ) )
+        {
+        Internals->Operations[ &inConnection ] = op;
+        }
+      }
+    return;
+  case 0x8001: // C-STORE-RSP of a sub-operation
+      {
+      if( it == Internals->Operations.end() ) break;
+      GetOperation &op = it->second;
+      Attribute<0x0,0x900> status = { 0xFFFF };
+      status.SetFromDataSet( inCommand );
+      switch( status.GetValue() )
+        {
+      case 0x0000:
+        ++op.Completed;
+        break;
+      case 0xB000: // Coercion of data elements
+      case 0xB006: // Elements discarded
+      case 0xB007: // Data set does not match SOP class
+        ++op.Warning;
+        break;
+      default:
+        ++op.Failed;
+        op.FailedSOPInstanceUIDs.push_back( GetCommandUID( inCommand, Tag(0x0,0x1000) ) );
+        }
+      if( op.Next < op.Filenames.size() && !op.Canceled )
+        {
+        Internals->SendResponse( inConnection, op, 0xFF00, false );
+        }
+      if( !Internals->Continue( inConnection, op ) )
+        {
+        Internals->Operations.erase( it );
+        }
+      }
+    return;
+  case 0x0FFF: // C-CANCEL-RQ
+    if( it != Internals->Operations.end() )
+      {
+      it->second.Canceled = true;
+      return;
+      }
+    break;
+    }
+  HandleOtherMessage( inConnection, inCommand, inDataSet );
+}
+
+void ULGetSCPCallback::HandleClose(ULConnection &inConnection)
+{
+  Internals->Operations.erase( &inConnection );
+}
+
+} // end namespace network
+} // end namespace gdcm
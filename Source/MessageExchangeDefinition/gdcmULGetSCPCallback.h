@@ -0,0 +1,75 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef GDCMULGETSCPCALLBACK_H
+#define GDCMULGETSCPCALLBACK_H
+
+#include "gdcmULNonBlockingTransport.h"
+
+#include <string>
+
+namespace gdcm
+{
+namespace network
+{
+class ULGetSCPCallbackInternals;
+/**
+ * \brief ULGetSCPCallback
+ * \details C-GET SCP on top of ULNonBlockingTransport. Upon C-GET-RQ the
+ * identifier is resolved into a list of files (see GetFilenames), which are
+ * then sent back as C-STORE sub-operations over the very same association.
+ * Sub-operations are issued one at a time: the next C-STORE-RQ is only sent
+ * once the C-STORE-RSP of the previous one has been received, and a pending
+ * C-GET-RSP (with the sub-operation counters) is sent in between. C-CANCEL-RQ
+ * stops the operation after the running sub-operation.
+ *
+ * The storage presentation contexts must have been negotiated, and the files
+ * are sent with their own transfer syntax (no conversion is done).
+ */
+class GDCM_EXPORT ULGetSCPCallback : public ULTransportCallback
+{
+public:
+  ULGetSCPCallback();
+  ~ULGetSCPCallback() override;
+  ULGetSCPCallback(const ULGetSCPCallback&) = delete;
+  void operator=(const ULGetSCPCallback&) = delete;
+
+  /// Set the transport used to send the responses (not owned)
+  void SetTransport(ULNonBlockingTransport *transport);
+  ULNonBlockingTransport *GetTransport() const;
+
+  /// Resolve the identifier of a C-GET-RQ into the list of files to send.
+  /// Return false when the identifier cannot be processed (0xA900 is then
+  /// returned to the peer).
+  virtual bool GetFilenames(const DataSet &inIdentifier,
+    std::vector<std::string> &outFilenames) = 0;
+
+  /// Called for any message which is not part of a C-GET operation
+  virtual void HandleOtherMessage(ULConnection &, const DataSet &, const DataSet &) {}
+
+  void HandleMessage(ULConnection &inConnection,
+    const DataSet &inCommand, const DataSet &inDataSet) override;
+  void HandleClose(ULConnection &inConnection) override;
+
+private:
+  ULGetSCPCallbackInternals *Internals;
+};
+
+} // end namespace network
+} // end namespace gdcm
+
+#endif // GDCMULGETSCPCALLBACK_H
@@ -0,0 +1,780 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULConnection.h"
+#include "gdcmULConnectionInfo.h"
+#include "gdcmULTransitionTable.h"
+#include "gdcmULEvent.h"
+#include "gdcmPDUFactory.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmAttribute.h"
+#include "gdcmDataSet.h"
+#include "gdcmTrace.h"
+
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <streambuf>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace gdcm
+{
+namespace network
+{
+
+// The get area is pointed directly at the bytes of the PDU being parsed (no
+// copy), the put area appends to the pending write buffer of the connection.
+class ULTransportBuffer : public std::streambuf
+{
+public:
+  std::vector<char> Output;
+  size_t OutputPos{0}; // bytes of Output already sent
+
+  void SetInput(char *begin, char *end) { setg(begin, begin, end); }
+  void ClearInput() { setg(nullptr, nullptr, nullptr); }
+  size_t GetPendingSize() const { return Output.size() - OutputPos; }
+  void Consume(size_t n)
+    {
+    OutputPos += n;
+    if( OutputPos == Output.size() )
+      {
+      Output.clear();
+      OutputPos = 0;
+      }
+    else if( OutputPos > Output.size() / 2 )
+      {
+      Output.erase( Output.begin(), Output.begin() + OutputPos );
+      OutputPos = 0;
+      }
+    }
+
+protected:
+  int_type overflow(int_type c) override
+    {
+    if( !traits_type::eq_int_type(c, traits_type::eof()) )
+      {
+      Output.push_back( traits_type::to_char_type(c) );
+      }
+    return traits_type::not_eof(c);
+    }
+  std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+    Output.insert( Output.end(), s, s + n );
+    return n;
+    }
+  int_type underflow() override
+    {
+    return traits_type::eof();
+    }
+};
+
+struct ULTransportConnection
+{
+  ULTransportConnection():Stream(&Buffer) {}
+  int FD{-1};
+  ULConnection *Connection{nullptr};
+  ULTransportBuffer Buffer;
+  std::iostream Stream;
+  std::vector<char> Input;   // received bytes not yet parsed into a PDU
+  bool Connecting{false};    // non-blocking connect() in progress
+  bool WantWrite{false};     // EPOLLOUT currently registered
+  bool Closing{false};
+  std::chrono::steady_clock::time_point StateTime;
+  EStateID LastState{eStaDoesNotExist};
+  // DIMSE message reassembly:
+  std::vector<PresentationDataValue> CommandPDVs;
+  std::vector<PresentationDataValue> DataPDVs;
+  DataSet Command;
+  bool ExpectDataSet{false};
+};
+
+class ULNonBlockingTransportInternals
+{
+public:
+  ULNonBlockingTransport *Owner{nullptr};
+  ULTransportCallback *Callback{nullptr};
+  ULTransitionTable Transitions;
+  double Timeout{30};
+  uint32_t MaxPDULength{0x4000};
+  int EpollFD{-1};
+  int ListenFD{-1};
+  std::map<int, ULTransportConnection*> Connections;
+  // set while ProcessEvents runs: a connection aborted from a callback is only
+  // marked as Closing, and destroyed once the callback returned
+  bool InProcessEvents{false};
+
+  ULTransportConnection *Find(ULConnection const &c) const
+    {
+    std::map<int, ULTransportConnection*>::const_iterator it = Connections.begin();
+    for( ; it != Connections.end(); ++it )
+      {
+      if( it->second->Connection == &c ) return it->second;
+      }
+    return nullptr;
+    }
+
+  static bool IsDataSetExplicit(ULConnection const &c, uint8_t pcid)
+    {
+    TransferSyntaxSub explicitts;
+    explicitts.SetNameFromUID( UIDs::ExplicitVRLittleEndian );
+    const PresentationContextAC *pc = c.GetPresentationContextACByID( pcid );
+    const char *tsname = pc ? pc->GetTransferSyntax().GetName()
+      : c.GetCStoreTransferSyntax().GetName();
+    return strcmp( tsname, explicitts.GetName() ) == 0;
+    }
+
+  void Dispatch(ULTransportConnection &tc, ULEvent &event);
+  void HandlePDataTF(ULTransportConnection &tc, PDataTFPDU const &pdu);
+  void HandlePDU(ULTransportConnection &tc, uint8_t itemtype, char *begin, char *end);
+  void CheckStateChange(ULTransportConnection &tc);
+  ULTransportConnection *AddConnection(int fd, ULConnection *c);
+  void UpdateInterest(ULTransportConnection &tc);
+  bool Flush(ULTransportConnection &tc);
+  void ParseInput(ULTransportConnection &tc);
+  void Read(ULTransportConnection &tc);
+  void Accept();
+  void Close(ULTransportConnection *tc);
+  void CheckTimers();
+};
+
+void ULNonBlockingTransportInternals::Dispatch(ULTransportConnection &tc, ULEvent &event)
+{
+  bool waitingForEvent = false;
+  EEventID raisedEvent = eEventDoesNotExist;
+  Transitions.HandleEvent(Owner, event, *tc.Connection, waitingForEvent, raisedEvent);
+  // same semantic as ULConnectionManager::RunEventLoop: local events raised by
+  // an action are fed back into the table, until some input from the peer is
+  // required. Nothing ever blocks here.
+  for( int i = 0; i < cMaxEventID && !waitingForEvent
+    && raisedEvent != eEventDoesNotExist; ++i )
+    {
+    event.SetEvent( raisedEvent );
+    raisedEvent = eEventDoesNotExist;
+    Transitions.HandleEvent(Owner, event, *tc.Connection, waitingForEvent, raisedEvent);
+    }
+  tc.Stream.clear();
+  CheckStateChange(tc);
+}
+
+void ULNonBlockingTransportInternals::CheckStateChange(ULTransportConnection &tc)
+{
+  const EStateID state = tc.Connection->GetState();
+  if( state == tc.LastState ) return;
+  tc.LastState = state;
+  tc.StateTime = std::chrono::steady_clock::now();
+  if( state == eSta6TransferReady )
+    {
+    if( Callback ) Callback->HandleAssociation( *tc.Connection );
+    }
+  else if( state == eSta1Idle || state == eStaDoesNotExist )
+    {
+    tc.Closing = true;
+    }
+}
+
+void ULNonBlockingTransportInternals::HandlePDataTF(ULTransportConnection &tc,
+  PDataTFPDU const &pdu)
+{
+  for( PDataTFPDU::SizeType i = 0;
+    !tc.Closing && i < pdu.GetNumberOfPresentationDataValues(); ++i )
+    {
+    PresentationDataValue const &pdv = pdu.GetPresentationDataValue(i);
+    if( pdv.GetIsCommand() )
+      {
+      tc.CommandPDVs.push_back( pdv );
+      if( !pdv.GetIsLastFragment() ) continue;
+      // command are always sent as implicit little endian
+      tc.Command = PresentationDataValue::ConcatenatePDVBlobs( tc.CommandPDVs );
+      tc.CommandPDVs.clear();
+      Attribute<0x0,0x0800> commanddatasettype = { 0x0101 };
+      if( tc.Command.FindDataElement( commanddatasettype.GetTag() ) )
+        commanddatasettype.SetFromDataSet( tc.Command );
+      tc.ExpectDataSet = commanddatasettype.GetValue() != 0x0101;
+      if( !tc.ExpectDataSet && Callback )
+        {
+        DataSet empty;
+        Callback->HandleMessage( *tc.Connection, tc.Command, empty );
+        }
+      }
+    else
+      {
+      tc.DataPDVs.push_back( pdv );
+      if( !pdv.GetIsLastFragment() ) continue;
+      const bool isexplicit =
+        IsDataSetExplicit( *tc.Connection, pdv.GetPresentationContextID() );
+      DataSet ds = isexplicit
+        ? PresentationDataValue::ConcatenatePDVBlobsAsExplicit( tc.DataPDVs )
+        : PresentationDataValue::ConcatenatePDVBlobs( tc.DataPDVs );
+      tc.DataPDVs.clear();
+      if( !tc.ExpectDataSet )
+        {
+        gdcmWarningMacro( "Data Set received without Command Set. Discarding" );
+        continue;
+        }
+      tc.ExpectDataSet = false;
+      if( Callback ) Callback->HandleMessage( *tc.Connection, tc.Command, ds );
+      }
+    }
+}
+
+void ULNonBlockingTransportInternals::HandlePDU(ULTransportConnection &tc,
+  uint8_t itemtype, char *begin, char *end)
+{
+  BasePDU *pdu = PDUFactory::ConstructPDU( itemtype );
+  if( !pdu )
+    {
+    gdcmWarningMacro( "Unrecognized PDU type: " << (int)itemtype );
+    ULEvent event( eUnrecognizedPDUReceived, pdu );
+    Dispatch( tc, event );
+    return;
+    }
+  // skip itemtype, PDU::Read starts on the reserved byte
+  tc.Buffer.SetInput( begin + 1, end );
+  pdu->Read( tc.Stream );
+  tc.Buffer.ClearInput();
+  tc.Stream.clear();
+  if( Trace::GetDebugFlag() )
+    {
+    pdu->Print( Trace::GetStream() );
+    }
+
+  const EEventID eventid = PDUFactory::DetermineEventByPDU( pdu );
+  if( eventid == ePDATATFPDU && tc.Connection->GetState() == eSta6TransferReady )
+    {
+    // P-DATA indication: bypass DT2 which would re-emit a P-DATA request
+    // (ULConnectionManager does the same thing)
+    HandlePDataTF( tc, *static_cast<PDataTFPDU*>(pdu) );
+    delete pdu;
+    return;
+    }
+  ULEvent event( eventid, pdu );
+  Dispatch( tc, event );
+}
+
+ULTransportConnection *ULNonBlockingTransportInternals::AddConnection(int fd, ULConnection *c)
+{
+  ULTransportConnection *tc = new ULTransportConnection;
+  tc->FD = fd;
+  tc->Connection = c;
+  tc->StateTime = std::chrono::steady_clock::now();
+  tc->LastState = c->GetState();
+  c->GetTimer().SetTimeout( Timeout );
+  c->SetBufferedProtocol( &tc->Stream );
+  Connections[fd] = tc;
+  return tc;
+}
+
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+static bool SetNonBlocking(int fd)
+{
+  const int flags = fcntl(fd, F_GETFL, 0);
+  if( flags < 0 ) return false;
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void SetNoDelay(int fd)
+{
+  int val = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+}
+
+void ULNonBlockingTransportInternals::UpdateInterest(ULTransportConnection &tc)
+{
+  const bool wantwrite = tc.Connecting || tc.Buffer.GetPendingSize() != 0;
+  if( wantwrite == tc.WantWrite ) return;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | (wantwrite ? (uint32_t)EPOLLOUT : 0u);
+  ev.data.fd = tc.FD;
+  epoll_ctl(EpollFD, EPOLL_CTL_MOD, tc.FD, &ev);
+  tc.WantWrite = wantwrite;
+}
+
+bool ULNonBlockingTransportInternals::Flush(ULTransportConnection &tc)
+{
+  while( tc.Buffer.GetPendingSize() )
+    {
+    const ssize_t n = send( tc.FD, &tc.Buffer.Output[tc.Buffer.OutputPos],
+      tc.Buffer.GetPendingSize(), MSG_NOSIGNAL );
+    if( n < 0 )
+      {
+      if( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+      if( errno == EINTR ) continue;
+      gdcmDebugMacro( "send failed: " << strerror(errno) );
+      return false;
+      }
+    tc.Buffer.Consume( (size_t)n );
+    }
+  UpdateInterest( tc );
+  return true;
+}
+
+void ULNonBlockingTransportInternals::ParseInput(ULTransportConnection &tc)
+{
+  // Our Maximum Length (0 means no limit) applies to P-DATA-TF PDUs, the other
+  // ones are small
+  const size_t maxpdu = tc.Connection->GetConnectionInfo().GetMaxPDULength();
+  const size_t maxotherpdu = 0x10000;
+
+  // PDU framing: 1 byte type, 1 byte reserved, 4 bytes big endian length
+  size_t offset = 0;
+  while( !tc.Closing && tc.Input.size() - offset >= 6 )
+    {
+    const unsigned char *h = (const unsigned char*)&tc.Input[offset];
+    const size_t pdulen = ((size_t)h[2] << 24) | ((size_t)h[3] << 16)
+      | ((size_t)h[4] << 8) | (size_t)h[5];
+    const size_t maxlen = h[0] == 0x04 ? maxpdu : std::max( maxpdu, maxotherpdu );
+    if( maxlen && pdulen > maxlen )
+      {
+      // the input buffer never holds more than one PDU of at most maxlen bytes
+      gdcmWarningMacro( "PDU length " << pdulen << " exceeds " << maxlen << ". Aborting" );
+      ULEvent event( eAABORTRequest, PDUFactory::ConstructAbortPDU() );
+      Dispatch( tc, event );
+      tc.Closing = true;
+      break;
+      }
+    if( tc.Input.size() - offset < 6 + pdulen ) break;
+    char *begin = &tc.Input[offset];
+    HandlePDU( tc, h[0], begin, begin + 6 + pdulen );
+    offset += 6 + pdulen;
+    }
+  if( tc.Closing )
+    {
+    tc.Input.clear();
+    }
+  else if( offset )
+    {
+    tc.Input.erase( tc.Input.begin(), tc.Input.begin() + offset );
+    }
+}
+
+void ULNonBlockingTransportInternals::Read(ULTransportConnection &tc)
+{
+  char chunk[65536];
+  bool eof = false;
+  // complete PDUs are handled as soon as they are received, so that only the
+  // last (partial) one stays in the input buffer
+  while( !tc.Closing )
+    {
+    const ssize_t n = recv( tc.FD, chunk, sizeof(chunk), 0 );
+    if( n > 0 )
+      {
+      tc.Input.insert( tc.Input.end(), chunk, chunk + n );
+      ParseInput( tc );
+      continue;
+      }
+    if( n == 0 ) { eof = true; break; }
+    if( errno == EINTR ) continue;
+    if( errno != EAGAIN && errno != EWOULDBLOCK ) eof = true;
+    break;
+    }
+
+  if( eof && !tc.Closing )
+    {
+    ULEvent event( eTransportConnectionClosed, nullptr );
+    Dispatch( tc, event );
+    tc.Closing = true;
+    }
+}
+
+void ULNonBlockingTransportInternals::Accept()
+{
+  for(;;)
+    {
+    const int fd = accept( ListenFD, nullptr, nullptr );
+    if( fd < 0 )
+      {
+      if( errno == EINTR ) continue;
+      break; // EAGAIN: no more pending connection
+      }
+    SetNonBlocking( fd );
+    SetNoDelay( fd );
+    ULConnectionInfo info;
+    info.SetMaxPDULength( MaxPDULength );
+    ULConnection *c = new ULConnection( info );
+    ULTransportConnection *tc = AddConnection( fd, c );
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = fd;
+    epoll_ctl( EpollFD, EPOLL_CTL_ADD, fd, &ev );
+
+    ULEvent event( eTransportConnIndicLocal, nullptr );
+    Dispatch( *tc, event );
+    }
+}
+
+void ULNonBlockingTransportInternals::Close(ULTransportConnection *tc)
+{
+  // no longer found by Abort & co, should the callback call them
+  Connections.erase( tc->FD );
+  if( Callback ) Callback->HandleClose( *tc->Connection );
+  epoll_ctl( EpollFD, EPOLL_CTL_DEL, tc->FD, nullptr );
+  close( tc->FD );
+  tc->Connection->SetBufferedProtocol( nullptr );
+  delete tc->Connection;
+  delete tc;
+}
+
+void ULNonBlockingTransportInternals::CheckTimers()
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::map<int, ULTransportConnection*>::iterator it = Connections.begin();
+  for( ; it != Connections.end(); ++it )
+    {
+    ULTransportConnection &tc = *it->second;
+    const EStateID state = tc.Connection->GetState();
+    const double elapsed =
+      std::chrono::duration<double>( now - tc.StateTime ).count();
+    if( elapsed <= Timeout ) continue;
+    if( state == eSta2Open || state == eSta13AwaitingClose )
+      {
+      // ARTIM timer
+      ULEvent event( eARTIMTimerExpired, nullptr );
+      Dispatch( tc, event );
+      tc.Closing = true;
+      }
+    else if( tc.Connecting || state == eSta5WaitRemoteAssoc )
+      {
+      gdcmWarningMacro( "Timeout while establishing association" );
+      tc.Closing = true;
+      }
+    }
+}
+#endif
+
+ULNonBlockingTransport::ULNonBlockingTransport()
+{
+  Internals = new ULNonBlockingTransportInternals;
+  Internals->Owner = this;
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  Internals->EpollFD = epoll_create1( 0 );
+#endif
+}
+
+ULNonBlockingTransport::~ULNonBlockingTransport()
+{
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  while( !Internals->Connections.empty() )
+    {
+    Internals->Close( Internals->Connections.begin()->second );
+    }
+  if( Internals->ListenFD >= 0 ) close( Internals->ListenFD );
+  if( Internals->EpollFD >= 0 ) close( Internals->EpollFD );
+#endif
+  delete Internals;
+}
+
+bool ULNonBlockingTransport::IsSupported()
+{
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ULNonBlockingTransport::SetCallback(ULTransportCallback *callback)
+{
+  Internals->Callback = callback;
+}
+
+void ULNonBlockingTransport::SetTimeout(double t)
+{
+  Internals->Timeout = t;
+}
+
+double ULNonBlockingTransport::GetTimeout() const
+{
+  return Internals->Timeout;
+}
+
+void ULNonBlockingTransport::SetMaxPDULength(uint32_t length)
+{
+  Internals->MaxPDULength = length;
+}
+
+uint32_t ULNonBlockingTransport::GetMaxPDULength() const
+{
+  return Internals->MaxPDULength;
+}
+
+bool ULNonBlockingTransport::Listen(uint16_t inPort)
+{
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  if( Internals->EpollFD < 0 || Internals->ListenFD >= 0 ) return false;
+  const int fd = socket( AF_INET, SOCK_STREAM, 0 );
+  if( fd < 0 ) return false;
+  int val = 1;
+  setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val) );
+  struct sockaddr_in addr;
+  memset( &addr, 0, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_ANY );
+  addr.sin_port = htons( inPort );
+  if( bind( fd, (struct sockaddr*)&addr, sizeof(addr) ) != 0
+    || listen( fd, SOMAXCONN ) != 0 || !SetNonBlocking( fd ) )
+    {
+    gdcmErrorMacro( "Could not listen on port " << inPort << ": " << strerror(errno) );
+    close( fd );
+    return false;
+    }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  epoll_ctl( Internals->EpollFD, EPOLL_CTL_ADD, fd, &ev );
+  Internals->ListenFD = fd;
+  return true;
+#else
+  (void)inPort;
+  gdcmErrorMacro( "Non-blocking transport is not supported on this platform" );
+  return false;
+#endif
+}
+
+ULConnection *ULNonBlockingTransport::Connect(const std::string& inAETitle,
+  const std::string& inConnectAETitle,
+  const std::string& inComputerName, uint16_t inConnectPort,
+  std::vector<PresentationContext> const & pcVector)
+{
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  if( Internals->EpollFD < 0 ) return nullptr;
+  if( inAETitle.size() > 16 || inConnectAETitle.size() > 16 ) return nullptr;
+  UserInformation userInfo;
+  ULConnectionInfo connectInfo;
+  if( !connectInfo.Initialize(userInfo, inConnectAETitle.c_str(),
+      inAETitle.c_str(), 0, inConnectPort, inComputerName) )
+    {
+    return nullptr;
+    }
+  connectInfo.SetMaxPDULength( Internals->MaxPDULength );
+
+  // name resolution is still a blocking call
+  struct addrinfo hints;
+  memset( &hints, 0, sizeof(hints) );
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *res = nullptr;
+  char port[8];
+  snprintf( port, sizeof(port), "%u", (unsigned int)inConnectPort );
+  if( getaddrinfo( inComputerName.c_str(), port, &hints, &res ) != 0 || !res )
+    {
+    gdcmErrorMacro( "Could not resolve: " << inComputerName );
+    return nullptr;
+    }
+  const int fd = socket( res->ai_family, res->ai_socktype, res->ai_protocol );
+  if( fd < 0 || !SetNonBlocking( fd ) )
+    {
+    if( fd >= 0 ) close( fd );
+    freeaddrinfo( res );
+    return nullptr;
+    }
+  SetNoDelay( fd );
+  const int ret = connect( fd, res->ai_addr, res->ai_addrlen );
+  freeaddrinfo( res );
+  if( ret != 0 && errno != EINPROGRESS )
+    {
+    gdcmErrorMacro( "Could not connect to " << inComputerName << ":"
+      << inConnectPort << ": " << strerror(errno) );
+    close( fd );
+    return nullptr;
+    }
+
+  ULConnection *c = new ULConnection( connectInfo );
+  c->SetPresentationContexts( pcVector );
+  ULTransportConnection *tc = Internals->AddConnection( fd, c );
+  tc->Connecting = true;
+  tc->WantWrite = true;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+  ev.data.fd = fd;
+  epoll_ctl( Internals->EpollFD, EPOLL_CTL_ADD, fd, &ev );
+  return c;
+#else
+  (void)inAETitle; (void)inConnectAETitle; (void)inComputerName;
+  (void)inConnectPort; (void)pcVector;
+  gdcmErrorMacro( "Non-blocking transport is not supported on this platform" );
+  return nullptr;
+#endif
+}
+
+bool ULNonBlockingTransport::Send(ULConnection &inConnection,
+  std::vector<BasePDU*> const & inPDUs)
+{
+  ULEvent event( ePDATArequest, inPDUs ); // takes ownership
+  ULTransportConnection *tc = Internals->Find( inConnection );
+  if( !tc || inConnection.GetState() != eSta6TransferReady ) return false;
+  Internals->Dispatch( *tc, event );
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  return Internals->Flush( *tc );
+#else
+  return false;
+#endif
+}
+
+bool ULNonBlockingTransport::Release(ULConnection &inConnection)
+{
+  ULTransportConnection *tc = Internals->Find( inConnection );
+  if( !tc || inConnection.GetState() != eSta6TransferReady ) return false;
+  ULEvent event( eARELEASERequest, PDUFactory::ConstructReleasePDU() );
+  Internals->Dispatch( *tc, event );
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  return Internals->Flush( *tc );
+#else
+  return false;
+#endif
+}
+
+void ULNonBlockingTransport::Abort(ULConnection &inConnection)
+{
+  ULTransportConnection *tc = Internals->Find( inConnection );
+  if( !tc ) return;
+  ULEvent event( eAABORTRequest, PDUFactory::ConstructAbortPDU() );
+  Internals->Dispatch( *tc, event );
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  // best effort: the A-ABORT PDU is only sent if the socket can take it now
+  Internals->Flush( *tc );
+  if( Internals->InProcessEvents )
+    {
+    // called from a callback, the connection is still in use up the stack:
+    // ProcessEvents closes it before returning
+    tc->Closing = true;
+    }
+  else
+    {
+    Internals->Close( tc );
+    }
+#endif
+}
+
+int ULNonBlockingTransport::ProcessEvents(int inTimeout)
+{
+#if defined(GDCM_HAVE_SYS_EPOLL_H)
+  if( Internals->EpollFD < 0 ) return -1;
+  // wake up at least every second to honor the ARTIM timer
+  const int timeout = Internals->Connections.empty() ? inTimeout
+    : (inTimeout < 0 || inTimeout > 1000 ? 1000 : inTimeout);
+  struct epoll_event events[64];
+  const int n = epoll_wait( Internals->EpollFD, events, 64, timeout );
+  if( n < 0 )
+    {
+    return errno == EINTR ? 0 : -1;
+    }
+  struct InProcessEventsGuard
+  {
+    bool &Flag;
+    const bool Previous;
+    explicit InProcessEventsGuard(bool &flag):Flag(flag),Previous(flag) { Flag = true; }
+    ~InProcessEventsGuard() { Flag = Previous; }
+  } guard( Internals->InProcessEvents );
+  for( int i = 0; i < n; ++i )
+    {
+    const int fd = events[i].data.fd;
+    if( fd == Internals->ListenFD )
+      {
+      Internals->Accept();
+      continue;
+      }
+    std::map<int, ULTransportConnection*>::iterator it = Internals->Connections.find( fd );
+    if( it == Internals->Connections.end() ) continue;
+    ULTransportConnection &tc = *it->second;
+    if( tc.Connecting && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) )
+      {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt( fd, SOL_SOCKET, SO_ERROR, &err, &len );
+      tc.Connecting = false;
+      if( err != 0 )
+        {
+        gdcmWarningMacro( "Connection failed: " << strerror(err) );
+        tc.Closing = true;
+        }
+      else
+        {
+        // equivalent of AE-1 once the transport is up: send A-ASSOCIATE-RQ
+        tc.Connection->SetState( eSta4LocalAssocDone );
+        ULEvent event( eTransportConnConfirmLocal, nullptr );
+        Internals->Dispatch( tc, event );
+        }
+      }
+    if( !tc.Closing && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) )
+      {
+      Internals->Read( tc );
+      }
+    if( !Internals->Flush( tc ) )
+      {
+      tc.Closing = true;
+      }
+    }
+  Internals->CheckTimers();
+
+  // reap connections: either the state machine went back to idle, or the
+  // association was released / aborted and the last PDU is on the wire.
+  std::vector<ULTransportConnection*> toclose;
+  std::map<int, ULTransportConnection*>::iterator it = Internals->Connections.begin();
+  for( ; it != Internals->Connections.end(); ++it )
+    {
+    ULTransportConnection *tc = it->second;
+    const bool drained = tc->Buffer.GetPendingSize() == 0;
+    if( tc->Closing
+      || (drained && tc->Connection->GetState() == eSta13AwaitingClose) )
+      {
+      toclose.push_back( tc );
+      }
+    }
+  for( size_t i = 0; i < toclose.size(); ++i )
+    {
+    Internals->Flush( *toclose[i] );
+    Internals->Close( toclose[i] );
+    }
+  return n;
+#else
+  (void)inTimeout;
+  return -1;
+#endif
+}
+
+size_t ULNonBlockingTransport::GetNumberOfConnections() const
+{
+  return Internals->Connections.size();
+}
+
+size_t ULNonBlockingTransport::GetNumberOfPendingBytes(ULConnection const &inConnection) const
+{
+  ULTransportConnection *tc = Internals->Find( inConnection );
+  return tc ? tc->Buffer.GetPendingSize() : 0;
+}
+
+} // end namespace network
+} // end namespace gdcm
@@ -0,0 +1,144 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef GDCMULNONBLOCKINGTRANSPORT_H
+#define GDCMULNONBLOCKINGTRANSPORT_H
+
+#include "gdcmSubject.h"
+#include "gdcmPresentationContext.h"
+#include "gdcmNetworkStateID.h"
+
+#include <vector>
+
+namespace gdcm
+{
+class DataSet;
+namespace network
+{
+class BasePDU;
+class ULConnection;
+class ULNonBlockingTransportInternals;
+
+/**
+ * \brief ULTransportCallback
+ * \details Notifications sent by the ULNonBlockingTransport while it services
+ * its connections. All calls happen from within ProcessEvents, on the thread
+ * running the event loop.
+ */
+class GDCM_EXPORT ULTransportCallback
+{
+public:
+  virtual ~ULTransportCallback() = default;
+  /// called once the association on inConnection reached eSta6TransferReady
+  virtual void HandleAssociation(ULConnection &) {}
+  /// called for every complete DIMSE message (command set, and data set when
+  /// one is present; it is empty otherwise)
+  virtual void HandleMessage(ULConnection &inConnection,
+    const DataSet &inCommand, const DataSet &inDataSet) = 0;
+  /// called right before the transport connection is closed and inConnection
+  /// is destroyed
+  virtual void HandleClose(ULConnection &) {}
+};
+
+/**
+ * \brief ULNonBlockingTransport
+ * \details Non-blocking alternative to the socket++ iostream used by
+ * ULConnectionManager. Sockets are put in non-blocking mode and multiplexed
+ * with epoll (Linux only), so a single thread can service many associations.
+ *
+ * Each connection gets an explicit read buffer and write buffer. Bytes are
+ * only handed to the ULTransitionTable once a complete PDU has been received,
+ * and every PDU written by a ULAction is queued in the write buffer and
+ * flushed when the socket becomes writable. The state machine itself is the
+ * very same one (ULEvent / ULAction*) as the one used in blocking mode.
+ *
+ * Typical SCP usage:
+ * \code
+ * ULNonBlockingTransport t;
+ * t.SetCallback( &mycallback );
+ * t.Listen( 11112 );
+ * while( running ) t.ProcessEvents( 100 );
+ * \endcode
+ *
+ * \warning this class is not thread safe, ProcessEvents/Send/Release must all
+ * be called from the same thread.
+ */
+class GDCM_EXPORT ULNonBlockingTransport : public Subject
+{
+public:
+  ULNonBlockingTransport();
+  ~ULNonBlockingTransport() override;
+  ULNonBlockingTransport(const ULNonBlockingTransport&) = delete;
+  void operator=(const ULNonBlockingTransport&) = delete;
+
+  /// Return whether this platform supports the non-blocking transport
+  static bool IsSupported();
+
+  /// Set the callback for incoming messages (not owned)
+  void SetCallback(ULTransportCallback *callback);
+
+  /// set/get Timeout (in seconds) used for the ARTIM timer of new connections
+  void SetTimeout(double t);
+  double GetTimeout() const;
+
+  /// set/get the maximum length of the PDUs accepted on new connections
+  /// (0 means no limit, default is 16384)
+  void SetMaxPDULength(uint32_t length);
+  uint32_t GetMaxPDULength() const;
+
+  /// Start accepting incoming associations on inPort (SCP side).
+  /// Return false upon error.
+  bool Listen(uint16_t inPort);
+
+  /// Start an outgoing association (SCU side). The TCP connection and the
+  /// A-ASSOCIATE negotiation both progress from ProcessEvents. The returned
+  /// connection is owned by the transport, NULL is returned upon error.
+  ULConnection *Connect(const std::string& inAETitle,
+    const std::string& inConnectAETitle,
+    const std::string& inComputerName, uint16_t inConnectPort,
+    std::vector<PresentationContext> const & pcVector);
+
+  /// Queue P-DATA-TF PDUs (as generated by PDUFactory) on an established
+  /// association. The transport takes ownership of the PDUs.
+  bool Send(ULConnection &inConnection, std::vector<BasePDU*> const & inPDUs);
+
+  /// Request an orderly release of the association (A-RELEASE-RQ)
+  bool Release(ULConnection &inConnection);
+
+  /// Abort the association (A-ABORT) and close the transport connection.
+  /// When called from a callback, the connection is closed once it returned
+  void Abort(ULConnection &inConnection);
+
+  /// Wait at most inTimeout milliseconds (-1 means forever) for socket
+  /// activity and process it. Return the number of sockets serviced, or -1
+  /// upon error.
+  int ProcessEvents(int inTimeout);
+
+  /// Number of currently open connections (listening socket excluded)
+  size_t GetNumberOfConnections() const;
+
+  /// Number of bytes waiting to be written on inConnection
+  size_t GetNumberOfPendingBytes(ULConnection const &inConnection) const;
+
+private:
+  ULNonBlockingTransportInternals *Internals;
+};
+
+} // end namespace network
+} // end namespace gdcm
+
+#endif // GDCMULNONBLOCKINGTRANSPORT_H
@@ -317,6 +317,17 @@ void UserInformation::AddRoleSelectionSub( RoleSelectionSub const & rss )
   assert( (size_t)ItemLength + 4 == Size() );
 }
 
+size_t UserInformation::GetNumberOfRoleSelectionSubs() const
+{
+  return RSSI->RSSArray.size();
+}
+
+RoleSelectionSub const &UserInformation::GetRoleSelectionSub( size_t i ) const
+{
+  assert( i < RSSI->RSSArray.size() );
+  return RSSI->RSSArray[i];
+}
+
 void UserInformation::AddSOPClassExtendedNegociationSub( SOPClassExtendedNegociationSub const & sopcens )
 {
   SOPCENSI->SOPCENSArray.push_back( sopcens );
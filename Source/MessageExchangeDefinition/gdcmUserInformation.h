@@ -55,6 +55,8 @@ public:
   MaximumLengthSub &GetMaximumLengthSub() { return MLS; }
 
   void AddRoleSelectionSub( RoleSelectionSub const & r );
+  size_t GetNumberOfRoleSelectionSubs() const;
+  RoleSelectionSub const &GetRoleSelectionSub( size_t i ) const;
   void AddSOPClassExtendedNegociationSub( SOPClassExtendedNegociationSub const & s );
 
 private:
@@ -0,0 +1,151 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmASCIINumber.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+int TestParseDouble(const char *s, double expected, size_t consumed)
+{
+  double v;
+  const char *end = s + strlen(s);
+  const char *p = gdcm::ASCIINumber::Parse(s, end, v);
+  if( !p || v != expected || (size_t)(p - s) != consumed )
+    {
+    std::cerr << "Parse(\"" << s << "\") = " << v << " instead of " << expected << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+int TestFormat(double v, const char *expected)
+{
+  char buf[16+1];
+  const unsigned int len = gdcm::ASCIINumber::FormatDS(v, buf);
+  if( len != strlen(buf) || strcmp(buf, expected) != 0 )
+    {
+    std::cerr << "FormatDS(" << v << ") = " << buf << " instead of " << expected << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+// Every value which has a 16 characters representation must read back exactly
+int TestRoundTrip(double v)
+{
+  char buf[16+1];
+  const unsigned int len = gdcm::ASCIINumber::FormatDS(v, buf);
+  double check;
+  if( len > 16 || !gdcm::ASCIINumber::Parse(buf, buf + len, check)
+    || check != v || strtod(buf, nullptr) != v )
+    {
+    std::cerr << "No round trip for " << v << ": " << buf << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestASCIINumber(int , char *[])
+{
+  int ret = 0;
+  ret += TestParseDouble("0.5", 0.5, 3);
+  ret += TestParseDouble("  -1.25\\3", -1.25, 7);
+  ret += TestParseDouble(".5 ", 0.5, 2);
+  ret += TestParseDouble("+2.", 2., 3);
+  ret += TestParseDouble("1e-5", 1e-5, 4);
+  ret += TestParseDouble("1E3", 1e3, 3);
+  ret += TestParseDouble("3e", 3., 1);
+  ret += TestParseDouble("0.1000000000000000055511151231257827", 0.1, 36);
+  ret += TestParseDouble("12345678901234567890123", 12345678901234567890123., 23);
+  ret += TestParseDouble("2.2250738585072014e-308", 2.2250738585072014e-308, 23);
+  // Correctly rounded, even out of the fast path:
+  const char *hard[] = { "9007199254740993", "0.30000000000000004",
+    "1.7976931348623157e308", "4.9406564584124654e-324", "123456.7890123456e-20" };
+  for( size_t i = 0; i < sizeof(hard) / sizeof(*hard); ++i )
+    ret += TestParseDouble(hard[i], strtod(hard[i], nullptr), strlen(hard[i]));
+
+  double d;
+  const char invalid[] = " \\1";
+  if( gdcm::ASCIINumber::Parse(invalid, invalid + 3, d) || d != 0 )
+    {
+    std::cerr << "Parsed an invalid number" << std::endl;
+    ++ret;
+    }
+  // The end of the buffer is honored (no terminating null character needed)
+  const char truncated[] = "12345";
+  if( !gdcm::ASCIINumber::Parse(truncated, truncated + 2, d) || d != 12 )
+    {
+    std::cerr << "Read past the end: " << d << std::endl;
+    ++ret;
+    }
+
+  long long l;
+  const char big[] = "-99999999999999999999";
+  if( gdcm::ASCIINumber::Parse(big, big + strlen(big), l) != big + strlen(big)
+    || l != std::numeric_limits<long long>::min() )
+    {
+    std::cerr << "Wrong overflow: " << l << std::endl;
+    ++ret;
+    }
+  const char is[] = " +512\\-3";
+  const char *p = gdcm::ASCIINumber::Parse(is, is + strlen(is), l);
+  if( !p || *p != '\\' || l != 512 )
+    {
+    std::cerr << "Wrong IS: " << l << std::endl;
+    ++ret;
+    }
+  unsigned long long ul;
+  if( !gdcm::ASCIINumber::Parse(p + 1, is + strlen(is), ul) || ul != (unsigned long long)-3 )
+    {
+    std::cerr << "Wrong unsigned: " << ul << std::endl;
+    ++ret;
+    }
+
+  // Shortest representation, same layout as before
+  ret += TestFormat(0., "0");
+  ret += TestFormat(1., "1");
+  ret += TestFormat(0.5, ".5");
+  ret += TestFormat(-0.5, "-.5");
+  ret += TestFormat(0.1, ".1");
+  ret += TestFormat(1e-5, "1e-5");
+  ret += TestFormat(0.001, ".001");
+  ret += TestFormat(2.5, "2.5");
+  ret += TestFormat(-1234.5678, "-1234.5678");
+  ret += TestFormat(1e20, "1e20");
+  // Too many digits: rounded to 16 characters
+  ret += TestFormat(0.1 + 0.2, ".3");
+  ret += TestFormat(1. / 3., ".333333333333333");
+  ret += TestFormat(-1. / 3., "-.33333333333333");
+
+  const double values[] = { 0.1, 1. / 1024, 3.14159, 2.71828182845904, 1e300,
+    -1e-300, 12345678901234., 123456789012345., 0.000123456789, 4.9e-324 };
+  for( size_t i = 0; i < sizeof(values) / sizeof(*values); ++i )
+    ret += TestRoundTrip(values[i]);
+
+  char buf[21];
+  if( gdcm::ASCIINumber::Format(std::numeric_limits<long long>::min(), buf) != 20
+    || strcmp(buf, "-9223372036854775808") != 0
+    || gdcm::ASCIINumber::Format(0, buf) != 1 || strcmp(buf, "0") != 0 )
+    {
+    std::cerr << "Wrong IS formatting: " << buf << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
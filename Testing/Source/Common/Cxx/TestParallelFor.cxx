@@ -0,0 +1,78 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmParallelFor.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+int TestParallelFor(int, char *[])
+{
+  if( gdcm::ComputeNumberOfThreads( 0, 0 ) != 1
+    || gdcm::ComputeNumberOfThreads( 8, 3 ) != 3
+    || gdcm::ComputeNumberOfThreads( 2, 100 ) != 2
+    || gdcm::ComputeNumberOfThreads( 0, 100 ) < 1 )
+    {
+    std::cerr << "Wrong number of threads" << std::endl;
+    return 1;
+    }
+
+  // Each index is visited once, by one of the threads
+  const size_t n = 1000;
+  for( unsigned int nthreads = 1; nthreads <= 4; ++nthreads )
+    {
+    std::vector<unsigned int> visits( n ), threads( n );
+    const bool b = gdcm::ParallelFor( n, nthreads,
+      [&]( size_t i, unsigned int t ) {
+        ++visits[i];
+        threads[i] = t;
+        return true;
+      } );
+    for( size_t i = 0; i < n; ++i )
+      {
+      if( !b || visits[i] != 1 || threads[i] >= nthreads )
+        {
+        std::cerr << "Wrong visit of " << i << " with " << nthreads << " threads" << std::endl;
+        return 1;
+        }
+      }
+    }
+
+  // A call returning false stops the loop
+  std::vector<unsigned int> visits( n );
+  if( gdcm::ParallelFor( n, 4,
+      [&]( size_t i, unsigned int ) { ++visits[i]; return i != 10; } )
+    || !visits[10] )
+    {
+    std::cerr << "Loop not stopped" << std::endl;
+    return 1;
+    }
+
+  // An exception is rethrown in the calling thread, once all are joined
+  try
+    {
+    gdcm::ParallelFor( n, 4, []( size_t i, unsigned int ) {
+      if( i == 500 ) throw std::runtime_error( "500" );
+      return true;
+      } );
+    std::cerr << "Exception lost" << std::endl;
+    return 1;
+    }
+  catch( std::runtime_error &ex )
+    {
+    if( std::string( ex.what() ) != "500" ) return 1;
+    }
+
+  return 0;
+}
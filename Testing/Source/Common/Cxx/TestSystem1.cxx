@@ -413,6 +413,27 @@ std::cerr << "found:" << ss2 << std::endl;
   res++;
 }
 
+  // RenameFile replaces an existing destination, and keeps it on failure
+  const std::string testfilesize_str = testfilesize;
+  const std::string renamed = gdcm::Testing::GetTempFilename( "renamed.bin" );
+  {
+  std::ofstream os2( renamed.c_str(), std::ios::binary );
+  os2 << "old content";
+  }
+  if( !gdcm::System::RenameFile( testfilesize_str.c_str(), renamed.c_str() )
+    || gdcm::System::FileExists( testfilesize_str.c_str() )
+    || gdcm::System::FileSize( renamed.c_str() ) != strlen( coucou ) )
+{
+std::cerr << "could not rename:" << testfilesize_str << std::endl;
+  res++;
+}
+  if( gdcm::System::RenameFile( testfilesize_str.c_str(), renamed.c_str() )
+    || gdcm::System::FileSize( renamed.c_str() ) != strlen( coucou ) )
+{
+std::cerr << "renamed a missing file" << std::endl;
+  res++;
+}
+
 
   const char *codeset = gdcm::System::GetLocaleCharset();
 if( !codeset )
@@ -0,0 +1,159 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmDeflateStreamBuf.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmFileMetaInformation.h"
+
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+// compressible, but not trivially
+std::string MakeData(size_t len)
+{
+  std::string data( len, 0 );
+  unsigned int seed = 1;
+  for( size_t i = 0; i < len; ++i )
+    {
+    seed = seed * 1103515245 + 12345;
+    data[i] = (char)( (i % 1000 < 600) ? 'a' + (i / 1000) % 26 : (seed >> 16) & 0x0f );
+    }
+  return data;
+}
+
+int TestRoundTrip(std::string const &data, unsigned int nthreads, size_t blocksize)
+{
+  std::stringstream ss;
+  ss << "HEAD";
+  {
+  gdcm::DeflateStreamBuf buf( ss, nthreads, -1, blocksize );
+  std::ostream os( &buf );
+  // mix of single characters and large writes
+  size_t i = 0;
+  for( ; i < data.size() && i < 1000; ++i ) os.put( data[i] );
+  while( i < data.size() )
+    {
+    const size_t len = std::min( data.size() - i, (size_t)(3 * blocksize + 17) );
+    os.write( data.data() + i, len );
+    i += len;
+    }
+  if( !buf.Finish() ) return 1;
+  }
+  ss << "TAIL";
+
+  ss.seekg( 4, std::ios::beg );
+  std::string out( data.size(), 0 );
+  {
+  gdcm::InflateIStream is( ss );
+  // small then large reads
+  const size_t first = std::min( data.size(), (size_t)10 );
+  is.read( &out[0], first );
+  if( data.size() > first ) is.read( &out[first], data.size() - first );
+  if( (size_t)is.gcount() != data.size() - first && data.size() > first ) return 1;
+  // nothing after the end
+  if( is.get() != EOF ) return 1;
+  }
+  if( out != data )
+    {
+    std::cerr << "Wrong inflated data for " << data.size() << " bytes, "
+      << nthreads << " threads" << std::endl;
+    return 1;
+    }
+  // input stream is left right after the deflate stream
+  char tail[4];
+  ss.read( tail, 4 );
+  if( !ss || memcmp( tail, "TAIL", 4 ) != 0 )
+    {
+    std::cerr << "Deflate stream end not found" << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+int TestWriterReader(unsigned int nthreads)
+{
+  gdcm::Writer w;
+  gdcm::File &file = w.GetFile();
+  gdcm::DataSet &ds = file.GetDataSet();
+  gdcm::DataElement uid( gdcm::Tag(0x0008,0x0018) );
+  uid.SetVR( gdcm::VR::UI );
+  uid.SetByteValue( "1.2.3.4", 8 );
+  ds.Insert( uid );
+  gdcm::DataElement sop( gdcm::Tag(0x0008,0x0016) );
+  sop.SetVR( gdcm::VR::UI );
+  const char sopclass[] = "1.2.840.10008.5.1.4.1.1.88.11"; // Basic Text SR
+  sop.SetByteValue( sopclass, (uint32_t)strlen(sopclass) + 1 );
+  ds.Insert( sop );
+  const std::string text = MakeData( 1000000 );
+  gdcm::DataElement big( gdcm::Tag(0x0009,0x1010) );
+  big.SetVR( gdcm::VR::OB );
+  big.SetByteValue( text.data(), (uint32_t)text.size() );
+  ds.Insert( big );
+  file.GetHeader().SetDataSetTransferSyntax(
+    gdcm::TransferSyntax::DeflatedExplicitVRLittleEndian );
+
+  std::stringstream ss;
+  w.SetStream( ss );
+  w.SetNumberOfThreads( nthreads );
+  if( !w.Write() ) return 1;
+  if( ss.str().size() > text.size() / 2 ) return 1;
+
+  gdcm::Reader r;
+  r.SetStream( ss );
+  if( !r.Read() ) return 1;
+  const gdcm::DataSet &rds = r.GetFile().GetDataSet();
+  const gdcm::ByteValue *bv = rds.GetDataElement( gdcm::Tag(0x0009,0x1010) ).GetByteValue();
+  if( !bv || bv->GetLength() != text.size()
+    || memcmp( bv->GetPointer(), text.data(), text.size() ) != 0 )
+    {
+    std::cerr << "Wrong value read back with " << nthreads << " threads" << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestDeflateStreamBuf(int, char *[])
+{
+  int ret = 0;
+  const size_t sizes[] = { 0, 1, 5000, 32 * 1024, 1000000 };
+  for( size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i )
+    {
+    const std::string data = MakeData( sizes[i] );
+    ret += TestRoundTrip( data, 1, 32 * 1024 );
+    ret += TestRoundTrip( data, 4, 32 * 1024 );
+    ret += TestRoundTrip( data, 3, 100 * 1024 );
+    }
+
+  // compression ratio is not affected by the number of threads (dictionary)
+  const std::string data = MakeData( 1000000 );
+  std::stringstream s1, s4;
+  {
+  gdcm::DeflateStreamBuf b1( s1, 1, -1, 32 * 1024 );
+  gdcm::DeflateStreamBuf b4( s4, 4, -1, 32 * 1024 );
+  b1.sputn( data.data(), (std::streamsize)data.size() );
+  b4.sputn( data.data(), (std::streamsize)data.size() );
+  }
+  if( s1.str() != s4.str() )
+    {
+    std::cerr << "Output depends on the number of threads" << std::endl;
+    ++ret;
+    }
+
+  ret += TestWriterReader( 1 );
+  ret += TestWriterReader( 4 );
+  return ret;
+}
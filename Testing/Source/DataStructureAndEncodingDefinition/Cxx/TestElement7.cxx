@@ -0,0 +1,103 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmAttribute.h"
+#include "gdcmElement.h"
+
+#include <cstring>
+#include <clocale>
+
+// DS/IS values are parsed from the ByteValue, whatever the locale
+namespace
+{
+gdcm::DataElement Make(gdcm::Tag const &t, gdcm::VR const &vr, const char *value)
+{
+  gdcm::DataElement de( t );
+  de.SetVR( vr );
+  de.SetByteValue( value, (uint32_t)strlen(value) );
+  return de;
+}
+}
+
+int TestElement7(int , char *[])
+{
+  // Try a locale with a comma as decimal point, if any
+  const char *locales[] = { "fr_FR.UTF-8", "fr_FR", "de_DE.UTF-8", "de_DE" };
+  for( size_t i = 0; i < sizeof(locales) / sizeof(*locales); ++i )
+    if( setlocale( LC_NUMERIC, locales[i] ) ) break;
+
+  int ret = 0;
+  // Fixed VM
+  gdcm::Attribute<0x0020,0x0032> ipp;
+  ipp.SetFromDataElement( Make( ipp.GetTag(), gdcm::VR::DS, " -125.5\\ 0.25 \\1e-2 " ) );
+  if( ipp[0] != -125.5 || ipp[1] != 0.25 || ipp[2] != 0.01 )
+    {
+    std::cerr << "Wrong IPP: " << ipp[0] << "," << ipp[1] << "," << ipp[2] << std::endl;
+    ++ret;
+    }
+  // VM1
+  gdcm::Attribute<0x0020,0x0013> in;
+  in.SetFromDataElement( Make( in.GetTag(), gdcm::VR::IS, "  42 " ) );
+  if( in.GetValue() != 42 )
+    {
+    std::cerr << "Wrong Instance Number: " << in.GetValue() << std::endl;
+    ++ret;
+    }
+  // VM1_n: the number of values is computed from the separators
+  gdcm::Attribute<0x0028,0x1050> wc;
+  wc.SetFromDataElement( Make( wc.GetTag(), gdcm::VR::DS, "40\\-400.5\\.5 " ) );
+  if( wc.GetNumberOfValues() != 3 || wc[0] != 40 || wc[1] != -400.5 || wc[2] != 0.5 )
+    {
+    std::cerr << "Wrong Window Center: " << wc.GetNumberOfValues() << std::endl;
+    ++ret;
+    }
+  // Missing values are 0, and parsing stops there
+  gdcm::Element<gdcm::VR::DS,gdcm::VM::VM3> el;
+  const char partial[] = "1.5\\\\3";
+  el.Read( partial, strlen(partial) );
+  if( el[0] != 1.5 || el[1] != 0 )
+    {
+    std::cerr << "Wrong partial value: " << el[0] << "," << el[1] << std::endl;
+    ++ret;
+    }
+  // Binary values are simply copied
+  const float fl[2] = { 1.5f, -2.f };
+  gdcm::Element<gdcm::VR::FL,gdcm::VM::VM2> el2;
+  el2.Read( reinterpret_cast<const char*>(fl), sizeof(fl) );
+  if( el2[0] != 1.5f || el2[1] != -2.f )
+    {
+    std::cerr << "Wrong FL: " << el2[0] << "," << el2[1] << std::endl;
+    ++ret;
+    }
+
+  // Write back the shortest DS representation, with a dot (padded to even length)
+  gdcm::Attribute<0x0028,0x0030> ps = {{ 0.5, 1. / 3. }};
+  const gdcm::DataElement psde = ps.GetAsDataElement();
+  const gdcm::ByteValue *bv = psde.GetByteValue();
+  const std::string s( bv->GetPointer(), bv->GetLength() );
+  if( s != ".5\\.333333333333333 " )
+    {
+    std::cerr << "Wrong Pixel Spacing: " << s << std::endl;
+    ++ret;
+    }
+  gdcm::Attribute<0x0028,0x0030> ps2;
+  ps2.SetFromDataElement( psde );
+  if( ps2[0] != 0.5 )
+    {
+    std::cerr << "No round trip: " << ps2[0] << std::endl;
+    ++ret;
+    }
+
+  setlocale( LC_NUMERIC, "C" );
+  return ret;
+}
@@ -0,0 +1,149 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFilePrefetcher.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+const gdcm::Tag BigTag(0x0009,0x1010);
+
+std::string MakeValue(size_t i)
+{
+  // from a few bytes to well above the prefetch size
+  std::string value( 10 + i * i * 5000, 0 );
+  for( size_t j = 0; j < value.size(); ++j )
+    value[j] = (char)( 'a' + (i + j) % 26 );
+  return value;
+}
+
+bool WriteFile(const std::string &filename, std::string const &value)
+{
+  gdcm::Writer w;
+  gdcm::DataSet &ds = w.GetFile().GetDataSet();
+  gdcm::DataElement uid( gdcm::Tag(0x0008,0x0018) );
+  uid.SetVR( gdcm::VR::UI );
+  uid.SetByteValue( "1.2.3.4", 8 );
+  ds.Insert( uid );
+  gdcm::DataElement sop( gdcm::Tag(0x0008,0x0016) );
+  sop.SetVR( gdcm::VR::UI );
+  const char sopclass[] = "1.2.840.10008.5.1.4.1.1.88.11"; // Basic Text SR
+  sop.SetByteValue( sopclass, (uint32_t)strlen(sopclass) + 1 );
+  ds.Insert( sop );
+  gdcm::DataElement big( BigTag );
+  big.SetVR( gdcm::VR::OB );
+  big.SetByteValue( value.data(), (uint32_t)value.size() );
+  ds.Insert( big );
+  w.GetFile().GetHeader().SetDataSetTransferSyntax(
+    gdcm::TransferSyntax::ExplicitVRLittleEndian );
+  w.SetFileName( filename.c_str() );
+  return w.Write();
+}
+
+int CheckFile(gdcm::FilePrefetcher &prefetcher, size_t i)
+{
+  gdcm::Reader reader;
+  reader.SetStream( prefetcher.GetStream( i ) );
+  if( !reader.Read() )
+    {
+    std::cerr << "Could not read file " << i << std::endl;
+    return 1;
+    }
+  const std::string value = MakeValue( i );
+  const gdcm::ByteValue *bv =
+    reader.GetFile().GetDataSet().GetDataElement( BigTag ).GetByteValue();
+  if( !bv || bv->GetLength() != value.size()
+    || memcmp( bv->GetPointer(), value.data(), value.size() ) != 0 )
+    {
+    std::cerr << "Wrong value for file " << i << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestFilePrefetcher(int, char *[])
+{
+  const char subdir[] = "TestFilePrefetcher";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  std::vector<std::string> filenames;
+  const size_t nfiles = 12;
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    std::ostringstream os;
+    os << tmpdir << "/file" << i << ".dcm";
+    filenames.push_back( os.str() );
+    if( !WriteFile( filenames.back(), MakeValue( i ) ) ) return 1;
+    }
+
+  int ret = 0;
+  gdcm::FilePrefetcher prefetcher;
+  // most files do not fit: the end is read from the file itself
+  prefetcher.SetPrefetchSize( 100000 );
+  prefetcher.SetReadAhead( 3 );
+  prefetcher.SetFileNames( filenames );
+  for( size_t i = 0; i < nfiles; ++i )
+    ret += CheckFile( prefetcher, i );
+
+  // out of order, and with a file list which is set again
+  prefetcher.SetReadAhead( 0 );
+  prefetcher.SetFileNames( filenames );
+  ret += CheckFile( prefetcher, 5 );
+  ret += CheckFile( prefetcher, 2 );
+  ret += CheckFile( prefetcher, 11 );
+
+  // seeking around the prefetched bytes
+  prefetcher.SetReadAhead( 2 );
+  prefetcher.SetPrefetchSize( 1000 );
+  prefetcher.SetFileNames( filenames );
+  std::istream &is = prefetcher.GetStream( 3 );
+  is.seekg( 0, std::ios::end );
+  const std::streamoff size = is.tellg();
+  if( size != (std::streamoff)gdcm::System::FileSize( filenames[3].c_str() ) ) ++ret;
+  char c1, c2;
+  is.seekg( 1500, std::ios::beg );
+  is.get( c1 );
+  is.seekg( -1001, std::ios::cur );
+  is.get( c2 );
+  std::ifstream ref( filenames[3].c_str(), std::ios::binary );
+  char r1, r2;
+  ref.seekg( 1500 );
+  ref.get( r1 );
+  ref.seekg( 500 );
+  ref.get( r2 );
+  if( !is || c1 != r1 || c2 != r2 )
+    {
+    std::cerr << "Wrong seek" << std::endl;
+    ++ret;
+    }
+
+  // missing file
+  std::vector<std::string> missing( 1, tmpdir + "/missing.dcm" );
+  prefetcher.SetFileNames( missing );
+  gdcm::Reader reader;
+  reader.SetStream( prefetcher.GetStream( 0 ) );
+  if( reader.Read() ) ++ret;
+
+  return ret;
+}
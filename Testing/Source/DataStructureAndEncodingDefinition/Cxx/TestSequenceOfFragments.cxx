@@ -13,10 +13,37 @@
 =========================================================================*/
 #include "gdcmSequenceOfFragments.h"
 
+#include <cstring>
+
 int TestSequenceOfFragments(int, char *[])
 {
   gdcm::SequenceOfFragments sf;
   std::cout << sf << std::endl;
 
+  // one fragment per frame
+  const char buffer[] = "0123456789";
+  for( uint32_t i = 1; i <= 4; ++i )
+    {
+    gdcm::Fragment frag;
+    frag.SetByteValue( buffer, 2 * i );
+    sf.AddFragment( frag );
+    }
+  if( !sf.FillBasicOffsetTable() ) return 1;
+  const gdcm::ByteValue *bv = sf.GetTable().GetByteValue();
+  if( !bv || bv->GetLength() != 4 * sizeof(uint32_t) ) return 1;
+  uint32_t table[4];
+  memcpy( table, bv->GetPointer(), sizeof(table) );
+  const uint32_t reftable[] = { 0, 10, 22, 36 };
+  if( memcmp( table, reftable, sizeof(table) ) != 0 ) return 1;
+
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> lengths;
+  sf.ComputeFragmentOffsets( offsets, lengths );
+  if( offsets.size() != 4 || lengths.size() != 4 ) return 1;
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    if( offsets[i] != reftable[i] || lengths[i] != 2 * (i + 1) ) return 1;
+    }
+
   return 0;
 }
@@ -0,0 +1,206 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmSequenceOfItems.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmExplicitDataElement.h"
+
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+gdcm::DataElement MakeElement(gdcm::Tag const &t, gdcm::VR const &vr,
+  const char *value, size_t len)
+{
+  gdcm::DataElement de( t );
+  de.SetVR( vr );
+  de.SetByteValue( value, (uint32_t)len );
+  return de;
+}
+
+gdcm::DataElement MakeElement(gdcm::Tag const &t, gdcm::VR const &vr,
+  const char *value)
+{
+  return MakeElement( t, vr, value, strlen(value) );
+}
+
+gdcm::DataElement MakeBinary(gdcm::Tag const &t, gdcm::VR const &vr, size_t len)
+{
+  std::vector<char> value( len );
+  for( size_t i = 0; i < len; ++i ) value[i] = (char)(i * 7 + i / 256);
+  return MakeElement( t, vr, &value[0], len );
+}
+
+// A sequence with `nitems` items, each one holding a nested sequence when
+// depth > 0. Lengths alternate between defined and undefined.
+gdcm::DataElement MakeSequence(gdcm::Tag const &t, unsigned int depth,
+  size_t nitems, bool defined)
+{
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sq = new gdcm::SequenceOfItems;
+  for( size_t i = 0; i < nitems; ++i )
+    {
+    gdcm::Item item;
+    if( (i + depth) % 2 ) item.SetVLToUndefined();
+    else item.SetVL( 0 );
+    gdcm::DataSet &nds = item.GetNestedDataSet();
+    std::ostringstream os;
+    os << "item " << depth << "/" << i;
+    nds.Insert( MakeElement( gdcm::Tag(0x0008,0x0104), gdcm::VR::LO, os.str().c_str() ) );
+    const uint16_t us[] = { 1, 2, (uint16_t)i };
+    nds.Insert( MakeElement( gdcm::Tag(0x0028,0x0010), gdcm::VR::US, (const char*)us, sizeof(us) ) );
+    if( depth > 0 )
+      nds.Insert( MakeSequence( gdcm::Tag(0x0040,0xa730), depth - 1, 2, !defined ) );
+    sq->AddItem( item );
+    }
+  gdcm::DataElement de( t );
+  de.SetVR( gdcm::VR::SQ );
+  de.SetValue( *sq );
+  if( defined )
+    {
+    sq->SetLength( 0 ); // no Sequence Delimitation Item
+    const gdcm::VL len = sq->ComputeLength<gdcm::ExplicitDataElement>();
+    sq->SetLength( len );
+    de.SetVL( len );
+    }
+  else
+    {
+    de.SetVLToUndefined();
+    }
+  return de;
+}
+
+void MakeDataSet(gdcm::DataSet &ds, bool encapsulated)
+{
+  ds.Insert( MakeElement( gdcm::Tag(0x0008,0x0016), gdcm::VR::UI,
+      "1.2.840.10008.5.1.4.1.1.7" ) );
+  ds.Insert( MakeElement( gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, "1.2.3.4.5" ) );
+  ds.Insert( MakeElement( gdcm::Tag(0x0010,0x0010), gdcm::VR::PN, "Doe^John" ) );
+  ds.Insert( MakeElement( gdcm::Tag(0x0008,0x1030), gdcm::VR::LO, "odd" ) );
+  const double fd[] = { 1.5, -2.25, 3.125 };
+  ds.Insert( MakeElement( gdcm::Tag(0x0018,0x9089), gdcm::VR::FD, (const char*)fd, sizeof(fd) ) );
+  const uint16_t at[] = { 0x0020, 0x9157, 0x0028, 0x0010 };
+  ds.Insert( MakeElement( gdcm::Tag(0x0020,0x9165), gdcm::VR::AT, (const char*)at, sizeof(at) ) );
+  const uint32_t ul = 1234567;
+  ds.Insert( MakeElement( gdcm::Tag(0x0019,0x0000), gdcm::VR::UL, (const char*)&ul, sizeof(ul) ) );
+  // private: creator, binary values written as is or swapped, large enough
+  // to be written directly
+  ds.Insert( MakeElement( gdcm::Tag(0x0009,0x0010), gdcm::VR::LO, "ACME" ) );
+  ds.Insert( MakeBinary( gdcm::Tag(0x0009,0x1001), gdcm::VR::UN, 10 ) );
+  ds.Insert( MakeBinary( gdcm::Tag(0x0009,0x1003), gdcm::VR::OB, 100000 ) );
+  ds.Insert( MakeBinary( gdcm::Tag(0x0009,0x1004), gdcm::VR::OW, 70000 ) );
+  ds.Insert( MakeBinary( gdcm::Tag(0x0009,0x1005), gdcm::VR::FD, 160000 ) );
+  // UN holding a defined length sequence: written as SQ, undefined length
+  gdcm::DataElement unsq = MakeSequence( gdcm::Tag(0x0009,0x1006), 1, 2, true );
+  unsq.SetVR( gdcm::VR::UN );
+  ds.Insert( unsq );
+  // no VR: written as UN in explicit
+  gdcm::DataElement invalid( gdcm::Tag(0x0011,0x1010) );
+  invalid.SetByteValue( "abcd", 4 );
+  ds.Insert( invalid );
+  // empty elements
+  gdcm::DataElement empty( gdcm::Tag(0x0020,0x0011) );
+  empty.SetVR( gdcm::VR::IS );
+  ds.Insert( empty );
+  ds.Insert( MakeElement( gdcm::Tag(0x0010,0x0020), gdcm::VR::LO, "" ) );
+  // nested sequences
+  ds.Insert( MakeSequence( gdcm::Tag(0x0028,0x9110), 3, 3, false ) );
+  ds.Insert( MakeSequence( gdcm::Tag(0x0054,0x0016), 2, 2, true ) );
+  ds.Insert( MakeSequence( gdcm::Tag(0x0040,0x0275), 0, 0, false ) );
+  if( encapsulated )
+    {
+    gdcm::SmartPointer<gdcm::SequenceOfFragments> sf = new gdcm::SequenceOfFragments;
+    for( size_t i = 0; i < 2; ++i )
+      {
+      gdcm::Fragment frag;
+      std::vector<char> bytes( i ? 100000 : 999, (char)i );
+      frag.SetByteValue( &bytes[0], (uint32_t)bytes.size() );
+      sf->AddFragment( frag );
+      }
+    gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+    pixeldata.SetVR( gdcm::VR::OB );
+    pixeldata.SetValue( *sf );
+    ds.Insert( pixeldata );
+    }
+}
+
+bool Write(gdcm::DataSet const &ds, gdcm::TransferSyntax::TSType ts,
+  bool fastwrite, std::string &out)
+{
+  gdcm::Writer w;
+  w.GetFile().SetDataSet( ds );
+  w.GetFile().GetHeader().SetDataSetTransferSyntax( ts );
+  w.SetFastWrite( fastwrite );
+  std::stringstream ss;
+  w.SetStream( ss );
+  if( !w.Write() ) return false;
+  out = ss.str();
+  return true;
+}
+}
+
+int TestWriter3(int, char *[])
+{
+  const gdcm::TransferSyntax::TSType tss[] = {
+    gdcm::TransferSyntax::ExplicitVRLittleEndian,
+    gdcm::TransferSyntax::ImplicitVRLittleEndian,
+    gdcm::TransferSyntax::ExplicitVRBigEndian,
+    gdcm::TransferSyntax::DeflatedExplicitVRLittleEndian,
+    gdcm::TransferSyntax::JPEGBaselineProcess1,
+  };
+  int ret = 0;
+  for( size_t i = 0; i < sizeof(tss) / sizeof(*tss); ++i )
+    {
+    const gdcm::TransferSyntax ts = tss[i];
+    gdcm::DataSet ds;
+    MakeDataSet( ds, ts.IsEncapsulated() );
+    std::string ref, fast;
+    if( !Write( ds, ts, false, ref ) || !Write( ds, ts, true, fast ) )
+      {
+      std::cerr << "Could not write " << ts << std::endl;
+      ++ret;
+      continue;
+      }
+    if( ref != fast )
+      {
+      std::cerr << "Different output for " << ts << std::endl;
+      ++ret;
+      continue;
+      }
+    std::stringstream ss( fast );
+    gdcm::Reader r;
+    r.SetStream( ss );
+    if( !r.Read() )
+      {
+      std::cerr << "Could not read back " << ts << std::endl;
+      ++ret;
+      }
+    }
+
+  // a defined length sequence with the wrong length cannot be written
+  gdcm::DataSet ds;
+  MakeDataSet( ds, false );
+  gdcm::DataElement sq = MakeSequence( gdcm::Tag(0x0054,0x0016), 1, 2, true );
+  sq.SetVL( sq.GetVL() + 2 );
+  ds.Replace( sq );
+  std::string out;
+  if( Write( ds, gdcm::TransferSyntax::ExplicitVRLittleEndian, true, out ) )
+    {
+    std::cerr << "Wrong sequence length not detected" << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
@@ -0,0 +1,270 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmBatchAnonymizer.h"
+#include "gdcmDummyValueMap.h"
+#include "gdcmCryptographicMessageSyntax.h"
+#include "gdcmGlobal.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+using TestFixture::Insert;
+using TestFixture::PassThroughCMS;
+
+const gdcm::Tag PatientName(0x0010,0x0010);
+const gdcm::Tag StudyUID(0x0020,0x000d);
+const gdcm::Tag SeriesUID(0x0020,0x000e);
+const gdcm::Tag SOPUID(0x0008,0x0018);
+const size_t NumberOfFiles = 24;
+
+std::string GetOriginalValue(gdcm::Tag const &t, size_t i)
+{
+  std::ostringstream os;
+  if( t == PatientName ) os << "Doe^" << (i % 3);
+  else if( t == StudyUID ) os << "1.2.3." << (i % 3);
+  else if( t == SeriesUID ) os << "1.2.3." << (i % 3) << "." << (i % 2);
+  else os << "1.2.3.4.5." << i;
+  return os.str();
+}
+
+bool WriteFile(const std::string &filename, size_t i)
+{
+  gdcm::DataSet ds;
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.7" );
+  Insert( ds, SOPUID, gdcm::VR::UI, GetOriginalValue( SOPUID, i ) );
+  Insert( ds, gdcm::Tag(0x0008,0x0060), gdcm::VR::CS, "OT" );
+  Insert( ds, PatientName, gdcm::VR::PN, GetOriginalValue( PatientName, i ) );
+  Insert( ds, StudyUID, gdcm::VR::UI, GetOriginalValue( StudyUID, i ) );
+  Insert( ds, SeriesUID, gdcm::VR::UI, GetOriginalValue( SeriesUID, i ) );
+  return TestFixture::Write( filename, ds );
+}
+
+std::string GetValue(const std::string &filename, gdcm::Tag const &t)
+{
+  gdcm::Reader r;
+  r.SetFileName( filename.c_str() );
+  if( !r.Read() ) return "<unreadable>";
+  const gdcm::DataSet &ds = r.GetFile().GetDataSet();
+  if( !ds.FindDataElement( t ) ) return "<missing>";
+  const gdcm::ByteValue *bv = ds.GetDataElement( t ).GetByteValue();
+  if( !bv ) return "";
+  std::string s( bv->GetPointer(), bv->GetLength() );
+  while( !s.empty() && ( s[s.size()-1] == ' ' || s[s.size()-1] == 0 ) )
+    s.resize( s.size() - 1 );
+  return s;
+}
+
+gdcm::Directory::FilenamesType GetFilenames(std::string const &dir)
+{
+  gdcm::Directory::FilenamesType filenames;
+  for( size_t i = 0; i < NumberOfFiles; ++i )
+    {
+    std::ostringstream os;
+    os << dir << "/file" << i << ".dcm";
+    filenames.push_back( os.str() );
+    }
+  return filenames;
+}
+
+// Same original values give the same dummy values, different ones give
+// different dummy values
+int CheckDeidentified(gdcm::Directory::FilenamesType const &outputs)
+{
+  const gdcm::Tag tags[] = { PatientName, StudyUID, SeriesUID, SOPUID };
+  for( size_t t = 0; t < sizeof(tags) / sizeof(*tags); ++t )
+    {
+    std::map<std::string, std::string> dummies, originals;
+    for( size_t i = 0; i < outputs.size(); ++i )
+      {
+      const std::string original = GetOriginalValue( tags[t], i );
+      const std::string dummy = GetValue( outputs[i], tags[t] );
+      if( dummy == original || dummy == "<unreadable>" || dummy == "<missing>"
+        || ( dummies.count( original ) && dummies[original] != dummy ) )
+        {
+        std::cerr << "Wrong dummy value: " << dummy << " for " << original << std::endl;
+        return 1;
+        }
+      dummies[original] = dummy;
+      originals[dummy] = original;
+      }
+    // Patient's Name is not a UID: always the same dummy value
+    if( tags[t] != PatientName && originals.size() != dummies.size() )
+      {
+      std::cerr << "Same dummy value for different values" << std::endl;
+      return 1;
+      }
+    }
+  return 0;
+}
+}
+
+int TestBatchAnonymizer(int, char *[])
+{
+  gdcm::Global& g = gdcm::Global::GetInstance();
+  if( !g.LoadResourcesFiles() )
+    {
+    std::cerr << "Could not load resources files" << std::endl;
+    return 1;
+    }
+  const char subdir[] = "TestBatchAnonymizer";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  const std::string outdirs[] = { tmpdir + "/in", tmpdir + "/out1", tmpdir + "/out2", tmpdir + "/reid" };
+  for( size_t i = 0; i < sizeof(outdirs) / sizeof(*outdirs); ++i )
+    {
+    gdcm::System::MakeDirectory( outdirs[i].c_str() );
+    }
+  gdcm::Directory::FilenamesType inputs = GetFilenames( outdirs[0] );
+  for( size_t i = 0; i < NumberOfFiles; ++i )
+    {
+    if( !WriteFile( inputs[i], i ) ) return 1;
+    }
+  const gdcm::Directory::FilenamesType outputs1 = GetFilenames( outdirs[1] );
+  const gdcm::Directory::FilenamesType outputs2 = GetFilenames( outdirs[2] );
+  const gdcm::Directory::FilenamesType reidentified = GetFilenames( outdirs[3] );
+
+  int ret = 0;
+  PassThroughCMS cms;
+  const std::string mapfilename = tmpdir + "/map.txt";
+  gdcm::System::RemoveFile( mapfilename.c_str() );
+    {
+    gdcm::DummyValueMap dvm;
+    gdcm::BatchAnonymizer batch;
+    batch.SetFileNames( inputs, outputs1 );
+    batch.SetCryptographicMessageSyntax( &cms );
+    batch.SetDummyValueMap( &dvm );
+    batch.SetNumberOfThreads( 4 );
+    if( !batch.Anonymize( true ) || !batch.GetFailedFileNames().empty() )
+      {
+      std::cerr << "Could not de-identify" << std::endl;
+      return 1;
+      }
+    ret += CheckDeidentified( outputs1 );
+    if( !dvm.Write( mapfilename.c_str() ) ) return 1;
+    }
+
+  // A new run, loading the mapping: same dummy values
+    {
+    gdcm::DummyValueMap dvm;
+    if( !dvm.Read( mapfilename.c_str() ) ) return 1;
+    gdcm::BatchAnonymizer batch;
+    batch.SetFileNames( inputs, outputs2 );
+    batch.SetCryptographicMessageSyntax( &cms );
+    batch.SetDummyValueMap( &dvm );
+    batch.SetNumberOfThreads( 1 );
+    if( !batch.Anonymize( true ) ) return 1;
+    const size_t nuids = dvm.GetNumberOfUIDs();
+    // 3 studies, 6 series, and the SOP Instance UIDs
+    if( nuids < 3 + 6 + NumberOfFiles )
+      {
+      std::cerr << "Wrong number of UIDs: " << nuids << std::endl;
+      ++ret;
+      }
+    }
+  for( size_t i = 0; i < NumberOfFiles; ++i )
+    {
+    if( GetValue( outputs1[i], StudyUID ) != GetValue( outputs2[i], StudyUID )
+      || GetValue( outputs1[i], SOPUID ) != GetValue( outputs2[i], SOPUID ) )
+      {
+      std::cerr << "Different dummy values after loading the mapping" << std::endl;
+      ++ret;
+      break;
+      }
+    }
+
+  // Re-identify
+    {
+    gdcm::BatchAnonymizer batch;
+    batch.SetFileNames( outputs1, reidentified );
+    batch.SetCryptographicMessageSyntax( &cms );
+    if( !batch.Anonymize( false ) ) return 1;
+    }
+  for( size_t i = 0; i < NumberOfFiles; ++i )
+    {
+    if( GetValue( reidentified[i], PatientName ) != GetOriginalValue( PatientName, i )
+      || GetValue( reidentified[i], StudyUID ) != GetOriginalValue( StudyUID, i ) )
+      {
+      std::cerr << "Could not re-identify: " << reidentified[i] << std::endl;
+      ++ret;
+      break;
+      }
+    }
+
+  // A file which is not DICOM
+  const std::string notdicom = outdirs[0] + "/notdicom.txt";
+  std::ofstream os( notdicom.c_str() );
+  os << "not a DICOM file";
+  os.close();
+  inputs.insert( inputs.begin() + 5, notdicom );
+  gdcm::Directory::FilenamesType outputs = outputs2;
+  outputs.insert( outputs.begin() + 5, outdirs[2] + "/notdicom.txt" );
+  // and a DICOM file the StreamingAnonymizer cannot read (unknown IOD)
+  const std::string unknowniod = outdirs[0] + "/unknowniod.dcm";
+    {
+    gdcm::DataSet ds;
+    Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.3.4" );
+    Insert( ds, SOPUID, gdcm::VR::UI, "1.2.3.4.5.6" );
+    Insert( ds, PatientName, gdcm::VR::PN, "Doe^" );
+    if( !TestFixture::Write( unknowniod, ds ) ) return 1;
+    }
+  inputs.insert( inputs.begin() + 10, unknowniod );
+  outputs.insert( outputs.begin() + 10, outdirs[2] + "/unknowniod.dcm" );
+    {
+    gdcm::BatchAnonymizer batch;
+    batch.SetFileNames( inputs, outputs );
+    batch.SetCryptographicMessageSyntax( &cms );
+    batch.SetSkipUnreadableFiles( true );
+    if( !batch.Anonymize( true ) || batch.GetFailedFileNames().size() != 2
+      || batch.GetFailedFileNames()[0] != notdicom
+      || batch.GetFailedFileNames()[1] != unknowniod )
+      {
+      std::cerr << "Unreadable file not skipped" << std::endl;
+      ++ret;
+      }
+    batch.SetSkipUnreadableFiles( false );
+    if( batch.Anonymize( true ) || batch.GetFailedFileNames().empty() )
+      {
+      std::cerr << "Unreadable file not detected" << std::endl;
+      ++ret;
+      }
+    }
+
+  // Values which are not UIDs are escaped in the file
+    {
+    gdcm::DummyValueMap dvm;
+    const std::string value( "a\tb\\c\nd\0e", 9 );
+    const std::string dummy = dvm.GetDummyValue( PatientName, value );
+    const std::string uid = dvm.GetDummyUID( "1.2.3" );
+    if( dvm.GetDummyUID( std::string( "1.2.3\0", 6 ) ) != uid
+      || !dvm.Write( mapfilename.c_str() ) )
+      return 1;
+    gdcm::DummyValueMap dvm2;
+    if( !dvm2.Read( mapfilename.c_str() ) || dvm2.GetNumberOfValues() != 1
+      || dvm2.GetNumberOfUIDs() != 1
+      || dvm2.GetDummyValue( PatientName, value ) != dummy
+      || dvm2.GetDummyUID( "1.2.3" ) != uid )
+      {
+      std::cerr << "Wrong mapping after reading it" << std::endl;
+      ++ret;
+      }
+    }
+
+  return ret;
+}
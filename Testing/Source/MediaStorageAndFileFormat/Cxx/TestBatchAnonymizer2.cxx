@@ -0,0 +1,150 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmBatchAnonymizer.h"
+#include "gdcmStreamingAnonymizer.h"
+#include "gdcmDummyValueMap.h"
+#include "gdcmGlobal.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+#include "TestFixture.h"
+
+#include <set>
+
+// De-identify gdcmData with a BatchAnonymizer, and compare with the files
+// de-identified one at a time with a StreamingAnonymizer using the same
+// dummy values
+namespace
+{
+const gdcm::Tag Tags[] = {
+  gdcm::Tag(0x0010,0x0010), // Patient's Name
+  gdcm::Tag(0x0010,0x0020), // Patient ID
+  gdcm::Tag(0x0020,0x000d), // Study Instance UID
+  gdcm::Tag(0x0020,0x000e), // Series Instance UID
+  gdcm::Tag(0x0008,0x0018), // SOP Instance UID
+};
+const gdcm::Tag PixelData(0x7fe0,0x0010);
+
+std::string GetTempFilename(const char *filename, const char *subdir)
+{
+  const std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  return gdcm::Testing::GetTempFilename( filename, subdir );
+}
+
+int CompareFiles(const char *filename, std::string const &batchfilename,
+  std::string const &singlefilename)
+{
+  gdcm::Reader batch, single, input;
+  batch.SetFileName( batchfilename.c_str() );
+  single.SetFileName( singlefilename.c_str() );
+  if( !batch.Read() || !single.Read() )
+    {
+    std::cerr << "Could not read back: " << batchfilename << std::endl;
+    return 1;
+    }
+  const gdcm::DataSet &ds = batch.GetFile().GetDataSet();
+  const gdcm::DataSet &refds = single.GetFile().GetDataSet();
+  for( size_t t = 0; t < sizeof(Tags) / sizeof(*Tags); ++t )
+    {
+    if( ds.FindDataElement( Tags[t] ) != refds.FindDataElement( Tags[t] )
+      || ( ds.FindDataElement( Tags[t] )
+        && !( ds.GetDataElement( Tags[t] ) == refds.GetDataElement( Tags[t] ) ) ) )
+      {
+      std::cerr << "Different " << Tags[t] << " for: " << filename << std::endl;
+      return 1;
+      }
+    }
+  // The Pixel Data is copied as is
+  input.SetFileName( filename );
+  if( input.Read() && input.GetFile().GetDataSet().FindDataElement( PixelData )
+    && !( input.GetFile().GetDataSet().GetDataElement( PixelData )
+      == ds.GetDataElement( PixelData ) ) )
+    {
+    std::cerr << "Different Pixel Data for: " << filename << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestBatchAnonymizer2(int, char *[])
+{
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  gdcm::Global& g = gdcm::Global::GetInstance();
+  if( !g.LoadResourcesFiles() )
+    {
+    std::cerr << "Could not load resources files" << std::endl;
+    return 1;
+    }
+  TestFixture::PassThroughCMS cms;
+  gdcm::DummyValueMap dvm;
+
+  // One file at a time: the files which cannot be de-identified would stop
+  // the batch, they are left out
+  gdcm::Directory::FilenamesType inputs, outputs, singles;
+  std::set<std::string> unreadable;
+  gdcm::StreamingAnonymizer anon;
+  anon.SetCryptographicMessageSyntax( &cms );
+  anon.SetDummyValueMap( &dvm );
+  const char *filename;
+  for( unsigned int i = 0; (filename = gdcm::Testing::GetFileName( i )); ++i )
+    {
+    const std::string single = GetTempFilename( filename, "TestBatchAnonymizer2_single" );
+    anon.SetInputFileName( filename );
+    anon.SetOutputFileName( single.c_str() );
+    if( !anon.BasicApplicationLevelConfidentialityProfile() )
+      {
+      if( !anon.IsInputFileUnreadable() ) continue;
+      unreadable.insert( filename );
+      }
+    inputs.push_back( filename );
+    outputs.push_back( GetTempFilename( filename, "TestBatchAnonymizer2" ) );
+    singles.push_back( single );
+    }
+  std::cout << inputs.size() << " files, " << unreadable.size() << " unreadable" << std::endl;
+  if( inputs.size() == unreadable.size() ) return 1;
+
+  // The dummy values are already known: the batch must produce the same ones
+  gdcm::BatchAnonymizer batch;
+  batch.SetFileNames( inputs, outputs );
+  batch.SetCryptographicMessageSyntax( &cms );
+  batch.SetDummyValueMap( &dvm );
+  batch.SetNumberOfThreads( 4 );
+  batch.SetSkipUnreadableFiles( true );
+  if( !batch.Anonymize( true ) )
+    {
+    std::cerr << "BatchAnonymizer failed" << std::endl;
+    return 1;
+    }
+  gdcm::Directory::FilenamesType const &failed = batch.GetFailedFileNames();
+  if( std::set<std::string>( failed.begin(), failed.end() ) != unreadable )
+    {
+    std::cerr << "Wrong unreadable files: " << failed.size() << std::endl;
+    return 1;
+    }
+
+  int ret = 0;
+  for( size_t i = 0; i < inputs.size(); ++i )
+    {
+    if( unreadable.count( inputs[i] ) ) continue;
+    ret += CompareFiles( inputs[i].c_str(), outputs[i], singles[i] );
+    }
+  return ret;
+}
@@ -0,0 +1,221 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmCatalog.h"
+#include "gdcmDataSet.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// Catalog of a synthetic set of files: 2 patients, 3 studies, 4 series
+namespace
+{
+using TestFixture::Insert;
+
+struct Instance
+{
+  const char *PatientID;
+  const char *PatientName;
+  const char *StudyUID;
+  const char *StudyDate;
+  const char *SeriesUID;
+  const char *Modality;
+};
+const Instance Instances[] = {
+  { "P1", "Doe^John", "1.2.3.1", "20200115", "1.2.3.1.1", "CT" },
+  { "P1", "Doe^John", "1.2.3.1", "20200115", "1.2.3.1.1", "CT" },
+  { "P1", "Doe^John", "1.2.3.1", "20200115", "1.2.3.1.2", "SR" },
+  { "P1", "Doe^John", "1.2.3.2", "20210301", "1.2.3.2.1", "MR" },
+  { "P2", "Smith^Jane", "1.2.3.3", "20200620", "1.2.3.3.1", "CT" },
+  { "P2", "Smith^Jane", "1.2.3.3", "20200620", "1.2.3.3.1", "CT" },
+  { "P2", "Smith^Jane", "1.2.3.3", "20200620", "1.2.3.3.1", "CT" },
+};
+const unsigned int NumberOfInstances = sizeof(Instances) / sizeof(*Instances);
+
+bool WriteFile(const std::string &filename, unsigned int i)
+{
+  const Instance &inst = Instances[i];
+  gdcm::DataSet ds;
+  std::ostringstream uid, in;
+  uid << inst.SeriesUID << "." << i;
+  in << i + 1;
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.2" );
+  Insert( ds, gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, uid.str() );
+  Insert( ds, gdcm::Tag(0x0008,0x0020), gdcm::VR::DA, inst.StudyDate );
+  Insert( ds, gdcm::Tag(0x0008,0x0060), gdcm::VR::CS, inst.Modality );
+  Insert( ds, gdcm::Tag(0x0010,0x0010), gdcm::VR::PN, inst.PatientName );
+  Insert( ds, gdcm::Tag(0x0010,0x0020), gdcm::VR::LO, inst.PatientID );
+  Insert( ds, gdcm::Tag(0x0020,0x000d), gdcm::VR::UI, inst.StudyUID );
+  Insert( ds, gdcm::Tag(0x0020,0x000e), gdcm::VR::UI, inst.SeriesUID );
+  Insert( ds, gdcm::Tag(0x0020,0x0013), gdcm::VR::IS, in.str() );
+  return TestFixture::Write( filename, ds );
+}
+
+size_t Count(gdcm::Catalog const &c, gdcm::Catalog::LevelType level,
+  gdcm::Tag const &t, const char *value, gdcm::Tag const &t2 = gdcm::Tag(),
+  const char *value2 = nullptr)
+{
+  gdcm::Catalog::KeysType keys;
+  keys.push_back( std::make_pair( t, value ) );
+  if( value2 ) keys.push_back( std::make_pair( t2, value2 ) );
+  return c.Select( level, keys ).size();
+}
+
+int TestQueries(gdcm::Catalog const &c)
+{
+  const gdcm::Tag patientid(0x0010,0x0020), patientname(0x0010,0x0010),
+    studyuid(0x0020,0x000d), studydate(0x0008,0x0020), modality(0x0008,0x0060);
+  if( c.GetNumberOfRecords( gdcm::Catalog::PATIENT ) != 2
+    || c.GetNumberOfRecords( gdcm::Catalog::STUDY ) != 3
+    || c.GetNumberOfRecords( gdcm::Catalog::SERIES ) != 4
+    || c.GetNumberOfRecords( gdcm::Catalog::IMAGE ) != NumberOfInstances )
+    {
+    std::cerr << "Wrong number of records" << std::endl;
+    return 1;
+    }
+  int ret = 0;
+  struct { size_t Found, Expected; const char *Query; } queries[] = {
+    { Count( c, gdcm::Catalog::STUDY, patientid, "P1" ), 2, "studies of P1" },
+    { Count( c, gdcm::Catalog::IMAGE, patientid, "P2" ), 3, "instances of P2" },
+    { Count( c, gdcm::Catalog::SERIES, modality, "CT" ), 2, "CT series" },
+    { Count( c, gdcm::Catalog::STUDY, studydate, "20200101-20201231" ), 2, "date range" },
+    { Count( c, gdcm::Catalog::STUDY, studydate, "20210101-" ), 1, "open date range" },
+    { Count( c, gdcm::Catalog::STUDY, studyuid, "1.2.3.1\\1.2.3.3\\9.9" ), 2, "UID list" },
+    { Count( c, gdcm::Catalog::PATIENT, patientname, "Doe*" ), 1, "wild card" },
+    { Count( c, gdcm::Catalog::PATIENT, patientname, "*^J?n*" ), 1, "wild card, no prefix" },
+    { Count( c, gdcm::Catalog::PATIENT, patientname, "*" ), 2, "universal wild card" },
+    { Count( c, gdcm::Catalog::SERIES, patientid, "P1", modality, "CT" ), 1, "P1 CT series" },
+    { Count( c, gdcm::Catalog::IMAGE, studydate, "-20200131", modality, "SR" ), 1, "SR before Feb 2020" },
+    { Count( c, gdcm::Catalog::STUDY, patientid, "P3" ), 0, "unknown patient" },
+    // Attributes of the instances are ignored at the study level
+    { Count( c, gdcm::Catalog::STUDY, gdcm::Tag(0x0008,0x0018), "1.2.3.3.1.4" ), 3, "lower level key" },
+  };
+  for( size_t q = 0; q < sizeof(queries) / sizeof(*queries); ++q )
+    {
+    if( queries[q].Found != queries[q].Expected )
+      {
+      std::cerr << "Wrong " << queries[q].Query << ": " << queries[q].Found << std::endl;
+      ++ret;
+      }
+    }
+
+  gdcm::Catalog::KeysType keys;
+  keys.push_back( std::make_pair( studyuid, "1.2.3.3" ) );
+  const std::vector<size_t> series = c.Select( gdcm::Catalog::SERIES, keys );
+  if( series.size() != 1 || c.GetFilenames( gdcm::Catalog::SERIES, series[0] ).size() != 3
+    || strcmp( c.GetValue( gdcm::Catalog::SERIES, series[0], patientname ), "Smith^Jane" ) != 0
+    || c.GetValue( gdcm::Catalog::SERIES, series[0], gdcm::Tag(0x0008,0x0018) ) )
+    {
+    std::cerr << "Wrong series of study 1.2.3.3" << std::endl;
+    ++ret;
+    }
+  return ret;
+}
+}
+
+int TestCatalog(int , char *[])
+{
+  const char subdir[] = "TestCatalog";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  gdcm::Directory::FilenamesType filenames;
+  for( unsigned int i = 0; i < NumberOfInstances; ++i )
+    {
+    std::ostringstream os;
+    os << tmpdir << "/instance" << i << ".dcm";
+    filenames.push_back( os.str() );
+    if( !WriteFile( filenames.back(), i ) )
+      {
+      std::cerr << "Could not write: " << filenames.back() << std::endl;
+      return 1;
+      }
+    }
+  // Not a DICOM file
+  const std::string notdicom = tmpdir + "/notdicom.txt";
+    {
+    std::ofstream os( notdicom.c_str() );
+    os << "not a DICOM file\n";
+    }
+  filenames.insert( filenames.begin() + 3, notdicom );
+
+  gdcm::Catalog c;
+  c.SetNumberOfThreads( 3 );
+  if( !c.Populate( filenames ) )
+    {
+    std::cerr << "Could not populate the catalog" << std::endl;
+    return 1;
+    }
+  if( TestQueries( c ) ) return 1;
+  // Files already in the catalog are not added twice
+  c.SetNumberOfThreads( 1 );
+  if( !c.Populate( filenames ) || TestQueries( c ) ) return 1;
+  if( strcmp( c.GetFilename( 3 ), filenames[4].c_str() ) != 0 )
+    {
+    std::cerr << "Wrong filename: " << c.GetFilename( 3 ) << std::endl;
+    return 1;
+    }
+
+  // C-FIND identifier
+  gdcm::DataSet identifier;
+  Insert( identifier, gdcm::Tag(0x0008,0x0052), gdcm::VR::CS, "STUDY" );
+  Insert( identifier, gdcm::Tag(0x0010,0x0020), gdcm::VR::LO, "P1" );
+  Insert( identifier, gdcm::Tag(0x0020,0x000d), gdcm::VR::UI, "" );
+  Insert( identifier, gdcm::Tag(0x0008,0x0020), gdcm::VR::DA, "2021*" );
+  Insert( identifier, gdcm::Tag(0x0008,0x1030), gdcm::VR::LO, "" );
+  std::vector<gdcm::DataSet> results;
+  if( !c.Find( identifier, results ) || results.size() != 1 )
+    {
+    std::cerr << "Wrong C-FIND results: " << results.size() << std::endl;
+    return 1;
+    }
+  const gdcm::DataSet &result = results[0];
+  const gdcm::ByteValue *bv = result.GetDataElement( gdcm::Tag(0x0020,0x000d) ).GetByteValue();
+  if( result.Size() != identifier.Size() || !bv
+    || std::string( bv->GetPointer(), bv->GetLength() ) != std::string( "1.2.3.2", 8 )
+    || !result.GetDataElement( gdcm::Tag(0x0008,0x1030) ).IsEmpty() )
+    {
+    std::cerr << "Wrong C-FIND result" << std::endl;
+    return 1;
+    }
+  gdcm::DataSet invalid;
+  Insert( invalid, gdcm::Tag(0x0008,0x0052), gdcm::VR::CS, "FRAME" );
+  if( c.Find( invalid, results ) )
+    {
+    std::cerr << "Invalid Query/Retrieve Level accepted" << std::endl;
+    return 1;
+    }
+
+  // Save and load back
+  const std::string catalogfile = tmpdir + "/catalog.txt";
+  gdcm::Catalog c2;
+  if( !c.Write( catalogfile.c_str() ) || !c2.Read( catalogfile.c_str() ) )
+    {
+    std::cerr << "Could not save the catalog" << std::endl;
+    return 1;
+    }
+  if( TestQueries( c2 ) ) return 1;
+  if( strcmp( c2.GetFilename( 6 ), c.GetFilename( 6 ) ) != 0 )
+    {
+    std::cerr << "Wrong filename after Read" << std::endl;
+    return 1;
+    }
+
+  return 0;
+}
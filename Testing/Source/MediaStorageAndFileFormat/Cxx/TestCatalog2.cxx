@@ -0,0 +1,205 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmCatalog.h"
+#include "gdcmScanner.h"
+#include "gdcmSystem.h"
+#include "gdcmTextFields.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+
+#include <map>
+#include <set>
+
+// Catalog of gdcmData: the instances are checked against a Scanner, and the
+// indexed queries against a loop over all the records
+namespace
+{
+typedef gdcm::Catalog::LevelType LevelType;
+const LevelType Levels[] = {
+  gdcm::Catalog::PATIENT, gdcm::Catalog::STUDY, gdcm::Catalog::SERIES, gdcm::Catalog::IMAGE };
+// Key of each level
+const gdcm::Tag KeyTags[] = {
+  gdcm::Tag(0x0010,0x0020), gdcm::Tag(0x0020,0x000d),
+  gdcm::Tag(0x0020,0x000e), gdcm::Tag(0x0008,0x0018) };
+// Some of the indexed attributes
+const gdcm::Tag QueryTags[] = {
+  gdcm::Tag(0x0010,0x0020), // Patient ID
+  gdcm::Tag(0x0010,0x0010), // Patient's Name
+  gdcm::Tag(0x0020,0x000d), // Study Instance UID
+  gdcm::Tag(0x0008,0x0020), // Study Date
+  gdcm::Tag(0x0020,0x000e), // Series Instance UID
+  gdcm::Tag(0x0008,0x0060), // Modality
+};
+const gdcm::Tag StudyDate(0x0008,0x0020);
+
+bool IsUID(gdcm::Tag const &t)
+{
+  return t == KeyTags[1] || t == KeyTags[2] || t == KeyTags[3];
+}
+
+// The records of level matching key, by looping over all of them
+std::vector<size_t> RefSelect(gdcm::Catalog const &c, LevelType level,
+  gdcm::Tag const &t, std::string const &value)
+{
+  std::vector<size_t> ids;
+  const bool wildcard = value.size() > 1 && value[value.size()-1] == '*';
+  const bool range = t == StudyDate && value.size() > 1 && value[value.size()-1] == '-';
+  const std::string bound = value.substr( 0, value.size() - 1 );
+  for( size_t id = 0; id < c.GetNumberOfRecords( level ); ++id )
+    {
+    const std::string v = c.GetValue( level, id, t );
+    if( wildcard ? v.compare( 0, bound.size(), bound ) == 0
+      : range ? !v.empty() && v >= bound
+      : v == value )
+      ids.push_back( id );
+    }
+  return ids;
+}
+
+int TestQueries(gdcm::Catalog const &c)
+{
+  int ret = 0;
+  for( unsigned int l = 0; l < 4; ++l )
+    {
+    const LevelType level = Levels[l];
+    for( size_t q = 0; q < sizeof(QueryTags) / sizeof(*QueryTags); ++q )
+      {
+      const gdcm::Tag &t = QueryTags[q];
+      if( !c.GetNumberOfRecords( level ) || !c.GetValue( level, 0, t ) ) continue;
+      std::set<std::string> queries;
+      for( size_t id = 0; id < c.GetNumberOfRecords( level ); ++id )
+        {
+        const std::string v = c.GetValue( level, id, t );
+        // only the values matched as is
+        if( v.empty() || v.find_first_of( "*?\\-" ) != std::string::npos ) continue;
+        queries.insert( v );
+        if( !IsUID( t ) ) queries.insert( v.substr( 0, 1 ) + "*" );
+        if( t == StudyDate ) queries.insert( v + "-" );
+        }
+      for( std::set<std::string>::const_iterator it = queries.begin(); it != queries.end(); ++it )
+        {
+        gdcm::Catalog::KeysType keys;
+        keys.push_back( std::make_pair( t, *it ) );
+        if( c.Select( level, keys ) != RefSelect( c, level, t, *it ) )
+          {
+          std::cerr << "Wrong records of level " << l << " for " << t
+            << " = [" << *it << "]" << std::endl;
+          ++ret;
+          }
+        }
+      }
+    }
+  return ret;
+}
+
+bool SameRecords(gdcm::Catalog const &c1, gdcm::Catalog const &c2)
+{
+  for( unsigned int l = 0; l < 4; ++l )
+    {
+    const LevelType level = Levels[l];
+    if( c1.GetNumberOfRecords( level ) != c2.GetNumberOfRecords( level ) ) return false;
+    const std::vector<gdcm::Tag> tags = gdcm::Catalog::GetTags( level );
+    for( size_t id = 0; id < c1.GetNumberOfRecords( level ); ++id )
+      {
+      if( l && c1.GetParent( level, id ) != c2.GetParent( level, id ) ) return false;
+      for( size_t t = 0; t < tags.size(); ++t )
+        if( std::string( c1.GetValue( level, id, tags[t] ) )
+          != c2.GetValue( level, id, tags[t] ) ) return false;
+      }
+    }
+  for( size_t id = 0; id < c1.GetNumberOfRecords( gdcm::Catalog::IMAGE ); ++id )
+    if( std::string( c1.GetFilename( id ) ) != c2.GetFilename( id ) ) return false;
+  return true;
+}
+}
+
+int TestCatalog2(int, char *[])
+{
+  gdcm::Trace::DebugOff();
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  gdcm::Directory::FilenamesType filenames;
+  const char *filename;
+  for( unsigned int i = 0; (filename = gdcm::Testing::GetFileName( i )); ++i )
+    filenames.push_back( filename );
+
+  gdcm::Catalog c;
+  c.SetNumberOfThreads( 4 );
+  if( !c.Populate( filenames ) )
+    {
+    std::cerr << "Populate failed" << std::endl;
+    return 1;
+    }
+
+  // One instance per SOP Instance UID, with the first file holding it
+  gdcm::Scanner s;
+  for( unsigned int l = 0; l < 4; ++l ) s.AddTag( KeyTags[l] );
+  if( !s.Scan( filenames ) ) return 1;
+  std::map<std::string, std::string> firstfiles; // SOP Instance UID -> filename
+  std::vector<std::string> uids;
+  for( size_t i = 0; i < filenames.size(); ++i )
+    {
+    const std::string uid = gdcm::TrimValue( s.GetValue( filenames[i].c_str(), KeyTags[3] ) );
+    if( uid.empty() || firstfiles.count( uid ) ) continue;
+    firstfiles[uid] = filenames[i];
+    uids.push_back( uid );
+    }
+  const size_t ninstances = c.GetNumberOfRecords( gdcm::Catalog::IMAGE );
+  std::cout << ninstances << " instances, "
+    << c.GetNumberOfRecords( gdcm::Catalog::SERIES ) << " series" << std::endl;
+  if( !ninstances || ninstances != uids.size() )
+    {
+    std::cerr << "Wrong number of instances: " << uids.size() << std::endl;
+    return 1;
+    }
+  int ret = 0;
+  for( size_t id = 0; id < ninstances; ++id )
+    {
+    const char *instancefilename = c.GetFilename( id );
+    if( uids[id] != c.GetValue( gdcm::Catalog::IMAGE, id, KeyTags[3] )
+      || firstfiles[ uids[id] ] != instancefilename )
+      {
+      std::cerr << "Wrong instance: " << uids[id] << std::endl;
+      ++ret;
+      continue;
+      }
+    // The series of the instance is the one of the file (its study and
+    // patient are the ones of the first instance of the series)
+    if( gdcm::TrimValue( s.GetValue( instancefilename, KeyTags[2] ) )
+      != c.GetValue( gdcm::Catalog::IMAGE, id, KeyTags[2] ) )
+      {
+      std::cerr << "Wrong parent for instance: " << uids[id] << std::endl;
+      ++ret;
+      }
+    }
+
+  ret += TestQueries( c );
+
+  // Same records once written and read back
+  const std::string tmpdir = gdcm::Testing::GetTempDirectory( "TestCatalog2" );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  const std::string catalogfilename = tmpdir + "/catalog.txt";
+  gdcm::Catalog c2;
+  if( !c.Write( catalogfilename.c_str() ) || !c2.Read( catalogfilename.c_str() )
+    || !SameRecords( c, c2 ) )
+    {
+    std::cerr << "Wrong catalog read back from: " << catalogfilename << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
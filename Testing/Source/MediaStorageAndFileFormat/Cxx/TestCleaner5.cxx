@@ -0,0 +1,140 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmCleaner.h"
+#include "gdcmSequenceOfItems.h"
+#include "TestFixture.h"
+
+// Check the Tag, PrivateTag, DPath and VR rules at each depth, without any
+// input file.
+namespace {
+using TestFixture::Insert;
+using TestFixture::InsertSQ;
+
+const gdcm::Tag PatientName(0x0010, 0x0010);
+const gdcm::Tag InstitutionName(0x0008, 0x0080);
+const gdcm::Tag RefStudySQ(0x0008, 0x1110);
+const gdcm::Tag RefSeriesSQ(0x0008, 0x1111);
+const gdcm::Tag RefSOPClass(0x0008, 0x1150);
+const gdcm::Tag RefSOPInstance(0x0008, 0x1155);
+const gdcm::Tag Creator(0x0029, 0x0010);
+const gdcm::Tag ReportType(0x0029, 0x1008);
+const gdcm::Tag Report(0x0029, 0x1009);
+const gdcm::Tag Orphan(0x0031, 0x1010);
+const char Owner[] = "SIEMENS CSA REPORT";
+
+void InsertPrivate(gdcm::DataSet &ds) {
+  Insert(ds, Creator, gdcm::VR::LO, Owner);
+  Insert(ds, ReportType, gdcm::VR::CS, "TYPE");
+  Insert(ds, Report, gdcm::VR::LO, "Doe report");
+}
+
+const gdcm::DataSet &GetNested(const gdcm::DataSet &ds, gdcm::Tag const &t) {
+  static const gdcm::DataSet empty;
+  if (!ds.FindDataElement(t)) return empty;
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sq =
+      ds.GetDataElement(t).GetValueAsSQ();
+  if (!sq || sq->GetNumberOfItems() != 1) return empty;
+  return sq->GetItem(1).GetNestedDataSet();
+}
+
+// 0: missing, 1: empty, 2: has a value
+int GetState(const gdcm::DataSet &ds, gdcm::Tag const &t) {
+  if (!ds.FindDataElement(t)) return 0;
+  return ds.GetDataElement(t).IsEmpty() ? 1 : 2;
+}
+}  // namespace
+
+int TestCleaner5(int, char *[]) {
+  gdcm::DataSet level2;
+  Insert(level2, PatientName, gdcm::VR::PN, "Doe^Nested");
+  Insert(level2, RefSOPInstance, gdcm::VR::UI, "1.2.3.2");
+  InsertPrivate(level2);
+
+  gdcm::DataSet level1;
+  Insert(level1, RefSOPClass, gdcm::VR::UI, "1.2.840.10008.3.1.2.3.1");
+  Insert(level1, RefSOPInstance, gdcm::VR::UI, "1.2.3.1");
+  InsertSQ(level1, RefSeriesSQ, level2);
+
+  gdcm::DataSet sibling;
+  InsertPrivate(sibling);
+
+  // Cleaner keeps a reference counted pointer to the File
+  gdcm::SmartPointer<gdcm::File> file = new gdcm::File;
+  gdcm::DataSet &ds = file->GetDataSet();
+  Insert(ds, InstitutionName, gdcm::VR::LO, "Hospital");
+  Insert(ds, RefSOPInstance, gdcm::VR::UI, "1.2.3");
+  InsertSQ(ds, RefStudySQ, level1);
+  InsertSQ(ds, RefSeriesSQ, sibling);
+  Insert(ds, PatientName, gdcm::VR::PN, "Doe^John");
+  InsertPrivate(ds);
+  Insert(ds, Orphan, gdcm::VR::LO, "no creator");
+
+  gdcm::Cleaner cleaner;
+  gdcm::DPath dpath;
+  // Tag and PrivateTag rules apply at any depth
+  if (!cleaner.Remove(InstitutionName) ||
+      !cleaner.Empty(gdcm::PrivateTag(0x0029, 0x09, Owner)) ||
+      !cleaner.Remove(gdcm::PrivateTag(0x0029, 0x08, Owner)))
+    return 1;
+  // DPath rules only at their position
+  if (!dpath.ConstructFromString("/0008,1110/*/0008,1155") ||
+      !cleaner.Remove(dpath))
+    return 1;
+  if (!dpath.ConstructFromString("/0008,1111/*/0029,08,SIEMENS CSA REPORT") ||
+      !cleaner.Preserve(dpath))
+    return 1;
+  if (!dpath.ConstructFromString("/0008,1110/*/0008,1111/*/0010,0010") ||
+      !cleaner.Preserve(dpath))
+    return 1;
+  // Item numbers are not supported: never matches
+  if (!dpath.ConstructFromString("/0008,1110/1/0008,1150") ||
+      !cleaner.Remove(dpath))
+    return 1;
+  if (!cleaner.Empty(gdcm::VR(gdcm::VR::PN))) return 1;
+
+  cleaner.SetFile(*file);
+  if (!cleaner.Clean()) {
+    std::cerr << "Could not clean" << std::endl;
+    return 1;
+  }
+
+  const gdcm::DataSet &clean = cleaner.GetFile().GetDataSet();
+  const gdcm::DataSet &clean1 = GetNested(clean, RefStudySQ);
+  const gdcm::DataSet &clean2 = GetNested(clean1, RefSeriesSQ);
+  const gdcm::DataSet &cleansibling = GetNested(clean, RefSeriesSQ);
+  struct {
+    const gdcm::DataSet *ds;
+    gdcm::Tag tag;
+    int state;
+  } expected[] = {
+      {&clean, InstitutionName, 0}, {&clean, RefSOPInstance, 2},
+      {&clean, PatientName, 1},     {&clean, Creator, 2},
+      {&clean, ReportType, 0},      {&clean, Report, 1},
+      {&clean, Orphan, 0},          {&clean1, RefSOPClass, 2},
+      {&clean1, RefSOPInstance, 0}, {&clean2, PatientName, 2},
+      {&clean2, RefSOPInstance, 2}, {&clean2, ReportType, 0},
+      {&clean2, Report, 1},         {&cleansibling, ReportType, 2},
+      {&cleansibling, Report, 1},
+  };
+  int ret = 0;
+  for (size_t i = 0; i < sizeof(expected) / sizeof(*expected); ++i) {
+    const int state = GetState(*expected[i].ds, expected[i].tag);
+    if (state != expected[i].state) {
+      std::cerr << "Wrong state for #" << i << " " << expected[i].tag << ": "
+                << state << " instead of " << expected[i].state << std::endl;
+      ++ret;
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,205 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmCleaner.h"
+#include "gdcmDicts.h"
+#include "gdcmGlobal.h"
+#include "gdcmReader.h"
+#include "gdcmSequenceOfItems.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+
+#include <cstdio>
+#include <map>
+
+// For each file of gdcmData, pick an attribute found in the items of a
+// sequence, and check a Tag rule applies to it at any depth while a DPath
+// rule applies only at its position (and a Preserve DPath rule wins).
+namespace {
+typedef std::map<std::string, size_t> CountsType;
+
+std::string ToString(gdcm::Tag const &t) {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%04x,%04x", t.GetGroup(), t.GetElement());
+  return buffer;
+}
+
+bool IsSequence(gdcm::DataElement const &de) {
+  static const gdcm::Dicts &dicts = gdcm::Global::GetInstance().GetDicts();
+  return de.GetTag().IsPublic() &&
+         dicts.GetDictEntry(de.GetTag()).GetVR() == gdcm::VR::SQ;
+}
+
+// Number of attributes matching t (or pt when t is not set) in each nested
+// dataset, by DPath of the dataset
+void Count(const gdcm::DataSet &ds, std::string const &path, gdcm::Tag const &t,
+           gdcm::PrivateTag const &pt, CountsType &counts) {
+  gdcm::DataSet::ConstIterator it = ds.Begin();
+  for (; it != ds.End(); ++it) {
+    const gdcm::Tag &tag = it->GetTag();
+    if (t != gdcm::Tag(0xffff, 0xffff) ? tag == t
+                                       : tag.IsPrivate() &&
+                                             !tag.IsPrivateCreator() &&
+                                             ds.GetPrivateTag(tag) == pt)
+      ++counts[path];
+    if (!IsSequence(*it)) continue;
+    gdcm::SmartPointer<gdcm::SequenceOfItems> sqi = it->GetValueAsSQ();
+    if (!sqi) continue;
+    for (gdcm::SequenceOfItems::SizeType i = 1; i <= sqi->GetNumberOfItems();
+         ++i)
+      Count(sqi->GetItem(i).GetNestedDataSet(), path + "/" + ToString(tag) + "/*",
+            t, pt, counts);
+  }
+}
+
+// A public attribute in the items of a sequence found at root
+bool FindNested(const gdcm::DataSet &ds, std::string &itemspath,
+                gdcm::Tag &nested) {
+  gdcm::DataSet::ConstIterator it = ds.Begin();
+  for (; it != ds.End(); ++it) {
+    if (!IsSequence(*it)) continue;
+    gdcm::SmartPointer<gdcm::SequenceOfItems> sqi = it->GetValueAsSQ();
+    if (!sqi || !sqi->GetNumberOfItems()) continue;
+    const gdcm::DataSet &nestedds = sqi->GetItem(1).GetNestedDataSet();
+    gdcm::DataSet::ConstIterator nit = nestedds.Begin();
+    for (; nit != nestedds.End(); ++nit) {
+      const gdcm::Tag &tag = nit->GetTag();
+      if (tag.IsPublic() && !tag.IsGroupLength() && !IsSequence(*nit)) {
+        itemspath = "/" + ToString(it->GetTag()) + "/*";
+        nested = tag;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// A private attribute (with its creator) at root
+bool FindPrivate(const gdcm::DataSet &ds, gdcm::PrivateTag &pt) {
+  gdcm::DataSet::ConstIterator it = ds.Begin();
+  for (; it != ds.End(); ++it) {
+    const gdcm::Tag &tag = it->GetTag();
+    if (!tag.IsPrivate() || tag.IsPrivateCreator() || tag.IsGroupLength())
+      continue;
+    pt = ds.GetPrivateTag(tag);
+    if (*pt.GetOwner()) return true;
+  }
+  return false;
+}
+
+enum RuleType { TAG_RULE, DPATH_RULE, PRESERVE_RULE, PRIVATE_RULE };
+
+// Counts after a cleaning with one rule
+bool Clean(const char *filename, RuleType type, std::string const &itemspath,
+           gdcm::Tag const &t, gdcm::PrivateTag const &pt, CountsType &counts) {
+  gdcm::Reader reader;
+  reader.SetFileName(filename);
+  if (!reader.Read()) return false;
+  gdcm::Cleaner cleaner;
+  gdcm::DPath dpath;
+  if (!dpath.ConstructFromString((itemspath + "/" + ToString(t)).c_str()))
+    return false;
+  switch (type) {
+    case TAG_RULE:
+      if (!cleaner.Remove(t)) return false;
+      break;
+    case DPATH_RULE:
+      if (!cleaner.Remove(dpath)) return false;
+      break;
+    case PRESERVE_RULE:
+      if (!cleaner.Remove(t) || !cleaner.Preserve(dpath)) return false;
+      break;
+    case PRIVATE_RULE:
+      if (!cleaner.Remove(pt)) return false;
+      break;
+  }
+  cleaner.SetFile(reader.GetFile());
+  if (!cleaner.Clean()) return false;
+  Count(cleaner.GetFile().GetDataSet(), "",
+        type == PRIVATE_RULE ? gdcm::Tag(0xffff, 0xffff) : t, pt, counts);
+  return true;
+}
+
+int TestCleaner6Impl(const char *filename, int &nfiles) {
+  gdcm::Reader reader;
+  reader.SetFileName(filename);
+  if (!reader.Read()) return 0;
+  const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+  int ret = 0;
+
+  std::string itemspath;
+  gdcm::Tag nested;
+  if (FindNested(ds, itemspath, nested)) {
+    ++nfiles;
+    CountsType original, tagrule, dpathrule, preserverule;
+    Count(ds, "", nested, gdcm::PrivateTag(), original);
+    if (!Clean(filename, TAG_RULE, itemspath, nested, gdcm::PrivateTag(),
+               tagrule) ||
+        !Clean(filename, DPATH_RULE, itemspath, nested, gdcm::PrivateTag(),
+               dpathrule) ||
+        !Clean(filename, PRESERVE_RULE, itemspath, nested, gdcm::PrivateTag(),
+               preserverule)) {
+      std::cerr << "Could not clean: " << filename << std::endl;
+      return 1;
+    }
+    CountsType dpathref = original, preserveref;
+    dpathref.erase(itemspath);
+    preserveref[itemspath] = original[itemspath];
+    if (!tagrule.empty() || dpathrule != dpathref ||
+        preserverule != preserveref) {
+      std::cerr << "Wrong rules for " << itemspath << "/" << ToString(nested)
+                << " in: " << filename << std::endl;
+      ++ret;
+    }
+  }
+
+  gdcm::PrivateTag pt;
+  if (FindPrivate(ds, pt)) {
+    CountsType privaterule;
+    if (!Clean(filename, PRIVATE_RULE, "", gdcm::Tag(0x0008, 0x0018), pt,
+               privaterule)) {
+      std::cerr << "Could not clean: " << filename << std::endl;
+      return 1;
+    }
+    if (!privaterule.empty()) {
+      std::cerr << "Wrong rule for " << pt << " in: " << filename << std::endl;
+      ++ret;
+    }
+  }
+  return ret;
+}
+}  // namespace
+
+int TestCleaner6(int argc, char *argv[]) {
+  int nfiles = 0;
+  if (argc == 2) {
+    const char *filename = argv[1];
+    return TestCleaner6Impl(filename, nfiles);
+  }
+
+  // else
+  gdcm::Trace::DebugOff();
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  int r = 0, i = 0;
+  const char *filename;
+  const char *const *filenames = gdcm::Testing::GetFileNames();
+  while ((filename = filenames[i])) {
+    r += TestCleaner6Impl(filename, nfiles);
+    ++i;
+  }
+  std::cout << nfiles << " files with nested attributes" << std::endl;
+  if (!nfiles) return 1;
+
+  return r;
+}
@@ -0,0 +1,291 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmDICOMDIRGenerator.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmAttribute.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+using TestFixture::Insert;
+
+const size_t NumberOfFiles = 16;
+
+// 2 patients, 3 studies, 6 series
+std::string GetPatientID(size_t i) { return i < 10 ? "PAT1" : "PAT2"; }
+std::string GetStudyUID(size_t i) { return i < 6 ? "1.2.3.1" : i < 10 ? "1.2.3.2" : "1.2.3.3"; }
+std::string GetSeriesUID(size_t i)
+{
+  std::ostringstream os;
+  os << "1.2.3." << GetStudyUID( i ).substr( 6 ) << "." << i / 4;
+  return os.str();
+}
+std::string GetSOPUID(size_t i)
+{
+  std::ostringstream os;
+  os << "1.2.3.4.5." << 100 + i;
+  return os.str();
+}
+
+bool WriteFile(const std::string &filename, size_t i)
+{
+  gdcm::DataSet ds;
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.7" );
+  Insert( ds, gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, GetSOPUID( i ) );
+  Insert( ds, gdcm::Tag(0x0008,0x0060), gdcm::VR::CS, "OT" );
+  Insert( ds, gdcm::Tag(0x0010,0x0010), gdcm::VR::PN, "Doe^" + GetPatientID( i ) );
+  Insert( ds, gdcm::Tag(0x0010,0x0020), gdcm::VR::LO, GetPatientID( i ) );
+  Insert( ds, gdcm::Tag(0x0020,0x000d), gdcm::VR::UI, GetStudyUID( i ) );
+  Insert( ds, gdcm::Tag(0x0020,0x000e), gdcm::VR::UI, GetSeriesUID( i ) );
+  Insert( ds, gdcm::Tag(0x0020,0x0013), gdcm::VR::IS, "1" );
+  return TestFixture::Write( filename, ds );
+}
+
+// A Directory Record, as found in the DICOMDIR file at a given offset
+struct Record
+{
+  uint32_t Next;
+  uint32_t Lower;
+  std::string Type;
+  std::string Content;
+};
+
+bool ReadRecord(std::string const &dicomdir, uint32_t offset, Record &r)
+{
+  const char itemtag[] = "\xfe\xff\x00\xe0";
+  const char itemdelimitation[] = "\xfe\xff\x0d\xe0";
+  if( offset + 8 > dicomdir.size() || dicomdir.compare( offset, 4, itemtag, 4 ) != 0 )
+    return false;
+  const size_t end = dicomdir.find( std::string( itemdelimitation, 4 ), offset );
+  r.Content = dicomdir.substr( offset, end - offset );
+  // (0004,1400), (0004,1410), (0004,1420) and (0004,1430) are first, with a
+  // short VR
+  size_t pos = 8;
+  for( int i = 0; i < 4 && pos + 8 <= r.Content.size(); ++i )
+    {
+    uint16_t element, len;
+    memcpy( &element, r.Content.c_str() + pos + 2, 2 );
+    memcpy( &len, r.Content.c_str() + pos + 6, 2 );
+    const char *value = r.Content.c_str() + pos + 8;
+    if( element == 0x1400 ) memcpy( &r.Next, value, 4 );
+    else if( element == 0x1420 ) memcpy( &r.Lower, value, 4 );
+    else if( element == 0x1430 ) r.Type = std::string( value, len );
+    pos += 8 + len;
+    }
+  return true;
+}
+
+bool Contains(Record const &r, std::string const &value)
+{
+  return r.Content.find( value ) != std::string::npos;
+}
+
+// Walk the records by their offsets, and check they match the files
+int CheckDICOMDIR(std::string const &filename)
+{
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  const std::string dicomdir = ss.str();
+  gdcm::Reader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.Read() ) return 1;
+  const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+  gdcm::Attribute<0x4,0x1200> first;
+  first.SetFromDataSet( ds );
+  gdcm::Attribute<0x4,0x1202> last;
+  last.SetFromDataSet( ds );
+
+  size_t i = 0; // next file expected
+  uint32_t lastpatient = 0;
+  Record patient, study, series, image;
+  for( uint32_t p = first.GetValue(); p; p = patient.Next )
+    {
+    lastpatient = p;
+    if( !ReadRecord( dicomdir, p, patient ) || patient.Type != "PATIENT "
+      || i >= NumberOfFiles || !Contains( patient, GetPatientID( i ) ) )
+      return 1;
+    for( uint32_t s = patient.Lower; s; s = study.Next )
+      {
+      if( !ReadRecord( dicomdir, s, study ) || study.Type != "STUDY "
+        || i >= NumberOfFiles || !Contains( study, GetStudyUID( i ) )
+        || GetPatientID( i ) != GetPatientID( i - (s == patient.Lower ? 0 : 1) ) )
+        return 1;
+      for( uint32_t se = study.Lower; se; se = series.Next )
+        {
+        if( !ReadRecord( dicomdir, se, series ) || series.Type != "SERIES"
+          || i >= NumberOfFiles || !Contains( series, GetSeriesUID( i ) ) )
+          return 1;
+        for( uint32_t im = series.Lower; im; im = image.Next )
+          {
+          if( !ReadRecord( dicomdir, im, image ) || image.Type != "IMAGE "
+            || i >= NumberOfFiles || !Contains( image, GetSOPUID( i ) )
+            || GetSeriesUID( i ) != GetSeriesUID( i - (im == series.Lower ? 0 : 1) ) )
+            return 1;
+          ++i;
+          }
+        }
+      }
+    }
+  if( i != NumberOfFiles || last.GetValue() != lastpatient )
+    {
+    std::cerr << "Wrong number of records or last record: " << i << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+bool Generate(gdcm::DICOMDIRGenerator &gen, std::string const &tmpdir,
+  gdcm::Directory::FilenamesType const &filenames, std::string const &outfilename,
+  const char *descriptor = "MYDESCRIPTOR")
+{
+  gen.SetFilenames( filenames );
+  gen.SetRootDirectory( tmpdir );
+  if( descriptor ) gen.SetDescriptor( descriptor );
+  if( !gen.Generate() ) return false;
+  gdcm::Writer writer;
+  writer.SetFile( gen.GetFile() );
+  writer.SetFileName( outfilename.c_str() );
+  return writer.Write();
+}
+}
+
+int TestDICOMDIRGenerator3(int, char *[])
+{
+  const char subdir[] = "TestDICOMDIRGenerator3";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  // files are not given in order
+  gdcm::Directory::FilenamesType filenames, firsthalf, secondhalf;
+  for( size_t i = 0; i < NumberOfFiles; ++i )
+    {
+    const size_t j = (i * 7) % NumberOfFiles;
+    std::ostringstream os;
+    os << tmpdir << "/IMG" << j;
+    if( !WriteFile( os.str(), j ) ) return 1;
+    filenames.push_back( os.str() );
+    (i % 2 ? firsthalf : secondhalf).push_back( os.str() );
+    }
+
+  int ret = 0;
+  const std::string dicomdir = tmpdir + "/DICOMDIR";
+    {
+    gdcm::DICOMDIRGenerator gen;
+    if( !Generate( gen, tmpdir, filenames, dicomdir ) ) return 1;
+    }
+  if( CheckDICOMDIR( dicomdir ) )
+    {
+    std::cerr << "Wrong DICOMDIR" << std::endl;
+    ++ret;
+    }
+
+  // half of the files, then the other half (and a file already there)
+  const std::string dicomdir2 = tmpdir + "/DICOMDIR2";
+    {
+    gdcm::DICOMDIRGenerator gen;
+    if( !Generate( gen, tmpdir, firsthalf, dicomdir2 ) ) return 1;
+    }
+  gdcm::Reader reader;
+  reader.SetFileName( dicomdir2.c_str() );
+  if( !reader.Read() ) return 1;
+  gdcm::Attribute<0x2,0x3> filesetuid;
+  filesetuid.SetFromDataSet( reader.GetFile().GetHeader() );
+  secondhalf.push_back( firsthalf[0] );
+    {
+    gdcm::DICOMDIRGenerator gen;
+    gen.SetFile( reader.GetFile() );
+    gen.SetAppend( true );
+    if( !Generate( gen, tmpdir, secondhalf, dicomdir2 ) ) return 1;
+    }
+  gdcm::Reader reader2;
+  reader2.SetFileName( dicomdir2.c_str() );
+  if( !reader2.Read() ) return 1;
+  gdcm::Attribute<0x2,0x3> filesetuid2;
+  filesetuid2.SetFromDataSet( reader2.GetFile().GetHeader() );
+  if( CheckDICOMDIR( dicomdir2 ) || filesetuid.GetValue() != filesetuid2.GetValue() )
+    {
+    std::cerr << "Wrong appended DICOMDIR" << std::endl;
+    ++ret;
+    }
+
+  // appending nothing leaves the records, and without a descriptor the
+  // File-set ID, as they are
+    {
+    gdcm::DICOMDIRGenerator gen;
+    gen.SetFile( reader2.GetFile() );
+    gen.SetAppend( true );
+    if( !Generate( gen, tmpdir, gdcm::Directory::FilenamesType(), dicomdir2, nullptr ) ) return 1;
+    }
+  gdcm::Reader reader3;
+  reader3.SetFileName( dicomdir2.c_str() );
+  if( !reader3.Read() ) return 1;
+  gdcm::Attribute<0x4,0x1130> filesetid;
+  filesetid.SetFromDataSet( reader3.GetFile().GetDataSet() );
+  if( CheckDICOMDIR( dicomdir2 ) || !( filesetid.GetValue() == "MYDESCRIPTOR" ) )
+    {
+    std::cerr << "Wrong DICOMDIR after an empty append: " << filesetid.GetValue() << std::endl;
+    ++ret;
+    }
+
+  // a file without a Transfer Syntax cannot be appended
+    {
+    gdcm::DataSet ds;
+    Insert( ds, gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, GetSOPUID( NumberOfFiles ) );
+    Insert( ds, gdcm::Tag(0x0010,0x0020), gdcm::VR::LO, GetPatientID( 0 ) );
+    Insert( ds, gdcm::Tag(0x0020,0x000d), gdcm::VR::UI, GetStudyUID( 0 ) );
+    Insert( ds, gdcm::Tag(0x0020,0x000e), gdcm::VR::UI, GetSeriesUID( 0 ) );
+    const std::string acrnema = tmpdir + "/ACRNEMA";
+    gdcm::Writer w;
+    w.GetFile().SetDataSet( ds );
+    // no File Meta Information is written
+    w.GetFile().GetHeader().SetDataSetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+    w.SetCheckFileMetaInformation( false );
+    w.SetFileName( acrnema.c_str() );
+    if( !w.Write() ) return 1;
+    gdcm::DICOMDIRGenerator gen;
+    gen.SetFile( reader3.GetFile() );
+    gen.SetAppend( true );
+    if( Generate( gen, tmpdir, gdcm::Directory::FilenamesType( 1, acrnema ), dicomdir2 ) )
+      {
+      std::cerr << "Appended a file without a Transfer Syntax" << std::endl;
+      ++ret;
+      }
+    }
+
+  // a descriptor replaces the File-set ID
+    {
+    gdcm::DICOMDIRGenerator gen;
+    gen.SetFile( reader3.GetFile() );
+    gen.SetAppend( true );
+    if( !Generate( gen, tmpdir, gdcm::Directory::FilenamesType(), dicomdir2, "NEW_DESCRIPTOR" ) ) return 1;
+    filesetid.SetFromDataSet( gen.GetFile().GetDataSet() );
+    }
+  if( !( filesetid.GetValue() == "NEW_DESCRIPTOR" ) )
+    {
+    std::cerr << "File-set ID not replaced: " << filesetid.GetValue() << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
@@ -0,0 +1,240 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmDICOMDIRGenerator.h"
+#include "gdcmDirectory.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmScanner.h"
+#include "gdcmAttribute.h"
+#include "gdcmItem.h"
+#include "gdcmSwapper.h"
+#include "gdcmTesting.h"
+#include "gdcmSystem.h"
+#include "gdcmTrace.h"
+#include "gdcmFilenameGenerator.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <set>
+#include <vector>
+
+// Generate a DICOMDIR from the files of TestImageChangeTransferSyntax4 (at
+// once, then in two steps using SetAppend), and walk its records by their
+// offsets to check they match the files
+namespace
+{
+const gdcm::Tag KeyTags[] = {
+  gdcm::Tag(0x10,0x20), gdcm::Tag(0x20,0xd), gdcm::Tag(0x20,0xe), gdcm::Tag(0x8,0x18) };
+const gdcm::Tag RecordKeyTags[] = {
+  gdcm::Tag(0x10,0x20), gdcm::Tag(0x20,0xd), gdcm::Tag(0x20,0xe), gdcm::Tag(0x4,0x1511) };
+
+std::string Trim(const char *value, size_t len)
+{
+  std::string s( value, len );
+  while( !s.empty() && ( s[s.size()-1] == ' ' || s[s.size()-1] == 0 ) )
+    s.resize( s.size() - 1 );
+  return s;
+}
+
+std::string GetValue(gdcm::DataSet const &ds, gdcm::Tag const &t)
+{
+  if( !ds.FindDataElement( t ) ) return "";
+  const gdcm::ByteValue *bv = ds.GetDataElement( t ).GetByteValue();
+  return bv ? Trim( bv->GetPointer(), bv->GetLength() ) : "";
+}
+
+// The Directory Record at offset in the DICOMDIR file
+bool ReadRecord(std::string const &dicomdir, uint32_t offset, gdcm::Item &item)
+{
+  if( !offset || offset >= dicomdir.size() ) return false;
+  std::istringstream is( dicomdir.substr( offset ) );
+  item.Read<gdcm::ExplicitDataElement,gdcm::SwapperNoOp>( is );
+  return is.good() && item.GetTag() == gdcm::Tag(0xfffe,0xe000);
+}
+
+// patient/study/series/image paths of the records below offset
+bool WalkRecords(std::string const &dicomdir, uint32_t offset, int level,
+  std::string const &parent, std::set<std::string> &paths,
+  std::map<std::string, std::string> &fileids)
+{
+  for( int n = 0; offset; ++n )
+    {
+    gdcm::Item item;
+    if( n > 100000 || !ReadRecord( dicomdir, offset, item ) ) return false;
+    const gdcm::DataSet &ds = item.GetNestedDataSet();
+    gdcm::Attribute<0x4,0x1400> next = {0};
+    next.SetFromDataSet( ds );
+    gdcm::Attribute<0x4,0x1420> lower = {0};
+    lower.SetFromDataSet( ds );
+    const std::string path = parent + "\\" + GetValue( ds, RecordKeyTags[level] );
+    if( level == 3 )
+      {
+      if( lower.GetValue() || !paths.insert( path ).second ) return false;
+      fileids[path] = GetValue( ds, gdcm::Tag(0x4,0x1500) );
+      }
+    else if( !WalkRecords( dicomdir, lower.GetValue(), level + 1, path, paths, fileids ) )
+      {
+      return false;
+      }
+    offset = next.GetValue();
+    }
+  return true;
+}
+
+int CheckDICOMDIR(std::string const &filename, std::set<std::string> const &refpaths,
+  std::map<std::string, std::string> const &reffileids)
+{
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  gdcm::Reader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.Read() ) return 1;
+  gdcm::Attribute<0x4,0x1200> first = {0};
+  first.SetFromDataSet( reader.GetFile().GetDataSet() );
+  std::set<std::string> paths;
+  std::map<std::string, std::string> fileids;
+  if( !WalkRecords( ss.str(), first.GetValue(), 0, "", paths, fileids ) )
+    {
+    std::cerr << "Invalid Directory Records in " << filename << std::endl;
+    return 1;
+    }
+  if( paths != refpaths )
+    {
+    std::cerr << "Wrong Directory Records in " << filename << std::endl;
+    return 1;
+    }
+  // each image record points to a file with the same keys
+  std::map<std::string, std::string>::const_iterator it = fileids.begin();
+  for( ; it != fileids.end(); ++it )
+    {
+    std::map<std::string, std::string>::const_iterator ref = reffileids.find( it->second );
+    if( ref == reffileids.end() || ref->second != it->first )
+      {
+      std::cerr << "Wrong Referenced File ID: " << it->second << std::endl;
+      return 1;
+      }
+    }
+  return 0;
+}
+
+bool Generate(gdcm::DICOMDIRGenerator &gen, std::string const &outtmpdir,
+  gdcm::Directory::FilenamesType const &filenames, std::string const &outfilename)
+{
+  gen.SetFilenames( filenames );
+  gen.SetRootDirectory( outtmpdir );
+  gen.SetDescriptor( "MYDESCRIPTOR" );
+  if( !gen.Generate() ) return false;
+  gdcm::Writer writer;
+  writer.SetFile( gen.GetFile() );
+  writer.SetFileName( outfilename.c_str() );
+  return writer.Write();
+}
+}
+
+int TestDICOMDIRGenerator4(int, char *[])
+{
+  gdcm::Trace::WarningOff();
+  const char subdir[] = "TestImageChangeTransferSyntax4";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    std::cerr << "Need to run TestImageChangeTransferSyntax4 before" << std::endl;
+    return 1;
+    }
+  const char outsubdir[] = "TestDICOMDIRGenerator4";
+  std::string outtmpdir = gdcm::Testing::GetTempDirectory( outsubdir );
+  if( !gdcm::System::FileIsDirectory( outtmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( outtmpdir.c_str() );
+    }
+
+  // Only the files with the keys of all the levels can be referenced
+  gdcm::Directory dir;
+  dir.Load( tmpdir.c_str() );
+  gdcm::Scanner s;
+  for( int level = 0; level < 4; ++level ) s.AddTag( KeyTags[level] );
+  s.AddTag( gdcm::Tag(0x2,0x10) );
+  if( !s.Scan( dir.GetFilenames() ) ) return 1;
+  gdcm::Directory::FilenamesType const &filenames = s.GetFilenames();
+  gdcm::Directory::FilenamesType keyfilenames;
+  std::vector<std::string> keypaths;
+  for( size_t i = 0; i < filenames.size(); ++i )
+    {
+    const char *filename = filenames[i].c_str();
+    const char *ts = s.GetValue( filename, gdcm::Tag(0x2,0x10) );
+    if( !ts || Trim( ts, strlen( ts ) ) != "1.2.840.10008.1.2.1" ) continue;
+    std::string path;
+    for( int level = 0; level < 4; ++level )
+      {
+      const char *value = s.GetValue( filename, KeyTags[level] );
+      const std::string key = value ? Trim( value, strlen( value ) ) : "";
+      if( key.empty() ) { path.clear(); break; }
+      path += "\\" + key;
+      }
+    if( path.empty() ) continue;
+    keyfilenames.push_back( filenames[i] );
+    keypaths.push_back( path );
+    }
+  const size_t nfiles = keyfilenames.size();
+  std::cout << nfiles << " files with all the keys" << std::endl;
+  if( !nfiles ) return 1;
+
+  gdcm::FilenameGenerator fg;
+  fg.SetPattern( "FILE%03d" );
+  fg.SetNumberOfFilenames( nfiles );
+  if( !fg.Generate() ) return 1;
+  gdcm::Directory::FilenamesType outfilenames, firsthalf, secondhalf;
+  std::set<std::string> refpaths;
+  std::map<std::string, std::string> reffileids; // File ID -> keys
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    const std::string copy = outtmpdir + "/" + fg.GetFilename( i );
+    std::ifstream f1( keyfilenames[i].c_str(), std::fstream::binary );
+    std::ofstream f2( copy.c_str(), std::fstream::binary );
+    f2 << f1.rdbuf();
+    outfilenames.push_back( copy );
+    (i % 2 ? secondhalf : firsthalf).push_back( copy );
+    refpaths.insert( keypaths[i] );
+    reffileids[ fg.GetFilename( i ) ] = keypaths[i];
+    }
+
+  int ret = 0;
+  const std::string dicomdir = outtmpdir + "/DICOMDIR";
+    {
+    gdcm::DICOMDIRGenerator gen;
+    if( !Generate( gen, outtmpdir, outfilenames, dicomdir ) ) return 1;
+    }
+  ret += CheckDICOMDIR( dicomdir, refpaths, reffileids );
+
+  const std::string dicomdir2 = outtmpdir + "/DICOMDIR2";
+    {
+    gdcm::DICOMDIRGenerator gen;
+    if( !Generate( gen, outtmpdir, firsthalf, dicomdir2 ) ) return 1;
+    }
+  gdcm::Reader reader;
+  reader.SetFileName( dicomdir2.c_str() );
+  if( !reader.Read() ) return 1;
+    {
+    gdcm::DICOMDIRGenerator gen;
+    gen.SetFile( reader.GetFile() );
+    gen.SetAppend( true );
+    if( !Generate( gen, outtmpdir, secondhalf, dicomdir2 ) ) return 1;
+    }
+  ret += CheckDICOMDIR( dicomdir2, refpaths, reffileids );
+
+  return ret;
+}
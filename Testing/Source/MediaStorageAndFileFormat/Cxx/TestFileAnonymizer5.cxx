@@ -0,0 +1,246 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFileAnonymizer.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+const gdcm::Tag PatientName(0x0010,0x0010);
+const gdcm::Tag PatientID(0x0010,0x0020);
+const gdcm::Tag PatientSex(0x0010,0x0040);
+const gdcm::Tag StudyDescription(0x0008,0x1030);
+const gdcm::Tag Creator(0x0009,0x0010);
+const gdcm::Tag Padding(0x0009,0x1000);
+const gdcm::Tag TrailingPadding(0xfffc,0xfffc);
+
+bool WriteFile(const std::string &filename, gdcm::TransferSyntax::TSType ts)
+{
+  gdcm::Writer w;
+  gdcm::DataSet &ds = w.GetFile().GetDataSet();
+  gdcm::DataElement sop( gdcm::Tag(0x0008,0x0016) );
+  sop.SetVR( gdcm::VR::UI );
+  const char sopclass[] = "1.2.840.10008.5.1.4.1.1.7"; // Secondary Capture
+  sop.SetByteValue( sopclass, (uint32_t)strlen(sopclass) + 1 );
+  ds.Insert( sop );
+  gdcm::DataElement uid( gdcm::Tag(0x0008,0x0018) );
+  uid.SetVR( gdcm::VR::UI );
+  uid.SetByteValue( "1.2.3.4", 8 );
+  ds.Insert( uid );
+  gdcm::DataElement desc( StudyDescription );
+  desc.SetVR( gdcm::VR::LO );
+  desc.SetByteValue( "HEAD", 4 );
+  ds.Insert( desc );
+  gdcm::DataElement name( PatientName );
+  name.SetVR( gdcm::VR::PN );
+  name.SetByteValue( "Doe^John", 8 );
+  ds.Insert( name );
+  gdcm::DataElement id( PatientID );
+  id.SetVR( gdcm::VR::LO );
+  id.SetByteValue( "1234", 4 );
+  ds.Insert( id );
+  std::vector<char> pixels( 1000000 );
+  for( size_t i = 0; i < pixels.size(); ++i ) pixels[i] = (char)(i % 251);
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetVR( gdcm::VR::OW );
+  pixeldata.SetByteValue( &pixels[0], (uint32_t)pixels.size() );
+  ds.Insert( pixeldata );
+  w.GetFile().GetHeader().SetDataSetTransferSyntax( ts );
+  w.SetFileName( filename.c_str() );
+  return w.Write();
+}
+
+std::string ReadFile(const std::string &filename)
+{
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+std::string GetValue(const std::string &filename, gdcm::Tag const &t)
+{
+  gdcm::Reader r;
+  r.SetFileName( filename.c_str() );
+  if( !r.Read() ) return "<unreadable>";
+  const gdcm::DataSet &ds = r.GetFile().GetDataSet();
+  if( !ds.FindDataElement( t ) ) return "<missing>";
+  const gdcm::ByteValue *bv = ds.GetDataElement( t ).GetByteValue();
+  if( !bv ) return "";
+  return std::string( bv->GetPointer(), bv->GetLength() );
+}
+
+int TestInPlace(const std::string &tmpdir, gdcm::TransferSyntax::TSType ts)
+{
+  const std::string input = tmpdir + "input.dcm";
+  const std::string output = tmpdir + "inplace.dcm";
+  if( !WriteFile( input, ts ) ) return 1;
+
+  // reserve some space, when the file is copied (the output must not exist
+  // or this would be a strict in place edit)
+  gdcm::System::RemoveFile( output.c_str() );
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( input.c_str() );
+    fa.SetOutputFileName( output.c_str() );
+    fa.Replace( Creator, "GDCM PADDING" );
+    const std::string zeros( 200, 0 );
+    fa.Replace( Padding, zeros.c_str(), (uint32_t)zeros.size() );
+    if( !fa.Write() ) return 1;
+    }
+  const std::string before = ReadFile( output );
+  // pixel data is at the end of the file
+  const std::string pixeldata = before.substr( before.size() - 1000000 );
+
+  // longer name, removed and inserted attributes
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( output.c_str() );
+    fa.SetInPlace( true );
+    fa.SetPaddingTag( Padding );
+    fa.Replace( PatientName, "Smith^Jonathan^Alexander" );
+    fa.Replace( PatientSex, "O " );
+    fa.Empty( StudyDescription );
+    fa.Remove( PatientID );
+    if( !fa.Write() )
+      {
+      std::cerr << "In place edit failed" << std::endl;
+      return 1;
+      }
+    }
+  const std::string after = ReadFile( output );
+  if( after.size() != before.size()
+    || after.compare( after.size() - 1000000, 1000000, pixeldata ) != 0 )
+    {
+    std::cerr << "Pixel data was modified" << std::endl;
+    return 1;
+    }
+  if( GetValue( output, PatientName ) != "Smith^Jonathan^Alexander"
+    || GetValue( output, PatientSex ) != "O "
+    || GetValue( output, StudyDescription ) != ""
+    || GetValue( output, PatientID ) != "<missing>" )
+    {
+    std::cerr << "Wrong values after in place edit" << std::endl;
+    return 1;
+    }
+  // 16 more bytes for the name, 10 for the sex (14 as UN in explicit), 4 less
+  // for the description and 12 less for the ID
+  const size_t sexlen = ts == gdcm::TransferSyntax::ImplicitVRLittleEndian ? 10 : 14;
+  if( GetValue( output, Padding ).size() != 200 - 16 - sexlen + 4 + 12 )
+    {
+    std::cerr << "Wrong padding length: " << GetValue( output, Padding ).size() << std::endl;
+    return 1;
+    }
+
+  // does not fit: the file is left as is
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( output.c_str() );
+    fa.SetInPlace( true );
+    fa.SetPaddingTag( Padding );
+    const std::string big( 1000, 'X' );
+    fa.Replace( PatientName, big.c_str() );
+    if( fa.Write() ) return 1;
+    }
+  if( ReadFile( output ) != after )
+    {
+    std::cerr << "File modified by a failed in place edit" << std::endl;
+    return 1;
+    }
+
+  // without padding, only same length edits are possible
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( output.c_str() );
+    fa.SetInPlace( true );
+    fa.Replace( PatientName, "Smith^Jonathan^Alexandra" );
+    if( !fa.Write() ) return 1;
+    }
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( output.c_str() );
+    fa.SetInPlace( true );
+    fa.Replace( PatientName, "Doe^" );
+    if( fa.Write() ) return 1;
+    }
+  if( GetValue( output, PatientName ) != "Smith^Jonathan^Alexandra" )
+    {
+    std::cerr << "Wrong same length edit" << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+// The padding element is the last one of the file
+int TestTrailingPadding(const std::string &tmpdir, gdcm::TransferSyntax::TSType ts)
+{
+  const std::string input = tmpdir + "input.dcm";
+  const std::string output = tmpdir + "trailing.dcm";
+  if( !WriteFile( input, ts ) ) return 1;
+  gdcm::System::RemoveFile( output.c_str() );
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( input.c_str() );
+    fa.SetOutputFileName( output.c_str() );
+    const std::string zeros( 100, 0 );
+    fa.Replace( TrailingPadding, zeros.c_str(), (uint32_t)zeros.size() );
+    if( !fa.Write() ) return 1;
+    }
+  const std::string before = ReadFile( output );
+    {
+    gdcm::FileAnonymizer fa;
+    fa.SetInputFileName( output.c_str() );
+    fa.SetInPlace( true );
+    fa.SetPaddingTag( TrailingPadding );
+    fa.Replace( PatientName, "Smith^Jonathan^Alexander" );
+    if( !fa.Write() )
+      {
+      std::cerr << "In place edit with trailing padding failed" << std::endl;
+      return 1;
+      }
+    }
+  if( ReadFile( output ).size() != before.size()
+    || GetValue( output, PatientName ) != "Smith^Jonathan^Alexander"
+    || GetValue( output, TrailingPadding ).size() != 100 - 16 )
+    {
+    std::cerr << "Wrong in place edit with trailing padding" << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestFileAnonymizer5(int, char *[])
+{
+  const char subdir[] = "TestFileAnonymizer5";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  tmpdir += "/";
+
+  int ret = 0;
+  ret += TestInPlace( tmpdir, gdcm::TransferSyntax::ExplicitVRLittleEndian );
+  ret += TestInPlace( tmpdir, gdcm::TransferSyntax::ImplicitVRLittleEndian );
+  ret += TestTrailingPadding( tmpdir, gdcm::TransferSyntax::ExplicitVRLittleEndian );
+  ret += TestTrailingPadding( tmpdir, gdcm::TransferSyntax::ImplicitVRLittleEndian );
+  return ret;
+}
@@ -0,0 +1,182 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFileChangeTransferSyntax.h"
+#include "gdcmImageWriter.h"
+#include "gdcmImageReader.h"
+#include "gdcmImageChangeTransferSyntax.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+const unsigned int Dims[3] = { 40, 30, 7 };
+
+std::string TempDir()
+{
+  const char subdir[] = "TestFileChangeTransferSyntax5";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  return tmpdir + "/";
+}
+
+bool WriteImage(const std::string &filename, gdcm::PixelFormat const &pf,
+  gdcm::PhotometricInterpretation::PIType pi, std::vector<char> &pixels,
+  gdcm::TransferSyntax::TSType ts)
+{
+  gdcm::SmartPointer<gdcm::Image> im = new gdcm::Image;
+  im->SetNumberOfDimensions( 3 );
+  im->SetDimensions( Dims );
+  im->SetPixelFormat( pf );
+  im->SetPhotometricInterpretation( pi );
+  pixels.resize( im->GetBufferLength() );
+  const size_t framelen = pixels.size() / Dims[2];
+  for( size_t i = 0; i < pixels.size(); ++i )
+    {
+    // frames compress to different sizes, keep within BitsStored
+    const size_t frame = i / framelen;
+    pixels[i] = (char)( ((i % (frame + 3)) * 5 + frame) & 0x0f );
+    }
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetByteValue( &pixels[0], (uint32_t)pixels.size() );
+  im->SetDataElement( pixeldata );
+  im->SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  gdcm::ImageChangeTransferSyntax change;
+  change.SetTransferSyntax( ts );
+  change.SetInput( *im );
+  if( !change.Change() ) return false;
+  gdcm::ImageWriter writer;
+  writer.SetImage( change.GetOutput() );
+  writer.SetFileName( filename.c_str() );
+  return writer.Write();
+}
+
+int Transcode(const std::string &in, const std::string &out,
+  gdcm::TransferSyntax::TSType ts, unsigned int nthreads, size_t maxmem)
+{
+  gdcm::FileChangeTransferSyntax fcts;
+  fcts.SetTransferSyntax( ts );
+  fcts.SetNumberOfThreads( nthreads );
+  fcts.SetMaximumMemory( maxmem );
+  fcts.SetInputFileName( in.c_str() );
+  fcts.SetOutputFileName( out.c_str() );
+  if( !fcts.Change() )
+    {
+    std::cerr << "Could not transcode " << in << " to " << out << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+int CheckFile(const std::string &filename, gdcm::TransferSyntax::TSType ts,
+  std::vector<char> const &pixels, unsigned int pc = 0)
+{
+  gdcm::ImageReader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.Read() ) return 1;
+  const gdcm::Image &img = reader.GetImage();
+  if( img.GetTransferSyntax() != ts )
+    {
+    std::cerr << "Wrong transfer syntax for " << filename << std::endl;
+    return 1;
+    }
+  if( img.GetPlanarConfiguration() != pc ) return 1;
+  std::vector<char> decoded( img.GetBufferLength() );
+  if( decoded.size() != pixels.size() || !img.GetBuffer( &decoded[0] ) ) return 1;
+  if( decoded != pixels )
+    {
+    std::cerr << "Wrong pixels for " << filename << std::endl;
+    return 1;
+    }
+  return 0;
+}
+
+std::string ReadFile(const std::string &filename)
+{
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+}
+
+int TestFileChangeTransferSyntax5(int, char *[])
+{
+  const std::string tmpdir = TempDir();
+  const size_t onemb = 1024 * 1024;
+  int ret = 0;
+
+  // 16 bits, 12 stored
+  gdcm::PixelFormat pf( gdcm::PixelFormat::UINT16 );
+  pf.SetBitsStored( 12 );
+  pf.SetHighBit( 11 );
+  std::vector<char> pixels;
+  const std::string raw = tmpdir + "raw.dcm";
+  if( !WriteImage( raw, pf, gdcm::PhotometricInterpretation::MONOCHROME2, pixels,
+      gdcm::TransferSyntax::ExplicitVRLittleEndian ) ) return 1;
+  const size_t framelen = pixels.size() / Dims[2];
+
+  // compress: memory cap for 2 frames at a time, uneven last batch
+  const std::string jls = tmpdir + "jpegls.dcm";
+  ret += Transcode( raw, jls, gdcm::TransferSyntax::JPEGLSLossless, 3, 6 * framelen );
+  ret += CheckFile( jls, gdcm::TransferSyntax::JPEGLSLossless, pixels );
+  const std::string jpeg = tmpdir + "jpeg.dcm";
+  ret += Transcode( raw, jpeg, gdcm::TransferSyntax::JPEGLosslessProcess14_1, 4, onemb );
+  ret += CheckFile( jpeg, gdcm::TransferSyntax::JPEGLosslessProcess14_1, pixels );
+
+  // encapsulated to encapsulated, output does not depend on the number of threads
+  const std::string j2k1 = tmpdir + "j2k1.dcm";
+  const std::string j2k4 = tmpdir + "j2k4.dcm";
+  ret += Transcode( jls, j2k1, gdcm::TransferSyntax::JPEG2000Lossless, 1, onemb );
+  ret += Transcode( jls, j2k4, gdcm::TransferSyntax::JPEG2000Lossless, 4, 1 );
+  ret += CheckFile( j2k4, gdcm::TransferSyntax::JPEG2000Lossless, pixels );
+  if( ReadFile( j2k1 ) != ReadFile( j2k4 ) )
+    {
+    std::cerr << "Output depends on the number of threads" << std::endl;
+    ++ret;
+    }
+  const std::string rle = tmpdir + "rle.dcm";
+  ret += Transcode( j2k4, rle, gdcm::TransferSyntax::RLELossless, 2, onemb );
+  ret += CheckFile( rle, gdcm::TransferSyntax::RLELossless, pixels );
+
+  // decompress
+  const std::string explicitle = tmpdir + "explicit.dcm";
+  ret += Transcode( jpeg, explicitle, gdcm::TransferSyntax::ExplicitVRLittleEndian, 0, onemb );
+  ret += CheckFile( explicitle, gdcm::TransferSyntax::ExplicitVRLittleEndian, pixels );
+  const std::string implicitle = tmpdir + "implicit.dcm";
+  ret += Transcode( rle, implicitle, gdcm::TransferSyntax::ImplicitVRLittleEndian, 3, 1 );
+  ret += CheckFile( implicitle, gdcm::TransferSyntax::ImplicitVRLittleEndian, pixels );
+
+  // RGB, planar RLE input is interleaved for the JPEG-LS encoder
+  std::vector<char> rgb;
+  const std::string rgbrle = tmpdir + "rgbrle.dcm";
+  gdcm::PixelFormat rgbpf( gdcm::PixelFormat::UINT8 );
+  rgbpf.SetSamplesPerPixel( 3 );
+  if( !WriteImage( rgbrle, rgbpf, gdcm::PhotometricInterpretation::RGB, rgb,
+      gdcm::TransferSyntax::RLELossless ) ) return 1;
+  const std::string rgbjls = tmpdir + "rgbjpegls.dcm";
+  ret += Transcode( rgbrle, rgbjls, gdcm::TransferSyntax::JPEGLSLossless, 2, onemb );
+  ret += CheckFile( rgbjls, gdcm::TransferSyntax::JPEGLSLossless, rgb );
+  const std::string rgbraw = tmpdir + "rgbraw.dcm";
+  ret += Transcode( rgbjls, rgbraw, gdcm::TransferSyntax::ExplicitVRLittleEndian, 2, onemb );
+  ret += CheckFile( rgbraw, gdcm::TransferSyntax::ExplicitVRLittleEndian, rgb );
+
+  return ret;
+}
@@ -0,0 +1,103 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#ifndef TESTFIXTURE_H
+#define TESTFIXTURE_H
+
+// Helpers shared by the tests which build their input files from scratch
+// (they do not need gdcmData)
+#include "gdcmDataSet.h"
+#include "gdcmSequenceOfItems.h"
+#include "gdcmCryptographicMessageSyntax.h"
+#include "gdcmWriter.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace TestFixture
+{
+// Insert t with value, padded to an even length (with a NUL for UI, a space
+// otherwise)
+inline void Insert(gdcm::DataSet &ds, gdcm::Tag const &t, gdcm::VR const &vr,
+  std::string value)
+{
+  if( value.size() % 2 ) value.push_back( vr == gdcm::VR::UI ? 0 : ' ' );
+  gdcm::DataElement de( t );
+  de.SetVR( vr );
+  de.SetByteValue( value.c_str(), (uint32_t)value.size() );
+  ds.Insert( de );
+}
+
+// Insert t as a sequence of undefined length, one item per data set
+inline void InsertSQ(gdcm::DataSet &ds, gdcm::Tag const &t,
+  std::vector<gdcm::DataSet> const &items)
+{
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sq = new gdcm::SequenceOfItems;
+  sq->SetLengthToUndefined();
+  for( size_t i = 0; i < items.size(); ++i )
+    {
+    gdcm::Item item;
+    item.SetVLToUndefined();
+    item.SetNestedDataSet( items[i] );
+    sq->AddItem( item );
+    }
+  gdcm::DataElement de( t );
+  de.SetVR( gdcm::VR::SQ );
+  de.SetValue( *sq );
+  de.SetVLToUndefined();
+  ds.Insert( de );
+}
+
+inline void InsertSQ(gdcm::DataSet &ds, gdcm::Tag const &t,
+  gdcm::DataSet const &item)
+{
+  InsertSQ( ds, t, std::vector<gdcm::DataSet>( 1, item ) );
+}
+
+// Write ds (and its File Meta Information) to filename
+inline bool Write(const std::string &filename, gdcm::DataSet const &ds,
+  gdcm::TransferSyntax::TSType ts = gdcm::TransferSyntax::ExplicitVRLittleEndian)
+{
+  gdcm::Writer w;
+  w.GetFile().SetDataSet( ds );
+  w.GetFile().GetHeader().SetDataSetTransferSyntax( ts );
+  w.SetFileName( filename.c_str() );
+  return w.Write();
+}
+
+// Not encrypted at all, but enough to check the attributes are restored
+class PassThroughCMS : public gdcm::CryptographicMessageSyntax
+{
+public:
+  bool ParseCertificateFile( const char * ) override { return true; }
+  bool ParseKeyFile( const char * ) override { return true; }
+  bool SetPassword(const char *, size_t ) override { return true; }
+  bool Encrypt(char *output, size_t &outlen, const char *array, size_t len) const override
+    {
+    if( outlen < len ) return false;
+    memcpy( output, array, len );
+    outlen = len;
+    return true;
+    }
+  bool Decrypt(char *output, size_t &outlen, const char *array, size_t len) const override
+    {
+    return Encrypt( output, outlen, array, len );
+    }
+  void SetCipherType(CipherTypes ) override {}
+  CipherTypes GetCipherType() const override { return AES256_CIPHER; }
+};
+
+} // end namespace TestFixture
+
+#endif //TESTFIXTURE_H
@@ -0,0 +1,140 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmFrameIndex.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmDataSet.h"
+#include "gdcmSwapper.h"
+
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+const unsigned int NumberOfFrames = 5;
+
+// Content of frame i: the frame number repeated, prefixed by a JPEG SOI marker
+std::string MakeFrame(unsigned int i)
+{
+  std::string frame( "\xFF\xD8" );
+  frame.append( 10 + 2 * i, (char)('a' + i) );
+  return frame;
+}
+
+void AddFrame(gdcm::SequenceOfFragments &sq, unsigned int i, unsigned int nfrags)
+{
+  const std::string frame = MakeFrame( i );
+  // fragments have an even length
+  const size_t len = (frame.size() / nfrags) & ~(size_t)1;
+  for( unsigned int f = 0; f < nfrags; ++f )
+    {
+    const size_t off = f * len;
+    const size_t size = (f == nfrags - 1) ? frame.size() - off : len;
+    gdcm::Fragment frag;
+    frag.SetByteValue( frame.data() + off, (uint32_t)size );
+    sq.AddFragment( frag );
+    }
+}
+
+int CheckFrames(std::istream &is, gdcm::FrameIndex const &index)
+{
+  if( index.GetNumberOfFrames() != NumberOfFrames ) return 1;
+  // random order access
+  for( unsigned int i = NumberOfFrames; i > 0; --i )
+    {
+    std::vector<char> buffer;
+    if( !index.ReadFrame( is, i - 1, buffer ) ) return 1;
+    const std::string ref = MakeFrame( i - 1 );
+    if( buffer.size() < ref.size() ) return 1;
+    // fragments are padded to an even length
+    if( memcmp( &buffer[0], ref.data(), ref.size() ) != 0 ) return 1;
+    }
+  return 0;
+}
+
+int TestOne(unsigned int nfrags, bool usebot, bool useeot)
+{
+  gdcm::SmartPointer<gdcm::SequenceOfFragments> sq = new gdcm::SequenceOfFragments;
+  for( unsigned int i = 0; i < NumberOfFrames; ++i )
+    AddFrame( *sq, i, nfrags );
+
+  // compute offsets of each frame relative to the first fragment
+  std::vector<uint32_t> offsets;
+  uint32_t offset = 0;
+  for( unsigned int i = 0; i < sq->GetNumberOfFragments(); ++i )
+    {
+    if( i % nfrags == 0 ) offsets.push_back( offset );
+    offset += 8 + (uint32_t)sq->GetFragment( i ).GetVL();
+    }
+  if( usebot )
+    {
+    // offset tables are always little endian
+    std::vector<uint32_t> bot( offsets );
+    gdcm::SwapperNoOp::SwapArray( &bot[0], bot.size() );
+    sq->GetTable().SetByteValue( (char*)&bot[0],
+      (uint32_t)(bot.size() * sizeof(uint32_t)) );
+    }
+  gdcm::DataSet ds;
+  if( useeot )
+    {
+    std::vector<uint64_t> eot( offsets.begin(), offsets.end() );
+    gdcm::SwapperNoOp::SwapArray( &eot[0], eot.size() );
+    gdcm::DataElement de( gdcm::Tag(0x7fe0,0x0001) );
+    de.SetVR( gdcm::VR::OV );
+    de.SetByteValue( (char*)&eot[0], (uint32_t)(eot.size() * sizeof(uint64_t)) );
+    ds.Insert( de );
+    }
+
+  std::stringstream ss;
+  ss << "junk"; // Pixel Data does not start at 0
+  sq->Write<gdcm::SwapperNoOp>( ss );
+  ss.seekg( 4, std::ios::beg );
+
+  gdcm::FrameIndex index;
+  if( !index.Build( ss, NumberOfFrames, useeot ? &ds : nullptr ) ) return 1;
+  if( ss.tellg() != 4 ) return 1;
+  const gdcm::FrameIndex::SourceType expected =
+    useeot ? gdcm::FrameIndex::EXTENDED_OFFSET_TABLE :
+    usebot ? gdcm::FrameIndex::BASIC_OFFSET_TABLE : gdcm::FrameIndex::FRAGMENT_SCAN;
+  if( index.GetSource() != expected )
+    {
+    std::cerr << "Wrong source: " << index.GetSource() << std::endl;
+    return 1;
+    }
+  return CheckFrames( ss, index );
+}
+}
+
+int TestFrameIndex(int, char *[])
+{
+  int ret = 0;
+  // one fragment per frame
+  ret += TestOne( 1, false, false );
+  ret += TestOne( 1, true, false );
+  ret += TestOne( 1, false, true );
+  // frames spanning multiple fragments
+  ret += TestOne( 3, false, false );
+  ret += TestOne( 3, true, false );
+  ret += TestOne( 3, true, true );
+
+  // not enough frames in the stream
+  gdcm::SmartPointer<gdcm::SequenceOfFragments> sq = new gdcm::SequenceOfFragments;
+  AddFrame( *sq, 0, 1 );
+  std::stringstream ss;
+  sq->Write<gdcm::SwapperNoOp>( ss );
+  ss.seekg( 0, std::ios::beg );
+  gdcm::FrameIndex index;
+  if( index.Build( ss, NumberOfFrames ) || index.IsValid() ) ++ret;
+
+  return ret;
+}
@@ -0,0 +1,254 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmIPPSorter.h"
+#include "gdcmSerieHelper.h"
+#include "gdcmAttribute.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <algorithm>
+#include <sstream>
+
+// Sort a synthetic series, reading only the headers (in parallel)
+namespace
+{
+using TestFixture::Insert;
+
+const gdcm::Tag PixelData(0x7fe0,0x0010);
+const gdcm::Tag PatientName(0x0010,0x0010);
+const unsigned int NumberOfSlices = 5;
+// Slice i is at z = Positions[i], and has Instance Number NumberOfSlices - i
+const double Positions[NumberOfSlices] = { 5, -2.5, 2.5, 0, 7.5 };
+
+bool WriteFile(const std::string &filename, unsigned int i, bool pixeldata)
+{
+  gdcm::DataSet ds;
+  std::ostringstream uid;
+  uid << "1.2.3.4.5.6." << i;
+  std::ostringstream in;
+  in << NumberOfSlices - i;
+  std::ostringstream ipp;
+  ipp << "0\\0\\" << (i < NumberOfSlices ? Positions[i] : 0.);
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.2" );
+  Insert( ds, gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, uid.str() );
+  Insert( ds, gdcm::Tag(0x0008,0x0060), gdcm::VR::CS, "CT" );
+  Insert( ds, PatientName, gdcm::VR::PN, "Doe^John" );
+  Insert( ds, gdcm::Tag(0x0020,0x000d), gdcm::VR::UI, "1.2.3.4" );
+  Insert( ds, gdcm::Tag(0x0020,0x000e), gdcm::VR::UI, "1.2.3.4.5" );
+  Insert( ds, gdcm::Tag(0x0020,0x0013), gdcm::VR::IS, in.str() );
+  Insert( ds, gdcm::Tag(0x0020,0x0032), gdcm::VR::DS, ipp.str() );
+  Insert( ds, gdcm::Tag(0x0020,0x0037), gdcm::VR::DS, "1\\0\\0\\0\\1\\0" );
+  Insert( ds, gdcm::Tag(0x0020,0x0052), gdcm::VR::UI, "1.2.3.4.6" );
+  if( pixeldata )
+    {
+    const char pixels[8] = { 1, 0, 2, 0, 3, 0, 4, 0 };
+    gdcm::DataElement pd( PixelData );
+    pd.SetVR( gdcm::VR::OW );
+    pd.SetByteValue( pixels, (uint32_t)sizeof(pixels) );
+    ds.Insert( pd );
+    }
+  return TestFixture::Write( filename, ds );
+}
+
+// Copy of filename, with an empty t
+bool WriteEmpty(const std::string &filename, gdcm::Tag const &t,
+  const std::string &outfilename)
+{
+  gdcm::Reader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.Read() ) return false;
+  gdcm::DataSet ds = reader.GetFile().GetDataSet();
+  gdcm::DataElement de( t );
+  de.SetVR( gdcm::VR::DS );
+  ds.Replace( de );
+  return TestFixture::Write( outfilename, ds );
+}
+
+bool SortByInstanceNumber(gdcm::DataSet const &ds1, gdcm::DataSet const &ds2)
+{
+  gdcm::Attribute<0x0020,0x0013> in1, in2;
+  in1.SetFromDataSet( ds1 );
+  in2.SetFromDataSet( ds2 );
+  return in1.GetValue() < in2.GetValue();
+}
+
+// Indexes of the slices, sorted along z
+std::vector<std::string> Expected(std::vector<std::string> const &filenames)
+{
+  std::vector<std::string> expected;
+  const unsigned int order[NumberOfSlices] = { 1, 3, 2, 0, 4 };
+  for( unsigned int i = 0; i < NumberOfSlices; ++i )
+    expected.push_back( filenames[ order[i] ] );
+  return expected;
+}
+}
+
+int TestIPPSorter4(int , char *[])
+{
+  const char subdir[] = "TestIPPSorter4";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  // The slices, and a file without Pixel Data (nor position) last
+  std::vector<std::string> filenames;
+  for( unsigned int i = 0; i <= NumberOfSlices; ++i )
+    {
+    std::ostringstream os;
+    os << tmpdir << "/slice" << i << ".dcm";
+    filenames.push_back( os.str() );
+    if( !WriteFile( filenames.back(), i, i < NumberOfSlices ) )
+      {
+      std::cerr << "Could not write: " << filenames.back() << std::endl;
+      return 1;
+      }
+    }
+  const std::string nopixeldata = filenames.back();
+  filenames.pop_back();
+  const std::vector<std::string> expected = Expected( filenames );
+
+  // Same result with one thread, several threads and read-ahead
+  for( unsigned int nthreads = 1; nthreads <= 4; ++nthreads )
+    {
+    gdcm::IPPSorter s;
+    s.SetComputeZSpacing( true );
+    s.SetZSpacingTolerance( 1e-3 );
+    if( nthreads == 4 )
+      s.SetReadAhead( 2 );
+    else
+      s.SetNumberOfThreads( nthreads );
+    if( !s.Sort( filenames ) )
+      {
+      std::cerr << "IPPSorter failed with " << nthreads << " threads" << std::endl;
+      return 1;
+      }
+    if( s.GetFilenames() != expected || s.GetZSpacing() != 2.5 )
+      {
+      std::cerr << "Wrong IPP order or spacing: " << s.GetZSpacing() << std::endl;
+      return 1;
+      }
+    }
+
+  // A file with an empty Image Position (Patient) is skipped, an empty Image
+  // Orientation (Patient) cannot be used
+  const std::string emptydir = gdcm::Testing::GetTempDirectory( "TestIPPSorter4_empty" );
+  if( !gdcm::System::FileIsDirectory( emptydir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( emptydir.c_str() );
+    }
+  std::vector<std::string> emptyipp( filenames ), emptyiop( filenames );
+  emptyipp[0] = emptydir + "/emptyipp.dcm";
+  emptyiop.back() = emptydir + "/emptyiop.dcm";
+  if( !WriteEmpty( filenames[0], gdcm::Tag(0x0020,0x0032), emptyipp[0] )
+    || !WriteEmpty( filenames.back(), gdcm::Tag(0x0020,0x0037), emptyiop.back() ) )
+    {
+    std::cerr << "Could not write the files with an empty attribute" << std::endl;
+    return 1;
+    }
+  std::vector<std::string> expectedipp( expected );
+  expectedipp.erase( std::find( expectedipp.begin(), expectedipp.end(), filenames[0] ) );
+    {
+    gdcm::IPPSorter s;
+    s.SetNumberOfThreads( 2 );
+    if( !s.Sort( emptyipp ) || s.GetFilenames() != expectedipp )
+      {
+      std::cerr << "Wrong IPP order with an empty IPP" << std::endl;
+      return 1;
+      }
+    if( s.Sort( emptyiop ) )
+      {
+      std::cerr << "Sorted with an empty IOP" << std::endl;
+      return 1;
+      }
+    s.SetDirectionCosinesTolerance( 1e-6 );
+    if( s.Sort( emptyiop ) )
+      {
+      std::cerr << "Sorted with an empty IOP and a tolerance" << std::endl;
+      return 1;
+      }
+    }
+
+  // Headers only: the Pixel Data element is there, but empty
+  std::vector<std::string> all = filenames;
+  all.push_back( nopixeldata );
+  gdcm::Sorter sorter;
+  sorter.SetNumberOfThreads( 3 );
+  std::vector<int> state( all.size(), -1 );
+  if( !sorter.ReadFiles( all, std::set<gdcm::Tag>(),
+      [&state]( size_t i, gdcm::File const *file ) {
+        if( !file ) return false;
+        const gdcm::DataSet &ds = file->GetDataSet();
+        state[i] = ds.FindDataElement( PixelData ) ?
+          ( ds.GetDataElement( PixelData ).IsEmpty() ? 1 : 2 ) : 0;
+        return true;
+      } ) )
+    {
+    std::cerr << "Could not read the headers" << std::endl;
+    return 1;
+    }
+  for( size_t i = 0; i < all.size(); ++i )
+    {
+    if( state[i] != ( i < NumberOfSlices ? 1 : 0 ) )
+      {
+      std::cerr << "Wrong Pixel Data state for: " << all[i] << ": " << state[i] << std::endl;
+      return 1;
+      }
+    }
+
+  sorter.SetSortFunction( SortByInstanceNumber );
+  if( !sorter.Sort( all ) || sorter.GetFilenames().size() != all.size()
+    || sorter.GetFilenames().front() != nopixeldata
+    || sorter.GetFilenames().back() != all[0] )
+    {
+    std::cerr << "Wrong Instance Number order" << std::endl;
+    return 1;
+    }
+
+  // The file without Pixel Data is not part of the series, same result
+  // with the files read in parallel or with read-ahead
+  for( unsigned int readahead = 0; readahead <= 2; readahead += 2 )
+    {
+    gdcm::SerieHelper sh;
+    sh.SetReadAhead( readahead );
+    sh.SetDirectory( tmpdir );
+    gdcm::FileList *fl = sh.GetFirstSingleSerieUIDFileSet();
+    if( !fl || fl->size() != NumberOfSlices || sh.GetNextSingleSerieUIDFileSet() )
+      {
+      std::cerr << "Wrong series with read-ahead " << readahead << std::endl;
+      return 1;
+      }
+    sh.OrderFileList( fl );
+    for( unsigned int i = 0; i < NumberOfSlices; ++i )
+      {
+      const gdcm::FileWithName &f = *(*fl)[i];
+      if( f.filename != expected[i] )
+        {
+        std::cerr << "Wrong SerieHelper order: " << f.filename << std::endl;
+        return 1;
+        }
+      // The whole header is kept, the Pixel Data without its value
+      if( !f.GetDataSet().FindDataElement( PatientName )
+        || !f.GetDataSet().GetDataElement( gdcm::Tag(0x7fe0,0x0010) ).IsEmpty() )
+        {
+        std::cerr << "Wrong header in: " << f.filename << std::endl;
+        return 1;
+        }
+      }
+    }
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmIPPSorter.h"
+#include "gdcmScanner.h"
+#include "gdcmReader.h"
+#include "gdcmAttribute.h"
+#include "gdcmDirectionCosines.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+
+#include <map>
+
+// Sort the series of gdcmData with an IPPSorter reading the keys on one
+// thread, on several threads and with read-ahead, and check the order with
+// the positions read by a plain Reader
+namespace
+{
+typedef std::map< std::string, std::vector<std::string> > SeriesType;
+
+// The files of sorted are in increasing distance along the normal of the first
+bool IsSorted(std::vector<std::string> const &sorted)
+{
+  double normal[3] = {};
+  double prev = 0;
+  for( size_t i = 0; i < sorted.size(); ++i )
+    {
+    gdcm::Reader reader;
+    reader.SetFileName( sorted[i].c_str() );
+    if( !reader.Read() ) return false;
+    const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+    gdcm::Attribute<0x0020,0x0032> ipp;
+    ipp.SetFromDataSet( ds );
+    if( i == 0 )
+      {
+      gdcm::Attribute<0x0020,0x0037> iop;
+      iop.SetFromDataSet( ds );
+      gdcm::DirectionCosines dc( iop.GetValues() );
+      dc.Cross( normal );
+      }
+    double dist = 0;
+    for( int j = 0; j < 3; ++j ) dist += normal[j] * ipp[j];
+    if( i && dist <= prev ) return false;
+    prev = dist;
+    }
+  return true;
+}
+
+int TestSeries(std::string const &uid, std::vector<std::string> const &filenames,
+  int &nsorted)
+{
+  gdcm::IPPSorter ref;
+  ref.SetComputeZSpacing( true );
+  ref.SetNumberOfThreads( 1 );
+  const bool b = ref.Sort( filenames );
+  if( b )
+    {
+    ++nsorted;
+    if( ref.GetFilenames().empty() || ref.GetFilenames().size() > filenames.size()
+      || !IsSorted( ref.GetFilenames() ) )
+      {
+      std::cerr << "Wrong IPP order for series: " << uid << std::endl;
+      return 1;
+      }
+    }
+  for( unsigned int n = 0; n < 2; ++n )
+    {
+    gdcm::IPPSorter s;
+    s.SetComputeZSpacing( true );
+    if( n == 0 )
+      s.SetNumberOfThreads( 4 );
+    else
+      s.SetReadAhead( 2 );
+    if( s.Sort( filenames ) != b
+      || ( b && ( s.GetFilenames() != ref.GetFilenames()
+          || s.GetZSpacing() != ref.GetZSpacing() ) ) )
+      {
+      std::cerr << "Different result " << (n ? "with read-ahead" : "with 4 threads")
+        << " for series: " << uid << std::endl;
+      return 1;
+      }
+    }
+  return 0;
+}
+}
+
+int TestIPPSorter5(int, char *[])
+{
+  gdcm::Trace::DebugOff();
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  std::vector<std::string> filenames;
+  const char *filename;
+  for( unsigned int i = 0; (filename = gdcm::Testing::GetFileName( i )); ++i )
+    filenames.push_back( filename );
+
+  const gdcm::Tag tseries(0x0020,0x000e); // Series Instance UID
+  gdcm::Scanner scanner;
+  scanner.AddTag( tseries );
+  if( !scanner.Scan( filenames ) ) return 1;
+  SeriesType series;
+  for( size_t i = 0; i < filenames.size(); ++i )
+    {
+    const char *uid = scanner.GetValue( filenames[i].c_str(), tseries );
+    if( uid && *uid ) series[ uid ].push_back( filenames[i] );
+    }
+
+  int ret = 0, nsorted = 0;
+  for( SeriesType::const_iterator it = series.begin(); it != series.end(); ++it )
+    {
+    ret += TestSeries( it->first, it->second, nsorted );
+    }
+  std::cout << series.size() << " series, " << nsorted << " sorted" << std::endl;
+  if( !nsorted ) return 1;
+
+  return ret;
+}
@@ -0,0 +1,159 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageHelper.h"
+#include "gdcmFile.h"
+#include "TestFixture.h"
+
+#include <sstream>
+
+// Per-frame geometry of a synthetic Enhanced CT Image, without any input file
+namespace
+{
+using TestFixture::Insert;
+using TestFixture::InsertSQ;
+
+const unsigned int NumberOfFrames = 4;
+
+// A functional group: a sequence of one item, holding one or two attributes
+void InsertGroup(gdcm::DataSet &ds, gdcm::Tag const &sq,
+  gdcm::Tag const &t1, std::string const &v1,
+  gdcm::Tag const &t2 = gdcm::Tag(), std::string const &v2 = "")
+{
+  gdcm::DataSet item;
+  Insert( item, t1, gdcm::VR::DS, v1 );
+  if( !v2.empty() ) Insert( item, t2, gdcm::VR::DS, v2 );
+  InsertSQ( ds, sq, std::vector<gdcm::DataSet>( 1, item ) );
+}
+
+const gdcm::Tag PlanePosition(0x0020,0x9113);
+const gdcm::Tag PlaneOrientation(0x0020,0x9116);
+const gdcm::Tag PixelMeasures(0x0028,0x9110);
+const gdcm::Tag PixelValueTransformation(0x0028,0x9145);
+
+void MakeEnhancedCT(gdcm::File &f, bool sharedorientation,
+  bool sharedposition = false)
+{
+  gdcm::DataSet &ds = f.GetDataSet();
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.2.1" );
+  Insert( ds, gdcm::Tag(0x0020,0x0037), gdcm::VR::DS, "0\\1\\0\\0\\0\\-1" );
+  gdcm::DataSet shared;
+  InsertGroup( shared, PixelMeasures, gdcm::Tag(0x0028,0x0030), "0.5\\0.25",
+    gdcm::Tag(0x0018,0x0088), "3" );
+  if( sharedorientation )
+    InsertGroup( shared, PlaneOrientation, gdcm::Tag(0x0020,0x0037), "1\\0\\0\\0\\1\\0" );
+  if( sharedposition )
+    InsertGroup( shared, PlanePosition, gdcm::Tag(0x0020,0x0032), "-10\\20.5\\0" );
+  InsertSQ( ds, gdcm::Tag(0x5200,0x9229), std::vector<gdcm::DataSet>( 1, shared ) );
+  std::vector<gdcm::DataSet> perframe( NumberOfFrames );
+  for( unsigned int i = 0; i < NumberOfFrames; ++i )
+    {
+    std::ostringstream ipp, intercept, slope;
+    ipp << "-10\\20.5\\" << 2 * i;
+    intercept << -1.5 * i;
+    slope << i + 1;
+    if( !sharedposition )
+      InsertGroup( perframe[i], PlanePosition, gdcm::Tag(0x0020,0x0032), ipp.str() );
+    InsertGroup( perframe[i], PixelValueTransformation,
+      gdcm::Tag(0x0028,0x1052), intercept.str(),
+      gdcm::Tag(0x0028,0x1053), slope.str() );
+    }
+  InsertSQ( ds, gdcm::Tag(0x5200,0x9230), perframe );
+}
+}
+
+int TestImageHelper4(int, char *[])
+{
+  gdcm::File f;
+  MakeEnhancedCT( f, true );
+
+  std::vector<gdcm::FrameGeometry> frames;
+  if( !gdcm::ImageHelper::GetFrameGeometryValues( f, frames )
+    || frames.size() != NumberOfFrames )
+    {
+    std::cerr << "Wrong number of frames: " << frames.size() << std::endl;
+    return 1;
+    }
+  int ret = 0;
+  for( unsigned int i = 0; i < NumberOfFrames; ++i )
+    {
+    const gdcm::FrameGeometry &fg = frames[i];
+    if( fg.Origin[0] != -10 || fg.Origin[1] != 20.5 || fg.Origin[2] != 2 * i
+      || fg.DirectionCosines[0] != 1 || fg.DirectionCosines[4] != 1
+      || fg.Spacing[0] != 0.25 || fg.Spacing[1] != 0.5 || fg.Spacing[2] != 3
+      || fg.Intercept != -1.5 * i || fg.Slope != i + 1 )
+      {
+      std::cerr << "Wrong geometry for frame #" << i << std::endl;
+      ++ret;
+      }
+    }
+
+  // The file level values are the ones of the first frame
+  const std::vector<double> origin = gdcm::ImageHelper::GetOriginValue( f );
+  const std::vector<double> dircos = gdcm::ImageHelper::GetDirectionCosinesValue( f );
+  const std::vector<double> spacing = gdcm::ImageHelper::GetSpacingValue( f );
+  const std::vector<double> is = gdcm::ImageHelper::GetRescaleInterceptSlopeValue( f );
+  if( origin[0] != -10 || origin[1] != 20.5 || origin[2] != 0 )
+    {
+    std::cerr << "Wrong origin" << std::endl;
+    ++ret;
+    }
+  if( dircos[0] != 1 || dircos[1] != 0 || dircos[4] != 1 )
+    {
+    std::cerr << "Wrong direction cosines" << std::endl;
+    ++ret;
+    }
+  // Z spacing comes from the positions, not from Spacing Between Slices
+  if( spacing.size() != 3 || spacing[0] != 0.25 || spacing[1] != 0.5 || spacing[2] != 2 )
+    {
+    std::cerr << "Wrong spacing" << std::endl;
+    ++ret;
+    }
+  if( is.size() != 2 || is[0] != 0 || is[1] != 1 )
+    {
+    std::cerr << "Wrong intercept/slope" << std::endl;
+    ++ret;
+    }
+
+  // Without a Plane Orientation Sequence, use the top level orientation
+  gdcm::File f2;
+  MakeEnhancedCT( f2, false );
+  if( !gdcm::ImageHelper::GetFrameGeometryValues( f2, frames )
+    || frames.size() != NumberOfFrames
+    || frames[NumberOfFrames-1].DirectionCosines[1] != 1
+    || frames[NumberOfFrames-1].DirectionCosines[5] != -1 )
+    {
+    std::cerr << "Wrong fallback direction cosines" << std::endl;
+    ++ret;
+    }
+
+  // A position shared by all the frames gives no Z spacing
+  gdcm::File f4;
+  MakeEnhancedCT( f4, true, true );
+  const std::vector<double> spacing4 = gdcm::ImageHelper::GetSpacingValue( f4 );
+  if( spacing4.size() != 3 || spacing4[0] != 1 || spacing4[1] != 1 || spacing4[2] != 1 )
+    {
+    std::cerr << "Wrong spacing with a shared position" << std::endl;
+    ++ret;
+    }
+
+  // No functional groups
+  gdcm::File f3;
+  if( gdcm::ImageHelper::GetFrameGeometryValues( f3, frames ) || !frames.empty() )
+    {
+    std::cerr << "Unexpected frames" << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageHelper.h"
+#include "gdcmReader.h"
+#include "gdcmAttribute.h"
+#include "gdcmSequenceOfItems.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+
+// Per-frame geometry of the enhanced multi-frame images of gdcmData, checked
+// against a walk of the functional groups of each frame
+namespace
+{
+const gdcm::Tag SharedFG(0x5200,0x9229);
+const gdcm::Tag PerFrameFG(0x5200,0x9230);
+
+// The attribute t of the functional group sq of item, or nullptr
+const gdcm::DataElement *FindInGroup(const gdcm::DataSet &item,
+  gdcm::Tag const &sq, gdcm::Tag const &t)
+{
+  if( !item.FindDataElement( sq ) ) return nullptr;
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sqi = item.GetDataElement( sq ).GetValueAsSQ();
+  if( !sqi || !sqi->GetNumberOfItems() ) return nullptr;
+  const gdcm::DataSet &subds = sqi->GetItem(1).GetNestedDataSet();
+  if( !subds.FindDataElement( t ) ) return nullptr;
+  return &subds.GetDataElement( t );
+}
+
+// The attribute t of the functional group sq for one frame: the shared item
+// wins over the frame's own item
+const gdcm::DataElement *FindForFrame(const gdcm::DataSet *shared,
+  const gdcm::DataSet *perframe, gdcm::Tag const &sq, gdcm::Tag const &t)
+{
+  const gdcm::DataElement *de = shared ? FindInGroup( *shared, sq, t ) : nullptr;
+  if( !de && perframe ) de = FindInGroup( *perframe, sq, t );
+  return de;
+}
+
+const gdcm::DataSet *GetItem(const gdcm::DataSet &ds, gdcm::Tag const &t,
+  gdcm::SequenceOfItems::SizeType i)
+{
+  if( !ds.FindDataElement( t ) ) return nullptr;
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sqi = ds.GetDataElement( t ).GetValueAsSQ();
+  if( !sqi || sqi->GetNumberOfItems() < i ) return nullptr;
+  return &sqi->GetItem( i ).GetNestedDataSet();
+}
+
+bool CheckFrame(const gdcm::DataSet &ds, const gdcm::DataSet *shared,
+  const gdcm::DataSet *perframe, gdcm::FrameGeometry const &fg)
+{
+  const gdcm::DataElement *de;
+  gdcm::Attribute<0x0020,0x0032> ipp = {{0,0,0}};
+  if( (de = FindForFrame( shared, perframe, gdcm::Tag(0x0020,0x9113), ipp.GetTag() )) )
+    ipp.SetFromDataElement( *de );
+  gdcm::Attribute<0x0020,0x0037> iop = {{1,0,0,0,1,0}};
+  if( (de = FindForFrame( shared, perframe, gdcm::Tag(0x0020,0x9116), iop.GetTag() )) )
+    iop.SetFromDataElement( *de );
+  else if( ds.FindDataElement( iop.GetTag() ) )
+    {
+    std::vector<double> dircos;
+    if( gdcm::ImageHelper::GetDirectionCosinesFromDataSet( ds, dircos ) )
+      iop.SetValues( dircos.data() );
+    }
+  gdcm::Attribute<0x0028,0x0030> ps = {{1,1}};
+  if( (de = FindForFrame( shared, perframe, gdcm::Tag(0x0028,0x9110), ps.GetTag() )) )
+    ps.SetFromDataElement( *de );
+  gdcm::Attribute<0x0018,0x0088> sbs = {1};
+  if( (de = FindForFrame( shared, perframe, gdcm::Tag(0x0028,0x9110), sbs.GetTag() )) )
+    sbs.SetFromDataElement( *de );
+  gdcm::Attribute<0x0028,0x1052> ri = {0};
+  gdcm::Attribute<0x0028,0x1053> rs = {1};
+  const gdcm::DataElement *dei = FindForFrame( shared, perframe, gdcm::Tag(0x0028,0x9145), ri.GetTag() );
+  const gdcm::DataElement *des = FindForFrame( shared, perframe, gdcm::Tag(0x0028,0x9145), rs.GetTag() );
+  if( dei && des )
+    {
+    ri.SetFromDataElement( *dei );
+    rs.SetFromDataElement( *des );
+    }
+
+  for( unsigned int i = 0; i < 3; ++i )
+    if( fg.Origin[i] != ipp[i] ) return false;
+  for( unsigned int i = 0; i < 6; ++i )
+    if( fg.DirectionCosines[i] != iop[i] ) return false;
+  return fg.Spacing[0] == ps[1] && fg.Spacing[1] == ps[0] && fg.Spacing[2] == sbs.GetValue()
+    && fg.Intercept == ri.GetValue() && fg.Slope == rs.GetValue();
+}
+
+int TestFrameGeometry(const char *filename, int &nfiles)
+{
+  gdcm::Reader reader;
+  reader.SetFileName( filename );
+  if( !reader.Read() ) return 0;
+  const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+
+  std::vector<gdcm::FrameGeometry> frames;
+  const bool b = gdcm::ImageHelper::GetFrameGeometryValues( reader.GetFile(), frames );
+  const gdcm::DataSet *shared = GetItem( ds, SharedFG, 1 );
+  const gdcm::DataSet *first = GetItem( ds, PerFrameFG, 1 );
+  if( b != ( shared || first ) )
+    {
+    std::cerr << "Wrong functional groups in: " << filename << std::endl;
+    return 1;
+    }
+  if( !b ) return 0;
+  ++nfiles;
+
+  size_t nframes = 1;
+  if( first )
+    nframes = ds.GetDataElement( PerFrameFG ).GetValueAsSQ()->GetNumberOfItems();
+  if( frames.size() != nframes )
+    {
+    std::cerr << "Wrong number of frames: " << frames.size() << " in: " << filename << std::endl;
+    return 1;
+    }
+  for( size_t i = 0; i < nframes; ++i )
+    {
+    const gdcm::DataSet *perframe =
+      GetItem( ds, PerFrameFG, (gdcm::SequenceOfItems::SizeType)(i + 1) );
+    if( !CheckFrame( ds, shared, perframe, frames[i] ) )
+      {
+      std::cerr << "Wrong geometry for frame #" << i << " in: " << filename << std::endl;
+      return 1;
+      }
+    }
+  return 0;
+}
+}
+
+int TestImageHelper5(int argc, char *argv[])
+{
+  int nfiles = 0;
+  if( argc == 2 )
+    {
+    const char *filename = argv[1];
+    return TestFrameGeometry( filename, nfiles );
+    }
+
+  // else
+  gdcm::Trace::DebugOff();
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  int r = 0, i = 0;
+  const char *filename;
+  const char * const *filenames = gdcm::Testing::GetFileNames();
+  while( (filename = filenames[i]) )
+    {
+    r += TestFrameGeometry( filename, nfiles );
+    ++i;
+    }
+  std::cout << nfiles << " files with functional groups" << std::endl;
+  if( !nfiles ) return 1;
+
+  return r;
+}
@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageRegionReader.h"
+#include "gdcmImageWriter.h"
+#include "gdcmImageChangeTransferSyntax.h"
+#include "gdcmJPEG2000Codec.h"
+#include "gdcmJPEG2000TileCache.h"
+#include "gdcmBoxRegion.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <cstring>
+
+namespace
+{
+const unsigned int Dims[3] = { 150, 100, 3 };
+const unsigned int TileSize = 32;
+
+uint16_t PixelValue(unsigned int x, unsigned int y, unsigned int z)
+{
+  return (uint16_t)( (x * 7 + y * 13 + z * 101) & 0x0fff );
+}
+
+int TestRegion(gdcm::ImageRegionReader &reader,
+  unsigned int xmin, unsigned int xmax, unsigned int ymin, unsigned int ymax,
+  unsigned int zmin, unsigned int zmax)
+{
+  gdcm::BoxRegion box;
+  box.SetDomain( xmin, xmax, ymin, ymax, zmin, zmax );
+  reader.SetRegion( box );
+  const size_t len = reader.ComputeBufferLength();
+  std::vector<uint16_t> buffer( len / 2 );
+  if( !reader.ReadIntoBuffer( (char*)&buffer[0], len ) )
+    {
+    std::cerr << "Could not read region" << std::endl;
+    return 1;
+    }
+  size_t i = 0;
+  for( unsigned int z = zmin; z <= zmax; ++z )
+    for( unsigned int y = ymin; y <= ymax; ++y )
+      for( unsigned int x = xmin; x <= xmax; ++x, ++i )
+        {
+        if( buffer[i] != PixelValue( x, y, z ) )
+          {
+          std::cerr << "Wrong value at " << x << "," << y << "," << z << ": "
+            << buffer[i] << std::endl;
+          return 1;
+          }
+        }
+  return 0;
+}
+}
+
+int TestImageRegionReaderJPEG2000(int, char *[])
+{
+  const char subdir[] = "TestImageRegionReaderJPEG2000";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  const std::string filename = tmpdir + "/tiled.dcm";
+
+  gdcm::SmartPointer<gdcm::Image> im = new gdcm::Image;
+  im->SetNumberOfDimensions( 3 );
+  im->SetDimensions( Dims );
+  gdcm::PixelFormat pf( gdcm::PixelFormat::UINT16 );
+  pf.SetBitsStored( 12 );
+  pf.SetHighBit( 11 );
+  im->SetPixelFormat( pf );
+  im->SetPhotometricInterpretation( gdcm::PhotometricInterpretation::MONOCHROME2 );
+  std::vector<uint16_t> pixels;
+  for( unsigned int z = 0; z < Dims[2]; ++z )
+    for( unsigned int y = 0; y < Dims[1]; ++y )
+      for( unsigned int x = 0; x < Dims[0]; ++x )
+        pixels.push_back( PixelValue( x, y, z ) );
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetByteValue( (char*)&pixels[0], (uint32_t)(pixels.size() * 2) );
+  im->SetDataElement( pixeldata );
+  im->SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  // same as: gdcmconv --j2k -t 32,32
+  gdcm::JPEG2000Codec j2kcodec;
+  j2kcodec.SetTileSize( TileSize, TileSize );
+  gdcm::ImageChangeTransferSyntax change;
+  change.SetTransferSyntax( gdcm::TransferSyntax::JPEG2000Lossless );
+  change.SetUserCodec( &j2kcodec );
+  change.SetInput( *im );
+  if( !change.Change() ) return 1;
+  gdcm::ImageWriter writer;
+  writer.SetImage( change.GetOutput() );
+  writer.SetFileName( filename.c_str() );
+  if( !writer.Write() ) return 1;
+
+  gdcm::ImageRegionReader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.ReadInformation() ) return 1;
+  const gdcm::JPEG2000TileCache &cache = reader.GetTileCache();
+
+  int ret = 0;
+  // 2x2 tiles of frame 1
+  ret += TestRegion( reader, 40, 70, 20, 40, 1, 1 );
+  if( cache.GetNumberOfMisses() != 4 || cache.GetNumberOfHits() != 0 )
+    {
+    std::cerr << "Expected 4 misses, got " << cache.GetNumberOfMisses() << std::endl;
+    ++ret;
+    }
+  // pan: overlapping region, only the new column of tiles is decoded
+  ret += TestRegion( reader, 50, 100, 25, 35, 1, 1 );
+  if( cache.GetNumberOfMisses() != 6 || cache.GetNumberOfHits() != 4 )
+    {
+    std::cerr << "Expected 6 misses / 4 hits, got " << cache.GetNumberOfMisses()
+      << " / " << cache.GetNumberOfHits() << std::endl;
+    ++ret;
+    }
+  // same region again: nothing decoded
+  ret += TestRegion( reader, 50, 100, 25, 35, 1, 1 );
+  if( cache.GetNumberOfMisses() != 6 || cache.GetNumberOfHits() != 10 ) ++ret;
+  // partial tiles on the image border, several frames
+  ret += TestRegion( reader, 120, 149, 90, 99, 0, 2 );
+  // whole volume
+  ret += TestRegion( reader, 0, Dims[0] - 1, 0, Dims[1] - 1, 0, Dims[2] - 1 );
+  if( cache.GetSize() == 0 ) ++ret;
+
+  // tiny cache: tiles are still decoded, but not kept around
+  reader.SetTileCacheSize( 100 );
+  if( cache.GetSize() != 0 ) ++ret;
+  ret += TestRegion( reader, 10, 140, 10, 90, 2, 2 );
+  if( cache.GetSize() != 0 ) ++ret;
+
+  // cache disabled: whole frames are decoded, the tiles are not looked up
+  reader.SetTileCacheSize( 0 );
+  const unsigned long misses = cache.GetNumberOfMisses();
+  const unsigned long hits = cache.GetNumberOfHits();
+  ret += TestRegion( reader, 33, 97, 5, 77, 0, 1 );
+  if( cache.GetNumberOfMisses() != misses || cache.GetNumberOfHits() != hits )
+    {
+    std::cerr << "Tile cache used while disabled" << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
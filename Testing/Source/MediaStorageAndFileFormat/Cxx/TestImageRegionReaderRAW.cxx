@@ -0,0 +1,139 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageRegionReader.h"
+#include "gdcmImageWriter.h"
+#include "gdcmBoxRegion.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <fstream>
+
+namespace
+{
+const unsigned int Dims[3] = { 40, 30, 5 };
+
+uint16_t PixelValue(unsigned int x, unsigned int y, unsigned int z)
+{
+  // only 12 bits are stored
+  return (uint16_t)( (x + 100 * y + 1000 * z) & 0x0fff );
+}
+
+int TestRegion(const char *filename, bool usestream,
+  unsigned int xmin, unsigned int xmax, unsigned int ymin, unsigned int ymax,
+  unsigned int zmin, unsigned int zmax)
+{
+  gdcm::ImageRegionReader reader;
+  std::ifstream is;
+  if( usestream )
+    {
+    is.open( filename, std::ios::binary );
+    reader.SetStream( is );
+    }
+  else
+    {
+    reader.SetFileName( filename );
+    }
+  if( !reader.ReadInformation() ) return 1;
+
+  gdcm::BoxRegion box;
+  box.SetDomain( xmin, xmax, ymin, ymax, zmin, zmax );
+  reader.SetRegion( box );
+  const size_t len = reader.ComputeBufferLength();
+  std::vector<uint16_t> buffer( len / 2 );
+  if( len != buffer.size() * 2 || !reader.ReadIntoBuffer( (char*)&buffer[0], len ) )
+    {
+    std::cerr << "Could not read region" << std::endl;
+    return 1;
+    }
+  size_t i = 0;
+  for( unsigned int z = zmin; z <= zmax; ++z )
+    for( unsigned int y = ymin; y <= ymax; ++y )
+      for( unsigned int x = xmin; x <= xmax; ++x, ++i )
+        {
+        if( buffer[i] != PixelValue( x, y, z ) )
+          {
+          std::cerr << "Wrong value at " << x << "," << y << "," << z << ": "
+            << buffer[i] << std::endl;
+          return 1;
+          }
+        }
+  return 0;
+}
+}
+
+int TestImageRegionReaderRAW(int, char *[])
+{
+  const char subdir[] = "TestImageRegionReaderRAW";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  const std::string filename = tmpdir + "/raw.dcm";
+
+  gdcm::SmartPointer<gdcm::Image> im = new gdcm::Image;
+  im->SetNumberOfDimensions( 3 );
+  im->SetDimensions( Dims );
+  gdcm::PixelFormat pf( gdcm::PixelFormat::UINT16 );
+  pf.SetBitsStored( 12 );
+  pf.SetHighBit( 11 );
+  im->SetPixelFormat( pf );
+  im->SetPhotometricInterpretation( gdcm::PhotometricInterpretation::MONOCHROME2 );
+  std::vector<uint16_t> pixels;
+  for( unsigned int z = 0; z < Dims[2]; ++z )
+    for( unsigned int y = 0; y < Dims[1]; ++y )
+      for( unsigned int x = 0; x < Dims[0]; ++x )
+        {
+        // garbage in the unused bits, must be cleaned up by the reader
+        pixels.push_back( (uint16_t)(PixelValue( x, y, z ) | 0xf000) );
+        }
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetByteValue( (char*)&pixels[0], (uint32_t)(pixels.size() * 2) );
+  im->SetDataElement( pixeldata );
+  im->SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  gdcm::ImageWriter writer;
+  writer.SetImage( *im );
+  writer.SetFileName( filename.c_str() );
+  if( !writer.Write() ) return 1;
+
+  int ret = 0;
+  for( int usestream = 0; usestream < 2; ++usestream )
+    {
+    const char *fn = filename.c_str();
+    // partial rows
+    ret += TestRegion( fn, usestream != 0, 3, 17, 2, 20, 1, 3 );
+    // single pixel
+    ret += TestRegion( fn, usestream != 0, 39, 39, 29, 29, 4, 4 );
+    // full rows
+    ret += TestRegion( fn, usestream != 0, 0, Dims[0] - 1, 5, 9, 0, 2 );
+    // full frames
+    ret += TestRegion( fn, usestream != 0, 0, Dims[0] - 1, 0, Dims[1] - 1, 1, 4 );
+    }
+  // reuse the same reader for several regions
+  gdcm::ImageRegionReader reader;
+  reader.SetFileName( filename.c_str() );
+  if( !reader.ReadInformation() ) return 1;
+  for( unsigned int z = 0; z < Dims[2]; ++z )
+    {
+    gdcm::BoxRegion box;
+    box.SetDomain( 10, 20, 10, 20, z, z );
+    reader.SetRegion( box );
+    std::vector<uint16_t> buffer( 11 * 11 );
+    if( !reader.ReadIntoBuffer( (char*)&buffer[0], buffer.size() * 2 ) ) ++ret;
+    else if( buffer[0] != PixelValue( 10, 10, z ) ) ++ret;
+    }
+
+  return ret;
+}
@@ -0,0 +1,167 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageRegionReader.h"
+#include "gdcmImageWriter.h"
+#include "gdcmImageChangeTransferSyntax.h"
+#include "gdcmBoxRegion.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <cstring>
+
+namespace
+{
+const unsigned int Dims[3] = { 300, 40, 4 };
+
+// runs of identical values mixed with literal runs
+char ByteValue(unsigned int x, unsigned int y, unsigned int z, unsigned int b)
+{
+  if( x % 50 < 20 ) return (char)(y + z + b);
+  return (char)(x * 3 + y * 7 + z * 11 + b * 13);
+}
+
+int WriteImage(const char *filename, gdcm::PixelFormat const &pf,
+  gdcm::PhotometricInterpretation const &pi, std::vector<char> &pixels)
+{
+  gdcm::SmartPointer<gdcm::Image> im = new gdcm::Image;
+  im->SetNumberOfDimensions( 3 );
+  im->SetDimensions( Dims );
+  im->SetPixelFormat( pf );
+  im->SetPhotometricInterpretation( pi );
+  const unsigned int pixelsize = pf.GetPixelSize();
+  pixels.clear();
+  for( unsigned int z = 0; z < Dims[2]; ++z )
+    for( unsigned int y = 0; y < Dims[1]; ++y )
+      for( unsigned int x = 0; x < Dims[0]; ++x )
+        for( unsigned int b = 0; b < pixelsize; ++b )
+          pixels.push_back( ByteValue( x, y, z, b ) );
+  if( pf.GetBitsStored() == 12 )
+    {
+    uint16_t *p = (uint16_t*)(void*)&pixels[0];
+    for( size_t i = 0; i < pixels.size() / 2; ++i ) p[i] &= 0x0fff;
+    }
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetByteValue( &pixels[0], (uint32_t)pixels.size() );
+  im->SetDataElement( pixeldata );
+  im->SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  gdcm::ImageChangeTransferSyntax change;
+  change.SetTransferSyntax( gdcm::TransferSyntax::RLELossless );
+  change.SetInput( *im );
+  if( !change.Change() ) return 1;
+  gdcm::ImageWriter writer;
+  writer.SetImage( change.GetOutput() );
+  writer.SetFileName( filename );
+  return writer.Write() ? 0 : 1;
+}
+
+int TestRegion(const char *filename, std::vector<char> const &pixels,
+  unsigned int xmin, unsigned int xmax, unsigned int ymin, unsigned int ymax,
+  unsigned int zmin, unsigned int zmax)
+{
+  gdcm::ImageRegionReader reader;
+  reader.SetFileName( filename );
+  if( !reader.ReadInformation() ) return 1;
+  const gdcm::Image &img = reader.GetImage();
+  const unsigned int spp = img.GetPixelFormat().GetSamplesPerPixel();
+  const unsigned int bps = img.GetPixelFormat().GetPixelSize() / spp;
+  // RLE is written with Planar Configuration = 1, just like the full decoder
+  // the region is returned one plane per sample
+  const bool planar = img.GetPlanarConfiguration() == 1;
+
+  gdcm::BoxRegion box;
+  box.SetDomain( xmin, xmax, ymin, ymax, zmin, zmax );
+  reader.SetRegion( box );
+  std::vector<char> buffer( reader.ComputeBufferLength() );
+  if( !reader.ReadIntoBuffer( &buffer[0], buffer.size() ) )
+    {
+    std::cerr << "Could not read region" << std::endl;
+    return 1;
+    }
+  const size_t npixels = (size_t)(xmax - xmin + 1) * (ymax - ymin + 1);
+  size_t i = 0;
+  for( unsigned int z = zmin; z <= zmax; ++z )
+    for( unsigned int y = ymin; y <= ymax; ++y )
+      for( unsigned int x = xmin; x <= xmax; ++x, ++i )
+        for( unsigned int s = 0; s < spp; ++s )
+          for( unsigned int b = 0; b < bps; ++b )
+            {
+            const size_t frame = (z - zmin) * npixels * spp * bps;
+            const size_t pixel = i - (z - zmin) * npixels;
+            const size_t out = planar ?
+              frame + (s * npixels + pixel) * bps + b :
+              (i * spp + s) * bps + b;
+            const size_t in =
+              ((((size_t)z * Dims[1] + y) * Dims[0] + x) * spp + s) * bps + b;
+            if( buffer[out] != pixels[in] )
+              {
+              std::cerr << "Wrong value at " << x << "," << y << "," << z
+                << " in " << filename << std::endl;
+              return 1;
+              }
+            }
+  return 0;
+}
+
+int TestFile(const char *filename, std::vector<char> const &pixels)
+{
+  int ret = 0;
+  // partial rows, with a run crossing xmin
+  ret += TestRegion( filename, pixels, 10, 129, 3, 17, 1, 2 );
+  // single pixel
+  ret += TestRegion( filename, pixels, Dims[0] - 1, Dims[0] - 1,
+    Dims[1] - 1, Dims[1] - 1, 3, 3 );
+  // first rows only
+  ret += TestRegion( filename, pixels, 0, Dims[0] - 1, 0, 1, 0, 0 );
+  // everything
+  ret += TestRegion( filename, pixels, 0, Dims[0] - 1, 0, Dims[1] - 1,
+    0, Dims[2] - 1 );
+  return ret;
+}
+}
+
+int TestImageRegionReaderRLE(int, char *[])
+{
+  const char subdir[] = "TestImageRegionReaderRLE";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+
+  int ret = 0;
+  std::vector<char> pixels;
+
+  const std::string mono8 = tmpdir + "/mono8.dcm";
+  if( WriteImage( mono8.c_str(), gdcm::PixelFormat::UINT8,
+      gdcm::PhotometricInterpretation::MONOCHROME2, pixels ) ) return 1;
+  ret += TestFile( mono8.c_str(), pixels );
+
+  const std::string mono16 = tmpdir + "/mono16.dcm";
+  gdcm::PixelFormat pf16( gdcm::PixelFormat::UINT16 );
+  pf16.SetBitsStored( 12 );
+  pf16.SetHighBit( 11 );
+  if( WriteImage( mono16.c_str(), pf16,
+      gdcm::PhotometricInterpretation::MONOCHROME2, pixels ) ) return 1;
+  ret += TestFile( mono16.c_str(), pixels );
+
+  const std::string rgb = tmpdir + "/rgb.dcm";
+  gdcm::PixelFormat pfrgb( gdcm::PixelFormat::UINT8 );
+  pfrgb.SetSamplesPerPixel( 3 );
+  if( WriteImage( rgb.c_str(), pfrgb,
+      gdcm::PhotometricInterpretation::RGB, pixels ) ) return 1;
+  ret += TestFile( rgb.c_str(), pixels );
+
+  return ret;
+}
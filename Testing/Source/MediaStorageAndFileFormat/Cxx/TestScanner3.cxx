@@ -0,0 +1,216 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmScanner.h"
+#include "gdcmScanner2.h"
+#include "gdcmStrictScanner.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+using TestFixture::Insert;
+
+const gdcm::Tag StudyUID(0x0020,0x000d);
+const gdcm::Tag SeriesUID(0x0020,0x000e);
+const gdcm::Tag SOPUID(0x0008,0x0018);
+const gdcm::Tag Modality(0x0008,0x0060);
+
+// Study UIDs where one is the prefix of the other
+std::string GetStudyUID(size_t i) { return i % 3 ? "1.2.3.45" : "1.2.3.4"; }
+std::string GetSeriesUID(size_t i)
+{
+  std::ostringstream os;
+  os << "1.2.3.4." << i / 4;
+  std::string s = os.str();
+  if( s.size() % 2 ) s.push_back( 0 );
+  return s;
+}
+std::string GetSOPUID(size_t i)
+{
+  std::ostringstream os;
+  os << "1.2.3.4.5." << i;
+  std::string s = os.str();
+  if( s.size() % 2 ) s.push_back( 0 );
+  return s;
+}
+// MR files have no Modality padding, CT files do
+std::string GetModality(size_t i) { return i % 2 ? "MR" : "CT  "; }
+
+bool WriteFile(const std::string &filename, size_t i)
+{
+  gdcm::DataSet ds;
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, std::string( "1.2.840.10008.5.1.4.1.1.7", 26 ) );
+  Insert( ds, SOPUID, gdcm::VR::UI, GetSOPUID( i ) );
+  if( i != 5 ) // no modality in this one
+    Insert( ds, Modality, gdcm::VR::CS, GetModality( i ) );
+  Insert( ds, StudyUID, gdcm::VR::UI, GetStudyUID( i ) );
+  Insert( ds, SeriesUID, gdcm::VR::UI, GetSeriesUID( i ) );
+  return TestFixture::Write( filename, ds );
+}
+
+template <typename TScanner>
+int CheckScanner(TScanner &s, gdcm::Directory::FilenamesType const &filenames)
+{
+  s.AddTag( StudyUID );
+  s.AddTag( SeriesUID );
+  s.AddTag( SOPUID );
+  s.AddTag( Modality );
+  s.Scan( filenames );
+  const size_t nfiles = filenames.size() - 1; // last one is not DICOM
+
+  int ret = 0;
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    const std::string sopuid = GetSOPUID( i );
+    const char *filename = s.GetFilenameFromTagToValue( SOPUID, sopuid.c_str() );
+    if( !filename || filenames[i] != filename ) ++ret;
+    const char *series = s.GetMappingFromTagToValue( SOPUID, sopuid.c_str() )
+      .find( SeriesUID )->second;
+    if( strcmp( GetSeriesUID( i ).c_str(), series ) != 0 ) ++ret;
+    }
+  if( ret ) std::cerr << "Wrong file for a SOP Instance UID" << std::endl;
+
+  // "1.2.3.4" is also a prefix of "1.2.3.45": first file is used
+  if( filenames[0] != s.GetFilenameFromTagToValue( StudyUID, "1.2.3.4" )
+    || filenames[1] != s.GetFilenameFromTagToValue( StudyUID, "1.2.3.45" )
+    || s.GetFilenameFromTagToValue( StudyUID, "1.2.3.5" ) != nullptr
+    || s.GetFilenameFromTagToValue( gdcm::Tag(0x0010,0x0010), "1.2.3.4" ) != nullptr )
+    {
+    std::cerr << "Wrong file for a Study Instance UID" << std::endl;
+    ++ret;
+    }
+
+  // exact match after trimming
+  gdcm::Directory::FilenamesType studies = s.GetAllFilenamesFromTagToValue( StudyUID, "1.2.3.4" );
+  gdcm::Directory::FilenamesType cts = s.GetAllFilenamesFromTagToValue( Modality, " CT" );
+  gdcm::Directory::FilenamesType nomodality = s.GetAllFilenamesFromTagToValue( Modality, "" );
+  size_t nstudies = 0, ncts = 0;
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    if( GetStudyUID( i ) == "1.2.3.4" )
+      {
+      if( nstudies >= studies.size() || studies[nstudies] != filenames[i] ) ++ret;
+      ++nstudies;
+      }
+    if( i % 2 == 0 && i != 5 )
+      {
+      if( ncts >= cts.size() || cts[ncts] != filenames[i] ) ++ret;
+      ++ncts;
+      }
+    }
+  if( nstudies != studies.size() || ncts != cts.size() )
+    {
+    std::cerr << "Wrong files for a value" << std::endl;
+    ++ret;
+    }
+  // files without the tag, including the one which could not be read
+  if( nomodality.size() != 2 || nomodality[0] != filenames[5]
+    || nomodality[1] != filenames[nfiles] )
+    {
+    std::cerr << "Wrong files for an empty value" << std::endl;
+    ++ret;
+    }
+
+  typename TScanner::ValuesType values = s.GetValues( StudyUID );
+  gdcm::Directory::FilenamesType ordered = s.GetOrderedValues( SeriesUID );
+  if( values.size() != 2 || *values.begin() != "1.2.3.4"
+    || ordered.size() != (nfiles + 3) / 4 )
+    {
+    std::cerr << "Wrong values" << std::endl;
+    ++ret;
+    }
+  for( size_t i = 0; i < ordered.size(); ++i )
+    if( strcmp( ordered[i].c_str(), GetSeriesUID( 4 * i ).c_str() ) != 0 ) ++ret;
+  return ret;
+}
+
+int CheckScanner2(gdcm::Scanner2 &s, gdcm::Directory::FilenamesType const &filenames)
+{
+  s.AddPublicTag( StudyUID );
+  s.AddPublicTag( SeriesUID );
+  s.AddPublicTag( SOPUID );
+  s.Scan( filenames );
+  const size_t nfiles = filenames.size() - 1;
+
+  int ret = 0;
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    const std::string sopuid = GetSOPUID( i );
+    const char *filename = s.GetFilenameFromPublicTagToValue( SOPUID, sopuid.c_str() );
+    if( !filename || filenames[i] != filename ) ++ret;
+    }
+  if( s.GetFilenameFromPublicTagToValue( StudyUID, "1.2.3" ) != nullptr
+    || filenames[1] != s.GetFilenameFromPublicTagToValue( StudyUID, "1.2.3.45" ) )
+    ++ret;
+  gdcm::Directory::FilenamesType studies = s.GetAllFilenamesFromPublicTagToValue( StudyUID, "1.2.3.45" );
+  if( studies.size() != nfiles - (nfiles + 2) / 3 || studies[0] != filenames[1] )
+    ++ret;
+  if( s.GetPublicValues( StudyUID ).size() != 2
+    || s.GetPublicOrderedValues( SeriesUID ).size() != (nfiles + 3) / 4 )
+    ++ret;
+  if( ret ) std::cerr << "Wrong Scanner2 lookups" << std::endl;
+  return ret;
+}
+}
+
+int TestScanner3(int, char *[])
+{
+  const char subdir[] = "TestScanner3";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  gdcm::Directory::FilenamesType filenames;
+  const size_t nfiles = 30;
+  for( size_t i = 0; i < nfiles; ++i )
+    {
+    std::ostringstream os;
+    os << tmpdir << "/file" << i << ".dcm";
+    filenames.push_back( os.str() );
+    if( !WriteFile( filenames.back(), i ) ) return 1;
+    }
+  filenames.push_back( tmpdir + "/notdicom.txt" );
+  std::ofstream notdicom( filenames.back().c_str() );
+  notdicom << "not a DICOM file";
+  notdicom.close();
+
+  int ret = 0;
+  gdcm::Scanner s;
+  ret += CheckScanner( s, filenames );
+  gdcm::StrictScanner ss;
+  ret += CheckScanner( ss, filenames );
+  // scanning again starts from scratch
+  std::reverse( filenames.begin(), filenames.begin() + nfiles );
+  if( s.GetFilenameFromTagToValue( SOPUID, GetSOPUID( 0 ).c_str() ) != filenames[nfiles - 1] )
+    ++ret;
+  s.Scan( filenames );
+  if( filenames[nfiles - 1] != s.GetFilenameFromTagToValue( SOPUID, GetSOPUID( 0 ).c_str() )
+    || filenames[0] != s.GetFilenameFromTagToValue( StudyUID, "1.2.3.45" ) )
+    {
+    std::cerr << "Wrong lookup after a new scan" << std::endl;
+    ++ret;
+    }
+  std::reverse( filenames.begin(), filenames.begin() + nfiles );
+  gdcm::Scanner2 s2;
+  ret += CheckScanner2( s2, filenames );
+
+  return ret;
+}
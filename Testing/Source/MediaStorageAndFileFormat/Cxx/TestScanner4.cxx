@@ -0,0 +1,233 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmScanner.h"
+#include "gdcmScanner2.h"
+#include "gdcmStrictScanner.h"
+#include "gdcmDirectory.h"
+#include "gdcmString.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Compare the indexed reverse lookups of the scanners with a plain loop over
+// the files of gdcmData
+static const gdcm::Tag Tags[] = {
+  gdcm::Tag(0x0020,0x000d), // Study Instance UID
+  gdcm::Tag(0x0020,0x000e), // Series Instance UID
+  gdcm::Tag(0x0008,0x0018), // SOP Instance UID
+  gdcm::Tag(0x0008,0x0060), // Modality
+  gdcm::Tag(0x0010,0x0010), // Patient's Name
+};
+static const size_t NumberOfTags = sizeof(Tags) / sizeof(*Tags);
+
+template <typename TScanner>
+static const char *RefFilenameFromTagToValue(TScanner const &s,
+  gdcm::Tag const &t, const char *valueref)
+{
+  size_t len = strlen( valueref );
+  if( len && valueref[ len - 1 ] == ' ' ) --len;
+  gdcm::Directory::FilenamesType const &files = s.GetFilenames();
+  for( size_t i = 0; i < files.size(); ++i )
+    {
+    const char *value = s.GetValue( files[i].c_str(), t );
+    if( value && strncmp( value, valueref, len ) == 0 )
+      return files[i].c_str();
+    }
+  return nullptr;
+}
+
+template <typename TScanner>
+static gdcm::Directory::FilenamesType RefAllFilenamesFromTagToValue(
+  TScanner const &s, gdcm::Tag const &t, const char *valueref)
+{
+  gdcm::Directory::FilenamesType theReturn;
+  const std::string valueref_str = gdcm::String<>::Trim( valueref );
+  gdcm::Directory::FilenamesType const &files = s.GetFilenames();
+  for( size_t i = 0; i < files.size(); ++i )
+    {
+    const char *value = s.GetValue( files[i].c_str(), t );
+    if( gdcm::String<>::Trim( value ) == valueref_str )
+      theReturn.push_back( files[i] );
+    }
+  return theReturn;
+}
+
+template <typename TScanner>
+static gdcm::Directory::FilenamesType RefOrderedValues(TScanner const &s,
+  gdcm::Tag const &t)
+{
+  gdcm::Directory::FilenamesType theReturn;
+  gdcm::Directory::FilenamesType const &files = s.GetFilenames();
+  for( size_t i = 0; i < files.size(); ++i )
+    {
+    const char *value = s.GetValue( files[i].c_str(), t );
+    if( value && std::find( theReturn.begin(), theReturn.end(), value ) == theReturn.end() )
+      theReturn.push_back( value );
+    }
+  return theReturn;
+}
+
+template <typename TScanner>
+static int CheckScanner(const char *name, gdcm::Directory::FilenamesType const &filenames)
+{
+  TScanner s;
+  for( size_t t = 0; t < NumberOfTags; ++t ) s.AddTag( Tags[t] );
+  if( !s.Scan( filenames ) )
+    {
+    std::cerr << name << ": Scan failed" << std::endl;
+    return 1;
+    }
+
+  int numerrors = 0;
+  for( size_t t = 0; t < NumberOfTags; ++t )
+    {
+    const gdcm::Tag &tag = Tags[t];
+    const gdcm::Directory::FilenamesType ordered = RefOrderedValues( s, tag );
+    if( s.GetOrderedValues( tag ) != ordered )
+      {
+      std::cerr << name << ": GetOrderedValues differs for " << tag << std::endl;
+      ++numerrors;
+      }
+    const typename TScanner::ValuesType values( ordered.begin(), ordered.end() );
+    if( s.GetValues( tag ) != values )
+      {
+      std::cerr << name << ": GetValues differs for " << tag << std::endl;
+      ++numerrors;
+      }
+
+    std::vector<std::string> queries( ordered );
+    queries.push_back( "" );
+    queries.push_back( "gdcm.rocks.invalid.value" );
+    for( size_t v = 0; v < ordered.size(); ++v )
+      {
+      // a prefix and a padded value are valid queries too
+      queries.push_back( ordered[v].substr( 0, ordered[v].size() / 2 ) );
+      queries.push_back( ordered[v] + " " );
+      }
+    for( size_t q = 0; q < queries.size(); ++q )
+      {
+      const char *valueref = queries[q].c_str();
+      const char *ref = RefFilenameFromTagToValue( s, tag, valueref );
+      const char *filename = s.GetFilenameFromTagToValue( tag, valueref );
+      if( ref != filename && ( !ref || !filename || strcmp( ref, filename ) != 0 ) )
+        {
+        std::cerr << name << ": GetFilenameFromTagToValue differs for " << tag
+          << " = [" << valueref << "]" << std::endl;
+        ++numerrors;
+        }
+      if( s.GetAllFilenamesFromTagToValue( tag, valueref )
+        != RefAllFilenamesFromTagToValue( s, tag, valueref ) )
+        {
+        std::cerr << name << ": GetAllFilenamesFromTagToValue differs for " << tag
+          << " = [" << valueref << "]" << std::endl;
+        ++numerrors;
+        }
+      }
+    }
+  return numerrors;
+}
+
+static int CheckScanner2(gdcm::Directory::FilenamesType const &filenames)
+{
+  gdcm::Scanner2 s;
+  for( size_t t = 0; t < NumberOfTags; ++t ) s.AddPublicTag( Tags[t] );
+  if( !s.Scan( filenames ) )
+    {
+    std::cerr << "Scanner2: Scan failed" << std::endl;
+    return 1;
+    }
+
+  int numerrors = 0;
+  gdcm::Directory::FilenamesType const &files = s.GetFilenames();
+  for( size_t t = 0; t < NumberOfTags; ++t )
+    {
+    const gdcm::Tag &tag = Tags[t];
+    gdcm::Directory::FilenamesType ordered;
+    for( size_t i = 0; i < files.size(); ++i )
+      {
+      const char *value = s.GetPublicValue( files[i].c_str(), tag );
+      if( value && std::find( ordered.begin(), ordered.end(), value ) == ordered.end() )
+        ordered.push_back( value );
+      }
+    if( s.GetPublicOrderedValues( tag ) != ordered )
+      {
+      std::cerr << "Scanner2: GetPublicOrderedValues differs for " << tag << std::endl;
+      ++numerrors;
+      }
+    if( s.GetPublicValues( tag ) != gdcm::Scanner2::ValuesType( ordered.begin(), ordered.end() ) )
+      {
+      std::cerr << "Scanner2: GetPublicValues differs for " << tag << std::endl;
+      ++numerrors;
+      }
+
+    std::vector<std::string> queries( ordered );
+    queries.push_back( "gdcm.rocks.invalid.value" );
+    for( size_t v = 0; v < ordered.size(); ++v )
+      queries.push_back( ordered[v] + " " );
+    for( size_t q = 0; q < queries.size(); ++q )
+      {
+      // Scanner2 matches the trimmed query exactly
+      const std::string valueref = gdcm::String<>::Trim( queries[q].c_str() );
+      gdcm::Directory::FilenamesType ref;
+      for( size_t i = 0; i < files.size(); ++i )
+        {
+        const char *value = s.GetPublicValue( files[i].c_str(), tag );
+        if( value && valueref == value )
+          ref.push_back( files[i] );
+        }
+      const gdcm::Directory::FilenamesType all =
+        s.GetAllFilenamesFromPublicTagToValue( tag, queries[q].c_str() );
+      const char *filename = s.GetFilenameFromPublicTagToValue( tag, queries[q].c_str() );
+      if( all != ref
+        || ( ref.empty() ? filename != nullptr : !filename || ref[0] != filename ) )
+        {
+        std::cerr << "Scanner2: reverse lookup differs for " << tag
+          << " = [" << queries[q] << "]" << std::endl;
+        ++numerrors;
+        }
+      }
+    }
+  return numerrors;
+}
+
+int TestScanner4(int argc, char *argv[])
+{
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  const char *directory = gdcm::Testing::GetDataRoot();
+  if( argc == 2 )
+    {
+    directory = argv[1];
+    }
+
+  if( !gdcm::System::FileIsDirectory(directory) )
+    {
+    std::cerr << "No such directory: " << directory <<  std::endl;
+    return 1;
+    }
+
+  gdcm::Directory d;
+  unsigned int nfiles = d.Load( directory ); // no recursion
+  std::cout << "done retrieving file list. " << nfiles << " files found." <<  std::endl;
+
+  int numerrors = 0;
+  numerrors += CheckScanner<gdcm::Scanner>( "Scanner", d.GetFilenames() );
+  numerrors += CheckScanner<gdcm::StrictScanner>( "StrictScanner", d.GetFilenames() );
+  numerrors += CheckScanner2( d.GetFilenames() );
+
+  return numerrors;
+}
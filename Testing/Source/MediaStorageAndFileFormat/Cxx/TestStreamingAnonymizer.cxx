@@ -0,0 +1,266 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmStreamingAnonymizer.h"
+#include "gdcmAnonymizer.h"
+#include "gdcmDummyValueMap.h"
+#include "gdcmCryptographicMessageSyntax.h"
+#include "gdcmGlobal.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmSequenceOfItems.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "TestFixture.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+namespace
+{
+using TestFixture::Insert;
+using TestFixture::PassThroughCMS;
+
+const gdcm::Tag PatientName(0x0010,0x0010);
+const gdcm::Tag StudyUID(0x0020,0x000d);
+const gdcm::Tag PixelData(0x7fe0,0x0010);
+const gdcm::Tag ReferencedSOPInstanceUID(0x0008,0x1155);
+const gdcm::Tag PrivateValue(0x7fe1,0x1010);
+
+enum PixelDataType
+{
+  NATIVE,
+  ENCAPSULATED,
+  NONE
+};
+
+std::string GetPixels(size_t len)
+{
+  std::string pixels( len, 0 );
+  for( size_t i = 0; i < len; ++i ) pixels[i] = (char)( i * 7 + i / 256 );
+  return pixels;
+}
+
+bool WriteFile(const std::string &filename, gdcm::TransferSyntax::TSType ts,
+  PixelDataType type)
+{
+  gdcm::DataSet ds;
+  Insert( ds, gdcm::Tag(0x0008,0x0016), gdcm::VR::UI, "1.2.840.10008.5.1.4.1.1.7" );
+  Insert( ds, gdcm::Tag(0x0008,0x0018), gdcm::VR::UI, "1.2.3.4.5.6" );
+  Insert( ds, gdcm::Tag(0x0008,0x0060), gdcm::VR::CS, "OT" );
+  Insert( ds, PatientName, gdcm::VR::PN, "Doe^John" );
+  Insert( ds, StudyUID, gdcm::VR::UI, "1.2.3.4" );
+  Insert( ds, gdcm::Tag(0x0020,0x000e), gdcm::VR::UI, "1.2.3.4.5" );
+
+  // A nested attribute to protect
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sq = new gdcm::SequenceOfItems;
+  sq->SetLengthToUndefined();
+  gdcm::Item item;
+  item.SetVLToUndefined();
+  Insert( item.GetNestedDataSet(), gdcm::Tag(0x0008,0x1150), gdcm::VR::UI, "1.2.840.10008.3.1.2.3.3" );
+  Insert( item.GetNestedDataSet(), ReferencedSOPInstanceUID, gdcm::VR::UI, "1.2.3.4.7" );
+  sq->AddItem( item );
+  gdcm::DataElement sqde( gdcm::Tag(0x0008,0x1111) );
+  sqde.SetVR( gdcm::VR::SQ );
+  sqde.SetValue( *sq );
+  sqde.SetVLToUndefined();
+  ds.Insert( sqde );
+
+  const std::string pixels = GetPixels( 3 * 1024 * 1024 + 2 );
+  if( type == NATIVE )
+    {
+    gdcm::DataElement pd( PixelData );
+    pd.SetVR( gdcm::VR::OB );
+    pd.SetByteValue( pixels.c_str(), (uint32_t)pixels.size() );
+    ds.Insert( pd );
+    }
+  else if( type == ENCAPSULATED )
+    {
+    gdcm::SmartPointer<gdcm::SequenceOfFragments> sf = new gdcm::SequenceOfFragments;
+    gdcm::Fragment frag;
+    frag.SetByteValue( pixels.c_str(), (uint32_t)pixels.size() / 2 );
+    sf->AddFragment( frag );
+    frag.SetByteValue( pixels.c_str() + pixels.size() / 2, (uint32_t)pixels.size() / 2 );
+    sf->AddFragment( frag );
+    gdcm::DataElement pd( PixelData );
+    pd.SetValue( *sf );
+    pd.SetVLToUndefined();
+    pd.SetVR( gdcm::VR::OB );
+    ds.Insert( pd );
+    }
+
+  // Elements after the Pixel Data
+  Insert( ds, gdcm::Tag(0x7fe1,0x0010), gdcm::VR::LO, "SIEMENS CSA NON-IMAGE" );
+  Insert( ds, PrivateValue, gdcm::VR::OB, "private" );
+  Insert( ds, gdcm::Tag(0xfffc,0xfffc), gdcm::VR::OB, std::string( 16, 0 ) );
+
+  return TestFixture::Write( filename, ds, ts );
+}
+
+std::string ReadBytes(const std::string &filename)
+{
+  std::ifstream is( filename.c_str(), std::ios::binary );
+  std::ostringstream os;
+  os << is.rdbuf();
+  return os.str();
+}
+
+std::string GetValue(const gdcm::DataSet &ds, gdcm::Tag const &t)
+{
+  if( !ds.FindDataElement( t ) ) return "<missing>";
+  const gdcm::ByteValue *bv = ds.GetDataElement( t ).GetByteValue();
+  if( !bv ) return "";
+  std::string s( bv->GetPointer(), bv->GetLength() );
+  while( !s.empty() && ( s[s.size()-1] == ' ' || s[s.size()-1] == 0 ) )
+    s.resize( s.size() - 1 );
+  return s;
+}
+
+std::string GetNestedValue(const gdcm::DataSet &ds)
+{
+  if( !ds.FindDataElement( gdcm::Tag(0x0008,0x1111) ) ) return "<missing>";
+  gdcm::SmartPointer<gdcm::SequenceOfItems> sq =
+    ds.GetDataElement( gdcm::Tag(0x0008,0x1111) ).GetValueAsSQ();
+  if( !sq || sq->GetNumberOfItems() != 1 ) return "<missing>";
+  return GetValue( sq->GetItem(1).GetNestedDataSet(), ReferencedSOPInstanceUID );
+}
+
+int CheckFile(const std::string &filename, gdcm::TransferSyntax::TSType ts,
+  PixelDataType type, PassThroughCMS &cms, const std::string &tmpdir)
+{
+  const std::string output = tmpdir + "/streaming.dcm";
+  const std::string expected = tmpdir + "/expected.dcm";
+  if( !WriteFile( filename, ts, type ) ) return 1;
+
+  gdcm::DummyValueMap dvm;
+  gdcm::StreamingAnonymizer sanon;
+  sanon.SetInputFileName( filename.c_str() );
+  sanon.SetOutputFileName( output.c_str() );
+  sanon.SetCryptographicMessageSyntax( &cms );
+  sanon.SetDummyValueMap( &dvm );
+  if( !sanon.BasicApplicationLevelConfidentialityProfile( true ) )
+    {
+    std::cerr << "Could not de-identify: " << filename << std::endl;
+    return 1;
+    }
+
+  // Same result as the in memory Anonymizer
+    {
+    gdcm::Reader reader;
+    reader.SetFileName( filename.c_str() );
+    if( !reader.Read() ) return 1;
+    gdcm::Anonymizer anon;
+    anon.SetCryptographicMessageSyntax( &cms );
+    anon.SetDummyValueMap( &dvm );
+    anon.SetFile( reader.GetFile() );
+    if( !anon.BasicApplicationLevelConfidentialityProfile( true ) ) return 1;
+    reader.GetFile().GetHeader().Clear();
+    gdcm::Writer writer;
+    writer.SetFileName( expected.c_str() );
+    writer.SetFile( reader.GetFile() );
+    if( !writer.Write() ) return 1;
+    }
+  const std::string bytes = ReadBytes( output );
+  if( bytes != ReadBytes( expected ) )
+    {
+    std::cerr << "Different from Anonymizer: " << filename << std::endl;
+    return 1;
+    }
+
+  int ret = 0;
+  gdcm::Reader reader;
+  reader.SetFileName( output.c_str() );
+  if( !reader.Read() ) return 1;
+  const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+  if( GetValue( ds, PatientName ) == "Doe^John"
+    || GetValue( ds, StudyUID ) != dvm.GetDummyUID( "1.2.3.4" )
+    || GetNestedValue( ds ) != dvm.GetDummyUID( "1.2.3.4.7" )
+    || GetValue( ds, PrivateValue ) != "private" )
+    {
+    std::cerr << "Wrong de-identified values: " << filename << std::endl;
+    ++ret;
+    }
+  const std::string pixels = GetPixels( 3 * 1024 * 1024 + 2 );
+  if( ( type != NONE && bytes.find( pixels.substr( 0, pixels.size() / 2 ) ) == std::string::npos )
+    || ( type == NONE && ds.FindDataElement( PixelData ) ) )
+    {
+    std::cerr << "Wrong Pixel Data: " << filename << std::endl;
+    ++ret;
+    }
+
+  // Re-identify in place
+  sanon.SetInputFileName( output.c_str() );
+  if( !sanon.BasicApplicationLevelConfidentialityProfile( false ) )
+    {
+    std::cerr << "Could not re-identify: " << filename << std::endl;
+    return 1;
+    }
+  gdcm::Reader reader2;
+  reader2.SetFileName( output.c_str() );
+  if( !reader2.Read() ) return 1;
+  const gdcm::DataSet &ds2 = reader2.GetFile().GetDataSet();
+  if( GetValue( ds2, PatientName ) != "Doe^John"
+    || GetValue( ds2, StudyUID ) != "1.2.3.4"
+    || GetNestedValue( ds2 ) != "1.2.3.4.7"
+    || ( type != NONE && ReadBytes( output ).find( pixels.substr( pixels.size() / 2 ) ) == std::string::npos )
+    || gdcm::System::FileExists( ( output + ".tmp" ).c_str() ) )
+    {
+    std::cerr << "Wrong re-identified values: " << filename << std::endl;
+    ++ret;
+    }
+  return ret;
+}
+}
+
+int TestStreamingAnonymizer(int, char *[])
+{
+  gdcm::Global& g = gdcm::Global::GetInstance();
+  if( !g.LoadResourcesFiles() )
+    {
+    std::cerr << "Could not load resources files" << std::endl;
+    return 1;
+    }
+  const char subdir[] = "TestStreamingAnonymizer";
+  const std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  const std::string input = tmpdir + "/input.dcm";
+
+  PassThroughCMS cms;
+  int ret = 0;
+  ret += CheckFile( input, gdcm::TransferSyntax::ExplicitVRLittleEndian, NATIVE, cms, tmpdir );
+  ret += CheckFile( input, gdcm::TransferSyntax::ImplicitVRLittleEndian, NATIVE, cms, tmpdir );
+  ret += CheckFile( input, gdcm::TransferSyntax::JPEGBaselineProcess1, ENCAPSULATED, cms, tmpdir );
+  ret += CheckFile( input, gdcm::TransferSyntax::ExplicitVRLittleEndian, NONE, cms, tmpdir );
+
+  // Missing input file: no output
+  const std::string missing = tmpdir + "/missing.dcm";
+  const std::string output = tmpdir + "/missing_out.dcm";
+  gdcm::System::RemoveFile( output.c_str() );
+  gdcm::StreamingAnonymizer sanon;
+  sanon.SetInputFileName( missing.c_str() );
+  sanon.SetOutputFileName( output.c_str() );
+  sanon.SetCryptographicMessageSyntax( &cms );
+  if( sanon.BasicApplicationLevelConfidentialityProfile( true )
+    || gdcm::System::FileExists( output.c_str() ) )
+    {
+    std::cerr << "Missing file not detected" << std::endl;
+    ++ret;
+    }
+
+  return ret;
+}
@@ -0,0 +1,176 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmStreamingAnonymizer.h"
+#include "gdcmAnonymizer.h"
+#include "gdcmDummyValueMap.h"
+#include "gdcmGlobal.h"
+#include "gdcmReader.h"
+#include "gdcmWriter.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+#include "gdcmTrace.h"
+#include "TestFixture.h"
+
+// De-identify (and re-identify) the files of gdcmData with a
+// StreamingAnonymizer, and compare with the in memory Anonymizer
+namespace
+{
+const gdcm::Tag PixelData(0x7fe0,0x0010);
+
+// Same attributes, the Pixel Data aside
+bool SameAttributes(const gdcm::DataSet &ds, const gdcm::DataSet &refds)
+{
+  if( ds.Size() != refds.Size() ) return false;
+  gdcm::DataSet::ConstIterator it = ds.Begin(), ref = refds.Begin();
+  for( ; it != ds.End(); ++it, ++ref )
+    {
+    if( it->GetTag() != ref->GetTag() ) return false;
+    if( it->GetTag() != PixelData && !( *it == *ref ) ) return false;
+    }
+  return true;
+}
+
+bool SamePixelData(const gdcm::DataSet &ds, const gdcm::DataSet &refds)
+{
+  if( ds.FindDataElement( PixelData ) != refds.FindDataElement( PixelData ) )
+    return false;
+  return !ds.FindDataElement( PixelData )
+    || ds.GetDataElement( PixelData ) == refds.GetDataElement( PixelData );
+}
+
+// Result of the in memory Anonymizer (read back from expected), false when
+// it cannot process filename
+bool Anonymize(const char *filename, bool deidentify, TestFixture::PassThroughCMS &cms,
+  gdcm::DummyValueMap &dvm, std::string const &expected, gdcm::Reader &reader)
+{
+    {
+    gdcm::Reader input;
+    input.SetFileName( filename );
+    if( !input.Read() ) return false;
+    gdcm::Anonymizer anon;
+    anon.SetCryptographicMessageSyntax( &cms );
+    anon.SetDummyValueMap( &dvm );
+    anon.SetFile( input.GetFile() );
+    if( !anon.BasicApplicationLevelConfidentialityProfile( deidentify ) ) return false;
+    input.GetFile().GetHeader().Clear();
+    gdcm::Writer writer;
+    writer.SetFileName( expected.c_str() );
+    writer.SetFile( input.GetFile() );
+    if( !writer.Write() ) return false;
+    }
+  reader.SetFileName( expected.c_str() );
+  return reader.Read();
+}
+
+int TestStreamingAnonymize(const char *filename, const char *subdir,
+  TestFixture::PassThroughCMS &cms, int &nfiles)
+{
+  const std::string output = gdcm::Testing::GetTempFilename( filename, subdir );
+  const std::string expectedfilename = output + ".expected";
+  gdcm::DummyValueMap dvm;
+  gdcm::StreamingAnonymizer sanon;
+  sanon.SetInputFileName( filename );
+  sanon.SetOutputFileName( output.c_str() );
+  sanon.SetCryptographicMessageSyntax( &cms );
+  sanon.SetDummyValueMap( &dvm );
+  if( !sanon.BasicApplicationLevelConfidentialityProfile( true ) )
+    {
+    if( gdcm::System::FileExists( output.c_str() ) )
+      {
+      std::cerr << "Output file left after a failure: " << output << std::endl;
+      return 1;
+      }
+    return 0; // not supported
+    }
+  gdcm::Reader expected;
+  if( !Anonymize( filename, true, cms, dvm, expectedfilename, expected ) ) return 0;
+  ++nfiles;
+
+  gdcm::Reader reader;
+  reader.SetFileName( output.c_str() );
+  if( !reader.Read()
+    || !SameAttributes( reader.GetFile().GetDataSet(), expected.GetFile().GetDataSet() ) )
+    {
+    std::cerr << "Different from Anonymizer: " << filename << std::endl;
+    return 1;
+    }
+  gdcm::Reader input;
+  input.SetFileName( filename );
+  if( !input.Read()
+    || !SamePixelData( reader.GetFile().GetDataSet(), input.GetFile().GetDataSet() ) )
+    {
+    std::cerr << "Different Pixel Data: " << filename << std::endl;
+    return 1;
+    }
+
+  // Re-identify in place
+  sanon.SetInputFileName( output.c_str() );
+  gdcm::Reader expected2, reidentified;
+  if( !Anonymize( output.c_str(), false, cms, dvm, expectedfilename, expected2 )
+    || !sanon.BasicApplicationLevelConfidentialityProfile( false ) )
+    {
+    std::cerr << "Could not re-identify: " << filename << std::endl;
+    return 1;
+    }
+  reidentified.SetFileName( output.c_str() );
+  if( !reidentified.Read()
+    || !SameAttributes( reidentified.GetFile().GetDataSet(), expected2.GetFile().GetDataSet() )
+    || !SamePixelData( reidentified.GetFile().GetDataSet(), input.GetFile().GetDataSet() ) )
+    {
+    std::cerr << "Wrong re-identified file: " << filename << std::endl;
+    return 1;
+    }
+  return 0;
+}
+}
+
+int TestStreamingAnonymizer2(int argc, char *argv[])
+{
+  gdcm::Global& g = gdcm::Global::GetInstance();
+  if( !g.LoadResourcesFiles() )
+    {
+    std::cerr << "Could not load resources files" << std::endl;
+    return 1;
+    }
+  const char subdir[] = "TestStreamingAnonymizer2";
+  const std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  TestFixture::PassThroughCMS cms;
+  int nfiles = 0;
+  if( argc == 2 )
+    {
+    const char *filename = argv[1];
+    return TestStreamingAnonymize( filename, subdir, cms, nfiles );
+    }
+
+  // else
+  gdcm::Trace::DebugOff();
+  gdcm::Trace::WarningOff();
+  gdcm::Trace::ErrorOff();
+  int r = 0, i = 0;
+  const char *filename;
+  const char * const *filenames = gdcm::Testing::GetFileNames();
+  while( (filename = filenames[i]) )
+    {
+    r += TestStreamingAnonymize( filename, subdir, cms, nfiles );
+    ++i;
+    }
+  std::cout << nfiles << " files compared" << std::endl;
+  if( !nfiles ) return 1;
+
+  return r;
+}
@@ -0,0 +1,181 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmVolumeAssembler.h"
+#include "gdcmImageWriter.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <sstream>
+#include <cmath>
+
+// Assemble a synthetic series of 16 bits slices
+namespace
+{
+const unsigned int NumberOfSlices = 6;
+const unsigned int Columns = 4;
+const unsigned int Rows = 3;
+
+// Slice i is at z = 1.5 * i, all its pixels are 100 * i + (pixel index)
+bool WriteSlice(const std::string &filename, unsigned int i, unsigned int rows = Rows,
+  double z = -1)
+{
+  gdcm::ImageWriter w;
+  gdcm::Image &image = w.GetImage();
+  image.SetNumberOfDimensions( 2 );
+  image.SetDimension( 0, Columns );
+  image.SetDimension( 1, rows );
+  image.SetPixelFormat( gdcm::PixelFormat::UINT16 );
+  image.SetPhotometricInterpretation( gdcm::PhotometricInterpretation::MONOCHROME2 );
+  const double dircos[6] = { 1, 0, 0, 0, 1, 0 };
+  image.SetOrigin( 0, -10 );
+  image.SetOrigin( 1, 5 );
+  image.SetOrigin( 2, z < 0 ? 1.5 * i : z );
+  image.SetDirectionCosines( dircos );
+  image.SetSpacing( 0, 0.5 );
+  image.SetSpacing( 1, 0.25 );
+
+  std::vector<uint16_t> pixels( Columns * rows );
+  for( size_t p = 0; p < pixels.size(); ++p )
+    pixels[p] = (uint16_t)(100 * i + p);
+  gdcm::DataElement pd( gdcm::Tag(0x7fe0,0x0010) );
+  pd.SetByteValue( reinterpret_cast<const char*>( &pixels[0] ),
+    (uint32_t)(pixels.size() * sizeof(uint16_t)) );
+  image.SetDataElement( pd );
+  image.SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  gdcm::DataSet &ds = w.GetFile().GetDataSet();
+  gdcm::DataElement sopclass( gdcm::Tag(0x0008,0x0016) );
+  sopclass.SetVR( gdcm::VR::UI );
+  const char ct[] = "1.2.840.10008.5.1.4.1.1.2";
+  sopclass.SetByteValue( ct, (uint32_t)sizeof(ct) );
+  ds.Insert( sopclass );
+  w.SetFileName( filename.c_str() );
+  return w.Write();
+}
+}
+
+int TestVolumeAssembler(int , char *[])
+{
+  const char subdir[] = "TestVolumeAssembler";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  std::vector<std::string> filenames;
+  for( unsigned int i = 0; i < NumberOfSlices; ++i )
+    {
+    std::ostringstream os;
+    os << tmpdir << "/slice" << i << ".dcm";
+    filenames.push_back( os.str() );
+    if( !WriteSlice( filenames.back(), i ) )
+      {
+      std::cerr << "Could not write: " << filenames.back() << std::endl;
+      return 1;
+      }
+    }
+
+  // Same volume with one or several threads
+  for( unsigned int nthreads = 1; nthreads <= 4; nthreads += 3 )
+    {
+    gdcm::VolumeAssembler va;
+    va.SetNumberOfThreads( nthreads );
+    if( !va.Assemble( filenames ) )
+      {
+      std::cerr << "Could not assemble with " << nthreads << " threads" << std::endl;
+      return 1;
+      }
+    const gdcm::Image &volume = va.GetImage();
+    if( volume.GetNumberOfDimensions() != 3 || volume.GetDimension(0) != Columns
+      || volume.GetDimension(1) != Rows || volume.GetDimension(2) != NumberOfSlices )
+      {
+      std::cerr << "Wrong dimensions" << std::endl;
+      return 1;
+      }
+    if( volume.GetSpacing(0) != 0.5 || volume.GetSpacing(1) != 0.25
+      || std::fabs( volume.GetSpacing(2) - 1.5 ) > 1e-6
+      || volume.GetOrigin(0) != -10 || volume.GetOrigin(2) != 0 )
+      {
+      std::cerr << "Wrong geometry: " << volume.GetSpacing(2) << std::endl;
+      return 1;
+      }
+    if( va.GetBufferLength() != va.ComputeBufferLength()
+      || va.GetBufferLength() != volume.GetBufferLength() )
+      {
+      std::cerr << "Wrong buffer length: " << va.GetBufferLength() << std::endl;
+      return 1;
+      }
+    const uint16_t *pixels = reinterpret_cast<const uint16_t*>( va.GetBuffer() );
+    for( unsigned int i = 0; i < NumberOfSlices; ++i )
+      {
+      for( unsigned int p = 0; p < Columns * Rows; ++p )
+        {
+        if( pixels[i * Columns * Rows + p] != 100 * i + p )
+          {
+          std::cerr << "Wrong pixel #" << p << " in slice #" << i << std::endl;
+          return 1;
+          }
+        }
+      }
+    }
+
+  // Caller owned buffer
+  gdcm::VolumeAssembler va;
+  if( !va.ReadInformation( filenames ) )
+    {
+    std::cerr << "Could not read information" << std::endl;
+    return 1;
+    }
+  std::vector<char> buffer( va.ComputeBufferLength() );
+  if( va.ReadIntoBuffer( &buffer[0], buffer.size() - 1 )
+    || !va.ReadIntoBuffer( &buffer[0], buffer.size() ) || va.GetBuffer() )
+    {
+    std::cerr << "Wrong caller buffer handling" << std::endl;
+    return 1;
+    }
+
+  // Not sorted
+  std::vector<std::string> reversed( filenames.rbegin(), filenames.rend() );
+  if( va.Assemble( reversed ) )
+    {
+    std::cerr << "Assembled unsorted slices" << std::endl;
+    return 1;
+    }
+
+  // A missing slice
+  std::vector<std::string> gap = filenames;
+  gap.erase( gap.begin() + 2 );
+  if( va.Assemble( gap ) )
+    {
+    std::cerr << "Assembled unevenly spaced slices" << std::endl;
+    return 1;
+    }
+
+  // A slice with other dimensions
+  const std::string other = tmpdir + "/other.dcm";
+  if( !WriteSlice( other, NumberOfSlices, Rows + 1, 1.5 * NumberOfSlices ) )
+    {
+    std::cerr << "Could not write: " << other << std::endl;
+    return 1;
+    }
+  std::vector<std::string> mixed = filenames;
+  mixed.push_back( other );
+  if( va.Assemble( mixed ) || va.GetBuffer() )
+    {
+    std::cerr << "Assembled slices of different dimensions" << std::endl;
+    return 1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/*=========================================================================
+
+  Program: GDCM (Grassroots DICOM). A DICOM library
+
+  Copyright (c) 2006-2011 Mathieu Malaterre
+  All rights reserved.
+  See Copyright.txt or http://gdcm.sourceforge.net/Copyright.html for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "gdcmImageWriter.h"
+#include "gdcmImageReader.h"
+#include "gdcmImageChangeTransferSyntax.h"
+#include "gdcmFileChangeTransferSyntax.h"
+#include "gdcmSequenceOfFragments.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <cstring>
+
+namespace
+{
+const unsigned int Dims[3] = { 32, 16, 6 };
+
+// Check the Basic Offset Table points at each frame fragment, and pixels
+// decode back to the input
+int CheckFile(const char *filename, std::vector<char> const &pixels)
+{
+  gdcm::ImageReader reader;
+  reader.SetFileName( filename );
+  if( !reader.Read() ) return 1;
+  const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+  const gdcm::SequenceOfFragments *sqf =
+    ds.GetDataElement( gdcm::Tag(0x7fe0,0x0010) ).GetSequenceOfFragments();
+  if( !sqf || sqf->GetNumberOfFragments() != Dims[2] ) return 1;
+  const gdcm::ByteValue *bv = sqf->GetTable().GetByteValue();
+  if( !bv || bv->GetLength() != Dims[2] * sizeof(uint32_t) )
+    {
+    std::cerr << "Basic Offset Table was not filled: " << filename << std::endl;
+    return 1;
+    }
+  std::vector<uint32_t> table( Dims[2] );
+  memcpy( &table[0], bv->GetPointer(), bv->GetLength() );
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> lengths;
+  sqf->ComputeFragmentOffsets( offsets, lengths );
+  for( unsigned int i = 0; i < Dims[2]; ++i )
+    {
+    if( table[i] != offsets[i] )
+      {
+      std::cerr << "Wrong offset for frame " << i << ": " << table[i] << std::endl;
+      return 1;
+      }
+    }
+  // small object, no need for the Extended Offset Table
+  if( ds.FindDataElement( gdcm::Tag(0x7fe0,0x0001) ) ) return 1;
+
+  const gdcm::Image &img = reader.GetImage();
+  std::vector<char> decoded( img.GetBufferLength() );
+  if( decoded.size() != pixels.size() || !img.GetBuffer( &decoded[0] ) ) return 1;
+  return decoded == pixels ? 0 : 1;
+}
+}
+
+int TestWriteOffsetTable(int, char *[])
+{
+  const char subdir[] = "TestWriteOffsetTable";
+  std::string tmpdir = gdcm::Testing::GetTempDirectory( subdir );
+  if( !gdcm::System::FileIsDirectory( tmpdir.c_str() ) )
+    {
+    gdcm::System::MakeDirectory( tmpdir.c_str() );
+    }
+  const std::string rawfilename = tmpdir + "/raw.dcm";
+  const std::string rlefilename = tmpdir + "/rle.dcm";
+  const std::string filerlefilename = tmpdir + "/filerle.dcm";
+
+  gdcm::SmartPointer<gdcm::Image> im = new gdcm::Image;
+  im->SetNumberOfDimensions( 3 );
+  im->SetDimensions( Dims );
+  im->SetPixelFormat( gdcm::PixelFormat::UINT8 );
+  im->SetPhotometricInterpretation( gdcm::PhotometricInterpretation::MONOCHROME2 );
+  std::vector<char> pixels( im->GetBufferLength() );
+  for( size_t i = 0; i < pixels.size(); ++i )
+    {
+    // frames compress to different sizes
+    const size_t frame = i / (Dims[0] * Dims[1]);
+    pixels[i] = (char)( (i % (frame + 1)) * 7 );
+    }
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetByteValue( &pixels[0], (uint32_t)pixels.size() );
+  im->SetDataElement( pixeldata );
+  im->SetTransferSyntax( gdcm::TransferSyntax::ExplicitVRLittleEndian );
+
+  gdcm::ImageWriter writer;
+  writer.SetImage( *im );
+  writer.SetFileName( rawfilename.c_str() );
+  if( !writer.Write() ) return 1;
+
+  // ImageChangeTransferSyntax + ImageWriter
+  gdcm::ImageChangeTransferSyntax change;
+  change.SetTransferSyntax( gdcm::TransferSyntax::RLELossless );
+  change.SetInput( *im );
+  if( !change.Change() ) return 1;
+  gdcm::ImageWriter rlewriter;
+  rlewriter.SetImage( change.GetOutput() );
+  rlewriter.SetFileName( rlefilename.c_str() );
+  if( !rlewriter.Write() ) return 1;
+
+  // FileChangeTransferSyntax
+  gdcm::FileChangeTransferSyntax fcts;
+  fcts.SetTransferSyntax( gdcm::TransferSyntax::RLELossless );
+  fcts.SetInputFileName( rawfilename.c_str() );
+  fcts.SetOutputFileName( filerlefilename.c_str() );
+  if( !fcts.Change() ) return 1;
+
+  int ret = 0;
+  ret += CheckFile( rlefilename.c_str(), pixels );
+  ret += CheckFile( filerlefilename.c_str(), pixels );
+  return ret;
+}
@@ -0,0 +1,230 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULConnection.h"
+#include "gdcmULConnectionCallback.h"
+#include "gdcmServiceClassUser.h"
+#include "gdcmCompositeNetworkFunctions.h"
+#include "gdcmPresentationContextGenerator.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmAttribute.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+const int NumberOfMatches = 20;
+
+// Minimal C-FIND SCP: PatientID "FINITE" gets NumberOfMatches results then
+// success, anything else gets NumberOfMatches pending results and only
+// completes on C-CANCEL-RQ
+class FindSCPCallback : public gdcm::network::ULTransportCallback
+{
+public:
+  gdcm::network::ULNonBlockingTransport *Transport = nullptr;
+  uint8_t PresentationContextID = 0;
+  int NumberOfCancel = 0;
+
+  void SendResponse(gdcm::network::ULConnection &c, const gdcm::DataSet &command,
+    uint16_t status, const gdcm::DataSet *identifier)
+    {
+    gdcm::CommandDataSet rsp;
+    {
+    gdcm::Attribute<0x0,0x2> at;
+    at.SetValue( gdcm::UIDs::GetUIDString(
+        gdcm::UIDs::StudyRootQueryRetrieveInformationModelFIND ) );
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x100> at = { 0x8020 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x110> msgid = { 1 };
+    if( command.FindDataElement( msgid.GetTag() ) )
+      msgid.SetFromDataSet( command );
+    else
+      {
+      gdcm::Attribute<0x0,0x120> cancelid;
+      cancelid.SetFromDataSet( command );
+      msgid.SetValue( cancelid.GetValue() );
+      }
+    gdcm::Attribute<0x0,0x120> at = { msgid.GetValue() };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x800> at = { identifier ? (uint16_t)0x0000 : (uint16_t)0x0101 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x900> at = { status };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    std::vector<gdcm::network::BasePDU*> pdus;
+    gdcm::network::PresentationDataValue pdv;
+    pdv.SetPresentationContextID( PresentationContextID );
+    pdv.SetCommand( true );
+    pdv.SetLastFragment( true );
+    pdv.SetDataSet( rsp );
+    gdcm::network::PDataTFPDU *pdu = new gdcm::network::PDataTFPDU;
+    pdu->AddPresentationDataValue( pdv );
+    pdus.push_back( pdu );
+    if( identifier )
+      {
+      gdcm::network::PresentationDataValue data;
+      data.SetPresentationContextID( PresentationContextID );
+      data.SetMessageHeader( 2 );
+      data.SetDataSet( *identifier );
+      gdcm::network::PDataTFPDU *datapdu = new gdcm::network::PDataTFPDU;
+      datapdu->AddPresentationDataValue( data );
+      pdus.push_back( datapdu );
+      }
+    Transport->Send( c, pdus );
+    }
+
+  void HandleMessage(gdcm::network::ULConnection &c,
+    const gdcm::DataSet &command, const gdcm::DataSet &ds) override
+    {
+    gdcm::Attribute<0x0,0x100> commandfield;
+    commandfield.SetFromDataSet( command );
+    if( commandfield.GetValue() == 0x0FFF )
+      {
+      ++NumberOfCancel;
+      SendResponse( c, command, 0xFE00, nullptr );
+      return;
+      }
+    if( commandfield.GetValue() != 0x0020 ) return;
+
+    gdcm::Attribute<0x10,0x20> patientid;
+    patientid.SetFromDataSet( ds );
+    for( int i = 0; i < NumberOfMatches; ++i )
+      {
+      gdcm::DataSet identifier;
+      gdcm::Attribute<0x20,0xd> studyuid;
+      std::ostringstream os;
+      os << "1.2.3.4." << i;
+      studyuid.SetValue( os.str().c_str() );
+      identifier.Insert( studyuid.GetAsDataElement() );
+      SendResponse( c, command, 0xFF00, &identifier );
+      }
+    if( patientid.GetValue().Trim() == "FINITE" )
+      SendResponse( c, command, 0x0000, nullptr );
+    }
+};
+
+// Stop the query after a few results
+class CountingCallback : public gdcm::network::ULConnectionCallback
+{
+public:
+  int NumberOfDataSets = 0;
+  int CancelAfter = 0;
+  void HandleDataSet(const gdcm::DataSet& ) override
+    {
+    ++NumberOfDataSets;
+    if( CancelAfter && NumberOfDataSets == CancelAfter ) RequestCancel();
+    }
+  void HandleResponse(const gdcm::DataSet& ) override {}
+};
+}
+
+int TestServiceClassUserFind(int , char *[])
+{
+  using namespace gdcm::network;
+  if( !ULNonBlockingTransport::IsSupported() ) return 0;
+
+  const uint16_t port = 11644;
+  gdcm::PresentationContextGenerator generator;
+  if( !generator.GenerateFromUID(
+      gdcm::UIDs::StudyRootQueryRetrieveInformationModelFIND ) ) return 1;
+
+  FindSCPCallback callback;
+  ULNonBlockingTransport transport;
+  callback.Transport = &transport;
+  callback.PresentationContextID =
+    generator.GetPresentationContexts()[0].GetPresentationContextID();
+  transport.SetCallback( &callback );
+  if( !transport.Listen( port ) ) return 1;
+
+  std::atomic<bool> done( false );
+  std::thread scp( [&transport, &done]() {
+    while( !done ) transport.ProcessEvents( 100 );
+  } );
+
+  gdcm::SmartPointer<gdcm::ServiceClassUser> scu = new gdcm::ServiceClassUser;
+  scu->SetHostname( "localhost" );
+  scu->SetPort( port );
+  scu->SetTimeout( 10 );
+  bool ret = scu->InitializeConnection();
+  std::vector<gdcm::DataSet> datasets;
+  CountingCallback canceling;
+  canceling.CancelAfter = 5;
+  if( ret )
+    {
+    scu->SetPresentationContexts( generator.GetPresentationContexts() );
+    ret = scu->StartAssociation();
+    }
+  if( ret )
+    {
+    gdcm::DataSet queryds;
+    gdcm::Attribute<0x10,0x20> patientid = { "FINITE" };
+    queryds.Insert( patientid.GetAsDataElement() );
+    gdcm::BaseRootQuery *query = gdcm::CompositeNetworkFunctions::ConstructQuery(
+      gdcm::eStudyRootType, gdcm::eStudy, queryds );
+    ret = query && scu->SendFind( query, datasets );
+    delete query;
+    }
+  if( ret )
+    {
+    gdcm::DataSet queryds;
+    gdcm::Attribute<0x10,0x20> patientid = { "ENDLESS" };
+    queryds.Insert( patientid.GetAsDataElement() );
+    gdcm::BaseRootQuery *query = gdcm::CompositeNetworkFunctions::ConstructQuery(
+      gdcm::eStudyRootType, gdcm::eStudy, queryds );
+    ret = query && scu->SendFind( query, &canceling );
+    delete query;
+    }
+  if( ret )
+    {
+    ret = scu->StopAssociation();
+    }
+
+  done = true;
+  scp.join();
+
+  if( !ret )
+    {
+    std::cerr << "C-FIND failed" << std::endl;
+    return 1;
+    }
+  if( datasets.size() != (size_t)NumberOfMatches )
+    {
+    std::cerr << "Wrong number of matches: " << datasets.size() << std::endl;
+    return 1;
+    }
+  if( callback.NumberOfCancel != 1
+    || canceling.NumberOfDataSets != canceling.CancelAfter )
+    {
+    std::cerr << "Cancel failed: " << callback.NumberOfCancel << " "
+      << canceling.NumberOfDataSets << std::endl;
+    return 1;
+    }
+
+  return 0;
+}
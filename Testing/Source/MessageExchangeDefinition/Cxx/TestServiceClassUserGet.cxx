@@ -0,0 +1,222 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULGetSCPCallback.h"
+#include "gdcmServiceClassUser.h"
+#include "gdcmCompositeNetworkFunctions.h"
+#include "gdcmPresentationContextGenerator.h"
+#include "gdcmAttribute.h"
+#include "gdcmWriter.h"
+#include "gdcmReader.h"
+#include "gdcmSystem.h"
+#include "gdcmTesting.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+const int NumberOfInstances = 5;
+
+// Serve the files of a directory, PatientID "MISSING" also gets a file which
+// does not exist, and PatientID "ESCAPE" a file whose SOP Instance UID is a
+// relative path (failed sub-operations)
+class GetSCPCallback : public gdcm::network::ULGetSCPCallback
+{
+public:
+  std::vector<std::string> Filenames;
+  std::string EscapeFilename;
+  bool GetFilenames(const gdcm::DataSet &identifier,
+    std::vector<std::string> &filenames) override
+    {
+    filenames = Filenames;
+    gdcm::Attribute<0x10,0x20> patientid;
+    patientid.SetFromDataSet( identifier );
+    if( patientid.GetValue().Trim() == "MISSING" )
+      filenames.push_back( "does-not-exist.dcm" );
+    if( patientid.GetValue().Trim() == "ESCAPE" )
+      filenames.push_back( EscapeFilename );
+    return true;
+    }
+};
+
+std::string MakeInstanceUID(int i)
+{
+  std::ostringstream os;
+  os << "1.2.3.4.5." << i;
+  return os.str();
+}
+
+bool WriteInstance(const char *filename, const char *sopinstanceuid, char value)
+{
+  gdcm::Writer w;
+  gdcm::DataSet &ds = w.GetFile().GetDataSet();
+  {
+  gdcm::Attribute<0x8,0x16> at;
+  at.SetValue( gdcm::UIDs::GetUIDString( gdcm::UIDs::CTImageStorage ) );
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  gdcm::Attribute<0x8,0x18> at;
+  at.SetValue( sopinstanceuid );
+  ds.Insert( at.GetAsDataElement() );
+  }
+  std::vector<char> pixels( 64 * 1024, value );
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetVR( gdcm::VR::OW );
+  pixeldata.SetByteValue( &pixels[0], (uint32_t)pixels.size() );
+  ds.Insert( pixeldata );
+  w.GetFile().GetHeader().SetDataSetTransferSyntax(
+    gdcm::TransferSyntax::ImplicitVRLittleEndian );
+  w.SetFileName( filename );
+  return w.Write();
+}
+}
+
+int TestServiceClassUserGet(int , char *[])
+{
+  using namespace gdcm::network;
+  if( !ULNonBlockingTransport::IsSupported() ) return 0;
+
+  const char subdir[] = "TestServiceClassUserGet";
+  std::string inputdir = gdcm::Testing::GetTempDirectory( subdir );
+  inputdir += "/input";
+  std::string outputdir = gdcm::Testing::GetTempDirectory( subdir );
+  outputdir += "/output";
+  if( !gdcm::System::MakeDirectory( inputdir.c_str() )
+    || !gdcm::System::MakeDirectory( outputdir.c_str() ) ) return 1;
+
+  GetSCPCallback callback;
+  gdcm::PresentationContextGenerator generator;
+  if( !generator.GenerateFromUID(
+      gdcm::UIDs::StudyRootQueryRetrieveInformationModelGET ) ) return 1;
+  for( int i = 0; i < NumberOfInstances; ++i )
+    {
+    std::string filename = inputdir + "/" + MakeInstanceUID( i ) + ".dcm";
+    if( !WriteInstance( filename.c_str(), MakeInstanceUID( i ).c_str(), (char)i ) )
+      return 1;
+    callback.Filenames.push_back( filename );
+    }
+  {
+  gdcm::Reader reader;
+  reader.SetFileName( callback.Filenames[0].c_str() );
+  if( !reader.Read() || !generator.AddFromFile( reader.GetFile() ) ) return 1;
+  }
+  // would be written next to the output directory if the UID was trusted
+  callback.EscapeFilename = inputdir + "/escape.dcm";
+  if( !WriteInstance( callback.EscapeFilename.c_str(), "../escape", 0 ) ) return 1;
+  const std::string escaped = outputdir + "/../escape.dcm";
+  gdcm::System::RemoveFile( escaped.c_str() );
+
+  const uint16_t port = 11646;
+  ULNonBlockingTransport transport;
+  callback.SetTransport( &transport );
+  transport.SetCallback( &callback );
+  if( !transport.Listen( port ) ) return 1;
+
+  std::atomic<bool> done( false );
+  std::thread scp( [&transport, &done]() {
+    while( !done ) transport.ProcessEvents( 100 );
+  } );
+
+  gdcm::SmartPointer<gdcm::ServiceClassUser> scu = new gdcm::ServiceClassUser;
+  scu->SetHostname( "localhost" );
+  scu->SetPort( port );
+  scu->SetTimeout( 10 );
+  bool ret = scu->InitializeConnection();
+  bool missing = true;
+  if( ret )
+    {
+    scu->SetPresentationContexts( generator.GetPresentationContexts() );
+    ret = scu->StartAssociation();
+    }
+  if( ret )
+    {
+    gdcm::DataSet queryds;
+    gdcm::Attribute<0x20,0xd> studyuid = { "1.2.3.4" };
+    queryds.Insert( studyuid.GetAsDataElement() );
+    gdcm::BaseRootQuery *query = gdcm::CompositeNetworkFunctions::ConstructQuery(
+      gdcm::eStudyRootType, gdcm::eStudy, queryds, gdcm::eGet );
+    ret = query && scu->SendGet( query, outputdir.c_str() );
+    delete query;
+    }
+  if( ret )
+    {
+    // one failed sub-operation: the C-GET completes with a warning
+    gdcm::DataSet queryds;
+    gdcm::Attribute<0x10,0x20> patientid = { "MISSING" };
+    queryds.Insert( patientid.GetAsDataElement() );
+    gdcm::BaseRootQuery *query = gdcm::CompositeNetworkFunctions::ConstructQuery(
+      gdcm::eStudyRootType, gdcm::eStudy, queryds, gdcm::eGet );
+    missing = query && scu->SendGet( query, outputdir.c_str() );
+    delete query;
+    }
+  bool escape = true;
+  if( ret )
+    {
+    gdcm::DataSet queryds;
+    gdcm::Attribute<0x10,0x20> patientid = { "ESCAPE" };
+    queryds.Insert( patientid.GetAsDataElement() );
+    gdcm::BaseRootQuery *query = gdcm::CompositeNetworkFunctions::ConstructQuery(
+      gdcm::eStudyRootType, gdcm::eStudy, queryds, gdcm::eGet );
+    escape = query && scu->SendGet( query, outputdir.c_str() );
+    delete query;
+    }
+  if( ret )
+    {
+    ret = scu->StopAssociation();
+    }
+
+  done = true;
+  scp.join();
+
+  if( !ret || missing )
+    {
+    std::cerr << "C-GET failed" << std::endl;
+    return 1;
+    }
+  if( escape || gdcm::System::FileExists( escaped.c_str() ) )
+    {
+    std::cerr << "Invalid SOP Instance UID was used as file name" << std::endl;
+    return 1;
+    }
+  for( int i = 0; i < NumberOfInstances; ++i )
+    {
+    std::string filename = outputdir + "/" + MakeInstanceUID( i ) + ".dcm";
+    gdcm::Reader reader;
+    reader.SetFileName( filename.c_str() );
+    if( !reader.Read() )
+      {
+      std::cerr << "Could not read: " << filename << std::endl;
+      return 1;
+      }
+    const gdcm::DataSet &ds = reader.GetFile().GetDataSet();
+    gdcm::Attribute<0x8,0x18> sopinstance;
+    sopinstance.SetFromDataSet( ds );
+    const gdcm::DataElement &pixeldata = ds.GetDataElement( gdcm::Tag(0x7fe0,0x0010) );
+    if( MakeInstanceUID( i ) != sopinstance.GetValue().c_str()
+      || !pixeldata.GetByteValue() || pixeldata.GetVL() != 64 * 1024
+      || pixeldata.GetByteValue()->GetPointer()[0] != (char)i )
+      {
+      std::cerr << "Wrong instance: " << filename << std::endl;
+      return 1;
+      }
+    }
+
+  return 0;
+}
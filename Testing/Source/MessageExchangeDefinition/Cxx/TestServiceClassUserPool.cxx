@@ -0,0 +1,179 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULConnection.h"
+#include "gdcmServiceClassUserPool.h"
+#include "gdcmCompositeNetworkFunctions.h"
+#include "gdcmPresentationContextGenerator.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmAttribute.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+// Minimal C-ECHO SCP
+class EchoSCPCallback : public gdcm::network::ULTransportCallback
+{
+public:
+  gdcm::network::ULNonBlockingTransport *Transport = nullptr;
+  uint8_t PresentationContextID = 0;
+  std::atomic<int> NumberOfAssociations{0};
+  std::atomic<int> NumberOfEchoes{0};
+  void HandleAssociation(gdcm::network::ULConnection &) override
+    {
+    ++NumberOfAssociations;
+    }
+  void HandleMessage(gdcm::network::ULConnection &c,
+    const gdcm::DataSet &command, const gdcm::DataSet &) override
+    {
+    gdcm::Attribute<0x0,0x100> commandfield;
+    commandfield.SetFromDataSet( command );
+    if( commandfield.GetValue() != 0x0030 ) return;
+    ++NumberOfEchoes;
+
+    gdcm::CommandDataSet rsp;
+    rsp.Insert( command.GetDataElement( gdcm::Tag(0x0,0x2) ) );
+    {
+    gdcm::Attribute<0x0,0x100> at = { 0x8030 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x110> msgid;
+    msgid.SetFromDataSet( command );
+    gdcm::Attribute<0x0,0x120> at = { msgid.GetValue() };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x800> at = { 0x0101 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x900> at = { 0 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    gdcm::network::PresentationDataValue pdv;
+    pdv.SetPresentationContextID( PresentationContextID );
+    pdv.SetCommand( true );
+    pdv.SetLastFragment( true );
+    pdv.SetDataSet( rsp );
+    gdcm::network::PDataTFPDU *pdu = new gdcm::network::PDataTFPDU;
+    pdu->AddPresentationDataValue( pdv );
+    std::vector<gdcm::network::BasePDU*> pdus;
+    pdus.push_back( pdu );
+    Transport->Send( c, pdus );
+    }
+};
+}
+
+int TestServiceClassUserPool(int , char *[])
+{
+  using namespace gdcm::network;
+  if( !ULNonBlockingTransport::IsSupported() ) return 0;
+
+  const uint16_t port = 11645;
+  gdcm::PresentationContextGenerator generator;
+  if( !generator.GenerateFromUID( gdcm::UIDs::VerificationSOPClass ) ) return 1;
+
+  EchoSCPCallback callback;
+  ULNonBlockingTransport transport;
+  callback.Transport = &transport;
+  callback.PresentationContextID =
+    generator.GetPresentationContexts()[0].GetPresentationContextID();
+  transport.SetCallback( &callback );
+  if( !transport.Listen( port ) ) return 1;
+
+  std::atomic<bool> done( false );
+  std::thread scp( [&transport, &done]() {
+    while( !done ) transport.ProcessEvents( 100 );
+  } );
+
+  int ret = 0;
+  {
+  gdcm::ServiceClassUserPool pool;
+  pool.SetHealthCheckInterval( -1 );
+
+  // sequential use: a single association
+  gdcm::ServiceClassUser *first = nullptr;
+  for( int i = 0; i < 10; ++i )
+    {
+    gdcm::ServiceClassUser *scu =
+      pool.Acquire( "localhost", port, generator.GetPresentationContexts() );
+    if( !scu || !scu->SendEcho() ) ret = 1;
+    if( i == 0 ) first = scu;
+    else if( first != scu ) ret = 1;
+    pool.Release( scu );
+    }
+  if( callback.NumberOfAssociations != 1 || callback.NumberOfEchoes != 10 )
+    {
+    std::cerr << "Association was not reused" << std::endl;
+    ret = 1;
+    }
+
+  // health check on reuse
+  pool.SetHealthCheckInterval( 0 );
+  {
+  gdcm::ServiceClassUser *scu =
+    pool.Acquire( "localhost", port, generator.GetPresentationContexts() );
+  if( scu != first || callback.NumberOfEchoes != 11 ) ret = 1;
+  pool.Release( scu );
+  }
+  pool.SetHealthCheckInterval( -1 );
+
+  // concurrent use, through CompositeNetworkFunctions
+  gdcm::CompositeNetworkFunctions::SetAssociationPool( &pool );
+  std::atomic<int> failures( 0 );
+  std::vector<std::thread> threads;
+  for( int t = 0; t < 4; ++t )
+    {
+    threads.push_back( std::thread( [&failures, port]() {
+      for( int i = 0; i < 10; ++i )
+        if( !gdcm::CompositeNetworkFunctions::CEcho( "localhost", port ) ) ++failures;
+    } ) );
+    }
+  for( size_t t = 0; t < threads.size(); ++t ) threads[t].join();
+  gdcm::CompositeNetworkFunctions::SetAssociationPool( nullptr );
+  if( failures != 0 || callback.NumberOfEchoes != 51 || callback.NumberOfAssociations > 4 )
+    {
+    std::cerr << "Concurrent reuse failed: " << failures << " "
+      << callback.NumberOfEchoes << " " << callback.NumberOfAssociations << std::endl;
+    ret = 1;
+    }
+
+  // idle timeout
+  pool.SetIdleTimeout( 0 );
+  pool.Purge();
+  if( pool.GetNumberOfIdleAssociations() != 0 ) ret = 1;
+  }
+
+  done = true;
+  scp.join();
+
+  // all associations have been released
+  for( int i = 0; i < 50 && transport.GetNumberOfConnections(); ++i )
+    transport.ProcessEvents( 100 );
+  if( transport.GetNumberOfConnections() != 0 )
+    {
+    std::cerr << "Associations were not released" << std::endl;
+    ret = 1;
+    }
+
+  return ret;
+}
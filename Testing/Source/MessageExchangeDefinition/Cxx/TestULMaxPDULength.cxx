@@ -0,0 +1,164 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULConnection.h"
+#include "gdcmServiceClassUser.h"
+#include "gdcmPresentationContextGenerator.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmAttribute.h"
+#include "gdcmFile.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+// Minimal C-STORE SCP
+class StoreCallback : public gdcm::network::ULTransportCallback
+{
+public:
+  gdcm::network::ULNonBlockingTransport *Transport = nullptr;
+  uint8_t PresentationContextID = 0;
+  uint32_t PeerMaxPDUSize = 0;
+  uint32_t PixelDataLength = 0;
+  void HandleMessage(gdcm::network::ULConnection &c,
+    const gdcm::DataSet &command, const gdcm::DataSet &ds) override
+    {
+    gdcm::Attribute<0x0,0x100> commandfield;
+    commandfield.SetFromDataSet( command );
+    if( commandfield.GetValue() != 0x0001 ) return;
+    PeerMaxPDUSize = c.GetMaxPDUSize();
+    if( ds.FindDataElement( gdcm::Tag(0x7fe0,0x0010) ) )
+      PixelDataLength = ds.GetDataElement( gdcm::Tag(0x7fe0,0x0010) ).GetVL();
+
+    gdcm::CommandDataSet rsp;
+    rsp.Insert( command.GetDataElement( gdcm::Tag(0x0,0x2) ) );
+    rsp.Insert( command.GetDataElement( gdcm::Tag(0x0,0x1000) ) );
+    {
+    gdcm::Attribute<0x0,0x100> at = { 0x8001 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x110> msgid;
+    msgid.SetFromDataSet( command );
+    gdcm::Attribute<0x0,0x120> at = { msgid.GetValue() };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x800> at = { 0x0101 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    {
+    gdcm::Attribute<0x0,0x900> at = { 0 };
+    rsp.Insert( at.GetAsDataElement() );
+    }
+    gdcm::network::PresentationDataValue pdv;
+    pdv.SetPresentationContextID( PresentationContextID );
+    pdv.SetCommand( true );
+    pdv.SetLastFragment( true );
+    pdv.SetDataSet( rsp );
+    gdcm::network::PDataTFPDU *pdu = new gdcm::network::PDataTFPDU;
+    pdu->AddPresentationDataValue( pdv );
+    std::vector<gdcm::network::BasePDU*> pdus;
+    pdus.push_back( pdu );
+    Transport->Send( c, pdus );
+    }
+};
+}
+
+int TestULMaxPDULength(int , char *[])
+{
+  using namespace gdcm::network;
+  if( !ULNonBlockingTransport::IsSupported() ) return 0;
+
+  const uint16_t port = 11643;
+  const uint32_t maxpdu = 1024 * 1024;
+  // a few MB of data set, sent as a handful of large PDUs
+  gdcm::DataSet ds;
+  {
+  gdcm::Attribute<0x8,0x16> at;
+  at.SetValue( gdcm::UIDs::GetUIDString( gdcm::UIDs::CTImageStorage ) );
+  ds.Insert( at.GetAsDataElement() );
+  }
+  {
+  gdcm::Attribute<0x8,0x18> at;
+  at.SetValue( "1.2.3.4.5" );
+  ds.Insert( at.GetAsDataElement() );
+  }
+  const uint32_t pixellen = 3 * maxpdu;
+  std::vector<char> pixels( pixellen, 0x42 );
+  gdcm::DataElement pixeldata( gdcm::Tag(0x7fe0,0x0010) );
+  pixeldata.SetVR( gdcm::VR::OW );
+  pixeldata.SetByteValue( &pixels[0], pixellen );
+  ds.Insert( pixeldata );
+
+  gdcm::SmartPointer<gdcm::File> file = new gdcm::File;
+  file->SetDataSet( ds );
+  file->GetHeader().SetDataSetTransferSyntax( gdcm::TransferSyntax::ImplicitVRLittleEndian );
+  file->GetHeader().FillFromDataSet( ds );
+  gdcm::PresentationContextGenerator generator;
+  if( !generator.AddFromFile( *file ) ) return 1;
+
+  StoreCallback callback;
+  ULNonBlockingTransport transport;
+  callback.Transport = &transport;
+  callback.PresentationContextID =
+    generator.GetPresentationContexts()[0].GetPresentationContextID();
+  transport.SetCallback( &callback );
+  transport.SetMaxPDULength( maxpdu );
+  if( !transport.Listen( port ) ) return 1;
+
+  std::atomic<bool> done( false );
+  std::thread scp( [&transport, &done]() {
+    while( !done ) transport.ProcessEvents( 100 );
+  } );
+
+  gdcm::SmartPointer<gdcm::ServiceClassUser> scu = new gdcm::ServiceClassUser;
+  scu->SetHostname( "localhost" );
+  scu->SetPort( port );
+  scu->SetTimeout( 10 );
+  scu->SetMaxPDULength( maxpdu );
+  bool ret = scu->InitializeConnection();
+  if( ret )
+    {
+    scu->SetPresentationContexts( generator.GetPresentationContexts() );
+    ret = scu->StartAssociation() && scu->SendStore( ds ) && scu->StopAssociation();
+    }
+
+  done = true;
+  scp.join();
+
+  if( !ret )
+    {
+    std::cerr << "C-STORE failed" << std::endl;
+    return 1;
+    }
+  if( callback.PeerMaxPDUSize != maxpdu )
+    {
+    std::cerr << "Wrong negotiated max PDU: " << callback.PeerMaxPDUSize << std::endl;
+    return 1;
+    }
+  if( callback.PixelDataLength != pixellen )
+    {
+    std::cerr << "Wrong Pixel Data length: " << callback.PixelDataLength << std::endl;
+    return 1;
+    }
+
+  return 0;
+}
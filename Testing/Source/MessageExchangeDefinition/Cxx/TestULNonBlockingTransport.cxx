@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gdcmULNonBlockingTransport.h"
+#include "gdcmULConnection.h"
+#include "gdcmPresentationContextGenerator.h"
+#include "gdcmPDataTFPDU.h"
+#include "gdcmCommandDataSet.h"
+#include "gdcmAttribute.h"
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+class EchoCallback : public gdcm::network::ULTransportCallback
+{
+public:
+  int NumberOfAssociations = 0;
+  int NumberOfEchoes = 0;
+  int NumberOfClose = 0;
+  // when set, the association is aborted from within HandleMessage
+  gdcm::network::ULNonBlockingTransport *AbortingTransport = nullptr;
+  void HandleAssociation(gdcm::network::ULConnection &) override
+    {
+    ++NumberOfAssociations;
+    }
+  void HandleMessage(gdcm::network::ULConnection &connection,
+    const gdcm::DataSet &command, const gdcm::DataSet &ds) override
+    {
+    gdcm::Attribute<0x0,0x100> commandfield;
+    commandfield.SetFromDataSet( command );
+    if( commandfield.GetValue() == 0x0030 && ds.IsEmpty() ) ++NumberOfEchoes;
+    if( AbortingTransport ) AbortingTransport->Abort( connection );
+    }
+  void HandleClose(gdcm::network::ULConnection &) override
+    {
+    ++NumberOfClose;
+    }
+};
+}
+
+static gdcm::network::ULConnection *Associate(
+  gdcm::network::ULNonBlockingTransport &transport, uint16_t port)
+{
+  using namespace gdcm::network;
+  gdcm::PresentationContextGenerator generator;
+  if( !generator.GenerateFromUID( gdcm::UIDs::VerificationSOPClass ) ) return nullptr;
+  // the very same thread acts as SCU and SCP:
+  ULConnection *scu = transport.Connect( "ECHOSCU", "ECHOSCP", "localhost", port,
+    generator.GetPresentationContexts() );
+  if( !scu ) return nullptr;
+
+  for( int i = 0; i < 100 && scu->GetState() != eSta6TransferReady; ++i )
+    transport.ProcessEvents( 100 );
+  if( scu->GetState() != eSta6TransferReady
+    || scu->GetAcceptedPresentationContexts().empty() )
+    {
+    std::cerr << "Association failed" << std::endl;
+    return nullptr;
+    }
+  return scu;
+}
+
+static bool SendEcho(gdcm::network::ULNonBlockingTransport &transport,
+  gdcm::network::ULConnection &scu)
+{
+  using namespace gdcm::network;
+  gdcm::CommandDataSet cmd;
+  {
+  gdcm::Attribute<0x0,0x2> at;
+  at.SetValue( gdcm::UIDs::GetUIDString( gdcm::UIDs::VerificationSOPClass ) );
+  cmd.Insert( at.GetAsDataElement() );
+  }
+  {
+  gdcm::Attribute<0x0,0x100> at = { 0x0030 };
+  cmd.Insert( at.GetAsDataElement() );
+  }
+  {
+  gdcm::Attribute<0x0,0x110> at = { 1 };
+  cmd.Insert( at.GetAsDataElement() );
+  }
+  {
+  gdcm::Attribute<0x0,0x800> at = { 0x0101 };
+  cmd.Insert( at.GetAsDataElement() );
+  }
+  PresentationDataValue pdv;
+  pdv.SetPresentationContextID(
+    scu.GetAcceptedPresentationContexts()[0].GetPresentationContextID() );
+  pdv.SetCommand( true );
+  pdv.SetLastFragment( true );
+  pdv.SetDataSet( cmd );
+  PDataTFPDU *pdu = new PDataTFPDU;
+  pdu->AddPresentationDataValue( pdv );
+  std::vector<BasePDU*> pdus;
+  pdus.push_back( pdu );
+  return transport.Send( scu, pdus );
+}
+
+int TestULNonBlockingTransport(int , char *[])
+{
+  using namespace gdcm::network;
+  if( !ULNonBlockingTransport::IsSupported() ) return 0;
+
+  EchoCallback callback;
+  ULNonBlockingTransport transport;
+  transport.SetCallback( &callback );
+  transport.SetTimeout( 10 );
+  const uint16_t port = 11642;
+  if( !transport.Listen( port ) )
+    {
+    std::cerr << "Could not listen on port " << port << std::endl;
+    return 1;
+    }
+
+  ULConnection *scu = Associate( transport, port );
+  if( !scu ) return 1;
+  if( callback.NumberOfAssociations != 2 ) return 1;
+  if( transport.GetNumberOfConnections() != 2 ) return 1;
+
+  // C-ECHO-RQ
+  if( !SendEcho( transport, *scu ) ) return 1;
+  for( int i = 0; i < 100 && callback.NumberOfEchoes == 0; ++i )
+    transport.ProcessEvents( 100 );
+  if( callback.NumberOfEchoes != 1 )
+    {
+    std::cerr << "C-ECHO-RQ not received" << std::endl;
+    return 1;
+    }
+
+  if( !transport.Release( *scu ) ) return 1;
+  for( int i = 0; i < 100 && transport.GetNumberOfConnections(); ++i )
+    transport.ProcessEvents( 100 );
+  if( transport.GetNumberOfConnections() != 0 || callback.NumberOfClose != 2 )
+    {
+    std::cerr << "Release failed" << std::endl;
+    return 1;
+    }
+
+  // Abort from within the callback: the connection is only destroyed once the
+  // callback returned
+  callback.AbortingTransport = &transport;
+  scu = Associate( transport, port );
+  if( !scu ) return 1;
+  if( !SendEcho( transport, *scu ) ) return 1;
+  for( int i = 0; i < 100 && transport.GetNumberOfConnections(); ++i )
+    transport.ProcessEvents( 100 );
+  if( transport.GetNumberOfConnections() != 0 || callback.NumberOfEchoes != 2
+    || callback.NumberOfClose != 4 )
+    {
+    std::cerr << "Abort failed" << std::endl;
+    return 1;
+    }
+  callback.AbortingTransport = nullptr;
+
+#if !defined(_WIN32)
+  // a peer announcing a PDU larger than our Maximum Length is aborted before
+  // anything is buffered
+  const int fd = socket( AF_INET, SOCK_STREAM, 0 );
+  if( fd < 0 ) return 1;
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons( port );
+  addr.sin_addr.s_addr = inet_addr( "127.0.0.1" );
+  if( connect( fd, (struct sockaddr*)&addr, sizeof(addr) ) != 0 )
+    {
+    close( fd );
+    return 1;
+    }
+  for( int i = 0; i < 100 && transport.GetNumberOfConnections() != 1; ++i )
+    transport.ProcessEvents( 100 );
+  const unsigned char header[] = { 0x04, 0x00, 0x7f, 0xff, 0xff, 0xff };
+  const bool sent = send( fd, header, sizeof(header), 0 ) == (ssize_t)sizeof(header);
+  for( int i = 0; i < 100 && transport.GetNumberOfConnections(); ++i )
+    transport.ProcessEvents( 100 );
+  close( fd );
+  if( !sent || transport.GetNumberOfConnections() != 0 || callback.NumberOfClose != 5 )
+    {
+    std::cerr << "Oversized PDU not rejected" << std::endl;
+    return 1;
+    }
+#endif
+
+  return 0;
+}
@@ -48,6 +48,7 @@
 #include "gdcmTrace.h"
 #include "gdcmImageChangePlanarConfiguration.h"
 #include "gdcmDirectoryHelper.h"
+#include "gdcmImageHelper.h"
 
 #include <sstream>
 
@@ -578,9 +579,33 @@ int vtkGDCMImageReader::RequestInformation(vtkInformation *request,
 }
 #endif
 
+// Modality LUT of each frame of an enhanced multi-frame image, only when it
+// changes from one frame to the next (and the one of image comes from the
+// functional groups)
+static bool GetPerFrameInterceptSlope(gdcm::File const & file,
+  gdcm::Image const & image, std::vector<gdcm::FrameGeometry> & frames)
+{
+  if( image.GetNumberOfDimensions() != 3
+    || !gdcm::ImageHelper::GetFrameGeometryValues( file, frames )
+    || frames.size() != image.GetDimension(2) )
+    {
+    return false;
+    }
+  if( frames[0].Intercept != image.GetIntercept() || frames[0].Slope != image.GetSlope() )
+    {
+    return false;
+    }
+  for( size_t i = 1; i < frames.size(); ++i )
+    {
+    if( frames[i].Intercept != frames[0].Intercept || frames[i].Slope != frames[0].Slope )
+      return true;
+    }
+  return false;
+}
+
 static gdcm::PixelFormat::ScalarType
 ComputePixelTypeFromFiles(const char *inputfilename, vtkStringArray *filenames,
-  gdcm::Image const & imageref)
+  gdcm::File const & fileref, gdcm::Image const & imageref)
 {
   gdcm::PixelFormat::ScalarType outputpt;
   outputpt = gdcm::PixelFormat::UNKNOWN;
@@ -600,6 +625,23 @@ ComputePixelTypeFromFiles(const char *inputfilename, vtkStringArray *filenames,
     r.SetSlope( scale );
     r.SetPixelFormat( pixeltype );
     outputpt = r.ComputeInterceptSlopePixelType();
+
+    // Same problem with the frames of an enhanced multi-frame image:
+    std::vector<gdcm::FrameGeometry> frames;
+    if( pixeltype.GetSamplesPerPixel() == 1
+      && GetPerFrameInterceptSlope( fileref, image, frames ) )
+      {
+      for( size_t i = 1; i < frames.size(); ++i )
+        {
+        r.SetIntercept( frames[i].Intercept );
+        r.SetSlope( frames[i].Slope );
+        if( r.ComputeInterceptSlopePixelType() != outputpt )
+          {
+          outputpt = gdcm::PixelFormat::FLOAT64;
+          break;
+          }
+        }
+      }
     }
   else if ( filenames && filenames->GetNumberOfValues() > 0 )
     {
@@ -833,7 +875,7 @@ int vtkGDCMImageReader::RequestInformationCompat()
 
   //gdcm::PixelFormat::ScalarType outputpt = pixeltype;
   gdcm::PixelFormat::ScalarType outputpt =
-    ComputePixelTypeFromFiles(this->FileName, this->FileNames, image);
+    ComputePixelTypeFromFiles(this->FileName, this->FileNames, reader.GetFile(), image);
   if( this->FileName )
     {
     // We should test that outputpt is 8 when BitsAllocated = 16 / Bits Stored = 8
@@ -1081,6 +1123,10 @@ int vtkGDCMImageReader::LoadSingleFile(const char *filename, char *pointer, unsi
   // HACK: Make sure that Shift/Scale are the one from the file:
   this->Shift = image.GetIntercept();
   this->Scale = image.GetSlope();
+  // Enhanced multi-frame: the Modality LUT can change with the frame
+  std::vector<gdcm::FrameGeometry> frames;
+  const bool perframe = pixeltype.GetSamplesPerPixel() == 1
+    && GetPerFrameInterceptSlope( reader.GetFile(), image, frames );
   if( (this->Scale != 1.0 || this->Shift != 0.0) || this->ForceRescale )
   {
     if( pixeltype.GetSamplesPerPixel() != 1 )
@@ -1091,7 +1137,7 @@ int vtkGDCMImageReader::LoadSingleFile(const char *filename, char *pointer, unsi
     }
   }
 
-  if( (this->Scale != 1.0 || this->Shift != 0.0) || this->ForceRescale )
+  if( (this->Scale != 1.0 || this->Shift != 0.0) || this->ForceRescale || perframe )
   {
     assert( pixeltype.GetSamplesPerPixel() == 1 );
     gdcm::Rescaler r;
@@ -1149,11 +1195,24 @@ int vtkGDCMImageReader::LoadSingleFile(const char *filename, char *pointer, unsi
     char * copy = new char[len];
     //memcpy(copy, pointer, len);
     image.GetBuffer(copy);
-    if( !r.Rescale(pointer,copy,len) )
+    // One Modality LUT per frame, or the same for all of them:
+    const size_t nframes = perframe ? frames.size() : 1;
+    const unsigned long framelen = len / nframes;
+    const unsigned long outframelen = framelen / pixeltype.GetPixelSize() * data->GetScalarSize();
+    for( size_t i = 0; i < nframes; ++i )
       {
-      vtkErrorMacro( "Could not Rescale" );
-      // problem with gdcmData/3E768EB7.dcm
-      return 0;
+      if( perframe )
+        {
+        r.SetIntercept( frames[i].Intercept );
+        r.SetSlope( frames[i].Slope );
+        }
+      if( !r.Rescale(pointer + i * outframelen, copy + i * framelen, framelen) )
+        {
+        vtkErrorMacro( "Could not Rescale" );
+        // problem with gdcmData/3E768EB7.dcm
+        delete[] copy;
+        return 0;
+        }
       }
     delete[] copy;
     // WARNING: sizeof(Real World Value) != sizeof(Stored Pixel)
@@ -46,6 +46,7 @@
 #include "gdcmImageChangePlanarConfiguration.h"
 #include "gdcmDirectoryHelper.h"
 #include "gdcmBoxRegion.h"
+#include "gdcmFilePrefetcher.h"
 
 #include <sstream>
 
@@ -102,6 +103,7 @@ vtkGDCMImageReader2::vtkGDCMImageReader2()
   this->MedicalImageProperties->SetDirectionCosine(1,0,0,0,1,0);
   this->SetImageOrientationPatient(1,0,0,0,1,0);
   this->ForceRescale = 0;
+  this->ReadAhead = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -781,7 +783,8 @@ static void InPlaceYFlipImage2(vtkImageData* data, const int dext[6])
 }
 
 //----------------------------------------------------------------------------
-int vtkGDCMImageReader2::LoadSingleFile(const char *filename, char *pointer, unsigned long &outlen)
+int vtkGDCMImageReader2::LoadSingleFile(const char *filename, char *pointer, unsigned long &outlen,
+  std::istream *is)
 {
   int *dext = this->GetDataExtent();
   vtkImageData *data = this->GetOutput(0);
@@ -790,7 +793,10 @@ int vtkGDCMImageReader2::LoadSingleFile(const char *filename, char *pointer, uns
   data->GetExtent(outExt);
 
   gdcm::ImageRegionReader reader;
-  reader.SetFileName( filename );
+  if( is )
+    reader.SetStream( *is );
+  else
+    reader.SetFileName( filename );
   if( !reader.ReadInformation() )
     {
     vtkErrorMacro( "ImageRegionReader failed: " << filename );
@@ -1174,11 +1180,23 @@ int vtkGDCMImageReader2::RequestDataCompat()
     // HACK: len is moved out of the loop so that when file > 1 start failing we can still know
     // the len of the buffer...technically all files should have the same len (not checked for now)
     unsigned long len = 0;
+    // Open/read round trips of the next files overlap with the decoding of
+    // the current one:
+    gdcm::FilePrefetcher prefetcher;
+    if( this->ReadAhead > 0 )
+      {
+      std::vector<std::string> filenames;
+      for(int j = outExt[4]; j <= outExt[5]; ++j)
+        filenames.push_back( this->FileNames->GetValue( j ) );
+      prefetcher.SetReadAhead( this->ReadAhead );
+      prefetcher.SetFileNames( filenames );
+      }
     for(int j = outExt[4]; !this->AbortExecute && j <= outExt[5]; ++j)
       {
       assert( j >= 0 && j <= this->FileNames->GetNumberOfValues() );
       const char *filename = this->FileNames->GetValue( j );
-      int load = this->LoadSingleFile( filename, pointer, len );
+      int load = this->LoadSingleFile( filename, pointer, len,
+        this->ReadAhead > 0 ? &prefetcher.GetStream( j - outExt[4] ) : 0 );
       vtkDebugMacro( "LoadSingleFile: " << filename );
       if( !load )
         {
@@ -1256,4 +1274,5 @@ vtkImageData* vtkGDCMImageReader2::GetIconImage()
 void vtkGDCMImageReader2::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "ReadAhead: " << this->ReadAhead << "\n";
 }
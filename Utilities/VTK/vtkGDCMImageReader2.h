@@ -68,6 +68,8 @@
 #include "vtkMedicalImageReader2.h"
 #include "vtkImageData.h"
 
+#include <iosfwd>
+
 class vtkPolyData;
 
 // vtkSystemIncludes.h defines:
@@ -210,6 +212,12 @@ public:
   vtkGetMacro(Shift,double);
   vtkGetMacro(Scale,double);
 
+  // Description:
+  // Number of files of a series (see SetFileNames) read ahead, in the
+  // background, of the one being loaded. 0 (default) disables read-ahead.
+  vtkGetMacro(ReadAhead,int);
+  vtkSetMacro(ReadAhead,int);
+
 protected:
   vtkGDCMImageReader2();
   ~vtkGDCMImageReader2();
@@ -252,7 +260,8 @@ protected:
   int ApplyPlanarConfiguration;
   int ApplyShiftScale;
 
-  int LoadSingleFile(const char *filename, char *pointer, unsigned long &outlen);
+  int LoadSingleFile(const char *filename, char *pointer, unsigned long &outlen,
+    std::istream *is = 0);
 
   double Shift;
   double Scale;
@@ -261,6 +270,7 @@ protected:
   int PlanarConfiguration;
   int LossyFlag;
   int ForceRescale;
+  int ReadAhead;
 
 protected:
   // TODO / FIXME